@@ -23,6 +23,52 @@
 #include "ipnfft.h"
 #include "matrix_D.h"
 
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
+static void trafo_interlaced_batched(
+    PNX(plan) ths);
+static void adj_interlaced_batched(
+    PNX(plan) ths);
+static int use_batched_interlacing(
+    const PNX(plan) ths, int trafo_flag);
+static R* get_interlaced_buffer(
+    PNX(plan) ths, INT size);
+static void release_interlaced_buffer(
+    PNX(plan) ths, R *buffer);
+static int trafo_step(
+    PNX(plan) ths, int step);
+static int adj_step(
+    PNX(plan) ths, int step);
+static void save_trafo_results(
+    PNX(plan) ths);
+static void average_trafo_results(
+    PNX(plan) ths);
+static void trafo_result_sizes(
+    const PNX(plan) ths,
+    INT *size_f, INT *size_grad_f, INT *size_hessian_f);
+static void save_adj_results(
+    PNX(plan) ths);
+static void average_adj_results(
+    PNX(plan) ths);
+static int exec_start(
+    PNX(plan) ths, int kind);
+static int exec_next(
+    PNX(plan) ths);
+static void exec_wait(
+    PNX(plan) ths);
+static int chunked_start(
+    PNX(plan) ths, int kind);
+static int chunked_running(
+    const PNX(plan) ths, int kind);
+static int start_exec_thread(
+    PNX(plan) ths);
+static int exec_thread_done(
+    const PNX(plan) ths);
+static void join_exec_thread(
+    PNX(plan) ths);
+
 /* wrappers for pfft init and cleanup */
 void PNX(init) (void){
   PX(init)();
@@ -30,6 +76,8 @@ void PNX(init) (void){
 
 
 void PNX(cleanup) (void){
+  PNX(forget_wisdom)();
+  PNX(forget_table_cache)();
   PX(cleanup)();
 }
 
@@ -108,12 +156,36 @@ void PNX(init_nodes)(
   PNX(free_x)(ths, pnfft_finalize_flags);
   PNX(free_f)(ths, pnfft_finalize_flags);
   PNX(free_grad_f)(ths, pnfft_finalize_flags);
+  PNX(free_hessian_f)(ths, pnfft_finalize_flags);
 
   /* allocate mem and adjust pnfft_flags, compute_flags */
-  ths->local_M = local_M;
+  PNX(free_sorted_index)(ths);
+  PNX(free_sparse_b)(ths);
+  PNX(free_redistribution)(ths);
+  ths->local_M = ths->local_M_capacity = local_M;
   PNX(malloc_x)(ths, pnfft_flags);
   PNX(malloc_f)(ths, pnfft_flags);
   PNX(malloc_grad_f)(ths, pnfft_flags);
+  PNX(malloc_hessian_f)(ths, pnfft_flags);
+}
+
+/* potential and ik gradient with a single forward FFT of 4 interleaved fields */
+static void grad_ik_batched(
+    PNX(plan) ths, int interlaced
+    )
+{
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+  PNX(scale_ik_diff_batched_c2c)(ths->local_N_start, ths->local_N, ths->pnfft_flags,
+      (C*)ths->g1);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+  PX(execute)(ths->pfft_forw_ik);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+  PNX(trafo_B_grad_ik_batched)(ths, interlaced);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
 }
 
 static void grad_ik_complex_input(
@@ -121,17 +193,17 @@ static void grad_ik_complex_input(
     )
 {
   /* duplicate g1 since we have to scale it several times for computing the gradient */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_D]);
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
   for(INT k=0; k<ths->local_N_total; k++)
     ((C*)ths->g1_buffer)[k] = ((C*)ths->g1)[k];
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_D]);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
 
   /* calculate potentials */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_F]);
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
   PNX(trafo_F)(ths);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_F]);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_B]);
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
   if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
     for(INT j=0; j<ths->local_M; j++)
       ths->f[j] = 0;
@@ -139,20 +211,20 @@ static void grad_ik_complex_input(
     for(INT j=0; j<ths->local_M; j++)
       ((C*)ths->f)[j] = 0;
   PNX(trafo_B_grad_ik)(ths, ths->f, 0, 1, interlaced);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_B]);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
 
   /* calculate gradient component wise */
   for(int dim =0; dim<3; dim++){
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_D]);
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
     PNX(scale_ik_diff_c2c)((C*)ths->g1_buffer, ths->local_N_start, ths->local_N, dim, ths->pnfft_flags,
         (C*)ths->g1);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_D]);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
     
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_F]);
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
     PNX(trafo_F)(ths);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_F]);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
 
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_B]);
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
     if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
       for(INT j=0; j<ths->local_M; j++)
         ths->grad_f[3*j+dim] = 0;
@@ -160,7 +232,7 @@ static void grad_ik_complex_input(
       for(INT j=0; j<ths->local_M; j++)
         ((C*)ths->grad_f)[3*j+dim] = 0;
     PNX(trafo_B_grad_ik)(ths, ths->grad_f, dim, 3, interlaced);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_B]);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
   }
 }
 
@@ -173,12 +245,12 @@ void PNX(direct_trafo)(
     return;
   }
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_WHOLE]);
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
   
   PNX(trafo_A)(ths);
 
   ths->timer_trafo[PNFFT_TIMER_ITER]++;
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_WHOLE]);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
 }
 
 void PNX(direct_adj)(
@@ -190,203 +262,808 @@ void PNX(direct_adj)(
     return;
   }
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_WHOLE]);
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
 
   PNX(adj_A)(ths);
 
   ths->timer_adj[PNFFT_TIMER_ITER]++;
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_WHOLE]);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
 }
 
-static void trafo(
+/* D and the potential and gradient of PNFFT_GRAD_IK, whose FFTs are not split into steps */
+static void trafo_grad_ik(
     PNX(plan) ths, int interlaced
     )
 {
   /* multiplication with matrix D */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_D]);
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
   PNX(trafo_D)(ths, interlaced);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_D]);
- 
-  if((ths->pnfft_flags & PNFFT_GRAD_IK) && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F) ){
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+
+  if(ths->pnfft_flags & PNFFT_BATCH_IK)
+    grad_ik_batched(ths, interlaced);
+  else
     grad_ik_complex_input(ths, interlaced);
-  } else {
-    /* multiplication with matrix F */
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_F]);
-    PNX(trafo_F)(ths);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_F]);
+}
+
+/* Step 'step' of the NFFT, returns 1 after the last step.
+ * Steps 0, 1 and 2 are D, F (the PFFT transposes) and B (the ghost cells) of the non-interlaced
+ * NFFT, steps 3, 4 and 5 the same for the interlaced NFFT, which are averaged in step 5. */
+static int trafo_step(
+    PNX(plan) ths, int step
+    )
+{
+  const int interlaced = (step >= 3);
+  const int last = interlaced || !(ths->pnfft_flags & PNFFT_INTERLACED);
+
+  if(use_batched_interlacing(ths, 1)){
+    /* compute non-interlaced and interlaced NFFT at once */
+    trafo_interlaced_batched(ths);
+    return 1;
+  }
+
+  if((ths->pnfft_flags & PNFFT_GRAD_IK) && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F) ){
+    if(step)
+      save_trafo_results(ths);
+    trafo_grad_ik(ths, step);
+    if(step)
+      average_trafo_results(ths);
+    return step || !(ths->pnfft_flags & PNFFT_INTERLACED);
+  }
 
-    /* multiplication with matrix B */
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_MATRIX_B]);
-    PNX(trafo_B_grad_ad)(ths, interlaced);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_MATRIX_B]);
+  switch(step % 3){
+    case 0:
+      if(interlaced)
+        save_trafo_results(ths);
+
+      /* multiplication with matrix D */
+      PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+      PNX(trafo_D)(ths, interlaced);
+      PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+      return 0;
+    case 1:
+      /* multiplication with matrix F */
+      PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+      PNX(trafo_F)(ths);
+      PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+
+      /* post the ghost cells, the progress calls test them until B */
+      if(ths->exec_split){
+        PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+        PNX(trafo_B_post)(ths, interlaced);
+        PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+      }
+      return 0;
+    default:
+      /* multiplication with matrix B of the backend, see PNX(set_backend) */
+      PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+      PNX(trafo_B_backend)(ths, interlaced);
+      PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+
+      if(interlaced)
+        average_trafo_results(ths);
+      return last;
   }
 }
 
+/* keep f, grad_f and the Hessian of the non-interlaced NFFT until the interlaced one is finished */
+static void save_trafo_results(
+    PNX(plan) ths
+    )
+{
+  INT size_f, size_grad_f, size_hessian_f;
+
+  trafo_result_sizes(ths, &size_f, &size_grad_f, &size_hessian_f);
+  ths->exec_buffer = get_interlaced_buffer(ths, size_f + size_grad_f + size_hessian_f);
+
+  for(INT j=0; j<size_f; j++)
+    ths->exec_buffer[j] = ths->f[j];
+  for(INT j=0; j<size_grad_f; j++)
+    ths->exec_buffer[size_f+j] = ths->grad_f[j];
+  for(INT j=0; j<size_hessian_f; j++)
+    ths->exec_buffer[size_f+size_grad_f+j] = ths->hessian_f[j];
+}
+
+static void average_trafo_results(
+    PNX(plan) ths
+    )
+{
+  INT size_f, size_grad_f, size_hessian_f;
+  R *buffer_f = ths->exec_buffer, *buffer_grad_f, *buffer_hessian_f;
+
+  trafo_result_sizes(ths, &size_f, &size_grad_f, &size_hessian_f);
+  buffer_grad_f = buffer_f + size_f;
+  buffer_hessian_f = buffer_grad_f + size_grad_f;
+
+  for(INT j=0; j<size_f; j++)
+    ths->f[j] = 0.5 * (ths->f[j] + buffer_f[j]);
+  for(INT j=0; j<size_grad_f; j++)
+    ths->grad_f[j] = 0.5 * (ths->grad_f[j] + buffer_grad_f[j]);
+  for(INT j=0; j<size_hessian_f; j++)
+    ths->hessian_f[j] = 0.5 * (ths->hessian_f[j] + buffer_hessian_f[j]);
+
+  release_interlaced_buffer(ths, buffer_f);
+  ths->exec_buffer = NULL;
+}
+
+static void trafo_result_sizes(
+    const PNX(plan) ths,
+    INT *size_f, INT *size_grad_f, INT *size_hessian_f
+    )
+{
+  const INT cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+
+  *size_f = *size_grad_f = *size_hessian_f = 0;
+  if(ths->compute_flags & PNFFT_COMPUTE_F)
+    *size_f = cplx * ths->howmany * ths->local_M;
+  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
+    *size_grad_f = cplx * ths->d * ths->local_M;
+  if(ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F)
+    *size_hessian_f = cplx * 6 * ths->local_M;
+}
+
 /* parallel 3dNFFT with different window functions */
 void PNX(trafo)(
     PNX(plan) ths
     )
 {
-  if(ths==NULL){
-    PX(fprintf)(MPI_COMM_WORLD, stderr, "!!! Error: Can not execute PNFFT Plan == NULL !!!\n");
+  if(!exec_start(ths, PNFFTI_EXEC_TRAFO))
     return;
+
+  while(!exec_next(ths));
+}
+
+/* D, F and B of the non-interlaced and the interlaced NFFT with one FFT of two fields */
+static void trafo_interlaced_batched(
+    PNX(plan) ths
+    )
+{
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+  PNX(trafo_D_interlaced_batched)(ths);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+  PX(execute)(ths->pfft_forw_il);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+  PNX(trafo_B_grad_ad)(ths, PNFFTI_INTERLACED_BATCHED);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+}
+
+static void adj_interlaced_batched(
+    PNX(plan) ths
+    )
+{
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+  PNX(adjoint_B)(ths, PNFFTI_INTERLACED_BATCHED);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_F);
+  PX(execute)(ths->pfft_back_il);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_F);
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+  PNX(adjoint_D_interlaced_batched)(ths);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+}
+
+/* Batched interlacing only supports f, the gradient falls back to two passes. */
+static int use_batched_interlacing(
+    const PNX(plan) ths, int trafo_flag
+    )
+{
+  if( !(ths->pnfft_flags & PNFFT_BATCH_INTERLACED) )
+    return 0;
+  if(trafo_flag)
+    return (ths->compute_flags & PNFFT_COMPUTE_F) && !(ths->compute_flags & (PNFFT_COMPUTE_GRAD_F | PNFFT_COMPUTE_HESSIAN_F));
+  return 1;
+}
+
+/* The buffer for the non-interlaced results is kept in the plan and only grows,
+ * e.g., if the number of nodes was changed by PNX(redistribute_nodes).
+ * Plans of an arena take it from the pool for a single call. */
+static R* get_interlaced_buffer(
+    PNX(plan) ths, INT size
+    )
+{
+  if(ths->arena != NULL)
+    return (R*) PNX(scratch_malloc)(ths, sizeof(R) * (size_t) size);
+
+  if(size > ths->buffer_il_size){
+    if(ths->buffer_il != NULL)
+      PNX(free)(ths->buffer_il);
+    ths->buffer_il = PNX(alloc_real)(size);
+    ths->buffer_il_size = size;
   }
+  return ths->buffer_il;
+}
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_WHOLE]);
+static void release_interlaced_buffer(
+    PNX(plan) ths, R *buffer
+    )
+{
+  if(ths->arena != NULL)
+    PNX(scratch_free)(ths, buffer);
+}
 
-  /* compute non-interlaced NFFT */
-  trafo(ths, 0);
+/* Step 'step' of the adjoint NFFT, returns 1 after the last step.
+ * Steps 0, 1 and 2 are B (the ghost cells), F (the PFFT transposes) and D of the non-interlaced
+ * adjoint, steps 3, 4 and 5 the same for the interlaced adjoint, which are averaged in step 5. */
+static int adj_step(
+    PNX(plan) ths, int step
+    )
+{
+  const int interlaced = (step >= 3);
+  const int last = interlaced || !(ths->pnfft_flags & PNFFT_INTERLACED);
 
-  /* compute interlaced NFFT and average the results */
-  if(ths->pnfft_flags & PNFFT_INTERLACED){
-    R *buffer_f_r=NULL, *buffer_grad_f_r=NULL;
-    C *buffer_f_c=NULL, *buffer_grad_f_c=NULL;
-    R *f_r = ths->f,     *grad_f_r = ths->grad_f;
-    C *f_c = (C*)ths->f, *grad_f_c = (C*)ths->grad_f;
+  if(use_batched_interlacing(ths, 0)){
+    /* compute non-interlaced and interlaced NFFT at once */
+    adj_interlaced_batched(ths);
+    return 1;
+  }
 
-    if(ths->trafo_flag & PNFFTI_TRAFO_C2R){
-      if(ths->compute_flags & PNFFT_COMPUTE_F){
-        buffer_f_r = ths->local_M ? PNX(malloc_R)(ths->local_M) : NULL;
-        for(INT j=0; j<ths->local_M; j++)
-          buffer_f_r[j] = f_r[j];
-      }
-      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-        buffer_grad_f_r = ths->local_M ? PNX(malloc_R)(ths->d*ths->local_M) : NULL;
-        for(INT j=0; j<ths->d*ths->local_M; j++)
-          buffer_grad_f_r[j] = grad_f_r[j];
-      }
-    } else {
-      if(ths->compute_flags & PNFFT_COMPUTE_F){
-        buffer_f_c = ths->local_M ? PNX(malloc_C)(ths->local_M) : NULL;
-        for(INT j=0; j<ths->local_M; j++)
-          buffer_f_c[j] = f_c[j];
-      }
-      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-        buffer_grad_f_c = ths->local_M ? PNX(malloc_C)(ths->d*ths->local_M) : NULL;
-        for(INT j=0; j<ths->d*ths->local_M; j++)
-          buffer_grad_f_c[j] = grad_f_c[j];
-      }
-    }
+  switch(step % 3){
+    case 0:
+      if(interlaced)
+        save_adj_results(ths);
+
+      /* multiplication with matrix B^T of the backend */
+      PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+      PNX(adjoint_B_backend)(ths, interlaced);
+      PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+      return 0;
+    case 1:
+      /* ghost cells posted by B^T */
+      PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+      PNX(gcells_wait)(ths);
+      PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+
+      /* multiplication with matrix F^H */
+      PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_F);
+      PNX(adjoint_F)(ths);
+      PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_F);
+      return 0;
+    default:
+      /* multiplication with matrix D */
+      PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+      PNX(adjoint_D)(ths, interlaced);
+      PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+
+      if(interlaced)
+        average_adj_results(ths);
+      return last;
+  }
+}
 
-    trafo(ths, 1);
+/* keep f_hat of the non-interlaced adjoint until the interlaced one is finished */
+static void save_adj_results(
+    PNX(plan) ths
+    )
+{
+  C *buffer_f_hat;
 
-    if(ths->compute_flags & PNFFT_COMPUTE_F) {
-      if(ths->trafo_flag & PNFFTI_TRAFO_C2R){
-        for(INT j=0; j<ths->local_M; j++)
-          f_r[j] = 0.5 * (f_r[j] + buffer_f_r[j]);
-      } else {
-        for(INT j=0; j<ths->local_M; j++)
-          f_c[j] = 0.5 * (f_c[j] + buffer_f_c[j]);
-      }
-    }
-    if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F) {
-      if(ths->trafo_flag & PNFFTI_TRAFO_C2R){
-        for(INT j=0; j<ths->d*ths->local_M; j++)
-          grad_f_r[j] = 0.5 * (grad_f_r[j] + buffer_grad_f_r[j]);
-      } else {
-        for(INT j=0; j<ths->d*ths->local_M; j++)
-          grad_f_c[j] = 0.5 * (grad_f_c[j] + buffer_grad_f_c[j]);
-      }
-    }
+  ths->exec_buffer = get_interlaced_buffer(ths, 2*ths->howmany*ths->local_N_total);
+  buffer_f_hat = (C*) ths->exec_buffer;
+
+  for(INT m=0; m<ths->howmany*ths->local_N_total; m++)
+    buffer_f_hat[m] = ths->f_hat[m];
+}
+
+static void average_adj_results(
+    PNX(plan) ths
+    )
+{
+  C *buffer_f_hat = (C*) ths->exec_buffer;
+
+  for(INT m=0; m<ths->howmany*ths->local_N_total; m++)
+    ths->f_hat[m] = 0.5 * (ths->f_hat[m] + buffer_f_hat[m]);
+
+  release_interlaced_buffer(ths, ths->exec_buffer);
+  ths->exec_buffer = NULL;
+}
+
+void PNX(adj)(
+    PNX(plan) ths
+    )
+{
+  if(!exec_start(ths, PNFFTI_EXEC_ADJ))
+    return;
 
-    if(buffer_f_r != NULL) PNX(free)(buffer_f_r);
-    if(buffer_f_c != NULL) PNX(free)(buffer_f_c);
-    if(buffer_grad_f_r != NULL) PNX(free)(buffer_grad_f_r);
-    if(buffer_grad_f_c != NULL) PNX(free)(buffer_grad_f_c);
+  while(!exec_next(ths));
+}
+
+/* Split-phase execution: PNX(trafo_start) and PNX(adj_start) run the first step and return.
+ * With PNFFT_PROGRESS_CALLS (default) the ghost cells of the persistent engine of
+ * PNX(set_ghost_engine) are posted as non-blocking messages, which every call of PNX(progress)
+ * tests. Until they have arrived, PNX(progress) returns 0 at once, afterwards it runs the next
+ * step, i.e., D, the PFFT transposes or the loop over the nodes, and returns 1 after the last one.
+ * The PFFT transposes, the ghost cells of PFFT, the particle halo and the ghost cells sent during
+ * the OpenMP loops block within their step, i.e., only the persistent engine overlaps between
+ * the calls. PNX(trafo_wait) and PNX(adj_wait) run all remaining steps. These calls are collective
+ * on the plan's comm, every process has to call PNX(progress) until it returns 1 or call the wait,
+ * but the number of calls may differ between the processes.
+ * With PNFFT_PROGRESS_THREAD a thread runs all steps, while the caller computes, and
+ * PNX(progress) only checks, if the thread has finished.
+ * The arrays of the plan must not be touched until the wait returns. */
+void PNX(trafo_start)(
+    PNX(plan) ths
+    )
+{
+  if(!exec_start(ths, PNFFTI_EXEC_TRAFO))
+    return;
+
+  if(!start_exec_thread(ths)){
+    ths->exec_split = 1;
+    exec_next(ths);
+  }
+}
+
+void PNX(adj_start)(
+    PNX(plan) ths
+    )
+{
+  if(!exec_start(ths, PNFFTI_EXEC_ADJ))
+    return;
+
+  if(!start_exec_thread(ths)){
+    ths->exec_split = 1;
+    exec_next(ths);
+  }
+}
+
+int PNX(progress)(
+    PNX(plan) ths
+    )
+{
+  if(ths->exec_thread != NULL){
+    if(!exec_thread_done(ths))
+      return 0;
+    join_exec_thread(ths);
+    return 1;
   }
- 
+
+  if(ths->exec_kind != PNFFTI_EXEC_TRAFO && ths->exec_kind != PNFFTI_EXEC_ADJ)
+    return 1;
+
+  return exec_next(ths);
+}
+
+void PNX(trafo_wait)(
+    PNX(plan) ths
+    )
+{
+  exec_wait(ths);
+}
+
+void PNX(adj_wait)(
+    PNX(plan) ths
+    )
+{
+  exec_wait(ths);
+}
+
+/* Chunked execution for node sets that do not fit into memory at once. PNX(trafo_chunked_start)
+ * runs D, F and the ghost cell exchange, afterwards every call of PNX(trafo_chunk) gathers f at
+ * the nodes currently stored in the plan. PNX(adj_chunked_start) clears the grid, every call of
+ * PNX(adj_chunk) spreads the current nodes onto it and PNX(adj_chunked_finish) reduces the ghost
+ * cells and runs F and D. Between the chunks the caller replaces the nodes with PNX(set_local_M),
+ * PNX(set_x) and PNX(set_f) and calls PNX(precompute_psi), such that all node based buffers only
+ * hold one chunk. The 'start' and 'finish' calls are collective, the chunk calls and
+ * PNX(precompute_psi) in between are local and every process may use a different number of
+ * chunks. Therefore, the chunks use neither the particle halo of PNX(set_halo) nor PNFFT_SPARSE_B,
+ * the 'start' calls free the halo of the previous nodes. PNFFT_INTERLACED and gradients of
+ * PNFFT_GRAD_IK are not supported. */
+void PNX(trafo_chunked_start)(
+    PNX(plan) ths
+    )
+{
+  if(!chunked_start(ths, PNFFTI_EXEC_TRAFO_CHUNKED))
+    return;
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+  PNX(trafo_D)(ths, 0);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+  PNX(trafo_F)(ths);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_F);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+  PNX(trafo_B_chunked)(ths, PNFFTI_CHUNK_START);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+}
+
+void PNX(trafo_chunk)(
+    PNX(plan) ths
+    )
+{
+  if(!chunked_running(ths, PNFFTI_EXEC_TRAFO_CHUNKED))
+    return;
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+  PNX(trafo_B_chunked)(ths, PNFFTI_CHUNK_NODES);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+}
+
+void PNX(trafo_chunked_finish)(
+    PNX(plan) ths
+    )
+{
+  if(!chunked_running(ths, PNFFTI_EXEC_TRAFO_CHUNKED))
+    return;
+
   ths->timer_trafo[PNFFT_TIMER_ITER]++;
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_WHOLE]);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
+  ths->exec_kind = PNFFTI_EXEC_NONE;
 }
 
-static void adj(
-    PNX(plan) ths, int interlaced
+void PNX(adj_chunked_start)(
+    PNX(plan) ths
     )
 {
-  /* multiplication with matrix B^T */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_MATRIX_B]);
-  PNX(adjoint_B)(ths, interlaced);
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_MATRIX_B]);
+  if(!chunked_start(ths, PNFFTI_EXEC_ADJ_CHUNKED))
+    return;
 
-  /* multiplication with matrix F^H */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_MATRIX_F]);
-  PNX(adjoint_F)(ths);
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_MATRIX_F]);
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+  PNX(adjoint_B_chunked)(ths, PNFFTI_CHUNK_START);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+}
 
-  /* multiplication with matrix D */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_MATRIX_D]);
-  PNX(adjoint_D)(ths, interlaced);
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_MATRIX_D]);
+void PNX(adj_chunk)(
+    PNX(plan) ths
+    )
+{
+  if(!chunked_running(ths, PNFFTI_EXEC_ADJ_CHUNKED))
+    return;
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+  PNX(adjoint_B_chunked)(ths, PNFFTI_CHUNK_NODES);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
 }
 
-void PNX(adj)(
+void PNX(adj_chunked_finish)(
     PNX(plan) ths
     )
+{
+  if(!chunked_running(ths, PNFFTI_EXEC_ADJ_CHUNKED))
+    return;
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+  PNX(adjoint_B_chunked)(ths, PNFFTI_CHUNK_FINISH);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_F);
+  PNX(adjoint_F)(ths);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_F);
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+  PNX(adjoint_D)(ths, 0);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+
+  ths->timer_adj[PNFFT_TIMER_ITER]++;
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
+  ths->exec_kind = PNFFTI_EXEC_NONE;
+}
+
+static int chunked_start(
+    PNX(plan) ths, int kind
+    )
+{
+  const int trafo = (kind == PNFFTI_EXEC_TRAFO_CHUNKED);
+
+  if(ths != NULL && (ths->pnfft_flags & PNFFT_INTERLACED)){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error in PNFFT: Chunked execution does not support PNFFT_INTERLACED !!!\n");
+    return 0;
+  }
+
+  if(ths != NULL && trafo && (ths->pnfft_flags & PNFFT_GRAD_IK) && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F)){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error in PNFFT: Chunked execution does not support gradients of PNFFT_GRAD_IK !!!\n");
+    return 0;
+  }
+
+  if(!exec_start(ths, trafo ? PNFFTI_EXEC_TRAFO : PNFFTI_EXEC_ADJ))
+    return 0;
+
+  /* halo and matrix B belong to the nodes before the chunks, see PNX(precompute_psi) */
+  PNX(free_halo)(ths);
+  PNX(free_sparse_b)(ths);
+
+  ths->exec_kind = kind;
+  return 1;
+}
+
+static int chunked_running(
+    const PNX(plan) ths, int kind
+    )
+{
+  if(ths == NULL || ths->exec_kind != kind){
+    PX(fprintf)((ths == NULL) ? MPI_COMM_WORLD : ths->comm_cart, stderr,
+        "!!! Error in PNFFT: Chunked %s was not started !!!\n",
+        (kind == PNFFTI_EXEC_TRAFO_CHUNKED) ? "trafo" : "adjoint");
+    return 0;
+  }
+  return 1;
+}
+
+/* PNFFT_PROGRESS_THREAD needs POSIX threads and MPI_THREAD_MULTIPLE, such that the caller can
+ * communicate while the thread runs. Otherwise, the plan stays at PNFFT_PROGRESS_CALLS. */
+void PNX(set_progress)(
+    int mode, PNX(plan) ths
+    )
+{
+  if(mode == PNFFT_PROGRESS_THREAD){
+#ifdef HAVE_PTHREAD_H
+    int provided;
+
+    MPI_Query_thread(&provided);
+    if(provided < MPI_THREAD_MULTIPLE){
+      PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_PROGRESS_THREAD needs MPI_THREAD_MULTIPLE, switch to PNFFT_PROGRESS_CALLS !!!\n");
+      mode = PNFFT_PROGRESS_CALLS;
+    }
+#else
+    PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_PROGRESS_THREAD needs POSIX threads, switch to PNFFT_PROGRESS_CALLS !!!\n");
+    mode = PNFFT_PROGRESS_CALLS;
+#endif
+  } else
+    mode = PNFFT_PROGRESS_CALLS;
+
+  ths->progress_mode = mode;
+}
+
+static int exec_start(
+    PNX(plan) ths, int kind
+    )
 {
   if(ths==NULL){
     PX(fprintf)(MPI_COMM_WORLD, stderr, "!!! Error: Can not execute PNFFT Plan == NULL !!!\n");
+    return 0;
+  }
+
+  if(ths->direction == ((kind == PNFFTI_EXEC_TRAFO) ? PNFFT_ADJ_ONLY : PNFFT_TRAFO_ONLY)){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error in PNFFT: Can not execute the %s of a plan without this direction !!!\n",
+        (kind == PNFFTI_EXEC_TRAFO) ? "trafo" : "adjoint");
+    return 0;
+  }
+
+  if(ths->exec_thread != NULL || ths->exec_kind != PNFFTI_EXEC_NONE){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error in PNFFT: Can not execute PNFFT Plan before the running execution was waited for !!!\n");
+    return 0;
+  }
+
+  if(kind == PNFFTI_EXEC_TRAFO){
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
+  } else {
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
+  }
+
+  ths->exec_kind = kind;
+  ths->exec_step = 0;
+  ths->exec_split = 0;
+  return 1;
+}
+
+/* run the next step of the running execution, returns 1 if it is finished */
+static int exec_next(
+    PNX(plan) ths
+    )
+{
+  int done;
+
+  /* the next step starts after the posted ghost cells have arrived */
+  if(ths->exec_split && !PNX(gcells_test)(ths))
+    return 0;
+
+  if(ths->exec_kind == PNFFTI_EXEC_TRAFO){
+    done = trafo_step(ths, ths->exec_step++);
+    if(done){
+      ths->timer_trafo[PNFFT_TIMER_ITER]++;
+      PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
+    }
+  } else {
+    done = adj_step(ths, ths->exec_step++);
+    if(done){
+      ths->timer_adj[PNFFT_TIMER_ITER]++;
+      PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
+    }
+  }
+
+  if(done)
+    ths->exec_kind = PNFFTI_EXEC_NONE;
+  return done;
+}
+
+static void exec_wait(
+    PNX(plan) ths
+    )
+{
+  if(ths->exec_thread != NULL){
+    join_exec_thread(ths);
     return;
   }
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_WHOLE]);
+  /* the remaining steps wait for their ghost cells */
+  ths->exec_split = 0;
+  while(ths->exec_kind == PNFFTI_EXEC_TRAFO || ths->exec_kind == PNFFTI_EXEC_ADJ)
+    exec_next(ths);
+}
+
+#ifdef HAVE_PTHREAD_H
+struct exec_thread_s{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  int done;
+  PNX(plan) ths;
+};
+
+static void* run_exec_thread(
+    void *arg
+    )
+{
+  struct exec_thread_s *t = (struct exec_thread_s*) arg;
+
+  while(!exec_next(t->ths));
 
-  /* compute non-interlaced NFFT */
-  adj(ths, 0);
+  pthread_mutex_lock(&t->lock);
+  t->done = 1;
+  pthread_mutex_unlock(&t->lock);
+  return NULL;
+}
+#endif
 
-  /* compute interlaced NFFT and average the results */
-  if(ths->pnfft_flags & PNFFT_INTERLACED){
-    C* buffer_f_hat = ths->local_N_total ? PNX(malloc_C)(ths->local_N_total) : NULL;
+/* returns 0, if the steps have to be run by the caller */
+static int start_exec_thread(
+    PNX(plan) ths
+    )
+{
+#ifdef HAVE_PTHREAD_H
+  struct exec_thread_s *t;
 
-    for(INT m=0; m<ths->local_N_total; m++)
-      buffer_f_hat[m] = ths->f_hat[m];
+  if(ths->progress_mode != PNFFT_PROGRESS_THREAD)
+    return 0;
 
-    adj(ths, 1);
+  t = (struct exec_thread_s*) malloc(sizeof(struct exec_thread_s));
+  t->done = 0;
+  t->ths = ths;
+  pthread_mutex_init(&t->lock, NULL);
 
-    for(INT m=0; m<ths->local_N_total; m++)
-      ths->f_hat[m] = 0.5 * (ths->f_hat[m] + buffer_f_hat[m]);
-    if(buffer_f_hat != NULL) PNX(free)(buffer_f_hat);
+  if(pthread_create(&t->thread, NULL, run_exec_thread, t) != 0){
+    pthread_mutex_destroy(&t->lock);
+    free(t);
+    return 0;
   }
 
-  ths->timer_adj[PNFFT_TIMER_ITER]++;
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_WHOLE]);
+  ths->exec_thread = t;
+  return 1;
+#else
+  return 0;
+#endif
 }
 
+static int exec_thread_done(
+    const PNX(plan) ths
+    )
+{
+#ifdef HAVE_PTHREAD_H
+  struct exec_thread_s *t = (struct exec_thread_s*) ths->exec_thread;
+  int done;
+
+  pthread_mutex_lock(&t->lock);
+  done = t->done;
+  pthread_mutex_unlock(&t->lock);
+  return done;
+#else
+  return 1;
+#endif
+}
+
+static void join_exec_thread(
+    PNX(plan) ths
+    )
+{
+#ifdef HAVE_PTHREAD_H
+  struct exec_thread_s *t = (struct exec_thread_s*) ths->exec_thread;
+
+  pthread_join(t->thread, NULL);
+  pthread_mutex_destroy(&t->lock);
+  free(t);
+#endif
+  ths->exec_thread = NULL;
+}
+
+
+/* Round trip f -> adj -> Fourier-space operator -> trafo -> f, as needed by particle-mesh methods.
+ * Without precomputed window values, adj keeps the values of the nodes that fit into the budget
+ * of PNX(set_shared_psi) and trafo reuses them, also for grad_f and the copies of the particle halo.
+ * If kernel != NULL, f_hat is multiplied point wise with kernel[local_N_total].
+ * Afterwards, op (if != NULL) is applied in place on f_hat. */
+void PNX(adj_op_trafo)(
+    PNX(plan) ths, const R *kernel, PNX(fourier_op) op, void *op_data
+    )
+{
+  int shared_psi;
+
+  if(ths==NULL){
+    PX(fprintf)(MPI_COMM_WORLD, stderr, "!!! Error: Can not execute PNFFT Plan == NULL !!!\n");
+    return;
+  }
+
+  shared_psi = PNX(init_shared_psi)(ths);
+
+  PNX(adj)(ths);
+
+  if(kernel != NULL)
+    for(INT k=0; k<ths->local_N_total; k++)
+      for(INT h=0; h<ths->howmany; h++)
+        ths->f_hat[ths->howmany*k+h] *= kernel[k];
+  if(op != NULL)
+    op(ths->f_hat, ths->local_N, ths->local_N_start, ths->howmany, op_data);
+
+  PNX(trafo)(ths);
+
+  if(shared_psi)
+    PNX(free_shared_psi)(ths);
+}
 
 void PNX(finalize)(
     PNX(plan) ths, unsigned pnfft_finalize_flags
     )
 {
+  /* finish a split-phase execution */
+  exec_wait(ths);
+
+  /* node sets stay allocated until PNX(rmnodes) */
+  PNX(attach_nodes)(NULL, ths);
+  PNX(free_halo)(ths);
+
   if((pnfft_finalize_flags & PNFFT_FREE_F_HAT) && (ths->f_hat != NULL))
     PNX(free)(ths->f_hat);
   if((pnfft_finalize_flags & PNFFT_FREE_GRAD_F) && (ths->grad_f != NULL))
     PNX(free)(ths->grad_f);
+  if((pnfft_finalize_flags & PNFFT_FREE_HESSIAN_F) && (ths->hessian_f != NULL))
+    PNX(free)(ths->hessian_f);
   if((pnfft_finalize_flags & PNFFT_FREE_F) && (ths->f != NULL))
     PNX(free)(ths->f);
   if((pnfft_finalize_flags & PNFFT_FREE_X) && (ths->x != NULL))
     PNX(free)(ths->x);
 
-  PX(destroy_plan)(ths->pfft_forw);
-  PX(destroy_plan)(ths->pfft_back);
+  if(ths->pfft_forw != NULL)
+    PX(destroy_plan)(ths->pfft_forw);
+  if(ths->pfft_back != NULL)
+    PX(destroy_plan)(ths->pfft_back);
   PX(destroy_gcplan)(ths->gcplan);
-
-  if(ths->g2 != ths->g1){
-    if(ths->g2 != NULL)
-      PNX(free)(ths->g2);
-  }
-  if(ths->g1 != NULL)
-    PNX(free)(ths->g1);
-  if(ths->g1_buffer != NULL)
-    PNX(free)(ths->g1_buffer);
+  PNX(free_ghost_engine)(ths);
+  PNX(free_pipe)(ths);
+  if(ths->pfft_forw_ik != NULL)
+    PX(destroy_plan)(ths->pfft_forw_ik);
+  if(ths->gcplan_ik != NULL)
+    PX(destroy_gcplan)(ths->gcplan_ik);
+  if(ths->pfft_forw_il != NULL)
+    PX(destroy_plan)(ths->pfft_forw_il);
+  if(ths->pfft_back_il != NULL)
+    PX(destroy_plan)(ths->pfft_back_il);
+  if(ths->gcplan_il != NULL)
+    PX(destroy_gcplan)(ths->gcplan_il);
+  if(ths->buffer_il != NULL)
+    PNX(free)(ths->buffer_il);
+
+  /* grids of an arena stay allocated for the other plans */
+  if(ths->g2 != ths->g1)
+    PNX(free_grid)(ths, PNFFTI_GRID_G2, ths->g2);
+  PNX(free_grid)(ths, (ths->g2 != ths->g1) ? PNFFTI_GRID_G1 : PNFFTI_GRID_G2, ths->g1);
+  PNX(free_grid)(ths, PNFFTI_GRID_G1_BUFFER, ths->g1_buffer);
+  PNX(free_grid)(ths, PNFFTI_GRID_G2_SINGLE, ths->g2_single);
+  PNX(arena_detach)(ths);
 
   if(ths->intpol_tables_psi != NULL){
-    for(int t=0;t<ths->d; t++)
+    for(int t=0;t<3; t++)
       if(ths->intpol_tables_psi[t] != NULL)
         PNX(free)(ths->intpol_tables_psi[t]);
     PNX(free)(ths->intpol_tables_psi);
   }
 
   if(ths->intpol_tables_dpsi != NULL){
-    for(int t=0;t<ths->d; t++)
+    for(int t=0;t<3; t++)
       if(ths->intpol_tables_dpsi[t] != NULL)
         PNX(free)(ths->intpol_tables_dpsi[t]);
     PNX(free)(ths->intpol_tables_dpsi);
@@ -409,18 +1086,28 @@ void PNX(finalize)(
     PNX(free)(ths->b);
   if(ths->exp_const != NULL)
     PNX(free)(ths->exp_const);
+  if(ths->phi_hat_es != NULL)
+    PNX(free)(ths->phi_hat_es);
   if(ths->spline_coeffs != NULL)
     PNX(free)(ths->spline_coeffs);
   if(ths->pre_inv_phi_hat_trafo != NULL)
     PNX(free)(ths->pre_inv_phi_hat_trafo);
   if(ths->pre_inv_phi_hat_adj != NULL)
     PNX(free)(ths->pre_inv_phi_hat_adj);
+  if(ths->pre_inv_phi_hat_trafo_il != NULL)
+    PNX(free)(ths->pre_inv_phi_hat_trafo_il);
+  if(ths->pre_inv_phi_hat_adj_il != NULL)
+    PNX(free)(ths->pre_inv_phi_hat_adj_il);
 
   if(ths->pre_psi != NULL)     PNX(free)(ths->pre_psi);
   if(ths->pre_dpsi != NULL)    PNX(free)(ths->pre_dpsi);
   if(ths->pre_psi_il != NULL)  PNX(free)(ths->pre_psi_il);
   if(ths->pre_dpsi_il != NULL) PNX(free)(ths->pre_dpsi_il);
 
+  PNX(free_sorted_index)(ths);
+  PNX(free_sparse_b)(ths);
+  PNX(free_redistribution)(ths);
+
   /* free mem of struct */
   PNX(rmplan)(ths);
 }
@@ -467,6 +1154,20 @@ C* PNX(get_grad_f)(
   return (C*)ths->grad_f;
 }
 
+void PNX(set_hessian_f)(
+    C* hessian_f, PNX(plan) ths
+    )
+{
+  ths->hessian_f = (R*)hessian_f;
+}
+
+C* PNX(get_hessian_f)(
+    const PNX(plan) ths
+    )
+{
+  return (C*)ths->hessian_f;
+}
+
 void PNX(set_f_hat_real)(
     R *f_hat, PNX(plan) ths
     )
@@ -509,12 +1210,27 @@ R* PNX(get_grad_f_real)(
   return ths->grad_f;
 }
 
+void PNX(set_hessian_f_real)(
+    R* hessian_f, PNX(plan) ths
+    )
+{
+  ths->hessian_f = hessian_f;
+}
+
+R* PNX(get_hessian_f_real)(
+    const PNX(plan) ths
+    )
+{
+  return ths->hessian_f;
+}
+
 
 void PNX(set_x)(
     R *x, PNX(plan) ths
     )
 {
   ths->x = x;
+  PNX(invalidate_sorted_index)(ths);
 }
 
 R* PNX(get_x)(
@@ -524,6 +1240,17 @@ R* PNX(get_x)(
   return ths->x;
 }
 
+/* Original index of every node after PNX(sort_nodes), i.e.,
+ * x[d*j+t] and f[j] belong to the node with user index node_order[j].
+ * Returns NULL if the nodes are stored in the original order, e.g., after PNX(set_x)
+ * or PNX(set_local_M) handed new nodes to the plan. */
+const INT* PNX(get_node_order)(
+    const PNX(plan) ths
+    )
+{
+  return ths->node_order;
+}
+
 
 /* getters for PNFFT internal parameters
  * No setters are implemented for these parameters.
@@ -539,6 +1266,217 @@ void PNX(set_b)(
   PNX(init_precompute_window)(ths);
 }
 
+/* Memory budget in bytes per process of the window values that PNX(adj_op_trafo) shares between
+ * adj and trafo. The nodes of the sorted order that do not fit evaluate the window in both,
+ * bytes = 0 never shares and negative bytes (default) allow as much as the oversampled grid. */
+void PNX(set_shared_psi)(
+    INT bytes, PNX(plan) ths
+    )
+{
+  ths->shared_psi_bytes = bytes;
+}
+
+/* Memory budget in bytes of the window tensors of PNFFT_PRE_FULL_PSI per thread.
+ * For bytes > 0 the tensors are computed block by block of sorted nodes right before
+ * matrix B instead of once for all nodes. Call PNX(precompute_psi) afterwards. */
+void PNX(set_pre_psi_block)(
+    INT bytes, PNX(plan) ths
+    )
+{
+  ths->pre_psi_block_bytes = (bytes > 0) ? bytes : 0;
+
+  /* release the tables of all nodes, PNX(precompute_psi) allocates them again if needed */
+  if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI){
+    if(ths->pre_psi != NULL)     PNX(free)(ths->pre_psi);
+    if(ths->pre_dpsi != NULL)    PNX(free)(ths->pre_dpsi);
+    if(ths->pre_psi_il != NULL)  PNX(free)(ths->pre_psi_il);
+    if(ths->pre_dpsi_il != NULL) PNX(free)(ths->pre_dpsi_il);
+    ths->pre_psi = ths->pre_dpsi = NULL;
+    ths->pre_psi_il = ths->pre_dpsi_il = NULL;
+  }
+}
+
+/* Width of the tiles in grid points for the subproblem spreading of the adjoint,
+ * e.g., 16. Values below the cutoff are raised to the cutoff, 0 switches it off. */
+void PNX(set_spread_tile)(
+    INT tile, PNX(plan) ths
+    )
+{
+  if(tile > 0 && ths->d < 3){
+    PX(printf)(ths->comm_cart, "!!! Warning: Tiled spreading is not supported by plans with d < 3. !!!\n");
+    tile = 0;
+  }
+
+  ths->spread_tile = (tile > 0) ? tile : 0;
+
+  /* tiled sort keys follow the tiles of the spreading, the nodes stay the same */
+  if(ths->sort_keys == PNFFT_SORT_KEYS_TILED)
+    ths->sorted_index_valid = 0;
+}
+
+/* Order of the nodes for PNFFT_SORT_NODES: PNFFT_SORT_KEYS_PLAIN sorts by the row major index
+ * of the lowest grid point in the support, PNFFT_SORT_KEYS_TILED by tile and then
+ * by the index within the tile (tiles of spread_tile or 16 grid points), PNFFT_SORT_KEYS_MORTON
+ * by the Morton (Z-order) index. The last two keep nodes of neighboring stencils close together. */
+void PNX(set_sort_keys)(
+    int keys, PNX(plan) ths
+    )
+{
+  if(keys != PNFFT_SORT_KEYS_TILED && keys != PNFFT_SORT_KEYS_MORTON)
+    keys = PNFFT_SORT_KEYS_PLAIN;
+  if(keys != ths->sort_keys){
+    ths->sort_keys = keys;
+    ths->sorted_index_valid = 0;
+  }
+}
+
+/* Store matrix B of fixed nodes as sparse matrix, such that repeated trafo and adj reduce
+ * to sparse matrix vector products with g2. PNX(precompute_psi) builds the matrix for the
+ * current nodes, PNFFT_SPARSE_B_SINGLE keeps the weights in single precision. Weights below
+ * threshold times the largest weight of the node are dropped, 0 keeps all of them.
+ * Supported for f of single field plans, everything else uses the usual loops. */
+void PNX(set_sparse_b)(
+    int mode, R threshold, PNX(plan) ths
+    )
+{
+  if(mode != PNFFT_SPARSE_B && mode != PNFFT_SPARSE_B_SINGLE)
+    mode = PNFFT_SPARSE_B_OFF;
+
+  if(mode != PNFFT_SPARSE_B_OFF)
+    if(ths->howmany > 1 || (ths->pnfft_flags & (PNFFT_BATCH_INTERLACED | PNFFT_MIXED_PRECISION)))
+      PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_SPARSE_B is not supported by this plan, the usual loops are used. !!!\n");
+
+  /* the rows of B cover the stencil of three axes */
+  if(mode != PNFFT_SPARSE_B_OFF && ths->d < 3){
+    PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_SPARSE_B is not supported by plans with d < 3, the usual loops are used. !!!\n");
+    mode = PNFFT_SPARSE_B_OFF;
+  }
+
+  ths->sparse_b_mode = mode;
+  ths->sparse_b_threshold = (threshold > 0) ? threshold : 0;
+  PNX(free_sparse_b)(ths);
+}
+
+/* Skip the weights of the stencil that are smaller than the truncation error of the window,
+ * i.e., the products of 1d weights below the level of the 1d window at the border of its support.
+ * This removes the corners of the cutoff^3 cube in trafo and adj without precomputed full psi. */
+void PNX(set_prune_stencil)(
+    int prune, PNX(plan) ths
+    )
+{
+  ths->prune_stencil = (prune != 0);
+  PNX(init_assign_kernels)(ths);
+}
+
+/* Store the window values of PNFFT_PRE_PSI as float, which halves the tables of double plans.
+ * The values are only weights of the grid points, matrix B converts them back for every node.
+ * Releases the tables of the current nodes, call PNX(precompute_psi) afterwards. Node sets
+ * that were precomputed before have to be precomputed again. */
+void PNX(set_pre_psi_single)(
+    int single, PNX(plan) ths
+    )
+{
+  single = (single != 0) && (sizeof(R) > sizeof(float));
+
+  if(single && ths->cutoff > PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF){
+    PX(printf)(ths->comm_cart, "!!! Warning: float tables of PNFFT_PRE_PSI need a cutoff of at most %d, the plan precision is kept !!!\n",
+        PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF);
+    single = 0;
+  }
+
+  if(single != ths->pre_psi_single && (ths->pnfft_flags & PNFFT_PRE_PSI))
+    PNX(free_pre_psi)(ths);
+  ths->pre_psi_single = single;
+}
+
+/* Ghost cells of g2 by PFFT (PNFFT_GHOSTS_PFFT, default) or by persistent requests that are set up
+ * once for the plan (PNFFT_GHOSTS_PERSISTENT). PNFFT_GHOSTS_SHARED additionally passes the ghost
+ * cells of processes on the same node through an MPI-3 shared memory window instead of messages.
+ * The last two need ghost cells that only reach the next neighbor. Collective.
+ * Or-ing them with PNFFT_GHOSTS_FLOAT_WIRE sends the ghost cells of double plans as float,
+ * which is accurate enough for a target accuracy above 1e-7. */
+void PNX(set_ghost_engine)(
+    int engine, PNX(plan) ths
+    )
+{
+  int float_wire = ((unsigned) engine & PNFFT_GHOSTS_FLOAT_WIRE) ? 1 : 0;
+
+  engine = (int) ((unsigned) engine & ~PNFFT_GHOSTS_FLOAT_WIRE);
+  if(engine != PNFFT_GHOSTS_PERSISTENT && engine != PNFFT_GHOSTS_SHARED)
+    engine = PNFFT_GHOSTS_PFFT;
+
+  if(engine != PNFFT_GHOSTS_PFFT && ths->d < 3){
+    PX(printf)(ths->comm_cart, "!!! Warning: Plans with d < 3 only support PNFFT_GHOSTS_PFFT !!!\n");
+    engine = PNFFT_GHOSTS_PFFT;
+  }
+
+  if(float_wire && engine == PNFFT_GHOSTS_PFFT){
+    PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_GHOSTS_FLOAT_WIRE needs PNFFT_GHOSTS_PERSISTENT or PNFFT_GHOSTS_SHARED, messages are sent in full precision !!!\n");
+    float_wire = 0;
+  }
+
+  ths->ghost_engine = engine;
+  ths->ghost_float_wire = float_wire;
+  PNX(init_ghost_engine)(ths);
+}
+
+/* Send the nodes near the block borders to the neighbors instead of the ghost cells of g2
+ * (PNFFT_HALO), which is cheaper for few nodes near the borders, e.g., dilute or clustered nodes.
+ * PNFFT_HALO_AUTO only uses the halo if it moves less data per call than the ghost cells.
+ * The halo is set up by PNX(precompute_psi), which becomes collective, and covers the gather
+ * and spread loops of plans without PNFFT_BATCH_INTERLACED, PNFFT_MIXED_PRECISION or
+ * PNFFT_SPARSE_B. It needs nodes whose support only reaches the next neighbor. */
+void PNX(set_halo)(
+    int mode, PNX(plan) ths
+    )
+{
+  if(mode != PNFFT_HALO && mode != PNFFT_HALO_AUTO)
+    mode = PNFFT_HALO_OFF;
+
+  if(mode != PNFFT_HALO_OFF && ths->d < 3){
+    PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_HALO is not supported by plans with d < 3, the ghost cells of g2 are used. !!!\n");
+    mode = PNFFT_HALO_OFF;
+  }
+
+  for(int t=0; t<ths->d; t++)
+    if(mode != PNFFT_HALO_OFF && ths->boundary[t] == PNFFT_BOUNDARY_OPEN){
+      PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_HALO is not supported by plans with open axes, the ghost cells of g2 are used. !!!\n");
+      mode = PNFFT_HALO_OFF;
+    }
+
+  ths->halo_mode = mode;
+  PNX(free_halo)(ths);
+}
+
+/* Boundary of every axis of the plan, PNFFT_BOUNDARY_PERIODIC (default) or PNFFT_BOUNDARY_OPEN.
+ * The window of a node near the border of an open axis is cut off at the border instead of
+ * wrapping around to the opposite side, i.e., the ghost cells are neither exchanged nor reduced
+ * across the border. The FFT stays periodic, so the caller still pads the open axes by choosing
+ * x_max and n, such that the nodes keep a distance of at least the window support to the
+ * periodic images. Plans with open axes do not use PNFFT_HALO. Collective. */
+void PNX(set_boundary)(
+    const int *boundary, PNX(plan) ths
+    )
+{
+  int open = 0;
+
+  for(int t=0; t<3; t++){
+    ths->boundary[t] = (t < ths->d && boundary[t] == PNFFT_BOUNDARY_OPEN)
+        ? PNFFT_BOUNDARY_OPEN : PNFFT_BOUNDARY_PERIODIC;
+    if(ths->boundary[t] == PNFFT_BOUNDARY_OPEN)
+      open = 1;
+  }
+
+  if(open && ths->halo_mode != PNFFT_HALO_OFF){
+    PX(printf)(ths->comm_cart, "!!! Warning: PNFFT_HALO is not supported by plans with open axes, the ghost cells of g2 are used. !!!\n");
+    ths->halo_mode = PNFFT_HALO_OFF;
+    PNX(free_halo)(ths);
+  }
+
+  /* the engines set up their neighbors once */
+  PNX(init_ghost_engine)(ths);
+}
+
 void PNX(get_b)(
     const PNX(plan) ths,
     R *b0, R *b1, R *b2
@@ -549,6 +1487,33 @@ void PNX(get_b)(
   *b2 = ths->b[2];
 }
 
+/* A priori estimate of the relative approximation error of the plan,
+ * i.e., the window error for the worst axis plus the error of the window interpolation. */
+R PNX(get_error_estimate)(
+    const PNX(plan) ths
+    )
+{
+  R err = 0.0;
+
+  for(int t=0; t<ths->d; t++){
+    R err_t = PNX(window_error_estimate)(ths->pnfft_flags, ths->m, ths->sigma[t]);
+    if(err_t > err)
+      err = err_t;
+  }
+
+  if(ths->pnfft_flags & PNFFT_PRE_INTPOL_PSI)
+    err += PNX(intpol_error_estimate)(ths->intpol_order, ths->intpol_num_nodes);
+
+  return err;
+}
+
+INT PNX(get_pre_psi_block)(
+    const PNX(plan) ths
+    )
+{
+  return ths->pre_psi_block_bytes;
+}
+
 int PNX(get_d)(
     const PNX(plan) ths
     )
@@ -563,6 +1528,13 @@ int PNX(get_m)(
   return ths->m;
 }
 
+INT PNX(get_howmany)(
+    const PNX(plan) ths
+    )
+{
+  return ths->howmany;
+}
+
 void PNX(get_x_max)(
     const PNX(plan) ths,
     R *x_max
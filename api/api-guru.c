@@ -26,11 +26,20 @@ static unsigned extract_pfft_opt_flags(
 static void fft_output_size(
     const INT *n, const R *x_max, int m,
     INT *no);
+static int embed_axes(
+    int d, const INT *N, const INT *n, const R *x_max, MPI_Comm comm_cart,
+    INT *N3, INT *n3, R *x_max3);
 static PNX(plan) PNX(init_guru_internal)(
-    int d, const INT *N, const INT *n, const R *x_max,
+    int d, const INT *N, const INT *n, const R *x_max, INT howmany,
     INT local_M, int m,
     unsigned trafo_flag, unsigned pnfft_flags, unsigned pfft_flags,
     MPI_Comm comm_cart);
+static unsigned planner_flags(
+    unsigned pnfft_flags, unsigned window_flag, int m, R eps);
+static int measure_candidates(
+    int d, const INT *N, const R *x_max, INT local_M,
+    int num, const INT *n_cand, const int *m_cand, const unsigned *window_cand,
+    R eps, unsigned pnfft_flags, MPI_Comm comm_cart);
 static void local_size_guru_internal(
     int d, const INT *N, const INT *n, const R *x_max, int m,
     MPI_Comm comm_cart,
@@ -69,7 +78,67 @@ PNX(plan) PNX(init_guru)(
     MPI_Comm comm_cart
     )
 {
-  return PNX(init_guru_internal)(d, N, n, x_max, local_M, m, PNFFTI_TRAFO_C2C, pnfft_flags, pfft_flags, comm_cart);
+  return PNX(init_guru_internal)(d, N, n, x_max, 1, local_M, m, PNFFTI_TRAFO_C2C, pnfft_flags, pfft_flags, comm_cart);
+}
+
+
+/* Plan 'howmany' fields with the same nodes. The fields are interleaved,
+ * i.e., f_hat[howmany*k+h] and f[howmany*j+h] belong to field h. */
+PNX(plan) PNX(init_guru_many)(
+    int d, const INT *N, const INT *n, const R *x_max, INT howmany,
+    INT local_M, int m,
+    unsigned pnfft_flags, unsigned pfft_flags,
+    MPI_Comm comm_cart
+    )
+{
+  return PNX(init_guru_internal)(d, N, n, x_max, howmany, local_M, m, PNFFTI_TRAFO_C2C, pnfft_flags, pfft_flags, comm_cart);
+}
+
+
+/* Choose n, m, the window and the interpolation of the window from the target relative error 'eps'.
+ * Without PFFT_ESTIMATE the cheapest candidates are timed with 'local_M' nodes. */
+#define PNFFT_PLANNER_NUM_CANDIDATES 3
+
+PNX(plan) PNX(init_guru_eps)(
+    int d, const INT *N, const R *x_max, R eps,
+    INT local_M,
+    unsigned pnfft_flags, unsigned pfft_flags,
+    MPI_Comm comm_cart
+    )
+{
+  INT n_cand[3*PNFFT_PLANNER_NUM_CANDIDATES];
+  int m_cand[PNFFT_PLANNER_NUM_CANDIDATES], num, num_procs, best=0;
+  unsigned window_cand[PNFFT_PLANNER_NUM_CANDIDATES];
+
+  if(d != 3){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d != 3 not yet implemented !!!\n");
+    return NULL;
+  }
+
+  MPI_Comm_size(comm_cart, &num_procs);
+  num = PNX(planner_candidates)(d, N, eps, local_M, num_procs, pnfft_flags, PNFFT_PLANNER_NUM_CANDIDATES,
+      n_cand, m_cand, window_cand);
+
+  if(num == 0){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: accuracy eps = %.2e can not be reached by the planner !!!\n", (double) eps);
+    return NULL;
+  }
+
+  /* a choice of the wisdom replaces the first candidate and skips the measurement */
+  if(num > 1 && !(pfft_flags & PFFT_ESTIMATE)){
+    long long local = (long long) local_M, total;
+
+    MPI_Allreduce(&local, &total, 1, MPI_LONG_LONG, MPI_SUM, comm_cart);
+    if( !PNX(wisdom_lookup_planner)(num_procs, pnfft_flags, (INT) total, N, x_max, eps,
+          n_cand, &m_cand[0], &window_cand[0]) ){
+      best = measure_candidates(d, N, x_max, local_M, num, n_cand, m_cand, window_cand, eps, pnfft_flags, comm_cart);
+      PNX(wisdom_add_planner)(num_procs, pnfft_flags, (INT) total, N, x_max, eps,
+          n_cand + d*best, m_cand[best], window_cand[best]);
+    }
+  }
+
+  return PNX(init_guru_internal)(d, N, n_cand + d*best, x_max, 1, local_M, m_cand[best], PNFFTI_TRAFO_C2C,
+      planner_flags(pnfft_flags, window_cand[best], m_cand[best], eps), pfft_flags, comm_cart);
 }
 
 
@@ -80,7 +149,43 @@ PNX(plan) PNX(init_guru_c2r)(
     MPI_Comm comm_cart
     )
 {
-  return PNX(init_guru_internal)(d, N, n, x_max, local_M, m, PNFFTI_TRAFO_C2R, pnfft_flags, pfft_flags, comm_cart);
+  return PNX(init_guru_internal)(d, N, n, x_max, 1, local_M, m, PNFFTI_TRAFO_C2R, pnfft_flags, pfft_flags, comm_cart);
+}
+
+/* Change x_max and/or the window shape parameters b of an existing plan, e.g., if the box changes
+ * in every step. NULL keeps the old values. The FFT and ghost cell plans and all buffers are kept,
+ * a new b recomputes the window and deconvolution tables. Returns 1 and keeps the plan unchanged
+ * if the new x_max needs another FFT output size. Collective, call PNX(precompute_psi) afterwards. */
+int PNX(update_plan)(
+    const R *x_max, const R *b,
+    PNX(plan) ths
+    )
+{
+  if(x_max != NULL){
+    INT no[3];
+    R x_max3[3] = {0, 0, 0};
+
+    for(int t=0; t<ths->d; t++)
+      x_max3[t] = x_max[t];
+    fft_output_size(ths->n, x_max3, ths->m,
+        no);
+    for(int t=0; t<ths->d; t++)
+      if(no[t] != ths->no[t]){
+        PX(fprintf)(ths->comm_cart, stderr, "!!! Error in PNFFT: x_max changes the size of the FFT output, a new plan is needed !!!\n");
+        return 1;
+      }
+
+    for(int t=0; t<ths->d; t++)
+      ths->x_max[t] = x_max[t];
+  }
+
+  if(b != NULL){
+    for(int t=0; t<ths->d; t++)
+      ths->b[t] = b[t];
+    PNX(init_precompute_window)(ths);
+  }
+
+  return 0;
 }
 
 
@@ -92,41 +197,66 @@ static void local_size_guru_internal(
     R *lower_border, R *upper_border
     )
 {
-  INT no[3], local_no[3], local_no_start[3];
+  INT N3[3], n3[3], no[3], local_N3[3], local_N_start3[3], local_no[3], local_no_start3[3];
+  R x_max3[3], lo3[3], up3[3];
 
-  if(d != 3){
-    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d != 3 not yet implemented !!!\n");
+  if(embed_axes(d, N, n, x_max, comm_cart, N3, n3, x_max3))
+    return;
+
+  if(d < 3 && (trafo_flag & PNFFTI_TRAFO_C2R)){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d < 3 not yet implemented for c2r plans !!!\n");
     return;
   }
 
-  fft_output_size(n, x_max, m,
+  fft_output_size(n3, x_max3, m,
       no);
 
-  PNX(local_size_internal)(N, n, no, comm_cart, trafo_flag, pnfft_flags,
-      local_N, local_N_start, local_no, local_no_start);
+  PNX(local_size_internal)(d, N3, n3, no, 1, comm_cart, trafo_flag, pnfft_flags,
+      local_N3, local_N_start3, local_no, local_no_start3);
 
-  PNX(node_borders)(n, local_no, local_no_start, x_max,
-      lower_border, upper_border);
+  PNX(node_borders)(n3, local_no, local_no_start3, x_max3,
+      lo3, up3);
+
+  for(int t=0; t<d; t++){
+    local_N[t] = local_N3[t];
+    local_N_start[t] = local_N_start3[t];
+    lower_border[t] = lo3[t];
+    upper_border[t] = up3[t];
+  }
 }
 
 
 static PNX(plan) PNX(init_guru_internal)(
-    int d, const INT *N, const INT *n, const R *x_max,
+    int d, const INT *N, const INT *n, const R *x_max, INT howmany,
     INT local_M, int m,
     unsigned trafo_flag, unsigned pnfft_flags, unsigned pfft_flags,
     MPI_Comm comm_cart
     )
 {
-  INT no[3];
+  INT N3[3], n3[3], no[3];
+  R x_max3[3];
   PNX(plan) ths;
   unsigned pfft_opt_flags = extract_pfft_opt_flags(pfft_flags);
   
-  if(d != 3){
-    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d != 3 not yet implemented !!!\n");
+  if(embed_axes(d, N, n, x_max, comm_cart, N3, n3, x_max3))
+    return NULL;
+
+  if(d < 3 && ((trafo_flag & PNFFTI_TRAFO_C2R) || howmany > 1)){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d < 3 not yet implemented for c2r plans and howmany > 1 !!!\n");
+    return NULL;
+  }
+
+  if(howmany < 1){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: howmany < 1 !!!\n");
+    return NULL;
+  }
+
+  if(howmany > 1 && (pnfft_flags & (PNFFT_MALLOC_GRAD_F | PNFFT_GRAD_IK | PNFFT_REAL_F))){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: howmany > 1 not yet implemented for gradients and real valued f !!!\n");
     return NULL;
   }
   
-  fft_output_size(n, x_max, m,
+  fft_output_size(n3, x_max3, m,
     no);
 
 #if PNFFT_DEBUG_USE_KAISER_BESSEL | PNFFT_DEBUG_USE_GAUSSIAN | PNFFT_DEBUG_USE_BSPLINE | PNFFT_DEBUG_USE_SINC_POWER
@@ -151,17 +281,85 @@ static PNX(plan) PNX(init_guru_internal)(
   pnfft_flags |= PNFFT_WINDOW_SINC_POWER;
 #endif
 
-  ths = PNX(init_internal)(d, N, n, no, local_M, m, trafo_flag, pnfft_flags, pfft_opt_flags, comm_cart);
+  ths = PNX(init_internal)(d, N3, n3, no, howmany, local_M, m, trafo_flag, pnfft_flags, pfft_opt_flags, comm_cart);
 
   /* Quick fix to save x_max in PNFFT plan */
-  for(int t=0; t<d; t++)
-    ths->x_max[t] = x_max[t];
+  for(int t=0; t<3; t++)
+    ths->x_max[t] = x_max3[t];
 
   return ths;
 }
 
 
 
+static unsigned planner_flags(
+    unsigned pnfft_flags, unsigned window_flag, int m, R eps
+    )
+{
+  pnfft_flags &= ~(PNFFT_WINDOW_GAUSSIAN | PNFFT_WINDOW_BSPLINE | PNFFT_WINDOW_SINC_POWER | PNFFT_WINDOW_BESSEL_I0 | PNFFT_WINDOW_ES);
+  pnfft_flags |= window_flag;
+
+  /* keep the precomputation chosen by the user */
+  if( !(pnfft_flags & (PNFFT_PRE_ONE_PSI | PNFFT_FG_PSI)) )
+    pnfft_flags |= PNX(intpol_flag_for_accuracy)(m, eps);
+
+  return pnfft_flags;
+}
+
+/* Time one trafo and one adjoint for every candidate on quasi random nodes and return the fastest one. */
+static int measure_candidates(
+    int d, const INT *N, const R *x_max, INT local_M,
+    int num, const INT *n_cand, const int *m_cand, const unsigned *window_cand,
+    R eps, unsigned pnfft_flags, MPI_Comm comm_cart
+    )
+{
+  int best = 0;
+  double time, time_max, time_best = -1;
+  INT local_N[3], local_N_start[3];
+  R lo[3], up[3];
+  unsigned trial_flags;
+  PNX(plan) ths;
+
+  for(int c=0; c<num; c++){
+    trial_flags = planner_flags(pnfft_flags, window_cand[c], m_cand[c], eps);
+    trial_flags &= ~(PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI | PNFFT_MALLOC_GRAD_F);
+    trial_flags |= PNFFT_MALLOC_X | PNFFT_MALLOC_F_HAT | PNFFT_MALLOC_F;
+
+    local_size_guru_internal(d, N, n_cand + d*c, x_max, m_cand[c], comm_cart, PNFFTI_TRAFO_C2C, trial_flags,
+        local_N, local_N_start, lo, up);
+    ths = PNX(init_guru_internal)(d, N, n_cand + d*c, x_max, 1, local_M, m_cand[c], PNFFTI_TRAFO_C2C,
+        trial_flags, PFFT_ESTIMATE, comm_cart);
+    if(ths == NULL)
+      continue;
+
+    for(INT k=0; k<ths->local_N_total; k++)
+      ths->f_hat[k] = 0;
+    for(INT j=0; j<local_M; j++)
+      for(int t=0; t<d; t++){
+        /* Kronecker sequence with the square roots of primes */
+        const R alpha[3] = {1.4142135623730951, 1.7320508075688772, 2.2360679774997898};
+        R frac = (j+1)*alpha[t] - pnfft_floor((j+1)*alpha[t]);
+        ths->x[d*j+t] = lo[t] + frac * (up[t] - lo[t]);
+      }
+
+    time = -MPI_Wtime();
+    PNX(trafo)(ths);
+    PNX(adj)(ths);
+    time += MPI_Wtime();
+    MPI_Allreduce(&time, &time_max, 1, MPI_DOUBLE, MPI_MAX, comm_cart);
+
+    if(time_best < 0 || time_max < time_best){
+      time_best = time_max;
+      best = c;
+    }
+
+    PNX(finalize)(ths, PNFFT_FREE_X | PNFFT_FREE_F_HAT | PNFFT_FREE_F);
+  }
+
+  return best;
+}
+
+
 static unsigned extract_pfft_opt_flags(
     unsigned pfft_flags
     )
@@ -214,4 +412,22 @@ static void fft_output_size(
   }
 }
 
+/* Plans with d < 3 are computed on three axes, the axes t >= d get N = n = 1 and x_max = 0.
+ * Returns 1 for an unsupported d. */
+static int embed_axes(
+    int d, const INT *N, const INT *n, const R *x_max, MPI_Comm comm_cart,
+    INT *N3, INT *n3, R *x_max3
+    )
+{
+  if(d < 1 || d > 3){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d < 1 or d > 3 not supported !!!\n");
+    return 1;
+  }
 
+  for(int t=0; t<3; t++){
+    N3[t] = (t < d) ? N[t] : 1;
+    n3[t] = (t < d) ? n[t] : 1;
+    x_max3[t] = (t < d) ? x_max[t] : 0;
+  }
+  return 0;
+}
@@ -5,12 +5,19 @@
 
 PNFFT_EXTERN int PNX(create_procmesh_2d_f03)(MPI_Fint f_comm, int np0, int np1, MPI_Fint * f_comm_cart_2d);
 PNFFT_EXTERN int PNX(create_procmesh_f03)(int rnk, MPI_Fint f_comm, const int * np, MPI_Fint * f_comm_cart);
+PNFFT_EXTERN int PNX(balanced_procmesh_f03)(int rnk, const INT * n, INT local_M, const R * x, MPI_Fint f_comm, int * np);
+PNFFT_EXTERN int PNX(topology_procmesh_f03)(int rnk, const INT * n, int m, MPI_Fint f_comm, int * np);
+PNFFT_EXTERN void PNX(print_procmesh_volume_f03)(int rnk, const INT * n, int m, MPI_Fint f_comm);
+PNFFT_EXTERN int PNX(create_procmesh_topology_f03)(int rnk, MPI_Fint f_comm, const int * np, MPI_Fint * f_comm_cart);
 PNFFT_EXTERN void PNX(local_size_3d_f03)(const INT * N, MPI_Fint f_comm_cart, unsigned pnfft_flags, INT * local_N, INT * local_N_start, R * lower_border, R * upper_border);
 PNFFT_EXTERN void PNX(local_size_adv_f03)(int d, const INT * N, MPI_Fint f_comm_cart, unsigned pnfft_flags, INT * local_N, INT * local_N_start, R * lower_border, R * upper_border);
 PNFFT_EXTERN void PNX(local_size_guru_f03)(int d, const INT * N, const INT * Nos, const R * x_max, int m, MPI_Fint f_comm_cart, unsigned pnfft_flags, INT * local_N, INT * local_N_start, R * lower_border, R * upper_border);
 PNFFT_EXTERN PNX(plan) PNX(init_3d_f03)(const INT * N, INT local_M, MPI_Fint f_comm_cart);
 PNFFT_EXTERN PNX(plan) PNX(init_adv_f03)(int d, const INT * N, INT local_M, unsigned pnfft_flags, unsigned fftw_flags, MPI_Fint f_comm_cart);
 PNFFT_EXTERN PNX(plan) PNX(init_guru_f03)(int d, const INT * N, const INT * Nos, const R * x_max, INT local_M, int m, unsigned pnfft_flags, unsigned fftw_flags, MPI_Fint f_comm_cart);
+PNFFT_EXTERN PNX(plan) PNX(init_guru_many_f03)(int d, const INT * N, const INT * Nos, const R * x_max, INT howmany, INT local_M, int m, unsigned pnfft_flags, unsigned fftw_flags, MPI_Fint f_comm_cart);
+PNFFT_EXTERN PNX(plan) PNX(init_guru_eps_f03)(int d, const INT * N, const R * x_max, R eps, INT local_M, unsigned pnfft_flags, unsigned fftw_flags, MPI_Fint f_comm_cart);
+PNFFT_EXTERN PNX(type3) PNX(init_type3_f03)(int d, const R * x_max, const R * v_max, int m, unsigned pnfft_flags, unsigned pfft_flags, MPI_Fint f_comm_cart);
 PNFFT_EXTERN void PNX(vpr_complex_f03)(C * data, INT N, const char * name, MPI_Fint f_comm);
 PNFFT_EXTERN void PNX(vpr_real_f03)(R * data, INT N, const char * name, MPI_Fint f_comm);
 PNFFT_EXTERN void PNX(apr_complex_3d_f03)(C * data, INT * local_N, INT * local_N_start, unsigned pnfft_flags, const char * name, MPI_Fint f_comm);
@@ -19,6 +26,14 @@ PNFFT_EXTERN void PNX(print_average_timer_f03)(const PNX(plan) ths, MPI_Fint f_c
 PNFFT_EXTERN void PNX(print_average_timer_adv_f03)(const PNX(plan) ths, MPI_Fint f_comm);
 PNFFT_EXTERN void PNX(write_average_timer_f03)(const PNX(plan) ths, const char * name, MPI_Fint f_comm);
 PNFFT_EXTERN void PNX(write_average_timer_adv_f03)(const PNX(plan) ths, const char * name, MPI_Fint f_comm);
+PNFFT_EXTERN void PNX(reduce_profile_f03)(const PNX(plan) ths, int phase, MPI_Fint f_comm, double *time_min, double *time_avg, double *time_max);
+PNFFT_EXTERN void PNX(print_profile_f03)(const PNX(plan) ths, MPI_Fint f_comm);
+PNFFT_EXTERN void PNX(print_load_balance_f03)(const PNX(plan) ths, MPI_Fint f_comm);
+PNFFT_EXTERN void PNX(print_memory_f03)(const PNX(plan) ths, MPI_Fint f_comm);
+PNFFT_EXTERN int PNX(export_wisdom_f03)(const char * filename, MPI_Fint f_comm);
+PNFFT_EXTERN int PNX(import_wisdom_f03)(const char * filename, MPI_Fint f_comm);
+PNFFT_EXTERN int PNX(save_table_cache_f03)(const char * filename, MPI_Fint f_comm);
+PNFFT_EXTERN int PNX(load_table_cache_f03)(const char * filename, MPI_Fint f_comm);
 
 int PNX(create_procmesh_2d_f03)(MPI_Fint f_comm, int np0, int np1, MPI_Fint * f_comm_cart_2d)
 {
@@ -40,6 +55,40 @@ int PNX(create_procmesh_f03)(int rnk, MPI_Fint f_comm, const int * np, MPI_Fint
   return ret;
 }
 
+int PNX(balanced_procmesh_f03)(int rnk, const INT * n, INT local_M, const R * x, MPI_Fint f_comm, int * np)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  return PNX(balanced_procmesh)(rnk, n, local_M, x, comm, np);
+}
+
+int PNX(topology_procmesh_f03)(int rnk, const INT * n, int m, MPI_Fint f_comm, int * np)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  return PNX(topology_procmesh)(rnk, n, m, comm, np);
+}
+
+void PNX(print_procmesh_volume_f03)(int rnk, const INT * n, int m, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  PNX(print_procmesh_volume)(rnk, n, m, comm);
+}
+
+int PNX(create_procmesh_topology_f03)(int rnk, MPI_Fint f_comm, const int * np, MPI_Fint * f_comm_cart)
+{
+  MPI_Comm comm, comm_cart;
+
+  comm = MPI_Comm_f2c(f_comm);
+  int ret = PNX(create_procmesh_topology)(rnk, comm, np, &comm_cart);
+  *f_comm_cart = MPI_Comm_c2f(comm_cart);
+  return ret;
+}
+
 void PNX(local_size_3d_f03)(const INT * N, MPI_Fint f_comm_cart, unsigned pnfft_flags, INT * local_N, INT * local_N_start, R * lower_border, R * upper_border)
 {
   MPI_Comm comm_cart;
@@ -91,6 +140,33 @@ PNX(plan) PNX(init_guru_f03)(int d, const INT * N, const INT * Nos, const R * x_
   return ret;
 }
 
+PNX(plan) PNX(init_guru_many_f03)(int d, const INT * N, const INT * Nos, const R * x_max, INT howmany, INT local_M, int m, unsigned pnfft_flags, unsigned fftw_flags, MPI_Fint f_comm_cart)
+{
+  MPI_Comm comm_cart;
+
+  comm_cart = MPI_Comm_f2c(f_comm_cart);
+  PNX(plan) ret = PNX(init_guru_many)(d, N, Nos, x_max, howmany, local_M, m, pnfft_flags, fftw_flags, comm_cart);
+  return ret;
+}
+
+PNX(plan) PNX(init_guru_eps_f03)(int d, const INT * N, const R * x_max, R eps, INT local_M, unsigned pnfft_flags, unsigned fftw_flags, MPI_Fint f_comm_cart)
+{
+  MPI_Comm comm_cart;
+
+  comm_cart = MPI_Comm_f2c(f_comm_cart);
+  PNX(plan) ret = PNX(init_guru_eps)(d, N, x_max, eps, local_M, pnfft_flags, fftw_flags, comm_cart);
+  return ret;
+}
+
+PNX(type3) PNX(init_type3_f03)(int d, const R * x_max, const R * v_max, int m, unsigned pnfft_flags, unsigned pfft_flags, MPI_Fint f_comm_cart)
+{
+  MPI_Comm comm_cart;
+
+  comm_cart = MPI_Comm_f2c(f_comm_cart);
+  PNX(type3) ret = PNX(init_type3)(d, x_max, v_max, m, pnfft_flags, pfft_flags, comm_cart);
+  return ret;
+}
+
 void PNX(vpr_complex_f03)(C * data, INT N, const char * name, MPI_Fint f_comm)
 {
   MPI_Comm comm;
@@ -155,3 +231,67 @@ void PNX(write_average_timer_adv_f03)(const PNX(plan) ths, const char * name, MP
   comm = MPI_Comm_f2c(f_comm);
   PNX(write_average_timer_adv)(ths, name, comm);
 }
+
+void PNX(reduce_profile_f03)(const PNX(plan) ths, int phase, MPI_Fint f_comm, double *time_min, double *time_avg, double *time_max)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  PNX(reduce_profile)(ths, phase, comm, time_min, time_avg, time_max);
+}
+
+void PNX(print_profile_f03)(const PNX(plan) ths, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  PNX(print_profile)(ths, comm);
+}
+
+void PNX(print_load_balance_f03)(const PNX(plan) ths, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  PNX(print_load_balance)(ths, comm);
+}
+
+void PNX(print_memory_f03)(const PNX(plan) ths, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  PNX(print_memory)(ths, comm);
+}
+
+int PNX(export_wisdom_f03)(const char * filename, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  return PNX(export_wisdom)(filename, comm);
+}
+
+int PNX(import_wisdom_f03)(const char * filename, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  return PNX(import_wisdom)(filename, comm);
+}
+
+int PNX(save_table_cache_f03)(const char * filename, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  return PNX(save_table_cache)(filename, comm);
+}
+
+int PNX(load_table_cache_f03)(const char * filename, MPI_Fint f_comm)
+{
+  MPI_Comm comm;
+
+  comm = MPI_Comm_f2c(f_comm);
+  return PNX(load_table_cache)(filename, comm);
+}
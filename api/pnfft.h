@@ -51,10 +51,35 @@
 #define PNFFT_DEFINE_API(PNX, PX, X, R, C, INT)                                         \
                                                                                         \
   typedef struct PNX(plan_s) *PNX(plan);                                                \
+  typedef struct PNX(arena_s) *PNX(arena);                                              \
+  typedef struct PNX(solver_s) *PNX(solver);                                            \
+  typedef struct PNX(nodes_s) *PNX(nodes);                                              \
+  typedef struct PNX(type3_s) *PNX(type3);                                              \
+  typedef void (*PNX(profile_hook))(                                                    \
+      int phase, int start, void *data);                                                \
+  typedef void (*PNX(fourier_op))(                                                      \
+      C *f_hat, const INT *local_N, const INT *local_N_start, INT howmany, void *data); \
+  typedef int (*PNX(b_kernel))(                                                         \
+      PNX(plan) ths, int interlaced, void *data);                                       \
+  typedef struct{                                                                       \
+    PNX(b_kernel) trafo_B;                                                              \
+    PNX(b_kernel) adjoint_B;                                                            \
+    void *data;                                                                         \
+  } PNX(backend);                                                                       \
                                                                                         \
   PNFFT_EXTERN int PNX(create_procmesh_2d)(                                             \
       MPI_Comm comm, int np0, int np1, MPI_Comm *comm_cart_2d);                         \
   PNFFT_EXTERN int PNX(create_procmesh)(                                                \
+      int rnk, MPI_Comm comm, const int *np, MPI_Comm *comm_cart);                      \
+  PNFFT_EXTERN int PNX(balanced_procmesh)(                                              \
+      int rnk, const INT *n, INT local_M, const R *x, MPI_Comm comm,                    \
+      int *np);                                                                         \
+  PNFFT_EXTERN int PNX(topology_procmesh)(                                              \
+      int rnk, const INT *n, int m, MPI_Comm comm,                                      \
+      int *np);                                                                         \
+  PNFFT_EXTERN void PNX(print_procmesh_volume)(                                         \
+      int rnk, const INT *n, int m, MPI_Comm comm);                                     \
+  PNFFT_EXTERN int PNX(create_procmesh_topology)(                                       \
       int rnk, MPI_Comm comm, const int *np, MPI_Comm *comm_cart);                      \
                                                                                         \
   PNFFT_EXTERN void PNX(local_size_3d)(                                                 \
@@ -111,14 +136,44 @@
         const INT *N, const INT *n, const R *x_max,                                     \
         INT local_M, int m,                                                             \
         unsigned pnfft_flags, unsigned fftw_flags,                                      \
+        MPI_Comm comm_cart);                                                            \
+  PNFFT_EXTERN PNX(plan) PNX(init_guru_many)(                                           \
+        int d,                                                                          \
+        const INT *N, const INT *n, const R *x_max, INT howmany,                        \
+        INT local_M, int m,                                                             \
+        unsigned pnfft_flags, unsigned fftw_flags,                                      \
+        MPI_Comm comm_cart);                                                            \
+  PNFFT_EXTERN PNX(plan) PNX(init_guru_eps)(                                            \
+        int d,                                                                          \
+        const INT *N, const R *x_max, R eps,                                            \
+        INT local_M,                                                                    \
+        unsigned pnfft_flags, unsigned fftw_flags,                                      \
         MPI_Comm comm_cart);                                                            \
                                                                                         \
   PNFFT_EXTERN void PNX(init_nodes)(                                                    \
       PNX(plan) ths, INT local_M,                                                       \
       unsigned pnfft_flags, unsigned pnfft_finalize_flags);                             \
+  PNFFT_EXTERN void PNX(set_local_M)(                                                   \
+      INT local_M, PNX(plan) ths);                                                      \
+  PNFFT_EXTERN INT PNX(get_local_M)(                                                    \
+      const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN PNX(nodes) PNX(mknodes)(                                                 \
+      INT local_M, unsigned malloc_flags, const PNX(plan) ths);                         \
+  PNFFT_EXTERN void PNX(attach_nodes)(                                                  \
+      PNX(nodes) nodes, PNX(plan) ths);                                                 \
+  PNFFT_EXTERN PNX(nodes) PNX(get_attached_nodes)(                                      \
+      const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN void PNX(rmnodes)(                                                       \
+      PNX(nodes) nodes, PNX(plan) ths);                                                 \
                                                                                         \
   PNFFT_EXTERN void PNX(precompute_psi)(                                                \
       PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(sort_nodes)(                                                    \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(unsort_nodes)(                                                  \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(redistribute_nodes)(                                            \
+      PNX(plan) ths, INT user_M, const R *user_x);                                      \
                                                                                         \
   PNFFT_EXTERN void PNX(set_f_hat)(                                                     \
       C *f_hat, PNX(plan) ths);                                                         \
@@ -132,10 +187,40 @@
       R *f, PNX(plan) ths);                                                             \
   PNFFT_EXTERN void PNX(set_grad_f_real)(                                               \
       R *grad_f, PNX(plan) ths);                                                        \
+  PNFFT_EXTERN void PNX(set_hessian_f)(                                                 \
+      C *hessian_f, PNX(plan) ths);                                                     \
+  PNFFT_EXTERN void PNX(set_hessian_f_real)(                                            \
+      R *hessian_f, PNX(plan) ths);                                                     \
   PNFFT_EXTERN void PNX(set_x)(                                                         \
       R *x, PNX(plan) ths);                                                             \
   PNFFT_EXTERN void PNX(set_b)(                                                         \
       R b0, R b1, R b2, PNX(plan) ths);                                                 \
+  PNFFT_EXTERN void PNX(set_pre_psi_block)(                                             \
+      INT bytes, PNX(plan) ths);                                                        \
+  PNFFT_EXTERN void PNX(set_shared_psi)(                                                \
+      INT bytes, PNX(plan) ths);                                                        \
+  PNFFT_EXTERN void PNX(set_spread_tile)(                                               \
+      INT tile, PNX(plan) ths);                                                         \
+  PNFFT_EXTERN void PNX(set_sort_keys)(                                                 \
+      int keys, PNX(plan) ths);                                                         \
+  PNFFT_EXTERN void PNX(set_sparse_b)(                                                  \
+      int mode, R threshold, PNX(plan) ths);                                            \
+  PNFFT_EXTERN void PNX(set_prune_stencil)(                                             \
+      int prune, PNX(plan) ths);                                                        \
+  PNFFT_EXTERN void PNX(set_pre_psi_single)(                                            \
+      int single, PNX(plan) ths);                                                       \
+  PNFFT_EXTERN void PNX(set_ghost_engine)(                                              \
+      int engine, PNX(plan) ths);                                                       \
+  PNFFT_EXTERN void PNX(set_halo)(                                                      \
+      int mode, PNX(plan) ths);                                                         \
+  PNFFT_EXTERN void PNX(set_boundary)(                                                  \
+      const int *boundary, PNX(plan) ths);                                              \
+  PNFFT_EXTERN void PNX(set_progress)(                                                  \
+      int mode, PNX(plan) ths);                                                         \
+  PNFFT_EXTERN void PNX(set_backend)(                                                   \
+      PNX(plan) ths, const PNX(backend) *backend);                                      \
+  PNFFT_EXTERN int PNX(update_plan)(                                                    \
+      const R *x_max, const R *b, PNX(plan) ths);                                       \
                                                                                         \
   PNFFT_EXTERN C *PNX(get_f_hat)(                                                       \
       const PNX(plan) ths);                                                             \
@@ -149,13 +234,23 @@
       const PNX(plan) ths);                                                             \
   PNFFT_EXTERN R *PNX(get_grad_f_real)(                                                 \
       const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN C *PNX(get_hessian_f)(                                                   \
+      const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN R *PNX(get_hessian_f_real)(                                              \
+      const PNX(plan) ths);                                                             \
   PNFFT_EXTERN R *PNX(get_x)(                                                           \
       const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN const INT *PNX(get_node_order)(                                          \
+      const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN R *PNX(get_grid)(                                                        \
+      const PNX(plan) ths, INT *local_no, INT *local_no_start);                         \
                                                                                         \
   PNFFT_EXTERN int PNX(get_d)(                                                          \
       const PNX(plan) ths);                                                             \
   PNFFT_EXTERN int PNX(get_m)(                                                          \
       const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN INT PNX(get_howmany)(                                                    \
+      const PNX(plan) ths);                                                             \
   PNFFT_EXTERN void PNX(get_x_max)(                                                     \
       const PNX(plan) ths, R *x_max);                                                   \
   PNFFT_EXTERN  void PNX(get_N)(                                                        \
@@ -169,6 +264,10 @@
   PNFFT_EXTERN void PNX(get_b)(                                                         \
       const PNX(plan) ths,                                                              \
       R *b0, R *b1, R *b2);                                                             \
+  PNFFT_EXTERN R PNX(get_error_estimate)(                                               \
+      const PNX(plan) ths);                                                             \
+  PNFFT_EXTERN INT PNX(get_pre_psi_block)(                                              \
+      const PNX(plan) ths);                                                             \
                                                                                         \
   PNFFT_EXTERN void PNX(finalize)(                                                      \
       PNX(plan) ths, unsigned pnfft_finalize_flags);                                    \
@@ -181,12 +280,61 @@
       PNX(plan) ths);                                                                   \
   PNFFT_EXTERN void PNX(adj)(                                                           \
       PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(trafo_start)(                                                   \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(trafo_wait)(                                                    \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(adj_start)(                                                     \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(adj_wait)(                                                      \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN int PNX(progress)(                                                       \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(trafo_pipelined)(                                               \
+      PNX(plan) ths, int num_fields, C **f_hat, C **f, C **grad_f);                     \
+  PNFFT_EXTERN void PNX(adj_pipelined)(                                                 \
+      PNX(plan) ths, int num_fields, C **f, C **f_hat);                                 \
+  PNFFT_EXTERN void PNX(trafo_chunked_start)(                                           \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(trafo_chunk)(                                                   \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(trafo_chunked_finish)(                                          \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(adj_chunked_start)(                                             \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(adj_chunk)(                                                     \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(adj_chunked_finish)(                                            \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(adj_op_trafo)(                                                  \
+      PNX(plan) ths, const R *kernel, PNX(fourier_op) op, void *op_data);               \
+  PNFFT_EXTERN void PNX(trafo_redistributed)(                                           \
+      PNX(plan) ths, C *user_f, C *user_grad_f);                                        \
+  PNFFT_EXTERN void PNX(trafo_redistributed_real)(                                      \
+      PNX(plan) ths, R *user_f, R *user_grad_f);                                        \
+  PNFFT_EXTERN void PNX(adj_redistributed)(                                             \
+      PNX(plan) ths, const C *user_f);                                                  \
+  PNFFT_EXTERN void PNX(adj_redistributed_real)(                                        \
+      PNX(plan) ths, const R *user_f);                                                  \
                                                                                         \
   PNFFT_EXTERN void PNX(init)(                                                          \
       void);                                                                            \
   PNFFT_EXTERN void PNX(cleanup)(                                                       \
       void);                                                                            \
                                                                                         \
+  PNFFT_EXTERN int PNX(export_wisdom)(                                                  \
+      const char *filename, MPI_Comm comm);                                             \
+  PNFFT_EXTERN int PNX(import_wisdom)(                                                  \
+      const char *filename, MPI_Comm comm);                                             \
+  PNFFT_EXTERN void PNX(forget_wisdom)(                                                 \
+      void);                                                                            \
+  PNFFT_EXTERN int PNX(save_table_cache)(                                               \
+      const char *filename, MPI_Comm comm);                                             \
+  PNFFT_EXTERN int PNX(load_table_cache)(                                               \
+      const char *filename, MPI_Comm comm);                                             \
+  PNFFT_EXTERN void PNX(forget_table_cache)(                                            \
+      void);                                                                            \
+                                                                                        \
   PNFFT_EXTERN void *PNX(malloc)(size_t n);					        \
   PNFFT_EXTERN R *PNX(alloc_real)(size_t n);					        \
   PNFFT_EXTERN C *PNX(alloc_complex)(size_t n);				                \
@@ -252,6 +400,80 @@
   PNFFT_EXTERN void PNX(write_average_timer_adv)(                                       \
       const PNX(plan) ths, const char *name, MPI_Comm comm);                            \
                                                                                         \
+  PNFFT_EXTERN void PNX(get_profile)(                                                   \
+      const PNX(plan) ths, int phase,                                                   \
+      double *time, double *calls, double *bytes);                                      \
+  PNFFT_EXTERN void PNX(reduce_profile)(                                                \
+      const PNX(plan) ths, int phase, MPI_Comm comm,                                    \
+      double *time_min, double *time_avg, double *time_max);                            \
+  PNFFT_EXTERN const char *PNX(get_profile_name)(                                       \
+      int phase);                                                                       \
+  PNFFT_EXTERN void PNX(reset_profile)(                                                 \
+      PNX(plan) ths);                                                                   \
+  PNFFT_EXTERN void PNX(set_profile_hook)(                                              \
+      PNX(plan) ths, PNX(profile_hook) hook, void *data);                               \
+  PNFFT_EXTERN void PNX(set_profile_detail)(                                            \
+      PNX(plan) ths, int detail);                                                       \
+  PNFFT_EXTERN void PNX(print_profile)(                                                 \
+      const PNX(plan) ths, MPI_Comm comm);                                              \
+  PNFFT_EXTERN void PNX(print_load_balance)(                                            \
+      const PNX(plan) ths, MPI_Comm comm);                                              \
+                                                                                        \
+  PNFFT_EXTERN INT PNX(get_memory)(                                                     \
+      const PNX(plan) ths, int component);                                              \
+  PNFFT_EXTERN const char *PNX(get_memory_name)(                                        \
+      int component);                                                                   \
+  PNFFT_EXTERN void PNX(print_memory)(                                                  \
+      const PNX(plan) ths, MPI_Comm comm);                                              \
+                                                                                        \
+  PNFFT_EXTERN PNX(arena) PNX(mkarena)(                                                 \
+      void);                                                                            \
+  PNFFT_EXTERN void PNX(set_arena_grids)(                                               \
+      R *g1, R *g2, INT size, PNX(arena) arena);                                        \
+  PNFFT_EXTERN void PNX(rmarena)(                                                       \
+      PNX(arena) arena);                                                                \
+  PNFFT_EXTERN void PNX(plan_with_arena)(                                               \
+      PNX(arena) arena);                                                                \
+  PNFFT_EXTERN void PNX(plan_with_alloc)(                                               \
+      unsigned alloc_flags);                                                            \
+  PNFFT_EXTERN void PNX(plan_with_direction)(                                           \
+      int direction);                                                                   \
+  PNFFT_EXTERN INT PNX(get_arena_memory)(                                               \
+      const PNX(arena) arena);                                                          \
+                                                                                        \
+  PNFFT_EXTERN PNX(solver) PNX(init_solver)(                                            \
+      PNX(plan) mv, unsigned solver_flags);                                             \
+  PNFFT_EXTERN void PNX(solver_before_loop)(                                            \
+      PNX(solver) ths);                                                                 \
+  PNFFT_EXTERN void PNX(solver_loop_one_step)(                                          \
+      PNX(solver) ths);                                                                 \
+  PNFFT_EXTERN void PNX(finalize_solver)(                                               \
+      PNX(solver) ths);                                                                 \
+  PNFFT_EXTERN C *PNX(solver_get_y)(                                                    \
+      const PNX(solver) ths);                                                           \
+  PNFFT_EXTERN C *PNX(solver_get_f_hat_iter)(                                           \
+      const PNX(solver) ths);                                                           \
+  PNFFT_EXTERN R *PNX(solver_get_w)(                                                    \
+      const PNX(solver) ths);                                                           \
+  PNFFT_EXTERN R *PNX(solver_get_w_hat)(                                                \
+      const PNX(solver) ths);                                                           \
+  PNFFT_EXTERN R PNX(solver_get_dot_r_iter)(                                            \
+      const PNX(solver) ths);                                                           \
+  PNFFT_EXTERN INT PNX(solver_get_memory)(                                              \
+      const PNX(solver) ths);                                                           \
+                                                                                        \
+  PNFFT_EXTERN PNX(type3) PNX(init_type3)(                                              \
+      int d, const R *x_max, const R *v_max, int m,                                     \
+      unsigned pnfft_flags, unsigned pfft_flags, MPI_Comm comm_cart);                   \
+  PNFFT_EXTERN void PNX(type3_set_nodes)(                                               \
+      PNX(type3) ths, INT local_M, const R *x, INT local_K, const R *v);                \
+  PNFFT_EXTERN void PNX(trafo_type3)(                                                   \
+      PNX(type3) ths, const C *c, C *f);                                                \
+  PNFFT_EXTERN void PNX(type3_get_N)(                                                   \
+      const PNX(type3) ths, INT *N);                                                    \
+  PNFFT_EXTERN void PNX(finalize_type3)(                                                \
+      PNX(type3) ths);                                                                  \
+                                                                                        \
   PNFFT_EXTERN void PNX(get_args)(                                                      \
       int argc, char **argv, const char *name,                                          \
       int neededArgs, unsigned type,                                                    \
@@ -295,6 +517,8 @@ PNFFT_DEFINE_API(PNFFT_MANGLE_LONG_DOUBLE, PFFT_MANGLE_LONG_DOUBLE, FFTW_MANGLE_
 #define PNFFT_MALLOC_F_HAT     (1U<< 9)
 #define PNFFT_MALLOC_F         (1U<< 10)
 #define PNFFT_MALLOC_GRAD_F    (1U<< 11)
+/* six components xx, xy, xz, yy, yz, zz of the Hessian per node, gathered together with f and grad_f */
+#define PNFFT_MALLOC_HESSIAN_F (1U<< 31)
 
 #define PNFFT_FFT_OUT_OF_PLACE (0U)
 #define PNFFT_FFT_IN_PLACE     (1U<< 12)
@@ -308,10 +532,19 @@ PNFFT_DEFINE_API(PNFFT_MANGLE_LONG_DOUBLE, PFFT_MANGLE_LONG_DOUBLE, FFTW_MANGLE_
 #define PNFFT_GRAD_AD          (0U)
 #define PNFFT_GRAD_IK          (1U<< 18)
 #define PNFFT_GRAD_NONE        (1U<< 19) /* turn off gradient NFFT and save memory for buffers */
+#define PNFFT_BATCH_IK         (1U<< 26)
+/* potential and ik gradient share one FFT with howmany=4 and one ghost cell send */
+#define PNFFT_GRAD_IK_BATCHED  ((PNFFT_GRAD_IK| PNFFT_BATCH_IK))
+#define PNFFT_BATCH_INTERLACED (1U<< 27)
+/* both interlacing grids share one FFT with howmany=2 and one loop over the nodes */
+#define PNFFT_INTERLACED_BATCHED ((PNFFT_INTERLACED| PNFFT_BATCH_INTERLACED))
 
 /* enable some optimizations for real inputs */
 #define PNFFT_REAL_F           (1U<< 20)
 
+/* gather and spread on a single precision copy of the ghost cell grid, FFT and deconvolution keep the plan precision */
+#define PNFFT_MIXED_PRECISION  (1U<< 30)
+
 /* default window function is Kaiser-Bessel */
 #define PNFFT_WINDOW_KAISER_BESSEL  (0U)
 #define PNFFT_WINDOW_GAUSSIAN       (1U<< 21)
@@ -320,18 +553,25 @@ PNFFT_DEFINE_API(PNFFT_MANGLE_LONG_DOUBLE, PFFT_MANGLE_LONG_DOUBLE, FFTW_MANGLE_
 #define PNFFT_WINDOW_BESSEL_I0      (1U<< 24)
 #define PNFFT_USE_FK_GAUSSIAN_T     (1U<< 25)
 #define PNFFT_WINDOW_GAUSSIAN_T     ((PNFFT_USE_FK_GAUSSIAN_T | PNFFT_WINDOW_GAUSSIAN))
+/* exponential of semicircle exp(b*(sqrt(1-x^2)-1)), Fourier coefficients are integrated numerically */
+#define PNFFT_WINDOW_ES             (1U<< 29)
+
+/* evaluate the window by one polynomial of degree m+3 per stencil cell (Horner's scheme, no tables per node) */
+#define PNFFT_PRE_POLY_PSI     (1U<< 28)
 
 
 #define PNFFT_PRE_INTPOL_PSI ((PNFFT_PRE_CONST_PSI| PNFFT_PRE_LIN_PSI| PNFFT_PRE_QUAD_PSI| PNFFT_PRE_CUB_PSI))
-#define PNFFT_PRE_ONE_PSI    ((PNFFT_PRE_INTPOL_PSI| PNFFT_PRE_FG_PSI| PNFFT_PRE_PSI| PNFFT_PRE_FULL_PSI))
+#define PNFFT_PRE_ONE_PSI    ((PNFFT_PRE_INTPOL_PSI| PNFFT_PRE_POLY_PSI| PNFFT_PRE_FG_PSI| PNFFT_PRE_PSI| PNFFT_PRE_FULL_PSI))
 
 #define PNFFT_FREE_X           ((PNFFT_MALLOC_X))
 #define PNFFT_FREE_F_HAT       ((PNFFT_MALLOC_F_HAT))
 #define PNFFT_FREE_F           ((PNFFT_MALLOC_F))
 #define PNFFT_FREE_GRAD_F      ((PNFFT_MALLOC_GRAD_F))
+#define PNFFT_FREE_HESSIAN_F   ((PNFFT_MALLOC_HESSIAN_F))
 
 #define PNFFT_COMPUTE_F        ((PNFFT_MALLOC_F))
 #define PNFFT_COMPUTE_GRAD_F   ((PNFFT_MALLOC_GRAD_F))
+#define PNFFT_COMPUTE_HESSIAN_F ((PNFFT_MALLOC_HESSIAN_F))
 
 #define PNFFT_INT            ((PFFT_INT))
 #define PNFFT_PTRDIFF_T      ((PFFT_PTRDIFF_T))
@@ -354,6 +594,94 @@ PNFFT_DEFINE_API(PNFFT_MANGLE_LONG_DOUBLE, PFFT_MANGLE_LONG_DOUBLE, FFTW_MANGLE_
 #define PNFFT_TIMER_SHIFT_INPUT     (8)
 #define PNFFT_TIMER_SHIFT_OUTPUT    (9)
 
+/* Phases of the profile are the timer indices of trafo and adj shifted
+ * by PNFFT_PROFILE_TRAFO or PNFFT_PROFILE_ADJ plus the window precomputation,
+ * followed by the sub-phases of trafo and adj shifted by PNFFT_PROFILE_TRAFO_SUB
+ * or PNFFT_PROFILE_ADJ_SUB */
+#define PNFFT_PROFILE_TRAFO          (0)
+#define PNFFT_PROFILE_ADJ            (PNFFT_TIMER_LENGTH)
+#define PNFFT_PROFILE_PRECOMPUTE_PSI (2*PNFFT_TIMER_LENGTH)
+#define PNFFT_PROFILE_TRAFO_SUB      (2*PNFFT_TIMER_LENGTH+1)
+#define PNFFT_PROFILE_ADJ_SUB        (PNFFT_PROFILE_TRAFO_SUB + PNFFT_PROFILE_SUB_LENGTH)
+#define PNFFT_PROFILE_LENGTH         (PNFFT_PROFILE_ADJ_SUB + PNFFT_PROFILE_SUB_LENGTH)
+
+/* Sub-phases: matrix F splits into the PFFT remaps and the local FFTs, the ghost cells into
+ * posting the messages and waiting for them, loop B into the window evaluation and the
+ * accumulation on the grid (the last two only with PNX(set_profile_detail)) */
+#define PNFFT_PROFILE_SUB_F_REMAP     (0)
+#define PNFFT_PROFILE_SUB_F_LOCAL     (1)
+#define PNFFT_PROFILE_SUB_GCELLS_POST (2)
+#define PNFFT_PROFILE_SUB_GCELLS_WAIT (3)
+#define PNFFT_PROFILE_SUB_PSI         (4)
+#define PNFFT_PROFILE_SUB_ACCUMULATE  (5)
+#define PNFFT_PROFILE_SUB_LENGTH      (6)
+
+/* Components of the memory report, the grids come first since they can be shared by an arena */
+#define PNFFT_MEMORY_G1              (0)
+#define PNFFT_MEMORY_G2              (1)
+#define PNFFT_MEMORY_G1_BUFFER       (2)
+#define PNFFT_MEMORY_G2_SINGLE       (3)
+#define PNFFT_MEMORY_F_HAT           (4)
+#define PNFFT_MEMORY_F               (5)
+#define PNFFT_MEMORY_GRAD_F          (6)
+#define PNFFT_MEMORY_X               (7)
+#define PNFFT_MEMORY_BUFFER_IL       (8)
+#define PNFFT_MEMORY_PRE_PSI         (9)
+#define PNFFT_MEMORY_INTPOL_TABLES   (10)
+#define PNFFT_MEMORY_PRE_PHI_HAT     (11)
+#define PNFFT_MEMORY_SORTED_INDEX    (12)
+#define PNFFT_MEMORY_HESSIAN_F       (13)
+#define PNFFT_MEMORY_LENGTH          (14)
+#define PNFFT_MEMORY_TOTAL           (-1)
+
+/* Sort keys of PNFFT_SORT_NODES, see PNX(set_sort_keys) */
+#define PNFFT_SORT_KEYS_PLAIN        (0)
+#define PNFFT_SORT_KEYS_TILED        (1)
+#define PNFFT_SORT_KEYS_MORTON       (2)
+
+/* Storage of matrix B for fixed nodes, see PNX(set_sparse_b) */
+#define PNFFT_SPARSE_B_OFF           (0)
+#define PNFFT_SPARSE_B               (1)
+#define PNFFT_SPARSE_B_SINGLE        (2)
+
+/* Flags of PNX(init_solver) */
+#define PNFFT_SOLVER_CGNR              (1U<< 0)
+#define PNFFT_SOLVER_CGNE              (1U<< 1)
+#define PNFFT_SOLVER_PRECOMPUTE_WEIGHT (1U<< 2)
+#define PNFFT_SOLVER_PRECOMPUTE_DAMP   (1U<< 3)
+
+/* Ghost cell engines, see PNX(set_ghost_engine) */
+#define PNFFT_GHOSTS_PFFT            (0)
+#define PNFFT_GHOSTS_PERSISTENT      (1)
+#define PNFFT_GHOSTS_SHARED          (2)
+#define PNFFT_GHOSTS_FLOAT_WIRE      (1U<< 2)
+
+/* Particle halo instead of ghost cells, see PNX(set_halo). PNX(precompute_psi) exchanges the halo
+ * and is collective, except for the calls between PNX(trafo_chunked_start) or PNX(adj_chunked_start)
+ * and the matching finish, these skip the halo */
+#define PNFFT_HALO_OFF               (0)
+#define PNFFT_HALO                   (1)
+#define PNFFT_HALO_AUTO              (2)
+
+/* Boundary of every axis, see PNX(set_boundary) */
+#define PNFFT_BOUNDARY_PERIODIC      (0)
+#define PNFFT_BOUNDARY_OPEN          (1)
+
+/* Progress of PNX(trafo_start) and PNX(adj_start), see PNX(set_progress) */
+#define PNFFT_PROGRESS_CALLS         (0)
+#define PNFFT_PROGRESS_THREAD        (1)
+
+/* Placement of the grids, see PNX(plan_with_alloc) */
+#define PNFFT_ALLOC_DEFAULT          (0U)
+#define PNFFT_ALLOC_FIRST_TOUCH      (1U<< 0)
+#define PNFFT_ALLOC_HUGE_PAGES       (1U<< 1)
+#define PNFFT_ALLOC_HUGETLB          (1U<< 2)
+
+/* Directions of the plans, see PNX(plan_with_direction) */
+#define PNFFT_TRAFO_AND_ADJ          (0)
+#define PNFFT_TRAFO_ONLY             (1)
+#define PNFFT_ADJ_ONLY               (2)
+
 
 
 
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Scaling benchmark of the c2c NFFT. Every run plans one NFFT, times 'repetitions' pairs of
+ * trafo and adj, and compares the trafo on a subsample of the nodes with the direct NDFT.
+ * Rank 0 writes one CSV or JSON line per run with the per phase times of the profile.
+ *
+ * The sweep covers all combinations of
+ *   -bench_N_steps s     N, 2N, ..., 2^s N starting from -pnfft_N
+ *   -bench_sigma  list   oversampling factors, e.g. 2.0,1.5
+ *   -bench_m      list   window cutoffs, e.g. 2,4,6
+ *   -bench_window list   kaiser_bessel, gaussian, gaussian_t, bspline, sinc_power, bessel_i0, es
+ *   -bench_flags  list   combinations of flags joined by '+', e.g. pre_psi+sort_nodes,pre_full_psi
+ * on 1, 2, 4, ... processes up to the size of MPI_COMM_WORLD (-bench_scaling strong|weak).
+ * Strong scaling keeps N and divides -pnfft_local_M nodes, weak scaling keeps -pnfft_local_M
+ * nodes per process and doubles one axis of N whenever the number of processes doubles.
+ * By default there is one node per Fourier coefficient. The precision is the one of the library,
+ * i.e., pnfftf_bench, pnfft_bench and pnfftl_bench. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <pnfft.h>
+
+#if defined(PNFFT_BENCH_FLOAT)
+# define BX(name) PNFFT_MANGLE_FLOAT(name)
+# define BENCH_PRECISION "float"
+typedef float R;
+typedef pnfftf_complex C;
+#elif defined(PNFFT_BENCH_LDOUBLE)
+# define BX(name) PNFFT_MANGLE_LONG_DOUBLE(name)
+# define BENCH_PRECISION "ldouble"
+typedef long double R;
+typedef pnfftl_complex C;
+#else
+# define BX(name) PNFFT_MANGLE_DOUBLE(name)
+# define BENCH_PRECISION "double"
+typedef double R;
+typedef pnfft_complex C;
+#endif
+
+#define BENCH_MAX_LIST 16
+#define BENCH_MAX_NAME 128
+
+#define BENCH_SCALING_NONE   0
+#define BENCH_SCALING_STRONG 1
+#define BENCH_SCALING_WEAK   2
+
+#define BENCH_CSV_HEADER 0
+#define BENCH_CSV        1
+#define BENCH_JSON       2
+
+typedef struct{
+  const char *name;
+  unsigned flag;
+} bench_flag;
+
+static const bench_flag window_names[] = {
+  {"kaiser_bessel", PNFFT_WINDOW_KAISER_BESSEL}, {"gaussian", PNFFT_WINDOW_GAUSSIAN},
+  {"gaussian_t", PNFFT_WINDOW_GAUSSIAN_T}, {"bspline", PNFFT_WINDOW_BSPLINE},
+  {"sinc_power", PNFFT_WINDOW_SINC_POWER}, {"bessel_i0", PNFFT_WINDOW_BESSEL_I0},
+  {"es", PNFFT_WINDOW_ES}, {NULL, 0}
+};
+
+static const bench_flag flag_names[] = {
+  {"none", 0}, {"pre_phi_hat", PNFFT_PRE_PHI_HAT}, {"fg_psi", PNFFT_FG_PSI},
+  {"pre_const_psi", PNFFT_PRE_CONST_PSI}, {"pre_lin_psi", PNFFT_PRE_LIN_PSI},
+  {"pre_quad_psi", PNFFT_PRE_QUAD_PSI}, {"pre_cub_psi", PNFFT_PRE_CUB_PSI},
+  {"pre_psi", PNFFT_PRE_PSI}, {"pre_full_psi", PNFFT_PRE_FULL_PSI},
+  {"pre_poly_psi", PNFFT_PRE_POLY_PSI}, {"fft_in_place", PNFFT_FFT_IN_PLACE},
+  {"sort_nodes", PNFFT_SORT_NODES}, {"interlaced", PNFFT_INTERLACED},
+  {"interlaced_batched", PNFFT_INTERLACED_BATCHED}, {"mixed_precision", PNFFT_MIXED_PRECISION},
+  {NULL, 0}
+};
+
+typedef struct{
+  int procs, np[3], m, repetitions;
+  ptrdiff_t N[3], n[3], local_M, M_total, samples;
+  double sigma;
+  const char *window, *flags;
+  double time_plan, error_estimate, error_abs, error_rel;
+  double phase_avg[PNFFT_PROFILE_LENGTH], phase_max[PNFFT_PROFILE_LENGTH];
+} bench_run;
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *N_steps,
+    int *repetitions, ptrdiff_t *samples,
+    int *scaling, int *format, const char **out,
+    const char **sigma_list, const char **m_list,
+    const char **window_list, const char **flags_list);
+static const char *get_string(
+    int argc, char **argv, const char *name, const char *def);
+static int split_list(
+    const char *list, char delim,
+    char items[BENCH_MAX_LIST][BENCH_MAX_NAME]);
+static int lookup_flags(
+    const bench_flag *table, const char *combination,
+    unsigned *flags);
+static int run_one(
+    MPI_Comm comm, bench_run *run, unsigned pnfft_flags);
+static void write_run(
+    FILE *file, int mode, const bench_run *run);
+static void put_field(
+    FILE *file, int mode, int *first, const char *name, int quote,
+    const char *fmt, ...);
+
+
+int main(int argc, char **argv)
+{
+  int myrank, size, N_steps, repetitions, scaling, format;
+  int num_sigma, num_m, num_window, num_flags;
+  ptrdiff_t N_base[3], local_M, samples;
+  const char *out, *sigma_list, *m_list, *window_list, *flags_list;
+  char sigma_items[BENCH_MAX_LIST][BENCH_MAX_NAME], m_items[BENCH_MAX_LIST][BENCH_MAX_NAME];
+  char window_items[BENCH_MAX_LIST][BENCH_MAX_NAME], flags_items[BENCH_MAX_LIST][BENCH_MAX_NAME];
+  unsigned window_flags[BENCH_MAX_LIST], pnfft_flags[BENCH_MAX_LIST];
+  FILE *file = NULL;
+
+  MPI_Init(&argc, &argv);
+  BX(init)();
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  /* set default values */
+  N_base[0] = N_base[1] = N_base[2] = 16;
+  local_M = 0;
+  N_steps = 0;
+  repetitions = 5;
+  samples = 10;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N_base, &local_M, &N_steps, &repetitions, &samples,
+      &scaling, &format, &out, &sigma_list, &m_list, &window_list, &flags_list);
+
+  num_sigma  = split_list(sigma_list, ',', sigma_items);
+  num_m      = split_list(m_list, ',', m_items);
+  num_window = split_list(window_list, ',', window_items);
+  num_flags  = split_list(flags_list, ',', flags_items);
+
+  for(int w=0; w<num_window; w++)
+    if( lookup_flags(window_names, window_items[w], &window_flags[w]) ){
+      pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Unknown window '%s'.\n", window_items[w]);
+      MPI_Finalize();
+      return 1;
+    }
+  for(int f=0; f<num_flags; f++)
+    if( lookup_flags(flag_names, flags_items[f], &pnfft_flags[f]) ){
+      pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Unknown flags '%s'.\n", flags_items[f]);
+      MPI_Finalize();
+      return 1;
+    }
+
+  if(myrank == 0){
+    file = (out == NULL) ? stdout : fopen(out, "w");
+    if(file == NULL)
+      fprintf(stderr, "Error: Can not open '%s', writing to stdout.\n", out);
+    file = (file == NULL) ? stdout : file;
+    if(format == BENCH_CSV)
+      write_run(file, BENCH_CSV_HEADER, NULL);
+  }
+
+  /* without scaling all processes run at once, otherwise 1, 2, 4, ... processes */
+  for(int procs = (scaling == BENCH_SCALING_NONE) ? size : 1; procs <= size; procs *= 2){
+    MPI_Comm comm_procs;
+    int grow = 0;
+
+    MPI_Comm_split(MPI_COMM_WORLD, (myrank < procs) ? 0 : MPI_UNDEFINED, myrank, &comm_procs);
+
+    /* weak scaling doubles one axis of N whenever the number of processes doubles */
+    if(scaling == BENCH_SCALING_WEAK)
+      for(int p=1; p<procs; p*=2)
+        grow++;
+
+    for(int s=0; s<=N_steps && comm_procs != MPI_COMM_NULL; s++)
+      for(int is=0; is<num_sigma; is++)
+        for(int im=0; im<num_m; im++)
+          for(int w=0; w<num_window; w++)
+            for(int f=0; f<num_flags; f++){
+              bench_run run;
+
+              run.procs = procs;
+              run.repetitions = repetitions;
+              run.samples = samples;
+              run.sigma = strtod(sigma_items[is], NULL);
+              run.m = atoi(m_items[im]);
+              run.window = window_items[w];
+              run.flags = flags_items[f];
+              for(int t=0; t<3; t++)
+                run.N[t] = N_base[t] << s;
+              for(int g=0; g<grow; g++)
+                run.N[g%3] *= 2;
+              for(int t=0; t<3; t++)
+                run.n[t] = 2 * (ptrdiff_t) ceil(run.sigma * run.N[t] / 2.0);
+
+              /* one node per Fourier coefficient by default, strong scaling divides the nodes */
+              run.local_M = (local_M == 0) ? run.N[0]*run.N[1]*run.N[2] / procs : local_M;
+              if(scaling == BENCH_SCALING_STRONG && local_M != 0)
+                run.local_M = local_M / procs;
+
+              if( run_one(comm_procs, &run, window_flags[w] | pnfft_flags[f]) )
+                continue;
+              if(myrank == 0){
+                write_run(file, format, &run);
+                fflush(file);
+              }
+            }
+
+    if(comm_procs != MPI_COMM_NULL)
+      MPI_Comm_free(&comm_procs);
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+
+  if(myrank == 0 && file != stdout)
+    fclose(file);
+
+  BX(cleanup)();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *N_steps,
+    int *repetitions, ptrdiff_t *samples,
+    int *scaling, int *format, const char **out,
+    const char **sigma_list, const char **m_list,
+    const char **window_list, const char **flags_list
+    )
+{
+  const char *str;
+
+  BX(get_args)(argc, argv, "-pnfft_N", 3, PNFFT_PTRDIFF_T, N);
+  BX(get_args)(argc, argv, "-pnfft_local_M", 1, PNFFT_PTRDIFF_T, local_M);
+  BX(get_args)(argc, argv, "-bench_N_steps", 1, PNFFT_INT, N_steps);
+  BX(get_args)(argc, argv, "-bench_repetitions", 1, PNFFT_INT, repetitions);
+  BX(get_args)(argc, argv, "-bench_samples", 1, PNFFT_PTRDIFF_T, samples);
+
+  *sigma_list  = get_string(argc, argv, "-bench_sigma", "2.0");
+  *m_list      = get_string(argc, argv, "-bench_m", "6");
+  *window_list = get_string(argc, argv, "-bench_window", "kaiser_bessel");
+  *flags_list  = get_string(argc, argv, "-bench_flags", "pre_phi_hat+pre_psi");
+  *out         = get_string(argc, argv, "-bench_out", NULL);
+
+  str = get_string(argc, argv, "-bench_scaling", "none");
+  *scaling = !strcmp(str, "strong") ? BENCH_SCALING_STRONG
+           : !strcmp(str, "weak")   ? BENCH_SCALING_WEAK : BENCH_SCALING_NONE;
+
+  str = get_string(argc, argv, "-bench_format", "csv");
+  *format = !strcmp(str, "json") ? BENCH_JSON : BENCH_CSV;
+}
+
+
+static const char *get_string(
+    int argc, char **argv, const char *name, const char *def
+    )
+{
+  for(int k=1; k<argc-1; k++)
+    if( !strcmp(argv[k], name) )
+      return argv[k+1];
+
+  return def;
+}
+
+
+static int split_list(
+    const char *list, char delim,
+    char items[BENCH_MAX_LIST][BENCH_MAX_NAME]
+    )
+{
+  int num = 0;
+
+  while(num < BENCH_MAX_LIST){
+    const char *end = strchr(list, delim);
+    size_t len = (end == NULL) ? strlen(list) : (size_t) (end - list);
+
+    if(len >= BENCH_MAX_NAME)
+      len = BENCH_MAX_NAME - 1;
+    memcpy(items[num], list, len);
+    items[num++][len] = '\0';
+
+    if(end == NULL)
+      break;
+    list = end + 1;
+  }
+
+  return num;
+}
+
+
+/* or all flags of a '+' separated combination, returns 1 for unknown names */
+static int lookup_flags(
+    const bench_flag *table, const char *combination,
+    unsigned *flags
+    )
+{
+  int num;
+  char names[BENCH_MAX_LIST][BENCH_MAX_NAME];
+
+  *flags = 0;
+  num = split_list(combination, '+', names);
+  for(int k=0; k<num; k++){
+    int found = 0;
+    for(const bench_flag *e = table; e->name != NULL; e++)
+      if( !strcmp(e->name, names[k]) ){
+        *flags |= e->flag;
+        found = 1;
+      }
+    if(!found)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/* Plan, time and check one run on all processes of 'comm'. Returns 1 if the procmesh does not fit. */
+static int run_one(
+    MPI_Comm comm, bench_run *run, unsigned pnfft_flags
+    )
+{
+  int procs;
+  long long local_M, M_total;
+  ptrdiff_t local_N[3], local_N_start[3], local_S, local_N_total;
+  R x_max[3] = {0.5, 0.5, 0.5}, lower_border[3], upper_border[3];
+  double local_err = 0, local_sum = 0, err, f_hat_sum, time_plan;
+  MPI_Comm comm_cart_3d;
+  BX(plan) pnfft, direct;
+  C *f_hat, *f, *f_direct;
+  R *x, *x_direct;
+
+  MPI_Comm_size(comm, &procs);
+  run->np[0] = run->np[1] = run->np[2] = 0;
+  MPI_Dims_create(procs, 3, run->np);
+
+  if( BX(create_procmesh)(3, comm, run->np, &comm_cart_3d) )
+    return 1;
+
+  BX(local_size_guru)(3, run->N, run->n, x_max, run->m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+
+  time_plan = -MPI_Wtime();
+  pnfft = BX(init_guru)(3, run->N, run->n, x_max, run->local_M, run->m,
+      pnfft_flags | PNFFT_MALLOC_X | PNFFT_MALLOC_F_HAT | PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+  time_plan += MPI_Wtime();
+  MPI_Allreduce(&time_plan, &run->time_plan, 1, MPI_DOUBLE, MPI_MAX, comm_cart_3d);
+
+  f_hat = BX(get_f_hat)(pnfft);
+  f     = BX(get_f)(pnfft);
+  x     = BX(get_x)(pnfft);
+
+  BX(init_f_hat_3d)(run->N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE, f_hat);
+  BX(init_x_3d)(lower_border, upper_border, run->local_M, x);
+  BX(reset_timer)(pnfft);
+  BX(precompute_psi)(pnfft);
+
+  for(int k=0; k<run->repetitions; k++){
+    MPI_Barrier(comm_cart_3d);
+    BX(trafo)(pnfft);
+    MPI_Barrier(comm_cart_3d);
+    BX(adj)(pnfft);
+  }
+
+  /* time per repetition, averaged and maximized over all processes */
+  for(int phase=0; phase<PNFFT_PROFILE_LENGTH; phase++){
+    double tmin;
+    BX(reduce_profile)(pnfft, phase, comm_cart_3d, &tmin, &run->phase_avg[phase], &run->phase_max[phase]);
+    if(phase != PNFFT_PROFILE_PRECOMPUTE_PSI && run->repetitions > 0){
+      run->phase_avg[phase] /= run->repetitions;
+      run->phase_max[phase] /= run->repetitions;
+    }
+  }
+  run->error_estimate = (double) BX(get_error_estimate)(pnfft);
+  local_M = (long long) run->local_M;
+  MPI_Allreduce(&local_M, &M_total, 1, MPI_LONG_LONG, MPI_SUM, comm_cart_3d);
+  run->M_total = (ptrdiff_t) M_total;
+
+  /* adj has overwritten f_hat, recompute f from the original coefficients */
+  BX(init_f_hat_3d)(run->N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE, f_hat);
+  BX(trafo)(pnfft);
+
+  /* direct NDFT on the first nodes of every process */
+  local_S = (run->samples < run->local_M) ? run->samples : run->local_M;
+  direct = BX(init_guru)(3, run->N, run->n, x_max, local_S, run->m,
+      PNFFT_MALLOC_X | PNFFT_MALLOC_F_HAT | PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+  x_direct = BX(get_x)(direct);
+  f_direct = BX(get_f)(direct);
+  BX(init_f_hat_3d)(run->N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE, BX(get_f_hat)(direct));
+  for(ptrdiff_t j=0; j<3*local_S; j++)
+    x_direct[j] = x[j];
+  BX(direct_trafo)(direct);
+
+  for(ptrdiff_t j=0; j<local_S; j++)
+    if( (double) cabsl(f[j] - f_direct[j]) > local_err )
+      local_err = (double) cabsl(f[j] - f_direct[j]);
+  for(ptrdiff_t k=0; k<local_N_total; k++)
+    local_sum += (double) cabsl(f_hat[k]);
+
+  MPI_Allreduce(&local_err, &err, 1, MPI_DOUBLE, MPI_MAX, comm_cart_3d);
+  MPI_Allreduce(&local_sum, &f_hat_sum, 1, MPI_DOUBLE, MPI_SUM, comm_cart_3d);
+  run->error_abs = err;
+  run->error_rel = (f_hat_sum > 0) ? err / f_hat_sum : 0;
+
+  BX(finalize)(direct, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  BX(finalize)(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+  return 0;
+}
+
+
+/* The same sequence of fields gives the CSV header, a CSV line or a JSON line. */
+static void write_run(
+    FILE *file, int mode, const bench_run *run
+    )
+{
+  int first = 1;
+  const bench_run empty = {0};
+  char name[BENCH_MAX_NAME];
+
+  if(run == NULL)
+    run = &empty;
+
+  if(mode == BENCH_JSON)
+    fputc('{', file);
+
+  put_field(file, mode, &first, "precision", 1, "%s", BENCH_PRECISION);
+  put_field(file, mode, &first, "procs", 0, "%d", run->procs);
+  for(int t=0; t<3; t++){
+    snprintf(name, BENCH_MAX_NAME, "np%d", t);
+    put_field(file, mode, &first, name, 0, "%d", run->np[t]);
+  }
+  for(int t=0; t<3; t++){
+    snprintf(name, BENCH_MAX_NAME, "N%d", t);
+    put_field(file, mode, &first, name, 0, "%td", run->N[t]);
+  }
+  for(int t=0; t<3; t++){
+    snprintf(name, BENCH_MAX_NAME, "n%d", t);
+    put_field(file, mode, &first, name, 0, "%td", run->n[t]);
+  }
+  put_field(file, mode, &first, "sigma", 0, "%g", run->sigma);
+  put_field(file, mode, &first, "m", 0, "%d", run->m);
+  put_field(file, mode, &first, "window", 1, "%s", run->window);
+  put_field(file, mode, &first, "flags", 1, "%s", run->flags);
+  put_field(file, mode, &first, "local_M", 0, "%td", run->local_M);
+  put_field(file, mode, &first, "M_total", 0, "%td", run->M_total);
+  put_field(file, mode, &first, "repetitions", 0, "%d", run->repetitions);
+  put_field(file, mode, &first, "samples", 0, "%td", run->samples);
+  put_field(file, mode, &first, "error_estimate", 0, "%.3e", run->error_estimate);
+  put_field(file, mode, &first, "error_abs", 0, "%.3e", run->error_abs);
+  put_field(file, mode, &first, "error_rel", 0, "%.3e", run->error_rel);
+  put_field(file, mode, &first, "time_plan", 0, "%.4e", run->time_plan);
+
+  /* phase names with underscores, the iteration counters are no phases */
+  for(int phase=0; phase<PNFFT_PROFILE_LENGTH; phase++){
+    if(phase % PNFFT_TIMER_LENGTH == PNFFT_TIMER_ITER && phase != PNFFT_PROFILE_PRECOMPUTE_PSI)
+      continue;
+    for(int stat=0; stat<2; stat++){
+      snprintf(name, BENCH_MAX_NAME, "%s_%s", stat ? "max" : "avg", BX(get_profile_name)(phase));
+      for(char *c=name; *c!='\0'; c++)
+        if(*c == ' ')
+          *c = '_';
+      put_field(file, mode, &first, name, 0, "%.4e", stat ? run->phase_max[phase] : run->phase_avg[phase]);
+    }
+  }
+
+  fputs((mode == BENCH_JSON) ? "}\n" : "\n", file);
+}
+
+
+static void put_field(
+    FILE *file, int mode, int *first, const char *name, int quote,
+    const char *fmt, ...
+    )
+{
+  va_list ap;
+
+  if(!*first)
+    fputs((mode == BENCH_JSON) ? ", " : ",", file);
+  *first = 0;
+
+  if(mode == BENCH_CSV_HEADER){
+    fputs(name, file);
+    return;
+  }
+
+  if(mode == BENCH_JSON)
+    fprintf(file, "\"%s\": %s", name, quote ? "\"" : "");
+
+  va_start(ap, fmt);
+  vfprintf(file, fmt, ap);
+  va_end(ap);
+
+  if(mode == BENCH_JSON && quote)
+    fputc('"', file);
+}
+
@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Single rank microbenchmarks of the kernels behind the end-to-end timers. Every kernel family
+ * runs on the same nodes and reports one CSV line per configuration with ns per node, GB/s and
+ * GFLOP/s of a simple traffic and operation count model, and the fraction of the roofline
+ * min(peak_gflops, intensity * peak_gbs) given by -bench_peak_gflops and -bench_peak_gbs.
+ *
+ *   -bench_kernels      list  spread, assign (pre_psi tensors on a ghost cell grid),
+ *                             window (PNX(precompute_psi) with PNFFT_PRE_PSI), sort (radix lsdf)
+ *   -bench_m            list  window cutoffs, the stencil has 2m+1 points per axis
+ *   -bench_window       list  kaiser_bessel, gaussian, bspline, sinc_power, bessel_i0, es
+ *   -bench_psi          list  direct, fg_psi, pre_lin_psi, pre_cub_psi, pre_poly_psi
+ *   -bench_distribution list  uniform, clustered, sorted (uniform nodes in grid order)
+ *   -bench_nodes, -bench_n, -bench_repetitions
+ * The precision is the one of the library. */
+
+#include <string.h>
+#include <math.h>
+#include "pnfft.h"
+#include "ipnfft.h"
+
+#if defined(PNFFT_PREC_SINGLE)
+# define BENCH_PRECISION "float"
+#elif defined(PNFFT_PREC_LDOUBLE)
+# define BENCH_PRECISION "ldouble"
+#else
+# define BENCH_PRECISION "double"
+#endif
+
+#define BENCH_MAX_LIST 16
+#define BENCH_MAX_NAME 64
+
+/* cluster centers of the clustered distribution and their width */
+#define BENCH_NUM_CLUSTERS 8
+#define BENCH_CLUSTER_WIDTH 0.02
+
+typedef struct{
+  const char *name;
+  unsigned flag;
+} bench_flag;
+
+static const bench_flag window_names[] = {
+  {"kaiser_bessel", PNFFT_WINDOW_KAISER_BESSEL}, {"gaussian", PNFFT_WINDOW_GAUSSIAN},
+  {"bspline", PNFFT_WINDOW_BSPLINE}, {"sinc_power", PNFFT_WINDOW_SINC_POWER},
+  {"bessel_i0", PNFFT_WINDOW_BESSEL_I0}, {"es", PNFFT_WINDOW_ES}, {NULL, 0}
+};
+
+static const bench_flag psi_names[] = {
+  {"direct", 0}, {"fg_psi", PNFFT_FG_PSI},
+  {"pre_lin_psi", PNFFT_PRE_LIN_PSI}, {"pre_cub_psi", PNFFT_PRE_CUB_PSI},
+  {"pre_poly_psi", PNFFT_PRE_POLY_PSI}, {NULL, 0}
+};
+
+typedef struct{
+  INT M, n;
+  int repetitions;
+  double peak_gflops, peak_gbs;
+  const char *distribution;
+} bench_setup;
+
+static const char *get_string(
+    int argc, char **argv, const char *name, const char *def);
+static int split_list(
+    const char *list, char delim,
+    char items[BENCH_MAX_LIST][BENCH_MAX_NAME]);
+static int lookup_flag(
+    const bench_flag *table, const char *name,
+    unsigned *flag);
+static int contains(
+    char items[BENCH_MAX_LIST][BENCH_MAX_NAME], int num, const char *name);
+static R random_number(
+    unsigned *seed);
+static void init_nodes(
+    const char *distribution, INT M, INT n,
+    R *x);
+static void cell_keys(
+    INT M, INT n, const R *x,
+    INT *keys);
+static INT key_high_bit(
+    INT n);
+static void report(
+    const bench_setup *setup, const char *kernel, const char *variant, int m,
+    double time, double flops, double bytes);
+static void bench_spread_assign(
+    const bench_setup *setup, int m, const R *x);
+static void bench_window(
+    const bench_setup *setup, int m, const char *window, unsigned window_flag,
+    const char *psi, unsigned psi_flag, const R *x);
+static void bench_sort(
+    const bench_setup *setup, const R *x);
+
+
+int main(int argc, char **argv)
+{
+  int num_kernels, num_m, num_window, num_psi, num_dist;
+  char kernels[BENCH_MAX_LIST][BENCH_MAX_NAME], m_items[BENCH_MAX_LIST][BENCH_MAX_NAME];
+  char windows[BENCH_MAX_LIST][BENCH_MAX_NAME], psis[BENCH_MAX_LIST][BENCH_MAX_NAME];
+  char dists[BENCH_MAX_LIST][BENCH_MAX_NAME];
+  bench_setup setup;
+  R *x;
+
+  MPI_Init(&argc, &argv);
+  PNX(init)();
+
+  /* set default values */
+  setup.M = 100000;
+  setup.n = 64;
+  setup.repetitions = 5;
+  setup.peak_gflops = setup.peak_gbs = 0;
+
+  /* set parameters by command line */
+  PNX(get_args)(argc, argv, "-bench_nodes", 1, PNFFT_PTRDIFF_T, &setup.M);
+  PNX(get_args)(argc, argv, "-bench_n", 1, PNFFT_PTRDIFF_T, &setup.n);
+  PNX(get_args)(argc, argv, "-bench_repetitions", 1, PNFFT_INT, &setup.repetitions);
+  PNX(get_args)(argc, argv, "-bench_peak_gflops", 1, PNFFT_DOUBLE, &setup.peak_gflops);
+  PNX(get_args)(argc, argv, "-bench_peak_gbs", 1, PNFFT_DOUBLE, &setup.peak_gbs);
+  num_kernels = split_list(get_string(argc, argv, "-bench_kernels", "spread,assign,window,sort"), ',', kernels);
+  num_m       = split_list(get_string(argc, argv, "-bench_m", "2,4,6,8"), ',', m_items);
+  num_window  = split_list(get_string(argc, argv, "-bench_window", "kaiser_bessel,gaussian,bspline,sinc_power,bessel_i0,es"), ',', windows);
+  num_psi     = split_list(get_string(argc, argv, "-bench_psi", "direct,pre_lin_psi,pre_cub_psi"), ',', psis);
+  num_dist    = split_list(get_string(argc, argv, "-bench_distribution", "uniform,clustered,sorted"), ',', dists);
+
+  x = PNX(malloc_R)((size_t) (3 * setup.M));
+
+  printf("kernel,precision,variant,distribution,m,cutoff,nodes,time,ns_per_node,gbs,gflops,intensity,roofline_gflops,roofline_fraction\n");
+  for(int d=0; d<num_dist; d++){
+    setup.distribution = dists[d];
+    init_nodes(dists[d], setup.M, setup.n, x);
+
+    for(int im=0; im<num_m; im++){
+      int m = atoi(m_items[im]);
+
+      if(contains(kernels, num_kernels, "spread") || contains(kernels, num_kernels, "assign"))
+        bench_spread_assign(&setup, m, x);
+
+      if(contains(kernels, num_kernels, "window"))
+        for(int w=0; w<num_window; w++)
+          for(int p=0; p<num_psi; p++){
+            unsigned window_flag, psi_flag;
+            if(lookup_flag(window_names, windows[w], &window_flag) || lookup_flag(psi_names, psis[p], &psi_flag))
+              continue;
+            /* the fast Gaussian gridding exists for the Gaussian only */
+            if((psi_flag & PNFFT_FG_PSI) && !(window_flag & PNFFT_WINDOW_GAUSSIAN))
+              continue;
+            bench_window(&setup, m, windows[w], window_flag, psis[p], psi_flag, x);
+          }
+    }
+
+    if(contains(kernels, num_kernels, "sort"))
+      bench_sort(&setup, x);
+  }
+
+  PNX(free)(x);
+  PNX(cleanup)();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static const char *get_string(
+    int argc, char **argv, const char *name, const char *def
+    )
+{
+  for(int k=1; k<argc-1; k++)
+    if( !strcmp(argv[k], name) )
+      return argv[k+1];
+
+  return def;
+}
+
+
+static int split_list(
+    const char *list, char delim,
+    char items[BENCH_MAX_LIST][BENCH_MAX_NAME]
+    )
+{
+  int num = 0;
+
+  while(num < BENCH_MAX_LIST){
+    const char *end = strchr(list, delim);
+    size_t len = (end == NULL) ? strlen(list) : (size_t) (end - list);
+
+    if(len >= BENCH_MAX_NAME)
+      len = BENCH_MAX_NAME - 1;
+    memcpy(items[num], list, len);
+    items[num++][len] = '\0';
+
+    if(end == NULL)
+      break;
+    list = end + 1;
+  }
+
+  return num;
+}
+
+
+/* returns 1 for unknown names */
+static int lookup_flag(
+    const bench_flag *table, const char *name,
+    unsigned *flag
+    )
+{
+  for(const bench_flag *e = table; e->name != NULL; e++)
+    if( !strcmp(e->name, name) ){
+      *flag = e->flag;
+      return 0;
+    }
+
+  fprintf(stderr, "Warning: Unknown name '%s' is skipped.\n", name);
+  return 1;
+}
+
+
+static int contains(
+    char items[BENCH_MAX_LIST][BENCH_MAX_NAME], int num, const char *name
+    )
+{
+  for(int k=0; k<num; k++)
+    if( !strcmp(items[k], name) )
+      return 1;
+
+  return 0;
+}
+
+
+/* reproducible numbers in [0,1) independent of the C library */
+static R random_number(
+    unsigned *seed
+    )
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return (R) ((*seed >> 8) & 0xffffff) / (R) 0x1000000;
+}
+
+
+/* nodes in [-0.5,0.5)^3, 'sorted' are the uniform nodes in the order of their grid cells */
+static void init_nodes(
+    const char *distribution, INT M, INT n,
+    R *x
+    )
+{
+  unsigned seed = 1;
+  R center[BENCH_NUM_CLUSTERS][3];
+
+  for(int c=0; c<BENCH_NUM_CLUSTERS; c++)
+    for(int t=0; t<3; t++)
+      center[c][t] = random_number(&seed) - 0.5;
+
+  for(INT j=0; j<M; j++){
+    int c = (int) (random_number(&seed) * BENCH_NUM_CLUSTERS);
+    for(int t=0; t<3; t++){
+      R v = random_number(&seed) - 0.5;
+      if( !strcmp(distribution, "clustered") ){
+        v = center[c][t] + BENCH_CLUSTER_WIDTH * (v + random_number(&seed) - 0.5);
+        v -= pnfft_floor(v + 0.5);
+      }
+      x[3*j+t] = v;
+    }
+  }
+
+  if( !strcmp(distribution, "sorted") ){
+    INT *keys = PNX(malloc_INT)((size_t) (4*M));
+    R *tmp = PNX(malloc_R)((size_t) (3*M));
+
+    cell_keys(M, n, x, keys);
+    PNX(sort_node_indices_radix_lsdf)(M, keys, keys + 2*M, key_high_bit(n));
+    for(INT j=0; j<M; j++)
+      for(int t=0; t<3; t++)
+        tmp[3*j+t] = x[3*keys[2*j+1]+t];
+    memcpy(x, tmp, sizeof(R) * (size_t) (3*M));
+
+    PNX(free)(tmp); PNX(free)(keys);
+  }
+}
+
+
+/* pairs of grid cell index and node index, as sorted by PNFFT_SORT_NODES */
+static void cell_keys(
+    INT M, INT n, const R *x,
+    INT *keys
+    )
+{
+  for(INT j=0; j<M; j++){
+    INT u[3];
+    for(int t=0; t<3; t++){
+      u[t] = (INT) pnfft_floor(n * (x[3*j+t] + 0.5));
+      u[t] = (u[t] % n + n) % n;
+    }
+    keys[2*j]   = (u[0]*n + u[1])*n + u[2];
+    keys[2*j+1] = j;
+  }
+}
+
+
+static INT key_high_bit(
+    INT n
+    )
+{
+  INT bits = 0;
+
+  while( ((INT) 1 << bits) < n*n*n )
+    bits++;
+
+  return bits - 1;
+}
+
+
+static void report(
+    const bench_setup *setup, const char *kernel, const char *variant, int m,
+    double time, double flops, double bytes
+    )
+{
+  double intensity = (bytes > 0) ? flops / bytes : 0;
+  double gflops = flops / time * 1e-9, gbs = bytes / time * 1e-9;
+  double roofline = 0, fraction = 0;
+
+  /* memory bound kernels without operation count are compared against the bandwidth */
+  if(setup->peak_gbs > 0 && flops == 0)
+    fraction = gbs / setup->peak_gbs;
+  else if(setup->peak_gbs > 0 && setup->peak_gflops > 0){
+    roofline = intensity * setup->peak_gbs;
+    if(roofline > setup->peak_gflops)
+      roofline = setup->peak_gflops;
+    fraction = gflops / roofline;
+  }
+
+  printf("%s,%s,%s,%s,%d,%d,%td,%.4e,%.2f,%.2f,%.2f,%.3f,%.2f,%.3f\n",
+      kernel, BENCH_PRECISION, variant, setup->distribution, m, 2*m+1, setup->M,
+      time, time / (double) setup->M * 1e9, gbs, gflops, intensity, roofline, fraction);
+  fflush(stdout);
+}
+
+
+/* PNX(spread_f_c2c_pre_psi) and PNX(assign_f_c2c_pre_psi) on a grid with ghost cells */
+static void bench_spread_assign(
+    const bench_setup *setup, int m, const R *x
+    )
+{
+  const int cutoff = 2*m+1;
+  const INT M = setup->M, n = setup->n;
+  const double c3 = (double) cutoff * cutoff * cutoff;
+  INT grid_size[3], grid_total, *m0;
+  double time_spread = 0, time_assign = 0, flops, bytes;
+  unsigned seed = 2;
+  R *pre_psi;
+  C *grid, *f;
+
+  for(int t=0; t<3; t++)
+    grid_size[t] = n + cutoff;
+  grid_total = grid_size[0] * grid_size[1] * grid_size[2];
+
+  grid    = PNX(malloc_C)((size_t) grid_total);
+  f       = PNX(malloc_C)((size_t) M);
+  pre_psi = PNX(malloc_R)((size_t) (3*cutoff*M));
+  m0      = PNX(malloc_INT)((size_t) M);
+
+  /* lowest stencil point of every node, the window values only have to be positive */
+  for(INT j=0; j<M; j++){
+    INT u[3];
+    for(int t=0; t<3; t++)
+      u[t] = (INT) pnfft_floor(n * (x[3*j+t] + 0.5));
+    m0[j] = (u[0]*grid_size[1] + u[1])*grid_size[2] + u[2];
+    f[j] = random_number(&seed) + I * random_number(&seed);
+  }
+  for(INT k=0; k<3*cutoff*M; k++)
+    pre_psi[k] = random_number(&seed);
+  memset(grid, 0, sizeof(C) * (size_t) grid_total);
+
+  for(int r=0; r<setup->repetitions; r++){
+    double time = -MPI_Wtime();
+    for(INT j=0; j<M; j++)
+      PNX(spread_f_c2c_pre_psi)(f[j], pre_psi + 3*cutoff*j, m0[j], grid_size, cutoff, grid);
+    time += MPI_Wtime();
+    time_spread += time;
+
+    time = -MPI_Wtime();
+    for(INT j=0; j<M; j++)
+      PNX(assign_f_c2c_pre_psi)(grid, pre_psi + 3*cutoff*j, m0[j], grid_size, cutoff, f + j);
+    time += MPI_Wtime();
+    time_assign += time;
+  }
+
+  /* per stencil point one real product and a complex multiply-add, the grid is read and written */
+  flops = (double) M * (5 * c3 + (double) cutoff * cutoff);
+  bytes = (double) M * (2 * c3 * sizeof(C) + 3 * cutoff * sizeof(R) + sizeof(C) + sizeof(INT));
+  report(setup, "spread", "c2c_pre_psi", m, time_spread / setup->repetitions, flops, bytes);
+
+  bytes = (double) M * (c3 * sizeof(C) + 3 * cutoff * sizeof(R) + sizeof(C) + sizeof(INT));
+  report(setup, "assign", "c2c_pre_psi", m, time_assign / setup->repetitions, flops, bytes);
+
+  PNX(free)(m0); PNX(free)(pre_psi); PNX(free)(f); PNX(free)(grid);
+}
+
+
+/* one plan per window, PNX(precompute_psi) evaluates all window tensors of the nodes */
+static void bench_window(
+    const bench_setup *setup, int m, const char *window, unsigned window_flag,
+    const char *psi, unsigned psi_flag, const R *x
+    )
+{
+  const int cutoff = 2*m+1;
+  int np[3] = {1, 1, 1};
+  INT N[3], n[3];
+  R x_max[3] = {0.5, 0.5, 0.5};
+  double time = 0, bytes;
+  char variant[2*BENCH_MAX_NAME];
+  MPI_Comm comm_cart_3d;
+  PNX(plan) ths;
+
+  for(int t=0; t<3; t++){
+    n[t] = setup->n;
+    N[t] = setup->n / 2;
+  }
+
+  if( PNX(create_procmesh)(3, MPI_COMM_SELF, np, &comm_cart_3d) )
+    return;
+
+  ths = PNX(init_guru)(3, N, n, x_max, setup->M, m,
+      window_flag | psi_flag | PNFFT_PRE_PSI | PNFFT_MALLOC_X, PFFT_ESTIMATE,
+      comm_cart_3d);
+  memcpy(PNX(get_x)(ths), x, sizeof(R) * (size_t) (3*setup->M));
+
+  for(int r=0; r<setup->repetitions; r++){
+    time -= MPI_Wtime();
+    PNX(precompute_psi)(ths);
+    time += MPI_Wtime();
+  }
+
+  /* the operation count differs from window to window, only the traffic is modeled */
+  bytes = (double) setup->M * (3 * sizeof(R) + 3 * cutoff * sizeof(R));
+  snprintf(variant, sizeof(variant), "%s+%s", window, psi);
+  report(setup, "window", variant, m, time / setup->repetitions, 0, bytes);
+
+  PNX(finalize)(ths, PNFFT_FREE_X);
+  MPI_Comm_free(&comm_cart_3d);
+}
+
+
+/* PNX(sort_node_indices_radix_lsdf) on the grid cell keys of PNFFT_SORT_NODES */
+static void bench_sort(
+    const bench_setup *setup, const R *x
+    )
+{
+  const INT M = setup->M, rhigh = key_high_bit(setup->n);
+  const int passes = (int) (rhigh / 9 + 1);
+  INT *keys = PNX(malloc_INT)((size_t) (4*M));
+  double time = 0, bytes;
+
+  for(int r=0; r<setup->repetitions; r++){
+    cell_keys(M, setup->n, x, keys);
+    time -= MPI_Wtime();
+    PNX(sort_node_indices_radix_lsdf)(M, keys, keys + 2*M, rhigh);
+    time += MPI_Wtime();
+  }
+
+  /* every pass of 9 bits reads and writes all pairs of key and index */
+  bytes = (double) M * passes * 2 * 2 * sizeof(INT);
+  report(setup, "sort", "radix_lsdf", 0, time / setup->repetitions, 0, bytes);
+
+  PNX(free)(keys);
+}
@@ -22,6 +22,101 @@
 #include "pnfft.h"
 #include "ipnfft.h"
 
+/* window tensor of node ind for PNFFT_PRE_FULL_PSI, blocked plans pass the tensor of the current block */
+#define FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff) \
+  ( PNFFT_PRE_PSI_BLOCKED(ths) ? (pre_psi) : (plan_pre_psi) + (ind)*PNFFT_POW3(cutoff) )
+#define FULL_DPSI(ths, plan_pre_dpsi, pre_dpsi, ind, cutoff) \
+  ( PNFFT_PRE_PSI_BLOCKED(ths) ? (pre_dpsi) : (plan_pre_dpsi) + 3*(ind)*PNFFT_POW3(cutoff) )
+/* window values of node ind for PNFFT_PRE_PSI, float tables are converted into the buffer */
+#define NODE_PSI(ths, plan_pre_psi, ind, cutoff, buffer) \
+  ( PNFFT_PRE_PSI_SINGLE(ths) ? unpack_pre_psi(plan_pre_psi, ind, cutoff, buffer) : (plan_pre_psi) + (ind)*3*(cutoff) )
+
+static inline R* unpack_pre_psi(
+    const R *plan_pre_psi, INT ind, int cutoff, R *buffer);
+static inline void spread_f_c2c_pre_psi_generic(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+static inline void spread_f_r2r_pre_psi_generic(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid);
+static inline void assign_f_c2c_pre_psi_generic(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+static inline void assign_f_r2r_pre_psi_generic(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv);
+static void spread_f_c2c_single_pre_psi(
+    C f, const R *pre_psi, INT m0, const INT *grid_size, int cutoff,
+    CS *grid);
+static inline R pruning_threshold(
+    const R *pre_psi, int cutoff);
+static inline void pruned_row(
+    R psi_xy, const R *pre_psi_z, int cutoff, R threshold,
+    int *lo, int *hi);
+static inline void spread_f_c2c_pre_psi_pruned_generic(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+static inline void spread_f_r2r_pre_psi_pruned_generic(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid);
+static inline void assign_f_c2c_pre_psi_pruned_generic(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+static inline void assign_f_r2r_pre_psi_pruned_generic(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv);
+static void spread_f_c2c_pre_psi_pruned(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+static void spread_f_r2r_pre_psi_pruned(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid);
+static void assign_f_c2c_pre_psi_pruned(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+static void assign_f_r2r_pre_psi_pruned(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv);
+static void assign_f_c2c_single_pre_psi(
+    const CS *grid, const R *pre_psi, INT m0, const INT *grid_size, int cutoff,
+    C *fv);
+static void spread_f_c2c_pre_psi_2d(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+static void spread_f_r2r_pre_psi_2d(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid);
+static void assign_f_c2c_pre_psi_2d(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+static void assign_f_r2r_pre_psi_2d(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv);
+static void spread_f_c2c_pre_psi_1d(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+static void spread_f_r2r_pre_psi_1d(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid);
+static void assign_f_c2c_pre_psi_1d(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+static void assign_f_r2r_pre_psi_1d(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv);
+
+
+/* tables of PNX(set_pre_psi_single) hold float, the kernels take the values of one node in R */
+static inline R* unpack_pre_psi(
+    const R *plan_pre_psi, INT ind, int cutoff, R *buffer
+    )
+{
+  const float *single = (const float*) plan_pre_psi + ind*3*cutoff;
+
+  for(int l=0; l<3*cutoff; l++)
+    buffer[l] = single[l];
+  return buffer;
+}
 
 void PNX(spread_f_c2c)(
     PNX(plan) ths, INT ind,
@@ -30,21 +125,70 @@ void PNX(spread_f_c2c)(
     )
 {
   R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(spread_f_c2c_pre_full_psi)(
-        f, plan_pre_psi + ind*PNFFT_POW3(cutoff), m0, grid_size, cutoff, 
+        f, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff, 
         grid);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
-    PNX(spread_f_c2c_pre_psi)(
-        f, plan_pre_psi + ind*3*cutoff, m0, grid_size, cutoff, 
+    ths->spread_f_c2c_kernel(
+        f, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff, 
         grid);
   else
-    PNX(spread_f_c2c_pre_psi)(
+    ths->spread_f_c2c_kernel(
         f, pre_psi, m0, grid_size, cutoff, 
         grid);
 }
 
+/* Spread the values of howmany interleaved fields of one node at once. */
+void PNX(spread_f_c2c_many)(
+    PNX(plan) ths, INT ind,
+    const C *f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT howmany, int interlaced,
+    C *grid
+    )
+{
+  R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
+
+  if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
+    PNX(spread_f_c2c_many_pre_full_psi)(
+        f, howmany, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff,
+        grid);
+  else if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    PNX(spread_f_c2c_many_pre_psi)(
+        f, howmany, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff,
+        grid);
+  else
+    PNX(spread_f_c2c_many_pre_psi)(
+        f, howmany, pre_psi, m0, grid_size, cutoff,
+        grid);
+}
+
+/* Spread onto one field of an interleaved grid, m0 is given in units of grid points times ostride. */
+void PNX(spread_f_c2c_strided)(
+    PNX(plan) ths, INT ind,
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride, int interlaced,
+    C *grid
+    )
+{
+  R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
+
+  if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
+    PNX(spread_f_c2c_strided_pre_full_psi)(
+        f, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff, ostride,
+        grid);
+  else if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    PNX(spread_f_c2c_strided_pre_psi)(
+        f, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff, ostride,
+        grid);
+  else
+    PNX(spread_f_c2c_strided_pre_psi)(
+        f, pre_psi, m0, grid_size, cutoff, ostride,
+        grid);
+}
+
 void PNX(spread_f_r2r)(
     PNX(plan) ths, INT ind,
     R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride, int interlaced,
@@ -52,21 +196,40 @@ void PNX(spread_f_r2r)(
     )
 {
   R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(spread_f_r2r_pre_full_psi)(
-        f, plan_pre_psi + ind*PNFFT_POW3(cutoff), m0, grid_size, cutoff, ostride,
+        f, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff, ostride,
         grid);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
-    PNX(spread_f_r2r_pre_psi)(
-        f, plan_pre_psi + ind*3*cutoff, m0, grid_size, cutoff, ostride,
+    ths->spread_f_r2r_kernel(
+        f, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff, ostride,
         grid);
   else
-    PNX(spread_f_r2r_pre_psi)(
+    ths->spread_f_r2r_kernel(
         f, pre_psi, m0, grid_size, cutoff, ostride,
         grid);
 }
 
+/* Spread onto the single precision grid of PNFFT_MIXED_PRECISION. */
+void PNX(spread_f_c2c_single)(
+    PNX(plan) ths, INT ind,
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, int interlaced,
+    CS *grid
+    )
+{
+  R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
+
+  if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    pre_psi = NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer);
+
+  spread_f_c2c_single_pre_psi(
+      f, pre_psi, m0, grid_size, cutoff,
+      grid);
+}
+
 void PNX(assign_f_c2c)(
     PNX(plan) ths, INT ind,
     C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, int interlaced,
@@ -74,21 +237,88 @@ void PNX(assign_f_c2c)(
     )
 {
   R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(assign_f_c2c_pre_full_psi)(
-        grid, plan_pre_psi + ind*PNFFT_POW3(cutoff), m0, grid_size, cutoff,
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff,
         f);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
-    PNX(assign_f_c2c_pre_psi)(
-        grid, plan_pre_psi + ind*3*cutoff, m0, grid_size, cutoff,
+    ths->assign_f_c2c_kernel(
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff,
         f);
   else
-    PNX(assign_f_c2c_pre_psi)(
+    ths->assign_f_c2c_kernel(
         grid, pre_psi, m0, grid_size, cutoff,
         f);
 }
 
+/* Assign from the single precision grid of PNFFT_MIXED_PRECISION. */
+void PNX(assign_f_c2c_single)(
+    PNX(plan) ths, INT ind,
+    const CS *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, int interlaced,
+    C *f
+    )
+{
+  R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
+
+  if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    pre_psi = NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer);
+
+  assign_f_c2c_single_pre_psi(
+      grid, pre_psi, m0, grid_size, cutoff,
+      f);
+}
+
+/* Assign the values of howmany interleaved fields of one node at once. */
+void PNX(assign_f_c2c_many)(
+    PNX(plan) ths, INT ind,
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT howmany, int interlaced,
+    C *f
+    )
+{
+  R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
+
+  if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
+    PNX(assign_f_c2c_many_pre_full_psi)(
+        grid, howmany, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff,
+        f);
+  else if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    PNX(assign_f_c2c_many_pre_psi)(
+        grid, howmany, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff,
+        f);
+  else
+    PNX(assign_f_c2c_many_pre_psi)(
+        grid, howmany, pre_psi, m0, grid_size, cutoff,
+        f);
+}
+
+/* Assign from one field of an interleaved grid, m0 is given in units of grid points times istride. */
+void PNX(assign_f_c2c_strided)(
+    PNX(plan) ths, INT ind,
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride, int interlaced,
+    C *f
+    )
+{
+  R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
+
+  if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
+    PNX(assign_f_c2c_strided_pre_full_psi)(
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff, istride,
+        f);
+  else if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    PNX(assign_f_c2c_strided_pre_psi)(
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff, istride,
+        f);
+  else
+    PNX(assign_f_c2c_strided_pre_psi)(
+        grid, pre_psi, m0, grid_size, cutoff, istride,
+        f);
+}
+
 void PNX(assign_f_r2r)(
     PNX(plan) ths, INT ind,
     R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride, int interlaced,
@@ -96,17 +326,18 @@ void PNX(assign_f_r2r)(
     )
 { 
   R* plan_pre_psi = (interlaced) ? ths->pre_psi_il : ths->pre_psi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(assign_f_r2r_pre_full_psi)(
-        grid, plan_pre_psi + ind*PNFFT_POW3(cutoff), m0, grid_size, cutoff, istride,
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), m0, grid_size, cutoff, istride,
         f);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
-    PNX(assign_f_r2r_pre_psi)(
-        grid, plan_pre_psi + ind*3*cutoff, m0, grid_size, cutoff, istride,
+    ths->assign_f_r2r_kernel(
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), m0, grid_size, cutoff, istride,
         f);
   else
-    PNX(assign_f_r2r_pre_psi)(
+    ths->assign_f_r2r_kernel(
         grid, pre_psi, m0, grid_size, cutoff, istride,
         f);
 }
@@ -119,15 +350,16 @@ void PNX(assign_grad_f_c2c)(
 {
   R* plan_pre_psi  = (interlaced) ? ths->pre_psi_il  : ths->pre_psi;
   R* plan_pre_dpsi = (interlaced) ? ths->pre_dpsi_il : ths->pre_dpsi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF], dpsi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(assign_grad_f_c2c_pre_full_psi)(
-        grid, plan_pre_psi + ind*PNFFT_POW3(cutoff), plan_pre_dpsi + 3*ind*PNFFT_POW3(cutoff),
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), FULL_DPSI(ths, plan_pre_dpsi, pre_dpsi, ind, cutoff),
         m0, grid_size, cutoff,
         grad_f);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
     PNX(assign_grad_f_c2c_pre_psi)(
-        grid, plan_pre_psi + ind*3*cutoff, plan_pre_dpsi + ind*3*cutoff,
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), NODE_PSI(ths, plan_pre_dpsi, ind, cutoff, dpsi_buffer),
         m0, grid_size, cutoff,
         grad_f);
   else
@@ -146,15 +378,16 @@ void PNX(assign_grad_f_r2r)(
 {
   R* plan_pre_psi  = (interlaced) ? ths->pre_psi_il  : ths->pre_psi;
   R* plan_pre_dpsi = (interlaced) ? ths->pre_dpsi_il : ths->pre_dpsi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF], dpsi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(assign_grad_f_r2r_pre_full_psi)(
-        grid, plan_pre_psi + ind*PNFFT_POW3(cutoff), plan_pre_dpsi + 3*ind*PNFFT_POW3(cutoff),
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), FULL_DPSI(ths, plan_pre_dpsi, pre_dpsi, ind, cutoff),
         m0, grid_size, cutoff, istride, ostride,
         grad_f);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
     PNX(assign_grad_f_r2r_pre_psi)(
-        grid, plan_pre_psi + ind*3*cutoff, plan_pre_dpsi + ind*3*cutoff,
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), NODE_PSI(ths, plan_pre_dpsi, ind, cutoff, dpsi_buffer),
         m0, grid_size, cutoff, istride, ostride,
         grad_f);
   else
@@ -172,15 +405,16 @@ void PNX(assign_f_and_grad_f_c2c)(
 { 
   R* plan_pre_psi  = (interlaced) ? ths->pre_psi_il  : ths->pre_psi;
   R* plan_pre_dpsi = (interlaced) ? ths->pre_dpsi_il : ths->pre_dpsi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF], dpsi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(assign_f_and_grad_f_c2c_pre_full_psi)(
-        grid, plan_pre_psi + ind*PNFFT_POW3(cutoff), plan_pre_dpsi + 3*ind*PNFFT_POW3(cutoff),
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), FULL_DPSI(ths, plan_pre_dpsi, pre_dpsi, ind, cutoff),
         m0, grid_size, cutoff,
         f, grad_f);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
     PNX(assign_f_and_grad_f_c2c_pre_psi)(
-        grid, plan_pre_psi + ind*3*cutoff, plan_pre_dpsi + ind*3*cutoff,
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), NODE_PSI(ths, plan_pre_dpsi, ind, cutoff, dpsi_buffer),
         m0, grid_size, cutoff,
         f, grad_f);
   else
@@ -199,15 +433,16 @@ void PNX(assign_f_and_grad_f_r2r)(
 { 
   R* plan_pre_psi  = (interlaced) ? ths->pre_psi_il  : ths->pre_psi;
   R* plan_pre_dpsi = (interlaced) ? ths->pre_dpsi_il : ths->pre_dpsi;
+  R psi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF], dpsi_buffer[3*PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF];
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
     PNX(assign_f_and_grad_f_r2r_pre_full_psi)(
-        grid, plan_pre_psi + ind*PNFFT_POW3(cutoff), plan_pre_dpsi + 3*ind*PNFFT_POW3(cutoff),
+        grid, FULL_PSI(ths, plan_pre_psi, pre_psi, ind, cutoff), FULL_DPSI(ths, plan_pre_dpsi, pre_dpsi, ind, cutoff),
         m0, grid_size, cutoff, istride, ostride,
         f, grad_f);
   else if(ths->pnfft_flags & PNFFT_PRE_PSI)
     PNX(assign_f_and_grad_f_r2r_pre_psi)(
-        grid, plan_pre_psi + ind*3*cutoff, plan_pre_dpsi + ind*3*cutoff,
+        grid, NODE_PSI(ths, plan_pre_psi, ind, cutoff, psi_buffer), NODE_PSI(ths, plan_pre_dpsi, ind, cutoff, dpsi_buffer),
         m0, grid_size, cutoff, istride, ostride,
         f, grad_f);
   else
@@ -229,6 +464,16 @@ void PNX(spread_f_c2c_pre_psi)(
     C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
     C *grid
     )
+{
+  spread_f_c2c_pre_psi_generic(
+      f, pre_psi, m0, grid_size, cutoff,
+      grid);
+}
+
+static inline void spread_f_c2c_pre_psi_generic(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
 { 
   INT m1, m2, l0, l1, l2;
   R *pre_psi_x = &pre_psi[0*cutoff];
@@ -245,6 +490,28 @@ void PNX(spread_f_c2c_pre_psi)(
   }
 }
 
+/* window values and updates in float, grid lines are contiguous in memory */
+static void spread_f_c2c_single_pre_psi(
+    C f, const R *pre_psi, INT m0, const INT *grid_size, int cutoff,
+    CS *grid
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  const R *pre_psi_x = &pre_psi[0*cutoff];
+  const R *pre_psi_y = &pre_psi[1*cutoff];
+  const R *pre_psi_z = &pre_psi[2*cutoff];
+  CS fs = (CS) f;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      CS psi_xy_f = (float) (pre_psi_x[l0] * pre_psi_y[l1]) * fs;
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++ ){
+        grid[m2] += (float) pre_psi_z[l2] * psi_xy_f;
+      }
+    }
+  }
+}
+
 void PNX(spread_f_c2c_pre_full_psi)(
     C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
     C *grid
@@ -257,10 +524,91 @@ void PNX(spread_f_c2c_pre_full_psi)(
         grid[m2] += pre_psi[m] * f;
 }
 
+/* The howmany values of every grid point are stored consecutively. */
+void PNX(spread_f_c2c_many_pre_psi)(
+    const C *f, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++ ){
+        R psi = psi_xy * pre_psi_z[l2];
+        C *gm = grid + howmany*m2;
+        for(INT h=0; h<howmany; h++)
+          gm[h] += psi * f[h];
+      }
+    }
+  }
+}
+
+void PNX(spread_f_c2c_many_pre_full_psi)(
+    const C *f, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
+{
+  INT m1, m2, l0, l1, l2, m=0;
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2])
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2])
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++, m++ ){
+        C *gm = grid + howmany*m2;
+        for(INT h=0; h<howmany; h++)
+          gm[h] += pre_psi[m] * f[h];
+      }
+}
+
+void PNX(spread_f_c2c_strided_pre_psi)(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    C *grid
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*ostride){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*ostride){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2+=ostride ){
+        grid[m2] += psi_xy * pre_psi_z[l2] * f;
+      }
+    }
+  }
+}
+
+void PNX(spread_f_c2c_strided_pre_full_psi)(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    C *grid
+    )
+{
+  INT m1, m2, l0, l1, l2, m=0;
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*ostride)
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*ostride)
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2+=ostride, m++ )
+        grid[m2] += pre_psi[m] * f;
+}
+
 void PNX(spread_f_r2r_pre_psi)(
     R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
     R *grid
     )
+{
+  spread_f_r2r_pre_psi_generic(
+      f, pre_psi, m0, grid_size, cutoff, ostride,
+      grid);
+}
+
+static inline void spread_f_r2r_pre_psi_generic(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid
+    )
 { 
   INT m1, m2, l0, l1, l2;
   R *pre_psi_x = &pre_psi[0*cutoff];
@@ -294,6 +642,16 @@ void PNX(assign_f_c2c_pre_psi)(
     C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
     C *fv
     )
+{
+  assign_f_c2c_pre_psi_generic(
+      grid, pre_psi, m0, grid_size, cutoff,
+      fv);
+}
+
+static inline void assign_f_c2c_pre_psi_generic(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
+    )
 { 
   INT m1, m2, l0, l1, l2;
   R *pre_psi_x = &pre_psi[0*cutoff];
@@ -312,6 +670,30 @@ void PNX(assign_f_c2c_pre_psi)(
   *fv += f;
 }
 
+/* sums over one grid line are computed in float, the sum over all lines in plan precision */
+static void assign_f_c2c_single_pre_psi(
+    const CS *grid, const R *pre_psi, INT m0, const INT *grid_size, int cutoff,
+    C *fv
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  const R *pre_psi_x = &pre_psi[0*cutoff];
+  const R *pre_psi_y = &pre_psi[1*cutoff];
+  const R *pre_psi_z = &pre_psi[2*cutoff];
+  C f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      CS f_line = 0;
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++ ){
+        f_line += (float) pre_psi_z[l2] * grid[m2];
+      }
+      f += (pre_psi_x[l0] * pre_psi_y[l1]) * (C) f_line;
+    }
+  }
+  *fv += f;
+}
+
 void PNX(assign_f_c2c_pre_full_psi)(
     C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
     C *fv
@@ -330,16 +712,58 @@ void PNX(assign_f_c2c_pre_full_psi)(
   *fv += f;
 }
 
-void PNX(assign_f_r2r_pre_psi)(
-    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
-    R *fv
+/* The howmany values of every grid point are stored consecutively. */
+void PNX(assign_f_c2c_many_pre_psi)(
+    C *grid, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
     )
-{ 
+{
   INT m1, m2, l0, l1, l2;
   R *pre_psi_x = &pre_psi[0*cutoff];
   R *pre_psi_y = &pre_psi[1*cutoff];
   R *pre_psi_z = &pre_psi[2*cutoff];
-  R f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++ ){
+        R psi = psi_xy * pre_psi_z[l2];
+        const C *gm = grid + howmany*m2;
+        for(INT h=0; h<howmany; h++)
+          fv[h] += psi * gm[h];
+      }
+    }
+  }
+}
+
+void PNX(assign_f_c2c_many_pre_full_psi)(
+    C *grid, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
+    )
+{
+  INT m1, m2, l0, l1, l2, m=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++, m++ ){
+        const C *gm = grid + howmany*m2;
+        for(INT h=0; h<howmany; h++)
+          fv[h] += pre_psi[m] * gm[h];
+      }
+    }
+  }
+}
+
+void PNX(assign_f_c2c_strided_pre_psi)(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    C *fv
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+  C f=0;
 
   for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
     for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride){
@@ -349,17 +773,17 @@ void PNX(assign_f_r2r_pre_psi)(
       }
     }
   }
-  *fv += f;;
+  *fv += f;
 }
 
-void PNX(assign_f_r2r_pre_full_psi)(
-    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, int istride,
-    R *fv
+void PNX(assign_f_c2c_strided_pre_full_psi)(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    C *fv
     )
-{ 
+{
   INT m1, m2, l0, l1, l2, m=0;
-  R f=0;
-  
+  C f=0;
+
   for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
     for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride){
       for(l2=0, m2 = m1; l2<cutoff; l2++, m2+=istride, m++ ){
@@ -367,12 +791,62 @@ void PNX(assign_f_r2r_pre_full_psi)(
       }
     }
   }
-  *fv += f;;
+  *fv += f;
 }
 
-void PNX(assign_grad_f_c2c_pre_psi)(
-    C *grid, R *pre_psi, R *pre_dpsi, INT m0, INT *grid_size, int cutoff,
-    C *grad_f
+void PNX(assign_f_r2r_pre_psi)(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv
+    )
+{
+  assign_f_r2r_pre_psi_generic(
+      grid, pre_psi, m0, grid_size, cutoff, istride,
+      fv);
+}
+
+static inline void assign_f_r2r_pre_psi_generic(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv
+    )
+{ 
+  INT m1, m2, l0, l1, l2;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+  R f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2+=istride ){
+        f += psi_xy * pre_psi_z[l2] * grid[m2];
+      }
+    }
+  }
+  *fv += f;
+}
+
+void PNX(assign_f_r2r_pre_full_psi)(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, int istride,
+    R *fv
+    )
+{ 
+  INT m1, m2, l0, l1, l2, m=0;
+  R f=0;
+  
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride){
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2+=istride, m++ ){
+        f += pre_psi[m] * grid[m2];
+      }
+    }
+  }
+  *fv += f;
+}
+
+void PNX(assign_grad_f_c2c_pre_psi)(
+    C *grid, R *pre_psi, R *pre_dpsi, INT m0, INT *grid_size, int cutoff,
+    C *grad_f
     )
 { 
   INT m1, m2, l0, l1, l2;
@@ -564,4 +1038,514 @@ void PNX(assign_f_and_grad_f_r2r_pre_full_psi)(
   grad_f[0*ostride] += g0; grad_f[1*ostride] += g1; grad_f[2*ostride] += g2;
 }
 
+/* f, grad_f and the Hessian (xx, xy, xz, yy, yz, zz) in one pass over the stencil. Every row
+ * along z is summed up with the window, its first and its second derivative, the products of
+ * the x and y factors combine the three sums. f and grad_f are skipped, if they are NULL. */
+void PNX(assign_hessian_f_c2c)(
+    C *grid, R *pre_psi, R *pre_dpsi, R *pre_d2psi, INT m0, INT *grid_size, int cutoff,
+    C *fv, C *grad_f, C *hessian_f
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  R *pre_psi_x = &pre_psi[0*cutoff], *pre_dpsi_x = &pre_dpsi[0*cutoff], *pre_d2psi_x = &pre_d2psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff], *pre_dpsi_y = &pre_dpsi[1*cutoff], *pre_d2psi_y = &pre_d2psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff], *pre_dpsi_z = &pre_dpsi[2*cutoff], *pre_d2psi_z = &pre_d2psi[2*cutoff];
+  C f=0, g0=0, g1=0, g2=0, h00=0, h01=0, h02=0, h11=0, h12=0, h22=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      R psi_xy   = pre_psi_x[l0]   * pre_psi_y[l1];
+      R psi_dxy  = pre_dpsi_x[l0]  * pre_psi_y[l1];
+      R psi_xdy  = pre_psi_x[l0]   * pre_dpsi_y[l1];
+      R psi_ddxy = pre_d2psi_x[l0] * pre_psi_y[l1];
+      R psi_dxdy = pre_dpsi_x[l0]  * pre_dpsi_y[l1];
+      R psi_xddy = pre_psi_x[l0]   * pre_d2psi_y[l1];
+      C s0=0, s1=0, s2=0;
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2++ ){
+        s0 += pre_psi_z[l2]   * grid[m2];
+        s1 += pre_dpsi_z[l2]  * grid[m2];
+        s2 += pre_d2psi_z[l2] * grid[m2];
+      }
+      f   += psi_xy   * s0;
+      g0  += psi_dxy  * s0;
+      g1  += psi_xdy  * s0;
+      g2  += psi_xy   * s1;
+      h00 += psi_ddxy * s0;
+      h01 += psi_dxdy * s0;
+      h02 += psi_dxy  * s1;
+      h11 += psi_xddy * s0;
+      h12 += psi_xdy  * s1;
+      h22 += psi_xy   * s2;
+    }
+  }
+  if(fv != NULL)
+    *fv += f;
+  if(grad_f != NULL){
+    grad_f[0] += g0; grad_f[1] += g1; grad_f[2] += g2;
+  }
+  hessian_f[0] += h00; hessian_f[1] += h01; hessian_f[2] += h02;
+  hessian_f[3] += h11; hessian_f[4] += h12; hessian_f[5] += h22;
+}
+
+void PNX(assign_hessian_f_r2r)(
+    R *grid, R *pre_psi, R *pre_dpsi, R *pre_d2psi, INT m0, INT *grid_size, int cutoff, INT istride, INT ostride,
+    R *fv, R *grad_f, R *hessian_f
+    )
+{
+  INT m1, m2, l0, l1, l2;
+  R *pre_psi_x = &pre_psi[0*cutoff], *pre_dpsi_x = &pre_dpsi[0*cutoff], *pre_d2psi_x = &pre_d2psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff], *pre_dpsi_y = &pre_dpsi[1*cutoff], *pre_d2psi_y = &pre_d2psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff], *pre_dpsi_z = &pre_dpsi[2*cutoff], *pre_d2psi_z = &pre_d2psi[2*cutoff];
+  R f=0, g0=0, g1=0, g2=0, h00=0, h01=0, h02=0, h11=0, h12=0, h22=0;
 
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride){
+      R psi_xy   = pre_psi_x[l0]   * pre_psi_y[l1];
+      R psi_dxy  = pre_dpsi_x[l0]  * pre_psi_y[l1];
+      R psi_xdy  = pre_psi_x[l0]   * pre_dpsi_y[l1];
+      R psi_ddxy = pre_d2psi_x[l0] * pre_psi_y[l1];
+      R psi_dxdy = pre_dpsi_x[l0]  * pre_dpsi_y[l1];
+      R psi_xddy = pre_psi_x[l0]   * pre_d2psi_y[l1];
+      R s0=0, s1=0, s2=0;
+      for(l2=0, m2 = m1; l2<cutoff; l2++, m2+=istride ){
+        s0 += pre_psi_z[l2]   * grid[m2];
+        s1 += pre_dpsi_z[l2]  * grid[m2];
+        s2 += pre_d2psi_z[l2] * grid[m2];
+      }
+      f   += psi_xy   * s0;
+      g0  += psi_dxy  * s0;
+      g1  += psi_xdy  * s0;
+      g2  += psi_xy   * s1;
+      h00 += psi_ddxy * s0;
+      h01 += psi_dxdy * s0;
+      h02 += psi_dxy  * s1;
+      h11 += psi_xddy * s0;
+      h12 += psi_xdy  * s1;
+      h22 += psi_xy   * s2;
+    }
+  }
+  if(fv != NULL)
+    *fv += f;
+  if(grad_f != NULL){
+    grad_f[0*ostride] += g0; grad_f[1*ostride] += g1; grad_f[2*ostride] += g2;
+  }
+  hessian_f[0*ostride] += h00; hessian_f[1*ostride] += h01; hessian_f[2*ostride] += h02;
+  hessian_f[3*ostride] += h11; hessian_f[4*ostride] += h12; hessian_f[5*ostride] += h22;
+}
+
+
+/* Pruned stencil of PNX(set_prune_stencil). The truncation of the window to cutoff points
+ * already neglects weights of the size of the 1d window at the border of the support.
+ * Therefore, products of the 1d weights below this level times the largest weight are skipped,
+ * which removes the corners of the cube. */
+static inline R pruning_threshold(
+    const R *pre_psi, int cutoff
+    )
+{
+  R level = 1, psi_max_total = 1;
+
+  for(int t=0; t<3; t++){
+    const R *psi = &pre_psi[t*cutoff];
+    R psi_max = 0, psi_border = PNFFT_MAX(pnfft_fabs(psi[0]), pnfft_fabs(psi[cutoff-1]));
+
+    for(int l=0; l<cutoff; l++)
+      if(pnfft_fabs(psi[l]) > psi_max)
+        psi_max = pnfft_fabs(psi[l]);
+    if(psi_max > 0 && psi_border < level * psi_max)
+      level = psi_border / psi_max;
+    psi_max_total *= psi_max;
+  }
+
+  return level * psi_max_total;
+}
+
+/* The 1d window decays from its center, therefore the kept weights of the row (l0,l1)
+ * form the contiguous range lo <= l2 < hi. Skipped rows get lo = hi. */
+static inline void pruned_row(
+    R psi_xy, const R *pre_psi_z, int cutoff, R threshold,
+    int *lo, int *hi
+    )
+{
+  int l = 0, h = cutoff;
+
+  while(l < h && pnfft_fabs(psi_xy * pre_psi_z[l]) < threshold)
+    l++;
+  while(h > l && pnfft_fabs(psi_xy * pre_psi_z[h-1]) < threshold)
+    h--;
+
+  *lo = l; *hi = h;
+}
+
+static inline void spread_f_c2c_pre_psi_pruned_generic(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
+{
+  INT m1, m2, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+  const R threshold = pruning_threshold(pre_psi, cutoff);
+  int lo, hi;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      pruned_row(psi_xy, pre_psi_z, cutoff, threshold, &lo, &hi);
+      for(int l2=lo; l2<hi; l2++){
+        m2 = m1 + l2;
+        grid[m2] += psi_xy * pre_psi_z[l2] * f;
+      }
+    }
+  }
+}
+
+static inline void spread_f_r2r_pre_psi_pruned_generic(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid
+    )
+{
+  INT m1, m2, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+  const R threshold = pruning_threshold(pre_psi, cutoff);
+  int lo, hi;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*ostride){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*ostride){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      pruned_row(psi_xy, pre_psi_z, cutoff, threshold, &lo, &hi);
+      for(int l2=lo; l2<hi; l2++){
+        m2 = m1 + l2*ostride;
+        grid[m2] += psi_xy * pre_psi_z[l2] * f;
+      }
+    }
+  }
+}
+
+static inline void assign_f_c2c_pre_psi_pruned_generic(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
+    )
+{
+  INT m1, m2, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+  const R threshold = pruning_threshold(pre_psi, cutoff);
+  int lo, hi;
+  C f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      pruned_row(psi_xy, pre_psi_z, cutoff, threshold, &lo, &hi);
+      for(int l2=lo; l2<hi; l2++){
+        m2 = m1 + l2;
+        f += psi_xy * pre_psi_z[l2] * grid[m2];
+      }
+    }
+  }
+  *fv += f;
+}
+
+static inline void assign_f_r2r_pre_psi_pruned_generic(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv
+    )
+{
+  INT m1, m2, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R *pre_psi_z = &pre_psi[2*cutoff];
+  const R threshold = pruning_threshold(pre_psi, cutoff);
+  int lo, hi;
+  R f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride){
+      R psi_xy = pre_psi_x[l0] * pre_psi_y[l1];
+      pruned_row(psi_xy, pre_psi_z, cutoff, threshold, &lo, &hi);
+      for(int l2=lo; l2<hi; l2++){
+        m2 = m1 + l2*istride;
+        f += psi_xy * pre_psi_z[l2] * grid[m2];
+      }
+    }
+  }
+  *fv += f;
+}
+
+static void spread_f_c2c_pre_psi_pruned(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
+{
+  spread_f_c2c_pre_psi_pruned_generic(f, pre_psi, m0, grid_size, cutoff, grid);
+}
+
+static void spread_f_r2r_pre_psi_pruned(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid
+    )
+{
+  spread_f_r2r_pre_psi_pruned_generic(f, pre_psi, m0, grid_size, cutoff, ostride, grid);
+}
+
+static void assign_f_c2c_pre_psi_pruned(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
+    )
+{
+  assign_f_c2c_pre_psi_pruned_generic(grid, pre_psi, m0, grid_size, cutoff, fv);
+}
+
+static void assign_f_r2r_pre_psi_pruned(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv
+    )
+{
+  assign_f_r2r_pre_psi_pruned_generic(grid, pre_psi, m0, grid_size, cutoff, istride, fv);
+}
+
+
+/* Kernels with a compile time cutoff, such that the compiler can completely
+ * unroll and vectorize the stencil loops. */
+#define PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(CUTOFF)                                   \
+static void spread_f_c2c_pre_psi_##CUTOFF(                                          \
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,                            \
+    C *grid)                                                                        \
+{                                                                                   \
+  spread_f_c2c_pre_psi_generic(f, pre_psi, m0, grid_size, CUTOFF, grid);            \
+}                                                                                   \
+static void spread_f_r2r_pre_psi_##CUTOFF(                                          \
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,               \
+    R *grid)                                                                        \
+{                                                                                   \
+  spread_f_r2r_pre_psi_generic(f, pre_psi, m0, grid_size, CUTOFF, ostride, grid);   \
+}                                                                                   \
+static void assign_f_c2c_pre_psi_##CUTOFF(                                          \
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,                        \
+    C *fv)                                                                          \
+{                                                                                   \
+  assign_f_c2c_pre_psi_generic(grid, pre_psi, m0, grid_size, CUTOFF, fv);           \
+}                                                                                   \
+static void assign_f_r2r_pre_psi_##CUTOFF(                                          \
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,           \
+    R *fv)                                                                          \
+{                                                                                   \
+  assign_f_r2r_pre_psi_generic(grid, pre_psi, m0, grid_size, CUTOFF, istride, fv);  \
+}                                                                                   \
+static void spread_f_c2c_pre_psi_pruned_##CUTOFF(                                   \
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,                            \
+    C *grid)                                                                        \
+{                                                                                   \
+  spread_f_c2c_pre_psi_pruned_generic(f, pre_psi, m0, grid_size, CUTOFF, grid);     \
+}                                                                                   \
+static void spread_f_r2r_pre_psi_pruned_##CUTOFF(                                   \
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,               \
+    R *grid)                                                                        \
+{                                                                                   \
+  spread_f_r2r_pre_psi_pruned_generic(f, pre_psi, m0, grid_size, CUTOFF, ostride,   \
+      grid);                                                                        \
+}                                                                                   \
+static void assign_f_c2c_pre_psi_pruned_##CUTOFF(                                   \
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,                        \
+    C *fv)                                                                          \
+{                                                                                   \
+  assign_f_c2c_pre_psi_pruned_generic(grid, pre_psi, m0, grid_size, CUTOFF, fv);    \
+}                                                                                   \
+static void assign_f_r2r_pre_psi_pruned_##CUTOFF(                                   \
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,           \
+    R *fv)                                                                          \
+{                                                                                   \
+  assign_f_r2r_pre_psi_pruned_generic(grid, pre_psi, m0, grid_size, CUTOFF,        \
+      istride, fv);                                                                 \
+}
+
+#define PNFFT_SET_FIXED_CUTOFF_KERNELS(ths, CUTOFF)                                 \
+  ths->spread_f_c2c_kernel = spread_f_c2c_pre_psi_##CUTOFF;                         \
+  ths->spread_f_r2r_kernel = spread_f_r2r_pre_psi_##CUTOFF;                         \
+  ths->assign_f_c2c_kernel = assign_f_c2c_pre_psi_##CUTOFF;                         \
+  ths->assign_f_r2r_kernel = assign_f_r2r_pre_psi_##CUTOFF;
+
+#define PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths, CUTOFF)                          \
+  ths->spread_f_c2c_kernel = spread_f_c2c_pre_psi_pruned_##CUTOFF;                  \
+  ths->spread_f_r2r_kernel = spread_f_r2r_pre_psi_pruned_##CUTOFF;                  \
+  ths->assign_f_c2c_kernel = assign_f_c2c_pre_psi_pruned_##CUTOFF;                  \
+  ths->assign_f_r2r_kernel = assign_f_r2r_pre_psi_pruned_##CUTOFF;
+
+/* cutoff = 2*m+1 for m = 1,...,6 */
+PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(3)
+PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(5)
+PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(7)
+PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(9)
+PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(11)
+PNFFT_DEFINE_FIXED_CUTOFF_KERNELS(13)
+
+/* Choose the tensor product kernels for the cutoff of the plan.
+ * The generic kernels are used for all other cutoffs. */
+void PNX(init_assign_kernels)(
+    PNX(plan) ths
+    )
+{
+  /* plans with d < 3 only run over the stencil of their first d axes, they are not pruned */
+  if(ths->d == 2){
+    ths->spread_f_c2c_kernel = spread_f_c2c_pre_psi_2d;
+    ths->spread_f_r2r_kernel = spread_f_r2r_pre_psi_2d;
+    ths->assign_f_c2c_kernel = assign_f_c2c_pre_psi_2d;
+    ths->assign_f_r2r_kernel = assign_f_r2r_pre_psi_2d;
+    return;
+  }
+  if(ths->d == 1){
+    ths->spread_f_c2c_kernel = spread_f_c2c_pre_psi_1d;
+    ths->spread_f_r2r_kernel = spread_f_r2r_pre_psi_1d;
+    ths->assign_f_c2c_kernel = assign_f_c2c_pre_psi_1d;
+    ths->assign_f_r2r_kernel = assign_f_r2r_pre_psi_1d;
+    return;
+  }
+
+  if(ths->prune_stencil){
+    ths->spread_f_c2c_kernel = spread_f_c2c_pre_psi_pruned;
+    ths->spread_f_r2r_kernel = spread_f_r2r_pre_psi_pruned;
+    ths->assign_f_c2c_kernel = assign_f_c2c_pre_psi_pruned;
+    ths->assign_f_r2r_kernel = assign_f_r2r_pre_psi_pruned;
+
+    switch(ths->cutoff){
+      case  3: PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths,  3); break;
+      case  5: PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths,  5); break;
+      case  7: PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths,  7); break;
+      case  9: PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths,  9); break;
+      case 11: PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths, 11); break;
+      case 13: PNFFT_SET_FIXED_CUTOFF_PRUNED_KERNELS(ths, 13); break;
+    }
+    return;
+  }
+
+  ths->spread_f_c2c_kernel = PNX(spread_f_c2c_pre_psi);
+  ths->spread_f_r2r_kernel = PNX(spread_f_r2r_pre_psi);
+  ths->assign_f_c2c_kernel = PNX(assign_f_c2c_pre_psi);
+  ths->assign_f_r2r_kernel = PNX(assign_f_r2r_pre_psi);
+
+  switch(ths->cutoff){
+    case  3: PNFFT_SET_FIXED_CUTOFF_KERNELS(ths,  3); break;
+    case  5: PNFFT_SET_FIXED_CUTOFF_KERNELS(ths,  5); break;
+    case  7: PNFFT_SET_FIXED_CUTOFF_KERNELS(ths,  7); break;
+    case  9: PNFFT_SET_FIXED_CUTOFF_KERNELS(ths,  9); break;
+    case 11: PNFFT_SET_FIXED_CUTOFF_KERNELS(ths, 11); break;
+    case 13: PNFFT_SET_FIXED_CUTOFF_KERNELS(ths, 13); break;
+  }
+}
+
+
+/* Stencils of plans with d < 3. The window values keep the layout of three axes,
+ * the axes of length 1 have a single grid point and their values are not used. */
+static void spread_f_c2c_pre_psi_2d(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
+{
+  INT m1, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    R psi_x = pre_psi_x[l0];
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2])
+      grid[m1] += psi_x * pre_psi_y[l1] * f;
+  }
+}
+
+static void spread_f_r2r_pre_psi_2d(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid
+    )
+{
+  INT m1, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*ostride){
+    R psi_x = pre_psi_x[l0];
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*ostride)
+      grid[m1] += psi_x * pre_psi_y[l1] * f;
+  }
+}
+
+static void assign_f_c2c_pre_psi_2d(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
+    )
+{
+  INT m1, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  C f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]){
+    R psi_x = pre_psi_x[l0];
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2])
+      f += psi_x * pre_psi_y[l1] * grid[m1];
+  }
+  *fv += f;
+}
+
+static void assign_f_r2r_pre_psi_2d(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv
+    )
+{
+  INT m1, l0, l1;
+  R *pre_psi_x = &pre_psi[0*cutoff];
+  R *pre_psi_y = &pre_psi[1*cutoff];
+  R f=0;
+
+  for(l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride){
+    R psi_x = pre_psi_x[l0];
+    for(l1=0, m1=m0; l1<cutoff; l1++, m1 += grid_size[2]*istride)
+      f += psi_x * pre_psi_y[l1] * grid[m1];
+  }
+  *fv += f;
+}
+
+static void spread_f_c2c_pre_psi_1d(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid
+    )
+{
+  for(int l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2])
+    grid[m0] += pre_psi[l0] * f;
+}
+
+static void spread_f_r2r_pre_psi_1d(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid
+    )
+{
+  for(int l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*ostride)
+    grid[m0] += pre_psi[l0] * f;
+}
+
+static void assign_f_c2c_pre_psi_1d(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv
+    )
+{
+  C f=0;
+
+  for(int l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2])
+    f += pre_psi[l0] * grid[m0];
+  *fv += f;
+}
+
+static void assign_f_r2r_pre_psi_1d(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv
+    )
+{
+  R f=0;
+
+  for(int l0=0; l0<cutoff; l0++, m0 += grid_size[1]*grid_size[2]*istride)
+    f += pre_psi[l0] * grid[m0];
+  *fv += f;
+}
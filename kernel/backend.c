@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Function table of matrix B, see PNX(set_backend). Every pass of PNX(trafo) and PNX(adj)
+ * calls trafo_B after the FFT and adjoint_B before the adjoint FFT, e.g., to run the loops over
+ * the nodes on a device with its own ghost cells over GPU-aware MPI on the plan's comm_cart.
+ * An entry which returns 0 leaves the pass to the loops of the host. Matrix D and the FFTs of
+ * PFFT stay on the host, the backend exchanges the grid with them through PNX(get_grid). */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+
+static int host_trafo_B(
+    PNX(plan) ths, int interlaced, void *data);
+static int host_adjoint_B(
+    PNX(plan) ths, int interlaced, void *data);
+
+
+void PNX(init_backend)(
+    PNX(plan) ths
+    )
+{
+  ths->backend.trafo_B = host_trafo_B;
+  ths->backend.adjoint_B = host_adjoint_B;
+  ths->backend.data = NULL;
+}
+
+/* The plan copies the table, entries equal to NULL and backend == NULL keep the host loops.
+ * Both entries get the plan, the pass and data. interlaced is 1 for the second pass of
+ * PNFFT_INTERLACED on the grid shifted by half a mesh width, the plan averages both passes.
+ * trafo_B computes f, grad_f and hessian_f of the local nodes as requested by the compute flags,
+ * adjoint_B overwrites the whole local grid. PNFFT_BATCH_INTERLACED, PNFFT_GRAD_IK and the
+ * chunked execution always use the host loops. */
+void PNX(set_backend)(
+    PNX(plan) ths, const PNX(backend) *backend
+    )
+{
+  PNX(init_backend)(ths);
+  if(backend == NULL)
+    return;
+
+  if(backend->trafo_B != NULL)
+    ths->backend.trafo_B = backend->trafo_B;
+  if(backend->adjoint_B != NULL)
+    ths->backend.adjoint_B = backend->adjoint_B;
+  ths->backend.data = backend->data;
+}
+
+/* Local block of the oversampled grid between matrix B and the FFT without ghost cells, i.e.,
+ * local_no[0] x local_no[1] x local_no[2] points from local_no_start in row major order with
+ * howmany complex (c2r: real) values each. Host memory of PFFT. */
+R *PNX(get_grid)(
+    const PNX(plan) ths, INT *local_no, INT *local_no_start
+    )
+{
+  for(int t=0; t<3; t++){
+    local_no[t] = ths->local_no[t];
+    local_no_start[t] = ths->local_no_start[t];
+  }
+  return ths->g2;
+}
+
+/* returns 1, if the direction adj still runs the loops of the host */
+int PNX(host_backend)(
+    const PNX(plan) ths, int adj
+    )
+{
+  if(adj)
+    return ths->backend.adjoint_B == host_adjoint_B;
+  return ths->backend.trafo_B == host_trafo_B;
+}
+
+void PNX(trafo_B_backend)(
+    PNX(plan) ths, int interlaced
+    )
+{
+  if(!ths->backend.trafo_B(ths, interlaced, ths->backend.data))
+    host_trafo_B(ths, interlaced, NULL);
+}
+
+void PNX(adjoint_B_backend)(
+    PNX(plan) ths, int interlaced
+    )
+{
+  if(!ths->backend.adjoint_B(ths, interlaced, ths->backend.data))
+    host_adjoint_B(ths, interlaced, NULL);
+}
+
+static int host_trafo_B(
+    PNX(plan) ths, int interlaced, void *data
+    )
+{
+  PNX(trafo_B_grad_ad)(ths, interlaced);
+  return 1;
+}
+
+static int host_adjoint_B(
+    PNX(plan) ths, int interlaced, void *data
+    )
+{
+  PNX(adjoint_B)(ths, interlaced);
+  return 1;
+}
@@ -19,6 +19,7 @@
  *
  */
 
+#include <string.h>
 #include "pnfft.h"
 #include "ipnfft.h"
 #include "bspline.h"
@@ -91,6 +92,85 @@ R PNX(bspline)(
 } /* bspline */
 
 
+/** Exact piecewise polynomial coefficients of \f$M_{k,0}\f$ and its first two derivatives.
+ *  Piece i covers [i, i+1) and is a polynomial of degree k-1 in t = x - i. The coefficient of t^p
+ *  of derivative 'derivative' is coeffs[(derivative*k + p)*k + i], such that all pieces are
+ *  evaluated in lockstep for the same t. coeffs needs 3*k*k entries.
+ *  The pieces follow from M_k(x) = (x M_{k-1}(x) + (k-x) M_{k-1}(x-1)) / (k-1).
+ */
+void PNX(bspline_poly_coeffs)(
+    int k, R *coeffs
+    )
+{
+  R *prev = coeffs + k*k, *tmp;
+
+  /* the second and third table serve as work space of the recurrence */
+  memset(coeffs, 0, sizeof(R) * (size_t) (3*k*k));
+  coeffs[0] = 1.0;
+
+  for(int j=2; j<=k; j++){
+    memcpy(prev, coeffs, sizeof(R) * (size_t) (k*k));
+    for(int i=0; i<j; i++)
+      for(int p=0; p<j; p++){
+        R a  = (i < j-1)           ? prev[p*k + i]       : 0.0;
+        R a1 = (i < j-1 && p > 0)  ? prev[(p-1)*k + i]   : 0.0;
+        R c  = (i > 0)             ? prev[p*k + i-1]     : 0.0;
+        R c1 = (i > 0 && p > 0)    ? prev[(p-1)*k + i-1] : 0.0;
+        coeffs[p*k + i] = (i*a + a1 + (j-i)*c - c1) / (j-1);
+      }
+  }
+
+  /* derivatives of the pieces, the work space is overwritten */
+  tmp = coeffs + 2*k*k;
+  for(int p=0; p<k; p++)
+    for(int i=0; i<k; i++){
+      prev[p*k + i] = (p+1 < k) ? (p+1) * coeffs[(p+1)*k + i] : 0.0;
+      tmp[p*k + i]  = (p+2 < k) ? (p+1) * (p+2) * coeffs[(p+2)*k + i] : 0.0;
+    }
+}
+
+/** Evaluates all k pieces of \f$M_{k,0}\f$ (or its derivative) at x = i + t by a Horner scheme
+ *  that runs over the pieces in lockstep. No scratch is needed, coeffs is read only.
+ */
+void PNX(bspline_poly_pieces)(
+    int k, int derivative, R t, const R *coeffs,
+    R *pieces
+    )
+{
+  const R *c = coeffs + derivative*k*k;
+
+  for(int i=0; i<k; i++)
+    pieces[i] = c[(k-1)*k + i];
+  for(int p=k-2; p>=0; p--)
+    for(int i=0; i<k; i++)
+      pieces[i] = pieces[i] * t + c[p*k + i];
+}
+
+/** Computes \f$M_{k,0}\left(x\right)\f$ or its derivative from the coefficients of
+ *  PNX(bspline_poly_coeffs).
+ */
+R PNX(bspline_poly)(
+    int k, int derivative, R x, const R *coeffs
+    )
+{
+  const R *c = coeffs + derivative*k*k;
+  R t, result_value;
+  int i;
+
+  if( !(0<x && x<k) )
+    return 0.0;
+
+  i = (int) x;
+  t = x - i;
+
+  result_value = c[(k-1)*k + i];
+  for(int p=k-2; p>=0; p--)
+    result_value = result_value * t + c[p*k + i];
+
+  return result_value;
+}
+
+
 R PNX(fast_bspline)(
     int i, R x, int p
     )
@@ -26,6 +26,13 @@
 
 R PNX(bspline)(
     int k, R x, R *scratch);
+void PNX(bspline_poly_coeffs)(
+    int k, R *coeffs);
+void PNX(bspline_poly_pieces)(
+    int k, int derivative, R t, const R *coeffs,
+    R *pieces);
+R PNX(bspline_poly)(
+    int k, int derivative, R x, const R *coeffs);
 R PNX(fast_bspline)(
     int i, R x, int cao_value);
 R PNX(fast_bspline_d)(
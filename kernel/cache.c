@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Process wide cache of the window tables (interpolation tables, 1d tables of phi_hat).
+ * Plans with the same window parameters copy the tables instead of evaluating the window again.
+ * All entries are equal on all processes, therefore process 0 can save them to a file. */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+
+#define PNFFT_CACHE_MAGIC "pnfft-table-cache 1"
+
+typedef struct{
+  double key[PNFFT_CACHE_KEY_LENGTH];
+  INT size;
+  R *data;
+} cache_entry;
+
+static cache_entry *entries = NULL;
+static int num_entries = 0, max_entries = 0;
+
+static cache_entry* find_entry(
+    const double *key, INT size);
+
+
+/* Key of a table of axis 'dim' that depends on the window, m, n and b, together with
+ * three parameters specific to the kind of table. */
+void PNX(window_cache_key)(
+    const PNX(plan) ths, int kind, int dim, double p0, double p1, double p2,
+    double *key
+    )
+{
+  key[0] = (double) kind;
+  key[1] = (double) (ths->pnfft_flags & PNFFTI_WINDOW_FLAGS);
+  key[2] = (double) ths->m;
+  key[3] = (double) ths->n[dim];
+  key[4] = (double) ths->b[dim];
+  key[5] = p0;
+  key[6] = p1;
+  key[7] = p2;
+}
+
+/* Copy the cached table of 'size' reals into 'data'. Collective, the result is 1
+ * on all processes of 'comm' only if all of them hold the table. */
+int PNX(cache_fetch)(
+    const double *key, INT size, MPI_Comm comm,
+    R *data
+    )
+{
+  cache_entry *entry = find_entry(key, size);
+  int found = (entry != NULL), found_all;
+
+  MPI_Allreduce(&found, &found_all, 1, MPI_INT, MPI_MIN, comm);
+  if(!found_all)
+    return 0;
+
+  for(INT k=0; k<size; k++)
+    data[k] = entry->data[k];
+  return 1;
+}
+
+void PNX(cache_insert)(
+    const double *key, INT size, const R *data
+    )
+{
+  cache_entry *entry = find_entry(key, size);
+
+  if(entry == NULL){
+    if(num_entries == max_entries){
+      max_entries = (max_entries) ? 2*max_entries : 16;
+      entries = (cache_entry*) realloc(entries, sizeof(cache_entry) * (size_t) max_entries);
+    }
+    entry = &entries[num_entries++];
+    for(int k=0; k<PNFFT_CACHE_KEY_LENGTH; k++)
+      entry->key[k] = key[k];
+    entry->size = size;
+    entry->data = (R*) malloc(sizeof(R) * (size_t) size);
+  }
+
+  for(INT k=0; k<size; k++)
+    entry->data[k] = data[k];
+}
+
+/* Block [start, end) of a table of 'size' entries that is computed by the calling process. */
+void PNX(table_chunk)(
+    INT size, MPI_Comm comm,
+    INT *start, INT *end
+    )
+{
+  int rank, num_procs;
+
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &num_procs);
+
+  *start = size * rank / num_procs;
+  *end   = size * (rank+1) / num_procs;
+}
+
+/* Every process filled its chunk of 'data', afterwards all processes hold the whole table. */
+void PNX(allgather_table)(
+    INT size, MPI_Comm comm,
+    R *data
+    )
+{
+  int num_procs, *counts, *displs;
+
+  MPI_Comm_size(comm, &num_procs);
+  if(num_procs == 1)
+    return;
+
+  counts = (int*) malloc(sizeof(int) * 2 * (size_t) num_procs);
+  displs = counts + num_procs;
+  for(int p=0; p<num_procs; p++){
+    displs[p] = (int) (size * p / num_procs);
+    counts[p] = (int) (size * (p+1) / num_procs) - displs[p];
+  }
+
+  MPI_Allgatherv(MPI_IN_PLACE, 0, PNFFT_MPI_REAL_TYPE, data, counts, displs, PNFFT_MPI_REAL_TYPE, comm);
+  free(counts);
+}
+
+
+/* Collective, process 0 writes all cached tables. Returns 0 on success on all processes. */
+int PNX(save_table_cache)(
+    const char *filename, MPI_Comm comm
+    )
+{
+  int rank, err = 0;
+
+  MPI_Comm_rank(comm, &rank);
+
+  if(rank == 0){
+    FILE *file = fopen(filename, "wb");
+    int real_size = (int) sizeof(R);
+    long long size;
+
+    if(file == NULL)
+      err = 1;
+    else {
+      fwrite(PNFFT_CACHE_MAGIC, 1, sizeof(PNFFT_CACHE_MAGIC), file);
+      fwrite(&real_size, sizeof(int), 1, file);
+      fwrite(&num_entries, sizeof(int), 1, file);
+      for(int e=0; e<num_entries; e++){
+        size = (long long) entries[e].size;
+        fwrite(entries[e].key, sizeof(double), PNFFT_CACHE_KEY_LENGTH, file);
+        fwrite(&size, sizeof(long long), 1, file);
+        fwrite(entries[e].data, sizeof(R), (size_t) size, file);
+      }
+      err = ferror(file);
+      fclose(file);
+    }
+  }
+
+  MPI_Bcast(&err, 1, MPI_INT, 0, comm);
+  return err;
+}
+
+/* Collective, process 0 reads the tables and broadcasts them to all processes of 'comm'.
+ * Returns 0 on success on all processes. */
+int PNX(load_table_cache)(
+    const char *filename, MPI_Comm comm
+    )
+{
+  int rank, err = 0, num = 0;
+  FILE *file = NULL;
+
+  MPI_Comm_rank(comm, &rank);
+
+  if(rank == 0){
+    char magic[sizeof(PNFFT_CACHE_MAGIC)];
+    int real_size = 0;
+
+    file = fopen(filename, "rb");
+    if(file == NULL
+        || fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, PNFFT_CACHE_MAGIC, sizeof(magic))
+        || fread(&real_size, sizeof(int), 1, file) != 1 || real_size != (int) sizeof(R)
+        || fread(&num, sizeof(int), 1, file) != 1)
+      err = 1;
+  }
+
+  MPI_Bcast(&err, 1, MPI_INT, 0, comm);
+  MPI_Bcast(&num, 1, MPI_INT, 0, comm);
+
+  for(int e=0; e<num && !err; e++){
+    double key[PNFFT_CACHE_KEY_LENGTH];
+    long long size = 0;
+    R *data;
+
+    if(rank == 0)
+      if(fread(key, sizeof(double), PNFFT_CACHE_KEY_LENGTH, file) != PNFFT_CACHE_KEY_LENGTH
+          || fread(&size, sizeof(long long), 1, file) != 1)
+        size = -1;
+    MPI_Bcast(&size, 1, MPI_LONG_LONG, 0, comm);
+    if(size < 0){
+      err = 1;
+      break;
+    }
+
+    data = (R*) malloc(sizeof(R) * (size_t) (size+1));
+    if(rank == 0)
+      if(fread(data, sizeof(R), (size_t) size, file) != (size_t) size)
+        size = -1;
+    MPI_Bcast(&size, 1, MPI_LONG_LONG, 0, comm);
+    if(size >= 0){
+      MPI_Bcast(key, PNFFT_CACHE_KEY_LENGTH, MPI_DOUBLE, 0, comm);
+      MPI_Bcast(data, (int) size, PNFFT_MPI_REAL_TYPE, 0, comm);
+      PNX(cache_insert)(key, (INT) size, data);
+    } else
+      err = 1;
+    free(data);
+  }
+
+  if(file != NULL)
+    fclose(file);
+
+  return err;
+}
+
+void PNX(forget_table_cache)(
+    void
+    )
+{
+  for(int e=0; e<num_entries; e++)
+    free(entries[e].data);
+  if(entries != NULL)
+    free(entries);
+  entries = NULL;
+  num_entries = max_entries = 0;
+}
+
+
+static cache_entry* find_entry(
+    const double *key, INT size
+    )
+{
+  for(int e=0; e<num_entries; e++){
+    int equal = (entries[e].size == size);
+
+    for(int k=0; k<PNFFT_CACHE_KEY_LENGTH && equal; k++)
+      equal = (entries[e].key[k] == key[k]);
+    if(equal)
+      return &entries[e];
+  }
+
+  return NULL;
+}
@@ -0,0 +1,581 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Ghost cell engine with persistent requests, an alternative to PX(gcplan) for ghost cells
+ * that only reach the next neighbor. Same as PX(exchange) and PX(reduce), exchange expands the
+ * local block of g2 in place to the block with ghost cells and reduce shrinks it again.
+ * The axes are handled one after another, such that the corners reach the diagonal neighbors.
+ * With PNFFT_GHOSTS_SHARED, the slabs for neighbors on the same node are packed into an MPI-3
+ * shared memory window and read directly by the neighbor, i.e., without messages.
+ * With a float wire format, the slabs of double plans are packed as float, which halves the
+ * messages, and the reduce accumulates the received floats in the precision of the plan.
+ * Open axes have no neighbor across the global border, the ghost cells there stay zero in the
+ * exchange and are dropped by the reduce. */
+
+#include <string.h>
+#include "pnfft.h"
+#include "ipnfft.h"
+
+#define GHOSTS_PACK       0
+#define GHOSTS_UNPACK     1
+#define GHOSTS_ACCUMULATE 2
+#define GHOSTS_ZERO       3
+
+/* direction of a slab, i.e., toward the lower or the upper neighbor */
+#define GHOSTS_DOWN 0
+#define GHOSTS_UP   1
+
+struct PNX(ghosts_s){
+  MPI_Comm comm;                /**< Cartesian communicator of the plan              */
+  MPI_Comm comm_node;           /**< Processes on the same node or MPI_COMM_NULL     */
+  MPI_Win win;                  /**< Shared window of the send slabs or MPI_WIN_NULL */
+  INT unit;                     /**< Reals per grid point                            */
+  int float_wire;               /**< Flag, if the slabs hold float instead of R      */
+  MPI_Datatype wire_type;       /**< MPI type of the slab entries                    */
+  INT local_no[3];              /**< Local block without ghost cells                 */
+  INT gc_below[3], gc_above[3]; /**< Ghost cells below and above the local block     */
+  INT local_ngc[3];             /**< Local block with ghost cells                    */
+  int neighbor[3][2];           /**< Lower and upper neighbor in comm or MPI_PROC_NULL */
+  R *remote[3][2];              /**< Send slab of the neighbor within the shared
+                                     window, NULL if it lives on another node        */
+  R *send[3][2];                /**< Send slabs, within the shared window if used    */
+  R *recv[3][2];                /**< Receive slabs of neighbors on other nodes       */
+  MPI_Request req_exchange[3][4]; /**< Persistent requests of the exchange           */
+  MPI_Request req_reduce[3][4];   /**< Persistent requests of the reduce             */
+  int num_exchange[3], num_reduce[3]; /**< Number of requests per axis               */
+  double bytes_exchange[3], bytes_reduce[3]; /**< Bytes sent per axis as messages      */
+  INT bytes;                    /**< Size of all slabs in bytes                      */
+  int split_axes;               /**< Axes finished by the posted exchange or reduce,
+                                     -1 if none is posted                            */
+};
+
+static INT plane_size(
+    const PNX(ghosts) ths, int t);
+static void copy_slab(
+    const PNX(ghosts) ths, int t, INT start, INT width, int mode,
+    R *grid, R *buf);
+static void expand_block(
+    const PNX(ghosts) ths,
+    R *grid);
+static void shrink_block(
+    const PNX(ghosts) ths,
+    R *grid);
+static void fence(
+    const PNX(ghosts) ths);
+static void post_axis(
+    PNX(ghosts) ths, int t, int reduce,
+    R *grid);
+static void finish_axis(
+    PNX(ghosts) ths, int t, int reduce,
+    R *grid);
+static int requests_done(
+    int num, MPI_Request *req, int wait);
+
+
+/* Returns NULL on all processes, if the ghost cells reach further than the next neighbor. Collective. */
+PNX(ghosts) PNX(mkghosts)(
+    const INT *local_no, const INT *gc_below, const INT *gc_above, INT unit,
+    int shared, int float_wire, const int *open, MPI_Comm comm_cart
+    )
+{
+  int rnk_pm, dims[3], periods[3], coords[3], fits = 1, fits_all;
+  INT offset[3][2], total = 0;
+  PNX(ghosts) ths;
+
+  MPI_Cartdim_get(comm_cart, &rnk_pm);
+  for(int t=0; t<3; t++){
+    dims[t] = 1; coords[t] = 0;
+  }
+  MPI_Cart_get(comm_cart, rnk_pm, dims, periods, coords);
+
+  for(int t=0; t<3; t++)
+    if(gc_below[t] > local_no[t] || gc_above[t] > local_no[t])
+      fits = 0;
+  MPI_Allreduce(&fits, &fits_all, 1, MPI_INT, MPI_MIN, comm_cart);
+  if(!fits_all)
+    return NULL;
+
+  ths = (PNX(ghosts)) malloc(sizeof(struct PNX(ghosts_s)));
+  ths->comm = comm_cart;
+  ths->unit = unit;
+  ths->split_axes = -1;
+
+  /* the slabs keep their size in units of R, float entries only use the first half */
+  ths->float_wire = float_wire && (sizeof(R) > sizeof(float));
+  ths->wire_type = (ths->float_wire) ? MPI_FLOAT : PNFFT_MPI_REAL_TYPE;
+  for(int t=0; t<3; t++){
+    ths->local_no[t] = local_no[t];
+    ths->gc_below[t] = gc_below[t];
+    ths->gc_above[t] = gc_above[t];
+    ths->local_ngc[t] = gc_below[t] + local_no[t] + gc_above[t];
+  }
+
+  /* periodic neighbors, axes that are not distributed wrap around on the same process,
+   * open axes end at the global border */
+  for(int t=0; t<3; t++){
+    for(int dir=0; dir<2; dir++){
+      int c[3] = {coords[0], coords[1], coords[2]};
+      int border = (dir == GHOSTS_UP) ? (c[t] == dims[t]-1) : (c[t] == 0);
+      c[t] = (c[t] + ((dir == GHOSTS_UP) ? 1 : dims[t]-1)) % dims[t];
+      if(open[t] && border)
+        ths->neighbor[t][dir] = MPI_PROC_NULL;
+      else
+        MPI_Cart_rank(comm_cart, c, &ths->neighbor[t][dir]);
+    }
+  }
+
+  /* exchange sends the first gc_above interior planes down and the last gc_below planes up,
+   * reduce sends the ghost cells, i.e., the slab toward the lower neighbor has the same size */
+  for(int t=0; t<3; t++){
+    offset[t][GHOSTS_DOWN] = total;
+    total += PNFFT_MAX(gc_below[t], gc_above[t]) * plane_size(ths, t);
+    offset[t][GHOSTS_UP] = total;
+    total += PNFFT_MAX(gc_below[t], gc_above[t]) * plane_size(ths, t);
+  }
+  ths->bytes = 2 * total * (INT) sizeof(R);
+
+  ths->comm_node = MPI_COMM_NULL;
+  ths->win = MPI_WIN_NULL;
+  if(shared){
+    R *base;
+    MPI_Comm_split_type(comm_cart, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &ths->comm_node);
+    MPI_Win_allocate_shared((MPI_Aint) (total + 1) * (MPI_Aint) sizeof(R), (int) sizeof(R), MPI_INFO_NULL,
+        ths->comm_node, &base, &ths->win);
+    for(int t=0; t<3; t++)
+      for(int dir=0; dir<2; dir++)
+        ths->send[t][dir] = base + offset[t][dir];
+  } else {
+    R *base = (R*) PNX(malloc)(sizeof(R) * (size_t) (total + 1));
+    for(int t=0; t<3; t++)
+      for(int dir=0; dir<2; dir++)
+        ths->send[t][dir] = base + offset[t][dir];
+  }
+
+  for(int t=0; t<3; t++){
+    for(int dir=0; dir<2; dir++){
+      const INT count = PNFFT_MAX(gc_below[t], gc_above[t]) * plane_size(ths, t);
+      const int from = ths->neighbor[t][1-dir];
+      int node_rank = MPI_UNDEFINED;
+      long long remote_offset = 0, my_offset = (long long) offset[t][dir];
+
+      /* the slab that travels in direction dir comes from the opposite neighbor */
+      ths->remote[t][dir] = NULL;
+      if(ths->comm_node != MPI_COMM_NULL && from != MPI_PROC_NULL){
+        MPI_Group group, group_node;
+        MPI_Comm_group(comm_cart, &group);
+        MPI_Comm_group(ths->comm_node, &group_node);
+        MPI_Group_translate_ranks(group, 1, &from, group_node, &node_rank);
+        MPI_Group_free(&group);
+        MPI_Group_free(&group_node);
+      }
+      MPI_Sendrecv(&my_offset, 1, MPI_LONG_LONG, ths->neighbor[t][dir], 4*t+dir,
+          &remote_offset, 1, MPI_LONG_LONG, from, 4*t+dir, comm_cart, MPI_STATUS_IGNORE);
+
+      if(from == MPI_PROC_NULL)
+        ths->recv[t][dir] = NULL;
+      else if(node_rank != MPI_UNDEFINED){
+        MPI_Aint size;
+        int disp_unit;
+        R *base;
+        MPI_Win_shared_query(ths->win, node_rank, &size, &disp_unit, &base);
+        ths->remote[t][dir] = base + remote_offset;
+        ths->recv[t][dir] = NULL;
+      } else
+        ths->recv[t][dir] = (R*) PNX(malloc)(sizeof(R) * (size_t) (count + 1));
+    }
+  }
+
+  /* persistent requests with neighbors on other nodes */
+  for(int t=0; t<3; t++){
+    INT count_down_ex = gc_above[t] * plane_size(ths, t), count_up_ex = gc_below[t] * plane_size(ths, t);
+    INT count_down_re = gc_below[t] * plane_size(ths, t), count_up_re = gc_above[t] * plane_size(ths, t);
+    int tag = 8*t;
+
+    ths->num_exchange[t] = ths->num_reduce[t] = 0;
+    ths->bytes_exchange[t] = ths->bytes_reduce[t] = 0;
+    for(int dir=0; dir<2; dir++){
+      const INT count_ex = (dir == GHOSTS_DOWN) ? count_down_ex : count_up_ex;
+      const INT count_re = (dir == GHOSTS_DOWN) ? count_down_re : count_up_re;
+      const int to = ths->neighbor[t][dir], from = ths->neighbor[t][1-dir];
+
+      /* the receiving neighbor reads the slab from the shared window */
+      if(to != MPI_PROC_NULL && (ths->comm_node == MPI_COMM_NULL || !PNX(ghosts_on_node)(ths, to))){
+        MPI_Send_init(ths->send[t][dir], (int) count_ex, ths->wire_type, to, tag+dir, comm_cart,
+            &ths->req_exchange[t][ths->num_exchange[t]++]);
+        MPI_Send_init(ths->send[t][dir], (int) count_re, ths->wire_type, to, tag+2+dir, comm_cart,
+            &ths->req_reduce[t][ths->num_reduce[t]++]);
+        ths->bytes_exchange[t] += (double) count_ex * ((ths->float_wire) ? sizeof(float) : sizeof(R));
+        ths->bytes_reduce[t]   += (double) count_re * ((ths->float_wire) ? sizeof(float) : sizeof(R));
+      }
+      if(ths->recv[t][dir] != NULL){
+        MPI_Recv_init(ths->recv[t][dir], (int) count_ex, ths->wire_type, from, tag+dir, comm_cart,
+            &ths->req_exchange[t][ths->num_exchange[t]++]);
+        MPI_Recv_init(ths->recv[t][dir], (int) count_re, ths->wire_type, from, tag+2+dir, comm_cart,
+            &ths->req_reduce[t][ths->num_reduce[t]++]);
+      }
+    }
+  }
+
+  return ths;
+}
+
+/* Flag, if process 'rank' of comm shares the window of the ghost cell slabs. */
+int PNX(ghosts_on_node)(
+    const PNX(ghosts) ths, int rank
+    )
+{
+  MPI_Group group, group_node;
+  int node_rank;
+
+  if(ths->comm_node == MPI_COMM_NULL)
+    return 0;
+
+  MPI_Comm_group(ths->comm, &group);
+  MPI_Comm_group(ths->comm_node, &group_node);
+  MPI_Group_translate_ranks(group, 1, &rank, group_node, &node_rank);
+  MPI_Group_free(&group);
+  MPI_Group_free(&group_node);
+
+  return node_rank != MPI_UNDEFINED;
+}
+
+void PNX(rmghosts)(
+    PNX(ghosts) ths
+    )
+{
+  if(ths == NULL)
+    return;
+
+  for(int t=0; t<3; t++){
+    for(int k=0; k<ths->num_exchange[t]; k++)
+      MPI_Request_free(&ths->req_exchange[t][k]);
+    for(int k=0; k<ths->num_reduce[t]; k++)
+      MPI_Request_free(&ths->req_reduce[t][k]);
+    for(int dir=0; dir<2; dir++)
+      if(ths->recv[t][dir] != NULL)
+        PNX(free)(ths->recv[t][dir]);
+  }
+
+  if(ths->win != MPI_WIN_NULL)
+    MPI_Win_free(&ths->win);
+  else
+    PNX(free)(ths->send[0][GHOSTS_DOWN]);
+  if(ths->comm_node != MPI_COMM_NULL)
+    MPI_Comm_free(&ths->comm_node);
+
+  free(ths);
+}
+
+INT PNX(ghosts_memory)(
+    const PNX(ghosts) ths
+    )
+{
+  return (ths != NULL) ? ths->bytes : 0;
+}
+
+/* Same as PX(exchange), grid holds the local block on input and the block with ghost cells on output.
+ * Adds the time of packing and posting, the time of waiting and unpacking and the bytes sent to stats. */
+void PNX(ghosts_exchange)(
+    PNX(ghosts) ths,
+    R *grid, double *stats
+    )
+{
+  PNX(ghosts_exchange_post)(ths, grid, stats);
+  PNX(ghosts_exchange_test)(ths, grid, 1, stats);
+}
+
+/* Same as PX(reduce), grid holds the block with ghost cells on input and the local block on output.
+ * Adds the times and bytes to stats as PNX(ghosts_exchange). */
+void PNX(ghosts_reduce)(
+    PNX(ghosts) ths,
+    R *grid, double *stats
+    )
+{
+  PNX(ghosts_reduce_post)(ths, grid, stats);
+  PNX(ghosts_reduce_test)(ths, grid, 1, stats);
+}
+
+/* Split-phase exchange: post expands the block and posts the slabs of the first axis, every test
+ * finishes the axes whose messages have arrived, posts the next one and returns 1 after the last axis.
+ * With 'wait' set, test waits for all axes. grid must not be touched until test returned 1.
+ * The axes fence the shared window, i.e., all processes of a node have to test until the end. */
+void PNX(ghosts_exchange_post)(
+    PNX(ghosts) ths,
+    R *grid, double *stats
+    )
+{
+  stats[PNFFTI_COMM_POST] -= MPI_Wtime();
+  expand_block(ths, grid);
+  post_axis(ths, 0, 0, grid);
+  stats[PNFFTI_COMM_POST] += MPI_Wtime();
+  ths->split_axes = 0;
+}
+
+int PNX(ghosts_exchange_test)(
+    PNX(ghosts) ths,
+    R *grid, int wait, double *stats
+    )
+{
+  if(ths->split_axes < 0)
+    return 1;
+
+  while(ths->split_axes < 3){
+    const int t = ths->split_axes;
+
+    stats[PNFFTI_COMM_WAIT] -= MPI_Wtime();
+    if(!requests_done(ths->num_exchange[t], ths->req_exchange[t], wait)){
+      stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+      return 0;
+    }
+    finish_axis(ths, t, 0, grid);
+    stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+    stats[PNFFTI_COMM_BYTES] += ths->bytes_exchange[t];
+
+    if(++ths->split_axes < 3){
+      stats[PNFFTI_COMM_POST] -= MPI_Wtime();
+      post_axis(ths, t+1, 0, grid);
+      stats[PNFFTI_COMM_POST] += MPI_Wtime();
+    }
+  }
+
+  /* the neighbors read the slabs before they are packed again */
+  stats[PNFFTI_COMM_WAIT] -= MPI_Wtime();
+  fence(ths);
+  stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+  ths->split_axes = -1;
+  return 1;
+}
+
+/* Split-phase reduce, same as PNX(ghosts_exchange_post) and PNX(ghosts_exchange_test)
+ * with the axes in reverse order. */
+void PNX(ghosts_reduce_post)(
+    PNX(ghosts) ths,
+    R *grid, double *stats
+    )
+{
+  stats[PNFFTI_COMM_POST] -= MPI_Wtime();
+  post_axis(ths, 2, 1, grid);
+  stats[PNFFTI_COMM_POST] += MPI_Wtime();
+  ths->split_axes = 0;
+}
+
+int PNX(ghosts_reduce_test)(
+    PNX(ghosts) ths,
+    R *grid, int wait, double *stats
+    )
+{
+  if(ths->split_axes < 0)
+    return 1;
+
+  while(ths->split_axes < 3){
+    const int t = 2 - ths->split_axes;
+
+    stats[PNFFTI_COMM_WAIT] -= MPI_Wtime();
+    if(!requests_done(ths->num_reduce[t], ths->req_reduce[t], wait)){
+      stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+      return 0;
+    }
+    finish_axis(ths, t, 1, grid);
+    stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+    stats[PNFFTI_COMM_BYTES] += ths->bytes_reduce[t];
+
+    if(++ths->split_axes < 3){
+      stats[PNFFTI_COMM_POST] -= MPI_Wtime();
+      post_axis(ths, t-1, 1, grid);
+      stats[PNFFTI_COMM_POST] += MPI_Wtime();
+    }
+  }
+
+  stats[PNFFTI_COMM_WAIT] -= MPI_Wtime();
+  fence(ths);
+  stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+  shrink_block(ths, grid);
+  ths->split_axes = -1;
+  return 1;
+}
+
+
+/* pack the slabs of axis t and start their messages */
+static void post_axis(
+    PNX(ghosts) ths, int t, int reduce,
+    R *grid
+    )
+{
+  /* exchange sends interior planes, reduce sends the ghost cells */
+  const INT start_send[2] = {(reduce) ? 0 : ths->gc_below[t],
+                             (reduce) ? ths->gc_below[t] + ths->local_no[t] : ths->local_no[t]};
+  const INT width_send[2] = {(reduce) ? ths->gc_below[t] : ths->gc_above[t],
+                             (reduce) ? ths->gc_above[t] : ths->gc_below[t]};
+
+  for(int dir=0; dir<2; dir++)
+    if(ths->neighbor[t][dir] != MPI_PROC_NULL)
+      copy_slab(ths, t, start_send[dir], width_send[dir], GHOSTS_PACK, grid, ths->send[t][dir]);
+
+  if(reduce && ths->num_reduce[t])
+    MPI_Startall(ths->num_reduce[t], ths->req_reduce[t]);
+  if(!reduce && ths->num_exchange[t])
+    MPI_Startall(ths->num_exchange[t], ths->req_exchange[t]);
+}
+
+/* unpack (exchange) or accumulate (reduce) the slabs of axis t after its messages arrived */
+static void finish_axis(
+    PNX(ghosts) ths, int t, int reduce,
+    R *grid
+    )
+{
+  /* the slab traveling down fills the upper ghost cells of exchange, the lower ghost cells
+   * of the upper neighbor are added to the last interior planes by reduce, and vice versa */
+  const INT start_recv[2] = {(reduce) ? ths->local_no[t] : ths->gc_below[t] + ths->local_no[t],
+                             (reduce) ? ths->gc_below[t] : 0};
+  const INT width_recv[2] = {(reduce) ? ths->gc_below[t] : ths->gc_above[t],
+                             (reduce) ? ths->gc_above[t] : ths->gc_below[t]};
+  const int mode = (reduce) ? GHOSTS_ACCUMULATE : GHOSTS_UNPACK;
+
+  fence(ths);
+  for(int dir=0; dir<2; dir++)
+    if(ths->remote[t][dir] != NULL)
+      copy_slab(ths, t, start_recv[dir], width_recv[dir], mode, grid, ths->remote[t][dir]);
+  for(int dir=0; dir<2; dir++)
+    if(ths->recv[t][dir] != NULL)
+      copy_slab(ths, t, start_recv[dir], width_recv[dir], mode, grid, ths->recv[t][dir]);
+    else if(!reduce && ths->neighbor[t][1-dir] == MPI_PROC_NULL)
+      copy_slab(ths, t, start_recv[dir], width_recv[dir], GHOSTS_ZERO, grid, NULL);
+}
+
+/* waits or tests for the requests, returns 1 if all of them have completed */
+static int requests_done(
+    int num, MPI_Request *req, int wait
+    )
+{
+  int flag = 1;
+
+  if(num == 0)
+    return 1;
+
+  if(wait)
+    MPI_Waitall(num, req, MPI_STATUSES_IGNORE);
+  else
+    MPI_Testall(num, req, &flag, MPI_STATUSES_IGNORE);
+  return flag;
+}
+
+
+/* reals of one plane orthogonal to axis t, including the ghost cells of the other axes */
+static INT plane_size(
+    const PNX(ghosts) ths, int t
+    )
+{
+  INT size = ths->unit;
+
+  for(int s=0; s<3; s++)
+    if(s != t)
+      size *= ths->local_ngc[s];
+
+  return size;
+}
+
+/* planes start <= k_t < start+width of the block with ghost cells from or into buf,
+ * GHOSTS_ZERO clears the planes without buf */
+static void copy_slab(
+    const PNX(ghosts) ths, int t, INT start, INT width, int mode,
+    R *grid, R *buf
+    )
+{
+  const INT *ngc = ths->local_ngc;
+  INT lo[3] = {0, 0, 0}, hi[3] = {ngc[0], ngc[1], ngc[2]}, row, m = 0;
+
+  lo[t] = start;
+  hi[t] = start + width;
+  row = (hi[2] - lo[2]) * ths->unit;
+
+  for(INT k0=lo[0]; k0<hi[0]; k0++){
+    for(INT k1=lo[1]; k1<hi[1]; k1++, m += row){
+      R *g = grid + ((k0*ngc[1] + k1)*ngc[2] + lo[2]) * ths->unit;
+      if(mode == GHOSTS_ZERO){
+        memset(g, 0, sizeof(R) * (size_t) row);
+        continue;
+      }
+      if(ths->float_wire){
+        float *b = (float*) buf + m;
+        switch(mode){
+          case GHOSTS_PACK:
+            for(INT k=0; k<row; k++)
+              b[k] = (float) g[k];
+            break;
+          case GHOSTS_UNPACK:
+            for(INT k=0; k<row; k++)
+              g[k] = (R) b[k];
+            break;
+          default:
+            for(INT k=0; k<row; k++)
+              g[k] += (R) b[k];
+        }
+        continue;
+      }
+      switch(mode){
+        case GHOSTS_PACK:
+          memcpy(buf + m, g, sizeof(R) * (size_t) row); break;
+        case GHOSTS_UNPACK:
+          memcpy(g, buf + m, sizeof(R) * (size_t) row); break;
+        default:
+          for(INT k=0; k<row; k++)
+            g[k] += buf[m+k];
+      }
+    }
+  }
+}
+
+/* move the rows backward, since the position within the larger block is never lower */
+static void expand_block(
+    const PNX(ghosts) ths,
+    R *grid
+    )
+{
+  const INT *no = ths->local_no, *ngc = ths->local_ngc, *gc = ths->gc_below;
+  const INT row = no[2] * ths->unit;
+
+  for(INT k0=no[0]-1; k0>=0; k0--)
+    for(INT k1=no[1]-1; k1>=0; k1--)
+      memmove(grid + (((k0+gc[0])*ngc[1] + k1+gc[1])*ngc[2] + gc[2]) * ths->unit,
+          grid + (k0*no[1] + k1) * row, sizeof(R) * (size_t) row);
+}
+
+static void shrink_block(
+    const PNX(ghosts) ths,
+    R *grid
+    )
+{
+  const INT *no = ths->local_no, *ngc = ths->local_ngc, *gc = ths->gc_below;
+  const INT row = no[2] * ths->unit;
+
+  for(INT k0=0; k0<no[0]; k0++)
+    for(INT k1=0; k1<no[1]; k1++)
+      memmove(grid + (k0*no[1] + k1) * row,
+          grid + (((k0+gc[0])*ngc[1] + k1+gc[1])*ngc[2] + gc[2]) * ths->unit, sizeof(R) * (size_t) row);
+}
+
+/* all processes of the node call the same number of fences */
+static void fence(
+    const PNX(ghosts) ths
+    )
+{
+  if(ths->win != MPI_WIN_NULL)
+    MPI_Win_fence(0, ths->win);
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Particle halo, an alternative to the ghost cells of g2 for dilute or clustered nodes.
+ * Every node whose support reaches into a neighboring block is sent once to this neighbor,
+ * shifted to its periodic image. The neighbor handles the received copies like its own nodes
+ * on its local block, which is padded by zeros instead of ghost cells. Trafo returns the
+ * partial results of the copies to the owner of the node, adj sends f of the nodes to the
+ * neighbors. The nodes travel only once in PNX(precompute_psi), every call moves f and grad_f
+ * of the copies instead of the cutoff planes of every face. */
+
+#include <string.h>
+#include "pnfft.h"
+#include "ipnfft.h"
+
+/* up to 26 neighbors of a 3d block */
+#define HALO_MAX_NEIGHBORS 26
+
+/* tags of the node counts and of the values of the copies */
+#define HALO_TAG_COUNT  0
+#define HALO_TAG_VALUES 1
+
+struct PNX(halo_s){
+  MPI_Comm comm;                /**< Cartesian communicator of the plan              */
+  int num_neighbors;            /**< Number of different neighbors                   */
+  int neighbor[HALO_MAX_NEIGHBORS]; /**< Neighbors in comm, maybe the own process    */
+  int send_count[HALO_MAX_NEIGHBORS]; /**< Own nodes sent to every neighbor          */
+  int recv_count[HALO_MAX_NEIGHBORS]; /**< Copies received from every neighbor       */
+  INT send_M;                   /**< Sum of send_count                               */
+  INT recv_M;                   /**< Sum of recv_count                               */
+  INT *send_index;              /**< Own node of every sent copy, grouped by neighbor */
+  INT pad[3];                   /**< Zeros below and above the local block           */
+  INT local_ngc[3];             /**< Local block with padding                        */
+  INT unit_f, unit_grad_f;      /**< Reals of f and grad_f per node                  */
+  PNX(nodes) nodes;             /**< Received copies, attached for the local loops   */
+  PNX(nodes) prev;              /**< Node set attached before PNX(halo_attach)       */
+  R *x, *f, *grad_f;            /**< Nodes and results of the received copies        */
+  R *send_buf;                  /**< Values of the sent copies                       */
+  R *recv_buf;                  /**< Values of the received copies                   */
+};
+
+static int node_sides(
+    const PNX(plan) ths, const R *x, const INT *pad,
+    int *lo, int *hi);
+static void exchange_values(
+    const PNX(halo) halo, int reverse, INT unit,
+    R *send, R *recv, double *stats);
+
+
+/* Collect the nodes of ths that reach into a neighbor and send them to this neighbor.
+ * With 'automatic', the halo is only used if it moves less data per call than the ghost cells.
+ * Returns NULL on all processes, if the halo is not used or the support of the nodes reaches
+ * further than the next neighbor. Collective. */
+PNX(halo) PNX(mkhalo)(
+    PNX(plan) ths, int automatic
+    )
+{
+  const int cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+  const int il = (ths->pnfft_flags & PNFFT_INTERLACED) ? 1 : 0;
+  int rnk_pm, dims[3], periods[3], coords[3], fits = 1, fits_all;
+  int neighbor_of[27], cursor[HALO_MAX_NEIGHBORS];
+  INT pad[3], local_ngc[3];
+  double ghost_reals, cost[2], cost_max[2];
+  MPI_Request req[2*HALO_MAX_NEIGHBORS];
+  R *send_x;
+  PNX(halo) halo;
+
+  /* these plans never reach the loops of the halo */
+  if((ths->pnfft_flags & (PNFFT_BATCH_INTERLACED | PNFFT_MIXED_PRECISION)) || ths->sparse_b_mode != PNFFT_SPARSE_B_OFF)
+    return NULL;
+
+  MPI_Cartdim_get(ths->comm_cart, &rnk_pm);
+  for(int t=0; t<3; t++){
+    dims[t] = 1; coords[t] = 0;
+  }
+  MPI_Cart_get(ths->comm_cart, rnk_pm, dims, periods, coords);
+
+  /* support of a node within the block reaches at most pad grid points over its borders,
+   * the received copies in the neighbor's padding fit into the same width */
+  for(int t=0; t<3; t++){
+    pad[t] = ths->cutoff - 1 + il;
+    local_ngc[t] = ths->local_no[t] + 2*pad[t];
+    if(pad[t] > ths->local_no[t])
+      fits = 0;
+  }
+  MPI_Allreduce(&fits, &fits_all, 1, MPI_INT, MPI_MIN, ths->comm_cart);
+  if(!fits_all)
+    return NULL;
+
+  halo = (PNX(halo)) malloc(sizeof(struct PNX(halo_s)));
+  memset(halo, 0, sizeof(struct PNX(halo_s)));
+  halo->comm = ths->comm_cart;
+  halo->unit_f = cplx * ths->howmany;
+  halo->unit_grad_f = (ths->pnfft_flags & PNFFT_GRAD_NONE) ? 0 : cplx * ths->d;
+  for(int t=0; t<3; t++){
+    halo->pad[t] = pad[t];
+    halo->local_ngc[t] = local_ngc[t];
+  }
+
+  /* neighbors in the order of the offsets, duplicates on small meshes are merged */
+  for(int off=0; off<27; off++){
+    int c[3], rank, k;
+
+    neighbor_of[off] = -1;
+    if(off == 13)
+      continue;
+    c[0] = (coords[0] + off/9 - 1 + dims[0]) % dims[0];
+    c[1] = (coords[1] + (off/3)%3 - 1 + dims[1]) % dims[1];
+    c[2] = (coords[2] + off%3 - 1 + dims[2]) % dims[2];
+    MPI_Cart_rank(ths->comm_cart, c, &rank);
+    for(k=0; k<halo->num_neighbors; k++)
+      if(halo->neighbor[k] == rank)
+        break;
+    if(k == halo->num_neighbors)
+      halo->neighbor[halo->num_neighbors++] = rank;
+    neighbor_of[off] = k;
+  }
+
+  /* count the copies of every neighbor */
+  for(INT j=0; j<ths->local_M; j++){
+    int lo[3], hi[3];
+    if(!node_sides(ths, ths->x + ths->d*j, pad, lo, hi))
+      continue;
+    for(int s0=lo[0]; s0<=hi[0]; s0++)
+      for(int s1=lo[1]; s1<=hi[1]; s1++)
+        for(int s2=lo[2]; s2<=hi[2]; s2++)
+          if(s0 || s1 || s2)
+            halo->send_count[neighbor_of[9*(s0+1) + 3*(s1+1) + s2+1]]++;
+  }
+
+  for(int k=0; k<halo->num_neighbors; k++){
+    MPI_Irecv(&halo->recv_count[k], 1, MPI_INT, halo->neighbor[k], HALO_TAG_COUNT, halo->comm, &req[2*k]);
+    MPI_Isend(&halo->send_count[k], 1, MPI_INT, halo->neighbor[k], HALO_TAG_COUNT, halo->comm, &req[2*k+1]);
+  }
+  MPI_Waitall(2*halo->num_neighbors, req, MPI_STATUSES_IGNORE);
+
+  for(int k=0; k<halo->num_neighbors; k++){
+    cursor[k] = (int) halo->send_M;
+    halo->send_M += halo->send_count[k];
+    halo->recv_M += halo->recv_count[k];
+  }
+
+  /* reals per call of the halo and of the ghost cells, the nodes only travel once */
+  ghost_reals = (double) halo->unit_f;
+  for(int t=0; t<3; t++)
+    ghost_reals *= (double) (ths->local_no[t] + ths->cutoff - 1 + il);
+  cost[0] = (double) ((halo->unit_f + halo->unit_grad_f) * PNFFT_MAX(halo->send_M, halo->recv_M));
+  cost[1] = ghost_reals - (double) (halo->unit_f * PNX(prod_INT)(3, ths->local_no));
+  MPI_Allreduce(cost, cost_max, 2, MPI_DOUBLE, MPI_MAX, ths->comm_cart);
+  if(automatic && cost_max[0] >= cost_max[1]){
+    free(halo);
+    return NULL;
+  }
+
+  /* periodic image of every copy within the block of the neighbor */
+  halo->send_index = (halo->send_M) ? (INT*) PNX(malloc)(sizeof(INT) * (size_t) halo->send_M) : NULL;
+  send_x = (halo->send_M) ? (R*) PNX(malloc)(sizeof(R) * 3 * (size_t) halo->send_M) : NULL;
+  for(INT j=0; j<ths->local_M; j++){
+    int lo[3], hi[3], s[3];
+    if(!node_sides(ths, ths->x + ths->d*j, pad, lo, hi))
+      continue;
+    for(s[0]=lo[0]; s[0]<=hi[0]; s[0]++)
+      for(s[1]=lo[1]; s[1]<=hi[1]; s[1]++)
+        for(s[2]=lo[2]; s[2]<=hi[2]; s[2]++){
+          int k;
+          if(!s[0] && !s[1] && !s[2])
+            continue;
+          k = cursor[neighbor_of[9*(s[0]+1) + 3*(s[1]+1) + s[2]+1]]++;
+          halo->send_index[k] = j;
+          for(int t=0; t<3; t++){
+            send_x[3*k+t] = ths->x[ths->d*j+t];
+            /* same period as the ghost cells of the FFT output */
+            if(coords[t] + s[t] < 0)
+              send_x[3*k+t] += (R) ths->no[t] / (R) ths->n[t];
+            if(coords[t] + s[t] >= dims[t])
+              send_x[3*k+t] -= (R) ths->no[t] / (R) ths->n[t];
+          }
+        }
+  }
+
+  halo->x = (halo->recv_M) ? (R*) PNX(malloc)(sizeof(R) * 3 * (size_t) halo->recv_M) : NULL;
+  exchange_values(halo, 0, 3, send_x, halo->x, NULL);
+  if(send_x != NULL)
+    PNX(free)(send_x);
+
+  if(halo->recv_M){
+    halo->f = (R*) PNX(malloc)(sizeof(R) * (size_t) (halo->unit_f * halo->recv_M));
+    if(halo->unit_grad_f)
+      halo->grad_f = (R*) PNX(malloc)(sizeof(R) * (size_t) (halo->unit_grad_f * halo->recv_M));
+    halo->recv_buf = (R*) PNX(malloc)(sizeof(R) * (size_t) ((halo->unit_f + halo->unit_grad_f) * halo->recv_M));
+  }
+  if(halo->send_M)
+    halo->send_buf = (R*) PNX(malloc)(sizeof(R) * (size_t) ((halo->unit_f + halo->unit_grad_f) * halo->send_M));
+
+  /* the buffers stay with the halo, the node set only holds the sort and the precomputations */
+  halo->nodes = PNX(mknodes)(halo->recv_M, 0, ths);
+
+  return halo;
+}
+
+void PNX(rmhalo)(
+    PNX(halo) halo, PNX(plan) ths
+    )
+{
+  if(halo == NULL)
+    return;
+
+  PNX(rmnodes)(halo->nodes, ths);
+  if(halo->send_index != NULL) PNX(free)(halo->send_index);
+  if(halo->x != NULL)          PNX(free)(halo->x);
+  if(halo->f != NULL)          PNX(free)(halo->f);
+  if(halo->grad_f != NULL)     PNX(free)(halo->grad_f);
+  if(halo->send_buf != NULL)   PNX(free)(halo->send_buf);
+  if(halo->recv_buf != NULL)   PNX(free)(halo->recv_buf);
+
+  free(halo);
+}
+
+/* Halo of PNX(set_halo) for the current nodes of ths, the received copies get their own sort
+ * and window values. Called by PNX(precompute_psi), collective. */
+void PNX(init_halo)(
+    PNX(plan) ths
+    )
+{
+  int mode = ths->halo_mode;
+  PNX(halo) halo;
+
+  PNX(free_halo)(ths);
+  if(mode == PNFFT_HALO_OFF)
+    return;
+
+  halo = PNX(mkhalo)(ths, mode == PNFFT_HALO_AUTO);
+  if(halo == NULL)
+    return;
+  ths->halo = halo;
+
+  /* the copies have no halo of their own */
+  ths->halo_mode = PNFFT_HALO_OFF;
+  PNX(halo_attach)(halo, ths);
+  PNX(precompute_psi)(ths);
+  PNX(halo_detach)(halo, ths);
+  ths->halo_mode = mode;
+}
+
+void PNX(free_halo)(
+    PNX(plan) ths
+    )
+{
+  PNX(rmhalo)(ths->halo, ths);
+  ths->halo = NULL;
+}
+
+/* Work on the received copies with the compute flags of the current nodes of ths.
+ * The copies have no halo, i.e., ths->halo is NULL until PNX(halo_detach). */
+void PNX(halo_attach)(
+    PNX(halo) halo, PNX(plan) ths
+    )
+{
+  const unsigned compute = ths->compute_flags & (PNFFT_COMPUTE_F | PNFFT_COMPUTE_GRAD_F);
+
+  halo->prev = ths->nodes;
+  PNX(attach_nodes)(halo->nodes, ths);
+
+  ths->x = halo->x;
+  ths->f = halo->f;
+  ths->grad_f = halo->grad_f;
+  ths->compute_flags = (ths->compute_flags & ~(PNFFT_COMPUTE_F | PNFFT_COMPUTE_GRAD_F)) | compute;
+}
+
+/* Back to the node set that was attached before PNX(halo_attach). */
+void PNX(halo_detach)(
+    PNX(halo) halo, PNX(plan) ths
+    )
+{
+  PNX(attach_nodes)(halo->prev, ths);
+}
+
+/* Flag, if the received copies have a buffer for the gradient. */
+int PNX(halo_has_grad_f)(
+    const PNX(halo) halo
+    )
+{
+  return halo->unit_grad_f > 0;
+}
+
+/* Padding and size of the local block of the halo grid, returns the number of reals. */
+INT PNX(halo_grid_size)(
+    const PNX(halo) halo,
+    INT *pad, INT *local_ngc
+    )
+{
+  for(int t=0; t<3; t++){
+    pad[t] = halo->pad[t];
+    local_ngc[t] = halo->local_ngc[t];
+  }
+  return halo->unit_f * PNX(prod_INT)(3, halo->local_ngc);
+}
+
+/* Copy the local block g2 into the middle of 'grid' and fill the padding with zeros. */
+void PNX(halo_expand)(
+    const PNX(halo) halo, const R *g2,
+    R *grid
+    )
+{
+  const INT *no = halo->local_ngc, *pad = halo->pad;
+  INT local_no[3], row;
+
+  for(int t=0; t<3; t++)
+    local_no[t] = no[t] - 2*pad[t];
+  row = local_no[2] * halo->unit_f;
+
+  memset(grid, 0, sizeof(R) * (size_t) (halo->unit_f * PNX(prod_INT)(3, no)));
+  for(INT k0=0; k0<local_no[0]; k0++)
+    for(INT k1=0; k1<local_no[1]; k1++)
+      memcpy(grid + (((k0+pad[0])*no[1] + k1+pad[1])*no[2] + pad[2]) * halo->unit_f,
+          g2 + (k0*local_no[1] + k1) * row, sizeof(R) * (size_t) row);
+}
+
+/* Copy the middle of 'grid' into the local block g2, the padding is dropped. */
+void PNX(halo_shrink)(
+    const PNX(halo) halo, const R *grid,
+    R *g2
+    )
+{
+  const INT *no = halo->local_ngc, *pad = halo->pad;
+  INT local_no[3], row;
+
+  for(int t=0; t<3; t++)
+    local_no[t] = no[t] - 2*pad[t];
+  row = local_no[2] * halo->unit_f;
+
+  for(INT k0=0; k0<local_no[0]; k0++)
+    for(INT k1=0; k1<local_no[1]; k1++)
+      memcpy(g2 + (k0*local_no[1] + k1) * row,
+          grid + (((k0+pad[0])*no[1] + k1+pad[1])*no[2] + pad[2]) * halo->unit_f, sizeof(R) * (size_t) row);
+}
+
+/* adj: f of the current nodes of ths into f of the received copies, the times and bytes are added to stats */
+void PNX(halo_scatter_f)(
+    const PNX(halo) halo, const PNX(plan) ths, double *stats
+    )
+{
+  const INT unit = halo->unit_f;
+
+  for(INT k=0; k<halo->send_M; k++)
+    memcpy(halo->send_buf + unit*k, ths->f + unit*halo->send_index[k], sizeof(R) * (size_t) unit);
+
+  exchange_values(halo, 0, unit, halo->send_buf, halo->f, stats);
+}
+
+/* trafo: add the partial f and grad_f of the received copies to the current nodes of ths,
+ * the times and bytes are added to stats */
+void PNX(halo_gather_f)(
+    const PNX(halo) halo, PNX(plan) ths, double *stats
+    )
+{
+  const INT unit_f = (ths->compute_flags & PNFFT_COMPUTE_F) ? halo->unit_f : 0;
+  const INT unit_grad_f = (ths->compute_flags & PNFFT_COMPUTE_GRAD_F) ? halo->unit_grad_f : 0;
+  const INT unit = unit_f + unit_grad_f;
+
+  if(unit == 0)
+    return;
+
+  for(INT k=0; k<halo->recv_M; k++){
+    R *buf = halo->recv_buf + unit*k;
+    if(unit_f)
+      memcpy(buf, halo->f + unit_f*k, sizeof(R) * (size_t) unit_f);
+    if(unit_grad_f)
+      memcpy(buf + unit_f, halo->grad_f + unit_grad_f*k, sizeof(R) * (size_t) unit_grad_f);
+  }
+
+  exchange_values(halo, 1, unit, halo->recv_buf, halo->send_buf, stats);
+
+  /* a node may have several copies, but every copy is added by the owner alone */
+  for(INT k=0; k<halo->send_M; k++){
+    const R *buf = halo->send_buf + unit*k;
+    INT j = halo->send_index[k];
+    for(INT l=0; l<unit_f; l++)
+      ths->f[unit_f*j + l] += buf[l];
+    for(INT l=0; l<unit_grad_f; l++)
+      ths->grad_f[unit_grad_f*j + l] += buf[unit_f + l];
+  }
+}
+
+
+/* Range -1 <= lo[t] <= hi[t] <= 1 of the neighbor offsets along every axis that the support
+ * of node 'x' reaches. Returns 0, if the support lies within the local block. */
+static int node_sides(
+    const PNX(plan) ths, const R *x, const INT *pad,
+    int *lo, int *hi
+    )
+{
+  int cross = 0;
+
+  for(int t=0; t<3; t++){
+    INT u = (INT) pnfft_floor(ths->n[t]*x[t]) - ths->m - ths->local_no_start[t];
+    lo[t] = (u < 0) ? -1 : 0;
+    hi[t] = (u + pad[t] >= ths->local_no[t]) ? 1 : 0;
+    cross |= lo[t] | hi[t];
+  }
+
+  return cross;
+}
+
+/* Send 'unit' reals per copy from the owner to the neighbors, or back with 'reverse'.
+ * If stats is not NULL, the posting and waiting times and the bytes sent to other processes are added. */
+static void exchange_values(
+    const PNX(halo) halo, int reverse, INT unit,
+    R *send, R *recv, double *stats
+    )
+{
+  const int *count_send = (reverse) ? halo->recv_count : halo->send_count;
+  const int *count_recv = (reverse) ? halo->send_count : halo->recv_count;
+  MPI_Request req[2*HALO_MAX_NEIGHBORS];
+  INT offset_send = 0, offset_recv = 0;
+  double time = MPI_Wtime(), bytes = 0;
+  int myrank;
+
+  MPI_Comm_rank(halo->comm, &myrank);
+  for(int k=0; k<halo->num_neighbors; k++){
+    MPI_Irecv(recv + unit*offset_recv, (int) (unit*count_recv[k]), PNFFT_MPI_REAL_TYPE,
+        halo->neighbor[k], HALO_TAG_VALUES + reverse, halo->comm, &req[2*k]);
+    MPI_Isend(send + unit*offset_send, (int) (unit*count_send[k]), PNFFT_MPI_REAL_TYPE,
+        halo->neighbor[k], HALO_TAG_VALUES + reverse, halo->comm, &req[2*k+1]);
+    if(halo->neighbor[k] != myrank)
+      bytes += (double) (unit*count_send[k]) * sizeof(R);
+    offset_send += count_send[k];
+    offset_recv += count_recv[k];
+  }
+  if(stats != NULL){
+    stats[PNFFTI_COMM_POST] += MPI_Wtime() - time;
+    stats[PNFFTI_COMM_BYTES] += bytes;
+    time = MPI_Wtime();
+  }
+  MPI_Waitall(2*halo->num_neighbors, req, MPI_STATUSES_IGNORE);
+  if(stats != NULL)
+    stats[PNFFTI_COMM_WAIT] += MPI_Wtime() - time;
+}
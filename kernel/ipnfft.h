@@ -34,6 +34,8 @@
 #define PNFFT_DEBUG_USE_SINC_POWER    0
 
 #define PNFFT_SORT_RADIX 1
+/* edge length of the tiles of PNFFT_SORT_KEYS_TILED without spread tiles */
+#define PNFFT_SORT_TILE 16
 
 /* Begin: This part is based on ifftw3.h */
 #include <stdlib.h>             /* size_t */
@@ -46,6 +48,10 @@
 #include <pfft.h>
 #include <complex.h> // C99 complex-number support
 
+#ifdef PNFFT_OPENMP
+#  include <omp.h>
+#endif
+
 #define IPNFFT_EXTERN extern
 
 typedef ptrdiff_t INT;
@@ -65,11 +71,16 @@ typedef ptrdiff_t INT;
 
 #define PNFFT_PLAIN_INDEX_3D(k, n)      ( k[2] + n[2]*(k[1] + n[1]*k[0]) )
 #define PNFFT_FFTSHIFT(k, N)            ( ((N)/2-1 < (k)) ? (k)-(N) : (k) )
+/* position of the component (a,b), a <= b, in the Hessian order xx, xy, xz, yy, yz, zz */
+#define PNFFT_HESSIAN_INDEX(a, b)       ( (a)*(5-(a))/2 + (b) )
 
 /* all pnfft identifiers start with pnfft (or pnfftf etc.) */
 #define CONCAT(prefix, name) prefix ## name
 
 /* define function names according to used precision */
+/* single precision grid of PNFFT_MIXED_PRECISION */
+typedef float _Complex CS;
+
 #if defined(PNFFT_PREC_SINGLE)
   typedef float R;
   typedef pnfftf_complex C;
@@ -136,6 +147,22 @@ typedef ptrdiff_t INT;
 #define PNFFTI_TRAFO_C2C            (1U<< 0)
 #define PNFFTI_TRAFO_C2R            (1U<< 1)
 
+/* value of the 'interlaced' argument of matrix B for both grids at once,
+ * the non-interlaced and the interlaced field are stored interleaved in g2 */
+#define PNFFTI_INTERLACED_BATCHED   2
+
+/* split-phase execution of PNX(trafo_start) and PNX(adj_start) */
+#define PNFFTI_EXEC_NONE            0
+#define PNFFTI_EXEC_TRAFO           1
+#define PNFFTI_EXEC_ADJ             2
+#define PNFFTI_EXEC_TRAFO_CHUNKED   3
+#define PNFFTI_EXEC_ADJ_CHUNKED     4
+
+/* stages of matrix B of the chunked execution */
+#define PNFFTI_CHUNK_START          0
+#define PNFFTI_CHUNK_NODES          1
+#define PNFFTI_CHUNK_FINISH         2
+
 #define A(ex) /* nothing */
 
 #define PNFFT_PRINT_TIMER_BASIC    (1U<<0)
@@ -152,15 +179,136 @@ typedef ptrdiff_t INT;
 #define PNFFT_FINISH_TIMING(timer) \
    timer += MPI_Wtime();
 
+/* time to post the messages, time to wait for them and bytes sent by one ghost cell
+ * or halo exchange, see PNX(profile_comm) */
+#define PNFFTI_COMM_POST            0
+#define PNFFTI_COMM_WAIT            1
+#define PNFFTI_COMM_BYTES           2
+#define PNFFTI_COMM_STATS           3
+
+/* times of the window evaluation and of the accumulation in loop B, see PNX(set_profile_detail) */
+#define PNFFTI_DETAIL_PSI           0
+#define PNFFTI_DETAIL_ACCUMULATE    1
+#define PNFFTI_DETAIL_TIMES         2
+
+/* timing of one phase that also feeds the profile and the profile hook */
+#define PNFFT_PROFILE_PHASE(ths, timer, slot) \
+   ( ((timer) == (ths)->timer_adj) ? PNFFT_PROFILE_ADJ + (slot) : PNFFT_PROFILE_TRAFO + (slot) )
+#define PNFFT_START_PHASE(ths, timer, slot) \
+   PNFFT_START_TIMING((ths)->comm_cart, (timer)[slot]); \
+   PNX(profile_start)(ths, PNFFT_PROFILE_PHASE(ths, timer, slot));
+#define PNFFT_FINISH_PHASE(ths, timer, slot) \
+   PNX(profile_finish)(ths, PNFFT_PROFILE_PHASE(ths, timer, slot)); \
+   PNFFT_FINISH_TIMING((timer)[slot]);
+
+/* PNFFT_PRE_PSI with float tables, see PNX(set_pre_psi_single) */
+#define PNFFT_PRE_PSI_SINGLE(ths) \
+   ( (ths)->pre_psi_single && ((ths)->pnfft_flags & PNFFT_PRE_PSI) )
+
+/* largest cutoff of float tables, the matrix B unpacks the values of one node on the stack */
+#define PNFFT_PRE_PSI_SINGLE_MAX_CUTOFF 32
+
+/* PNFFT_PRE_FULL_PSI without tables of all nodes, the loops over the nodes fill blocks of tensors */
+#define PNFFT_PRE_PSI_BLOCKED(ths) \
+   ( ((ths)->pnfft_flags & PNFFT_PRE_FULL_PSI) && (ths)->pre_psi_block_bytes > 0 \
+     && !((ths)->pnfft_flags & PNFFT_BATCH_INTERLACED) )
+
 #ifndef PNFFT_H
 typedef struct PNX(plan_s) *PNX(plan);
+typedef struct PNX(arena_s) *PNX(arena);
+typedef struct PNX(solver_s) *PNX(solver);
+typedef struct PNX(nodes_s) *PNX(nodes);
+typedef struct PNX(type3_s) *PNX(type3);
 #endif /* !PNFFT_H */
+typedef struct PNX(ghosts_s) *PNX(ghosts);
+typedef struct PNX(halo_s) *PNX(halo);
+typedef struct PNX(pipe_s) *PNX(pipe);
+
+/* grids that can be shared by the plans of an arena, same order as the memory report */
+#define PNFFTI_GRID_G1        PNFFT_MEMORY_G1
+#define PNFFTI_GRID_G2        PNFFT_MEMORY_G2
+#define PNFFTI_GRID_G1_BUFFER PNFFT_MEMORY_G1_BUFFER
+#define PNFFTI_GRID_G2_SINGLE PNFFT_MEMORY_G2_SINGLE
+#define PNFFTI_GRIDS          4
+
+/* keys of the process wide table cache (see cache.c) */
+#define PNFFT_CACHE_KEY_LENGTH      8
+#define PNFFTI_CACHE_INTPOL_PSI     1
+#define PNFFTI_CACHE_POLY_PSI       2
+#define PNFFTI_CACHE_INV_PHI_HAT    3
+#define PNFFTI_CACHE_PHI_HAT_ES     4
+#define PNFFTI_WINDOW_FLAGS        ((PNFFT_WINDOW_GAUSSIAN| PNFFT_WINDOW_BSPLINE| PNFFT_WINDOW_SINC_POWER| \
+                                     PNFFT_WINDOW_BESSEL_I0| PNFFT_WINDOW_ES| PNFFT_USE_FK_GAUSSIAN_T))
+
+/* evaluation of the window inside the node loops, chosen at plan time (see ndft-parallel.c) */
+#define PNFFTI_PSI_TABLES           0
+#define PNFFTI_PSI_INTPOL           1
+#define PNFFTI_PSI_POLY             2
+#define PNFFTI_PSI_GAUSSIAN         3
+#define PNFFTI_PSI_FAST_GAUSSIAN    4
+#define PNFFTI_PSI_BSPLINE          5
+#define PNFFTI_PSI_SINC_POWER       6
+#define PNFFTI_PSI_BESSEL_I0        7
+#define PNFFTI_PSI_ES               8
+#define PNFFTI_PSI_KAISER_BESSEL    9
+
+/* tensor product kernels of matrix B, chosen at plan time (see assign.c) */
+typedef void (*PNX(spread_c2c_kernel))(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+typedef void (*PNX(spread_r2r_kernel))(
+    R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    R *grid);
+typedef void (*PNX(assign_c2c_kernel))(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+typedef void (*PNX(assign_r2r_kernel))(
+    R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    R *fv);
+
+/* Window values that the adjoint of PNX(adj_op_trafo) evaluates and its trafo reuses. Only the
+ * first 'nodes' nodes of the sorted order fit into the budget, the others are evaluated twice.
+ * Every node set, i.e., also the copies of the particle halo, has its own. */
+typedef struct{
+  INT nodes;                  /**< Nodes with stored values                        */
+  int grad;                   /**< Flag, if the derivatives are stored as well     */
+  int filled[2];              /**< Flag, if adj stored the values of both grids    */
+  R *psi[2], *dpsi[2];        /**< 3*cutoff values per node, [1] for interlacing   */
+} PNX(shared_psi);
+
+/* node loops of matrix B specialized for one window evaluation, chosen at plan time */
+typedef void (*PNX(gather_nodes_kernel))(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index, int select,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, R *pre_dpsi, PNX(shared_psi) *shared,
+    R *rsum, R *rsum_derive, double *times);
+typedef R (*PNX(spread_node_kernel))(
+    PNX(plan) ths, INT p, INT j,
+    INT *local_no_start, INT *gcells_below, int interlaced,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, PNX(shared_psi) *shared, double *times);
+
+/* Matrix B of PNFFT_SPARSE_B in compressed row storage, one row per node */
+typedef struct{
+  INT rows, nnz;
+  INT *node;                  /**< Node of each row, the rows follow the sorted order */
+  INT *start;                 /**< Entries of row p are start[p], ..., start[p+1]-1 */
+  int *index;                 /**< Grid point of every entry within g2 with ghost cells */
+  R *weight;                  /**< Weights, NULL for PNFFT_SPARSE_B_SINGLE        */
+  float *weight_single;       /**< Weights of PNFFT_SPARSE_B_SINGLE               */
+  INT num_slabs;              /**< Slabs of cutoff planes along the first axis    */
+  INT *slab_start;            /**< Rows of slab s are slab_rows[slab_start[s]], ...,
+                                   slab_rows[slab_start[s+1]-1]                   */
+  INT *slab_rows;
+} PNX(sparse_b);
 
 typedef struct PNX(plan_s){                                                                      
   INT N_total;                /**< Total number of Fourier coefficients            */
   C *f_hat;                   /**< Vector of Fourier coefficients                  */
   R *f;                       /**< Vector of samples                               */
   R *grad_f;                  /**< Vector of gradients                             */
+  R *hessian_f;               /**< Vector of Hessians, six components per node     */
   R *x;                       /**< Nodes in time/spatial domain                    */
                                                                                      
   int d;                      /**< Dimension, rank                                 */
@@ -177,43 +325,120 @@ typedef struct PNX(plan_s){
   INT *local_no;              /**< Local FFT output length                         */
   INT *local_no_start;        /**< Offset FFT output offset                        */
   INT local_no_total;         /**< Total number of local FFT outputs               */
+  INT howmany;                /**< Number of interleaved fields per node           */
                                                                                      
   R *b;                       /**< Shape parameter of Gaussian window function     */
   R *exp_const;               /**< Precomputed values for Fast Gaussian window     */
                                                                                      
-  R *spline_coeffs;           /**< Input for de Boor algorithm, if B_SPLINE or       
-                                   SINC_POWER is used                              */
+  R *spline_coeffs;           /**< Piecewise polynomials of the Bspline, if B_SPLINE
+                                   or SINC_POWER is used                           */
+  R *phi_hat_es;              /**< Tabulated ES window Fourier coefficients          
+                                   for 0 <= k <= n/2, one 1d table per axis        */
                                                                                      
   C *pre_inv_phi_hat_trafo;   /**< Precomputed inverse window Fourier coefficients   
-                                   for NFFT trafo                                  */
+                                   for NFFT trafo, one 1d table per axis           */
   C *pre_inv_phi_hat_adj;     /**< Precomputed inverse window Fourier coefficients   
                                    for adjoint NFFT                                */
+  C *pre_inv_phi_hat_trafo_il;/**< Precomputed inverse window Fourier coefficients   
+                                   times interlacing modulation for NFFT trafo     */
+  C *pre_inv_phi_hat_adj_il;  /**< Precomputed inverse window Fourier coefficients   
+                                   times interlacing modulation for adjoint NFFT   */
 
   R *pre_psi;                 /**< Precomputed window function values              */
   R *pre_dpsi;                /**< Precomputed window function derivatives         */
   R *pre_psi_il;              /**< Precomputed window function values, interlaced  */
   R *pre_dpsi_il;             /**< Precomputed window function derivatives, interlaced */
+  INT pre_psi_block_bytes;    /**< Budget per thread for blocks of PNFFT_PRE_FULL_PSI,
+                                   0 stores the tensors of all nodes               */
+  INT shared_psi_bytes;       /**< Budget per process of the shared window values,
+                                   negative for the size of g2                     */
+  PNX(shared_psi) *shared_psi; /**< Window values of a running PNX(adj_op_trafo)    */
+  INT spread_tile;            /**< Tile width of the subproblem spreading in adj,
+                                   0 spreads directly onto g2                      */
+  int sparse_b_mode;          /**< PNFFT_SPARSE_B_OFF, PNFFT_SPARSE_B or _SINGLE    */
+  R sparse_b_threshold;       /**< Dropped weights relative to the largest of a node */
+  PNX(sparse_b) *sparse_b[2]; /**< Matrix B of the non-interlaced and the interlaced
+                                   grid, NULL if not precomputed                   */
                                                                                      
   unsigned pnfft_flags;        /**< Flags for precomputation, (de)allocation,        
                                    and FFTW usage                                  */
   unsigned compute_flags;     /**< Flags for choice of NFFT results                */
   unsigned trafo_flag;        /**< Flags for choice of transformation type         */
   unsigned pfft_opt_flags;    /**< Flags for PFFT optimization                     */
+  int direction;              /**< PNFFT_TRAFO_AND_ADJ, _TRAFO_ONLY or _ADJ_ONLY   */
                                                                                      
   /* internal*/                                                                      
   PX(plan)   pfft_forw;       /**< Forward PFFT plan                               */
   PX(plan)   pfft_back;       /**< Backward PFFT plan                              */
   PX(gcplan) gcplan;          /**< PFFT Ghostcell plan                             */
+  PX(plan)   pfft_forw_ik;    /**< Forward PFFT plan of potential and ik gradient  */
+  PX(gcplan) gcplan_ik;       /**< Ghostcell plan of potential and ik gradient     */
+  PX(plan)   pfft_forw_il;    /**< Forward PFFT plan of both interlacing grids     */
+  PX(plan)   pfft_back_il;    /**< Backward PFFT plan of both interlacing grids    */
+  PX(gcplan) gcplan_il;       /**< Ghostcell plan of both interlacing grids        */
+  int ghost_engine;           /**< PNFFT_GHOSTS_PFFT, _PERSISTENT or _SHARED       */
+  int ghost_float_wire;       /**< Flag of PNFFT_GHOSTS_FLOAT_WIRE                 */
+  PNX(ghosts) ghosts;         /**< Ghost cell engine replacing gcplan or NULL      */
+  PNX(ghosts) ghosts_ik;      /**< Ghost cell engine replacing gcplan_ik or NULL   */
+  PNX(ghosts) ghosts_il;      /**< Ghost cell engine replacing gcplan_il or NULL   */
+  PNX(pipe) pipe;             /**< Second buffer set of the pipelined transforms   */
+  int halo_mode;              /**< PNFFT_HALO_OFF, PNFFT_HALO or PNFFT_HALO_AUTO   */
+  int boundary[3];            /**< PNFFT_BOUNDARY_PERIODIC or _OPEN per axis       */
+  R *buffer_il;               /**< Buffer for averaging the interlaced results     */
+  INT buffer_il_size;         /**< Number of reals in buffer_il                    */
+  int progress_mode;          /**< PNFFT_PROGRESS_CALLS or PNFFT_PROGRESS_THREAD   */
+  int exec_kind;              /**< Running split-phase or chunked execution or PNFFTI_EXEC_NONE */
+  int exec_step;              /**< Next step of the split-phase execution          */
+  R *exec_buffer;             /**< Results of the first interlacing pass           */
+  void *exec_thread;          /**< Progress thread of PNFFT_PROGRESS_THREAD or NULL */
+  int exec_split;             /**< Flag, if PNX(progress) tests the ghost cells    */
+  PNX(ghosts) split_ghosts;   /**< Engine with posted ghost cells or NULL          */
+  int split_adj;              /**< Flag, if split_ghosts runs the reduce           */
+  int split_done;             /**< Flag, if the messages of split_ghosts arrived   */
+  double split_stats[PNFFTI_COMM_STATS]; /**< Times and bytes of split_ghosts      */
                                                                                      
   R *g1;                      /**< Input of PFFT                                   */
   R *g2;                      /**< Output of PFFT                                  */
   R *g1_buffer;               /**< Buffer for computing Fourier-space derivatives  */
+  CS *g2_single;              /**< Single precision copy of g2 including ghost
+                                   cells, if PNFFT_MIXED_PRECISION               */
+  INT grid_bytes[PNFFTI_GRIDS];/**< Size of g1, g2, g1_buffer and g2_single       */
+  PNX(arena) arena;           /**< Scratch arena of the plan or NULL               */
+  unsigned shared_grids;      /**< Bit mask of the grids taken from the arena      */
+  unsigned alloc_flags;       /**< Placement flags of the grids                    */
+  int grid_alloc[PNFFTI_GRIDS];/**< Allocation method of the private grids         */
                                                                                      
   int cutoff;                 /**< cutoff range                                    */
+  PNX(spread_c2c_kernel) spread_f_c2c_kernel; /**< Spreading kernel for cutoff    */
+  PNX(spread_r2r_kernel) spread_f_r2r_kernel; /**< Spreading kernel for cutoff    */
+  PNX(assign_c2c_kernel) assign_f_c2c_kernel; /**< Assignment kernel for cutoff   */
+  PNX(assign_r2r_kernel) assign_f_r2r_kernel; /**< Assignment kernel for cutoff   */
+  int psi_kind;               /**< Window evaluation of the node loops             */
+  PNX(gather_nodes_kernel) gather_nodes_kernel; /**< Trafo node loop for psi_kind */
+  PNX(spread_node_kernel) spread_node_kernel;   /**< Adjoint node for psi_kind    */
+  int prune_stencil;          /**< Flag, if the kernels skip negligible weights    */
+  int pre_psi_single;         /**< Flag, if PNFFT_PRE_PSI tables are stored as float */
   INT local_M;                /**< Number of local nodes                           */
+  INT local_M_capacity;       /**< Number of nodes that fit into x, f and grad_f   */
+  PNX(nodes) nodes;           /**< Attached node set, NULL for the own nodes       */
+  PNX(halo) halo;             /**< Particle halo of the current nodes or NULL      */
+  INT *sorted_index;          /**< Cached permutation of the sorted nodes          */
+  int sorted_index_valid;     /**< Flag, if sorted_index fits to the current nodes */
+  int nodes_in_order;         /**< Flag, if the nodes are stored in sorted order   */
+  int sort_keys;              /**< PNFFT_SORT_KEYS_PLAIN, _TILED or _MORTON        */
+  INT *node_order;            /**< Original index of every node after sort_nodes,
+                                   NULL if the nodes were not reordered            */
+                                                                                     
+  /* communication pattern of redistribute_nodes */                                  
+  INT redist_M;               /**< Number of nodes given by the user               */
+  INT *redist_perm;           /**< Send buffer position of every user node         */
+  int *redist_sendcounts;     /**< Number of user nodes sent to every process      */
+  int *redist_senddispls;     /**< Send buffer offsets of every process            */
+  int *redist_recvcounts;     /**< Number of nodes received from every process     */
+  int *redist_recvdispls;     /**< Offsets of the local nodes of every process     */
                                                                                      
   /* parameters for window interpolation table */                                    
-  int intpol_order;           /**< order of window interpolation                   */
+  int intpol_order;           /**< order of window interpolation (poly degree)     */
   INT intpol_num_nodes;       /**< number of sampled points for interpolation      */
   R **intpol_tables_psi;      /**< sampled values of window functions              */
   R **intpol_tables_dpsi;     /**< sampled values of window function derivatives   */
@@ -225,6 +450,11 @@ typedef struct PNX(plan_s){
                                                                                      
   double* timer_trafo;        /**< Saves time measurements during PNFFT            */
   double* timer_adj;          /**< Saves time measurements during adjoint PNFFT    */
+  double* profile;            /**< Time, calls and bytes of every profile phase    */
+  PNX(profile_hook) profile_hook; /**< User callback at start and end of phases   */
+  void *profile_hook_data;    /**< User data passed to profile_hook                */
+  int profile_detail;         /**< Flag, if loop B times psi and accumulation      */
+  PNX(backend) backend;       /**< Function table of matrix B                      */
 } plan_s;
 
 #if PNFFT_ENABLE_DEBUG
@@ -268,6 +498,8 @@ void PNX(sort_node_indices_radix_lsdf)(
     INT n, INT *keys0, INT *keys1, INT rhigh);
 void PNX(sort_node_indices_radix_msdf)(
     INT n, INT *keys0, INT *keys1, INT rhigh);
+void PNX(sort_node_indices_incremental)(
+    INT n, INT *keys0, INT *keys1, INT rhigh);
 void PNX(sort_nodes_indices_qsort_3d)(
     const INT *n, int m, INT local_M, const R *x,
     INT *sort);
@@ -283,24 +515,178 @@ double* PNX(mktimer)(
 void PNX(rmtimer)(
     double* timer);
 
+/* profile.c */
+double* PNX(mkprofile)(
+    void);
+void PNX(rmprofile)(
+    double *profile);
+void PNX(profile_start)(
+    PNX(plan) ths, int phase);
+void PNX(profile_finish)(
+    PNX(plan) ths, int phase);
+void PNX(profile_add)(
+    PNX(plan) ths, int phase, double time, double bytes);
+void PNX(profile_comm)(
+    PNX(plan) ths, int adj, const double *stats);
+void PNX(profile_detail_times)(
+    PNX(plan) ths, int adj, const double *times);
+
+/* backend.c */
+void PNX(init_backend)(
+    PNX(plan) ths);
+int PNX(host_backend)(
+    const PNX(plan) ths, int adj);
+void PNX(trafo_B_backend)(
+    PNX(plan) ths, int interlaced);
+void PNX(adjoint_B_backend)(
+    PNX(plan) ths, int interlaced);
+
+/* wisdom.c */
+int PNX(wisdom_lookup_planner)(
+    int num_procs, unsigned pnfft_flags, INT M,
+    const INT *N, const R *x_max, R eps,
+    INT *n, int *m, unsigned *window_flag);
+void PNX(wisdom_add_planner)(
+    int num_procs, unsigned pnfft_flags, INT M,
+    const INT *N, const R *x_max, R eps,
+    const INT *n, int m, unsigned window_flag);
+
+/* memory.c */
+void* PNX(alloc_grid)(
+    PNX(plan) ths, int grid, INT bytes);
+void PNX(free_grid)(
+    PNX(plan) ths, int grid, void *data);
+void PNX(arena_attach)(
+    PNX(plan) ths);
+void PNX(arena_detach)(
+    PNX(plan) ths);
+PNX(arena) PNX(get_plan_arena)(
+    void);
+unsigned PNX(get_plan_alloc)(
+    void);
+void PNX(first_touch)(
+    const PNX(plan) ths, void *data, size_t bytes);
+void* PNX(scratch_malloc)(
+    PNX(plan) ths, size_t bytes);
+void PNX(scratch_free)(
+    PNX(plan) ths, void *data);
+
+/* ghosts.c */
+PNX(ghosts) PNX(mkghosts)(
+    const INT *local_no, const INT *gc_below, const INT *gc_above, INT unit,
+    int shared, int float_wire, const int *open, MPI_Comm comm_cart);
+int PNX(ghosts_on_node)(
+    const PNX(ghosts) ths, int rank);
+void PNX(rmghosts)(
+    PNX(ghosts) ths);
+INT PNX(ghosts_memory)(
+    const PNX(ghosts) ths);
+void PNX(ghosts_exchange)(
+    PNX(ghosts) ths,
+    R *grid, double *stats);
+void PNX(ghosts_reduce)(
+    PNX(ghosts) ths,
+    R *grid, double *stats);
+void PNX(ghosts_exchange_post)(
+    PNX(ghosts) ths,
+    R *grid, double *stats);
+int PNX(ghosts_exchange_test)(
+    PNX(ghosts) ths,
+    R *grid, int wait, double *stats);
+void PNX(ghosts_reduce_post)(
+    PNX(ghosts) ths,
+    R *grid, double *stats);
+int PNX(ghosts_reduce_test)(
+    PNX(ghosts) ths,
+    R *grid, int wait, double *stats);
+
+/* halo.c */
+PNX(halo) PNX(mkhalo)(
+    PNX(plan) ths, int automatic);
+void PNX(rmhalo)(
+    PNX(halo) halo, PNX(plan) ths);
+void PNX(init_halo)(
+    PNX(plan) ths);
+void PNX(free_halo)(
+    PNX(plan) ths);
+void PNX(halo_attach)(
+    PNX(halo) halo, PNX(plan) ths);
+void PNX(halo_detach)(
+    PNX(halo) halo, PNX(plan) ths);
+int PNX(halo_has_grad_f)(
+    const PNX(halo) halo);
+INT PNX(halo_grid_size)(
+    const PNX(halo) halo,
+    INT *pad, INT *local_ngc);
+void PNX(halo_expand)(
+    const PNX(halo) halo, const R *g2,
+    R *grid);
+void PNX(halo_shrink)(
+    const PNX(halo) halo, const R *grid,
+    R *g2);
+void PNX(halo_scatter_f)(
+    const PNX(halo) halo, const PNX(plan) ths,
+    double *stats);
+void PNX(halo_gather_f)(
+    const PNX(halo) halo, PNX(plan) ths,
+    double *stats);
+
+/* pipeline.c */
+void PNX(free_pipe)(
+    PNX(plan) ths);
+
+/* cache.c */
+void PNX(window_cache_key)(
+    const PNX(plan) ths, int kind, int dim, double p0, double p1, double p2,
+    double *key);
+int PNX(cache_fetch)(
+    const double *key, INT size, MPI_Comm comm,
+    R *data);
+void PNX(cache_insert)(
+    const double *key, INT size, const R *data);
+void PNX(table_chunk)(
+    INT size, MPI_Comm comm,
+    INT *start, INT *end);
+void PNX(allgather_table)(
+    INT size, MPI_Comm comm,
+    R *data);
+
 /* ndft-parallel.c */
 void PNX(init_precompute_window)(
     PNX(plan) ths);
+int PNX(init_shared_psi)(
+    PNX(plan) ths);
+void PNX(free_pre_psi)(
+    PNX(plan) ths);
+void PNX(free_shared_psi)(
+    PNX(plan) ths);
+void PNX(free_sparse_b)(
+    PNX(plan) ths);
+void PNX(init_ghost_engine)(
+    PNX(plan) ths);
+void PNX(free_ghost_engine)(
+    PNX(plan) ths);
+void PNX(invalidate_sorted_index)(
+    PNX(plan) ths);
+void PNX(free_sorted_index)(
+    PNX(plan) ths);
 void PNX(rmplan)(
     PNX(plan) ths);
+int PNX(get_plan_direction)(
+    void);
 INT PNX(local_size_internal)(
-    const INT *N, const INT *n, const INT *no,
+    int d, const INT *N, const INT *n, const INT *no, INT howmany,
     MPI_Comm comm_cart_2d,
     unsigned trafo_flag, unsigned pnfft_flags,
     INT *local_N, INT *local_N_start,
     INT *local_no, INT *local_no_start);
 void PNX(local_block_internal)(
-    const INT *N, const INT *no,
+    int d, const INT *N, const INT *no,
     MPI_Comm comm_cart, int pid,
     unsigned pnfft_flags, unsigned trafo_flag,
     INT *local_N, INT *local_N_start);
 PNX(plan) PNX(init_internal)(
-    int d, const INT *N, const INT *n, const INT *no,
+    int d, const INT *N, const INT *n, const INT *no, INT howmany,
     INT local_M, int m,
     unsigned trafo_flag, unsigned pnfft_flags, unsigned pfft_opt_flags,
     MPI_Comm comm_cart_2d);
@@ -312,12 +698,27 @@ void PNX(trafo_F)(
     PNX(plan) ths);
 void PNX(adjoint_F)(
     PNX(plan) ths);
+void PNX(plan_grid_fft)(
+    const PNX(plan) ths, R *g1, R *g2, MPI_Comm comm_cart,
+    PX(plan) *forw, PX(plan) *back, PX(gcplan) *gcplan);
 void PNX(trafo_B_grad_ad)(
     PNX(plan) ths, int interlaced);
 void PNX(trafo_B_grad_ik)(
     PNX(plan) ths, R *f, INT offset, INT stride, int interlaced);
+void PNX(trafo_B_grad_ik_batched)(
+    PNX(plan) ths, int interlaced);
 void PNX(adjoint_B)(
     PNX(plan) ths, int interlaced);
+int PNX(trafo_B_post)(
+    PNX(plan) ths, int interlaced);
+int PNX(gcells_test)(
+    PNX(plan) ths);
+void PNX(gcells_wait)(
+    PNX(plan) ths);
+void PNX(trafo_B_chunked)(
+    PNX(plan) ths, int stage);
+void PNX(adjoint_B_chunked)(
+    PNX(plan) ths, int stage);
 void PNX(malloc_x)(
     PNX(plan) ths, unsigned pnfft_flags);
 void PNX(free_x)(
@@ -330,6 +731,10 @@ void PNX(malloc_grad_f)(
     PNX(plan) ths, unsigned pnfft_flags);
 void PNX(free_grad_f)(
     PNX(plan) ths, unsigned pnfft_finalize_flags);
+void PNX(malloc_hessian_f)(
+    PNX(plan) ths, unsigned pnfft_flags);
+void PNX(free_hessian_f)(
+    PNX(plan) ths, unsigned pnfft_finalize_flags);
 void PNX(node_borders)(
     const INT *n,
     const INT *local_no, const INT *local_no_start,
@@ -338,8 +743,36 @@ void PNX(node_borders)(
 void PNX(scale_ik_diff_c2c)(
     const C* g1_buffer, INT *local_N_start, INT *local_N, int dim, unsigned pnfft_flags,
     C* g1);
+void PNX(scale_ik_diff_batched_c2c)(
+    INT *local_N_start, INT *local_N, unsigned pnfft_flags,
+    C* g1);
+
+/* redistribute.c */
+void PNX(exchange_redistributed)(
+    PNX(plan) ths, int howmany, int backward,
+    R *user_data, R *local_data);
+void PNX(free_redistribution)(
+    PNX(plan) ths);
+
+/* planner.c */
+R PNX(window_error_estimate)(
+    unsigned window_flag, int m, R sigma);
+R PNX(window_shape_parameter)(
+    unsigned window_flag, int m, R sigma);
+R PNX(intpol_error_estimate)(
+    int intpol_order, INT num_nodes);
+INT PNX(default_intpol_num_nodes)(
+    int cutoff);
+unsigned PNX(intpol_flag_for_accuracy)(
+    int m, R eps);
+int PNX(planner_candidates)(
+    int d, const INT *N, R eps, INT local_M, int num_procs,
+    unsigned pnfft_flags, int max_num,
+    INT *n_cand, int *m_cand, unsigned *window_cand);
 
 /* assign.c */
+void PNX(init_assign_kernels)(
+    PNX(plan) ths);
 void PNX(spread_f_c2c)(
     PNX(plan) ths, INT ind,
     C f, R *pre_psi, INT m0, INT *local_ngc, int cutoff,
@@ -350,10 +783,26 @@ void PNX(spread_f_r2r)(
     R f, R *pre_psi, INT m0, INT *local_ngc, int cutoff, INT ostride,
     int interlaced,
     R *grid);
+void PNX(spread_f_c2c_many)(
+    PNX(plan) ths, INT ind,
+    const C *f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT howmany, int interlaced,
+    C *grid);
+void PNX(spread_f_c2c_strided)(
+    PNX(plan) ths, INT ind,
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride, int interlaced,
+    C *grid);
 void PNX(assign_f_c2c)(
     PNX(plan) ths, INT ind,
     C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, int interlaced,
     C *f);
+void PNX(assign_f_c2c_many)(
+    PNX(plan) ths, INT ind,
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT howmany, int interlaced,
+    C *f);
+void PNX(assign_f_c2c_strided)(
+    PNX(plan) ths, INT ind,
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride, int interlaced,
+    C *f);
 void PNX(assign_f_r2r)(
     PNX(plan) ths, INT ind,
     R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride, int interlaced,
@@ -362,6 +811,14 @@ void PNX(assign_grad_f_c2c)(
     PNX(plan) ths, INT ind,
     C *grid, R *pre_psi, R *pre_dpsi, INT m0, INT *grid_size, int cutoff, int interlaced,
     C *grad_f);
+void PNX(spread_f_c2c_single)(
+    PNX(plan) ths, INT ind,
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, int interlaced,
+    CS *grid);
+void PNX(assign_f_c2c_single)(
+    PNX(plan) ths, INT ind,
+    const CS *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, int interlaced,
+    C *f);
 void PNX(assign_grad_f_r2r)(
     PNX(plan) ths, INT ind,
     R *grid, R *pre_psi, R *pre_dpsi, INT m0, INT *grid_size, int cutoff,
@@ -385,6 +842,18 @@ void PNX(spread_f_c2c_pre_psi)(
 void PNX(spread_f_c2c_pre_full_psi)(
     C f, R *pre_psi, INT m0, INT *grid_size, int cutoff,
     C *grid);
+void PNX(spread_f_c2c_many_pre_psi)(
+    const C *f, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+void PNX(spread_f_c2c_many_pre_full_psi)(
+    const C *f, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *grid);
+void PNX(spread_f_c2c_strided_pre_psi)(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    C *grid);
+void PNX(spread_f_c2c_strided_pre_full_psi)(
+    C f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
+    C *grid);
 void PNX(spread_f_r2r_pre_psi)(
     R f, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT ostride,
     R *grid);
@@ -398,6 +867,18 @@ void PNX(assign_f_c2c_pre_psi)(
 void PNX(assign_f_c2c_pre_full_psi)(
     C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff,
     C *fv);
+void PNX(assign_f_c2c_many_pre_psi)(
+    C *grid, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+void PNX(assign_f_c2c_many_pre_full_psi)(
+    C *grid, INT howmany, R *pre_psi, INT m0, INT *grid_size, int cutoff,
+    C *fv);
+void PNX(assign_f_c2c_strided_pre_psi)(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    C *fv);
+void PNX(assign_f_c2c_strided_pre_full_psi)(
+    C *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
+    C *fv);
 void PNX(assign_f_r2r_pre_psi)(
     R *grid, R *pre_psi, INT m0, INT *grid_size, int cutoff, INT istride,
     R *fv);
@@ -430,56 +911,14 @@ void PNX(assign_f_and_grad_f_r2r_pre_psi)(
 void PNX(assign_f_and_grad_f_r2r_pre_full_psi)(
     R *grid, R *pre_psi, R *pre_dpsi, INT m0, INT *grid_size, int cutoff, INT istride, INT ostride,
     R *fv, R *grad_f);
+void PNX(assign_hessian_f_c2c)(
+    C *grid, R *pre_psi, R *pre_dpsi, R *pre_d2psi, INT m0, INT *grid_size, int cutoff,
+    C *fv, C *grad_f, C *hessian_f);
+void PNX(assign_hessian_f_r2r)(
+    R *grid, R *pre_psi, R *pre_dpsi, R *pre_d2psi, INT m0, INT *grid_size, int cutoff, INT istride, INT ostride,
+    R *fv, R *grad_f, R *hessian_f);
 
 
-
-
-/** constant spline interpolation */
-static inline R pnfft_intpol_const(
-    int k, const R *table
-    )
-{
-  return table[k];
-}
-
-/** linear spline interpolation */
-static inline R pnfft_intpol_lin(
-    int k, R dist, const R *table
-    )
-{
-  R f1,f2;
-  f1=table[k]; f2=table[k+1];
-  return f1*(1.0-dist) + f2*dist;
-}
-
-/** quadratic spline interpolation */
-static inline R pnfft_intpol_quad(
-    int k, R dist, const R *table
-    )
-{
-  R c0,c1,c2,f0,f1,f2;
-  f0=table[k]; f1=table[k+1]; f2=table[k+2];
-  c0=dist+1.0;
-  c1=dist;
-  c2=dist-1.0;
-  return (0.5*f0*c1*c2-c0*f1*c2+0.5*c0*c1*f2);
-}
-
-/** cubic spline interpolation */
-static inline R pnfft_intpol_kub(
-    int k, R dist, const R *table
-    )
-{
-  R c0,c1,c2,c3;
-  R f0,f1,f2,f3;
-  f0=table[k]; f1=table[k+1]; f2=table[k+2]; f3=table[k+3];
-  c0=dist+1.0;
-  c1=dist;
-  c2=dist-1.0;
-  c3=dist-2.0;
-  return(-f0*c1*c2*c3+3.0*c0*f1*c2*c3-3.0*c0*c1*f2*c3+c0*c1*c2*f3)/6.0;
-}
-
 /* liberfc */
 #include <../cerf/cerf.h>
 
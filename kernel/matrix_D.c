@@ -55,7 +55,7 @@ static inline R inv_phi_hat_gauss_t(
 }
 
 static inline R phi_hat_gauss_t(
-    INT k, INT n, R b, int m
+    R k, INT n, R b, int m
     )
 {
   R sqrtb = pnfft_sqrt(b);
@@ -77,7 +77,7 @@ static inline R inv_phi_hat_kaiser(
 }
 
 static inline R phi_hat_kaiser(
-    INT k, INT n, R b, int m
+    R k, INT n, R b, int m
     )
 {
   R d = PNFFT_SQR( b ) - PNFFT_SQR( 2.0 * PNFFT_PI * (R)k / (R)n );
@@ -88,6 +88,51 @@ static inline R phi_hat_kaiser(
   return (d>0) ? PNX(bessel_i0)(m*pnfft_sqrt(d)) : 1.0;
 }
 
+static int es_quad_num_nodes(
+    int m);
+static void gauss_legendre_unit(
+    int q,
+    R *nodes, R *weights);
+
+/* ES window psi(u/n) = exp(b*(sqrt(1-(u/m)^2)-1)), |u| <= m: no closed form,
+ * integrate phi_hat(k) = 2m int_0^1 psi(m t/n) cos(2 pi k m t/n) dt by Gauss-Legendre.
+ * The substitution t = sin(theta) removes the square root singularity at t=1. */
+static R phi_hat_es_quad(
+    R k, INT n, R b, int m,
+    int q, const R *nodes, const R *weights
+    )
+{
+  R sum = 0;
+  for(int j=0; j<q; j++){
+    R theta = 0.5 * PNFFT_PI * nodes[j];
+    sum += weights[j] * pnfft_exp( b * (pnfft_cos(theta) - 1.0) ) * pnfft_cos(theta)
+      * pnfft_cos( 2.0 * PNFFT_PI * (R)k * (R)m * pnfft_sin(theta) / (R)n );
+  }
+  return PNFFT_PI * (R)m * sum;
+}
+
+static inline R phi_hat_es(
+    INT k, int dim, const PNX(plan) ths
+    )
+{
+  INT offset = 0;
+  k = PNFFT_ABS(k);
+
+  for(int t=0; t<dim; t++)
+    offset += ths->n[t]/2 + 1;
+
+  if(ths->phi_hat_es != NULL && k <= ths->n[dim]/2)
+    return ths->phi_hat_es[offset + k];
+
+  /* fall back to quadrature for coefficients outside of the table */
+  int q = es_quad_num_nodes(ths->m);
+  R *nodes = (R*) PNX(malloc)(sizeof(R) * (size_t) (2*q));
+  gauss_legendre_unit(q, nodes, nodes + q);
+  R r = phi_hat_es_quad(k, ths->n[dim], ths->b[dim], ths->m, q, nodes, nodes + q);
+  PNX(free)(nodes);
+  return r;
+}
+
 static inline R inv_phi_hat_bessel_i0(
     INT k, INT n, R b, int m
     )
@@ -102,7 +147,7 @@ static inline R inv_phi_hat_bessel_i0(
 }
 
 static inline R phi_hat_bessel_i0(
-    INT k, INT n, R b, int m
+    R k, INT n, R b, int m
     )
 {
   R d = PNFFT_SQR( b ) - PNFFT_SQR( 2.0 * PNFFT_PI * (R)k / (R)n );
@@ -128,15 +173,15 @@ static inline R inv_phi_hat_sinc_power(
   R d = pnfft_fabs(k * b / n);
 
   /* avoid division by zero for d == m */
-  return (d < m) ? 1.0 / PNX(bspline)(2*m, d + m, spline_coeffs) : 0.0;
+  return (d < m) ? 1.0 / PNX(bspline_poly)(2*m, 0, d + m, spline_coeffs) : 0.0;
 }
 
 static inline R phi_hat_sinc_power(
-    INT k, INT n, R b, int m, R *spline_coeffs
+    R k, INT n, R b, int m, R *spline_coeffs
     )
 {
   R d = pnfft_fabs(k * b / n);
-  return PNX(bspline)(2*m, d + m, spline_coeffs);
+  return PNX(bspline_poly)(2*m, 0, d + m, spline_coeffs);
 }
 
 
@@ -144,27 +189,38 @@ static inline R phi_hat_sinc_power(
 /* For oversampling factor sigma==1 avoid division by zero. */
 /* The factor 1/n from matrix D is computed in matrix B (There it cancels with the factor N of the window). */
 #define PNFFT_INV_PHI_HAT_SINC_POWER(k,N,n,b,m,spline_coeffs) \
-  ( (PNFFT_ABS(k) >= (n) - (N)/2) ? 0.0 : 1.0 / PNX(bspline)(2 * (m), (R)(k) * (b) / ((R) n) + (R)(m), (spline_coeffs)) )
+  ( (PNFFT_ABS(k) >= (n) - (N)/2) ? 0.0 : 1.0 / PNX(bspline_poly)(2 * (m), 0, (R)(k) * (b) / ((R) n) + (R)(m), (spline_coeffs)) )
 
 #define PNFFT_PHI_HAT_SINC_POWER(k,N,n,b,m,spline_coeffs) \
-  ( (PNFFT_ABS(k) >= (n) - (N)/2) ? 0.0 : PNX(bspline)(2 * (m), (R)(k) * (b) / ((R) n) + (R)(m), (spline_coeffs)) )
+  ( (PNFFT_ABS(k) >= (n) - (N)/2) ? 0.0 : PNX(bspline_poly)(2 * (m), 0, (R)(k) * (b) / ((R) n) + (R)(m), (spline_coeffs)) )
 
 
 static void convolution_due_to_interlacing(
     const INT *n,
-    const INT *local_N, const INT *local_N_start,
+    const INT *local_N, const INT *local_N_start, INT howmany,
     unsigned pnfft_flags, int sign,
     C *inout);
 static void convolution_with_general_window(
     const C *in,
     const INT *n,
-    const INT *local_N, const INT *local_N_start,
+    const INT *local_N, const INT *local_N_start, INT howmany,
     unsigned pnfft_flags,
     const PNX(plan) window_param, int sign,
     C *out);
-static void convolution_with_pre_inv_phi_hat(
+static void convolution_two_fields_with_pre_inv_phi_hat(
     const C *in,
     const INT *local_N,
+    const C *pre_inv_phi_hat, const C *pre_inv_phi_hat_il,
+    unsigned pnfft_flags, int sign,
+    C *out);
+static void precompute_interlacing_phases(
+    const INT *n,
+    const INT *local_N, const INT *local_N_start,
+    int sign,
+    C *phases);
+static void convolution_with_pre_inv_phi_hat(
+    const C *in,
+    const INT *local_N, INT howmany,
     const C *pre_inv_phi_hat,
     unsigned pnfft_flags,
     C *out);
@@ -172,6 +228,9 @@ static void precompute_inv_phi_hat_general_window(
     const INT *local_N, const INT *local_N_start,
     const PNX(plan) window_param,
     C *pre_inv_phi_hat);
+static void init_inv_phi_hat_table(
+    const PNX(plan) ths, int dim,
+    R *table);
 
 /* Return the inverse window Fourier coefficients.
  * Since we use tensor product structure, only the return the factor that belongs to dimension 'dim'. */
@@ -179,6 +238,9 @@ R PNX(inv_phi_hat)(
     const PNX(plan) ths, int dim, INT k
     )
 {
+  /* axes of length 1 of plans with d < 3 are not convolved */
+  if(dim >= ths->d)
+    return 1.0;
   if((ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN) && (ths->pnfft_flags & PNFFT_USE_FK_GAUSSIAN_T))
     return inv_phi_hat_gauss_t(k, ths->n[dim], ths->b[dim], ths->m);
   else if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
@@ -189,6 +251,8 @@ R PNX(inv_phi_hat)(
     return inv_phi_hat_sinc_power(k, ths->n[dim], ths->b[dim], ths->m, ths->spline_coeffs);
   else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
     return inv_phi_hat_bessel_i0(k, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_ES)
+    return 1.0 / phi_hat_es(k, dim, ths);
   else
     return inv_phi_hat_kaiser(k, ths->n[dim], ths->b[dim], ths->m);
 }
@@ -197,6 +261,8 @@ R PNX(phi_hat)(
     const PNX(plan) ths, int dim, INT k
     )
 {
+  if(dim >= ths->d)
+    return 1.0;
   if((ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN) && (ths->pnfft_flags & PNFFT_USE_FK_GAUSSIAN_T))
     return phi_hat_gauss_t(k, ths->n[dim], ths->b[dim], ths->m);
   else if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
@@ -207,34 +273,67 @@ R PNX(phi_hat)(
     return phi_hat_sinc_power(k, ths->n[dim], ths->b[dim], ths->m, ths->spline_coeffs);
   else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
     return phi_hat_bessel_i0(k, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_ES)
+    return phi_hat_es(k, dim, ths);
   else
     return phi_hat_kaiser(k, ths->n[dim], ths->b[dim], ths->m);
 }
 
+/* Window Fourier transform at a real frequency k, which is needed for the deconvolution
+ * at nonuniform frequencies of the type-3 NFFT. Agrees with PNX(phi_hat) for integer k. */
+R PNX(phi_hat_real)(
+    const PNX(plan) ths, int dim, R k
+    )
+{
+  if((ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN) && (ths->pnfft_flags & PNFFT_USE_FK_GAUSSIAN_T))
+    return phi_hat_gauss_t(k, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
+    return PNFFT_PHI_HAT_GAUSS(k, ths->n[dim], ths->b[dim]);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_BSPLINE)
+    return PNFFT_PHI_HAT_BSPLINE(k, ths->n[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_SINC_POWER)
+    return phi_hat_sinc_power(k, ths->n[dim], ths->b[dim], ths->m, ths->spline_coeffs);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
+    return phi_hat_bessel_i0(k, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_ES){
+    /* the table of PNFFT_WINDOW_ES holds integer frequencies only */
+    int q = es_quad_num_nodes(ths->m);
+    R *nodes = (R*) PNX(malloc)(sizeof(R) * (size_t) (2*q));
+    gauss_legendre_unit(q, nodes, nodes + q);
+    R r = phi_hat_es_quad(pnfft_fabs(k), ths->n[dim], ths->b[dim], ths->m, q, nodes, nodes + q);
+    PNX(free)(nodes);
+    return r;
+  } else
+    return phi_hat_kaiser(k, ths->n[dim], ths->b[dim], ths->m);
+}
+
 void PNX(trafo_D)(
     PNX(plan) ths, int interlaced
     )
 {
 #if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)((R*)ths->f_hat, ths->local_N[0]*ths->local_N[1]*ths->local_N[2], 1,
+  PNX(debug_sum_print)((R*)ths->f_hat, ths->local_N_total*ths->howmany, 1,
       "PNFFT: Sum of Fourier coefficients before deconvolution");
 #endif
 
-  /* use precomputed window Fourier coefficients if possible */
+  /* use precomputed window Fourier coefficients if possible,
+   * the tables for interlacing already include the modulation */
   if(ths->pnfft_flags & PNFFT_PRE_PHI_HAT){
     convolution_with_pre_inv_phi_hat(
-        ths->f_hat, ths->local_N, ths->pre_inv_phi_hat_trafo, ths->pnfft_flags,
-        (C*)ths->g1);
-  } else {
-    convolution_with_general_window(
-        ths->f_hat, ths->n, ths->local_N, ths->local_N_start, ths->pnfft_flags, ths, FFTW_FORWARD,
+        ths->f_hat, ths->local_N, ths->howmany,
+        (interlaced) ? ths->pre_inv_phi_hat_trafo_il : ths->pre_inv_phi_hat_trafo, ths->pnfft_flags,
         (C*)ths->g1);
+    return;
   }
 
+  convolution_with_general_window(
+      ths->f_hat, ths->n, ths->local_N, ths->local_N_start, ths->howmany, ths->pnfft_flags, ths, FFTW_FORWARD,
+      (C*)ths->g1);
+
   /* interlaced NFFT needs extra modulation to revert the shift in x */
   if(interlaced)
     convolution_due_to_interlacing(
-        ths->n, ths->local_N, ths->local_N_start, ths->pnfft_flags, FFTW_FORWARD,
+        ths->n, ths->local_N, ths->local_N_start, ths->howmany, ths->pnfft_flags, FFTW_FORWARD,
         (C*)ths->g1);
 }
 
@@ -243,130 +342,248 @@ void PNX(adjoint_D)(
     PNX(plan) ths, int interlaced
     )
 {
-  /* use precomputed window Fourier coefficients if possible */
+  /* use precomputed window Fourier coefficients if possible,
+   * the tables for interlacing already include the modulation */
   if(ths->pnfft_flags & PNFFT_PRE_PHI_HAT){
     convolution_with_pre_inv_phi_hat(
-        (C*)ths->g1, ths->local_N, ths->pre_inv_phi_hat_adj, ths->pnfft_flags,
+        (C*)ths->g1, ths->local_N, ths->howmany,
+        (interlaced) ? ths->pre_inv_phi_hat_adj_il : ths->pre_inv_phi_hat_adj, ths->pnfft_flags,
         ths->f_hat);
   } else {
     convolution_with_general_window(
-        (C*)ths->g1, ths->n, ths->local_N, ths->local_N_start, ths->pnfft_flags, ths, FFTW_BACKWARD,
+        (C*)ths->g1, ths->n, ths->local_N, ths->local_N_start, ths->howmany, ths->pnfft_flags, ths, FFTW_BACKWARD,
         ths->f_hat);
+
+    /* interlaced NFFT needs extra modulation to revert the shift in x */
+    if(interlaced)
+      convolution_due_to_interlacing(
+          ths->n, ths->local_N, ths->local_N_start, ths->howmany, ths->pnfft_flags, FFTW_BACKWARD,
+          ths->f_hat);
   }
 
-  /* interlaced NFFT needs extra modulation to revert the shift in x */
-  if(interlaced)
-    convolution_due_to_interlacing(
-        ths->n, ths->local_N, ths->local_N_start, ths->pnfft_flags, FFTW_BACKWARD,
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)((R*)ths->f_hat, ths->local_N_total*ths->howmany, 1,
+      "PNFFT^H: Sum of Fourier coefficients after deconvolution");
+#endif
+}
+
+/* Deconvolution for the non-interlaced and the interlaced grid at once.
+ * g1 holds both fields interleaved, as needed by the FFT with howmany=2. */
+void PNX(trafo_D_interlaced_batched)(
+    PNX(plan) ths
+    )
+{
+  C *g1 = (C*)ths->g1;
+  C *upper, *phases;
+
+  if(ths->pnfft_flags & PNFFT_PRE_PHI_HAT){
+    convolution_two_fields_with_pre_inv_phi_hat(
+        ths->f_hat, ths->local_N, ths->pre_inv_phi_hat_trafo, ths->pre_inv_phi_hat_trafo_il,
+        ths->pnfft_flags, FFTW_FORWARD,
+        g1);
+    return;
+  }
+
+  /* deconvolve into the upper half of g1, such that the expansion can run in place */
+  upper = g1 + ths->local_N_total;
+  convolution_with_general_window(
+      ths->f_hat, ths->n, ths->local_N, ths->local_N_start, 1, ths->pnfft_flags, ths, FFTW_FORWARD,
+      upper);
+
+  phases = (C*) PNX(malloc)(sizeof(C) * (size_t) PNX(sum_INT)(3, ths->local_N));
+  precompute_interlacing_phases(ths->n, ths->local_N, ths->local_N_start, FFTW_FORWARD,
+      phases);
+  convolution_two_fields_with_pre_inv_phi_hat(
+      upper, ths->local_N, NULL, phases, ths->pnfft_flags, FFTW_FORWARD,
+      g1);
+  PNX(free)(phases);
+}
+
+/* Average the non-interlaced and the interlaced field of g1 and deconvolve. */
+void PNX(adjoint_D_interlaced_batched)(
+    PNX(plan) ths
+    )
+{
+  C *g1 = (C*)ths->g1;
+  C *phases;
+
+  if(ths->pnfft_flags & PNFFT_PRE_PHI_HAT){
+    convolution_two_fields_with_pre_inv_phi_hat(
+        g1, ths->local_N, ths->pre_inv_phi_hat_adj, ths->pre_inv_phi_hat_adj_il,
+        ths->pnfft_flags, FFTW_BACKWARD,
+        ths->f_hat);
+  } else {
+    phases = (C*) PNX(malloc)(sizeof(C) * (size_t) PNX(sum_INT)(3, ths->local_N));
+    precompute_interlacing_phases(ths->n, ths->local_N, ths->local_N_start, FFTW_BACKWARD,
+        phases);
+    convolution_two_fields_with_pre_inv_phi_hat(
+        g1, ths->local_N, NULL, phases, ths->pnfft_flags, FFTW_BACKWARD,
+        g1);
+    PNX(free)(phases);
+
+    convolution_with_general_window(
+        g1, ths->n, ths->local_N, ths->local_N_start, 1, ths->pnfft_flags, ths, FFTW_BACKWARD,
         ths->f_hat);
+  }
 
 #if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)((R*)ths->f_hat, ths->local_N[0]*ths->local_N[1]*ths->local_N[2], 1,
+  PNX(debug_sum_print)((R*)ths->f_hat, ths->local_N_total, 1,
       "PNFFT^H: Sum of Fourier coefficients after deconvolution");
 #endif
 }
 
-static void convolution_due_to_interlacing(
-    const INT *n,
-    const INT *local_N, const INT *local_N_start,
+/* Per axis tables a (non-interlaced, NULL means 1) and b (interlaced):
+ * FFTW_FORWARD:  out[2k] = a[k] * in[k], out[2k+1] = b[k] * in[k]
+ * FFTW_BACKWARD: out[k] = (a[k] * in[2k] + b[k] * in[2k+1]) / 2
+ * Both work in place for in == out + local_N_total (forward) and in == out (backward). */
+static void convolution_two_fields_with_pre_inv_phi_hat(
+    const C *in,
+    const INT *local_N,
+    const C *pre_inv_phi_hat, const C *pre_inv_phi_hat_il,
     unsigned pnfft_flags, int sign,
-    C *inout
+    C *out
     )
 {
-  INT k0, k1, k2, k=0;
-  R h0, h1, h2;
+  int t0=0, t1=1, t2=2;
+  const C *a[3], *b[3];
+
+  a[0] = pre_inv_phi_hat;    a[1] = a[0] + local_N[0]; a[2] = a[1] + local_N[1];
+  b[0] = pre_inv_phi_hat_il; b[1] = b[0] + local_N[0]; b[2] = b[1] + local_N[1];
 
+  /* f_hat is transposed N1 x N2 x N0 */
   if(pnfft_flags & PNFFT_TRANSPOSED_F_HAT){
-    /* f_hat is transposed N1 x N2 x N0 */
-    for(k1=local_N_start[1]; k1<local_N_start[1] + local_N[1]; k1++){
-      h1 = (R) k1/n[1];
-      for(k2=local_N_start[2]; k2<local_N_start[2] + local_N[2]; k2++){
-        h2 = h1 + (R) k2/n[2];
-        for(k0=local_N_start[0]; k0<local_N_start[0] + local_N[0]; k0++, k++){
-          h0 = h2 + (R) k0/n[0];
-          inout[k] *= pnfft_cexp(-sign * PNFFT_PI * I * h0);
-        }
-      }
-    }
-  } else {
-    /* f_hat is non-transposed N0 x N1 x N2 */
-    for(k0=local_N_start[0]; k0<local_N_start[0] + local_N[0]; k0++){
-      h0 = (R) k0/n[0];
-      for(k1=local_N_start[1]; k1<local_N_start[1] + local_N[1]; k1++){
-        h1 = h0 + (R) k1/n[1];
-        for(k2=local_N_start[2]; k2<local_N_start[2] + local_N[2]; k2++, k++){
-          h2 = h1 + (R) k2/n[2];
-          inout[k] *= pnfft_cexp(-sign * PNFFT_PI * I * h2);
-        }
-      }
+    t0=1; t1=2; t2=0;
+  }
+
+#ifdef PNFFT_OPENMP
+  /* in place the rows must be processed in order, since every row overwrites input of later rows */
+  int in_place = (sign == FFTW_FORWARD) ? (in == out + PNX(prod_INT)(3, local_N)) : (in == out);
+  #pragma omp parallel for schedule(static) if(!in_place)
+#endif
+  for(INT ks=0; ks<local_N[t0]*local_N[t1]; ks++){
+    const INT k0 = ks / local_N[t1], k1 = ks % local_N[t1];
+    const C a_xy = (pre_inv_phi_hat) ? a[t0][k0] * a[t1][k1] : 1.0;
+    const C b_xy = b[t0][k0] * b[t1][k1];
+    INT k = ks * local_N[t2];
+
+    for(INT k2=0; k2<local_N[t2]; k2++, k++){
+      C a_xyz = (pre_inv_phi_hat) ? a_xy * a[t2][k2] : 1.0;
+      C b_xyz = b_xy * b[t2][k2];
+      if(sign == FFTW_FORWARD){
+        C g = in[k];
+        out[2*k]   = a_xyz * g;
+        out[2*k+1] = b_xyz * g;
+      } else
+        out[k] = 0.5 * (a_xyz * in[2*k] + b_xyz * in[2*k+1]);
     }
   }
 }
 
+/* Modulation due to interlacing is a tensor product over the axes.
+ * Store the factors of all axes consecutively, as for the deconvolution. */
+static void precompute_interlacing_phases(
+    const INT *n,
+    const INT *local_N, const INT *local_N_start,
+    int sign,
+    C *phases
+    )
+{
+  INT l=0;
+
+  for(int t=0; t<3; t++)
+    for(INT k=local_N_start[t]; k<local_N_start[t] + local_N[t]; k++, l++)
+      phases[l] = pnfft_cexp(-sign * PNFFT_PI * I * (R) k / (R) n[t]);
+}
+
+static void convolution_due_to_interlacing(
+    const INT *n,
+    const INT *local_N, const INT *local_N_start, INT howmany,
+    unsigned pnfft_flags, int sign,
+    C *inout
+    )
+{
+  C *phases = (C*) PNX(malloc)(sizeof(C) * (size_t) PNX(sum_INT)(3, local_N));
+
+  precompute_interlacing_phases(n, local_N, local_N_start, sign,
+      phases);
+  convolution_with_pre_inv_phi_hat(
+      inout, local_N, howmany, phases, pnfft_flags,
+      inout);
+
+  PNX(free)(phases);
+}
+
 static void convolution_with_general_window(
     const C *in,
     const INT *n,
-    const INT *local_N, const INT *local_N_start,
+    const INT *local_N, const INT *local_N_start, INT howmany,
     unsigned pnfft_flags,
     const PNX(plan) window_param, int sign,
     C *out
     )
 {
-  INT k0, k1, k2, k=0;
-  C inv_phi_x, inv_phi_xy, inv_phi_xyz;
+  C *inv_phi_hat = (C*) PNX(malloc)(sizeof(C) * (size_t) PNX(sum_INT)(3, local_N));
+  INT l=0;
 
-  if(pnfft_flags & PNFFT_TRANSPOSED_F_HAT){
-    /* g_hat is transposed N1 x N2 x N0 */
-    for(k1=local_N_start[1]; k1<local_N_start[1] + local_N[1]; k1++){
-      inv_phi_x = PNX(inv_phi_hat)(window_param, 1, k1);
-      for(k2=local_N_start[2]; k2<local_N_start[2] + local_N[2]; k2++){
-        inv_phi_xy = inv_phi_x * PNX(inv_phi_hat)(window_param, 2, k2);
-        for(k0=local_N_start[0]; k0<local_N_start[0] + local_N[0]; k0++, k++){
-          inv_phi_xyz = inv_phi_xy * PNX(inv_phi_hat)(window_param, 0, k0);
-          out[k] = in[k] * inv_phi_xyz;
-        }
-      }
-    }
-  } else {
-    /* g_hat is non-transposed N0 x N1 x N2 */
-    for(k0=local_N_start[0]; k0<local_N_start[0] + local_N[0]; k0++){
-      inv_phi_x = PNX(inv_phi_hat)(window_param, 0, k0);
-      for(k1=local_N_start[1]; k1<local_N_start[1] + local_N[1]; k1++){
-        inv_phi_xy = inv_phi_x * PNX(inv_phi_hat)(window_param, 1, k1);
-        for(k2=local_N_start[2]; k2<local_N_start[2] + local_N[2]; k2++, k++){
-          inv_phi_xyz = inv_phi_xy * PNX(inv_phi_hat)(window_param, 2, k2);
-          out[k] = in[k] * inv_phi_xyz;
-        }
-      }
-    }
-  }
+  /* the window is evaluated once per index of every axis, the rows of the 3d block are threaded */
+  for(int t=0; t<3; t++)
+    for(INT k=local_N_start[t]; k<local_N_start[t] + local_N[t]; k++, l++)
+      inv_phi_hat[l] = PNX(inv_phi_hat)(window_param, t, k);
+
+  convolution_with_pre_inv_phi_hat(
+      in, local_N, howmany, inv_phi_hat, pnfft_flags,
+      out);
+
+  PNX(free)(inv_phi_hat);
 }
 
 static void convolution_with_pre_inv_phi_hat(
     const C *in,
-    const INT *local_N,
+    const INT *local_N, INT howmany,
     const C *pre_inv_phi_hat,
     unsigned pnfft_flags,
     C *out
     )
 {
-  INT k0, k1, k2, k=0;
   const C *inv_phi_hat0 = pre_inv_phi_hat;
   const C *inv_phi_hat1 = inv_phi_hat0 + local_N[0];
   const C *inv_phi_hat2 = inv_phi_hat1 + local_N[1];
+  const C *inv_phi_slow, *inv_phi_mid, *inv_phi_fast;
+  INT n_slow, n_mid, n_fast;
 
   if(pnfft_flags & PNFFT_TRANSPOSED_F_HAT){
     /* g_hat is transposed N1 x N2 x N0 */
-    for(k1=0; k1<local_N[1]; k1++)
-      for(k2=0; k2<local_N[2]; k2++)
-        for(k0=0; k0<local_N[0]; k0++, k++)
-          out[k] = in[k] * inv_phi_hat0[k0] * inv_phi_hat1[k1] * inv_phi_hat2[k2];
+    inv_phi_slow = inv_phi_hat1; n_slow = local_N[1];
+    inv_phi_mid  = inv_phi_hat2; n_mid  = local_N[2];
+    inv_phi_fast = inv_phi_hat0; n_fast = local_N[0];
   } else {
     /* g_hat is non-transposed N0 x N1 x N2 */
-    for(k0=0; k0<local_N[0]; k0++)
-      for(k1=0; k1<local_N[1]; k1++)
-        for(k2=0; k2<local_N[2]; k2++, k++)
-          out[k] = in[k] * inv_phi_hat0[k0] * inv_phi_hat1[k1] * inv_phi_hat2[k2];
+    inv_phi_slow = inv_phi_hat0; n_slow = local_N[0];
+    inv_phi_mid  = inv_phi_hat1; n_mid  = local_N[1];
+    inv_phi_fast = inv_phi_hat2; n_fast = local_N[2];
+  }
+
+  /* The factor of the two outer axes is constant along each row, such that the
+   * innermost loop is a plain multiply with the 1d table of the fastest axis.
+   * Both layouts run over contiguous rows, which are independent and split over the threads. */
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(INT ks=0; ks<n_slow*n_mid; ks++){
+    const C inv_phi_xy = inv_phi_slow[ks / n_mid] * inv_phi_mid[ks % n_mid];
+    const C *in_row = in + howmany*ks*n_fast;
+    C *out_row = out + howmany*ks*n_fast;
+
+    if(howmany == 1){
+      for(INT kf=0; kf<n_fast; kf++)
+        out_row[kf] = in_row[kf] * (inv_phi_xy * inv_phi_fast[kf]);
+    } else {
+      for(INT kf=0; kf<n_fast; kf++){
+        C inv_phi_xyz = inv_phi_xy * inv_phi_fast[kf];
+        for(INT h=0; h<howmany; h++)
+          out_row[howmany*kf+h] = in_row[howmany*kf+h] * inv_phi_xyz;
+      }
+    }
   }
 }
 
@@ -388,6 +605,25 @@ void PNX(precompute_inv_phi_hat_adj)(
       pre_phi_hat_adj);
 }
 
+/* Fused deconvolution and modulation due to interlacing, sign is FFTW_FORWARD for trafo and FFTW_BACKWARD for adj. */
+void PNX(precompute_inv_phi_hat_interlaced)(
+    PNX(plan) ths, int sign,
+    C *pre_inv_phi_hat_il
+    )
+{
+  INT l, size = PNX(sum_INT)(3, ths->local_N);
+  C *phases = (C*) PNX(malloc)(sizeof(C) * (size_t) size);
+
+  precompute_inv_phi_hat_general_window(ths->local_N, ths->local_N_start, ths,
+      pre_inv_phi_hat_il);
+  precompute_interlacing_phases(ths->n, ths->local_N, ths->local_N_start, sign,
+      phases);
+  for(l=0; l<size; l++)
+    pre_inv_phi_hat_il[l] *= phases[l];
+
+  PNX(free)(phases);
+}
+
 static void precompute_inv_phi_hat_general_window(
     const INT *local_N, const INT *local_N_start,
     const PNX(plan) window_param,
@@ -396,8 +632,122 @@ static void precompute_inv_phi_hat_general_window(
 {
   INT l=0;
 
-  for(INT t=0; t<3; t++)
+  for(int t=0; t<3; t++){
+    INT size = window_param->N[t] + 1, k0 = -window_param->N[t]/2;
+    R *table;
+
+    /* no table and no cache entry for the axes of length 1 of plans with d < 3 */
+    if(t >= window_param->d){
+      for(INT k=local_N_start[t]; k<local_N_start[t] + local_N[t]; k++, l++)
+        pre_inv_phi_hat[l] = 1.0;
+      continue;
+    }
+
+    table = (R*) PNX(malloc)(sizeof(R) * (size_t) size);
+
+    init_inv_phi_hat_table(window_param, t,
+        table);
     for(INT k=local_N_start[t]; k<local_N_start[t] + local_N[t]; k++, l++)
-      pre_inv_phi_hat[l] = PNX(inv_phi_hat)(window_param, t, k);
+      pre_inv_phi_hat[l] = (k-k0 >= 0 && k-k0 < size) ? table[k-k0] : PNX(inv_phi_hat)(window_param, t, k);
+    PNX(free)(table);
+  }
+}
+
+/* 1d table of inv_phi_hat for -N/2 <= k <= N/2 from the table cache.
+ * On a miss every process evaluates one block of the table. Collective on comm_cart. */
+static void init_inv_phi_hat_table(
+    const PNX(plan) ths, int dim,
+    R *table
+    )
+{
+  INT size = ths->N[dim] + 1, k0 = -ths->N[dim]/2, start, end;
+  double key[PNFFT_CACHE_KEY_LENGTH];
+
+  PNX(window_cache_key)(ths, PNFFTI_CACHE_INV_PHI_HAT, dim, (double) ths->N[dim], 0, 0,
+      key);
+  if(PNX(cache_fetch)(key, size, ths->comm_cart, table))
+    return;
+
+  PNX(table_chunk)(size, ths->comm_cart, &start, &end);
+  for(INT l=start; l<end; l++)
+    table[l] = PNX(inv_phi_hat)(ths, dim, k0 + l);
+  PNX(allgather_table)(size, ths->comm_cart,
+      table);
+  PNX(cache_insert)(key, size, table);
+}
+
+
+/* Tabulate the ES window Fourier coefficients for 0 <= k <= n/2 per axis,
+ * phi_hat is even in k. */
+void PNX(precompute_phi_hat_es)(
+    PNX(plan) ths
+    )
+{
+  int q = es_quad_num_nodes(ths->m);
+  INT size = 0, offset = 0;
+  R *nodes, *weights;
+
+  for(int t=0; t<ths->d; t++)
+    size += ths->n[t]/2 + 1;
+  if(ths->phi_hat_es == NULL)
+    ths->phi_hat_es = (R*) PNX(malloc)(sizeof(R) * (size_t) size);
+
+  nodes   = (R*) PNX(malloc)(sizeof(R) * (size_t) q);
+  weights = (R*) PNX(malloc)(sizeof(R) * (size_t) q);
+  gauss_legendre_unit(q, nodes, weights);
+
+  /* the quadrature is split over all processes and the tables are shared between plans */
+  for(int t=0; t<ths->d; t++){
+    INT length = ths->n[t]/2 + 1, start, end;
+    R *table = ths->phi_hat_es + offset;
+    double key[PNFFT_CACHE_KEY_LENGTH];
+
+    PNX(window_cache_key)(ths, PNFFTI_CACHE_PHI_HAT_ES, t, 0, 0, 0,
+        key);
+    if(!PNX(cache_fetch)(key, length, ths->comm_cart, table)){
+      PNX(table_chunk)(length, ths->comm_cart, &start, &end);
+      for(INT k=start; k<end; k++)
+        table[k] = phi_hat_es_quad(k, ths->n[t], ths->b[t], ths->m, q, nodes, weights);
+      PNX(allgather_table)(length, ths->comm_cart,
+          table);
+      PNX(cache_insert)(key, length, table);
+    }
+    offset += length;
+  }
+
+  PNX(free)(nodes); PNX(free)(weights);
 }
 
+/* The integrand oscillates at most m/2 times on [0,1] and has a narrow peak of width 1/sqrt(b). */
+static int es_quad_num_nodes(
+    int m
+    )
+{
+  return 4*m + 8;
+}
+
+/* Gauss-Legendre nodes and weights on [0,1], Newton iteration for the roots of P_q */
+static void gauss_legendre_unit(
+    int q,
+    R *nodes, R *weights
+    )
+{
+  for(int i=0; i<q; i++){
+    R x = pnfft_cos( PNFFT_PI * (i + 0.75) / (q + 0.5) ), x_old, dp;
+
+    do{
+      R p0 = 1.0, p1 = x;
+      for(int j=2; j<=q; j++){
+        R p2 = ((2.0*j-1.0) * x * p1 - (j-1.0) * p0) / j;
+        p0 = p1; p1 = p2;
+      }
+      /* p1 = P_q(x), p0 = P_{q-1}(x) */
+      dp = q * (x*p1 - p0) / (x*x - 1.0);
+      x_old = x;
+      x -= p1 / dp;
+    } while(pnfft_fabs(x - x_old) > 4 * PNFFT_EPSILON);
+
+    nodes[i]   = 0.5 * (1.0 + x);
+    weights[i] = 1.0 / ( (1.0 - x*x) * dp * dp );
+  }
+}
@@ -25,6 +25,10 @@ void PNX(trafo_D)(
     PNX(plan) ths, int interlaced);
 void PNX(adjoint_D)(
     PNX(plan) ths, int interlaced);
+void PNX(trafo_D_interlaced_batched)(
+    PNX(plan) ths);
+void PNX(adjoint_D_interlaced_batched)(
+    PNX(plan) ths);
 
 void PNX(precompute_inv_phi_hat_trafo)(
     PNX(plan) ths,
@@ -32,5 +36,12 @@ void PNX(precompute_inv_phi_hat_trafo)(
 void PNX(precompute_inv_phi_hat_adj)(
     PNX(plan) ths,
     C *pre_inv_phi_hat_adj);
+void PNX(precompute_inv_phi_hat_interlaced)(
+    PNX(plan) ths, int sign,
+    C *pre_inv_phi_hat_il);
+void PNX(precompute_phi_hat_es)(
+    PNX(plan) ths);
+R PNX(phi_hat_real)(
+    const PNX(plan) ths, int dim, R k);
 
 #endif /* __MATRIX_D_H__ */
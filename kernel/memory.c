@@ -0,0 +1,527 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Memory footprint of a plan and scratch arenas shared by several plans.
+ * The grids g1, g2, g1_buffer and g2_single only hold data during one call of trafo or adj,
+ * therefore all plans created with the same arena work on the same grids.
+ * Temporaries of single calls are taken from a pool of blocks that is kept between calls.
+ * The placement of the grids on huge pages and NUMA domains is chosen by PNX(plan_with_alloc). */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+#define PNFFT_ARENA_POOL_MAX 16
+
+/* huge pages are only worth it for grids of several pages */
+#define PNFFT_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+/* how a grid was allocated, such that it is freed the same way */
+#define PNFFTI_GRID_ALLOC_PFFT    0
+#define PNFFTI_GRID_ALLOC_ALIGNED 1
+#define PNFFTI_GRID_ALLOC_MMAP    2
+
+struct PNX(arena_s){
+  void *grid[PNFFTI_GRIDS];           /**< Shared grids                                 */
+  INT grid_bytes[PNFFTI_GRIDS];       /**< Size of every grid in bytes                  */
+  int grid_user[PNFFTI_GRIDS];        /**< Flag, if the grid was given by the user      */
+  int grid_alloc[PNFFTI_GRIDS];       /**< Allocation method of every grid              */
+  int num_plans;                      /**< Number of plans that use the grids           */
+  int pool_num;                       /**< Number of blocks in the pool                 */
+  void *pool[PNFFT_ARENA_POOL_MAX];   /**< Blocks for temporaries of single calls       */
+  size_t pool_bytes[PNFFT_ARENA_POOL_MAX]; /**< Size of every block in bytes            */
+  int pool_used[PNFFT_ARENA_POOL_MAX];/**< Flag, if the block is handed out             */
+};
+
+/* arena and allocation flags of all plans that are created afterwards,
+ * see PNX(plan_with_arena) and PNX(plan_with_alloc) */
+static PNX(arena) plan_arena = NULL;
+static unsigned plan_alloc = PNFFT_ALLOC_DEFAULT;
+
+static const char *memory_names[PNFFT_MEMORY_LENGTH] = {
+  "g1", "g2", "g1_buffer", "g2_single",
+  "f_hat", "f", "grad_f", "x",
+  "buffer_il", "pre_psi", "intpol tables", "pre_phi_hat", "sorted index",
+  "hessian_f"
+};
+
+static INT component_bytes(
+    const PNX(plan) ths, int component);
+static void* grid_malloc(
+    size_t bytes, unsigned alloc_flags,
+    int *method);
+static void grid_free(
+    void *data, size_t bytes, int method);
+static void touch_static(
+    void *data, size_t bytes);
+
+
+PNX(arena) PNX(mkarena)(
+    void
+    )
+{
+  PNX(arena) arena = (PNX(arena)) malloc(sizeof(struct PNX(arena_s)));
+
+  for(int k=0; k<PNFFTI_GRIDS; k++){
+    arena->grid[k] = NULL;
+    arena->grid_bytes[k] = 0;
+    arena->grid_user[k] = 0;
+    arena->grid_alloc[k] = PNFFTI_GRID_ALLOC_PFFT;
+  }
+  arena->num_plans = 0;
+  arena->pool_num = 0;
+
+  return arena;
+}
+
+/* Let the arena work on user grids g1 and g2 of 'size' reals each.
+ * The grids must not be changed while plans use the arena. */
+void PNX(set_arena_grids)(
+    R *g1, R *g2, INT size, PNX(arena) arena
+    )
+{
+  R *grids[2] = {g1, g2};
+
+  if(arena->num_plans > 0){
+    fprintf(stderr, "!!! Error in PNFFT: arena grids can not be changed while %d plans use them !!!\n", arena->num_plans);
+    return;
+  }
+
+  for(int k=0; k<2; k++){
+    if(arena->grid[k] != NULL && !arena->grid_user[k])
+      grid_free(arena->grid[k], (size_t) arena->grid_bytes[k], arena->grid_alloc[k]);
+    arena->grid[k] = grids[k];
+    arena->grid_bytes[k] = (grids[k] != NULL) ? size * (INT) sizeof(R) : 0;
+    arena->grid_user[k] = (grids[k] != NULL);
+    arena->grid_alloc[k] = PNFFTI_GRID_ALLOC_PFFT;
+  }
+}
+
+/* All plans of the arena must be finalized before. */
+void PNX(rmarena)(
+    PNX(arena) arena
+    )
+{
+  if(arena == NULL)
+    return;
+
+  if(plan_arena == arena)
+    plan_arena = NULL;
+
+  for(int k=0; k<PNFFTI_GRIDS; k++)
+    if(arena->grid[k] != NULL && !arena->grid_user[k])
+      grid_free(arena->grid[k], (size_t) arena->grid_bytes[k], arena->grid_alloc[k]);
+  for(int k=0; k<arena->pool_num; k++)
+    PNX(free)(arena->pool[k]);
+
+  free(arena);
+}
+
+/* All plans created afterwards share the grids of 'arena', NULL switches back to private grids.
+ * A plan uses its own grid, if the arena grid is too small and already used by other plans.
+ * Therefore, create the plan with the largest grids first. */
+void PNX(plan_with_arena)(
+    PNX(arena) arena
+    )
+{
+  plan_arena = arena;
+}
+
+/* All grids of plans created afterwards are allocated with 'alloc_flags':
+ * PNFFT_ALLOC_FIRST_TOUCH touches the grids and the precomputed window values with the static
+ * decomposition of the threaded loops, such that their pages are local to the NUMA domain of the
+ * threads that work on them. PNFFT_ALLOC_HUGE_PAGES aligns grids of at least 2MB to transparent
+ * huge pages, PNFFT_ALLOC_HUGETLB maps them on explicit huge pages and falls back to transparent
+ * ones if the system has none reserved. */
+void PNX(plan_with_alloc)(
+    unsigned alloc_flags
+    )
+{
+  plan_alloc = alloc_flags;
+}
+
+/* bytes of all grids and pool blocks held by the arena on the calling process */
+INT PNX(get_arena_memory)(
+    const PNX(arena) arena
+    )
+{
+  INT bytes = 0;
+
+  for(int k=0; k<PNFFTI_GRIDS; k++)
+    if(!arena->grid_user[k])
+      bytes += arena->grid_bytes[k];
+  for(int k=0; k<arena->pool_num; k++)
+    bytes += (INT) arena->pool_bytes[k];
+
+  return bytes;
+}
+
+
+/* Grid of 'bytes' bytes for the plan. Grids of the arena grow as long as no plan uses them. */
+void* PNX(alloc_grid)(
+    PNX(plan) ths, int grid, INT bytes
+    )
+{
+  PNX(arena) arena = ths->arena;
+
+  ths->grid_bytes[grid] = bytes;
+  if(bytes == 0)
+    return NULL;
+
+  if(arena != NULL){
+    if(bytes > arena->grid_bytes[grid] && !arena->grid_user[grid] && arena->num_plans == 0){
+      if(arena->grid[grid] != NULL)
+        grid_free(arena->grid[grid], (size_t) arena->grid_bytes[grid], arena->grid_alloc[grid]);
+      arena->grid[grid] = grid_malloc((size_t) bytes, ths->alloc_flags, &arena->grid_alloc[grid]);
+      arena->grid_bytes[grid] = bytes;
+    }
+    if(bytes <= arena->grid_bytes[grid]){
+      ths->shared_grids |= 1U << grid;
+      return arena->grid[grid];
+    }
+  }
+
+  return grid_malloc((size_t) bytes, ths->alloc_flags, &ths->grid_alloc[grid]);
+}
+
+void PNX(free_grid)(
+    PNX(plan) ths, int grid, void *data
+    )
+{
+  if(data != NULL && !(ths->shared_grids & (1U << grid)))
+    grid_free(data, (size_t) ths->grid_bytes[grid], ths->grid_alloc[grid]);
+}
+
+/* Touch 'bytes' bytes of 'data' with the static schedule of the threaded loops,
+ * if the plan was created with PNFFT_ALLOC_FIRST_TOUCH. */
+void PNX(first_touch)(
+    const PNX(plan) ths, void *data, size_t bytes
+    )
+{
+  if(data != NULL && (ths->alloc_flags & PNFFT_ALLOC_FIRST_TOUCH))
+    touch_static(data, bytes);
+}
+
+/* called after all grids of the plan are allocated */
+void PNX(arena_attach)(
+    PNX(plan) ths
+    )
+{
+  if(ths->arena != NULL)
+    ths->arena->num_plans++;
+}
+
+void PNX(arena_detach)(
+    PNX(plan) ths
+    )
+{
+  if(ths->arena != NULL)
+    ths->arena->num_plans--;
+  ths->arena = NULL;
+}
+
+PNX(arena) PNX(get_plan_arena)(
+    void
+    )
+{
+  return plan_arena;
+}
+
+unsigned PNX(get_plan_alloc)(
+    void
+    )
+{
+  return plan_alloc;
+}
+
+
+/* Temporary memory of a single call, only called outside of parallel regions.
+ * Without arena these are plain PNX(malloc) and PNX(free). */
+void* PNX(scratch_malloc)(
+    PNX(plan) ths, size_t bytes
+    )
+{
+  PNX(arena) arena = ths->arena;
+  int best = -1, unused = -1;
+
+  if(arena == NULL || bytes == 0)
+    return (bytes) ? PNX(malloc)(bytes) : NULL;
+
+  /* smallest free block that is large enough */
+  for(int k=0; k<arena->pool_num; k++){
+    if(arena->pool_used[k])
+      continue;
+    if(arena->pool_bytes[k] >= bytes){
+      if(best < 0 || arena->pool_bytes[k] < arena->pool_bytes[best])
+        best = k;
+    } else
+      unused = k;
+  }
+
+  /* add a block or grow a free one */
+  if(best < 0){
+    if(arena->pool_num < PNFFT_ARENA_POOL_MAX)
+      best = arena->pool_num++;
+    else if(unused >= 0)
+      PNX(free)(arena->pool[best = unused]);
+    else
+      return PNX(malloc)(bytes);
+    arena->pool[best] = PNX(malloc)(bytes);
+    arena->pool_bytes[best] = bytes;
+  }
+
+  arena->pool_used[best] = 1;
+  return arena->pool[best];
+}
+
+void PNX(scratch_free)(
+    PNX(plan) ths, void *data
+    )
+{
+  PNX(arena) arena = ths->arena;
+
+  if(data == NULL)
+    return;
+
+  if(arena != NULL)
+    for(int k=0; k<arena->pool_num; k++)
+      if(arena->pool[k] == data){
+        arena->pool_used[k] = 0;
+        return;
+      }
+
+  PNX(free)(data);
+}
+
+
+const char* PNX(get_memory_name)(
+    int component
+    )
+{
+  if(component < 0 || component >= PNFFT_MEMORY_LENGTH)
+    return NULL;
+
+  return memory_names[component];
+}
+
+/* Bytes of one component on the calling process. PNFFT_MEMORY_TOTAL sums up all
+ * components without the grids shared with an arena. */
+INT PNX(get_memory)(
+    const PNX(plan) ths, int component
+    )
+{
+  INT bytes = 0;
+
+  if(component != PNFFT_MEMORY_TOTAL)
+    return (component >= 0 && component < PNFFT_MEMORY_LENGTH) ? component_bytes(ths, component) : 0;
+
+  for(int k=0; k<PNFFT_MEMORY_LENGTH; k++)
+    if( !(k < PNFFTI_GRIDS && (ths->shared_grids & (1U << k))) )
+      bytes += component_bytes(ths, k);
+
+  return bytes;
+}
+
+/* Minimum, average and maximum bytes of every component over all processes of 'comm'. */
+void PNX(print_memory)(
+    const PNX(plan) ths, MPI_Comm comm
+    )
+{
+  int size;
+
+  MPI_Comm_size(comm, &size);
+
+  PX(fprintf)(comm, stdout, "PNFFT memory per process in bytes:\n");
+  PX(fprintf)(comm, stdout, "%-14s %12s %12s %12s %8s\n", "component", "min", "avg", "max", "shared");
+
+  for(int k=-1; k<PNFFT_MEMORY_LENGTH; k++){
+    int component = (k < 0) ? PNFFT_MEMORY_TOTAL : k;
+    double local = (double) PNX(get_memory)(ths, component), vmin, vavg, vmax;
+
+    MPI_Allreduce(&local, &vmin, 1, MPI_DOUBLE, MPI_MIN, comm);
+    MPI_Allreduce(&local, &vmax, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(&local, &vavg, 1, MPI_DOUBLE, MPI_SUM, comm);
+    vavg /= size;
+    if(vmax == 0 && component != PNFFT_MEMORY_TOTAL)
+      continue;
+
+    PX(fprintf)(comm, stdout, "%-14s %12.4e %12.4e %12.4e %8s\n",
+        (k < 0) ? "total" : memory_names[k], vmin, vavg, vmax,
+        (k >= 0 && k < PNFFTI_GRIDS && (ths->shared_grids & (1U << k))) ? "yes" : "");
+  }
+}
+
+
+static INT component_bytes(
+    const PNX(plan) ths, int component
+    )
+{
+  INT bytes = 0, size;
+  const INT cplx = 2 * (INT) sizeof(R);
+
+  switch(component){
+    case PNFFT_MEMORY_G1:
+      /* in-place FFT works on g2 only, the second buffer set of PNX(trafo_pipelined) is counted twice */
+      return (ths->g1 != ths->g2) ? ((ths->pipe != NULL) ? 2 : 1) * ths->grid_bytes[component] : 0;
+    case PNFFT_MEMORY_G2:
+      return ((ths->pipe != NULL) ? 2 : 1) * ths->grid_bytes[component];
+    case PNFFT_MEMORY_G1_BUFFER:
+    case PNFFT_MEMORY_G2_SINGLE:
+      return ths->grid_bytes[component];
+    case PNFFT_MEMORY_F_HAT:
+      return (ths->f_hat != NULL) ? ths->howmany * ths->local_N_total * (INT) sizeof(C) : 0;
+    case PNFFT_MEMORY_F:
+      return (ths->f != NULL) ? ths->howmany * ths->local_M * cplx : 0;
+    case PNFFT_MEMORY_GRAD_F:
+      return (ths->grad_f != NULL) ? ths->d * ths->local_M * cplx : 0;
+    case PNFFT_MEMORY_HESSIAN_F:
+      return (ths->hessian_f != NULL) ? 6 * ths->local_M * cplx : 0;
+    case PNFFT_MEMORY_X:
+      return (ths->x != NULL) ? ths->d * ths->local_M * (INT) sizeof(R) : 0;
+    case PNFFT_MEMORY_BUFFER_IL:
+      return ths->buffer_il_size * (INT) sizeof(R);
+    case PNFFT_MEMORY_PRE_PSI:
+      size = (ths->pnfft_flags & PNFFT_PRE_FULL_PSI) ? PNFFT_POW3(ths->cutoff) * ths->local_M
+           : 3 * ths->cutoff * ths->local_M;
+      if(ths->pre_psi != NULL)     bytes += size;
+      if(ths->pre_psi_il != NULL)  bytes += size;
+      if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI)
+        size *= 3;
+      if(ths->pre_dpsi != NULL)    bytes += size;
+      if(ths->pre_dpsi_il != NULL) bytes += size;
+      bytes *= PNFFT_PRE_PSI_SINGLE(ths) ? (INT) sizeof(float) : (INT) sizeof(R);
+      /* matrices of PNFFT_SPARSE_B */
+      for(int k=0; k<2; k++){
+        const PNX(sparse_b) *sb = ths->sparse_b[k];
+        if(sb == NULL)
+          continue;
+        bytes += sb->nnz * (INT) (sizeof(int) + ((sb->weight != NULL) ? sizeof(R) : sizeof(float)));
+        bytes += (3 * sb->rows + sb->num_slabs + 1) * (INT) sizeof(INT);
+      }
+      return bytes;
+    case PNFFT_MEMORY_INTPOL_TABLES:
+      size = ths->intpol_num_nodes * ths->cutoff * (ths->intpol_order+1);
+      for(int t=0; t<3; t++){
+        if(ths->intpol_tables_psi != NULL && ths->intpol_tables_psi[t] != NULL)
+          bytes += size;
+        if(ths->intpol_tables_dpsi != NULL && ths->intpol_tables_dpsi[t] != NULL)
+          bytes += size;
+      }
+      return bytes * (INT) sizeof(R);
+    case PNFFT_MEMORY_PRE_PHI_HAT:
+      size = PNX(sum_INT)(3, ths->local_N) * (INT) sizeof(C);
+      if(ths->pre_inv_phi_hat_trafo != NULL)    bytes += size;
+      if(ths->pre_inv_phi_hat_adj != NULL)      bytes += size;
+      if(ths->pre_inv_phi_hat_trafo_il != NULL) bytes += size;
+      if(ths->pre_inv_phi_hat_adj_il != NULL)   bytes += size;
+      if(ths->phi_hat_es != NULL)
+        for(int t=0; t<ths->d; t++)
+          bytes += (ths->n[t]/2 + 1) * (INT) sizeof(R);
+      return bytes;
+    case PNFFT_MEMORY_SORTED_INDEX:
+      if(ths->sorted_index != NULL) bytes += 2 * ths->local_M;
+      if(ths->node_order != NULL)   bytes += ths->local_M;
+      if(ths->redist_perm != NULL)  bytes += ths->redist_M;
+      return bytes * (INT) sizeof(INT);
+    default:
+      return 0;
+  }
+}
+
+
+static void* grid_malloc(
+    size_t bytes, unsigned alloc_flags,
+    int *method
+    )
+{
+  void *data = NULL;
+
+  *method = PNFFTI_GRID_ALLOC_PFFT;
+
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_HUGETLB) && defined(MAP_ANONYMOUS)
+  if((alloc_flags & PNFFT_ALLOC_HUGETLB) && bytes >= PNFFT_HUGE_PAGE_SIZE){
+    size_t mapped = (bytes + PNFFT_HUGE_PAGE_SIZE - 1) / PNFFT_HUGE_PAGE_SIZE * PNFFT_HUGE_PAGE_SIZE;
+
+    data = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(data != MAP_FAILED)
+      *method = PNFFTI_GRID_ALLOC_MMAP;
+    else
+      data = NULL;
+  }
+#endif
+
+#ifdef HAVE_POSIX_MEMALIGN
+  if(data == NULL && (alloc_flags & (PNFFT_ALLOC_HUGE_PAGES | PNFFT_ALLOC_HUGETLB)) && bytes >= PNFFT_HUGE_PAGE_SIZE){
+    if(posix_memalign(&data, PNFFT_HUGE_PAGE_SIZE, bytes) == 0){
+      *method = PNFFTI_GRID_ALLOC_ALIGNED;
+#  if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+      madvise(data, bytes, MADV_HUGEPAGE);
+#  endif
+    } else
+      data = NULL;
+  }
+#endif
+
+  if(data == NULL)
+    data = PNX(malloc)(bytes);
+
+  if(alloc_flags & PNFFT_ALLOC_FIRST_TOUCH)
+    touch_static(data, bytes);
+
+  return data;
+}
+
+static void grid_free(
+    void *data, size_t bytes, int method
+    )
+{
+  switch(method){
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_HUGETLB) && defined(MAP_ANONYMOUS)
+    case PNFFTI_GRID_ALLOC_MMAP:
+      munmap(data, (bytes + PNFFT_HUGE_PAGE_SIZE - 1) / PNFFT_HUGE_PAGE_SIZE * PNFFT_HUGE_PAGE_SIZE);
+      break;
+#endif
+    case PNFFTI_GRID_ALLOC_ALIGNED:
+      free(data);
+      break;
+    default:
+      PNX(free)(data);
+  }
+  (void) bytes;
+}
+
+/* pages are placed on the NUMA domain of the thread that touches them first */
+static void touch_static(
+    void *data, size_t bytes
+    )
+{
+#ifdef PNFFT_OPENMP
+  INT size = (INT) (bytes / sizeof(R));
+  R *array = (R*) data;
+
+  #pragma omp parallel for schedule(static)
+  for(INT k=0; k<size; k++)
+    array[k] = 0;
+#else
+  (void) data; (void) bytes;
+#endif
+}
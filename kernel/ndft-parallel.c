@@ -19,6 +19,7 @@
  */
 
 #include <complex.h>
+#include <limits.h>
 #include "pnfft.h"
 #include "ipnfft.h"
 #include "bessel_i0.h"
@@ -35,6 +36,19 @@
 
 #define PNFFT_SAVE_FREE(array) = if(array != NULL) free(array);
 
+/* subsets of nodes for overlapping ghost cell communication with computation */
+#define PNFFT_NODES_ALL      0
+#define PNFFT_NODES_INTERIOR 1
+#define PNFFT_NODES_BOUNDARY 2
+
+/* window tensors of one block of nodes for blocked PNFFT_PRE_FULL_PSI, one per thread */
+typedef struct{
+  INT nodes;                  /* capacity in nodes, 0 if the plan is not blocked */
+  int grad;                   /* fill the tensors of the derivatives as well */
+  R *psi, *dpsi;
+  R *buffer_psi, *buffer_dpsi;
+} psi_block;
+
 static void loop_over_particles_trafo(
     PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
     int interlaced,
@@ -43,22 +57,155 @@ static void loop_over_particles_adj(
     PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
     int interlaced,
     INT *sorted_index);
-// static void loop_over_particles_adj_interlaced_0(
-//     PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
-//     INT *sorted_index);
-// static void loop_over_particles_adj_interlaced_1(
-//     PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
-//     INT *sorted_index);
+#ifdef PNFFT_OPENMP
+static void loop_over_particles_trafo_overlap(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index);
+static R loop_over_particles_adj_colored(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index, int overlap);
+static int use_gcells_overlap(
+    const PNX(plan) ths);
+static R spread_tiles(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index, int select,
+    INT tiles_total, const INT *num_tiles, const INT *tile_start, const INT *node_in_tile,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, double *times);
+#endif
+static inline void gather_nodes_generic(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index, int select,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, R *pre_dpsi, PNX(shared_psi) *shared,
+    R *rsum, R *rsum_derive, double *times, const int kind);
+static inline double detail_start(
+    const double *times);
+static inline void detail_finish(
+    double *times, int part, double start);
+static inline void detail_reduce(
+    const double *thread_times, double *times);
+static void zero_grid_B(
+    PNX(plan) ths, INT size, int mixed);
+static R loop_over_particles_adj_tiled(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index);
+static void bin_nodes_to_tiles(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index,
+    const INT *tile_size, const INT *num_tiles,
+    INT *tile_start, INT *node_in_tile);
+static int use_mixed_precision(
+    const PNX(plan) ths, int interlaced, int gather);
+static void grid_to_single(
+    const C *grid, INT size,
+    CS *grid_single);
+static void grid_from_single(
+    const CS *grid_single, INT size,
+    C *grid);
+static void first_touch_pre_psi(
+    const PNX(plan) ths, size_t bytes_psi, size_t bytes_dpsi);
+static inline R spread_node_generic(
+    PNX(plan) ths, INT p, INT j,
+    INT *local_no_start, INT *gcells_below, int interlaced,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, PNX(shared_psi) *shared, double *times, const int kind);
+static void init_window_loops(
+    PNX(plan) ths);
+static INT mk_shared_psi(
+    PNX(plan) ths, INT bytes);
+static void rm_shared_psi(
+    PNX(plan) ths);
+static void finish_shared_psi(
+    PNX(plan) ths, int interlaced);
+static inline R* node_shared_psi(
+    const PNX(shared_psi) *shared, INT p, int interlaced, int cutoff,
+    R **dpsi, int *ready);
+static int node_in_subset(
+    int select, const INT *u_j, const INT *gcells_below, const INT *local_no, int cutoff);
+static void project_node_to_local_grid(
+    PNX(plan) ths, INT j, INT *local_no_start, INT *gcells_below, int interlaced,
+    R *x, R *floor_nx_j, INT *u_j);
+static void offset_node_to_interlaced_grid(
+    const PNX(plan) ths, const R *x, const R *floor_nx_j, const INT *u_j,
+    R *x_il, R *floor_nx_il, INT *u_il);
+static void prepare_node_interlaced_batched(
+    PNX(plan) ths, INT j, INT *local_no_start, INT *gcells_below,
+    INT *grid_size, const INT *grid_offset, R *spline_coeffs,
+    R *pre_psi, R *pre_psi_il, INT *m0, INT *m0_il);
+static void init_spline_coeffs(
+    PNX(plan) ths);
+static void init_psi_block(
+    const PNX(plan) ths, int compute_grad_ad,
+    psi_block *block);
+static void fill_psi_block(
+    PNX(plan) ths, INT first, INT count, const INT *node_list,
+    INT *local_no_start, INT *gcells_below, int interlaced, INT *sorted_index,
+    R *spline_coeffs, psi_block *block);
+static void free_psi_block(
+    psi_block *block);
 
 static PNX(plan) mkplan(
     void);
 
+static PNX(sparse_b)* init_sparse_b(
+    PNX(plan) ths, int interlaced);
+static int use_sparse_b(
+    const PNX(plan) ths, int interlaced, int gather);
+static void sparse_b_trafo(
+    PNX(plan) ths, int interlaced);
+static void sparse_b_adj(
+    PNX(plan) ths, int interlaced);
+static void exchange_gcells(
+    PNX(plan) ths, PX(gcplan) gcplan, PNX(ghosts) ghosts);
+static void reduce_gcells(
+    PNX(plan) ths, PX(gcplan) gcplan, PNX(ghosts) ghosts);
+static void reduce_gcells_split(
+    PNX(plan) ths, int interlaced);
+static int use_split_gcells(
+    const PNX(plan) ths, int interlaced, int gather);
+static int has_open_axes(
+    const PNX(plan) ths);
+static void zero_open_gcells(
+    PNX(plan) ths, PX(gcplan) gcplan);
+static INT gcplan_unit(
+    const PNX(plan) ths, PX(gcplan) gcplan);
+static void profile_fft(
+    PNX(plan) ths, PX(plan) pfft, int adj);
+static double gcplan_bytes(
+    PNX(plan) ths, PX(gcplan) gcplan);
+static int use_halo(
+    const PNX(plan) ths, int interlaced, int gather);
+static void halo_trafo(
+    PNX(plan) ths, INT *local_no_start, int interlaced, INT *sorted_index);
+static void halo_adj(
+    PNX(plan) ths, INT *local_no_start, int interlaced, INT *sorted_index);
+
+static R node_coordinate(
+    const PNX(plan) ths, INT j, int t);
+static void trafo_A_block(
+    PNX(plan) ths, const C *buffer,
+    const INT *local_Np, const INT *local_Np_start);
+static void adj_A_block(
+    PNX(plan) ths,
+    const INT *local_Np, const INT *local_Np_start,
+    C *buffer);
+static void get_all_blocks(
+    const PNX(plan) ths, int np_total,
+    INT **block_size, INT **block_start, INT *max_block_total);
+
 static void local_size_B(
     const PNX(plan) ths,
     INT *local_no, INT *local_no_start);
 static void get_size_gcells(
-    int m, int cutoff, unsigned pnfft_flags,
+    int d, int m, int cutoff, unsigned pnfft_flags,
     INT *gcells_below, INT *gcells_above);
+static void pad_local_size(
+    int d,
+    INT *local_n, INT *local_n_start);
 static void lowest_summation_index(
     const INT *n, int m, const R *x,
     const INT *local_no_start, const INT *gcells_below,
@@ -97,6 +244,10 @@ static void pre_psi_tensor_bessel_i0(
     const INT *n, const R *b, int m, int cutoff,
     const R *x, const R *floor_nx, 
     R *pre_psi);
+static void pre_psi_tensor_es(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, 
+    R *pre_psi);
 static void pre_psi_tensor_kaiser_bessel(
     const INT *n, const R *b, int m, int cutoff,
     const R *x, const R *floor_nx, 
@@ -129,13 +280,76 @@ static void pre_dpsi_tensor_bessel_i0(
     const INT *n, const R *b, int m, int cutoff,
     const R *x, const R *floor_nx, 
     R *pre_dpsi);
+static void pre_dpsi_tensor_es(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_dpsi);
 static void pre_dpsi_tensor_kaiser_bessel(
     const INT *n, const R *b, int m, int cutoff,
     const R *x, const R *floor_nx, const R *pre_psi,
     R *pre_dpsi);
+
+static void pre_psi_dpsi_tensor(
+    const INT *n, const R *b, int m, int cutoff, const R *x, const R *floor_nx,
+    const R *exp_const, R *spline_coeffs, unsigned pnfft_flags,
+    int intpol_order, INT intpol_num_nodes, R **intpol_tables_psi, R **intpol_tables_dpsi,
+    R *pre_psi, R *pre_dpsi);
+static void pre_psi_dpsi_tensor_fast_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *exp_const,
+    R *fg_psi, R *fg_dpsi);
+static inline void psi_tensor_kind(
+    const PNX(plan) ths, const int kind, const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_psi);
+static inline void psi_dpsi_tensor_kind(
+    const PNX(plan) ths, const int kind, const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_psi, R *pre_dpsi);
+
+static void pre_d2psi_tensor(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs,
+    const R *pre_psi, unsigned pnfft_flags,
+    R *pre_d2psi);
+static void pre_d2psi_tensor_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_d2psi);
+static void pre_d2psi_tensor_bspline(
+    const INT *n, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_d2psi);
+static void pre_d2psi_tensor_sinc_power(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_d2psi);
+static void pre_d2psi_tensor_bessel_i0(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_d2psi);
+static void pre_d2psi_tensor_es(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_d2psi);
+static void pre_d2psi_tensor_kaiser_bessel(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_d2psi);
 static void sort_nodes_for_better_cache_handle(
-    int d, const INT *n, int m, INT local_x_num, const R *local_x,
+    int d, const INT *n, int m, INT local_x_num, const R *local_x, int warm_start,
+    int keys, INT tile,
     INT *ar_x);
+#if PNFFT_SORT_RADIX
+static INT sort_key(
+    int d, const INT *n, const INT *u_j, int keys, INT tile, int bits);
+static int sort_key_bits(
+    int d, const INT *n, int keys, INT tile, int *bits);
+#endif
+static INT* get_sorted_index(
+    PNX(plan) ths, double *timer);
+static INT* update_sorted_index(
+    PNX(plan) ths, double *timer);
+static void permute_nodes(
+    PNX(plan) ths, const INT *perm, int scatter);
 static void project_node_to_grid(
     const INT *n, int m, const R *x,
     R *floor_nx_j, INT *u_j);
@@ -150,11 +364,21 @@ static R window_bessel_i0_1d(
     R x, INT n, R b, int m);
 static R window_bessel_i0_derivative_1d(
     R x, INT n, R b, int m);
+static R window_bessel_i0_second_derivative_1d(
+    R x, INT n, R b, int m);
+static R window_es_1d(
+    R x, INT n, R b, int m);
+static R window_es_derivative_1d(
+    R x, INT n, R b, int m, R psi);
+static R window_es_second_derivative_1d(
+    R x, INT n, R b, int m, R psi);
 
 static R kaiser_bessel_1d(
     R x, INT n, R b, int m);
 static R kaiser_bessel_derivative_1d(
     R x, INT n, R b, int m, R psi);
+static R kaiser_bessel_second_derivative_1d(
+    R x, INT n, R b, int m, R psi);
 
 
 static void init_intpol_table_psi(
@@ -167,6 +391,24 @@ static void init_intpol_table_dpsi(
     INT n, int m, int dim,
     const PNX(plan) wind_param,
     R *table);
+static void init_intpol_table(
+    INT num_nodes_per_interval, int intpol_order, int cutoff,
+    INT n, int m, int dim,
+    const PNX(plan) wind_param, int derivative,
+    R *table);
+static R intpol_sample(
+    const PNX(plan) wind_param, int dim, R x, int derivative);
+static void intpol_nodal_to_monomial(
+    int intpol_order, const R *f, int cstride,
+    R *coeff);
+static void init_poly_table(
+    int degree, int cutoff,
+    INT n, int m, int dim,
+    const PNX(plan) wind_param, int derivative,
+    R *table);
+static void init_window_table(
+    const PNX(plan) ths, int dim, int poly, int derivative,
+    R *table);
 static R psi_gaussian(
     R x, INT n, R b);
 static R dpsi_gaussian(
@@ -183,6 +425,10 @@ static R psi_bessel_i0(
     R x, INT n, R b, int m);
 static R dpsi_bessel_i0(
     R x, INT n, R b, int m);
+static R psi_es(
+    R x, INT n, R b, int m);
+static R dpsi_es(
+    R x, INT n, R b, int m);
 static R psi_kaiser(
     R x, INT n, R b, int m);
 static R dpsi_kaiser(
@@ -190,8 +436,10 @@ static R dpsi_kaiser(
 
 static void precompute_psi(
     PNX(plan) ths, INT ind, R* x, R* buffer_psi, R* buffer_dpsi, 
-    int compute_grad_ad,
+    int compute_grad_ad, R* spline_coeffs,
     R* pre_psi, R* pre_dpsi);
+static void precompute_psi_nodes(
+    PNX(plan) ths, const INT *sorted_index, int compute_grad_ad);
 
 /* TODO: This function calculates the number of minimum samples of the 2-point-Taylor regularized
  * kernel function 1/x to reach a certain relative error 'eps'. Our windows are likely to be nicer,
@@ -279,6 +527,28 @@ static void init_intpol_table_psi(
     const PNX(plan) wind_param,
     R *table
     )
+{
+  init_intpol_table(num_nodes_per_interval, intpol_order, cutoff, n, m, dim, wind_param, 0,
+      table);
+}
+
+static void init_intpol_table_dpsi(
+    INT num_nodes_per_interval, int intpol_order, int cutoff,
+    INT n, int m, int dim,
+    const PNX(plan) wind_param,
+    R *table
+    )
+{
+  init_intpol_table(num_nodes_per_interval, intpol_order, cutoff, n, m, dim, wind_param, 1,
+      table);
+}
+
+static void init_intpol_table(
+    INT num_nodes_per_interval, int intpol_order, int cutoff,
+    INT n, int m, int dim,
+    const PNX(plan) wind_param, int derivative,
+    R *table
+    )
 {
   /* interpolation of "f" at grid point "r" of order
    * 0: uses f[r]
@@ -286,145 +556,323 @@ static void init_intpol_table_psi(
    * 2: uses f[r-1], f[r], f[r+1]
    * 3: uses f[r-1], f[r], f[r+1], f[r+2]
    * This equivalent to f[-order/2], ... , f[(order+1)/2]
-   * with integer division. */
-  INT ind=0;
-  for(INT k=0; k<num_nodes_per_interval; k++){
-    for(INT c=0; c<cutoff; c++){
+   * with integer division.
+   * The table stores the monomial coefficients of the interpolating polynomial in dist_k
+   * with layout [k][power][c], such that Horner's scheme runs over contiguous memory for all c. */
+  const INT stride = cutoff * (intpol_order+1);
+  R f[4];
+
+  for(INT c=0; c<cutoff; c++){
+    for(INT k=0; k<num_nodes_per_interval; k++){
       for(INT i=-intpol_order/2; i<=(intpol_order+1)/2; i++){
+        INT l = i + intpol_order/2;
         /* avoid multiple evaluations of psi(...) at the same points */
         if( (k > 0) && (i < (intpol_order+1)/2) )
-          table[ind] = table[ind - cutoff*(intpol_order+1) + 1];
+          f[l] = f[l+1];
         else
-          table[ind] = PNX(psi)(wind_param, dim, (m + (R)(k+i)/num_nodes_per_interval - c)/n);
-        ++ind;
+          f[l] = intpol_sample(wind_param, dim, (m + (R)(k+i)/num_nodes_per_interval - c)/n, derivative);
       }
+      intpol_nodal_to_monomial(intpol_order, f, cutoff,
+          table + k*stride + c);
     }
   }
 }
 
-static void init_intpol_table_dpsi(
-    INT num_nodes_per_interval, int intpol_order, int cutoff,
+/* Interpolation table (poly=0) or polynomial table (poly=1) of axis 'dim' from the table cache.
+ * On a miss process 0 evaluates the window and broadcasts the table. Collective on comm_cart. */
+static void init_window_table(
+    const PNX(plan) ths, int dim, int poly, int derivative,
+    R *table
+    )
+{
+  INT size = ths->intpol_num_nodes * ths->cutoff * (ths->intpol_order+1);
+  double key[PNFFT_CACHE_KEY_LENGTH];
+  int rank;
+
+  PNX(window_cache_key)(ths, (poly) ? PNFFTI_CACHE_POLY_PSI : PNFFTI_CACHE_INTPOL_PSI, dim,
+      (double) ths->intpol_num_nodes, (double) ths->intpol_order, (double) derivative,
+      key);
+  if(PNX(cache_fetch)(key, size, ths->comm_cart, table))
+    return;
+
+  MPI_Comm_rank(ths->comm_cart, &rank);
+  if(rank == 0){
+    if(poly)
+      init_poly_table(ths->intpol_order, ths->cutoff, ths->n[dim], ths->m, dim, ths, derivative,
+          table);
+    else if(derivative)
+      init_intpol_table_dpsi(ths->intpol_num_nodes, ths->intpol_order, ths->cutoff, ths->n[dim], ths->m, dim, ths,
+          table);
+    else
+      init_intpol_table_psi(ths->intpol_num_nodes, ths->intpol_order, ths->cutoff, ths->n[dim], ths->m, dim, ths,
+          table);
+  }
+  MPI_Bcast(table, (int) size, PNFFT_MPI_REAL_TYPE, 0, ths->comm_cart);
+  PNX(cache_insert)(key, size, table);
+}
+
+static R intpol_sample(
+    const PNX(plan) wind_param, int dim, R x, int derivative
+    )
+{
+  return (derivative) ? -PNX(dpsi)(wind_param, dim, x) : PNX(psi)(wind_param, dim, x);
+}
+
+/* convert the values at the interpolation nodes -order/2, ..., (order+1)/2
+ * into the coefficients of 1, dist, dist^2, ... with stride 'cstride' */
+static void intpol_nodal_to_monomial(
+    int intpol_order, const R *f, int cstride,
+    R *coeff
+    )
+{
+  switch(intpol_order){
+    case 0 :
+      coeff[0] = f[0];
+      break;
+    case 1 :
+      coeff[0]         = f[0];
+      coeff[cstride]   = f[1] - f[0];
+      break;
+    case 2 :
+      coeff[0]         = f[1];
+      coeff[cstride]   = 0.5 * (f[2] - f[0]);
+      coeff[2*cstride] = 0.5 * (f[0] - 2.0*f[1] + f[2]);
+      break;
+    default:
+      coeff[0]         = f[1];
+      coeff[cstride]   = (-2.0*f[0] - 3.0*f[1] + 6.0*f[2] - f[3]) / 6.0;
+      coeff[2*cstride] = 0.5 * (f[0] - 2.0*f[1] + f[2]);
+      coeff[3*cstride] = (-f[0] + 3.0*f[1] - 3.0*f[2] + f[3]) / 6.0;
+  }
+}
+
+/* Fit the window (or its derivative) on every stencil cell c by a polynomial of
+ * degree 'degree' in z = 2*dist-1, 0 <= dist < 1. The Chebyshev interpolant is
+ * converted into monomial coefficients with layout [power][c] for Horner's scheme. */
+static void init_poly_table(
+    int degree, int cutoff,
     INT n, int m, int dim,
-    const PNX(plan) wind_param,
+    const PNX(plan) wind_param, int derivative,
     R *table
     )
 {
-  /* interpolation of "f" at grid point "r" of order
-   * 0: uses f[r]
-   * 1: uses f[r], f[r+1]
-   * 2: uses f[r-1], f[r], f[r+1]
-   * 3: uses f[r-1], f[r], f[r+1], f[r+2]
-   * This equivalent to f[-order/2], ... , f[(order+1)/2]
-   * with integer division. */
-  INT ind=0;
-  for(INT k=0; k<num_nodes_per_interval; k++){
-    for(INT c=0; c<cutoff; c++){
-      for(INT i=-intpol_order/2; i<=(intpol_order+1)/2; i++){
-        /* avoid multiple evaluations of dpsi(...) at the same points */
-        if( (k > 0) && (i < (intpol_order+1)/2) )
-          table[ind] = table[ind - cutoff*(intpol_order+1) + 1];
-        else
-          table[ind] = -PNX(dpsi)(wind_param, dim, (m + (R)(k+i)/num_nodes_per_interval - c)/n);
-        ++ind;
+  const int nn = degree+1;
+  R *f = (R*) PNX(malloc)(sizeof(R) * (size_t) (4*nn));
+  R *cheb = f + nn, *t_old = f + 2*nn, *t_cur = f + 3*nn;
+
+  for(int c=0; c<cutoff; c++){
+    /* sample at the Chebyshev nodes */
+    for(int j=0; j<nn; j++){
+      R z = pnfft_cos(PNFFT_PI * (j+0.5) / nn);
+      f[j] = intpol_sample(wind_param, dim, (m + 0.5*(z+1.0) - c)/n, derivative);
+    }
+
+    /* Chebyshev coefficients */
+    for(int k=0; k<nn; k++){
+      cheb[k] = 0;
+      for(int j=0; j<nn; j++)
+        cheb[k] += f[j] * pnfft_cos(PNFFT_PI * k * (j+0.5) / nn);
+      cheb[k] *= (k==0) ? 1.0/nn : 2.0/nn;
+    }
+
+    /* sum up the monomial coefficients of T_k via T_{k+1} = 2z T_k - T_{k-1} */
+    for(int i=0; i<nn; i++)
+      table[i*cutoff+c] = t_old[i] = t_cur[i] = 0;
+    t_old[0] = 1;
+    table[c] = cheb[0];
+    if(nn > 1){
+      t_cur[1] = 1;
+      table[cutoff+c] += cheb[1];
+    }
+    for(int k=2; k<nn; k++){
+      for(int i=nn-1; i>=0; i--){
+        R t_new = ( (i>0) ? 2.0*t_cur[i-1] : 0.0 ) - t_old[i];
+        t_old[i] = t_cur[i];
+        t_cur[i] = t_new;
       }
+      for(int i=0; i<=k; i++)
+        table[i*cutoff+c] += cheb[k] * t_cur[i];
     }
   }
 
+  PNX(free)(f);
 }
 
 
+/* Fourier coefficients of all processes circulate in a ring. Every process
+ * sends its current block to the right neighbor, receives the next block
+ * from the left neighbor and computes with the current block in between. */
 void PNX(trafo_A)(
     PNX(plan) ths
     )
 {
-  int np_total, myrnk;
-  INT local_Np[3], local_Np_start[3]; 
-  C *buffer;
+  const INT howmany = ths->howmany;
+  int np_total, myrnk, left, right;
+  INT *block_size, *block_start, max_block_total;
+  C *buffer, *next_buffer;
 
   MPI_Comm_size(ths->comm_cart, &np_total);
   MPI_Comm_rank(ths->comm_cart, &myrnk);
+  left  = (myrnk + np_total - 1) % np_total;
+  right = (myrnk + 1) % np_total;
 
   if (ths->trafo_flag & PNFFTI_TRAFO_C2R) {
     for(INT j=0; j<ths->local_M; j++)  ths->f[j] = 0;
     if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
       for(INT j=0; j<3*ths->local_M; j++)  ths->grad_f[j] = 0;
+    if(ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F)
+      for(INT j=0; j<6*ths->local_M; j++)  ths->hessian_f[j] = 0;
   } else if (ths->trafo_flag & PNFFTI_TRAFO_C2C) {
-    for(INT j=0; j<ths->local_M; j++)  ((C*)ths->f)[j] = 0;
+    for(INT j=0; j<howmany*ths->local_M; j++)  ((C*)ths->f)[j] = 0;
     if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
       for(INT j=0; j<3*ths->local_M; j++)  ((C*)ths->grad_f)[j] = 0;
+    if(ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F)
+      for(INT j=0; j<6*ths->local_M; j++)  ((C*)ths->hessian_f)[j] = 0;
   }
 
-  for(int pid=0; pid<np_total; pid++){
-    /* compute local_Np, local_Np_start of proc. with rank pid */
-    PNX(local_block_internal)(ths->N, ths->no, ths->comm_cart, pid, ths->pnfft_flags, ths->trafo_flag,
-        local_Np, local_Np_start);
+  get_all_blocks(ths, np_total,
+      &block_size, &block_start, &max_block_total);
 
-    INT local_Np_total = PNX(prod_INT)(3, local_Np);
+  buffer = (max_block_total > 0) ? PNX(malloc_C)((size_t) (howmany*max_block_total)) : NULL;
+  next_buffer = (max_block_total > 0) ? PNX(malloc_C)((size_t) (howmany*max_block_total)) : NULL;
+
+  for(INT k=0; k<howmany*PNX(prod_INT)(3, block_size + 3*myrnk); k++)
+    buffer[k] = ths->f_hat[k];
+
+  for(int s=0; s<np_total; s++){
+    /* block of rank pid is available at step s */
+    int pid = (myrnk + np_total - s) % np_total;
+    int next_pid = (pid + np_total - 1) % np_total;
+    MPI_Request request[2];
+
+    if(s+1 < np_total){
+      MPI_Irecv(next_buffer, (int) (2*howmany*PNX(prod_INT)(3, block_size + 3*next_pid)), PNFFT_MPI_REAL_TYPE,
+          left, 0, ths->comm_cart, &request[0]);
+      MPI_Isend(buffer, (int) (2*howmany*PNX(prod_INT)(3, block_size + 3*pid)), PNFFT_MPI_REAL_TYPE,
+          right, 0, ths->comm_cart, &request[1]);
+    }
 
     /* Avoid errors for empty blocks */
-    if(local_Np_total == 0) continue;
+    if(PNX(prod_INT)(3, block_size + 3*pid) > 0)
+      trafo_A_block(ths, buffer, block_size + 3*pid, block_start + 3*pid);
+
+    if(s+1 < np_total){
+      C *tmp = buffer;
+      MPI_Waitall(2, request, MPI_STATUSES_IGNORE);
+      buffer = next_buffer;
+      next_buffer = tmp;
+    }
+  }
+
+  if(buffer != NULL)      PNX(free)(buffer);
+  if(next_buffer != NULL) PNX(free)(next_buffer);
+  PNX(free)(block_size);
+  PNX(free)(block_start);
+
+  R minusTwoPi  = -2.0 * PNFFT_PI;
+  C minusTwoPiI = minusTwoPi * I;
+  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F) {
+    if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
+      for(INT j=0; j<3*ths->local_M; j++)
+        ths->grad_f[j] *= minusTwoPi;
+    else if (ths->trafo_flag & PNFFTI_TRAFO_C2C)
+      for(INT j=0; j<3*ths->local_M; j++)
+        ((C*)ths->grad_f)[j] *= minusTwoPiI;
+  }
 
-    buffer = (myrnk == pid) ? ths->f_hat : PNX(malloc_C)(local_Np_total);
+  /* (-2 pi i)^2 for both c2c and c2r */
+  if(ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F) {
+    if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
+      for(INT j=0; j<6*ths->local_M; j++)
+        ths->hessian_f[j] *= -minusTwoPi * minusTwoPi;
+    else if (ths->trafo_flag & PNFFTI_TRAFO_C2C)
+      for(INT j=0; j<6*ths->local_M; j++)
+        ((C*)ths->hessian_f)[j] *= -minusTwoPi * minusTwoPi;
+  }
+}
 
-    /* broadcast block of Fourier coefficients from p to all procs */
-    MPI_Bcast(buffer, 2*local_Np_total, PNFFT_MPI_REAL_TYPE, pid, ths->comm_cart);
+/* Coordinate t of node j, the axes t >= d of plans with d < 3 have the single node 0. */
+static R node_coordinate(
+    const PNX(plan) ths, INT j, int t
+    )
+{
+  return (t < ths->d) ? ths->x[ths->d*j+t] : 0;
+}
 
-    INT t0 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 1 : 0;
-    INT t1 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 2 : 1;
-    INT t2 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 0 : 2;
+static void trafo_A_block(
+    PNX(plan) ths, const C *buffer,
+    const INT *local_Np, const INT *local_Np_start
+    )
+{
+  INT t0 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 1 : 0;
+  INT t1 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 2 : 1;
+  INT t2 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 0 : 2;
 
-    for(INT j=0; j<ths->local_M; j++){
-      C exp_x0 = pnfft_cexp(-2.0 * PNFFT_PI * ths->x[3*j+t0] * I);
-      C exp_x1 = pnfft_cexp(-2.0 * PNFFT_PI * ths->x[3*j+t1] * I);
-      C exp_x2 = pnfft_cexp(-2.0 * PNFFT_PI * ths->x[3*j+t2] * I);
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(INT j=0; j<ths->local_M; j++){
+    C exp_x0 = pnfft_cexp(-2.0 * PNFFT_PI * node_coordinate(ths, j, t0) * I);
+    C exp_x1 = pnfft_cexp(-2.0 * PNFFT_PI * node_coordinate(ths, j, t1) * I);
+    C exp_x2 = pnfft_cexp(-2.0 * PNFFT_PI * node_coordinate(ths, j, t2) * I);
 
-      C exp_kx0_start = pnfft_cexp(-2.0 * PNFFT_PI * local_Np_start[t0] * ths->x[3*j+t0] * I);
-      C exp_kx1_start = pnfft_cexp(-2.0 * PNFFT_PI * local_Np_start[t1] * ths->x[3*j+t1] * I);
-      C exp_kx2_start = pnfft_cexp(-2.0 * PNFFT_PI * local_Np_start[t2] * ths->x[3*j+t2] * I);
+    C exp_kx0_start = pnfft_cexp(-2.0 * PNFFT_PI * local_Np_start[t0] * node_coordinate(ths, j, t0) * I);
+    C exp_kx1_start = pnfft_cexp(-2.0 * PNFFT_PI * local_Np_start[t1] * node_coordinate(ths, j, t1) * I);
+    C exp_kx2_start = pnfft_cexp(-2.0 * PNFFT_PI * local_Np_start[t2] * node_coordinate(ths, j, t2) * I);
 
-      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-        R grad_f[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-
-        INT m=0;
-        C exp_kx0 = exp_kx0_start;
-        for(INT k0 = local_Np_start[t0]; k0 < local_Np_start[t0] + local_Np[t0]; k0++){
-          C exp_kx1 = exp_kx0 * exp_kx1_start;
-          for(INT k1 = local_Np_start[t1]; k1 < local_Np_start[t1] + local_Np[t1]; k1++){
-            C exp_kx2 = exp_kx1 * exp_kx2_start;
-            for(INT k2 = local_Np_start[t2]; k2 < local_Np_start[t2] + local_Np[t2]; k2++, m++){
-              C bufferTimesExp = buffer[m] * exp_kx2;
-
-              if (ths->trafo_flag & PNFFTI_TRAFO_C2R) {
-                if (k0 == 0 && k1 == 0 && k2 == 0)
-                  ths->f[j] += pnfft_creal(buffer[m]);
-                else if ( ! (// these have to be zero
-                             ( (k0 == 0 || k0 ==  -ths->N[t0]/2) &&
-                               (k1 == 0 || k1 ==  -ths->N[t1]/2) &&
-                               (k2 == 0 || k2 ==  -ths->N[t2]/2)    ) ||
-                             // these are redundant. we have to skip them because we always add the two
-                             // hermitean coefficients at once and we would otherwise add them twice
-                             ( k1 > 0 && (k2 == 0 || k2 == -ths->N[t2]/2) ) ||
-                             ( k0 > 0 && (k1 == 0 || k1 == -ths->N[t1]/2) && (k2 == 0 || k2 == -ths->N[t2]/2) ))
-                        ) {
-                  ths->f[j] += 2 * pnfft_creal(bufferTimesExp);
-                  grad_f[0] += k0 * pnfft_cimag(bufferTimesExp);
-                  grad_f[2] += k1 * pnfft_cimag(bufferTimesExp);
-                  grad_f[4] += k2 * pnfft_cimag(bufferTimesExp);
-                }
-              } else {
-                ((C*)ths->f)[j] += bufferTimesExp;
-                ((C*)grad_f)[0] += k0 * bufferTimesExp;
-                ((C*)grad_f)[1] += k1 * bufferTimesExp;
-                ((C*)grad_f)[2] += k2 * bufferTimesExp;
-              }
+    if(ths->compute_flags & (PNFFT_COMPUTE_GRAD_F | PNFFT_COMPUTE_HESSIAN_F)){
+      R grad_f[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      C hessian_f[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
 
-              exp_kx2 *= exp_x2;
+      INT m=0;
+      C exp_kx0 = exp_kx0_start;
+      for(INT k0 = local_Np_start[t0]; k0 < local_Np_start[t0] + local_Np[t0]; k0++){
+        C exp_kx1 = exp_kx0 * exp_kx1_start;
+        for(INT k1 = local_Np_start[t1]; k1 < local_Np_start[t1] + local_Np[t1]; k1++){
+          C exp_kx2 = exp_kx1 * exp_kx2_start;
+          for(INT k2 = local_Np_start[t2]; k2 < local_Np_start[t2] + local_Np[t2]; k2++, m++){
+            C bufferTimesExp = buffer[m] * exp_kx2;
+
+            if (ths->trafo_flag & PNFFTI_TRAFO_C2R) {
+              if (k0 == 0 && k1 == 0 && k2 == 0)
+                ths->f[j] += pnfft_creal(buffer[m]);
+              else if ( ! (// these have to be zero
+                           ( (k0 == 0 || k0 ==  -ths->N[t0]/2) &&
+                             (k1 == 0 || k1 ==  -ths->N[t1]/2) &&
+                             (k2 == 0 || k2 ==  -ths->N[t2]/2)    ) ||
+                           // these are redundant. we have to skip them because we always add the two
+                           // hermitean coefficients at once and we would otherwise add them twice
+                           ( k1 > 0 && (k2 == 0 || k2 == -ths->N[t2]/2) ) ||
+                           ( k0 > 0 && (k1 == 0 || k1 == -ths->N[t1]/2) && (k2 == 0 || k2 == -ths->N[t2]/2) ))
+                      ) {
+                ths->f[j] += 2 * pnfft_creal(bufferTimesExp);
+                grad_f[0] += k0 * pnfft_cimag(bufferTimesExp);
+                grad_f[2] += k1 * pnfft_cimag(bufferTimesExp);
+                grad_f[4] += k2 * pnfft_cimag(bufferTimesExp);
+                bufferTimesExp = pnfft_creal(bufferTimesExp);
+              } else
+                bufferTimesExp = 0;
+            } else {
+              ((C*)ths->f)[j] += bufferTimesExp;
+              ((C*)grad_f)[0] += k0 * bufferTimesExp;
+              ((C*)grad_f)[1] += k1 * bufferTimesExp;
+              ((C*)grad_f)[2] += k2 * bufferTimesExp;
             }
-            exp_kx1 *= exp_x1;
+            hessian_f[0] += k0 * k0 * bufferTimesExp;
+            hessian_f[1] += k0 * k1 * bufferTimesExp;
+            hessian_f[2] += k0 * k2 * bufferTimesExp;
+            hessian_f[3] += k1 * k1 * bufferTimesExp;
+            hessian_f[4] += k1 * k2 * bufferTimesExp;
+            hessian_f[5] += k2 * k2 * bufferTimesExp;
+
+            exp_kx2 *= exp_x2;
           }
-          exp_kx0 *= exp_x0;
+          exp_kx1 *= exp_x1;
         }
+        exp_kx0 *= exp_x0;
+      }
 
+      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
         if (ths->trafo_flag & PNFFTI_TRAFO_C2R) {
           ths->grad_f[3*j+t0] += 2 * grad_f[0];
           ths->grad_f[3*j+t1] += 2 * grad_f[2];
@@ -434,106 +882,182 @@ void PNX(trafo_A)(
           ((C*)ths->grad_f)[3*j+t1] += ((C*)grad_f)[1];
           ((C*)ths->grad_f)[3*j+t2] += ((C*)grad_f)[2];
         }
+      }
 
-      } else {
-        INT m=0;
-        C exp_kx0 = exp_kx0_start;
-        for(INT k0 = local_Np_start[t0]; k0 < local_Np_start[t0] + local_Np[t0]; k0++){
-          C exp_kx1 = exp_kx0 * exp_kx1_start;
-          for(INT k1 = local_Np_start[t1]; k1 < local_Np_start[t1] + local_Np[t1]; k1++){
-            C exp_kx2 = exp_kx1 * exp_kx2_start;
-            for(INT k2 = local_Np_start[t2]; k2 < local_Np_start[t2] + local_Np[t2]; k2++, m++){
-              if (ths->trafo_flag & PNFFTI_TRAFO_C2R) {
-                if (k0 == 0 && k1 == 0 && k2 == 0)
-                  ths->f[j] += pnfft_creal(buffer[m]);
-                else if ( ! (// these have to be zero
-                             ( (k0 == 0 || k0 ==  -ths->N[t0]/2) &&
-                               (k1 == 0 || k1 ==  -ths->N[t1]/2) &&
-                               (k2 == 0 || k2 ==  -ths->N[t2]/2)    ) ||
-                             // these are redundant. we have to skip them because we always add the two
-                             // hermitean coefficients at once and we would otherwise add them twice
-                             ( k1 > 0 && (k2 == 0 || k2 == -ths->N[t2]/2) ) ||
-                             ( k0 > 0 && (k1 == 0 || k1 == -ths->N[t1]/2) && (k2 == 0 || k2 == -ths->N[t2]/2) ))
-                        )
-                  ths->f[j] += 2 * pnfft_creal(buffer[m] * exp_kx2);
-              } else if (ths->trafo_flag & PNFFTI_TRAFO_C2C)
-                ((C*)ths->f)[j] += buffer[m] * exp_kx2;
-
-              exp_kx2 *= exp_x2;
-            }
-            exp_kx1 *= exp_x1;
+      if(ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F){
+        /* components of the frequencies k0, k1, k2 belong to the axes t0, t1, t2 */
+        const INT tk[3] = {t0, t1, t2};
+        for(int a=0, c=0; a<3; a++){
+          for(int e=a; e<3; e++, c++){
+            INT h = PNFFT_HESSIAN_INDEX(PNFFT_MIN(tk[a], tk[e]), PNFFT_MAX(tk[a], tk[e]));
+            if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
+              ths->hessian_f[6*j+h] += 2 * pnfft_creal(hessian_f[c]);
+            else if (ths->trafo_flag & PNFFTI_TRAFO_C2C)
+              ((C*)ths->hessian_f)[6*j+h] += hessian_f[c];
           }
-          exp_kx0 *= exp_x0;
         }
       }
-    }
 
-    if(myrnk != pid) PNX(free)(buffer);
-  }
+    } else {
+      INT m=0;
+      C exp_kx0 = exp_kx0_start;
+      for(INT k0 = local_Np_start[t0]; k0 < local_Np_start[t0] + local_Np[t0]; k0++){
+        C exp_kx1 = exp_kx0 * exp_kx1_start;
+        for(INT k1 = local_Np_start[t1]; k1 < local_Np_start[t1] + local_Np[t1]; k1++){
+          C exp_kx2 = exp_kx1 * exp_kx2_start;
+          for(INT k2 = local_Np_start[t2]; k2 < local_Np_start[t2] + local_Np[t2]; k2++, m++){
+            if (ths->trafo_flag & PNFFTI_TRAFO_C2R) {
+              if (k0 == 0 && k1 == 0 && k2 == 0)
+                ths->f[j] += pnfft_creal(buffer[m]);
+              else if ( ! (// these have to be zero
+                           ( (k0 == 0 || k0 ==  -ths->N[t0]/2) &&
+                             (k1 == 0 || k1 ==  -ths->N[t1]/2) &&
+                             (k2 == 0 || k2 ==  -ths->N[t2]/2)    ) ||
+                           // these are redundant. we have to skip them because we always add the two
+                           // hermitean coefficients at once and we would otherwise add them twice
+                           ( k1 > 0 && (k2 == 0 || k2 == -ths->N[t2]/2) ) ||
+                           ( k0 > 0 && (k1 == 0 || k1 == -ths->N[t1]/2) && (k2 == 0 || k2 == -ths->N[t2]/2) ))
+                      )
+                ths->f[j] += 2 * pnfft_creal(buffer[m] * exp_kx2);
+            } else if (ths->trafo_flag & PNFFTI_TRAFO_C2C)
+              for(INT h=0; h<ths->howmany; h++)
+                ((C*)ths->f)[ths->howmany*j+h] += buffer[ths->howmany*m+h] * exp_kx2;
 
-  R minusTwoPi  = -2.0 * PNFFT_PI;
-  C minusTwoPiI = minusTwoPi * I;
-  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F) {
-    if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
-      for(INT j=0; j<3*ths->local_M; j++)
-        ths->grad_f[j] *= minusTwoPi;
-    else if (ths->trafo_flag & PNFFTI_TRAFO_C2C)
-      for(INT j=0; j<3*ths->local_M; j++)
-        ((C*)ths->grad_f)[j] *= minusTwoPiI;
+            exp_kx2 *= exp_x2;
+          }
+          exp_kx1 *= exp_x1;
+        }
+        exp_kx0 *= exp_x0;
+      }
+    }
   }
 }
 
 
 
+/* Partial sums of the Fourier coefficients circulate in a ring. Every process
+ * adds its contribution to the block and passes it to the left neighbor, until
+ * the block arrives at its owner. The contribution to the next block is
+ * computed while the partial sum is on the way. */
 void PNX(adj_A)(
     PNX(plan) ths
     )
 {
-  int np_total, myrnk;
-  INT local_Np[3], local_Np_start[3]; 
-  C *buffer;
+  const INT howmany = ths->howmany;
+  int np_total, myrnk, left, right;
+  INT *block_size, *block_start, max_block_total;
+  C *contrib, *sum[2];
+  MPI_Request send_request = MPI_REQUEST_NULL;
 
   MPI_Comm_size(ths->comm_cart, &np_total);
   MPI_Comm_rank(ths->comm_cart, &myrnk);
+  left  = (myrnk + np_total - 1) % np_total;
+  right = (myrnk + 1) % np_total;
 
-  for(int pid=0; pid<np_total; pid++){
-    /* compute local_Np, local_Np_start of proc. with rank pid */
-    PNX(local_block_internal)(ths->N, ths->no, ths->comm_cart, pid, ths->pnfft_flags, ths->trafo_flag,
-        local_Np, local_Np_start);
+  get_all_blocks(ths, np_total,
+      &block_size, &block_start, &max_block_total);
 
-    INT local_Np_total = PNX(prod_INT)(3, local_Np);
+  contrib = (max_block_total > 0) ? PNX(malloc_C)((size_t) (howmany*max_block_total)) : NULL;
+  sum[0]  = (max_block_total > 0) ? PNX(malloc_C)((size_t) (howmany*max_block_total)) : NULL;
+  sum[1]  = (max_block_total > 0) ? PNX(malloc_C)((size_t) (howmany*max_block_total)) : NULL;
+
+  for(int s=0; s<np_total; s++){
+    /* block of rank pid is summed up at step s */
+    int pid = (myrnk + s + 1) % np_total;
+    INT local_Np_total = PNX(prod_INT)(3, block_size + 3*pid);
+    INT local_size = howmany * local_Np_total;
+    C *partial = sum[s%2];
+    MPI_Request recv_request = MPI_REQUEST_NULL;
+
+    if(s > 0)
+      MPI_Irecv(partial, (int) (2*local_size), PNFFT_MPI_REAL_TYPE,
+          right, 0, ths->comm_cart, &recv_request);
 
     /* Avoid errors for empty blocks */
-    if(local_Np_total == 0) continue;
+    if(local_Np_total > 0)
+      adj_A_block(ths, block_size + 3*pid, block_start + 3*pid, contrib);
 
-    buffer = malloc(sizeof(C) * local_Np_total);
-    for(INT k=0; k<local_Np_total; k++) buffer[k] = 0;
+    if(s > 0){
+      MPI_Wait(&recv_request, MPI_STATUS_IGNORE);
+      for(INT k=0; k<local_size; k++)
+        partial[k] += contrib[k];
+    } else {
+      for(INT k=0; k<local_size; k++)
+        partial[k] = contrib[k];
+    }
 
-    INT t0 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 1 : 0;
-    INT t1 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 2 : 1;
-    INT t2 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 0 : 2;
+    /* buffer of the last send is reused in the next step */
+    MPI_Wait(&send_request, MPI_STATUS_IGNORE);
+    if(s+1 < np_total)
+      MPI_Isend(partial, (int) (2*local_size), PNFFT_MPI_REAL_TYPE,
+          left, 0, ths->comm_cart, &send_request);
+    else
+      for(INT k=0; k<local_size; k++)
+        ths->f_hat[k] = partial[k];
+  }
 
-    for(INT j=0; j<ths->local_M; j++){
-      C exp_x0 = pnfft_cexp(+2.0 * PNFFT_PI * ths->x[3*j+t0] * I);
-      C exp_x1 = pnfft_cexp(+2.0 * PNFFT_PI * ths->x[3*j+t1] * I);
-      C exp_x2 = pnfft_cexp(+2.0 * PNFFT_PI * ths->x[3*j+t2] * I);
+  if(contrib != NULL) PNX(free)(contrib);
+  if(sum[0] != NULL)  PNX(free)(sum[0]);
+  if(sum[1] != NULL)  PNX(free)(sum[1]);
+  PNX(free)(block_size);
+  PNX(free)(block_start);
+}
 
-      C exp_kx0_start = pnfft_cexp(+2.0 * PNFFT_PI * local_Np_start[t0] * ths->x[3*j+t0] * I);
-      C exp_kx1_start = pnfft_cexp(+2.0 * PNFFT_PI * local_Np_start[t1] * ths->x[3*j+t1] * I);
-      C exp_kx2_start = pnfft_cexp(+2.0 * PNFFT_PI * local_Np_start[t2] * ths->x[3*j+t2] * I);
+/* Every thread computes the contribution of all nodes to its own planes k0. */
+static void adj_A_block(
+    PNX(plan) ths,
+    const INT *local_Np, const INT *local_Np_start,
+    C *buffer
+    )
+{
+  const INT howmany = ths->howmany;
+  INT t0 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 1 : 0;
+  INT t1 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 2 : 1;
+  INT t2 = (ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? 0 : 2;
 
-      INT m=0;
-      C exp_kx0;
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    int num_threads = 1, tid = 0;
+#ifdef PNFFT_OPENMP
+    num_threads = omp_get_num_threads();
+    tid = omp_get_thread_num();
+#endif
+    INT k0_start = local_Np_start[t0] + (tid * local_Np[t0]) / num_threads;
+    INT k0_end   = local_Np_start[t0] + ((tid+1) * local_Np[t0]) / num_threads;
+    INT m_start  = (k0_start - local_Np_start[t0]) * local_Np[t1] * local_Np[t2];
+
+    for(INT k=howmany*m_start; k<howmany*(k0_end - local_Np_start[t0]) * local_Np[t1] * local_Np[t2]; k++)
+      buffer[k] = 0;
+
+    for(INT j=0; j<ths->local_M; j++){
+      C exp_x0 = pnfft_cexp(+2.0 * PNFFT_PI * node_coordinate(ths, j, t0) * I);
+      C exp_x1 = pnfft_cexp(+2.0 * PNFFT_PI * node_coordinate(ths, j, t1) * I);
+      C exp_x2 = pnfft_cexp(+2.0 * PNFFT_PI * node_coordinate(ths, j, t2) * I);
+
+      C exp_kx0_start = pnfft_cexp(+2.0 * PNFFT_PI * k0_start * node_coordinate(ths, j, t0) * I);
+      C exp_kx1_start = pnfft_cexp(+2.0 * PNFFT_PI * local_Np_start[t1] * node_coordinate(ths, j, t1) * I);
+      C exp_kx2_start = pnfft_cexp(+2.0 * PNFFT_PI * local_Np_start[t2] * node_coordinate(ths, j, t2) * I);
+
+      INT m=m_start;
+      C exp_kx0 = exp_kx0_start;
+      const C *f_j = (C*)ths->f + howmany*j;
+      /* a single field is multiplied into the exponentials */
       if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
-        exp_kx0 = exp_kx0_start * ths->f[j];
-      else
-        exp_kx0 = exp_kx0_start * ((C*)ths->f)[j];
-      for(INT k0 = local_Np_start[t0]; k0 < local_Np_start[t0] + local_Np[t0]; k0++){
+        exp_kx0 *= ths->f[j];
+      else if (howmany == 1)
+        exp_kx0 *= f_j[0];
+      for(INT k0 = k0_start; k0 < k0_end; k0++){
         C exp_kx1 = exp_kx0 * exp_kx1_start;
         for(INT k1 = local_Np_start[t1]; k1 < local_Np_start[t1] + local_Np[t1]; k1++){
           C exp_kx2 = exp_kx1 * exp_kx2_start;
           for(INT k2 = local_Np_start[t2]; k2 < local_Np_start[t2] + local_Np[t2]; k2++, m++){
-            buffer[m] += exp_kx2;
+            if (howmany == 1)
+              buffer[m] += exp_kx2;
+            else
+              for(INT h=0; h<howmany; h++)
+                buffer[howmany*m+h] += exp_kx2 * f_j[h];
 
             exp_kx2 *= exp_x2;
           }
@@ -542,10 +1066,24 @@ void PNX(adj_A)(
         exp_kx0 *= exp_x0;
       }
     }
+  }
+}
 
-    /* reduce block of Fourier coefficients from all procs to p */
-    MPI_Reduce(buffer, ths->f_hat, 2*local_Np_total, PNFFT_MPI_REAL_TYPE, MPI_SUM, pid, ths->comm_cart);
-    PNX(free)(buffer);
+/* local_Np and local_Np_start of all processes */
+static void get_all_blocks(
+    const PNX(plan) ths, int np_total,
+    INT **block_size, INT **block_start, INT *max_block_total
+    )
+{
+  *block_size  = PNX(malloc_INT)((size_t) 3 * np_total);
+  *block_start = PNX(malloc_INT)((size_t) 3 * np_total);
+  *max_block_total = 0;
+
+  for(int pid=0; pid<np_total; pid++){
+    PNX(local_block_internal)(ths->d, ths->N, ths->no, ths->comm_cart, pid, ths->pnfft_flags, ths->trafo_flag,
+        *block_size + 3*pid, *block_start + 3*pid);
+    if(PNX(prod_INT)(3, *block_size + 3*pid) > *max_block_total)
+      *max_block_total = PNX(prod_INT)(3, *block_size + 3*pid);
   }
 }
 
@@ -607,50 +1145,69 @@ static void local_size_B(
     INT *local_no, INT *local_no_start
     )
 {
-  for(int t=0; t<ths->d; t++){
+  for(int t=0; t<3; t++){
     local_no[t] = ths->local_no[t];
     local_no_start[t] = ths->local_no_start[t];
   }
 }
 
+/* The arrays have three entries, PFFT only sees the first d axes.
+ * The axes t >= d of plans with d < 3 have length 1 and are added afterwards. */
 INT PNX(local_size_internal)(
-    const INT *N, const INT *n, const INT *no,
+    int d, const INT *N, const INT *n, const INT *no, INT howmany,
     MPI_Comm comm_cart,
     unsigned trafo_flag, unsigned pnfft_flags,
     INT *local_N, INT *local_N_start,
     INT *local_no, INT *local_no_start
     )
 {
-  INT howmany = 1;
   unsigned pfft_flags;
+  INT alloc_local;
+
+  pad_local_size(d, local_N, local_N_start);
+  pad_local_size(d, local_no, local_no_start);
 
   if (trafo_flag & PNFFTI_TRAFO_C2R) {
     INT alloc_local_data_forw, alloc_local_data_back;
     pfft_flags = (pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? PFFT_TRANSPOSED_IN : 0;
 
-    alloc_local_data_forw = PX(local_size_many_dft_c2r)(3, n, N, no, howmany,
+    alloc_local_data_forw = PX(local_size_many_dft_c2r)(d, n, N, no, howmany,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, comm_cart, pfft_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT,
         local_N, local_N_start, local_no, local_no_start);
 
     pfft_flags = (pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? PFFT_TRANSPOSED_OUT : 0;
 
-    alloc_local_data_back = PX(local_size_many_dft_r2c)(3, n, no, N, howmany,
+    alloc_local_data_back = PX(local_size_many_dft_r2c)(d, n, no, N, howmany,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, comm_cart, pfft_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT,
         local_no, local_no_start, local_N, local_N_start);
 
-    return (alloc_local_data_forw > alloc_local_data_back) ?
+    alloc_local = (alloc_local_data_forw > alloc_local_data_back) ?
         alloc_local_data_forw : alloc_local_data_back;
   } else { /* trafo_flag & PNFFTI_TRAFO_C2C */
     pfft_flags = (pnfft_flags & PNFFT_TRANSPOSED_F_HAT) ? PFFT_TRANSPOSED_IN : 0;
 
-    return PX(local_size_many_dft)(3, n, N, no, howmany,
+    alloc_local = PX(local_size_many_dft)(d, n, N, no, howmany,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, comm_cart, pfft_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT,
         local_N, local_N_start, local_no, local_no_start);
   }
+
+  return alloc_local;
+}
+
+/* axes t >= d of plans with d < 3 consist of the single index 0 */
+static void pad_local_size(
+    int d,
+    INT *local_n, INT *local_n_start
+    )
+{
+  for(int t=d; t<3; t++){
+    local_n[t] = 1;
+    local_n_start[t] = 0;
+  }
 }
 
 void PNX(local_block_internal)(
-    const INT *N, const INT *no,
+    int d, const INT *N, const INT *no,
     MPI_Comm comm_cart, int pid,
     unsigned pnfft_flags, unsigned trafo_flag,
     INT *local_N, INT *local_N_start
@@ -679,30 +1236,56 @@ void PNX(local_block_internal)(
 //           local_block[0], local_block[1], local_block[2], local_block_start[0], local_block_start[1], local_block_start[2],
 //           local_size[0], local_size[1], local_size[2], local_size_start[0], local_size_start[1], local_size_start[2]);
 
+  pad_local_size(d, local_N, local_N_start);
+
   if (trafo_flag & PNFFTI_TRAFO_C2R) {
-    PX(local_block_many_dft_c2r)(3, N, no,
+    PX(local_block_many_dft_c2r)(d, N, no,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, comm_cart, pid, pfft_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT,
         local_N, local_N_start, dummy_lno, dummy_los);
   } else if (trafo_flag & PNFFTI_TRAFO_C2C) {
-    PX(local_block_many_dft)(3, N, no,
+    PX(local_block_many_dft)(d, N, no,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, comm_cart, pid, pfft_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT,
         local_N, local_N_start, dummy_lno, dummy_los);
   }
 }
 
 
+/* direction of all plans that are created afterwards, see PNX(plan_with_direction) */
+static int plan_direction = PNFFT_TRAFO_AND_ADJ;
+
+/* Plans created afterwards only support PNX(trafo) (PNFFT_TRAFO_ONLY) or PNX(adj) (PNFFT_ADJ_ONLY)
+ * and skip the PFFT plans, deconvolution tables and buffers of the other direction.
+ * Adjoint plans have no gradient. PNFFT_TRAFO_AND_ADJ (default) supports both. */
+void PNX(plan_with_direction)(
+    int direction
+    )
+{
+  if(direction != PNFFT_TRAFO_ONLY && direction != PNFFT_ADJ_ONLY)
+    direction = PNFFT_TRAFO_AND_ADJ;
+  plan_direction = direction;
+}
+
+int PNX(get_plan_direction)(
+    void
+    )
+{
+  return plan_direction;
+}
+
 /* N - size of NFFT
  * n - oversampled FFT size
- * no - FFT output size (if nodes are only in a subset the array) */
+ * no - FFT output size (if nodes are only in a subset the array)
+ * howmany - number of interleaved fields that share the nodes
+ * N, n and no have three entries, the axes t >= d of plans with d < 3 have length 1. */
 PNX(plan) PNX(init_internal)(
-    int d, const INT *N, const INT *n, const INT *no,
+    int d, const INT *N, const INT *n, const INT *no, INT howmany,
     INT local_M, int m,
     unsigned trafo_flag, unsigned pnfft_flags, unsigned pfft_opt_flags,
     MPI_Comm comm_cart
     )
 {
   unsigned pfft_flags=0;
-  INT howmany = 1;
+  INT howmany_alloc;
   INT alloc_local_in, alloc_local_out, alloc_local_gc;
   INT gcells_below[3], gcells_above[3];
   INT local_ngc[3], local_gc_start[3];
@@ -715,11 +1298,43 @@ PNX(plan) PNX(init_internal)(
     pnfft_flags &=  (~PNFFT_GRAD_NONE);
   }
 
+  if(pnfft_flags & PNFFT_BATCH_IK && (~pnfft_flags & PNFFT_GRAD_IK || pnfft_flags & PNFFT_REAL_F || trafo_flag & PNFFTI_TRAFO_C2R)){
+    PX(printf)(comm_cart, "!!! Warning: BATCH_IK needs GRAD_IK and complex f. Switch off batched ik gradient for this plan !!!\n");
+    pnfft_flags &= (~PNFFT_BATCH_IK);
+  }
+
+  if(pnfft_flags & PNFFT_BATCH_INTERLACED && (~pnfft_flags & PNFFT_INTERLACED || pnfft_flags & PNFFT_BATCH_IK
+        || pnfft_flags & PNFFT_REAL_F || howmany > 1)){
+    PX(printf)(comm_cart, "!!! Warning: BATCH_INTERLACED needs INTERLACED and one field without batched ik gradient. Switch off batched interlacing for this plan !!!\n");
+    pnfft_flags &= (~PNFFT_BATCH_INTERLACED);
+  }
+
+  if(pnfft_flags & PNFFT_MALLOC_HESSIAN_F && (pnfft_flags & PNFFT_GRAD_IK || howmany > 1)){
+    PX(printf)(comm_cart, "!!! Warning: HESSIAN_F needs the analytic gradient and one field. Switch off the Hessian for this plan !!!\n");
+    pnfft_flags &= (~PNFFT_MALLOC_HESSIAN_F);
+  }
+
+  /* the gradient is part of the forward transform only */
+  if(plan_direction == PNFFT_ADJ_ONLY && !(pnfft_flags & PNFFT_GRAD_NONE)){
+    pnfft_flags &= ~(PNFFT_GRAD_IK | PNFFT_BATCH_IK);
+    pnfft_flags |= PNFFT_GRAD_NONE;
+  }
+
   if(pnfft_flags & PNFFT_PRE_PSI && pnfft_flags & PNFFT_PRE_FULL_PSI){
     PX(printf)(comm_cart, "!!! Warning: PRE_PSI and PRE_FULL_PSI can not be used together. Using PRE_PSI for this plan !!!\n");
     pnfft_flags &= (~PNFFT_PRE_FULL_PSI); /* needed for correct pnfft_finalize */
   }
 
+  /* the stencil of d < 3 plans only covers the first d axes, see PNX(init_assign_kernels) */
+  if(d < 3){
+    const unsigned unsupported = PNFFT_MALLOC_GRAD_F | PNFFT_GRAD_IK | PNFFT_BATCH_IK | PNFFT_MALLOC_HESSIAN_F
+        | PNFFT_INTERLACED | PNFFT_BATCH_INTERLACED | PNFFT_PRE_FULL_PSI | PNFFT_MIXED_PRECISION;
+    if(pnfft_flags & unsupported)
+      PX(printf)(comm_cart, "!!! Warning: Plans with d < 3 only compute f. Switch off gradient, Hessian, interlacing, PRE_FULL_PSI and mixed precision for this plan !!!\n");
+    pnfft_flags &= ~unsupported;
+    pnfft_flags |= PNFFT_GRAD_NONE;
+  }
+
   /* Test Faddeeva function: */
 //   R x=0.5, y=0.1;
 //   cmplx w = w_of_z( x + I*y);
@@ -730,20 +1345,25 @@ PNX(plan) PNX(init_internal)(
   ths->d = d;
   ths->m= m;
   ths->local_M = local_M;
-
-  ths->N = (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
-  ths->n = (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
-  ths->no= (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
-  for(int t=0; t<d; t++){
+  ths->local_M_capacity = local_M;
+  ths->nodes = NULL;
+  ths->howmany = howmany;
+  ths->direction = plan_direction;
+
+  /* the per axis arrays always hold three axes, such that the kernels need no special cases */
+  ths->N = (INT*) PNX(malloc)(sizeof(INT) * 3);
+  ths->n = (INT*) PNX(malloc)(sizeof(INT) * 3);
+  ths->no= (INT*) PNX(malloc)(sizeof(INT) * 3);
+  for(int t=0; t<3; t++){
     ths->N[t]= N[t];
     ths->n[t]= n[t];
     ths->no[t]= no[t];
   }
 
-  ths->local_N        = (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
-  ths->local_N_start  = (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
-  ths->local_no       = (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
-  ths->local_no_start = (INT*) PNX(malloc)(sizeof(INT) * (size_t) d);
+  ths->local_N        = (INT*) PNX(malloc)(sizeof(INT) * 3);
+  ths->local_N_start  = (INT*) PNX(malloc)(sizeof(INT) * 3);
+  ths->local_no       = (INT*) PNX(malloc)(sizeof(INT) * 3);
+  ths->local_no_start = (INT*) PNX(malloc)(sizeof(INT) * 3);
 
   ths->pnfft_flags = pnfft_flags;
   ths->pfft_opt_flags = pfft_opt_flags;
@@ -753,27 +1373,32 @@ PNX(plan) PNX(init_internal)(
   get_mpi_cart_dims_3d(comm_cart, &ths->rnk_pm, ths->np, ths->coords);
   
   ths->cutoff = 2*m+1;
+  PNX(init_assign_kernels)(ths);
   ths->N_total = ths->n_total = 1;
   for(int t=0; t<d; t++){
     ths->N_total *= N[t];
     ths->n_total *= n[t];
   }
   /* x_max is filled in init_guru */
-  ths->x_max = (R*) PNX(malloc)(sizeof(R) * (size_t) d);
-  ths->sigma = (R*) PNX(malloc)(sizeof(R) * (size_t) d);
-  for(int t = 0;t < d; t++)
+  ths->x_max = (R*) PNX(malloc)(sizeof(R) * 3);
+  ths->sigma = (R*) PNX(malloc)(sizeof(R) * 3);
+  for(int t = 0;t < 3; t++)
     ths->sigma[t] = ((R)n[t])/N[t];
 
-  get_size_gcells(m, ths->cutoff, pnfft_flags,
+  get_size_gcells(d, m, ths->cutoff, pnfft_flags,
       gcells_below, gcells_above);
 
+  /* batched ik gradient holds the potential and three derivatives in g1 and g2,
+   * batched interlacing holds both grids */
+  howmany_alloc = (pnfft_flags & PNFFT_BATCH_IK) ? 4 : (pnfft_flags & PNFFT_BATCH_INTERLACED) ? 2 : howmany;
+
   /* alloc_local_data_in is given in units of complex for both c2r and c2c */
-  alloc_local_in = PNX(local_size_internal)(N, n, no, comm_cart, ths->trafo_flag, ths->pnfft_flags,
+  alloc_local_in = PNX(local_size_internal)(d, N, n, no, howmany_alloc, comm_cart, ths->trafo_flag, ths->pnfft_flags,
       ths->local_N, ths->local_N_start, ths->local_no, ths->local_no_start);
 
   /* alloc_local is given in units of complex for c2c and in units of real for c2r */
-  alloc_local_gc = PX(local_size_many_gc)(3, ths->local_no, ths->local_no_start,
-      howmany, gcells_below, gcells_above,
+  alloc_local_gc = PX(local_size_many_gc)(d, ths->local_no, ths->local_no_start,
+      howmany_alloc, gcells_below, gcells_above,
       local_ngc, local_gc_start);
 
   /* convert into units of real */
@@ -788,54 +1413,89 @@ PNX(plan) PNX(init_internal)(
   ths->local_no_total = PNX(prod_INT)(d, ths->local_no);
 
   if(pnfft_flags & PNFFT_MALLOC_F_HAT)
-    ths->f_hat = (ths->local_N_total) ? (C*) PNX(malloc)(sizeof(C) * (size_t) ths->local_N_total) : NULL;
+    ths->f_hat = (ths->local_N_total) ? (C*) PNX(malloc)(sizeof(C) * (size_t) (howmany*ths->local_N_total)) : NULL;
 
   /* init PFFT all the time (do not use the PNFFT_INIT_FFT flag anymore since
-   * the init of parallel FFT is far too complicated for any user) */
-  ths->g2 = (alloc_local_out) ? PNX(alloc_real)(alloc_local_out) : NULL;
+   * the init of parallel FFT is far too complicated for any user).
+   * The grids only hold data during one call and may be shared by the plans of an arena. */
+  ths->arena = PNX(get_plan_arena)();
+  ths->alloc_flags = PNX(get_plan_alloc)();
+  ths->g2 = (R*) PNX(alloc_grid)(ths, PNFFTI_GRID_G2, alloc_local_out * (INT) sizeof(R));
   if(pnfft_flags & PNFFT_FFT_IN_PLACE)
     ths->g1 = ths->g2;
   else
-    ths->g1 = (alloc_local_in) ? PNX(alloc_real)(alloc_local_in) : NULL;
+    ths->g1 = (R*) PNX(alloc_grid)(ths, PNFFTI_GRID_G1, alloc_local_in * (INT) sizeof(R));
 
   /* For derivative in Fourier space we need an extra buffer
    * (since we need to scale the output of the forward FFT with three different factors) */
-  if(ths->pnfft_flags & PNFFT_GRAD_IK)
-    ths->g1_buffer = (ths->local_N_total) ? PNX(alloc_real)(2 * ths->local_N_total) : NULL;
+  if((ths->pnfft_flags & PNFFT_GRAD_IK) && !(ths->pnfft_flags & PNFFT_BATCH_IK))
+    ths->g1_buffer = (R*) PNX(alloc_grid)(ths, PNFFTI_GRID_G1_BUFFER, 2 * ths->local_N_total * (INT) sizeof(R));
   else
     ths->g1_buffer = NULL;
 
+  /* gather and spread of complex plans on a single precision copy of g2 */
+  if((ths->pnfft_flags & PNFFT_MIXED_PRECISION) && (ths->trafo_flag & PNFFTI_TRAFO_C2C))
+    ths->g2_single = (CS*) PNX(alloc_grid)(ths, PNFFTI_GRID_G2_SINGLE, alloc_local_gc/2 * (INT) sizeof(CS));
+  else
+    ths->g2_single = NULL;
+  PNX(arena_attach)(ths);
+
+  /* Interlacing in two passes keeps the non-interlaced results of f and grad_f (trafo) or f_hat (adj).
+   * Batched interlacing only needs it for the gradient, which grows the buffer on first use.
+   * Plans of an arena take the buffer from the pool in every call. */
+  if((ths->pnfft_flags & PNFFT_INTERLACED) && !(ths->pnfft_flags & PNFFT_BATCH_INTERLACED) && ths->arena == NULL){
+    INT cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+    INT size_trafo = (ths->direction != PNFFT_ADJ_ONLY) ? cplx * (howmany + d) * local_M : 0;
+    INT size_adj = (ths->direction != PNFFT_TRAFO_ONLY) ? 2 * howmany * ths->local_N_total : 0;
+    ths->buffer_il_size = PNFFT_MAX(size_trafo, size_adj);
+    ths->buffer_il = (ths->buffer_il_size) ? PNX(alloc_real)(ths->buffer_il_size) : NULL;
+  }
+
   /* plan PFFT */
+  PNX(plan_grid_fft)(ths, ths->g1, ths->g2, comm_cart,
+      &ths->pfft_forw, &ths->pfft_back, &ths->gcplan);
+
   pfft_flags = pfft_opt_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT;
   if(ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT)
     pfft_flags |= PFFT_TRANSPOSED_IN;
-  if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-    ths->pfft_forw = PX(plan_many_dft_c2r)(3, n, N, no, howmany,
+  if((ths->pnfft_flags & PNFFT_BATCH_IK) && ths->direction != PNFFT_ADJ_ONLY)
+    ths->pfft_forw_ik = PX(plan_many_dft)(d, n, N, no, 4,
+        PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) ths->g1, (C*) ths->g2, comm_cart,
+        PFFT_FORWARD, pfft_flags);
+  if(ths->direction == PNFFT_ADJ_ONLY)
+    ths->pfft_forw_il = NULL;
+  else if((ths->pnfft_flags & PNFFT_BATCH_INTERLACED) && (ths->trafo_flag & PNFFTI_TRAFO_C2R))
+    ths->pfft_forw_il = PX(plan_many_dft_c2r)(d, n, N, no, 2,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) ths->g1, ths->g2, comm_cart,
         PFFT_FORWARD, pfft_flags);
-  else
-    ths->pfft_forw = PX(plan_many_dft)(3, n, N, no, howmany,
+  else if(ths->pnfft_flags & PNFFT_BATCH_INTERLACED)
+    ths->pfft_forw_il = PX(plan_many_dft)(d, n, N, no, 2,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) ths->g1, (C*) ths->g2, comm_cart,
         PFFT_FORWARD, pfft_flags);
   
   pfft_flags = pfft_opt_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT;
   if(ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT) 
     pfft_flags |= PFFT_TRANSPOSED_OUT;
-  if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-    ths->pfft_back = PX(plan_many_dft_r2c)(3, n, no, N, howmany,
+  if(ths->direction == PNFFT_TRAFO_ONLY)
+    ths->pfft_back_il = NULL;
+  else if((ths->pnfft_flags & PNFFT_BATCH_INTERLACED) && (ths->trafo_flag & PNFFTI_TRAFO_C2R))
+    ths->pfft_back_il = PX(plan_many_dft_r2c)(d, n, no, N, 2,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, ths->g2, (C*) ths->g1, comm_cart,
         PFFT_BACKWARD, pfft_flags);
-  else
-    ths->pfft_back = PX(plan_many_dft)(3, n, no, N, howmany,
+  else if(ths->pnfft_flags & PNFFT_BATCH_INTERLACED)
+    ths->pfft_back_il = PX(plan_many_dft)(d, n, no, N, 2,
         PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) ths->g2, (C*) ths->g1, comm_cart,
         PFFT_BACKWARD, pfft_flags);
 
   /* plan ghost cell send and receive */
-  if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-    ths->gcplan = PX(plan_many_rgc)(3, no, howmany, PFFT_DEFAULT_BLOCKS,
+  if(ths->pnfft_flags & PNFFT_BATCH_IK)
+    ths->gcplan_ik = PX(plan_many_cgc)(d, no, 4, PFFT_DEFAULT_BLOCKS,
+        gcells_below, gcells_above, (C*) ths->g2, comm_cart, 0);
+  if((ths->pnfft_flags & PNFFT_BATCH_INTERLACED) && (ths->trafo_flag & PNFFTI_TRAFO_C2R))
+    ths->gcplan_il = PX(plan_many_rgc)(d, no, 2, PFFT_DEFAULT_BLOCKS,
         gcells_below, gcells_above, ths->g2, comm_cart, 0);
-  else
-    ths->gcplan = PX(plan_many_cgc)(3, no, howmany, PFFT_DEFAULT_BLOCKS,
+  else if(ths->pnfft_flags & PNFFT_BATCH_INTERLACED)
+    ths->gcplan_il = PX(plan_many_cgc)(d, no, 2, PFFT_DEFAULT_BLOCKS,
         gcells_below, gcells_above, (C*) ths->g2, comm_cart, 0);
 
   /* init interpolation of window function */
@@ -847,15 +1507,17 @@ PNX(plan) PNX(init_internal)(
     ths->intpol_order = 2;
   else if(pnfft_flags & PNFFT_PRE_CUB_PSI)
     ths->intpol_order = 3;
+  else if(pnfft_flags & PNFFT_PRE_POLY_PSI)
+    ths->intpol_order = m + 3; /* polynomial degree per stencil cell */
   else
     ths->intpol_order = -1;
 
   /* init window specific parameters */
-  ths->b = (R*) PNX(malloc)(sizeof(R) * (size_t) d);
+  ths->b = (R*) PNX(malloc)(sizeof(R) * 3);
+  for(int t=0; t<3; t++)
+    ths->b[t] = PNX(window_shape_parameter)(ths->pnfft_flags, ths->m, ths->sigma[t]);
 
   if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN){
-    for(int t=0; t<ths->d; t++)
-      ths->b[t]= ((R)ths->m / PNFFT_PI) * K(2.0)*ths->sigma[t] / (K(2.0)*ths->sigma[t]-K(1.0));
 #if TUNE_B_FOR_EWALD_SPLITTING
     for(int t=0; t<ths->d; t++)
       ths->b[t]= 0.715303;
@@ -875,15 +1537,11 @@ PNX(plan) PNX(init_internal)(
 //     }
 #endif
   } else if(pnfft_flags & PNFFT_WINDOW_BSPLINE){
-    /* malloc array for scratch values of de Boor algorithm, no need to initialize */
-    if(ths->spline_coeffs == NULL)
-      ths->spline_coeffs= (R*) PNX(malloc)(sizeof(R)*2*ths->m);
+    /* piecewise polynomials of the Bspline of order 2m, read only during the transforms */
+    init_spline_coeffs(ths);
   } else if(pnfft_flags & PNFFT_WINDOW_SINC_POWER){
-    /* malloc array for scratch values of de Boor algorithm, no need to initialize */
-    if(ths->spline_coeffs == NULL)
-      ths->spline_coeffs= (R*) PNX(malloc)(sizeof(R)*2*ths->m);
-    for(int t=0; t<ths->d; t++)
-      ths->b[t]= (R)ths->m * (K(2.0)*ths->sigma[t]) / (K(2.0)*ths->sigma[t]-K(1.0));
+    /* phi_hat is the Bspline of order 2m */
+    init_spline_coeffs(ths);
 #if TUNE_B_FOR_EWALD_SPLITTING
 //     fprintf(stderr, "Sinc-Power: old b = %.4e\n", ths->b[0]);
     for(int t=0; t<ths->d; t++)
@@ -891,15 +1549,13 @@ PNX(plan) PNX(init_internal)(
 //     fprintf(stderr, "Sinc-Power: new b = %.4e\n", ths->b[0]);
 #endif
   } else if(pnfft_flags & PNFFT_WINDOW_BESSEL_I0){
-    for(int t=0; t<ths->d; t++)
-      ths->b[t] = (R) PNFFT_PI * (K(2.0) - K(1.0)/ths->sigma[t]);
 #if TUNE_B_FOR_EWALD_SPLITTING
     for(int t=0; t<ths->d; t++)
       ths->b[t]= 5.45066;
 #endif
+  } else if(pnfft_flags & PNFFT_WINDOW_ES){
+    /* phi_hat has no closed form and is tabulated in init_precompute_window */
   } else { /* default window function is Kaiser-Bessel */
-    for(int t=0; t<ths->d; t++)
-      ths->b[t] = (R) PNFFT_PI * (K(2.0) - K(1.0)/ths->sigma[t]);
 #if TUNE_B_FOR_EWALD_SPLITTING
     for(int t=0; t<ths->d; t++)
 //       ths->b[t]= 5.35;
@@ -916,19 +1572,27 @@ PNX(plan) PNX(init_internal)(
   PNX(malloc_x)(ths, pnfft_flags);
   PNX(malloc_f)(ths, pnfft_flags);
   PNX(malloc_grad_f)(ths, pnfft_flags);
+  PNX(malloc_hessian_f)(ths, pnfft_flags);
 
   return ths;
 }
 
 
+/* Tables that depend on the window and b. Repeated calls, e.g., after a new b, reuse the memory.
+ * The tables cover all three axes, also the axes of length 1 of plans with d < 3. */
 void PNX(init_precompute_window)(
     PNX(plan) ths
     )
 {
+  init_window_loops(ths);
+
+  if(ths->pnfft_flags & PNFFT_WINDOW_ES)
+    PNX(precompute_phi_hat_es)(ths);
+
   if(ths->pnfft_flags & PNFFT_FG_PSI){
     if(ths->exp_const == NULL)
-      ths->exp_const = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->d * ths->cutoff);
-    for(int t=0; t<ths->d; t++)
+      ths->exp_const = (R*) PNX(malloc)(sizeof(R) * (size_t) 3 * ths->cutoff);
+    for(int t=0; t<3; t++)
       for(int s=0; s<ths->cutoff; s++)
         ths->exp_const[ths->cutoff*t+s] = pnfft_exp(-s*s/ths->b[t])/(pnfft_sqrt(PNFFT_PI*ths->b[t]));
   }
@@ -941,26 +1605,46 @@ void PNX(init_precompute_window)(
 #if PNFFT_ENABLE_CALC_INTPOL_NODES
     ths->intpol_num_nodes = calc_intpol_num_nodes(ths->intpol_order, 1e-16);
 #else
-    /* For m=15 we get 1e-15 accuracy with 3rd order interpolation and 2048 interpolation nodes per interval,
-     * which gives a total number of (2*15+1)*2048 interpolation nodes.
-     * Keep the total number of interpolation nodes (2*m+1)*intpol_num_nodes constant for all other 'm'. */
-    ths->intpol_num_nodes = pnfft_ceil( (2.0*15.0+1.0)/ths->cutoff ) * 2048;
+    ths->intpol_num_nodes = PNX(default_intpol_num_nodes)(ths->cutoff);
 #endif
-    if(ths->intpol_tables_psi == NULL)
-      ths->intpol_tables_psi = (R**) PNX(malloc)(sizeof(R*) * (size_t) ths->d);
-    for(int t=0; t<ths->d; t++){
-      ths->intpol_tables_psi[t] = (R*) PNX(malloc)(sizeof(R)*(ths->intpol_num_nodes * ths->cutoff * (ths->intpol_order+1)));
-      init_intpol_table_psi(ths->intpol_num_nodes, ths->intpol_order, ths->cutoff, ths->n[t], ths->m, t, ths,
-          ths->intpol_tables_psi[t]);
+    if(ths->intpol_tables_psi == NULL){
+      ths->intpol_tables_psi = (R**) PNX(malloc)(sizeof(R*) * 3);
+      for(int t=0; t<3; t++)
+        ths->intpol_tables_psi[t] = (R*) PNX(malloc)(sizeof(R)*(ths->intpol_num_nodes * ths->cutoff * (ths->intpol_order+1)));
     }
+    for(int t=0; t<3; t++)
+      init_window_table(ths, t, 0, 0,
+          ths->intpol_tables_psi[t]);
     if( !(ths->pnfft_flags & (PNFFT_GRAD_IK | PNFFT_GRAD_NONE) ) ){
-      if(ths->intpol_tables_dpsi == NULL)
-        ths->intpol_tables_dpsi = (R**) PNX(malloc)(sizeof(R*) * (size_t) ths->d);
-      for(int t=0; t<ths->d; t++){
-        ths->intpol_tables_dpsi[t] = (R*) PNX(malloc)(sizeof(R)*(ths->intpol_num_nodes * ths->cutoff * (ths->intpol_order+1)));
-        init_intpol_table_dpsi(ths->intpol_num_nodes, ths->intpol_order, ths->cutoff, ths->n[t], ths->m, t, ths,
+      if(ths->intpol_tables_dpsi == NULL){
+        ths->intpol_tables_dpsi = (R**) PNX(malloc)(sizeof(R*) * 3);
+        for(int t=0; t<3; t++)
+          ths->intpol_tables_dpsi[t] = (R*) PNX(malloc)(sizeof(R)*(ths->intpol_num_nodes * ths->cutoff * (ths->intpol_order+1)));
+      }
+      for(int t=0; t<3; t++)
+        init_window_table(ths, t, 0, 1,
             ths->intpol_tables_dpsi[t]);
+    }
+  } else if(ths->pnfft_flags & PNFFT_PRE_POLY_PSI){
+    /* one polynomial per stencil cell, stored like an interpolation table with a single interval */
+    ths->intpol_num_nodes = 1;
+    if(ths->intpol_tables_psi == NULL){
+      ths->intpol_tables_psi = (R**) PNX(malloc)(sizeof(R*) * 3);
+      for(int t=0; t<3; t++)
+        ths->intpol_tables_psi[t] = (R*) PNX(malloc)(sizeof(R)*(ths->cutoff * (ths->intpol_order+1)));
+    }
+    for(int t=0; t<3; t++)
+      init_window_table(ths, t, 1, 0,
+          ths->intpol_tables_psi[t]);
+    if( !(ths->pnfft_flags & (PNFFT_GRAD_IK | PNFFT_GRAD_NONE) ) ){
+      if(ths->intpol_tables_dpsi == NULL){
+        ths->intpol_tables_dpsi = (R**) PNX(malloc)(sizeof(R*) * 3);
+        for(int t=0; t<3; t++)
+          ths->intpol_tables_dpsi[t] = (R*) PNX(malloc)(sizeof(R)*(ths->cutoff * (ths->intpol_order+1)));
       }
+      for(int t=0; t<3; t++)
+        init_window_table(ths, t, 1, 1,
+            ths->intpol_tables_dpsi[t]);
     }
   }
 #if PNFFT_TUNE_PRECOMPUTE_INTPOL
@@ -970,15 +1654,34 @@ void PNX(init_precompute_window)(
 
   /* precompute deconvultion in Fourier space */
   if(ths->pnfft_flags & PNFFT_PRE_PHI_HAT){
-    if(ths->pre_inv_phi_hat_trafo == NULL)
-      ths->pre_inv_phi_hat_trafo = (C*) malloc(sizeof(C) * PNX(sum_INT)(ths->d, ths->local_N));
-    if(ths->pre_inv_phi_hat_adj == NULL)
-      ths->pre_inv_phi_hat_adj   = (C*) malloc(sizeof(C) * PNX(sum_INT)(ths->d, ths->local_N));
+    const int trafo = (ths->direction != PNFFT_ADJ_ONLY), adj = (ths->direction != PNFFT_TRAFO_ONLY);
+
+    if(trafo && ths->pre_inv_phi_hat_trafo == NULL)
+      ths->pre_inv_phi_hat_trafo = (C*) malloc(sizeof(C) * PNX(sum_INT)(3, ths->local_N));
+    if(adj && ths->pre_inv_phi_hat_adj == NULL)
+      ths->pre_inv_phi_hat_adj   = (C*) malloc(sizeof(C) * PNX(sum_INT)(3, ths->local_N));
     
-    PNX(precompute_inv_phi_hat_trafo)(ths,
-        ths->pre_inv_phi_hat_trafo);
-    PNX(precompute_inv_phi_hat_adj)(ths,
-        ths->pre_inv_phi_hat_adj);
+    if(trafo)
+      PNX(precompute_inv_phi_hat_trafo)(ths,
+          ths->pre_inv_phi_hat_trafo);
+    if(adj)
+      PNX(precompute_inv_phi_hat_adj)(ths,
+          ths->pre_inv_phi_hat_adj);
+
+    /* interlacing uses separate tables with the modulation included */
+    if(ths->pnfft_flags & PNFFT_INTERLACED){
+      if(trafo && ths->pre_inv_phi_hat_trafo_il == NULL)
+        ths->pre_inv_phi_hat_trafo_il = (C*) PNX(malloc)(sizeof(C) * (size_t) PNX(sum_INT)(3, ths->local_N));
+      if(adj && ths->pre_inv_phi_hat_adj_il == NULL)
+        ths->pre_inv_phi_hat_adj_il   = (C*) PNX(malloc)(sizeof(C) * (size_t) PNX(sum_INT)(3, ths->local_N));
+
+      if(trafo)
+        PNX(precompute_inv_phi_hat_interlaced)(ths, FFTW_FORWARD,
+            ths->pre_inv_phi_hat_trafo_il);
+      if(adj)
+        PNX(precompute_inv_phi_hat_interlaced)(ths, FFTW_BACKWARD,
+            ths->pre_inv_phi_hat_adj_il);
+    }
   }
 }
 
@@ -990,37 +1693,58 @@ void PNX(precompute_psi)(
 {
   INT size;
   INT *sorted_index = NULL;
-  R *buffer_psi=NULL, *buffer_dpsi=NULL;
-  R x[3];
-  int compute_grad_ad;
+  int compute_grad_ad, chunked;
  
   compute_grad_ad = !(ths->pnfft_flags & (PNFFT_GRAD_NONE | PNFFT_GRAD_IK))
                     && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F);
 
+  /* the chunks use neither the particle halo nor PNFFT_SPARSE_B, such that the
+   * calls between the chunked start and finish stay local */
+  chunked = (ths->exec_kind == PNFFTI_EXEC_TRAFO_CHUNKED || ths->exec_kind == PNFFTI_EXEC_ADJ_CHUNKED);
+
+  /* particle halo of the new nodes, the received copies are precomputed as well */
+  if(!chunked)
+    PNX(init_halo)(ths);
+
+  /* nodes may have moved, sort them again but keep the order of PNX(sort_nodes) */
+  ths->sorted_index_valid = 0;
+
+  /* matrix B of PNFFT_SPARSE_B for the new nodes */
+  PNX(free_sparse_b)(ths);
+  if(ths->sparse_b_mode != PNFFT_SPARSE_B_OFF && !chunked){
+    PNX(profile_start)(ths, PNFFT_PROFILE_PRECOMPUTE_PSI);
+    ths->sparse_b[0] = init_sparse_b(ths, 0);
+    if(ths->pnfft_flags & PNFFT_INTERLACED)
+      ths->sparse_b[1] = init_sparse_b(ths, 1);
+    PNX(profile_finish)(ths, PNFFT_PROFILE_PRECOMPUTE_PSI);
+  }
+
   /* cleanup old precomputations */
-  if(ths->pre_psi != NULL)
-    PNX(free)(ths->pre_psi);
-  if(ths->pre_dpsi != NULL)
-    PNX(free)(ths->pre_dpsi);
-  if(ths->pre_psi_il != NULL)
-    PNX(free)(ths->pre_psi_il);
-  if(ths->pre_dpsi_il != NULL)
-    PNX(free)(ths->pre_dpsi_il);
+  PNX(free_pre_psi)(ths);
 
   if(!(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
     return;
 
+  /* blocked PNFFT_PRE_FULL_PSI fills the tensors within the loops over the nodes */
+  if(PNFFT_PRE_PSI_BLOCKED(ths))
+    return;
+
+  PNX(profile_start)(ths, PNFFT_PROFILE_PRECOMPUTE_PSI);
+
   /* allocate memory */
   if(ths->pnfft_flags & PNFFT_PRE_PSI){
+    const size_t value_size = PNFFT_PRE_PSI_SINGLE(ths) ? sizeof(float) : sizeof(R);
+
     size = 3 * ths->cutoff * ths->local_M;
-    ths->pre_psi = (size) ? (R*) PNX(malloc)(sizeof(R) * size) : NULL;
+    ths->pre_psi = (size) ? (R*) PNX(malloc)(value_size * size) : NULL;
     if(ths->pnfft_flags & PNFFT_INTERLACED)
-      ths->pre_psi_il = (size) ? (R*) PNX(malloc)(sizeof(R) * size) : NULL;
+      ths->pre_psi_il = (size) ? (R*) PNX(malloc)(value_size * size) : NULL;
     if(compute_grad_ad){
-      ths->pre_dpsi = (size) ? (R*) PNX(malloc)(sizeof(R) * size) : NULL;
+      ths->pre_dpsi = (size) ? (R*) PNX(malloc)(value_size * size) : NULL;
       if(ths->pnfft_flags & PNFFT_INTERLACED)
-        ths->pre_dpsi_il = (size) ? (R*) PNX(malloc)(sizeof(R) * size) : NULL;
+        ths->pre_dpsi_il = (size) ? (R*) PNX(malloc)(value_size * size) : NULL;
     }
+    first_touch_pre_psi(ths, value_size * size, value_size * size);
   }
 
   if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI){
@@ -1033,1629 +1757,4431 @@ void PNX(precompute_psi)(
       if(ths->pnfft_flags & PNFFT_INTERLACED)
         ths->pre_dpsi_il = (size) ? (R*) PNX(malloc)(sizeof(R) * 3 * size) : NULL;
     }
+    first_touch_pre_psi(ths, sizeof(R) * size, sizeof(R) * 3 * size);
   }
 
   /* save precomputations in the same order as need in matrix B */
-  if(ths->pnfft_flags & PNFFT_SORT_NODES){
-    sorted_index = (INT*) PNX(malloc)(sizeof(INT) * (size_t) 2*ths->local_M);
-    sort_nodes_for_better_cache_handle(
-        ths->d, ths->n, ths->m, ths->local_M, ths->x,
-        sorted_index);
-  }
+  sorted_index = get_sorted_index(ths, NULL);
+  precompute_psi_nodes(ths, sorted_index, compute_grad_ad);
 
-  if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI){
-    buffer_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->cutoff*3);
-    if(compute_grad_ad)
-      buffer_dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->cutoff*3);
-  }
-  for(INT p=0; p<ths->local_M; p++){
-    INT j = (ths->pnfft_flags & PNFFT_SORT_NODES) ? sorted_index[2*p+1] : p;
+  PNX(profile_finish)(ths, PNFFT_PROFILE_PRECOMPUTE_PSI);
+}
 
-    for(int t=0; t<3; t++)
-      x[t] = ths->x[ths->d*j+t];
-    precompute_psi(ths, p, x, buffer_psi, buffer_dpsi, compute_grad_ad,
-        ths->pre_psi, ths->pre_dpsi);
+/* Every node only writes its own part of the tables, such that the threads share the nodes
+ * with the same static decomposition as the first touch of the tables. */
+static void precompute_psi_nodes(
+    PNX(plan) ths, const INT *sorted_index, int compute_grad_ad
+    )
+{
+  const int buffered = (ths->pnfft_flags & PNFFT_PRE_FULL_PSI) || PNFFT_PRE_PSI_SINGLE(ths);
 
-    if(ths->pnfft_flags & PNFFT_INTERLACED){
-      /* shift x by half the mesh width */
-      for(int t=0; t<3; t++){
-        x[t] = ths->x[ths->d*j+t] + 0.5/ths->n[t];
-        if(x[t] >= 0.5)
-          x[t] -= 1.0;
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    R *buffer_psi = NULL, *buffer_dpsi = NULL;
+    R x[3];
+
+    if(buffered){
+      buffer_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->cutoff*3);
+      if(compute_grad_ad)
+        buffer_dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->cutoff*3);
+    }
+
+#ifdef PNFFT_OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(INT p=0; p<ths->local_M; p++){
+      INT j = (sorted_index) ? sorted_index[2*p+1] : p;
+
+      for(int t=0; t<3; t++)
+        x[t] = node_coordinate(ths, j, t);
+      precompute_psi(ths, p, x, buffer_psi, buffer_dpsi, compute_grad_ad, ths->spline_coeffs,
+          ths->pre_psi, ths->pre_dpsi);
+
+      if(ths->pnfft_flags & PNFFT_INTERLACED){
+        /* shift x by half the mesh width */
+        for(int t=0; t<3; t++){
+          x[t] = node_coordinate(ths, j, t) + 0.5/ths->n[t];
+          if(x[t] >= 0.5)
+            x[t] -= 1.0;
+        }
+        precompute_psi(ths, p, x, buffer_psi, buffer_dpsi, compute_grad_ad, ths->spline_coeffs,
+            ths->pre_psi_il, ths->pre_dpsi_il);
       }
-      precompute_psi(ths, p, x, buffer_psi, buffer_dpsi, compute_grad_ad,
-          ths->pre_psi_il, ths->pre_dpsi_il);
     }
+
+    if(buffer_psi != NULL)
+      PNX(free)(buffer_psi);
+    if(buffer_dpsi != NULL)
+      PNX(free)(buffer_dpsi);
+  }
+}
+
+/* Window values of a fused round trip adj -> trafo. The adjoint evaluates the window within its
+ * node loops as usual and keeps the values of as many nodes of the sorted order as fit into the
+ * budget of PNX(set_shared_psi), the trafo reuses them. The received copies of the particle halo
+ * get their own values from the rest of the budget.
+ * Returns 0 and does nothing, if the plan already holds precomputed window values or the budget is 0. */
+int PNX(init_shared_psi)(
+    PNX(plan) ths
+    )
+{
+  INT bytes = ths->shared_psi_bytes;
+
+  if(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI))
+    return 0;
+  if(ths->shared_psi != NULL)
+    return 0;
+
+  /* by default not more than the oversampled grid */
+  if(bytes < 0)
+    bytes = (INT) sizeof(C) * ths->howmany * ths->local_no_total;
+
+  bytes -= mk_shared_psi(ths, bytes);
+  if(ths->halo != NULL){
+    PNX(halo) halo = ths->halo;
+    PNX(halo_attach)(halo, ths);
+    mk_shared_psi(ths, bytes);
+    PNX(halo_detach)(halo, ths);
   }
 
-  if(sorted_index != NULL)
-    PNX(free)(sorted_index);
-  if(buffer_psi != NULL)
-    PNX(free)(buffer_psi);
-  if(buffer_dpsi != NULL)
-    PNX(free)(buffer_dpsi);
+  return 1;
 }
 
-static void precompute_psi(
-    PNX(plan) ths, INT ind, R* x, R* buffer_psi, R* buffer_dpsi,
-    int compute_grad_ad,
-    R* pre_psi, R* pre_dpsi
+/* Frees the shared window values of the current nodes and of the copies of their halo. */
+void PNX(free_shared_psi)(
+    PNX(plan) ths
     )
 {
-  int cutoff = ths->cutoff;
-  R floor_nx[3];
-  for(int t=0; t<3; t++)
-    floor_nx[t] = pnfft_floor(ths->n[t]*x[t]);
+  if(ths->halo != NULL){
+    PNX(halo) halo = ths->halo;
+    PNX(halo_attach)(halo, ths);
+    rm_shared_psi(ths);
+    PNX(halo_detach)(halo, ths);
+  }
+  rm_shared_psi(ths);
+}
 
-  if(ths->pnfft_flags & PNFFT_PRE_PSI){
-    /* shift index to current particle */
-    pre_psi += ind * 3 * cutoff;
-    if(compute_grad_ad)
-      pre_dpsi += ind * 3 * cutoff;
+/* Shared window values of the current nodes within 'bytes', returns the used bytes. */
+static INT mk_shared_psi(
+    PNX(plan) ths, INT bytes
+    )
+{
+  const int grids = (ths->pnfft_flags & PNFFT_INTERLACED) ? 2 : 1;
+  const int grad = !(ths->pnfft_flags & (PNFFT_GRAD_NONE | PNFFT_GRAD_IK))
+                   && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F);
+  const INT node_values = 3 * ths->cutoff;
+  const INT node_bytes = (INT) sizeof(R) * node_values * grids * (grad ? 2 : 1);
+  PNX(shared_psi) *shared;
+
+  rm_shared_psi(ths);
+
+  shared = (PNX(shared_psi)*) malloc(sizeof(PNX(shared_psi)));
+  memset(shared, 0, sizeof(PNX(shared_psi)));
+  shared->grad = grad;
+  shared->nodes = (bytes > 0) ? PNFFT_MIN(bytes / node_bytes, ths->local_M) : 0;
+
+  if(shared->nodes > 0)
+    for(int g=0; g<grids; g++){
+      shared->psi[g] = (R*) PNX(malloc)(sizeof(R) * (size_t) (node_values * shared->nodes));
+      if(grad)
+        shared->dpsi[g] = (R*) PNX(malloc)(sizeof(R) * (size_t) (node_values * shared->nodes));
+    }
 
-    pre_psi_tensor(
-        ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx,
-        ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-        ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
-        pre_psi);
+  ths->shared_psi = shared;
+  return node_bytes * shared->nodes;
+}
 
-    if(compute_grad_ad)
-      pre_dpsi_tensor(
-          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx, ths->spline_coeffs,
-          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_dpsi,
-          pre_psi, ths->pnfft_flags,
-          pre_dpsi);
+static void rm_shared_psi(
+    PNX(plan) ths
+    )
+{
+  PNX(shared_psi) *shared = ths->shared_psi;
+
+  if(shared == NULL)
+    return;
+
+  for(int g=0; g<2; g++){
+    if(shared->psi[g] != NULL)  PNX(free)(shared->psi[g]);
+    if(shared->dpsi[g] != NULL) PNX(free)(shared->dpsi[g]);
   }
-  else if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI){
-    /* shift index to current particle */
-    pre_psi += ind * PNFFT_POW3(cutoff);
-    if(compute_grad_ad)
-      pre_dpsi += 3 * ind * PNFFT_POW3(cutoff);
+  free(shared);
+  ths->shared_psi = NULL;
+}
 
-    pre_psi_tensor(
-        ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx,
-        ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-        ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
-        buffer_psi);
+/* The adjoint node loop of the non-interlaced or the interlaced grid stored its window values. */
+static void finish_shared_psi(
+    PNX(plan) ths, int interlaced
+    )
+{
+  if(ths->shared_psi != NULL && interlaced != PNFFTI_INTERLACED_BATCHED)
+    ths->shared_psi->filled[(interlaced) ? 1 : 0] = 1;
+}
 
-    if(compute_grad_ad)
-        pre_dpsi_tensor(
-            ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx, ths->spline_coeffs,
-            ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_dpsi,
-            buffer_psi, ths->pnfft_flags,
-            buffer_dpsi);
+/* Shared window values of node p of the sorted order or NULL, if the node has none.
+ * Sets 'ready', if adj already stored them. Batched interlacing evaluates both grids at once
+ * and always computes its values directly. */
+static inline R* node_shared_psi(
+    const PNX(shared_psi) *shared, INT p, int interlaced, int cutoff,
+    R **dpsi, int *ready
+    )
+{
+  int g = (interlaced) ? 1 : 0;
 
-    if(compute_grad_ad){
-      INT m=0;
-      INT md=0;
-      for(INT l0=0; l0<cutoff; l0++){
-        for(INT l1=cutoff; l1<2*cutoff; l1++){
-          R psi_xy  = buffer_psi[l0]   * buffer_psi[l1];
-          R psi_dxy = buffer_dpsi[l0]  * buffer_psi[l1];
-          R psi_xdy = buffer_psi[l0]   * buffer_dpsi[l1];
-          for(INT l2=2*cutoff; l2<3*cutoff; l2++, md+=3){
-            pre_psi[m++]   = psi_xy  * buffer_psi[l2];
-            pre_dpsi[md+0] = psi_dxy * buffer_psi[l2];
-            pre_dpsi[md+1] = psi_xdy * buffer_psi[l2];
-            pre_dpsi[md+2] = psi_xy  * buffer_dpsi[l2];
-          }
-        }
-      }
-    } else {
-      INT m=0;
-      for(INT l0=0; l0<cutoff; l0++)
-        for(INT l1=cutoff; l1<2*cutoff; l1++)
-          for(INT l2=2*cutoff; l2<3*cutoff; l2++)
-            pre_psi[m++] = buffer_psi[l0] * buffer_psi[l1] * buffer_psi[l2];
-    }
-  }
+  if(shared == NULL || interlaced == PNFFTI_INTERLACED_BATCHED || p >= shared->nodes || shared->psi[g] == NULL)
+    return NULL;
+
+  *ready = shared->filled[g];
+  *dpsi = (shared->grad) ? shared->dpsi[g] + 3*cutoff*p : NULL;
+  return shared->psi[g] + 3*cutoff*p;
 }
 
-static PNX(plan) mkplan(
-    void
+/* Must be called whenever the number of nodes local_M changes. */
+void PNX(free_pre_psi)(
+    PNX(plan) ths
     )
 {
-  PNX(plan) ths = (plan_s*) malloc(sizeof(plan_s));
+  if(ths->pre_psi != NULL)     PNX(free)(ths->pre_psi);
+  if(ths->pre_dpsi != NULL)    PNX(free)(ths->pre_dpsi);
+  if(ths->pre_psi_il != NULL)  PNX(free)(ths->pre_psi_il);
+  if(ths->pre_dpsi_il != NULL) PNX(free)(ths->pre_dpsi_il);
+  ths->pre_psi = ths->pre_dpsi = NULL;
+  ths->pre_psi_il = ths->pre_dpsi_il = NULL;
+}
 
-  ths->f_hat  = NULL;
-  ths->f      = NULL;
-  ths->grad_f = NULL;
-  ths->x      = NULL;
-  ths->N      = NULL;
-  ths->sigma  = NULL;
-  ths->n      = NULL;
-  ths->no     = NULL;
-  ths->x_max  = NULL;
+/* Matrix B of PNFFT_SPARSE_B for the nodes of the non-interlaced (interlaced = 0) or the
+ * interlaced grid. Every row holds the cutoff^3 grid points of one node within g2 (including
+ * ghost cells) and their window values, weights below sparse_b_threshold times the largest
+ * weight of the node are dropped. The rows follow the sorted order of the nodes and are grouped
+ * into slabs of cutoff planes along the first axis, such that slabs of the same parity never
+ * touch the same grid point. Returns NULL if the matrix does not fit to the plan. */
+static PNX(sparse_b)* init_sparse_b(
+    PNX(plan) ths, int interlaced
+    )
+{
+  const int cutoff = ths->cutoff;
+  const int single = (ths->sparse_b_mode == PNFFT_SPARSE_B_SINGLE);
+  const R threshold = ths->sparse_b_threshold;
+  INT local_no[3], local_no_start[3], gcells_below[3], gcells_above[3], local_ngc[3];
+  INT *sorted_index, *slab_of_row;
+  PNX(sparse_b) *sb;
 
-  ths->local_N        = NULL;
-  ths->local_N_start  = NULL;
-  ths->local_N_total  = 0;
-  ths->local_no       = NULL;
-  ths->local_no_start = NULL;
-  ths->local_no_total = 0;
+  local_size_B(ths,
+      local_no, local_no_start);
+  get_size_gcells(ths->d, ths->m, cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
 
-  ths->b              = NULL;
-  ths->exp_const      = NULL;
-  ths->spline_coeffs  = NULL;
+  /* grid indices are stored as int */
+  if(PNX(prod_INT)(3, local_ngc) > INT_MAX)
+    return NULL;
+
+  sorted_index = get_sorted_index(ths, NULL);
+
+  sb = (PNX(sparse_b)*) PNX(malloc)(sizeof(PNX(sparse_b)));
+  sb->rows = ths->local_M;
+  sb->node  = (INT*) PNX(malloc)(sizeof(INT) * (size_t) (ths->local_M + 1));
+  sb->start = (INT*) PNX(malloc)(sizeof(INT) * (size_t) (ths->local_M + 1));
+  sb->num_slabs = (local_ngc[0] + cutoff - 1) / cutoff;
+  slab_of_row = (INT*) PNX(malloc)(sizeof(INT) * (size_t) (ths->local_M + 1));
+
+  /* the first pass counts the entries of every row, the second one fills them */
+  sb->index = NULL;
+  sb->weight = NULL;
+  sb->weight_single = NULL;
+  for(int pass=0; pass<2; pass++){
+#ifdef PNFFT_OPENMP
+    #pragma omp parallel
+#endif
+    {
+      R *pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) 3*cutoff);
+      R *spline_coeffs = ths->spline_coeffs;
 
-  ths->pre_inv_phi_hat_trafo  = NULL;
-  ths->pre_inv_phi_hat_adj    = NULL;
+#ifdef PNFFT_OPENMP
+      #pragma omp for schedule(static)
+#endif
+      for(INT p=0; p<ths->local_M; p++){
+        INT j = (sorted_index) ? sorted_index[2*p+1] : p;
+        INT u_j[3], k = (pass) ? sb->start[p] : 0;
+        R x[3], floor_nx_j[3], psi_max = 0;
+
+        project_node_to_local_grid(
+            ths, j, local_no_start, gcells_below, interlaced,
+            x, floor_nx_j, u_j);
+        pre_psi_tensor(
+            ths->n, ths->b, ths->m, cutoff, x, floor_nx_j,
+            ths->exp_const, spline_coeffs, ths->pnfft_flags,
+            ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+            pre_psi);
+
+        for(int l0=0; l0<cutoff; l0++)
+          for(int l1=0; l1<cutoff; l1++)
+            for(int l2=0; l2<cutoff; l2++){
+              R w = pnfft_fabs(pre_psi[l0] * pre_psi[cutoff+l1] * pre_psi[2*cutoff+l2]);
+              if(w > psi_max) psi_max = w;
+            }
 
-  ths->pre_psi  = NULL;
-  ths->pre_dpsi = NULL;
-  ths->pre_psi_il  = NULL;
-  ths->pre_dpsi_il = NULL;
+        for(int l0=0; l0<cutoff; l0++){
+          for(int l1=0; l1<cutoff; l1++){
+            R psi_xy = pre_psi[l0] * pre_psi[cutoff+l1];
+            INT m1 = ((u_j[0]+l0)*local_ngc[1] + u_j[1]+l1)*local_ngc[2] + u_j[2];
+            for(int l2=0; l2<cutoff; l2++){
+              R w = psi_xy * pre_psi[2*cutoff+l2];
+              if(pnfft_fabs(w) < threshold * psi_max)
+                continue;
+              if(pass){
+                sb->index[k] = (int) (m1 + l2);
+                if(single)
+                  sb->weight_single[k] = (float) w;
+                else
+                  sb->weight[k] = w;
+              }
+              k++;
+            }
+          }
+        }
 
-  ths->g1 = NULL;
-  ths->g2 = NULL;
-  ths->g1_buffer = NULL;
-  
-  ths->pfft_forw = NULL;
-  ths->pfft_back = NULL;
-  ths->gcplan = NULL;
+        if(!pass){
+          sb->node[p] = j;
+          sb->start[p+1] = k;
+          slab_of_row[p] = u_j[0] / cutoff;
+        }
+      }
 
-  ths->intpol_num_nodes = 0;
-  ths->intpol_tables_psi  = NULL;
-  ths->intpol_tables_dpsi = NULL;
+      PNX(free)(pre_psi);
+    }
 
-  ths->timer_trafo = PNX(mktimer)();
-  ths->timer_adj   = PNX(mktimer)();
+    if(!pass){
+      /* row counts to row offsets */
+      sb->start[0] = 0;
+      for(INT p=0; p<ths->local_M; p++)
+        sb->start[p+1] += sb->start[p];
+      sb->nnz = sb->start[ths->local_M];
+      sb->index = (int*) PNX(malloc)(sizeof(int) * (size_t) (sb->nnz + 1));
+      if(single)
+        sb->weight_single = (float*) PNX(malloc)(sizeof(float) * (size_t) (sb->nnz + 1));
+      else
+        sb->weight = (R*) PNX(malloc)(sizeof(R) * (size_t) (sb->nnz + 1));
+    }
+  }
 
-  return ths;
+  /* bin the rows into slabs, the sorted order is kept within each slab */
+  sb->slab_start = (INT*) PNX(malloc)(sizeof(INT) * (size_t) (sb->num_slabs + 1));
+  sb->slab_rows  = (INT*) PNX(malloc)(sizeof(INT) * (size_t) (ths->local_M + 1));
+  for(INT s=0; s<=sb->num_slabs; s++)
+    sb->slab_start[s] = 0;
+  for(INT p=0; p<ths->local_M; p++)
+    sb->slab_start[slab_of_row[p]+1]++;
+  for(INT s=0; s<sb->num_slabs; s++)
+    sb->slab_start[s+1] += sb->slab_start[s];
+  for(INT p=0; p<ths->local_M; p++)
+    sb->slab_rows[sb->slab_start[slab_of_row[p]]++] = p;
+  for(INT s=sb->num_slabs; s>0; s--)
+    sb->slab_start[s] = sb->slab_start[s-1];
+  sb->slab_start[0] = 0;
+
+  PNX(free)(slab_of_row);
+  return sb;
 }
 
+void PNX(free_sparse_b)(
+    PNX(plan) ths
+    )
+{
+  for(int k=0; k<2; k++){
+    PNX(sparse_b) *sb = ths->sparse_b[k];
+
+    if(sb == NULL)
+      continue;
+    PNX(free)(sb->node);
+    PNX(free)(sb->start);
+    PNX(free)(sb->index);
+    if(sb->weight != NULL)        PNX(free)(sb->weight);
+    if(sb->weight_single != NULL) PNX(free)(sb->weight_single);
+    PNX(free)(sb->slab_start);
+    PNX(free)(sb->slab_rows);
+    PNX(free)(sb);
+    ths->sparse_b[k] = NULL;
+  }
+}
 
-void PNX(rmplan)(
+/* Engines of PNX(set_ghost_engine) for all ghost cell plans of ths. Collective, a plan keeps
+ * the PFFT ghost cells if the ghost cells reach further than the next neighbor. */
+void PNX(init_ghost_engine)(
     PNX(plan) ths
     )
 {
-  /* plan was already destroyed or never initialized */
-  if(ths==NULL)
+  const INT cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+  const int shared = (ths->ghost_engine == PNFFT_GHOSTS_SHARED);
+  INT local_no[3], local_no_start[3], gcells_below[3], gcells_above[3];
+  int open[3];
+
+  PNX(free_ghost_engine)(ths);
+  if(ths->ghost_engine == PNFFT_GHOSTS_PFFT)
     return;
 
-  PNX(rmtimer)(ths->timer_trafo);
-  PNX(rmtimer)(ths->timer_adj);
+  local_size_B(ths,
+      local_no, local_no_start);
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
 
-  /* free memory */
-  free(ths);
-  /* ths=NULL; would be senseless, since we can not change the pointer itself */
+  for(int t=0; t<3; t++)
+    open[t] = (ths->boundary[t] == PNFFT_BOUNDARY_OPEN);
+
+  ths->ghosts = PNX(mkghosts)(local_no, gcells_below, gcells_above, cplx * ths->howmany,
+      shared, ths->ghost_float_wire, open, ths->comm_cart);
+  if(ths->ghosts == NULL){
+    PX(printf)(ths->comm_cart, "!!! Warning: ghost cells reach beyond the next process, PFFT ghost cells are used. !!!\n");
+    return;
+  }
+  if(ths->gcplan_ik != NULL)
+    ths->ghosts_ik = PNX(mkghosts)(local_no, gcells_below, gcells_above, 2 * 4,
+        shared, ths->ghost_float_wire, open, ths->comm_cart);
+  if(ths->gcplan_il != NULL)
+    ths->ghosts_il = PNX(mkghosts)(local_no, gcells_below, gcells_above, cplx * 2,
+        shared, ths->ghost_float_wire, open, ths->comm_cart);
 }
 
+void PNX(free_ghost_engine)(
+    PNX(plan) ths
+    )
+{
+  PNX(rmghosts)(ths->ghosts);
+  PNX(rmghosts)(ths->ghosts_ik);
+  PNX(rmghosts)(ths->ghosts_il);
+  ths->ghosts = ths->ghosts_ik = ths->ghosts_il = NULL;
+}
 
+/* ghost cells of g2 by the engine of PNX(set_ghost_engine), if there is one, or by PFFT.
+ * The engines skip the neighbors across the border of open axes, PFFT always wraps around,
+ * i.e., its ghost cells beyond the border are cleared after the exchange and before the reduce. */
+static void exchange_gcells(
+    PNX(plan) ths, PX(gcplan) gcplan, PNX(ghosts) ghosts
+    )
+{
+  double stats[PNFFTI_COMM_STATS] = {0, 0, 0};
 
+  if(ths->split_ghosts != NULL){
+    /* posted by PNX(trafo_B_post) */
+    PNX(gcells_wait)(ths);
+    return;
+  }
 
+  if(ghosts != NULL)
+    PNX(ghosts_exchange)(ghosts, ths->g2, stats);
+  else {
+    /* PFFT posts and waits in one call */
+    stats[PNFFTI_COMM_WAIT] = -MPI_Wtime();
+    PX(exchange)(gcplan);
+    if(has_open_axes(ths))
+      zero_open_gcells(ths, gcplan);
+    stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+    stats[PNFFTI_COMM_BYTES] = gcplan_bytes(ths, gcplan);
+  }
+  PNX(profile_comm)(ths, 0, stats);
+}
 
-void PNX(malloc_x)(
-    PNX(plan) ths, unsigned pnfft_flags
+static void reduce_gcells(
+    PNX(plan) ths, PX(gcplan) gcplan, PNX(ghosts) ghosts
     )
 {
-  if( ~pnfft_flags & PNFFT_MALLOC_X )
-    return;
-
-  ths->x = (ths->local_M>0) ? (R*) PNX(malloc)(sizeof(R) * (size_t) ths->d*ths->local_M) : NULL;
-  ths->pnfft_flags |= PNFFT_MALLOC_X;
+  double stats[PNFFTI_COMM_STATS] = {0, 0, 0};
+
+  if(ghosts != NULL)
+    PNX(ghosts_reduce)(ghosts, ths->g2, stats);
+  else {
+    stats[PNFFTI_COMM_WAIT] = -MPI_Wtime();
+    if(has_open_axes(ths))
+      zero_open_gcells(ths, gcplan);
+    PX(reduce)(gcplan);
+    stats[PNFFTI_COMM_WAIT] += MPI_Wtime();
+    stats[PNFFTI_COMM_BYTES] = gcplan_bytes(ths, gcplan);
+  }
+  PNX(profile_comm)(ths, 1, stats);
 }
 
-void PNX(free_x)(
-    PNX(plan) ths, unsigned pnfft_finalize_flags
+/* with exec_split, the reduce of the persistent engine is only posted and tested by PNX(progress) */
+static void reduce_gcells_split(
+    PNX(plan) ths, int interlaced
     )
 {
-  if( ~pnfft_finalize_flags & PNFFT_FREE_X )
+  if(!ths->exec_split || !use_split_gcells(ths, interlaced, 0)){
+    reduce_gcells(ths, ths->gcplan, ths->ghosts);
     return;
+  }
 
-  if(ths->x != NULL)
-    PNX(free)(ths->x);
-  ths->pnfft_flags &= ~PNFFT_MALLOC_X;
+  for(int k=0; k<PNFFTI_COMM_STATS; k++)
+    ths->split_stats[k] = 0;
+  PNX(ghosts_reduce_post)(ths->ghosts, ths->g2, ths->split_stats);
+  ths->split_ghosts = ths->ghosts;
+  ths->split_adj = 1;
+  ths->split_done = 0;
 }
 
-void PNX(malloc_f)(
-    PNX(plan) ths, unsigned pnfft_flags
+/* Split-phase ghost cells of PNX(progress), only the persistent engine posts its messages without
+ * waiting. PNX(trafo_B_post) posts the exchange of the next PNX(trafo_B_grad_ad), which waits for
+ * the rest, and returns 0 if B exchanges the ghost cells itself. With exec_split, PNX(adjoint_B)
+ * only posts its reduce. PNX(gcells_test) advances the posted messages and returns 1, if all of
+ * them have arrived, PNX(gcells_wait) waits for the rest and hands the grid back to the plan. */
+int PNX(trafo_B_post)(
+    PNX(plan) ths, int interlaced
     )
 {
-  if( ~pnfft_flags & PNFFT_MALLOC_F )
-    return;
-
-  ths->f = (ths->local_M>0) ? (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) ths->local_M) : NULL;
-  ths->pnfft_flags |= PNFFT_COMPUTE_F;
-  ths->compute_flags |= PNFFT_COMPUTE_F;
+  if(!use_split_gcells(ths, interlaced, 1))
+    return 0;
+
+  for(int k=0; k<PNFFTI_COMM_STATS; k++)
+    ths->split_stats[k] = 0;
+  PNX(ghosts_exchange_post)(ths->ghosts, ths->g2, ths->split_stats);
+  ths->split_ghosts = ths->ghosts;
+  ths->split_adj = 0;
+  ths->split_done = 0;
+  return 1;
 }
 
-void PNX(free_f)(
-    PNX(plan) ths, unsigned pnfft_finalize_flags
+int PNX(gcells_test)(
+    PNX(plan) ths
     )
 {
-  if( ~pnfft_finalize_flags & PNFFT_FREE_F )
-    return;
+  if(ths->split_ghosts == NULL || ths->split_done)
+    return 1;
 
-  if(ths->f != NULL)
-    PNX(free)(ths->f);
-  ths->pnfft_flags &= ~PNFFT_MALLOC_F;
-  ths->compute_flags &= ~PNFFT_COMPUTE_F;
+  if(ths->split_adj)
+    ths->split_done = PNX(ghosts_reduce_test)(ths->split_ghosts, ths->g2, 0, ths->split_stats);
+  else
+    ths->split_done = PNX(ghosts_exchange_test)(ths->split_ghosts, ths->g2, 0, ths->split_stats);
+
+  if(ths->split_done)
+    PNX(profile_comm)(ths, ths->split_adj, ths->split_stats);
+  return ths->split_done;
 }
 
-void PNX(malloc_grad_f)(
-    PNX(plan) ths, unsigned pnfft_flags
+void PNX(gcells_wait)(
+    PNX(plan) ths
     )
 {
-  if( ~pnfft_flags & PNFFT_MALLOC_GRAD_F )
+  if(ths->split_ghosts == NULL)
     return;
 
-  ths->grad_f = (ths->local_M>0) ? (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) ths->d*ths->local_M) : NULL;
-  ths->pnfft_flags |= PNFFT_MALLOC_GRAD_F;
-  ths->compute_flags |= PNFFT_COMPUTE_GRAD_F;
+  if(!ths->split_done){
+    if(ths->split_adj)
+      PNX(ghosts_reduce_test)(ths->split_ghosts, ths->g2, 1, ths->split_stats);
+    else
+      PNX(ghosts_exchange_test)(ths->split_ghosts, ths->g2, 1, ths->split_stats);
+    PNX(profile_comm)(ths, ths->split_adj, ths->split_stats);
+  }
+
+  ths->split_ghosts = NULL;
+  ths->split_done = 0;
 }
 
-void PNX(free_grad_f)(
-    PNX(plan) ths, unsigned pnfft_finalize_flags
+/* The ghost cells of the plain loops and of PNFFT_SPARSE_B can be split, the particle halo and
+ * the OpenMP overlap communicate within B. */
+static int use_split_gcells(
+    const PNX(plan) ths, int interlaced, int gather
     )
 {
-  if( ~pnfft_finalize_flags & PNFFT_FREE_GRAD_F )
-   return;
+  if(ths->ghosts == NULL || interlaced == PNFFTI_INTERLACED_BATCHED)
+    return 0;
+  /* a device backend exchanges its own ghost cells */
+  if(!PNX(host_backend)(ths, !gather))
+    return 0;
+  if(use_sparse_b(ths, interlaced, gather))
+    return 1;
+  if(use_halo(ths, interlaced, gather))
+    return 0;
+#ifdef PNFFT_OPENMP
+  if(use_gcells_overlap(ths) && !use_mixed_precision(ths, interlaced, gather))
+    return 0;
+#endif
 
-  if(ths->grad_f != NULL)
-    PNX(free)(ths->grad_f);
-  ths->pnfft_flags &= ~PNFFT_MALLOC_GRAD_F;
-  ths->compute_flags &= ~PNFFT_COMPUTE_GRAD_F;
+  return 1;
 }
 
+static int has_open_axes(
+    const PNX(plan) ths
+    )
+{
+  for(int t=0; t<ths->d; t++)
+    if(ths->boundary[t] == PNFFT_BOUNDARY_OPEN)
+      return 1;
+  return 0;
+}
 
-void PNX(trafo_F)(
-    PNX(plan) ths
+/* Clear the ghost cells of g2 that lie beyond the global border of an open axis. */
+static void zero_open_gcells(
+    PNX(plan) ths, PX(gcplan) gcplan
     )
 {
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g1, ths->local_N[0]*ths->local_N[1]*ths->local_N[2], 1,
-      "PNFFT: Sum of Fourier coefficients before FFT");
-#endif
+  const INT unit = gcplan_unit(ths, gcplan);
+  INT local_no[3], local_no_start[3], gcells_below[3], gcells_above[3], local_ngc[3];
+  INT lo[3], hi[3];
 
-  PX(execute)(ths->pfft_forw);
+  local_size_B(ths,
+      local_no, local_no_start);
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
+
+  for(int t=0; t<ths->d; t++){
+    if(ths->boundary[t] != PNFFT_BOUNDARY_OPEN)
+      continue;
+
+    /* planes below index 0 and above index n-1 along axis t */
+    for(int side=0; side<2; side++){
+      for(int s=0; s<3; s++){
+        lo[s] = 0; hi[s] = local_ngc[s];
+      }
+      if(side == 0){
+        if(local_no_start[t] != 0)
+          continue;
+        hi[t] = gcells_below[t];
+      } else {
+        if(local_no_start[t] + local_no[t] != ths->n[t])
+          continue;
+        lo[t] = gcells_below[t] + local_no[t];
+      }
+      if(lo[t] >= hi[t])
+        continue;
+
+      for(INT k0=lo[0]; k0<hi[0]; k0++)
+        for(INT k1=lo[1]; k1<hi[1]; k1++)
+          memset(ths->g2 + ((k0*local_ngc[1] + k1)*local_ngc[2] + lo[2]) * unit, 0,
+              sizeof(R) * (size_t) ((hi[2]-lo[2]) * unit));
+    }
+  }
 }
 
-void PNX(adjoint_F)(
-    PNX(plan) ths
+/* Number of reals per grid point of the ghost cells of gcplan. */
+static INT gcplan_unit(
+    const PNX(plan) ths, PX(gcplan) gcplan
     )
 {
-  PX(execute)(ths->pfft_back);
+  const INT cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g1, ths->local_N[0]*ths->local_N[1]*ths->local_N[2], 1,
-      "PNFFT^H: Sum of Fourier coefficients after FFT");
-#endif
+  if(gcplan == ths->gcplan_ik)
+    return 2 * 4;
+  if(gcplan == ths->gcplan_il)
+    return cplx * 2;
+  return cplx * ths->howmany;
 }
 
-
-/* Implement ghostcell send for all dimensions */
-static void get_size_gcells(
-    int m, int cutoff, unsigned pnfft_flags,
-    INT *gcells_below, INT *gcells_above
+/* PFFT does not tell the sent bytes, count the ghost cells along the distributed axes,
+ * these are the ones that PFFT gets from other processes. */
+static double gcplan_bytes(
+    PNX(plan) ths, PX(gcplan) gcplan
     )
 {
+  int dims[3], periods[3], coords[3], ndims;
+  INT local_no[3], local_no_start[3], gcells_below[3], gcells_above[3];
+  double size = 1, size_local = 1;
+
+  MPI_Cartdim_get(ths->comm_cart, &ndims);
+  for(int t=0; t<3; t++)
+    dims[t] = 1;
+  MPI_Cart_get(ths->comm_cart, ndims, dims, periods, coords);
+
+  local_size_B(ths,
+      local_no, local_no_start);
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+
   for(int t=0; t<3; t++){
-    gcells_below[t] = m;
-    gcells_above[t] = cutoff - gcells_below[t] - 1;
-    if(pnfft_flags & PNFFT_INTERLACED)
-      gcells_above[t] += 1;
+    size_local *= (double) local_no[t];
+    size *= (double) local_no[t] + ((t < ndims && dims[t] > 1) ? gcells_below[t] + gcells_above[t] : 0);
   }
+
+  return (size - size_local) * (double) gcplan_unit(ths, gcplan) * sizeof(R);
 }
 
-static void lowest_summation_index(
-    const INT *n, int m, const R *x,
-    const INT *local_no_start, const INT *gcells_below,
-    R *floor_nx_j, INT *u_j
+/* The particle halo replaces the ghost cells of the plain loops over the nodes. */
+static int use_halo(
+    const PNX(plan) ths, int interlaced, int gather
     )
 {
-  project_node_to_grid(n, m, x, floor_nx_j, u_j);
-  for(int t=0; t<3; t++)
-    u_j[t] = u_j[t] - local_no_start[t] + gcells_below[t];
+  if(ths->halo == NULL || interlaced == PNFFTI_INTERLACED_BATCHED)
+    return 0;
+  if(use_mixed_precision(ths, interlaced, gather))
+    return 0;
+  if(gather && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F) && !PNX(halo_has_grad_f)(ths->halo))
+    return 0;
+  if(gather && (ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F))
+    return 0;
+
+  return 1;
 }
 
-
-static void local_array_size(
-    const INT *local_n, const INT *gcells_below, const INT *gcells_above,
-    INT *local_ngc
+/* Gather the own nodes and the received copies from the local block padded by zeros,
+ * then add the partial results of the copies to their nodes. */
+static void halo_trafo(
+    PNX(plan) ths, INT *local_no_start, int interlaced, INT *sorted_index
     )
 {
-  for(int t=0; t<3; t++)
-    local_ngc[t] = local_n[t] + gcells_below[t] + gcells_above[t];
-}
+  PNX(halo) halo = ths->halo;
+  INT pad[3], local_ngc[3];
+  R *g2 = ths->g2, *grid;
+  double stats[PNFFTI_COMM_STATS] = {0, 0, 0};
 
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+  grid = (R*) PNX(scratch_malloc)(ths, sizeof(R) * (size_t) PNX(halo_grid_size)(halo, pad, local_ngc));
+  PNX(halo_expand)(halo, g2, grid);
 
+  /* the loops work on ths->g2 */
+  ths->g2 = grid;
+  loop_over_particles_trafo(
+      ths, local_no_start, local_ngc, pad, interlaced, sorted_index);
+  PNX(halo_attach)(halo, ths);
+  loop_over_particles_trafo(
+      ths, local_no_start, local_ngc, pad, interlaced, get_sorted_index(ths, ths->timer_trafo));
+  PNX(halo_detach)(halo, ths);
+  ths->g2 = g2;
 
-static void pre_tensor_intpol(
-    const INT *n, int cutoff, const R *x, const R *floor_nx,
-    int intpol_order, INT intpol_num_nodes, R **intpol_tables_psi,
-    R *pre_psi
-    )
-{
-  const int d=3;
+  PNX(scratch_free)(ths, grid);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
 
-  for(int t=0; t<d; t++){
-    R dist = n[t]*x[t] - floor_nx[t] ; /* 0<= dist < 1 */
-    INT k = (INT) pnfft_floor(dist*intpol_num_nodes);
-    R dist_k = dist*intpol_num_nodes - (R)k; /* 0 <= dist_k < 1 */
-    k *= cutoff * (intpol_order+1);
-    switch(intpol_order){
-      case 0 :
-        for(int s=0; s<cutoff; s++, k++)
-          pre_psi[cutoff*t+s] = pnfft_intpol_const(k, intpol_tables_psi[t]);
-        break;
-      case 1 :
-        for(int s=0; s<cutoff; s++, k+=2)
-          pre_psi[cutoff*t+s] = pnfft_intpol_lin(k, dist_k, intpol_tables_psi[t]);
-        break;
-      case 2 :
-        for(int s=0; s<cutoff; s++, k+=3)
-          pre_psi[cutoff*t+s] = pnfft_intpol_quad(k, dist_k, intpol_tables_psi[t]);
-        break;
-      default:
-        for(int s=0; s<cutoff; s++, k+=4)
-          pre_psi[cutoff*t+s] = pnfft_intpol_kub(k, dist_k, intpol_tables_psi[t]);
-    }
-  }
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+  PNX(halo_gather_f)(halo, ths, stats);
+  PNX(profile_comm)(ths, 0, stats);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
 }
 
-
-/* switch between direct evaluation and interpolation */
-static void pre_psi_tensor(
-    const INT *n, const R *b, int m, int cutoff, const R *x, const R *floor_nx,
-    const R *exp_const, R *spline_coeffs, unsigned pnfft_flags,
-    int intpol_order, INT intpol_num_nodes, R **intpol_tables_psi,
-    R *pre_psi
+/* Spread the own nodes and the received copies onto the local block padded by zeros,
+ * the padding holds the parts of the neighbors and is dropped. */
+static void halo_adj(
+    PNX(plan) ths, INT *local_no_start, int interlaced, INT *sorted_index
     )
 {
-  if(pnfft_flags & PNFFT_PRE_INTPOL_PSI)
-    pre_tensor_intpol(
-        n, cutoff, x, floor_nx,
-        intpol_order, intpol_num_nodes, intpol_tables_psi,
-        pre_psi);
-  else
-    pre_psi_tensor_direct(
-        n, b, m, cutoff, x, floor_nx,
-        exp_const, spline_coeffs, pnfft_flags,
-        pre_psi);
-}
+  PNX(halo) halo = ths->halo;
+  INT pad[3], local_ngc[3], size;
+  R *g2 = ths->g2, *grid;
+  double stats[PNFFTI_COMM_STATS] = {0, 0, 0};
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+  PNX(halo_scatter_f)(halo, ths, stats);
+  PNX(profile_comm)(ths, 1, stats);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+  size = PNX(halo_grid_size)(halo, pad, local_ngc);
+  grid = (R*) PNX(scratch_malloc)(ths, sizeof(R) * (size_t) size);
+  memset(grid, 0, sizeof(R) * (size_t) size);
+
+  ths->g2 = grid;
+  loop_over_particles_adj(
+      ths, local_no_start, local_ngc, pad, interlaced, sorted_index);
+  PNX(halo_attach)(halo, ths);
+  loop_over_particles_adj(
+      ths, local_no_start, local_ngc, pad, interlaced, get_sorted_index(ths, ths->timer_adj));
+  PNX(halo_detach)(halo, ths);
+  ths->g2 = g2;
 
+  PNX(halo_shrink)(halo, grid, g2);
+  PNX(scratch_free)(ths, grid);
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+}
 
-/* calculate window function */
-static void pre_psi_tensor_direct(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx,
-    const R *exp_const, R *spline_coeffs,
-    unsigned pnfft_flags,
-    R *pre_psi
+/* The sparse matrix only covers f of single field plans, everything else runs the usual loops. */
+static int use_sparse_b(
+    const PNX(plan) ths, int interlaced, int gather
     )
 {
-  if(pnfft_flags & PNFFT_WINDOW_GAUSSIAN){
-    if(pnfft_flags & PNFFT_FG_PSI)
-      pre_psi_tensor_fast_gaussian(
-          n, b, m, cutoff, x, floor_nx, exp_const,
-          pre_psi);
-    else
-      pre_psi_tensor_gaussian(
-          n, b, m, cutoff, x, floor_nx,
-          pre_psi);
-  } 
-  else if(pnfft_flags & PNFFT_WINDOW_BSPLINE)
-    pre_psi_tensor_bspline(
-        n, m, cutoff, x, floor_nx, spline_coeffs,
-        pre_psi);
-  else if(pnfft_flags & PNFFT_WINDOW_SINC_POWER)
-    pre_psi_tensor_sinc_power(
-        n, b, m, cutoff, x, floor_nx,
-        pre_psi);
-  else if(pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
-    pre_psi_tensor_bessel_i0(
-        n, b, m, cutoff, x, floor_nx,
-        pre_psi);
-  else
-    pre_psi_tensor_kaiser_bessel(
-        n, b, m, cutoff, x, floor_nx,
-        pre_psi);
+  if(interlaced == PNFFTI_INTERLACED_BATCHED || ths->sparse_b[interlaced] == NULL)
+    return 0;
+  if(ths->howmany > 1 || (ths->pnfft_flags & PNFFT_MIXED_PRECISION))
+    return 0;
+  if(ths->sparse_b[interlaced]->rows != ths->local_M)
+    return 0;
+  if(gather && (ths->compute_flags & (PNFFT_COMPUTE_GRAD_F | PNFFT_COMPUTE_HESSIAN_F)))
+    return 0;
+
+  return 1;
 }
 
-static void pre_psi_tensor_gaussian(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx,
-    R *pre_psi
+/* f = B g2 as a sparse matrix vector product, the rows are independent */
+static void sparse_b_trafo(
+    PNX(plan) ths, int interlaced
     )
 {
-  const int d=3;
-  R u_j;
+  const PNX(sparse_b) *sb = ths->sparse_b[interlaced];
+  const int real = (ths->trafo_flag & PNFFTI_TRAFO_C2R) != 0;
 
-  for(int t=0; t<d; t++){
-    u_j = floor_nx[t] - n[t]*x[t] - m;
-    for(int s=0; s<cutoff; s++)
-      pre_psi[cutoff*t+s] = pnfft_exp(-PNFFT_SQR(u_j + s) / b[t]) / pnfft_sqrt(PNFFT_PI*b[t]);
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(INT p=0; p<sb->rows; p++){
+    INT j = sb->node[p];
+    if(real){
+      R f = 0;
+      if(sb->weight != NULL)
+        for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+          f += sb->weight[k] * ths->g2[sb->index[k]];
+      else
+        for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+          f += sb->weight_single[k] * ths->g2[sb->index[k]];
+      ths->f[j] = f;
+    } else {
+      const C *g2 = (const C*) ths->g2;
+      C f = 0;
+      if(sb->weight != NULL)
+        for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+          f += sb->weight[k] * g2[sb->index[k]];
+      else
+        for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+          f += sb->weight_single[k] * g2[sb->index[k]];
+      ((C*)ths->f)[j] = f;
+    }
   }
 }
 
-static void pre_psi_tensor_fast_gaussian(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx, const R *exp_const,
-    R *fg_psi
+/* g2 += B^T f, the threads share the slabs of one parity at a time */
+static void sparse_b_adj(
+    PNX(plan) ths, int interlaced
     )
 {
-  const int d=3;
-  R u_j, exp_sqr, exp_lin, tmp;
-
-  for(int t=0; t<d; t++){
-    u_j = floor_nx[t] - m;
-    exp_sqr = pnfft_exp( -PNFFT_SQR( n[t]*x[t]-u_j ) / b[t] );
-    exp_lin = pnfft_exp( 2*( n[t]*x[t]-u_j ) / b[t] );
+  const PNX(sparse_b) *sb = ths->sparse_b[interlaced];
+  const int real = (ths->trafo_flag & PNFFTI_TRAFO_C2R) != 0;
 
-    tmp = exp_sqr;
-    for(int s=0; s<cutoff; s++){
-      fg_psi[cutoff*t+s] = tmp * exp_const[cutoff*t+s];
-      tmp *= exp_lin;
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel
+#endif
+  for(int color=0; color<2; color++){
+#ifdef PNFFT_OPENMP
+    #pragma omp for schedule(dynamic)
+#endif
+    for(INT s=color; s<sb->num_slabs; s+=2){
+      for(INT q=sb->slab_start[s]; q<sb->slab_start[s+1]; q++){
+        INT p = sb->slab_rows[q], j = sb->node[p];
+        if(real){
+          R f = ths->f[j];
+          if(sb->weight != NULL)
+            for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+              ths->g2[sb->index[k]] += sb->weight[k] * f;
+          else
+            for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+              ths->g2[sb->index[k]] += sb->weight_single[k] * f;
+        } else {
+          C *g2 = (C*) ths->g2, f = ((C*)ths->f)[j];
+          if(sb->weight != NULL)
+            for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+              g2[sb->index[k]] += sb->weight[k] * f;
+          else
+            for(INT k=sb->start[p]; k<sb->start[p+1]; k++)
+              g2[sb->index[k]] += sb->weight_single[k] * f;
+        }
+      }
     }
   }
 }
 
-static void pre_psi_tensor_bspline(
-    const INT *n, int m, int cutoff,
-    const R *x, const R *floor_nx, R *spline_coeffs, 
-    R *pre_psi
+static void precompute_psi(
+    PNX(plan) ths, INT ind, R* x, R* buffer_psi, R* buffer_dpsi,
+    int compute_grad_ad, R* spline_coeffs,
+    R* pre_psi, R* pre_dpsi
     )
 {
-  const int d=3;
+  int cutoff = ths->cutoff;
+  R floor_nx[3];
+  for(int t=0; t<3; t++)
+    floor_nx[t] = pnfft_floor(ths->n[t]*x[t]);
 
-  if(m<9){
-    for(int t=0; t<d; t++){
-      /* Bspline is shifted by m */
-      R dist = floor_nx[t]  - n[t]*x[t] + 0.5; 
-      for(int s=0; s<cutoff; s++)
-        pre_psi[cutoff*t+s] = PNX(fast_bspline)(
-            s-1, dist, 2*m);
+  if(ths->pnfft_flags & PNFFT_PRE_PSI){
+    /* float tables of PNX(set_pre_psi_single) are filled from the buffers */
+    const int single = PNFFT_PRE_PSI_SINGLE(ths);
+    R *psi = (single) ? buffer_psi : pre_psi + ind * 3 * cutoff;
+    R *dpsi = (single || !compute_grad_ad) ? buffer_dpsi : pre_dpsi + ind * 3 * cutoff;
+
+    if(compute_grad_ad)
+      pre_psi_dpsi_tensor(
+          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx,
+          ths->exp_const, spline_coeffs, ths->pnfft_flags,
+          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi, ths->intpol_tables_dpsi,
+          psi, dpsi);
+    else
+      pre_psi_tensor(
+          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx,
+          ths->exp_const, spline_coeffs, ths->pnfft_flags,
+          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+          psi);
+
+    if(single){
+      float *psi_single = (float*) pre_psi + ind * 3 * cutoff;
+      for(int l=0; l<3*cutoff; l++)
+        psi_single[l] = (float) psi[l];
+      if(compute_grad_ad){
+        float *dpsi_single = (float*) pre_dpsi + ind * 3 * cutoff;
+        for(int l=0; l<3*cutoff; l++)
+          dpsi_single[l] = (float) dpsi[l];
+      }
     }
-    return;
   }
+  else if(ths->pnfft_flags & PNFFT_PRE_FULL_PSI){
+    /* shift index to current particle */
+    pre_psi += ind * PNFFT_POW3(cutoff);
+    if(compute_grad_ad)
+      pre_dpsi += 3 * ind * PNFFT_POW3(cutoff);
 
-  for(int t=0; t<d; t++){
-    /* Bspline is shifted by m */
-    R u_j = floor_nx[t] - n[t]*x[t]; 
-    for(int s=0; s<cutoff; s++)
-      pre_psi[cutoff*t+s] = PNX(bspline)(
-          2*m, u_j + (R)s, spline_coeffs);
+    if(compute_grad_ad)
+      pre_psi_dpsi_tensor(
+          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx,
+          ths->exp_const, spline_coeffs, ths->pnfft_flags,
+          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi, ths->intpol_tables_dpsi,
+          buffer_psi, buffer_dpsi);
+    else
+      pre_psi_tensor(
+          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx,
+          ths->exp_const, spline_coeffs, ths->pnfft_flags,
+          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+          buffer_psi);
+
+    if(compute_grad_ad){
+      INT m=0;
+      INT md=0;
+      for(INT l0=0; l0<cutoff; l0++){
+        for(INT l1=cutoff; l1<2*cutoff; l1++){
+          R psi_xy  = buffer_psi[l0]   * buffer_psi[l1];
+          R psi_dxy = buffer_dpsi[l0]  * buffer_psi[l1];
+          R psi_xdy = buffer_psi[l0]   * buffer_dpsi[l1];
+          for(INT l2=2*cutoff; l2<3*cutoff; l2++, md+=3){
+            pre_psi[m++]   = psi_xy  * buffer_psi[l2];
+            pre_dpsi[md+0] = psi_dxy * buffer_psi[l2];
+            pre_dpsi[md+1] = psi_xdy * buffer_psi[l2];
+            pre_dpsi[md+2] = psi_xy  * buffer_dpsi[l2];
+          }
+        }
+      }
+    } else {
+      INT m=0;
+      for(INT l0=0; l0<cutoff; l0++)
+        for(INT l1=cutoff; l1<2*cutoff; l1++)
+          for(INT l2=2*cutoff; l2<3*cutoff; l2++)
+            pre_psi[m++] = buffer_psi[l0] * buffer_psi[l1] * buffer_psi[l2];
+    }
   }
 }
 
-/* The factor n of the window cancels with the factor 1/n from matrix D. */
-static void pre_psi_tensor_sinc_power(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx,
-    R *pre_psi
+static PNX(plan) mkplan(
+    void
     )
 {
-  const int d=3;
-  R u_j;
-
-  for(int t=0; t<d; t++){
-    u_j = floor_nx[t] - n[t]*x[t] - m; 
-    for(int s=0; s<cutoff; s++)
-      pre_psi[cutoff*t+s] =
-        pnfft_pow(
-            PNX(sinc)( PNFFT_PI * (u_j + s) / b[t]),
-            K(2.0)*(R)m
-        ) / b[t];
-  }
-}
+  PNX(plan) ths = (plan_s*) malloc(sizeof(plan_s));
 
-static void pre_psi_tensor_bessel_i0(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx,
-    R *pre_psi
+  ths->f_hat  = NULL;
+  ths->f      = NULL;
+  ths->grad_f = NULL;
+  ths->hessian_f = NULL;
+  ths->x      = NULL;
+  ths->N      = NULL;
+  ths->sigma  = NULL;
+  ths->n      = NULL;
+  ths->no     = NULL;
+  ths->x_max  = NULL;
+
+  ths->local_N        = NULL;
+  ths->local_N_start  = NULL;
+  ths->local_N_total  = 0;
+  ths->local_no       = NULL;
+  ths->local_no_start = NULL;
+  ths->local_no_total = 0;
+  ths->howmany        = 1;
+
+  ths->b              = NULL;
+  ths->exp_const      = NULL;
+  ths->spline_coeffs  = NULL;
+  ths->phi_hat_es     = NULL;
+
+  ths->pre_inv_phi_hat_trafo  = NULL;
+  ths->pre_inv_phi_hat_adj    = NULL;
+  ths->pre_inv_phi_hat_trafo_il = NULL;
+  ths->pre_inv_phi_hat_adj_il   = NULL;
+
+  ths->pre_psi  = NULL;
+  ths->pre_dpsi = NULL;
+  ths->pre_psi_il  = NULL;
+  ths->pre_dpsi_il = NULL;
+  ths->pre_psi_block_bytes = 0;
+  ths->shared_psi_bytes = -1;
+  ths->shared_psi = NULL;
+  ths->spread_tile = 0;
+  ths->sort_keys = PNFFT_SORT_KEYS_PLAIN;
+  ths->prune_stencil = 0;
+  ths->pre_psi_single = 0;
+  ths->sparse_b_mode = PNFFT_SPARSE_B_OFF;
+  ths->sparse_b_threshold = 0;
+  ths->sparse_b[0] = ths->sparse_b[1] = NULL;
+
+  ths->g1 = NULL;
+  ths->g2 = NULL;
+  ths->g1_buffer = NULL;
+  ths->g2_single = NULL;
+  for(int k=0; k<PNFFTI_GRIDS; k++){
+    ths->grid_bytes[k] = 0;
+    ths->grid_alloc[k] = 0;
+  }
+  ths->arena = NULL;
+  ths->shared_grids = 0;
+  ths->alloc_flags = PNFFT_ALLOC_DEFAULT;
+
+  ths->sorted_index = NULL;
+  ths->sorted_index_valid = 0;
+  ths->nodes_in_order = 0;
+  ths->node_order = NULL;
+
+  ths->redist_M = 0;
+  ths->redist_perm = NULL;
+  ths->redist_sendcounts = NULL;
+  ths->redist_senddispls = NULL;
+  ths->redist_recvcounts = NULL;
+  ths->redist_recvdispls = NULL;
+  
+  ths->pfft_forw = NULL;
+  ths->pfft_back = NULL;
+  ths->gcplan = NULL;
+  ths->pfft_forw_ik = NULL;
+  ths->gcplan_ik = NULL;
+  ths->pfft_forw_il = NULL;
+  ths->pfft_back_il = NULL;
+  ths->gcplan_il = NULL;
+  ths->ghost_engine = PNFFT_GHOSTS_PFFT;
+  ths->ghost_float_wire = 0;
+  ths->ghosts = ths->ghosts_ik = ths->ghosts_il = NULL;
+  ths->pipe = NULL;
+  ths->halo_mode = PNFFT_HALO_OFF;
+  ths->halo = NULL;
+  for(int t=0; t<3; t++)
+    ths->boundary[t] = PNFFT_BOUNDARY_PERIODIC;
+  ths->progress_mode = PNFFT_PROGRESS_CALLS;
+  ths->exec_kind = PNFFTI_EXEC_NONE;
+  ths->exec_step = 0;
+  ths->exec_buffer = NULL;
+  ths->exec_thread = NULL;
+  ths->exec_split = 0;
+  ths->split_ghosts = NULL;
+  ths->split_done = 0;
+  ths->buffer_il = NULL;
+  ths->buffer_il_size = 0;
+
+  ths->intpol_num_nodes = 0;
+  ths->intpol_tables_psi  = NULL;
+  ths->intpol_tables_dpsi = NULL;
+
+  ths->timer_trafo = PNX(mktimer)();
+  ths->timer_adj   = PNX(mktimer)();
+  ths->profile     = PNX(mkprofile)();
+  ths->profile_hook = NULL;
+  ths->profile_hook_data = NULL;
+  ths->profile_detail = 0;
+  PNX(init_backend)(ths);
+
+  return ths;
+}
+
+
+void PNX(rmplan)(
+    PNX(plan) ths
     )
 {
-  const int d=3;
-  R u_j;
+  /* plan was already destroyed or never initialized */
+  if(ths==NULL)
+    return;
 
-  for(int t=0; t<d; t++){
-    u_j = floor_nx[t] - n[t]*x[t] - m;
-    for(int s=0; s<cutoff; s++)
-      pre_psi[cutoff*t+s] = window_bessel_i0_1d(
-          (u_j + s) / n[t], n[t], b[t], m);
-  }
+  PNX(rmtimer)(ths->timer_trafo);
+  PNX(rmtimer)(ths->timer_adj);
+  PNX(rmprofile)(ths->profile);
+
+  /* free memory */
+  free(ths);
+  /* ths=NULL; would be senseless, since we can not change the pointer itself */
 }
 
-static void pre_psi_tensor_kaiser_bessel(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx,
-    R *pre_psi
+
+
+
+
+void PNX(malloc_x)(
+    PNX(plan) ths, unsigned pnfft_flags
     )
 {
-  const int d=3;
-  R u_j;
+  if( ~pnfft_flags & PNFFT_MALLOC_X )
+    return;
 
-  for(int t=0; t<d; t++){
-    u_j = floor_nx[t] - n[t]*x[t] - m;
-    for(int s=0; s<cutoff; s++)
-      pre_psi[cutoff*t+s] = kaiser_bessel_1d(
-          (u_j + s) / n[t], n[t], b[t], m);
-  }
+  ths->x = (ths->local_M_capacity>0) ? (R*) PNX(malloc)(sizeof(R) * (size_t) ths->d*ths->local_M_capacity) : NULL;
+  ths->pnfft_flags |= PNFFT_MALLOC_X;
 }
 
-/* switch between direct evaluation and interpolation */
-static void pre_dpsi_tensor(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx, R *spline_coeffs,
-    int intpol_order, INT intpol_num_nodes, R **intpol_tables_dpsi,
-    const R *pre_psi, unsigned pnfft_flags,
-    R *pre_dpsi
+void PNX(free_x)(
+    PNX(plan) ths, unsigned pnfft_finalize_flags
     )
 {
-  if(pnfft_flags & PNFFT_PRE_INTPOL_PSI)
-    pre_tensor_intpol(
-        n, cutoff, x, floor_nx,
-        intpol_order, intpol_num_nodes, intpol_tables_dpsi,
-        pre_dpsi);
-  else
-    pre_dpsi_tensor_direct(
-        n, b, m, cutoff, x, floor_nx, spline_coeffs,
-        pre_psi, pnfft_flags,
-        pre_dpsi);
+  if( ~pnfft_finalize_flags & PNFFT_FREE_X )
+    return;
+
+  if(ths->x != NULL)
+    PNX(free)(ths->x);
+  ths->pnfft_flags &= ~PNFFT_MALLOC_X;
 }
 
-/* calculate window derivative */
-static void pre_dpsi_tensor_direct(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx, R *spline_coeffs, const R *pre_psi,
-    unsigned pnfft_flags,
-    R *pre_dpsi
+void PNX(malloc_f)(
+    PNX(plan) ths, unsigned pnfft_flags
     )
 {
-  if(pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
-    pre_dpsi_tensor_gaussian(
-        n, b, m, cutoff, x, floor_nx, pre_psi,
-        pre_dpsi);
-  else if(pnfft_flags & PNFFT_WINDOW_BSPLINE)
-    pre_dpsi_tensor_bspline(
-        n, m, cutoff, x, floor_nx, spline_coeffs,
-        pre_dpsi);
-  else if(pnfft_flags & PNFFT_WINDOW_SINC_POWER)
-    pre_dpsi_tensor_sinc_power(
-        n, b, m, cutoff, x, floor_nx, pre_psi,
-        pre_dpsi);
-  else if(pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
-    pre_dpsi_tensor_bessel_i0(
-        n, b, m, cutoff, x, floor_nx,
-        pre_dpsi);
-  else
-    pre_dpsi_tensor_kaiser_bessel(
-        n, b, m, cutoff, x, floor_nx, pre_psi,
-        pre_dpsi);
+  if( ~pnfft_flags & PNFFT_MALLOC_F )
+    return;
+
+  ths->f = (ths->local_M_capacity>0) ? (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) (ths->howmany*ths->local_M_capacity)) : NULL;
+  ths->pnfft_flags |= PNFFT_COMPUTE_F;
+  ths->compute_flags |= PNFFT_COMPUTE_F;
 }
 
-static void pre_dpsi_tensor_gaussian(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx, const R *fg_psi,
-    R *fg_dpsi
+void PNX(free_f)(
+    PNX(plan) ths, unsigned pnfft_finalize_flags
     )
 {
-  const int d=3;
-  R u_j;
+  if( ~pnfft_finalize_flags & PNFFT_FREE_F )
+    return;
 
-  for(int t=0; t<d; t++){
-    u_j = n[t]*x[t] - floor_nx[t] + m;
-    for(int s=0; s<cutoff; s++)
-      fg_dpsi[cutoff*t+s] = -2.0*n[t]/b[t] * (u_j-s) * fg_psi[cutoff*t+s];
-  }
+  if(ths->f != NULL)
+    PNX(free)(ths->f);
+  ths->pnfft_flags &= ~PNFFT_MALLOC_F;
+  ths->compute_flags &= ~PNFFT_COMPUTE_F;
 }
 
-static void pre_dpsi_tensor_bspline(
-    const INT *n, int m, int cutoff,
-    const R *x, const R *floor_nx, R *spline_coeffs,
-    R *pre_dpsi
+void PNX(malloc_grad_f)(
+    PNX(plan) ths, unsigned pnfft_flags
     )
 {
-  const int d=3;
+  if( ~pnfft_flags & PNFFT_MALLOC_GRAD_F )
+    return;
 
-  if(m<9){
-    for(int t=0; t<d; t++){
-      /* Bspline is shifted by m */
-      R dist = floor_nx[t] - n[t]*x[t] + 0.5;
-      for(int s=0; s<cutoff; s++)
-        pre_dpsi[cutoff*t+s] = -(R)n[t] * PNX(fast_bspline_d)(
-            s-1, dist, 2*m);
-    }
+  ths->grad_f = (ths->local_M_capacity>0) ? (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) ths->d*ths->local_M_capacity) : NULL;
+  ths->pnfft_flags |= PNFFT_MALLOC_GRAD_F;
+  ths->compute_flags |= PNFFT_COMPUTE_GRAD_F;
+}
+
+void PNX(free_grad_f)(
+    PNX(plan) ths, unsigned pnfft_finalize_flags
+    )
+{
+  if( ~pnfft_finalize_flags & PNFFT_FREE_GRAD_F )
+   return;
+
+  if(ths->grad_f != NULL)
+    PNX(free)(ths->grad_f);
+  ths->pnfft_flags &= ~PNFFT_MALLOC_GRAD_F;
+  ths->compute_flags &= ~PNFFT_COMPUTE_GRAD_F;
+}
+
+void PNX(malloc_hessian_f)(
+    PNX(plan) ths, unsigned pnfft_flags
+    )
+{
+  if( ~pnfft_flags & PNFFT_MALLOC_HESSIAN_F )
     return;
-  }
 
-  for(int t=0; t<d; t++){
-    /* Bspline is shifted by m */
-    R u_j = floor_nx[t] - n[t]*x[t];
-    for(int s=0; s<cutoff; s++)
-      pre_dpsi[cutoff*t+s] = (R)n[t] *
-        ( PNX(bspline)(2*m-1, u_j + (R)s - 1, spline_coeffs)
-          - PNX(bspline)(2*m-1, u_j + (R)s, spline_coeffs) );
-  }
+  ths->hessian_f = (ths->local_M_capacity>0) ? (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) 6*ths->local_M_capacity) : NULL;
+  ths->pnfft_flags |= PNFFT_MALLOC_HESSIAN_F;
+  ths->compute_flags |= PNFFT_COMPUTE_HESSIAN_F;
 }
 
+void PNX(free_hessian_f)(
+    PNX(plan) ths, unsigned pnfft_finalize_flags
+    )
+{
+  if( ~pnfft_finalize_flags & PNFFT_FREE_HESSIAN_F )
+   return;
 
-/* The factor n of the window cancels with the factor 1/n from matrix D. */
-static void pre_dpsi_tensor_sinc_power(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx, const R *pre_psi,
-    R *pre_dpsi
+  if(ths->hessian_f != NULL)
+    PNX(free)(ths->hessian_f);
+  ths->hessian_f = NULL;
+  ths->pnfft_flags &= ~PNFFT_MALLOC_HESSIAN_F;
+  ths->compute_flags &= ~PNFFT_COMPUTE_HESSIAN_F;
+}
+
+
+/* Forward and backward FFT and the ghost cells of the grids g1 and g2 of plan 'ths',
+ * i.e., the plans of one buffer set with howmany fields. The FFT of a direction that
+ * the plan does not support is NULL. */
+void PNX(plan_grid_fft)(
+    const PNX(plan) ths, R *g1, R *g2, MPI_Comm comm_cart,
+    PX(plan) *forw, PX(plan) *back, PX(gcplan) *gcplan
     )
 {
-  const int d=3;
-  R u_j, y;
+  unsigned pfft_flags;
+  INT gcells_below[3], gcells_above[3];
 
-  for(int t=0; t<d; t++){
-    u_j =  floor_nx[t] - n[t]*x[t] - m;
-    for(int s=0; s<cutoff; s++){
-      y =  PNFFT_PI * (u_j + s) / b[t];
-      if(pnfft_fabs(y) > PNFFT_EPSILON)
-        pre_dpsi[cutoff*t+s] =
-          2.0 * (R)m * PNFFT_PI * (R)n[t] / b[t] * ( 1.0/y - 1.0/pnfft_tan(y) ) * pre_psi[cutoff*t+s];
-      else
-        pre_dpsi[cutoff*t+s] = K(0.0);
-    }
+  pfft_flags = ths->pfft_opt_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT;
+  if(ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT)
+    pfft_flags |= PFFT_TRANSPOSED_IN;
+  if(ths->direction == PNFFT_ADJ_ONLY)
+    *forw = NULL;
+  else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+    *forw = PX(plan_many_dft_c2r)(ths->d, ths->n, ths->N, ths->no, ths->howmany,
+        PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) g1, g2, comm_cart,
+        PFFT_FORWARD, pfft_flags);
+  else
+    *forw = PX(plan_many_dft)(ths->d, ths->n, ths->N, ths->no, ths->howmany,
+        PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) g1, (C*) g2, comm_cart,
+        PFFT_FORWARD, pfft_flags);
+
+  pfft_flags = ths->pfft_opt_flags | PFFT_SHIFTED_IN | PFFT_SHIFTED_OUT;
+  if(ths->pnfft_flags & PNFFT_TRANSPOSED_F_HAT)
+    pfft_flags |= PFFT_TRANSPOSED_OUT;
+  if(ths->direction == PNFFT_TRAFO_ONLY)
+    *back = NULL;
+  else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+    *back = PX(plan_many_dft_r2c)(ths->d, ths->n, ths->no, ths->N, ths->howmany,
+        PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, g2, (C*) g1, comm_cart,
+        PFFT_BACKWARD, pfft_flags);
+  else
+    *back = PX(plan_many_dft)(ths->d, ths->n, ths->no, ths->N, ths->howmany,
+        PFFT_DEFAULT_BLOCKS, PFFT_DEFAULT_BLOCKS, (C*) g2, (C*) g1, comm_cart,
+        PFFT_BACKWARD, pfft_flags);
+
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+    *gcplan = PX(plan_many_rgc)(ths->d, ths->no, ths->howmany, PFFT_DEFAULT_BLOCKS,
+        gcells_below, gcells_above, g2, comm_cart, 0);
+  else
+    *gcplan = PX(plan_many_cgc)(ths->d, ths->no, ths->howmany, PFFT_DEFAULT_BLOCKS,
+        gcells_below, gcells_above, (C*) g2, comm_cart, 0);
+}
+
+void PNX(trafo_F)(
+    PNX(plan) ths
+    )
+{
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->g1, ths->howmany*ths->local_N[0]*ths->local_N[1]*ths->local_N[2], 1,
+      "PNFFT: Sum of Fourier coefficients before FFT");
+#endif
+
+  PX(execute)(ths->pfft_forw);
+  profile_fft(ths, ths->pfft_forw, 0);
+}
+
+void PNX(adjoint_F)(
+    PNX(plan) ths
+    )
+{
+  PX(execute)(ths->pfft_back);
+  profile_fft(ths, ths->pfft_back, 1);
+
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->g1, ths->howmany*ths->local_N[0]*ths->local_N[1]*ths->local_N[2], 1,
+      "PNFFT^H: Sum of Fourier coefficients after FFT");
+#endif
+}
+
+
+/* Implement ghostcell send for all dimensions, the axes t >= d of plans with d < 3 have none */
+/* Split the last execution of pfft into the global remaps and the local FFTs by the timer of PFFT,
+ * the bytes are the local array moved once per remap and read and written once per local FFT. */
+static void profile_fft(
+    PNX(plan) ths, PX(plan) pfft, int adj
+    )
+{
+  const int sub = (adj) ? PNFFT_PROFILE_ADJ_SUB : PNFFT_PROFILE_TRAFO_SUB;
+  const double size = (double) (ths->local_no_total * ths->howmany) * sizeof(C);
+  double remap = 0, local = 0;
+  PX(timer) timer = PX(get_timer_trafo)(pfft);
+
+  for(int k=0; k<timer->rnk_remap; k++)
+    remap += timer->remap[k];
+  remap += timer->remap_3dto2d[0] + timer->remap_3dto2d[1];
+  for(int k=0; k<timer->rnk_trafo; k++)
+    local += timer->trafo[k];
+  local += timer->itwiddle + timer->otwiddle;
+
+  PNX(profile_add)(ths, sub + PNFFT_PROFILE_SUB_F_REMAP, remap, timer->rnk_remap * size);
+  PNX(profile_add)(ths, sub + PNFFT_PROFILE_SUB_F_LOCAL, local, 2 * timer->rnk_trafo * size);
+
+  PX(destroy_timer)(timer);
+  PX(reset_timer)(pfft);
+}
+
+static void get_size_gcells(
+    int d, int m, int cutoff, unsigned pnfft_flags,
+    INT *gcells_below, INT *gcells_above
+    )
+{
+  for(int t=0; t<3; t++){
+    if(t >= d){
+      gcells_below[t] = gcells_above[t] = 0;
+      continue;
+    }
+    gcells_below[t] = m;
+    gcells_above[t] = cutoff - gcells_below[t] - 1;
+    if(pnfft_flags & PNFFT_INTERLACED)
+      gcells_above[t] += 1;
+  }
+}
+
+static void lowest_summation_index(
+    const INT *n, int m, const R *x,
+    const INT *local_no_start, const INT *gcells_below,
+    R *floor_nx_j, INT *u_j
+    )
+{
+  project_node_to_grid(n, m, x, floor_nx_j, u_j);
+  for(int t=0; t<3; t++)
+    u_j[t] = u_j[t] - local_no_start[t] + gcells_below[t];
+}
+
+
+static void local_array_size(
+    const INT *local_n, const INT *gcells_below, const INT *gcells_above,
+    INT *local_ngc
+    )
+{
+  for(int t=0; t<3; t++)
+    local_ngc[t] = local_n[t] + gcells_below[t] + gcells_above[t];
+}
+
+
+
+static void pre_tensor_intpol(
+    const INT *n, int cutoff, const R *x, const R *floor_nx,
+    int intpol_order, INT intpol_num_nodes, R **intpol_tables_psi,
+    R *pre_psi
+    )
+{
+  const int d=3;
+
+  for(int t=0; t<d; t++){
+    R dist = n[t]*x[t] - floor_nx[t] ; /* 0<= dist < 1 */
+    INT k = (INT) pnfft_floor(dist*intpol_num_nodes);
+    R dist_k = dist*intpol_num_nodes - (R)k; /* 0 <= dist_k < 1 */
+    const R *coeff = intpol_tables_psi[t] + k * cutoff * (intpol_order+1);
+    R *p = pre_psi + cutoff*t;
+
+    /* Horner's scheme, vectorizable over the contiguous stencil points */
+    for(int s=0; s<cutoff; s++)
+      p[s] = coeff[intpol_order*cutoff + s];
+    for(int i=intpol_order-1; i>=0; i--)
+      for(int s=0; s<cutoff; s++)
+        p[s] = p[s] * dist_k + coeff[i*cutoff + s];
+  }
+}
+
+static void pre_tensor_poly(
+    const INT *n, int cutoff, const R *x, const R *floor_nx,
+    int degree, R **poly_tables,
+    R *pre_psi
+    )
+{
+  const int d=3;
+
+  for(int t=0; t<d; t++){
+    R z = 2.0 * (n[t]*x[t] - floor_nx[t]) - 1.0; /* -1 <= z < 1 */
+    const R *coeff = poly_tables[t];
+    R *p = pre_psi + cutoff*t;
+
+    /* Horner's scheme, vectorizable over the contiguous stencil points */
+    for(int s=0; s<cutoff; s++)
+      p[s] = coeff[degree*cutoff + s];
+    for(int i=degree-1; i>=0; i--)
+      for(int s=0; s<cutoff; s++)
+        p[s] = p[s] * z + coeff[i*cutoff + s];
+  }
+}
+
+
+/* switch between direct evaluation and interpolation */
+static void pre_psi_tensor(
+    const INT *n, const R *b, int m, int cutoff, const R *x, const R *floor_nx,
+    const R *exp_const, R *spline_coeffs, unsigned pnfft_flags,
+    int intpol_order, INT intpol_num_nodes, R **intpol_tables_psi,
+    R *pre_psi
+    )
+{
+  if(pnfft_flags & PNFFT_PRE_INTPOL_PSI)
+    pre_tensor_intpol(
+        n, cutoff, x, floor_nx,
+        intpol_order, intpol_num_nodes, intpol_tables_psi,
+        pre_psi);
+  else if(pnfft_flags & PNFFT_PRE_POLY_PSI)
+    pre_tensor_poly(
+        n, cutoff, x, floor_nx,
+        intpol_order, intpol_tables_psi,
+        pre_psi);
+  else
+    pre_psi_tensor_direct(
+        n, b, m, cutoff, x, floor_nx,
+        exp_const, spline_coeffs, pnfft_flags,
+        pre_psi);
+}
+
+
+/* calculate window function */
+static void pre_psi_tensor_direct(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    const R *exp_const, R *spline_coeffs,
+    unsigned pnfft_flags,
+    R *pre_psi
+    )
+{
+  if(pnfft_flags & PNFFT_WINDOW_GAUSSIAN){
+    if(pnfft_flags & PNFFT_FG_PSI)
+      pre_psi_tensor_fast_gaussian(
+          n, b, m, cutoff, x, floor_nx, exp_const,
+          pre_psi);
+    else
+      pre_psi_tensor_gaussian(
+          n, b, m, cutoff, x, floor_nx,
+          pre_psi);
+  } 
+  else if(pnfft_flags & PNFFT_WINDOW_BSPLINE)
+    pre_psi_tensor_bspline(
+        n, m, cutoff, x, floor_nx, spline_coeffs,
+        pre_psi);
+  else if(pnfft_flags & PNFFT_WINDOW_SINC_POWER)
+    pre_psi_tensor_sinc_power(
+        n, b, m, cutoff, x, floor_nx,
+        pre_psi);
+  else if(pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
+    pre_psi_tensor_bessel_i0(
+        n, b, m, cutoff, x, floor_nx,
+        pre_psi);
+  else if(pnfft_flags & PNFFT_WINDOW_ES)
+    pre_psi_tensor_es(
+        n, b, m, cutoff, x, floor_nx,
+        pre_psi);
+  else
+    pre_psi_tensor_kaiser_bessel(
+        n, b, m, cutoff, x, floor_nx,
+        pre_psi);
+}
+
+static void pre_psi_tensor_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_psi[cutoff*t+s] = pnfft_exp(-PNFFT_SQR(u_j + s) / b[t]) / pnfft_sqrt(PNFFT_PI*b[t]);
+  }
+}
+
+static void pre_psi_tensor_fast_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *exp_const,
+    R *fg_psi
+    )
+{
+  const int d=3;
+  R v[3], tmp[3], exp_lin[3];
+
+  /* the three axes run in lockstep, such that the exponentials and the recurrence vectorize */
+  for(int t=0; t<d; t++)
+    v[t] = n[t]*x[t] - floor_nx[t] + m;
+  for(int t=0; t<d; t++){
+    tmp[t]     = pnfft_exp( -PNFFT_SQR(v[t]) / b[t] );
+    exp_lin[t] = pnfft_exp( 2*v[t] / b[t] );
+  }
+
+  for(int s=0; s<cutoff; s++)
+    for(int t=0; t<d; t++){
+      fg_psi[cutoff*t+s] = tmp[t] * exp_const[cutoff*t+s];
+      tmp[t] *= exp_lin[t];
+    }
+}
+
+static void pre_psi_tensor_bspline(
+    const INT *n, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs, 
+    R *pre_psi
+    )
+{
+  const int d=3;
+
+  if(m<9){
+    for(int t=0; t<d; t++){
+      /* Bspline is shifted by m */
+      R dist = floor_nx[t]  - n[t]*x[t] + 0.5; 
+      for(int s=0; s<cutoff; s++)
+        pre_psi[cutoff*t+s] = PNX(fast_bspline)(
+            s-1, dist, 2*m);
+    }
+    return;
+  }
+
+  /* stencil point s lies on piece s-1 of the Bspline, which is shifted by m */
+  for(int t=0; t<d; t++){
+    pre_psi[cutoff*t] = 0.0;
+    PNX(bspline_poly_pieces)(
+        2*m, 0, floor_nx[t] - n[t]*x[t] + 1, spline_coeffs,
+        pre_psi + cutoff*t + 1);
+  }
+}
+
+/* The factor n of the window cancels with the factor 1/n from matrix D. */
+static void pre_psi_tensor_sinc_power(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m; 
+    for(int s=0; s<cutoff; s++)
+      pre_psi[cutoff*t+s] =
+        pnfft_pow(
+            PNX(sinc)( PNFFT_PI * (u_j + s) / b[t]),
+            K(2.0)*(R)m
+        ) / b[t];
+  }
+}
+
+static void pre_psi_tensor_bessel_i0(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_psi[cutoff*t+s] = window_bessel_i0_1d(
+          (u_j + s) / n[t], n[t], b[t], m);
+  }
+}
+
+static void pre_psi_tensor_es(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_psi[cutoff*t+s] = window_es_1d(
+          (u_j + s) / n[t], n[t], b[t], m);
+  }
+}
+
+static void pre_psi_tensor_kaiser_bessel(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_psi[cutoff*t+s] = kaiser_bessel_1d(
+          (u_j + s) / n[t], n[t], b[t], m);
+  }
+}
+
+/* switch between direct evaluation and interpolation */
+static void pre_dpsi_tensor(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs,
+    int intpol_order, INT intpol_num_nodes, R **intpol_tables_dpsi,
+    const R *pre_psi, unsigned pnfft_flags,
+    R *pre_dpsi
+    )
+{
+  if(pnfft_flags & PNFFT_PRE_INTPOL_PSI)
+    pre_tensor_intpol(
+        n, cutoff, x, floor_nx,
+        intpol_order, intpol_num_nodes, intpol_tables_dpsi,
+        pre_dpsi);
+  else if(pnfft_flags & PNFFT_PRE_POLY_PSI)
+    pre_tensor_poly(
+        n, cutoff, x, floor_nx,
+        intpol_order, intpol_tables_dpsi,
+        pre_dpsi);
+  else
+    pre_dpsi_tensor_direct(
+        n, b, m, cutoff, x, floor_nx, spline_coeffs,
+        pre_psi, pnfft_flags,
+        pre_dpsi);
+}
+
+/* calculate window derivative */
+static void pre_dpsi_tensor_direct(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs, const R *pre_psi,
+    unsigned pnfft_flags,
+    R *pre_dpsi
+    )
+{
+  if(pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
+    pre_dpsi_tensor_gaussian(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_dpsi);
+  else if(pnfft_flags & PNFFT_WINDOW_BSPLINE)
+    pre_dpsi_tensor_bspline(
+        n, m, cutoff, x, floor_nx, spline_coeffs,
+        pre_dpsi);
+  else if(pnfft_flags & PNFFT_WINDOW_SINC_POWER)
+    pre_dpsi_tensor_sinc_power(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_dpsi);
+  else if(pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
+    pre_dpsi_tensor_bessel_i0(
+        n, b, m, cutoff, x, floor_nx,
+        pre_dpsi);
+  else if(pnfft_flags & PNFFT_WINDOW_ES)
+    pre_dpsi_tensor_es(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_dpsi);
+  else
+    pre_dpsi_tensor_kaiser_bessel(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_dpsi);
+}
+
+static void pre_dpsi_tensor_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *fg_psi,
+    R *fg_dpsi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = n[t]*x[t] - floor_nx[t] + m;
+    for(int s=0; s<cutoff; s++)
+      fg_dpsi[cutoff*t+s] = -2.0*n[t]/b[t] * (u_j-s) * fg_psi[cutoff*t+s];
+  }
+}
+
+/* window and derivative of one node, the fast Gaussian gridding computes both in one recurrence */
+static void pre_psi_dpsi_tensor(
+    const INT *n, const R *b, int m, int cutoff, const R *x, const R *floor_nx,
+    const R *exp_const, R *spline_coeffs, unsigned pnfft_flags,
+    int intpol_order, INT intpol_num_nodes, R **intpol_tables_psi, R **intpol_tables_dpsi,
+    R *pre_psi, R *pre_dpsi
+    )
+{
+  if((pnfft_flags & PNFFT_WINDOW_GAUSSIAN) && (pnfft_flags & PNFFT_FG_PSI)
+      && !(pnfft_flags & (PNFFT_PRE_INTPOL_PSI | PNFFT_PRE_POLY_PSI))){
+    pre_psi_dpsi_tensor_fast_gaussian(
+        n, b, m, cutoff, x, floor_nx, exp_const,
+        pre_psi, pre_dpsi);
+    return;
+  }
+
+  pre_psi_tensor(
+      n, b, m, cutoff, x, floor_nx,
+      exp_const, spline_coeffs, pnfft_flags,
+      intpol_order, intpol_num_nodes, intpol_tables_psi,
+      pre_psi);
+  pre_dpsi_tensor(
+      n, b, m, cutoff, x, floor_nx, spline_coeffs,
+      intpol_order, intpol_num_nodes, intpol_tables_dpsi,
+      pre_psi, pnfft_flags,
+      pre_dpsi);
+}
+
+/* psi' = -2n/b * (nx - u - s) * psi needs only one multiplication more per stencil point */
+static void pre_psi_dpsi_tensor_fast_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *exp_const,
+    R *fg_psi, R *fg_dpsi
+    )
+{
+  const int d=3;
+  R v[3], tmp[3], exp_lin[3], fac[3], psi;
+
+  for(int t=0; t<d; t++){
+    v[t]   = n[t]*x[t] - floor_nx[t] + m;
+    fac[t] = -2.0*n[t]/b[t];
+  }
+  for(int t=0; t<d; t++){
+    tmp[t]     = pnfft_exp( -PNFFT_SQR(v[t]) / b[t] );
+    exp_lin[t] = pnfft_exp( 2*v[t] / b[t] );
+  }
+
+  for(int s=0; s<cutoff; s++)
+    for(int t=0; t<d; t++){
+      psi = tmp[t] * exp_const[cutoff*t+s];
+      fg_psi[cutoff*t+s]  = psi;
+      fg_dpsi[cutoff*t+s] = fac[t] * (v[t]-s) * psi;
+      tmp[t] *= exp_lin[t];
+    }
+}
+
+/* window of one node for a kind known at compile time,
+ * the switch folds away in the specialized node loops */
+static inline void psi_tensor_kind(
+    const PNX(plan) ths, const int kind, const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_psi
+    )
+{
+  const int cutoff = ths->cutoff;
+
+  switch(kind){
+    case PNFFTI_PSI_INTPOL:
+      pre_tensor_intpol(ths->n, cutoff, x, floor_nx,
+          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi, pre_psi);
+      break;
+    case PNFFTI_PSI_POLY:
+      pre_tensor_poly(ths->n, cutoff, x, floor_nx,
+          ths->intpol_order, ths->intpol_tables_psi, pre_psi);
+      break;
+    case PNFFTI_PSI_GAUSSIAN:
+      pre_psi_tensor_gaussian(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi);
+      break;
+    case PNFFTI_PSI_FAST_GAUSSIAN:
+      pre_psi_tensor_fast_gaussian(ths->n, ths->b, ths->m, cutoff, x, floor_nx, ths->exp_const, pre_psi);
+      break;
+    case PNFFTI_PSI_BSPLINE:
+      pre_psi_tensor_bspline(ths->n, ths->m, cutoff, x, floor_nx, spline_coeffs, pre_psi);
+      break;
+    case PNFFTI_PSI_SINC_POWER:
+      pre_psi_tensor_sinc_power(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi);
+      break;
+    case PNFFTI_PSI_BESSEL_I0:
+      pre_psi_tensor_bessel_i0(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi);
+      break;
+    case PNFFTI_PSI_ES:
+      pre_psi_tensor_es(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi);
+      break;
+    case PNFFTI_PSI_KAISER_BESSEL:
+      pre_psi_tensor_kaiser_bessel(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi);
+      break;
+  }
+}
+
+/* window and derivative of one node for a kind known at compile time */
+static inline void psi_dpsi_tensor_kind(
+    const PNX(plan) ths, const int kind, const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_psi, R *pre_dpsi
+    )
+{
+  const int cutoff = ths->cutoff;
+
+  if(kind == PNFFTI_PSI_FAST_GAUSSIAN){
+    pre_psi_dpsi_tensor_fast_gaussian(ths->n, ths->b, ths->m, cutoff, x, floor_nx, ths->exp_const,
+        pre_psi, pre_dpsi);
+    return;
+  }
+
+  psi_tensor_kind(ths, kind, x, floor_nx, spline_coeffs, pre_psi);
+  switch(kind){
+    case PNFFTI_PSI_INTPOL:
+      pre_tensor_intpol(ths->n, cutoff, x, floor_nx,
+          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_dpsi, pre_dpsi);
+      break;
+    case PNFFTI_PSI_POLY:
+      pre_tensor_poly(ths->n, cutoff, x, floor_nx,
+          ths->intpol_order, ths->intpol_tables_dpsi, pre_dpsi);
+      break;
+    case PNFFTI_PSI_GAUSSIAN:
+      pre_dpsi_tensor_gaussian(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi, pre_dpsi);
+      break;
+    case PNFFTI_PSI_BSPLINE:
+      pre_dpsi_tensor_bspline(ths->n, ths->m, cutoff, x, floor_nx, spline_coeffs, pre_dpsi);
+      break;
+    case PNFFTI_PSI_SINC_POWER:
+      pre_dpsi_tensor_sinc_power(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi, pre_dpsi);
+      break;
+    case PNFFTI_PSI_BESSEL_I0:
+      pre_dpsi_tensor_bessel_i0(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_dpsi);
+      break;
+    case PNFFTI_PSI_ES:
+      pre_dpsi_tensor_es(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi, pre_dpsi);
+      break;
+    case PNFFTI_PSI_KAISER_BESSEL:
+      pre_dpsi_tensor_kaiser_bessel(ths->n, ths->b, ths->m, cutoff, x, floor_nx, pre_psi, pre_dpsi);
+      break;
+  }
+}
+
+static void pre_dpsi_tensor_bspline(
+    const INT *n, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_dpsi
+    )
+{
+  const int d=3;
+
+  if(m<9){
+    for(int t=0; t<d; t++){
+      /* Bspline is shifted by m */
+      R dist = floor_nx[t] - n[t]*x[t] + 0.5;
+      for(int s=0; s<cutoff; s++)
+        pre_dpsi[cutoff*t+s] = -(R)n[t] * PNX(fast_bspline_d)(
+            s-1, dist, 2*m);
+    }
+    return;
+  }
+
+  /* stencil point s lies on piece s-1 of the Bspline, which is shifted by m */
+  for(int t=0; t<d; t++){
+    pre_dpsi[cutoff*t] = 0.0;
+    PNX(bspline_poly_pieces)(
+        2*m, 1, floor_nx[t] - n[t]*x[t] + 1, spline_coeffs,
+        pre_dpsi + cutoff*t + 1);
+    for(int s=1; s<cutoff; s++)
+      pre_dpsi[cutoff*t+s] *= -(R)n[t];
+  }
+}
+
+
+/* The factor n of the window cancels with the factor 1/n from matrix D. */
+static void pre_dpsi_tensor_sinc_power(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_dpsi
+    )
+{
+  const int d=3;
+  R u_j, y;
+
+  for(int t=0; t<d; t++){
+    u_j =  floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++){
+      y =  PNFFT_PI * (u_j + s) / b[t];
+      if(pnfft_fabs(y) > PNFFT_EPSILON)
+        pre_dpsi[cutoff*t+s] =
+          2.0 * (R)m * PNFFT_PI * (R)n[t] / b[t] * ( 1.0/y - 1.0/pnfft_tan(y) ) * pre_psi[cutoff*t+s];
+      else
+        pre_dpsi[cutoff*t+s] = K(0.0);
+    }
+  }
+}
+
+static void pre_dpsi_tensor_bessel_i0(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_dpsi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_dpsi[cutoff*t+s] = window_bessel_i0_derivative_1d(
+          (u_j + s) / n[t], n[t], b[t], m);
+  }
+}
+
+
+static void pre_dpsi_tensor_es(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_dpsi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_dpsi[cutoff*t+s] = window_es_derivative_1d(
+          (u_j + s) / n[t], n[t], b[t], m, pre_psi[cutoff*t+s]);
+  }
+}
+
+static void pre_dpsi_tensor_kaiser_bessel(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_dpsi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j =  floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_dpsi[cutoff*t+s] = kaiser_bessel_derivative_1d(
+          (u_j + s) / n[t],
+          n[t], b[t], m, pre_psi[cutoff*t+s]);
+  }
+}
+
+/* Second derivatives of the window for PNFFT_COMPUTE_HESSIAN_F, always evaluated directly */
+static void pre_d2psi_tensor(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs,
+    const R *pre_psi, unsigned pnfft_flags,
+    R *pre_d2psi
+    )
+{
+  if(pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
+    pre_d2psi_tensor_gaussian(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_d2psi);
+  else if(pnfft_flags & PNFFT_WINDOW_BSPLINE)
+    pre_d2psi_tensor_bspline(
+        n, m, cutoff, x, floor_nx, spline_coeffs,
+        pre_d2psi);
+  else if(pnfft_flags & PNFFT_WINDOW_SINC_POWER)
+    pre_d2psi_tensor_sinc_power(
+        n, b, m, cutoff, x, floor_nx,
+        pre_d2psi);
+  else if(pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
+    pre_d2psi_tensor_bessel_i0(
+        n, b, m, cutoff, x, floor_nx,
+        pre_d2psi);
+  else if(pnfft_flags & PNFFT_WINDOW_ES)
+    pre_d2psi_tensor_es(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_d2psi);
+  else
+    pre_d2psi_tensor_kaiser_bessel(
+        n, b, m, cutoff, x, floor_nx, pre_psi,
+        pre_d2psi);
+}
+
+static void pre_d2psi_tensor_gaussian(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_d2psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = n[t]*x[t] - floor_nx[t] + m;
+    for(int s=0; s<cutoff; s++)
+      pre_d2psi[cutoff*t+s] = n[t]*n[t] *
+        ( 4.0 * PNFFT_SQR( (u_j-s)/b[t] ) - 2.0/b[t] ) * pre_psi[cutoff*t+s];
+  }
+}
+
+/* second derivative of the pieces of the Bspline, zero for m < 2 */
+static void pre_d2psi_tensor_bspline(
+    const INT *n, int m, int cutoff,
+    const R *x, const R *floor_nx, R *spline_coeffs,
+    R *pre_d2psi
+    )
+{
+  const int d=3;
+
+  /* stencil point s lies on piece s-1 of the Bspline, which is shifted by m */
+  for(int t=0; t<d; t++){
+    pre_d2psi[cutoff*t] = 0.0;
+    PNX(bspline_poly_pieces)(
+        2*m, 2, floor_nx[t] - n[t]*x[t] + 1, spline_coeffs,
+        pre_d2psi + cutoff*t + 1);
+    for(int s=1; s<cutoff; s++)
+      pre_d2psi[cutoff*t+s] *= (R)n[t] * (R)n[t];
+  }
+}
+
+/* Product rule for sinc(y)^(2m), the derivatives of sinc use their Taylor series close to 0. */
+static void pre_d2psi_tensor_sinc_power(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_d2psi
+    )
+{
+  const int d=3;
+  R u_j, y, y2, sinc, dsinc, d2sinc, c;
+
+  for(int t=0; t<d; t++){
+    u_j =  floor_nx[t] - n[t]*x[t] - m;
+    c = PNFFT_SQR( PNFFT_PI * (R)n[t] / b[t] );
+    for(int s=0; s<cutoff; s++){
+      y = PNFFT_PI * (u_j + s) / b[t];
+      y2 = y*y;
+      sinc = PNX(sinc)(y);
+      if(pnfft_fabs(y) < K(0.1)){
+        dsinc  = y * (-K(1.0)/3 + y2 * (K(1.0)/30 - y2/840));
+        d2sinc = -K(1.0)/3 + y2 * (K(1.0)/10 + y2 * (-K(1.0)/168 + y2/6480));
+      } else {
+        dsinc  = (pnfft_cos(y) - sinc) / y;
+        d2sinc = -sinc - 2.0 * dsinc / y;
+      }
+      pre_d2psi[cutoff*t+s] = c * 2.0 * (R)m / b[t] *
+        ( (2*m-1) * pnfft_pow(sinc, K(2.0)*(R)m - 2) * dsinc * dsinc
+          + pnfft_pow(sinc, K(2.0)*(R)m - 1) * d2sinc );
+    }
+  }
+}
+
+static void pre_d2psi_tensor_bessel_i0(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx,
+    R *pre_d2psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_d2psi[cutoff*t+s] = window_bessel_i0_second_derivative_1d(
+          (u_j + s) / n[t], n[t], b[t], m);
+  }
+}
+
+static void pre_d2psi_tensor_es(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_d2psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j = floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_d2psi[cutoff*t+s] = window_es_second_derivative_1d(
+          (u_j + s) / n[t], n[t], b[t], m, pre_psi[cutoff*t+s]);
+  }
+}
+
+static void pre_d2psi_tensor_kaiser_bessel(
+    const INT *n, const R *b, int m, int cutoff,
+    const R *x, const R *floor_nx, const R *pre_psi,
+    R *pre_d2psi
+    )
+{
+  const int d=3;
+  R u_j;
+
+  for(int t=0; t<d; t++){
+    u_j =  floor_nx[t] - n[t]*x[t] - m;
+    for(int s=0; s<cutoff; s++)
+      pre_d2psi[cutoff*t+s] = kaiser_bessel_second_derivative_1d(
+          (u_j + s) / n[t],
+          n[t], b[t], m, pre_psi[cutoff*t+s]);
+  }
+}
+
+
+
+
+
+
+/* Return the permutation of sorted nodes or NULL if PNFFT_SORT_NODES is not set.
+ * The permutation is cached within the plan and only recomputed after
+ * PNX(invalidate_sorted_index) was called. In this case, the old permutation
+ * serves as a warm start, since the nodes usually moved only slightly. */
+static INT* get_sorted_index(
+    PNX(plan) ths, double *timer
+    )
+{
+  if( !(ths->pnfft_flags & PNFFT_SORT_NODES) || ths->local_M == 0 )
+    return NULL;
+
+  update_sorted_index(ths, timer);
+
+  /* nodes are already stored in sorted order, no need for indirect access */
+  if(ths->nodes_in_order)
+    return NULL;
+
+  return ths->sorted_index;
+}
+
+static INT* update_sorted_index(
+    PNX(plan) ths, double *timer
+    )
+{
+  if(!ths->sorted_index_valid){
+    int warm_start = (ths->sorted_index != NULL);
+
+    if(timer != NULL){
+      PNFFT_START_PHASE(ths, timer, PNFFT_TIMER_SORT_NODES);
+    }
+    if(!warm_start)
+      ths->sorted_index = (INT*) PNX(malloc)(sizeof(INT) * (size_t) 2*ths->local_M);
+    sort_nodes_for_better_cache_handle(
+        ths->d, ths->n, ths->m, ths->local_M, ths->x, warm_start,
+        ths->sort_keys, (ths->spread_tile > 0) ? PNFFT_MAX(ths->spread_tile, ths->cutoff) : PNFFT_SORT_TILE,
+        ths->sorted_index);
+    ths->sorted_index_valid = 1;
+
+    ths->nodes_in_order = 1;
+    for(INT p=0; p<ths->local_M; p++){
+      if(ths->sorted_index[2*p+1] != p){
+        ths->nodes_in_order = 0;
+        break;
+      }
+    }
+    if(timer != NULL){
+      PNFFT_FINISH_PHASE(ths, timer, PNFFT_TIMER_SORT_NODES);
+    }
+  }
+
+  return ths->sorted_index;
+}
+
+/* Physically reorder x, f, grad_f and hessian_f into the sorted order of the nodes.
+ * Afterwards, all loops over the nodes run with unit stride.
+ * Call this function before PNX(precompute_psi). */
+void PNX(sort_nodes)(
+    PNX(plan) ths
+    )
+{
+  INT *sorted_index, *node_order;
+
+  if(ths->local_M == 0)
+    return;
+
+  sorted_index = update_sorted_index(ths, NULL);
+  if(ths->nodes_in_order)
+    return;
+
+  /* remember the original index of every node */
+  node_order = (INT*) PNX(malloc)(sizeof(INT) * (size_t) ths->local_M);
+  for(INT p=0; p<ths->local_M; p++){
+    INT j = sorted_index[2*p+1];
+    node_order[p] = (ths->node_order != NULL) ? ths->node_order[j] : j;
+  }
+  if(ths->node_order != NULL)
+    PNX(free)(ths->node_order);
+  ths->node_order = node_order;
+
+  for(INT p=0; p<ths->local_M; p++)
+    sorted_index[2*p+1] = p;
+  permute_nodes(ths, sorted_index, 0);
+  ths->nodes_in_order = 1;
+}
+
+/* Restore the original order of x, f, grad_f and hessian_f, i.e., undo PNX(sort_nodes). */
+void PNX(unsort_nodes)(
+    PNX(plan) ths
+    )
+{
+  if(ths->node_order == NULL)
+    return;
+
+  /* the permutation of the sorted nodes is now given by the original indices */
+  for(INT p=0; p<ths->local_M; p++)
+    ths->sorted_index[2*p+1] = ths->node_order[p];
+  permute_nodes(ths, ths->sorted_index, 1);
+  ths->nodes_in_order = 0;
+
+  PNX(free)(ths->node_order);
+  ths->node_order = NULL;
+}
+
+/* Gather (scatter=0) or scatter (scatter=1) all node based arrays
+ * according to the permutation perm[2*p+1]. */
+static void permute_nodes(
+    PNX(plan) ths, const INT *perm, int scatter
+    )
+{
+  int d = ths->d;
+  int cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+  int howmany[4];
+  R *arrays[4], *buffer;
+
+  arrays[0] = ths->x;         howmany[0] = d;
+  arrays[1] = ths->f;         howmany[1] = cplx * (int) ths->howmany;
+  arrays[2] = ths->grad_f;    howmany[2] = cplx * d;
+  arrays[3] = ths->hessian_f; howmany[3] = cplx * 6;
+
+  buffer = (R*) PNX(scratch_malloc)(ths, sizeof(R) * (size_t) PNFFT_MAX(12, PNFFT_MAX(2*d, howmany[1])) * ths->local_M);
+
+  for(int a=0; a<4; a++){
+    int h = howmany[a];
+    R *array = arrays[a];
+
+    if(array == NULL)
+      continue;
+
+    for(INT p=0; p<ths->local_M; p++){
+      INT j = perm[2*p+1];
+      for(int t=0; t<h; t++){
+        if(scatter)
+          buffer[h*j+t] = array[h*p+t];
+        else
+          buffer[h*p+t] = array[h*j+t];
+      }
+    }
+    memcpy(array, buffer, sizeof(R) * (size_t) h * ths->local_M);
+  }
+
+  PNX(scratch_free)(ths, buffer);
+}
+
+/* Must be called whenever the nodes x change. Keeps the old permutation for a warm start,
+ * but the new nodes come in the user's order, i.e., the order of PNX(sort_nodes) is dropped. */
+void PNX(invalidate_sorted_index)(
+    PNX(plan) ths
+    )
+{
+  ths->sorted_index_valid = 0;
+
+  if(ths->node_order != NULL)
+    PNX(free)(ths->node_order);
+  ths->node_order = NULL;
+  ths->nodes_in_order = 0;
+}
+
+/* Must be called whenever the number of nodes local_M changes. */
+void PNX(free_sorted_index)(
+    PNX(plan) ths
+    )
+{
+  if(ths->sorted_index != NULL)
+    PNX(free)(ths->sorted_index);
+  ths->sorted_index = NULL;
+  ths->sorted_index_valid = 0;
+
+  if(ths->node_order != NULL)
+    PNX(free)(ths->node_order);
+  ths->node_order = NULL;
+  ths->nodes_in_order = 0;
+}
+
+/**
+ * Sort nodes (index) to get better cache utilization during multiplication
+ * with matrix B.
+ * The resulting index set is written to ar[2*j+1], the nodes array remains
+ * unchanged.
+ *
+ * \arg n FFTW length (number of oversampled grid points in each dimension)
+ * \arg m window length
+ * \arg local_x_num number of nodes
+ * \arg local_x nodes array
+ * \arg ar_x resulting index array
+ *
+ * \author Toni Volkmer
+ */
+static void sort_nodes_for_better_cache_handle(
+    int d, const INT *n, int m, INT local_x_num, const R *local_x, int warm_start,
+    int keys, INT tile,
+    INT *ar_x
+    )
+{
+#if PNFFT_SORT_RADIX
+  INT u_j[d], i, j, k, help, rhigh;
+  INT *ar_x_temp;
+  int bits;
+
+  /* warm start: recompute the keys in the order of the previous sort */
+  rhigh = sort_key_bits(d, n, keys, tile, &bits) - 1;
+  for(i = 0; i < local_x_num; i++) {
+    k = (warm_start) ? ar_x[2*i+1] : i;
+    for(j = 0; j < d; j++) {
+      help = pnfft_floor( n[j]*local_x[d*k+j] - m);
+      u_j[j] = (help%n[j]+n[j])%n[j];
+    }
+    ar_x[2*i] = sort_key(d, n, u_j, keys, tile, bits);
+    ar_x[2*i+1] = k;
+  }
+
+  ar_x_temp = (INT*) PNX(malloc)(2*local_x_num*sizeof(INT));
+  if(warm_start)
+    PNX(sort_node_indices_incremental)(local_x_num, ar_x, ar_x_temp, rhigh);
+  else
+    PNX(sort_node_indices_radix_lsdf)(local_x_num, ar_x, ar_x_temp, rhigh);
+#  ifdef OMP_ASSERT
+  for (i = 1; i < local_x_num; i++)
+    assert(ar_x[2*(i-1)] <= ar_x[2*i]);
+#  endif
+  PNX(free)(ar_x_temp);
+#else
+  PNX(sort_nodes_indices_qsort_3d)(n, m, local_x_num, local_x, ar_x);
+#endif
+}
+
+#if PNFFT_SORT_RADIX
+/* Key of the lowest grid point u_j of a node's support, 0 <= u_j[t] < n[t]. */
+static INT sort_key(
+    int d, const INT *n, const INT *u_j, int keys, INT tile, int bits
+    )
+{
+  INT key = 0;
+
+  if(keys == PNFFT_SORT_KEYS_MORTON){
+    /* interleave the bits of all axes, the first axis gets the most significant bit */
+    for(int b = bits-1; b >= 0; b--)
+      for(int t = 0; t < d; t++)
+        key = (key << 1) | ((u_j[t] >> b) & 1);
+  } else if(keys == PNFFT_SORT_KEYS_TILED){
+    /* row major index of the tile, followed by the row major index within the tile */
+    INT in_tile = 0;
+    for(int t = 0; t < d; t++){
+      key = key * ((n[t] + tile - 1) / tile) + u_j[t] / tile;
+      in_tile = in_tile * tile + u_j[t] % tile;
+    }
+    for(int t = 0; t < d; t++)
+      key *= tile;
+    key += in_tile;
+  } else {
+    for(int t = 0; t < d; t++)
+      key = key * n[t] + u_j[t];
+  }
+
+  return key;
+}
+
+/* Number of bits of the largest key, 'bits' returns the bits per axis of Morton keys. */
+static int sort_key_bits(
+    int d, const INT *n, int keys, INT tile, int *bits
+    )
+{
+  R nprod = 1.0;
+
+  *bits = 0;
+  for(int t = 0; t < d; t++){
+    INT nt = n[t];
+    if(keys == PNFFT_SORT_KEYS_TILED)
+      nt = (n[t] + tile - 1) / tile * tile;
+    while( ((INT) 1 << *bits) < n[t] )
+      (*bits)++;
+    nprod *= nt;
+  }
+
+  if(keys == PNFFT_SORT_KEYS_MORTON)
+    return d * (*bits);
+
+  return (int) pnfft_ceil(pnfft_log2(nprod));
+}
+#endif
+
+
+
+
+
+static void project_node_to_grid(
+    const INT *n, int m, const R *x,
+    R *floor_nx_j, INT *u_j
+    )
+{
+  for(int t=0; t<3; t++){
+    floor_nx_j[t] = pnfft_floor(n[t]*x[t]);
+    u_j[t] = (INT) floor_nx_j[t] - m;
+  }
+}
+
+static void get_mpi_cart_dims_3d(
+    MPI_Comm comm_cart,
+    int *rnk_pm, int *dims, int *coords
+    )
+{
+  int *periods;
+
+  /* takes care of the case rnk_pm < 3 */  
+  for(int t=0; t<3; t++) dims[t] = 1;
+  for(int t=0; t<3; t++) coords[t] = 0;
+
+  MPI_Cartdim_get(comm_cart, rnk_pm);
+
+  periods = (int*) malloc(sizeof(int) * (size_t) *rnk_pm);
+  MPI_Cart_get(comm_cart, *rnk_pm, dims, periods, coords);
+  free(periods);
+}
+
+/* compact support in real space */
+static R window_bessel_i0_1d(
+    R x, INT n, R b, int m
+    )
+{
+  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
+
+  /* Compact support in real space */
+  return (d<0) ? 0.0 : 0.5 * PNX(bessel_i0)(b*pnfft_sqrt(d));
+}
+
+static R window_bessel_i0_derivative_1d(
+    R x, INT n, R b, int m
+    )
+{
+  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
+  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+
+  /* Compact support in real space */
+  if(d<0)
+   return 0.0;
+
+  /* avoid division by zero */
+  return (d>0) ? 0.5 * b * (R)n * (R)n * x * PNX(bessel_i1)(b*r) / r : PNFFT_SQR(0.5*b*n) * x;
+}
+
+/* I1(t)/t and (t*I0(t) - 2*I1(t))/t^3 with t = b*r switch to their Taylor series for small t */
+static R window_bessel_i0_second_derivative_1d(
+    R x, INT n, R b, int m
+    )
+{
+  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
+  R r, t, i1_t, d2_t;
+
+  /* Compact support in real space */
+  if(d<0)
+   return 0.0;
+
+  r = pnfft_sqrt(d);
+  t = b*r;
+  if(t < K(1e-2)){
+    i1_t = 0.5 + t*t/16;
+    d2_t = 0.125 + t*t/96;
+  } else {
+    i1_t = PNX(bessel_i1)(t) / t;
+    d2_t = (t*PNX(bessel_i0)(t) - 2.0*PNX(bessel_i1)(t)) / (t*t*t);
+  }
+
+  return -0.5 * b * (R)n * (R)n * ( b*i1_t - (R)n * (R)n * x*x * b*b*b*d2_t );
+}
+
+/* exponential of semicircle, compact support in real space */
+static R window_es_1d(
+    R x, INT n, R b, int m
+    )
+{
+  R d = K(1.0) - PNFFT_SQR( x*n/(R)m );
+
+  return (d<0) ? 0.0 : pnfft_exp( b * (pnfft_sqrt(d) - K(1.0)) );
+}
+
+static R window_es_derivative_1d(
+    R x, INT n, R b, int m, R psi
+    )
+{
+  R d = K(1.0) - PNFFT_SQR( x*n/(R)m );
+
+  /* the derivative is unbounded at the border of the support, where psi is almost zero */
+  return (d>0) ? psi * b * (R)n * (R)n * x / ( (R)m * (R)m * pnfft_sqrt(d) ) : 0.0;
+}
+
+static R window_es_second_derivative_1d(
+    R x, INT n, R b, int m, R psi
+    )
+{
+  R d = K(1.0) - PNFFT_SQR( x*n/(R)m );
+  R a = b * (R)n * (R)n / ( (R)m * (R)m ), sqrt_d;
+
+  if(d<=0)
+    return 0.0;
+
+  sqrt_d = pnfft_sqrt(d);
+  return a * psi * ( a*x*x/d - 1.0/sqrt_d - PNFFT_SQR( x*n/(R)m ) / (d*sqrt_d) );
+}
+
+static R kaiser_bessel_1d(
+    R x, INT n, R b, int m
+    )
+{
+  /* TODO: try to avoid case d<0, since in theory d >= 0 */
+  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
+  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+
+  if(d < 0)
+    return pnfft_sin(b*r) / ((R)PNFFT_PI*r);
+
+  /* regular case d >= 0 */
+  return (d>0) ? pnfft_sinh(b*r) / ((R)PNFFT_PI*r) : b/PNFFT_PI;
+}
+
+static R kaiser_bessel_derivative_1d(
+    R x, INT n, R b, int m, R psi
+    )
+{
+  /* TODO: try to avoid case d<0, since in theory d >= 0 */
+  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
+  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+
+  if(d < 0) /* use of -d results in change of sign within the brackets */
+    return n*n*x/d * (b*pnfft_cos(b*r)/PNFFT_PI - psi);
+
+  /* regular case d >= 0 */
+  return (d>0) ? n*n*x/d * (b*pnfft_cosh(b*r)/PNFFT_PI - psi) : -n*m*b*b*b/(3.0*PNFFT_PI);
+}
+
+/* With the window as function F of d = m^2 - (n*x)^2 it holds psi'' = 4*n^4*x^2*F''(d) - 2*n^2*F'(d),
+ * where F'(d) = (b*cosh(b*r)/pi - psi)/(2d) and F''(d) = (b^2*psi/2 - 3*F'(d))/(2d).
+ * Both use their Taylor series for small b^2*d. */
+static R kaiser_bessel_second_derivative_1d(
+    R x, INT n, R b, int m, R psi
+    )
+{
+  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
+  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+  R w = b*b*d, dF, d2F;
+
+  if(pnfft_fabs(w) < K(1e-2)){
+    dF  = b*b*b/PNFFT_PI * (K(1.0)/6  + w * (K(1.0)/60  + w/1680));
+    d2F = b*b*b*b*b/PNFFT_PI * (K(1.0)/60 + w * (K(1.0)/840 + w/30240));
+  } else {
+    /* use of -d results in cos instead of cosh */
+    dF  = ( b * ((d<0) ? pnfft_cos(b*r) : pnfft_cosh(b*r)) / PNFFT_PI - psi ) / (2.0*d);
+    d2F = ( 0.5*b*b*psi - 3.0*dF ) / (2.0*d);
+  }
+
+  return 4.0 * PNFFT_SQR( (R)n*(R)n*x ) * d2F - 2.0 * (R)n * (R)n * dF;
+}
+
+
+
+
+R PNX(psi)(
+    const PNX(plan) ths, int dim, R x
+    )
+{
+  if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
+    return psi_gaussian(x, ths->n[dim], ths->b[dim]);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_BSPLINE)
+    return psi_bspline(x, ths->n[dim], ths->m, ths->spline_coeffs);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_SINC_POWER)
+    return psi_sinc_power(x, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
+    return psi_bessel_i0(x, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_ES)
+    return psi_es(x, ths->n[dim], ths->b[dim], ths->m);
+  else
+    return psi_kaiser(x, ths->n[dim], ths->b[dim], ths->m);
+}
+
+R PNX(dpsi)(
+    const PNX(plan) ths, int dim, R x
+    )
+{
+  if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
+    return dpsi_gaussian(x, ths->n[dim], ths->b[dim]);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_BSPLINE)
+    return dpsi_bspline(x, ths->n[dim], ths->m, ths->spline_coeffs);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_SINC_POWER)
+    return dpsi_sinc_power(x, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
+    return dpsi_bessel_i0(x, ths->n[dim], ths->b[dim], ths->m);
+  else if(ths->pnfft_flags & PNFFT_WINDOW_ES)
+    return dpsi_es(x, ths->n[dim], ths->b[dim], ths->m);
+  else
+    return dpsi_kaiser(x, ths->n[dim], ths->b[dim], ths->m);
+}
+
+
+
+static R psi_gaussian(
+    R x, INT n, R b
+    )
+{
+  return pnfft_exp( -PNFFT_SQR(n*x)/b ) / pnfft_sqrt(PNFFT_PI*b);
+}
+
+static R dpsi_gaussian(
+    R x, INT n, R b
+    )
+{
+  return 2.0 * n/b * n*x * pnfft_exp( -PNFFT_SQR(n*x)/b ) / pnfft_sqrt(PNFFT_PI*b);
+}
+
+static R psi_bspline(
+    R x, INT n, int m, R *spline_coeffs
+    )
+{
+  /* Bspline is shifted by m */
+  return PNX(bspline_poly)(2*m, 0, n*x+m, spline_coeffs);
+}
+
+static R dpsi_bspline(
+    R x, INT n, int m, R *spline_coeffs
+    )
+{
+  /* Bspline is shifted by m */
+  return -(R)n * PNX(bspline_poly)(2*m, 1, n*x + m, spline_coeffs);
+}
+
+static R psi_sinc_power(
+    R x, INT n, R b, int m
+    )
+{
+  return pnfft_pow
+    (
+     PNX(sinc)( PNFFT_PI * (n*x) / b),
+     K(2.0)*(R)m
+    ) / b;
+}
+
+static R dpsi_sinc_power(
+    R x, INT n, R b, int m
+    )
+{
+  R y =  PNFFT_PI * n * x / b;
+  if(pnfft_fabs(y) > PNFFT_EPSILON)
+    return 2.0 * (R)m * PNFFT_PI * (R)n / b * ( 1.0/y - 1.0/pnfft_tan(y) ) * psi_sinc_power(x, n, b, m);
+  else
+    return 0.0;
+}
+
+static R psi_bessel_i0(
+    R x, INT n, R b, int m
+    )
+{
+  return window_bessel_i0_1d(x, n, b, m);
+}
+
+static R dpsi_bessel_i0(
+    R x, INT n, R b, int m
+    )
+{
+  return window_bessel_i0_derivative_1d(x, n, b, m);
+}
+
+static R psi_es(
+    R x, INT n, R b, int m
+    )
+{
+  return window_es_1d(x, n, b, m);
+}
+
+static R dpsi_es(
+    R x, INT n, R b, int m
+    )
+{
+  return window_es_derivative_1d(x, n, b, m, window_es_1d(x, n, b, m));
+}
+
+static R psi_kaiser(
+    R x, INT n, R b, int m
+    )
+{
+  return kaiser_bessel_1d(x, n, b, m);
+}
+
+static R dpsi_kaiser(
+    R x, INT n, R b, int m
+    )
+{
+  return kaiser_bessel_derivative_1d(
+      x, n, b, m, kaiser_bessel_1d(x, n, b, m));
+}
+
+
+/* Alternative sorting based on C standard qsort */
+void PNX(sort_nodes_indices_qsort_3d)(
+    const INT *n, int m, INT local_M, const R *x,
+    INT *sort
+    )
+{ /* sort must be of length 2*local_M */
+  int d = 3;
+  INT u_j[3];
+  R floor_nx_j[3];
+
+  if(local_M == 0)
+    return;
+
+  for(INT k = 0; k < local_M; k++){
+    project_node_to_grid(n, m, x+d*k, floor_nx_j, u_j);
+    sort[2*k]   = PNFFT_PLAIN_INDEX_3D(u_j, n);
+    sort[2*k+1] = k;
+  }
+  qsort(sort, (size_t) local_M, 2*sizeof(INT), compare_INT);
+}
+
+static int compare_INT(
+    const void* a, const void* b
+    )
+{
+  return (*(const INT*)a <= *(const INT*)b) ? -1 : 1;
+}
+
+
+// static void ik_diff_real_input(
+//     PNX(plan) ths
+//     )
+// {
+//   /* duplicate g1 since we have to scale it several times for computing the gradient */
+//   for(INT k=0; k<ths->local_N_total; k++)
+//     ths->g1_buffer[k] = ths->g1[k];
+// 
+//   /* calculate potential and 1st component of gradient */
+//   scale_ik_diff_r2ci(g1_buffer, ths->local_N_start, ths->local_N, dim=0,
+//     ths->g1);
+//   PNX(trafo_F)(ths);
+//   PNX(new_trafo_B)(ths, ths->grad_f, dim);
+//   
+//   /* calculate 2nd and 3rd component of gradient */
+//   scale_ik_diff_r2cr(g1_buffer, ths->local_N_start, ths->local_N, dim=1,
+//     ths->g1);
+//   scale_ik_diff_r2ci(g1_buffer, ths->local_N_start, ths->local_N, dim=2,
+//     ths->g1);
+//   PNX(trafo_F)(ths);
+//   PNX(new_trafo_B)(ths, ths->grad_f, dim);
+// }
+
+
+void PNX(trafo_B_grad_ik)(
+    PNX(plan) ths, R *f, INT offset, INT stride, int interlaced
+    )
+{
+  const int cutoff = ths->cutoff;
+  INT *sorted_index = NULL;
+  INT local_no[3], local_no_start[3];
+  INT gcells_below[3], gcells_above[3];
+  INT local_ngc[3];
+ 
+  local_size_B(ths,
+      local_no, local_no_start);
+
+  /* perform fftshift */
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_SHIFT_INPUT);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_SHIFT_INPUT);
+
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
+
+  /* send ghost cells in ring */
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+  exchange_gcells(ths, ths->gcplan, ths->ghosts);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+
+  /* sort indices for better cache handling */
+  sorted_index = get_sorted_index(ths, ths->timer_trafo);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    INT j, m0, u_j[3], block_nodes;
+    R floor_nx_j[3];
+    R *pre_psi = NULL;
+    R *spline_coeffs = ths->spline_coeffs;
+    R x[3];
+    psi_block block;
+
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
+    init_psi_block(ths, 0, &block);
+    block_nodes = (block.nodes) ? block.nodes : 1;
+
+#ifdef PNFFT_OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(INT p0=0; p0<ths->local_M; p0+=block_nodes){
+      INT p_end = (p0 + block_nodes < ths->local_M) ? p0 + block_nodes : ths->local_M;
+      if(block.nodes)
+        fill_psi_block(ths, p0, p_end-p0, NULL, local_no_start, gcells_below, interlaced, sorted_index,
+            spline_coeffs, &block);
+      for(INT p=p0; p<p_end; p++){
+        R *psi_p = (block.nodes) ? block.psi + (p-p0)*PNFFT_POW3(cutoff) : pre_psi;
+        j = (sorted_index) ? sorted_index[2*p+1] : p;
+
+        project_node_to_local_grid(
+            ths, j, local_no_start, gcells_below, interlaced,
+            x, floor_nx_j, u_j);
+
+        /* evaluate window on axes */
+        if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+          pre_psi_tensor(
+              ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j,
+              ths->exp_const, spline_coeffs, ths->pnfft_flags,
+              ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+              pre_psi);
+
+        /* compute f */
+        INT ind = j*stride + offset;
+        m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
+        if(ths->pnfft_flags & PNFFT_REAL_F)
+          PNX(assign_f_r2r)(
+              ths, p, ths->g2, psi_p, 2*m0, local_ngc, cutoff, 2, interlaced,
+              f + 2*ind);
+        else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          PNX(assign_f_r2r)(
+              ths, p, ths->g2, psi_p, m0, local_ngc, cutoff, 1, interlaced,
+              f + ind);
+        else
+          PNX(assign_f_c2c)(
+              ths, p, (C*)ths->g2, psi_p, m0, local_ngc, cutoff, interlaced,
+              (C*)f + ind);
+      }
+    }
+
+    if(pre_psi != NULL) PNX(free)(pre_psi);
+    free_psi_block(&block);
+  }
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+}
+
+/* potential and ik gradient from one exchange of the 4-fold interleaved g2 */
+void PNX(trafo_B_grad_ik_batched)(
+    PNX(plan) ths, int interlaced
+    )
+{
+  const int cutoff = ths->cutoff;
+  INT *sorted_index = NULL;
+  INT local_no[3], local_no_start[3];
+  INT gcells_below[3], gcells_above[3];
+  INT local_ngc[3];
+ 
+  local_size_B(ths,
+      local_no, local_no_start);
+
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
+
+  /* send ghost cells of all four fields in one ring */
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+  exchange_gcells(ths, ths->gcplan_ik, ths->ghosts_ik);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+
+  /* sort indices for better cache handling */
+  sorted_index = get_sorted_index(ths, ths->timer_trafo);
+
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    INT j, m0, u_j[3], block_nodes;
+    R floor_nx_j[3];
+    R *pre_psi = NULL;
+    R *spline_coeffs = ths->spline_coeffs;
+    R x[3];
+    C val[4];
+    psi_block block;
+
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
+    init_psi_block(ths, 0, &block);
+    block_nodes = (block.nodes) ? block.nodes : 1;
+
+#ifdef PNFFT_OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(INT p0=0; p0<ths->local_M; p0+=block_nodes){
+      INT p_end = (p0 + block_nodes < ths->local_M) ? p0 + block_nodes : ths->local_M;
+      if(block.nodes)
+        fill_psi_block(ths, p0, p_end-p0, NULL, local_no_start, gcells_below, interlaced, sorted_index,
+            spline_coeffs, &block);
+      for(INT p=p0; p<p_end; p++){
+        R *psi_p = (block.nodes) ? block.psi + (p-p0)*PNFFT_POW3(cutoff) : pre_psi;
+        j = (sorted_index) ? sorted_index[2*p+1] : p;
+
+        project_node_to_local_grid(
+            ths, j, local_no_start, gcells_below, interlaced,
+            x, floor_nx_j, u_j);
+
+        /* evaluate window on axes */
+        if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+          pre_psi_tensor(
+              ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j,
+              ths->exp_const, spline_coeffs, ths->pnfft_flags,
+              ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+              pre_psi);
+
+        /* field 0 is the potential, fields 1-3 are the derivatives */
+        for(int h=0; h<4; h++)
+          val[h] = 0;
+        m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
+        PNX(assign_f_c2c_many)(
+            ths, p, (C*)ths->g2, psi_p, m0, local_ngc, cutoff, 4, interlaced,
+            val);
+
+        if(ths->compute_flags & PNFFT_COMPUTE_F)
+          ((C*)ths->f)[j] = val[0];
+        for(int t=0; t<3; t++)
+          ((C*)ths->grad_f)[3*j+t] = val[1+t];
+      }
+    }
+
+    if(pre_psi != NULL) PNX(free)(pre_psi);
+    free_psi_block(&block);
+  }
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+}
+
+
+
+
+
+
+
+
+
+void PNX(trafo_B_grad_ad)(
+    PNX(plan) ths, int interlaced
+    )
+{
+  INT *sorted_index = NULL;
+  INT local_no[3], local_no_start[3];
+  INT gcells_below[3], gcells_above[3];
+  INT local_ngc[3];
+ 
+  local_size_B(ths,
+      local_no, local_no_start);
+
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->g2, ths->howmany*local_no[0]*local_no[1]*local_no[2],
+      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+      "PNFFT: Sum of Fourier coefficients before twiddles");
+#endif
+
+  /* perform fftshift */
+  PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_SHIFT_INPUT);
+  PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_SHIFT_INPUT);
+
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
+
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
+      "PNFFT: Sum of x before sort");
+#endif
+
+  /* sort indices for better cache handling */
+  sorted_index = get_sorted_index(ths, ths->timer_trafo);
+
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
+      "PNFFT: Sum of x after sort");
+
+  PNX(debug_sum_print)(ths->g2, ths->howmany*local_no[0]*local_no[1]*local_no[2],
+      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+      "PNFFT: Sum of Fourier coefficients before ghostcell send");
+#endif
+
+  if(use_sparse_b(ths, interlaced, 1)){
+    /* precomputed matrix B of PNFFT_SPARSE_B */
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+    exchange_gcells(ths, ths->gcplan, ths->ghosts);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+    sparse_b_trafo(ths, interlaced);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+  } else if(use_halo(ths, interlaced, 1)){
+    /* the neighbors gather the boundary nodes instead of sending ghost cells */
+    halo_trafo(ths, local_no_start, interlaced, sorted_index);
+  } else
+#ifdef PNFFT_OPENMP
+  if(interlaced != PNFFTI_INTERLACED_BATCHED && use_gcells_overlap(ths) && !use_mixed_precision(ths, interlaced, 1)){
+    /* send ghost cells in ring while the interior nodes are computed,
+     * the loop timer includes the overlapped ghost cell send */
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+    loop_over_particles_trafo_overlap(
+        ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+  } else
+#endif
+  {
+    /* send ghost cells in ring */
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+    if(interlaced == PNFFTI_INTERLACED_BATCHED)
+      exchange_gcells(ths, ths->gcplan_il, ths->ghosts_il);
+    else
+      exchange_gcells(ths, ths->gcplan, ths->ghosts);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+
+#if PNFFT_ENABLE_DEBUG
+    PNX(debug_sum_print)(ths->g2, ths->howmany*PNX(prod_INT)(3, local_ngc),
+        !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+        "PNFFT: Sum of Fourier coefficients after ghostcell send");
+#endif  
+
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+    if(use_mixed_precision(ths, interlaced, 1))
+      grid_to_single((C*)ths->g2, PNX(prod_INT)(3, local_ngc),
+          ths->g2_single);
+    loop_over_particles_trafo(
+        ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
   }
-}
 
-static void pre_dpsi_tensor_bessel_i0(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx,
-    R *pre_dpsi
-    )
-{
-  const int d=3;
-  R u_j;
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->f, ths->howmany*ths->local_M,
+      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+      "PNFFT: Sum of f");
 
-  for(int t=0; t<d; t++){
-    u_j = floor_nx[t] - n[t]*x[t] - m;
-    for(int s=0; s<cutoff; s++)
-      pre_dpsi[cutoff*t+s] = window_bessel_i0_derivative_1d(
-          (u_j + s) / n[t], n[t], b[t], m);
+  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
+    PNX(debug_sum_print_strides)(ths->grad_f, ths->local_M, 3,
+        !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+        "PNFFT: Sum of %dst component of grad_f");
   }
+#endif
 }
 
 
-static void pre_dpsi_tensor_kaiser_bessel(
-    const INT *n, const R *b, int m, int cutoff,
-    const R *x, const R *floor_nx, const R *pre_psi,
-    R *pre_dpsi
+
+
+void PNX(adjoint_B)(
+    PNX(plan) ths, int interlaced
     )
 {
-  const int d=3;
-  R u_j;
-
-  for(int t=0; t<d; t++){
-    u_j =  floor_nx[t] - n[t]*x[t] - m;
-    for(int s=0; s<cutoff; s++)
-      pre_dpsi[cutoff*t+s] = kaiser_bessel_derivative_1d(
-          (u_j + s) / n[t],
-          n[t], b[t], m, pre_psi[cutoff*t+s]);
-  }
-}
+  INT *sorted_index = NULL;
+  INT local_no[3], local_no_start[3];
+  INT gcells_below[3], gcells_above[3];
+  INT local_ngc[3], local_ngc_total;
 
+  local_size_B(ths,
+      local_no, local_no_start);
 
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
 
+  local_ngc_total = (interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : ths->howmany;
+  local_ngc_total *= PNX(prod_INT)(3, local_ngc);
 
+  zero_grid_B(ths, local_ngc_total, use_mixed_precision(ths, interlaced, 0));
 
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
+      "PNFFT^H: Sum of x before sort");
+#endif
 
-/**
- * Sort nodes (index) to get better cache utilization during multiplication
- * with matrix B.
- * The resulting index set is written to ar[2*j+1], the nodes array remains
- * unchanged.
- *
- * \arg n FFTW length (number of oversampled grid points in each dimension)
- * \arg m window length
- * \arg local_x_num number of nodes
- * \arg local_x nodes array
- * \arg ar_x resulting index array
- *
- * \author Toni Volkmer
- */
-static void sort_nodes_for_better_cache_handle(
-    int d, const INT *n, int m, INT local_x_num, const R *local_x,
-    INT *ar_x
-    )
-{
-#if PNFFT_SORT_RADIX
-  INT u_j[d], i, j, help, rhigh;
-  INT *ar_x_temp;
-  R nprod;
+  /* sort indices for better cache handling */
+  sorted_index = get_sorted_index(ths, ths->timer_adj);
+  
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
+      "PNFFT^H: Sum of x after sort");
+  
+  PNX(debug_sum_print)(ths->f, ths->howmany*ths->local_M,
+      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+      "PNFFT^H: Sum of f");
+#endif
+  
+  if(use_sparse_b(ths, interlaced, 0)){
+    /* precomputed matrix B of PNFFT_SPARSE_B */
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+    sparse_b_adj(ths, interlaced);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+    reduce_gcells_split(ths, interlaced);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+  } else if(use_halo(ths, interlaced, 0)){
+    /* the neighbors spread the boundary nodes instead of reducing ghost cells */
+    halo_adj(ths, local_no_start, interlaced, sorted_index);
+  } else
+#ifdef PNFFT_OPENMP
+  if(interlaced != PNFFTI_INTERLACED_BATCHED && use_gcells_overlap(ths) && !use_mixed_precision(ths, interlaced, 0)){
+    /* reduce ghost cells in ring while the interior nodes are computed,
+     * the loop timer includes the overlapped ghost cell reduce */
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+    loop_over_particles_adj_colored(
+        ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index, 1);
+    finish_shared_psi(ths, interlaced);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+  } else
+#endif
+  {
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+    loop_over_particles_adj(
+        ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index);
+    /* real inputs with PNFFT_INTERLACED_BATCHED spread onto both real grids in one pass,
+     * which share one r2c FFT with howmany=2 and one ghost cell reduce */
+    if(use_mixed_precision(ths, interlaced, 0))
+      grid_from_single(ths->g2_single, local_ngc_total,
+          (C*)ths->g2);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
 
-  for(i = 0; i < local_x_num; i++) {
-    ar_x[2*i] = 0;
-    ar_x[2*i+1] = i;
-    for(j = 0; j < d; j++) {
-      help = pnfft_floor( n[j]*local_x[d*i+j] - m);
-      u_j[j] = (help%n[j]+n[j])%n[j];
+#if PNFFT_ENABLE_DEBUG
+    PNX(debug_sum_print)(ths->g2, local_ngc_total,
+        !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+        "PNFFT^H: Sum of Fourier coefficients before ghostcell reduce");
+#endif  
 
-      ar_x[2*i] += u_j[j];
-      if (j+1 < d)
-        ar_x[2*i] *= n[j+1];
-    }
+    /* reduce ghost cells in ring */
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+    if(interlaced == PNFFTI_INTERLACED_BATCHED)
+      reduce_gcells(ths, ths->gcplan_il, ths->ghosts_il);
+    else
+      reduce_gcells_split(ths, interlaced);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
   }
 
-  for (j = 0, nprod = 1.0; j < d; j++)
-    nprod *= n[j];
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->g2, ths->howmany*local_no[0]*local_no[1]*local_no[2],
+      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+      "PNFFT^H: Sum of Fourier coefficients after ghostcell reduce");
+#endif
 
-  rhigh = pnfft_ceil(pnfft_log2(nprod)) - 1;
+  /* perform fftshift */
+  PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_SHIFT_INPUT);
+//   if(ths->pnfft_flags & PNFFT_SHIFTED_IN)
+  PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_SHIFT_INPUT);
 
-  ar_x_temp = (INT*) PNX(malloc)(2*local_x_num*sizeof(INT));
-  PNX(sort_node_indices_radix_lsdf)(local_x_num, ar_x, ar_x_temp, rhigh);
-#  ifdef OMP_ASSERT
-  for (i = 1; i < local_x_num; i++)
-    assert(ar_x[2*(i-1)] <= ar_x[2*i]);
-#  endif
-  PNX(free)(ar_x_temp);
-#else
-  PNX(sort_nodes_indices_qsort_3d)(n, m, local_x_num, local_x, ar_x);
+#if PNFFT_ENABLE_DEBUG
+  PNX(debug_sum_print)(ths->g2, ths->howmany*local_no[0]*local_no[1]*local_no[2],
+      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
+      "PNFFT^H: Sum of Fourier coefficients after twiddles");
 #endif
 }
 
+/* Matrix B^T of the chunked adjoint, see PNX(adj_chunked_start). PNFFTI_CHUNK_START clears the
+ * grid, PNFFTI_CHUNK_NODES adds the nodes of the plan and PNFFTI_CHUNK_FINISH reduces the ghost
+ * cells of all chunks at once. Neither the particle halo nor PNFFT_SPARSE_B are used. */
+void PNX(adjoint_B_chunked)(
+    PNX(plan) ths, int stage
+    )
+{
+  const int mixed = use_mixed_precision(ths, 0, 0);
+  INT local_no[3], local_no_start[3];
+  INT gcells_below[3], gcells_above[3];
+  INT local_ngc[3], local_ngc_total;
 
+  local_size_B(ths,
+      local_no, local_no_start);
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
+  local_ngc_total = ths->howmany * PNX(prod_INT)(3, local_ngc);
 
+  if(stage == PNFFTI_CHUNK_START){
+    zero_grid_B(ths, local_ngc_total, mixed);
+  } else if(stage == PNFFTI_CHUNK_NODES){
+    INT *sorted_index = get_sorted_index(ths, ths->timer_adj);
 
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+    loop_over_particles_adj(
+        ths, local_no_start, local_ngc, gcells_below, 0, sorted_index);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_LOOP_B);
+  } else {
+    if(mixed)
+      grid_from_single(ths->g2_single, local_ngc_total,
+          (C*)ths->g2);
 
-static void project_node_to_grid(
-    const INT *n, int m, const R *x,
-    R *floor_nx_j, INT *u_j
-    )
-{
-  for(int t=0; t<3; t++){
-    floor_nx_j[t] = pnfft_floor(n[t]*x[t]);
-    u_j[t] = (INT) floor_nx_j[t] - m;
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+    reduce_gcells(ths, ths->gcplan, ths->ghosts);
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
   }
 }
 
-static void get_mpi_cart_dims_3d(
-    MPI_Comm comm_cart,
-    int *rnk_pm, int *dims, int *coords
+/* Matrix B of the chunked trafo, see PNX(trafo_chunked_start). PNFFTI_CHUNK_START exchanges the
+ * ghost cells once and PNFFTI_CHUNK_NODES gathers the nodes of the plan from the same grid. */
+void PNX(trafo_B_chunked)(
+    PNX(plan) ths, int stage
     )
 {
-  int *periods;
-
-  /* takes care of the case rnk_pm < 3 */  
-  for(int t=0; t<3; t++) dims[t] = 1;
-  for(int t=0; t<3; t++) coords[t] = 0;
+  INT local_no[3], local_no_start[3];
+  INT gcells_below[3], gcells_above[3];
+  INT local_ngc[3];
 
-  MPI_Cartdim_get(comm_cart, rnk_pm);
+  local_size_B(ths,
+      local_no, local_no_start);
+  get_size_gcells(ths->d, ths->m, ths->cutoff, ths->pnfft_flags,
+      gcells_below, gcells_above);
+  local_array_size(local_no, gcells_below, gcells_above,
+      local_ngc);
 
-  periods = (int*) malloc(sizeof(int) * (size_t) *rnk_pm);
-  MPI_Cart_get(comm_cart, *rnk_pm, dims, periods, coords);
-  free(periods);
+  if(stage == PNFFTI_CHUNK_START){
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+    exchange_gcells(ths, ths->gcplan, ths->ghosts);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+
+    if(use_mixed_precision(ths, 0, 1))
+      grid_to_single((C*)ths->g2, ths->howmany * PNX(prod_INT)(3, local_ngc),
+          ths->g2_single);
+  } else if(stage == PNFFTI_CHUNK_NODES){
+    INT *sorted_index = get_sorted_index(ths, ths->timer_trafo);
+
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+    loop_over_particles_trafo(
+        ths, local_no_start, local_ngc, gcells_below, 0, sorted_index);
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_LOOP_B);
+  }
 }
 
-/* compact support in real space */
-static R window_bessel_i0_1d(
-    R x, INT n, R b, int m
+/* same static decomposition as the first touch of the grid */
+static void zero_grid_B(
+    PNX(plan) ths, INT size, int mixed
     )
 {
-  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
-
-  /* Compact support in real space */
-  return (d<0) ? 0.0 : 0.5 * PNX(bessel_i0)(b*pnfft_sqrt(d));
+  if(mixed){
+#ifdef PNFFT_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(INT k=0; k<size; k++)
+      ths->g2_single[k] = 0;
+  } else if (ths->trafo_flag & PNFFTI_TRAFO_C2R){
+#ifdef PNFFT_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(INT k=0; k<size; k++)
+      ths->g2[k] = 0;
+  } else {
+#ifdef PNFFT_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(INT k=0; k<size; k++)
+      ((C*)ths->g2)[k] = 0;
+  }
 }
 
-static R window_bessel_i0_derivative_1d(
-    R x, INT n, R b, int m
+static void loop_over_particles_trafo(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index
     )
 {
-  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
-  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+  const int cutoff = ths->cutoff;
+  const INT no_offset[3] = {0, 0, 0};
+  R *grid = (use_mixed_precision(ths, interlaced, 1)) ? (R*) ths->g2_single : ths->g2;
+  R rsum=0.0, rsum_derive=0.0;
+  double times[PNFFTI_DETAIL_TIMES] = {0, 0};
+#if PNFFT_ENABLE_DEBUG
+  R grsum, grsum_derive;
+#endif
 
-  /* Compact support in real space */
-  if(d<0)
-   return 0.0;
+  /* every node only writes to its own f and grad_f, i.e., the gather is race free */
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel reduction(+:rsum,rsum_derive)
+#endif
+  {
+    R *pre_psi = NULL, *pre_dpsi = NULL;
+    R *spline_coeffs = ths->spline_coeffs;
 
-  /* avoid division by zero */
-  return (d>0) ? 0.5 * b * (R)n * (R)n * x * PNX(bessel_i1)(b*r) / r : PNFFT_SQR(0.5*b*n) * x;
-}
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
+      /* batched interlacing needs the window of both grids */
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3 * ((interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : 1));
+      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
+        pre_dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
+    }
 
-static R kaiser_bessel_1d(
-    R x, INT n, R b, int m
-    )
-{
-  /* TODO: try to avoid case d<0, since in theory d >= 0 */
-  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
-  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+    ths->gather_nodes_kernel(
+        ths, local_no_start, gcells_below, interlaced, sorted_index, PNFFT_NODES_ALL,
+        grid, local_ngc, no_offset, spline_coeffs, pre_psi, pre_dpsi, ths->shared_psi,
+        &rsum, &rsum_derive, (ths->profile_detail) ? times : NULL);
 
-  if(d < 0)
-    return pnfft_sin(b*r) / ((R)PNFFT_PI*r);
+    if(pre_psi != NULL)  PNX(free)(pre_psi);
+    if(pre_dpsi != NULL) PNX(free)(pre_dpsi);
+  }
 
-  /* regular case d >= 0 */
-  return (d>0) ? pnfft_sinh(b*r) / ((R)PNFFT_PI*r) : b/PNFFT_PI;
+  if(ths->profile_detail)
+    PNX(profile_detail_times)(ths, 0, times);
+
+#if PNFFT_ENABLE_DEBUG
+  MPI_Reduce(&rsum, &grsum, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+  PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT: Sum of pre_psi: %e\n", grsum);
+
+  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
+    MPI_Reduce(&rsum_derive, &grsum_derive, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+    PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT: Sum of pre_dpsi: %e\n", grsum_derive);
+  }
+#endif
 }
 
-static R kaiser_bessel_derivative_1d(
-    R x, INT n, R b, int m, R psi
+#ifdef PNFFT_OPENMP
+/* Overlap the ghost cell send with the work on interior nodes, i.e., nodes whose
+ * support lies completely within the local block. Since PX(exchange) changes the
+ * layout of g2 in place, the interior nodes are gathered from a copy of the local
+ * block while the master thread sends the ghost cells. Afterwards, all threads
+ * handle the nodes near the block borders. */
+static void loop_over_particles_trafo_overlap(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index
     )
 {
-  /* TODO: try to avoid case d<0, since in theory d >= 0 */
-  R d = PNFFT_SQR( (R)m ) - PNFFT_SQR( x*n );
-  R r = (d<0) ? pnfft_sqrt(-d) : pnfft_sqrt(d);
+  const int cutoff = ths->cutoff;
+  const INT no_offset[3] = {0, 0, 0};
+  INT local_no_total_R = ths->howmany * ths->local_no_total;
+  R rsum=0.0, rsum_derive=0.0;
+  R *g2_local;
+  double times[PNFFTI_DETAIL_TIMES] = {0, 0};
+#if PNFFT_ENABLE_DEBUG
+  R grsum, grsum_derive;
+#endif
 
-  if(d < 0) /* use of -d results in change of sign within the brackets */
-    return n*n*x/d * (b*pnfft_cos(b*r)/PNFFT_PI - psi);
+  if( !(ths->trafo_flag & PNFFTI_TRAFO_C2R) )
+    local_no_total_R *= 2;
 
-  /* regular case d >= 0 */
-  return (d>0) ? n*n*x/d * (b*pnfft_cosh(b*r)/PNFFT_PI - psi) : -n*m*b*b*b/(3.0*PNFFT_PI);
-}
+  g2_local = (R*) PNX(scratch_malloc)(ths, sizeof(R) * (size_t) local_no_total_R);
+  memcpy(g2_local, ths->g2, sizeof(R) * (size_t) local_no_total_R);
 
+  #pragma omp parallel reduction(+:rsum,rsum_derive)
+  {
+    R *pre_psi = NULL, *pre_dpsi = NULL;
+    R *spline_coeffs = ths->spline_coeffs;
 
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
+      /* batched interlacing needs the window of both grids */
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3 * ((interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : 1));
+      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
+        pre_dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
+    }
 
+    /* send ghost cells in ring, no barrier at the end of master */
+    #pragma omp master
+    {
+      PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+      exchange_gcells(ths, ths->gcplan, ths->ghosts);
+      PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_GCELLS);
+    }
 
-R PNX(psi)(
-    const PNX(plan) ths, int dim, R x
-    )
-{
-  if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
-    return psi_gaussian(x, ths->n[dim], ths->b[dim]);
-  else if(ths->pnfft_flags & PNFFT_WINDOW_BSPLINE)
-    return psi_bspline(x, ths->n[dim], ths->m, ths->spline_coeffs);
-  else if(ths->pnfft_flags & PNFFT_WINDOW_SINC_POWER)
-    return psi_sinc_power(x, ths->n[dim], ths->b[dim], ths->m);
-  else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
-    return psi_bessel_i0(x, ths->n[dim], ths->b[dim], ths->m);
-  else
-    return psi_kaiser(x, ths->n[dim], ths->b[dim], ths->m);
+    ths->gather_nodes_kernel(
+        ths, local_no_start, gcells_below, interlaced, sorted_index, PNFFT_NODES_INTERIOR,
+        g2_local, ths->local_no, gcells_below, spline_coeffs, pre_psi, pre_dpsi, ths->shared_psi,
+        &rsum, &rsum_derive, (ths->profile_detail) ? times : NULL);
+
+    ths->gather_nodes_kernel(
+        ths, local_no_start, gcells_below, interlaced, sorted_index, PNFFT_NODES_BOUNDARY,
+        ths->g2, local_ngc, no_offset, spline_coeffs, pre_psi, pre_dpsi, ths->shared_psi,
+        &rsum, &rsum_derive, (ths->profile_detail) ? times : NULL);
+
+    if(pre_psi != NULL)  PNX(free)(pre_psi);
+    if(pre_dpsi != NULL) PNX(free)(pre_dpsi);
+  }
+
+  PNX(scratch_free)(ths, g2_local);
+  if(ths->profile_detail)
+    PNX(profile_detail_times)(ths, 0, times);
+
+#if PNFFT_ENABLE_DEBUG
+  MPI_Reduce(&rsum, &grsum, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+  PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT: Sum of pre_psi: %e\n", grsum);
+
+  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
+    MPI_Reduce(&rsum_derive, &grsum_derive, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+    PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT: Sum of pre_dpsi: %e\n", grsum_derive);
+  }
+#endif
 }
+#endif
 
-R PNX(dpsi)(
-    const PNX(plan) ths, int dim, R x
+/* Gather f and grad_f of all nodes in the subset 'select' from 'grid'.
+ * The lowest summation index of each node is shifted by 'grid_offset' to fit the
+ * array of size 'grid_size'. If called inside a parallel region, the nodes are
+ * shared among the threads. PNFFT_COMPUTE_HESSIAN_F evaluates the window with its first
+ * and second derivative per node and gathers f, grad_f and the Hessian in one pass.
+ * The window is evaluated as given by 'kind', one instance per kind is generated below.
+ * If 'shared' is not NULL, the window values that adj stored there are used instead.
+ * If 'times' is not NULL, the times of the window evaluation and of the accumulation are added. */
+static inline void gather_nodes_generic(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index, int select,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, R *pre_dpsi, PNX(shared_psi) *shared,
+    R *rsum, R *rsum_derive, double *times, const int kind
     )
 {
-  if(ths->pnfft_flags & PNFFT_WINDOW_GAUSSIAN)
-    return dpsi_gaussian(x, ths->n[dim], ths->b[dim]);
-  else if(ths->pnfft_flags & PNFFT_WINDOW_BSPLINE)
-    return dpsi_bspline(x, ths->n[dim], ths->m, ths->spline_coeffs);
-  else if(ths->pnfft_flags & PNFFT_WINDOW_SINC_POWER)
-    return dpsi_sinc_power(x, ths->n[dim], ths->b[dim], ths->m);
-  else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
-    return dpsi_bessel_i0(x, ths->n[dim], ths->b[dim], ths->m);
-  else
-    return dpsi_kaiser(x, ths->n[dim], ths->b[dim], ths->m);
-}
+  const int cutoff = ths->cutoff;
+  const int compute_grad_ad = !(ths->pnfft_flags & (PNFFT_GRAD_NONE | PNFFT_GRAD_IK))
+                              && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F);
+  const int compute_hessian = (ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F) && (interlaced != PNFFTI_INTERLACED_BATCHED);
+  INT j, m0, u_j[3], block_nodes;
+  R floor_nx_j[3];
+  R x[3];
+  R *hessian_psi = NULL;
+  R *scratch_psi = pre_psi, *scratch_dpsi = pre_dpsi;
+  psi_block block;
+  double thread_times[PNFFTI_DETAIL_TIMES] = {0, 0}, start;
+  double *detail = (times != NULL) ? thread_times : NULL;
+
+  if(compute_hessian){
+    memset(&block, 0, sizeof(psi_block));
+    hessian_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*9);
+  } else
+    init_psi_block(ths, compute_grad_ad, &block);
+  block_nodes = (block.nodes) ? block.nodes : 1;
+
+#ifdef PNFFT_OPENMP
+  #pragma omp for schedule(guided)
+#endif
+  for(INT p0=0; p0<ths->local_M; p0+=block_nodes){
+    INT p_end = (p0 + block_nodes < ths->local_M) ? p0 + block_nodes : ths->local_M;
+    if(block.nodes){
+      start = detail_start(detail);
+      fill_psi_block(ths, p0, p_end-p0, NULL, local_no_start, gcells_below, interlaced, sorted_index,
+          spline_coeffs, &block);
+      detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+    }
+    for(INT p=p0; p<p_end; p++){
+      j = (sorted_index) ? sorted_index[2*p+1] : p;
+
+      /* average of both interlacing grids in one pass, only f */
+      if(interlaced == PNFFTI_INTERLACED_BATCHED){
+        INT m0_il;
+        C f0 = 0, f1 = 0;
+        R *pre_psi_il = (pre_psi != NULL) ? pre_psi + 3*cutoff : NULL;
+        start = detail_start(detail);
+        prepare_node_interlaced_batched(
+            ths, j, local_no_start, gcells_below, grid_size, grid_offset, spline_coeffs,
+            pre_psi, pre_psi_il, &m0, &m0_il);
+        detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+        start = detail_start(detail);
+        if(ths->trafo_flag & PNFFTI_TRAFO_C2R){
+          R r0 = 0, r1 = 0;
+          PNX(assign_f_r2r)(
+              ths, p, grid, pre_psi, m0, grid_size, cutoff, 2, 0,
+              &r0);
+          PNX(assign_f_r2r)(
+              ths, p, grid + 1, pre_psi_il, m0_il, grid_size, cutoff, 2, 1,
+              &r1);
+          ths->f[j] = 0.5 * (r0 + r1);
+        } else {
+          PNX(assign_f_c2c_strided)(
+              ths, p, (C*)grid, pre_psi, m0, grid_size, cutoff, 2, 0,
+              &f0);
+          PNX(assign_f_c2c_strided)(
+              ths, p, (C*)grid + 1, pre_psi_il, m0_il, grid_size, cutoff, 2, 1,
+              &f1);
+          ((C*)ths->f)[j] = 0.5 * (f0 + f1);
+        }
+        detail_finish(detail, PNFFTI_DETAIL_ACCUMULATE, start);
+        continue;
+      }
 
+      project_node_to_local_grid(
+          ths, j, local_no_start, gcells_below, interlaced,
+          x, floor_nx_j, u_j);
 
+      if( !node_in_subset(select, u_j, gcells_below, ths->local_no, cutoff) )
+        continue;
 
-static R psi_gaussian(
-    R x, INT n, R b
-    )
-{
-  return pnfft_exp( -PNFFT_SQR(n*x)/b ) / pnfft_sqrt(PNFFT_PI*b);
-}
+      if(ths->compute_flags & PNFFT_COMPUTE_F) {
+        if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          ths->f[j] = 0;
+        else
+          for(INT h=0; h<ths->howmany; h++)
+            ((C*)ths->f)[ths->howmany*j+h] = 0;
+      }
+      if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
+        if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          for(int t=0; t<ths->d; t++)
+            ths->grad_f[ths->d*j+t] = 0;
+        else
+          for(int t=0; t<ths->d; t++)
+            ((C*)ths->grad_f)[ths->d*j+t] = 0;
+      }
 
-static R dpsi_gaussian(
-    R x, INT n, R b
-    )
-{
-  return 2.0 * n/b * n*x * pnfft_exp( -PNFFT_SQR(n*x)/b ) / pnfft_sqrt(PNFFT_PI*b);
-}
+      if(compute_hessian){
+        R *psi = hessian_psi, *dpsi = hessian_psi + 3*cutoff, *d2psi = hessian_psi + 6*cutoff;
+        R *f = (ths->compute_flags & PNFFT_COMPUTE_F) ? ths->f : NULL;
+        R *grad_f = (ths->compute_flags & PNFFT_COMPUTE_GRAD_F) ? ths->grad_f : NULL;
+
+        /* no tables for the second derivative, therefore all window values are direct */
+        start = detail_start(detail);
+        pre_psi_tensor_direct(
+            ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j,
+            ths->exp_const, spline_coeffs, ths->pnfft_flags,
+            psi);
+        pre_dpsi_tensor_direct(
+            ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j, spline_coeffs,
+            psi, ths->pnfft_flags,
+            dpsi);
+        pre_d2psi_tensor(
+            ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j, spline_coeffs,
+            psi, ths->pnfft_flags,
+            d2psi);
+        detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+
+        start = detail_start(detail);
+        for(int t=0; t<3; t++)
+          u_j[t] -= grid_offset[t];
+        m0 = PNFFT_PLAIN_INDEX_3D(u_j, grid_size);
+
+        if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          for(int t=0; t<6; t++)
+            ths->hessian_f[6*j+t] = 0;
+        else
+          for(int t=0; t<6; t++)
+            ((C*)ths->hessian_f)[6*j+t] = 0;
+
+        if(ths->pnfft_flags & PNFFT_REAL_F)
+          PNX(assign_hessian_f_r2r)(
+              grid, psi, dpsi, d2psi, 2*m0, grid_size, cutoff, 2, 2,
+              (f) ? f + 2*j : NULL, (grad_f) ? grad_f + 2*3*j : NULL, ths->hessian_f + 2*6*j);
+        else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          PNX(assign_hessian_f_r2r)(
+              grid, psi, dpsi, d2psi, m0, grid_size, cutoff, 1, 1,
+              (f) ? f + j : NULL, (grad_f) ? grad_f + 3*j : NULL, ths->hessian_f + 6*j);
+        else
+          PNX(assign_hessian_f_c2c)(
+              (C*)grid, psi, dpsi, d2psi, m0, grid_size, cutoff,
+              (f) ? (C*)f + j : NULL, (grad_f) ? (C*)grad_f + 3*j : NULL, (C*)ths->hessian_f + 6*j);
+        detail_finish(detail, PNFFTI_DETAIL_ACCUMULATE, start);
+        continue;
+      }
 
-static R psi_bspline(
-    R x, INT n, int m, R *spline_coeffs
-    )
-{
-  /* Bspline is shifted by m */
-  return PNX(bspline)(2*m, n*x+m, spline_coeffs);
-}
+      /* tensors of the current block */
+      if(block.nodes){
+        pre_psi = block.psi + (p-p0)*PNFFT_POW3(cutoff);
+        if(compute_grad_ad)
+          pre_dpsi = block.dpsi + 3*(p-p0)*PNFFT_POW3(cutoff);
+      }
 
-static R dpsi_bspline(
-    R x, INT n, int m, R *spline_coeffs
-    )
-{
-  /* Bspline is shifted by m */
-  return (R)n *( PNX(bspline)(2*m-1, n*x + m - 1, spline_coeffs)
-      - PNX(bspline)(2*m-1, n*x + m, spline_coeffs) );
-}
+      /* evaluate window on axes, unless adj already did */
+      if(kind != PNFFTI_PSI_TABLES){
+        int ready = 0;
+        R *shared_dpsi = NULL;
+        R *shared_psi = node_shared_psi(shared, p, interlaced, cutoff, &shared_dpsi, &ready);
+
+        pre_psi  = (shared_psi != NULL) ? shared_psi : scratch_psi;
+        pre_dpsi = (shared_dpsi != NULL) ? shared_dpsi : scratch_dpsi;
+        if((ths->compute_flags & PNFFT_COMPUTE_GRAD_F) && shared_dpsi == NULL)
+          ready = 0;
+
+        if(!ready){
+          start = detail_start(detail);
+          if(ths->compute_flags & (PNFFT_COMPUTE_GRAD_F))
+            psi_dpsi_tensor_kind(ths, kind, x, floor_nx_j, spline_coeffs,
+                pre_psi, pre_dpsi);
+          else
+            psi_tensor_kind(ths, kind, x, floor_nx_j, spline_coeffs,
+                pre_psi);
+          detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+        }
 
-static R psi_sinc_power(
-    R x, INT n, R b, int m
-    )
-{
-  return pnfft_pow
-    (
-     PNX(sinc)( PNFFT_PI * (n*x) / b),
-     K(2.0)*(R)m
-    ) / b;
-}
+#if PNFFT_ENABLE_DEBUG
+        /* Don't want to use PNX(debug_sum_print) because we are in a loop */
+        for(int t=0; t<3*cutoff; t++)
+          *rsum += pnfft_fabs(pre_psi[t]);
+        if(ths->compute_flags & (PNFFT_COMPUTE_GRAD_F))
+          for(int t=0; t<3*cutoff; t++)
+            *rsum_derive += pnfft_fabs(pre_dpsi[t]);
+#endif
+      }
 
-static R dpsi_sinc_power(
-    R x, INT n, R b, int m
-    )
-{
-  R y =  PNFFT_PI * n * x / b;
-  if(pnfft_fabs(y) > PNFFT_EPSILON)
-    return 2.0 * (R)m * PNFFT_PI * (R)n / b * ( 1.0/y - 1.0/pnfft_tan(y) ) * psi_sinc_power(x, n, b, m);
-  else
-    return 0.0;
-}
+      start = detail_start(detail);
+      for(int t=0; t<3; t++)
+        u_j[t] -= grid_offset[t];
+
+      m0 = PNFFT_PLAIN_INDEX_3D(u_j, grid_size);
+      if(ths->compute_flags & PNFFT_COMPUTE_F 
+         && ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
+        /* compute f and grad_f at once */
+        if(ths->pnfft_flags & PNFFT_REAL_F)
+          PNX(assign_f_and_grad_f_r2r)(
+              ths, p, grid, pre_psi, pre_dpsi,
+              2*m0, grid_size, cutoff, 2, 2, interlaced,
+              ths->f + 2*j, ths->grad_f + 2*3*j);
+        else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          PNX(assign_f_and_grad_f_r2r)(
+              ths, p, grid, pre_psi, pre_dpsi,
+              m0, grid_size, cutoff, 1, 1, interlaced,
+              ths->f + j, ths->grad_f + 3*j);
+        else
+          PNX(assign_f_and_grad_f_c2c)(
+              ths, p, (C*)grid, pre_psi, pre_dpsi,
+              m0, grid_size, cutoff, interlaced,
+              (C*)ths->f + j, (C*)ths->grad_f + 3*j);
+      } else if(ths->compute_flags & PNFFT_COMPUTE_F){
+        /* compute f, window values of the node go straight to the kernels */
+        if(kind != PNFFTI_PSI_TABLES && (ths->trafo_flag & PNFFTI_TRAFO_C2R))
+          ths->assign_f_r2r_kernel(
+              grid, pre_psi, m0, grid_size, cutoff, 1,
+              ths->f + j);
+        else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
+          PNX(assign_f_r2r)(
+              ths, p, grid, pre_psi, m0, grid_size, cutoff, 1, interlaced,
+              ths->f + j);
+        else if(ths->howmany > 1)
+          PNX(assign_f_c2c_many)(
+              ths, p, (C*)grid, pre_psi, m0, grid_size, cutoff, ths->howmany, interlaced,
+              (C*)ths->f + ths->howmany*j);
+        else if(use_mixed_precision(ths, interlaced, 1))
+          PNX(assign_f_c2c_single)(
+              ths, p, (CS*)grid, pre_psi, m0, grid_size, cutoff, interlaced,
+              (C*)ths->f + j);
+        else if(kind != PNFFTI_PSI_TABLES)
+          ths->assign_f_c2c_kernel(
+              (C*)grid, pre_psi, m0, grid_size, cutoff,
+              (C*)ths->f + j);
+        else
+          PNX(assign_f_c2c)(
+              ths, p, (C*)grid, pre_psi, m0, grid_size, cutoff, interlaced,
+              (C*)ths->f + j);
+      } else if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
+        /* compute grad_f */
+        PNX(assign_grad_f_c2c)(
+            ths, p, (C*)grid, pre_psi, pre_dpsi,
+            m0, grid_size, cutoff, interlaced,
+            (C*)ths->grad_f + 3*j);
+      }
+      detail_finish(detail, PNFFTI_DETAIL_ACCUMULATE, start);
+    }
+  }
 
-static R psi_bessel_i0(
-    R x, INT n, R b, int m
-    )
-{
-  return window_bessel_i0_1d(x, n, b, m);
+  if(hessian_psi != NULL) PNX(free)(hessian_psi);
+  free_psi_block(&block);
+  detail_reduce(thread_times, times);
 }
 
-static R dpsi_bessel_i0(
-    R x, INT n, R b, int m
+/* Start the time of one part of loop B, no-op if 'times' is NULL. */
+static inline double detail_start(
+    const double *times
     )
 {
-  return window_bessel_i0_derivative_1d(x, n, b, m);
+  return (times != NULL) ? MPI_Wtime() : 0;
 }
 
-static R psi_kaiser(
-    R x, INT n, R b, int m
+/* Add the time since 'start' to part PNFFTI_DETAIL_PSI or PNFFTI_DETAIL_ACCUMULATE of 'times'. */
+static inline void detail_finish(
+    double *times, int part, double start
     )
 {
-  return kaiser_bessel_1d(x, n, b, m);
+  if(times != NULL)
+    times[part] += MPI_Wtime() - start;
 }
 
-static R dpsi_kaiser(
-    R x, INT n, R b, int m
+/* Add the times of one thread to the times of the whole loop, which are shared by the threads. */
+static inline void detail_reduce(
+    const double *thread_times, double *times
     )
 {
-  return kaiser_bessel_derivative_1d(
-      x, n, b, m, kaiser_bessel_1d(x, n, b, m));
-}
-
-
-/* Alternative sorting based on C standard qsort */
-void PNX(sort_nodes_indices_qsort_3d)(
-    const INT *n, int m, INT local_M, const R *x,
-    INT *sort
-    )
-{ /* sort must be of length 2*local_M */
-  int d = 3;
-  INT u_j[3];
-  R floor_nx_j[3];
-
-  if(local_M == 0)
+  if(times == NULL)
     return;
 
-  for(INT k = 0; k < local_M; k++){
-    project_node_to_grid(n, m, x+d*k, floor_nx_j, u_j);
-    sort[2*k]   = PNFFT_PLAIN_INDEX_3D(u_j, n);
-    sort[2*k+1] = k;
+  for(int k=0; k<PNFFTI_DETAIL_TIMES; k++){
+#ifdef PNFFT_OPENMP
+    #pragma omp atomic
+#endif
+    times[k] += thread_times[k];
   }
-  qsort(sort, (size_t) local_M, 2*sizeof(INT), compare_INT);
 }
 
-static int compare_INT(
-    const void* a, const void* b
+static void loop_over_particles_adj(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index
     )
 {
-  return (*(const INT*)a <= *(const INT*)b) ? -1 : 1;
-}
+  const int cutoff = ths->cutoff;
+  const INT no_offset[3] = {0, 0, 0};
+  INT j;
+  R *grid = (use_mixed_precision(ths, interlaced, 0)) ? (R*) ths->g2_single : ths->g2;
+  R *pre_psi = NULL;
+  R rsum = 0.0;
+#if PNFFT_ENABLE_DEBUG
+  R grsum;
+#endif
 
+  if(ths->spread_tile > 0 && !use_mixed_precision(ths, interlaced, 0)){
+    rsum = loop_over_particles_adj_tiled(
+        ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index);
+  } else
+#ifdef PNFFT_OPENMP
+  if(omp_get_max_threads() > 1){
+    rsum = loop_over_particles_adj_colored(
+        ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index, 0);
+  } else
+#endif
+  {
+    psi_block block;
+    double times[PNFFTI_DETAIL_TIMES] = {0, 0}, start;
+    double *detail = (ths->profile_detail) ? times : NULL;
 
-// static void ik_diff_real_input(
-//     PNX(plan) ths
-//     )
-// {
-//   /* duplicate g1 since we have to scale it several times for computing the gradient */
-//   for(INT k=0; k<ths->local_N_total; k++)
-//     ths->g1_buffer[k] = ths->g1[k];
-// 
-//   /* calculate potential and 1st component of gradient */
-//   scale_ik_diff_r2ci(g1_buffer, ths->local_N_start, ths->local_N, dim=0,
-//     ths->g1);
-//   PNX(trafo_F)(ths);
-//   PNX(new_trafo_B)(ths, ths->grad_f, dim);
-//   
-//   /* calculate 2nd and 3rd component of gradient */
-//   scale_ik_diff_r2cr(g1_buffer, ths->local_N_start, ths->local_N, dim=1,
-//     ths->g1);
-//   scale_ik_diff_r2ci(g1_buffer, ths->local_N_start, ths->local_N, dim=2,
-//     ths->g1);
-//   PNX(trafo_F)(ths);
-//   PNX(new_trafo_B)(ths, ths->grad_f, dim);
-// }
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3 * ((interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : 1));
+    init_psi_block(ths, 0, &block);
+
+    for(INT p=0; p<ths->local_M; p++){
+      INT k = (block.nodes) ? p % block.nodes : 0;
+      if(block.nodes && k == 0){
+        start = detail_start(detail);
+        fill_psi_block(ths, p, (p + block.nodes < ths->local_M) ? block.nodes : ths->local_M - p, NULL,
+            local_no_start, gcells_below, interlaced, sorted_index, ths->spline_coeffs, &block);
+        detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+      }
+      j = (sorted_index) ? sorted_index[2*p+1] : p;
+      rsum += ths->spread_node_kernel(
+          ths, p, j, local_no_start, gcells_below, interlaced,
+          grid, local_ngc, no_offset, ths->spline_coeffs,
+          (block.nodes) ? block.psi + k*PNFFT_POW3(cutoff) : pre_psi, ths->shared_psi, detail);
+    }
+    if(pre_psi != NULL) PNX(free)(pre_psi);
+    free_psi_block(&block);
+    if(detail != NULL)
+      PNX(profile_detail_times)(ths, 1, times);
+  }
+  finish_shared_psi(ths, interlaced);
 
+#if PNFFT_ENABLE_DEBUG
+  MPI_Reduce(&rsum, &grsum, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+  PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT^H: Sum of pre_psi: %e\n", grsum);
+#endif
+}
 
-void PNX(trafo_B_grad_ik)(
-    PNX(plan) ths, R *f, INT offset, INT stride, int interlaced
+/* Spread the value f[j] of one node onto 'grid'.
+ * The lowest summation index is shifted by 'grid_offset' to fit the array of size 'grid_size'.
+ * The window is evaluated as given by 'kind', one instance per kind is generated below.
+ * If 'shared' is not NULL, the window values are also stored there for the following trafo.
+ * If 'times' is not NULL, the times of the window evaluation and of the accumulation are added.
+ * Returns the sum of the absolute window values for debugging. */
+static inline R spread_node_generic(
+    PNX(plan) ths, INT p, INT j,
+    INT *local_no_start, INT *gcells_below, int interlaced,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, PNX(shared_psi) *shared, double *times, const int kind
     )
 {
   const int cutoff = ths->cutoff;
-  INT j, m0;
-  INT *sorted_index = NULL;
-  INT local_no[3], local_no_start[3];
-  INT gcells_below[3], gcells_above[3];
-  INT u_j[3], local_ngc[3];
+  INT m0, u_j[3];
   R floor_nx_j[3];
-  R *pre_psi = NULL;
   R x[3];
- 
-  local_size_B(ths,
-      local_no, local_no_start);
-
-  /* perform fftshift */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_SHIFT_INPUT]);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_SHIFT_INPUT]);
-
-  get_size_gcells(ths->m, ths->cutoff, ths->pnfft_flags,
-      gcells_below, gcells_above);
-  local_array_size(local_no, gcells_below, gcells_above,
-      local_ngc);
-
-  /* send ghost cells in ring */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_GCELLS]);
-  PX(exchange)(ths->gcplan);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_GCELLS]);
-
-  /* sort indices for better cache handling */
-  if(ths->pnfft_flags & PNFFT_SORT_NODES){
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_SORT_NODES]);
-    sorted_index = (INT*) PNX(malloc)(sizeof(INT) * (size_t) 2*ths->local_M);
-    sort_nodes_for_better_cache_handle(
-        ths->d, ths->n, ths->m, ths->local_M, ths->x,
-        sorted_index);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_SORT_NODES]);
+  R rsum = 0.0;
+  double start;
+
+  /* spread onto both interlacing grids in one pass */
+  if(interlaced == PNFFTI_INTERLACED_BATCHED){
+    INT m0_il;
+    R *pre_psi_il = (pre_psi != NULL) ? pre_psi + 3*cutoff : NULL;
+    start = detail_start(times);
+    prepare_node_interlaced_batched(
+        ths, j, local_no_start, gcells_below, grid_size, grid_offset, spline_coeffs,
+        pre_psi, pre_psi_il, &m0, &m0_il);
+    detail_finish(times, PNFFTI_DETAIL_PSI, start);
+    start = detail_start(times);
+    if(ths->trafo_flag & PNFFTI_TRAFO_C2R){
+      PNX(spread_f_r2r)(
+          ths, p, ths->f[j], pre_psi, m0, grid_size, cutoff, 2, 0,
+          grid);
+      PNX(spread_f_r2r)(
+          ths, p, ths->f[j], pre_psi_il, m0_il, grid_size, cutoff, 2, 1,
+          grid + 1);
+    } else {
+      PNX(spread_f_c2c_strided)(
+          ths, p, ((C*)ths->f)[j], pre_psi, m0, grid_size, cutoff, 2, 0,
+          (C*)grid);
+      PNX(spread_f_c2c_strided)(
+          ths, p, ((C*)ths->f)[j], pre_psi_il, m0_il, grid_size, cutoff, 2, 1,
+          (C*)grid + 1);
+    }
+    detail_finish(times, PNFFTI_DETAIL_ACCUMULATE, start);
+    return rsum;
   }
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_LOOP_B]);
-  if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
-    pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
-  for(INT p=0; p<ths->local_M; p++){
-    j = (ths->pnfft_flags & PNFFT_SORT_NODES) ? sorted_index[2*p+1] : p;
+  project_node_to_local_grid(
+      ths, j, local_no_start, gcells_below, interlaced,
+      x, floor_nx_j, u_j);
 
-    /* shift x by half the mesh width for interlacing */
-    for(int t=0; t<3; t++){
-      x[t] = ths->x[ths->d*j+t];
-      if(interlaced)
-        x[t] += 0.5/ths->n[t];
-    }
+  /* evaluate window on axes, the trafo of PNX(adj_op_trafo) also needs the derivatives */
+  if(kind != PNFFTI_PSI_TABLES){
+    int ready;
+    R *shared_dpsi = NULL;
+    R *shared_psi = node_shared_psi(shared, p, interlaced, cutoff, &shared_dpsi, &ready);
 
-    /* We need to compute the lowest summation index before we fold x back into [-0.5,0.5).
-     * Otherwise u_j may be also folded and gets less than the local offset local_no_start. */
-    lowest_summation_index(
-        ths->n, ths->m, x, local_no_start, gcells_below,
-        floor_nx_j, u_j);
-    
-    /* assure -0.5 <= x < 0.5 */
-    if(interlaced){
-      for(int t=0; t<3; t++){
-        if(x[t] >= 0.5){
-          x[t] -= 1.0;
-          floor_nx_j[t] -= ths->n[t];
-        }
-      }
-    }
+    if(shared_psi != NULL)
+      pre_psi = shared_psi;
 
-    /* evaluate window on axes */
-    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
-      pre_psi_tensor(
-          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j,
-          ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+    start = detail_start(times);
+    if(shared_dpsi != NULL)
+      psi_dpsi_tensor_kind(ths, kind, x, floor_nx_j, spline_coeffs,
+          pre_psi, shared_dpsi);
+    else
+      psi_tensor_kind(ths, kind, x, floor_nx_j, spline_coeffs,
           pre_psi);
+    detail_finish(times, PNFFTI_DETAIL_PSI, start);
 
-    /* compute f */
-    INT ind = j*stride + offset;
-    m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
-    if(ths->pnfft_flags & PNFFT_REAL_F)
-      PNX(assign_f_r2r)(
-          ths, p, ths->g2, pre_psi, 2*m0, local_ngc, cutoff, 2, interlaced,
-          f + 2*ind);
-    else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-      PNX(assign_f_r2r)(
-          ths, p, ths->g2, pre_psi, m0, local_ngc, cutoff, 1, interlaced,
-          f + ind);
-    else
-      PNX(assign_f_c2c)(
-          ths, p, (C*)ths->g2, pre_psi, m0, local_ngc, cutoff, interlaced,
-          (C*)f + ind);
+#if PNFFT_ENABLE_DEBUG
+    /* Don't want to use PNX(debug_sum_print) because we are in a loop */
+    for(int t=0; t<3*cutoff; t++)
+      rsum += pnfft_fabs(pre_psi[t]);
+#endif
   }
 
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_LOOP_B]);
-  
-  if(sorted_index != NULL) PNX(free)(sorted_index);
-  if(pre_psi != NULL) PNX(free)(pre_psi);
+  start = detail_start(times);
+  for(int t=0; t<3; t++)
+    u_j[t] -= grid_offset[t];
+
+  m0 = PNFFT_PLAIN_INDEX_3D(u_j, grid_size);
+  if(kind != PNFFTI_PSI_TABLES && (ths->trafo_flag & PNFFTI_TRAFO_C2R))
+    ths->spread_f_r2r_kernel(
+        ths->f[j], pre_psi, m0, grid_size, cutoff, 1,
+        grid);
+  else if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
+    PNX(spread_f_r2r)(
+        ths, p, ths->f[j], pre_psi, m0, grid_size, cutoff, 1, interlaced,
+        grid);
+  else if(ths->howmany > 1)
+    PNX(spread_f_c2c_many)(
+        ths, p, (C*)ths->f + ths->howmany*j, pre_psi, m0, grid_size, cutoff, ths->howmany, interlaced,
+        (C*)grid);
+  else if(use_mixed_precision(ths, interlaced, 0))
+    PNX(spread_f_c2c_single)(
+        ths, p, ((C*)ths->f)[j], pre_psi, m0, grid_size, cutoff, interlaced,
+        (CS*)grid);
+  else if(kind != PNFFTI_PSI_TABLES)
+    ths->spread_f_c2c_kernel(
+        ((C*)ths->f)[j], pre_psi, m0, grid_size, cutoff,
+        (C*)grid);
+  else
+    PNX(spread_f_c2c)(
+        ths, p, ((C*)ths->f)[j], pre_psi, m0, grid_size, cutoff, interlaced,
+        (C*)grid);
+  detail_finish(times, PNFFTI_DETAIL_ACCUMULATE, start);
+
+  return rsum;
 }
 
+/* one trafo loop and one adjoint node per window evaluation */
+#define PNFFT_DEFINE_WINDOW_LOOPS(NAME, KIND)                                        \
+static void gather_nodes_ ## NAME(                                                  \
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,                          \
+    int interlaced, INT *sorted_index, int select,                                  \
+    R *grid, INT *grid_size, const INT *grid_offset,                                \
+    R *spline_coeffs, R *pre_psi, R *pre_dpsi, PNX(shared_psi) *shared,             \
+    R *rsum, R *rsum_derive, double *times                                          \
+    )                                                                               \
+{                                                                                   \
+  gather_nodes_generic(ths, local_no_start, gcells_below, interlaced, sorted_index, \
+      select, grid, grid_size, grid_offset, spline_coeffs, pre_psi, pre_dpsi,      \
+      shared, rsum, rsum_derive, times, KIND);                                      \
+}                                                                                   \
+static R spread_node_ ## NAME(                                                      \
+    PNX(plan) ths, INT p, INT j,                                                    \
+    INT *local_no_start, INT *gcells_below, int interlaced,                         \
+    R *grid, INT *grid_size, const INT *grid_offset,                                \
+    R *spline_coeffs, R *pre_psi, PNX(shared_psi) *shared, double *times            \
+    )                                                                               \
+{                                                                                   \
+  return spread_node_generic(ths, p, j, local_no_start, gcells_below, interlaced,   \
+      grid, grid_size, grid_offset, spline_coeffs, pre_psi, shared, times, KIND);   \
+}
 
+PNFFT_DEFINE_WINDOW_LOOPS(tables,         PNFFTI_PSI_TABLES)
+PNFFT_DEFINE_WINDOW_LOOPS(intpol,         PNFFTI_PSI_INTPOL)
+PNFFT_DEFINE_WINDOW_LOOPS(poly,           PNFFTI_PSI_POLY)
+PNFFT_DEFINE_WINDOW_LOOPS(gaussian,       PNFFTI_PSI_GAUSSIAN)
+PNFFT_DEFINE_WINDOW_LOOPS(fast_gaussian,  PNFFTI_PSI_FAST_GAUSSIAN)
+PNFFT_DEFINE_WINDOW_LOOPS(bspline,        PNFFTI_PSI_BSPLINE)
+PNFFT_DEFINE_WINDOW_LOOPS(sinc_power,     PNFFTI_PSI_SINC_POWER)
+PNFFT_DEFINE_WINDOW_LOOPS(bessel_i0,      PNFFTI_PSI_BESSEL_I0)
+PNFFT_DEFINE_WINDOW_LOOPS(es,             PNFFTI_PSI_ES)
+PNFFT_DEFINE_WINDOW_LOOPS(kaiser_bessel,  PNFFTI_PSI_KAISER_BESSEL)
+
+#define PNFFT_SET_WINDOW_LOOPS(ths, NAME)           \
+  do {                                             \
+    (ths)->gather_nodes_kernel = gather_nodes_ ## NAME; \
+    (ths)->spread_node_kernel  = spread_node_ ## NAME;  \
+  } while(0)
+
+/* Choose the node loops of the window evaluation, must be called again whenever
+ * the plan switches between precomputed and direct window values. */
+static void init_window_loops(
+    PNX(plan) ths
+    )
+{
+  const unsigned flags = ths->pnfft_flags;
+
+  if(flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI))
+    ths->psi_kind = PNFFTI_PSI_TABLES;
+  else if(flags & PNFFT_PRE_INTPOL_PSI)
+    ths->psi_kind = PNFFTI_PSI_INTPOL;
+  else if(flags & PNFFT_PRE_POLY_PSI)
+    ths->psi_kind = PNFFTI_PSI_POLY;
+  else if(flags & PNFFT_WINDOW_GAUSSIAN)
+    ths->psi_kind = (flags & PNFFT_FG_PSI) ? PNFFTI_PSI_FAST_GAUSSIAN : PNFFTI_PSI_GAUSSIAN;
+  else if(flags & PNFFT_WINDOW_BSPLINE)
+    ths->psi_kind = PNFFTI_PSI_BSPLINE;
+  else if(flags & PNFFT_WINDOW_SINC_POWER)
+    ths->psi_kind = PNFFTI_PSI_SINC_POWER;
+  else if(flags & PNFFT_WINDOW_BESSEL_I0)
+    ths->psi_kind = PNFFTI_PSI_BESSEL_I0;
+  else if(flags & PNFFT_WINDOW_ES)
+    ths->psi_kind = PNFFTI_PSI_ES;
+  else
+    ths->psi_kind = PNFFTI_PSI_KAISER_BESSEL;
+
+  switch(ths->psi_kind){
+    case PNFFTI_PSI_TABLES:        PNFFT_SET_WINDOW_LOOPS(ths, tables);        break;
+    case PNFFTI_PSI_INTPOL:        PNFFT_SET_WINDOW_LOOPS(ths, intpol);        break;
+    case PNFFTI_PSI_POLY:          PNFFT_SET_WINDOW_LOOPS(ths, poly);          break;
+    case PNFFTI_PSI_GAUSSIAN:      PNFFT_SET_WINDOW_LOOPS(ths, gaussian);      break;
+    case PNFFTI_PSI_FAST_GAUSSIAN: PNFFT_SET_WINDOW_LOOPS(ths, fast_gaussian); break;
+    case PNFFTI_PSI_BSPLINE:       PNFFT_SET_WINDOW_LOOPS(ths, bspline);       break;
+    case PNFFTI_PSI_SINC_POWER:    PNFFT_SET_WINDOW_LOOPS(ths, sinc_power);    break;
+    case PNFFTI_PSI_BESSEL_I0:     PNFFT_SET_WINDOW_LOOPS(ths, bessel_i0);     break;
+    case PNFFTI_PSI_ES:            PNFFT_SET_WINDOW_LOOPS(ths, es);            break;
+    default:                       PNFFT_SET_WINDOW_LOOPS(ths, kaiser_bessel); break;
+  }
+}
 
+#ifdef PNFFT_OPENMP
+/* Race free multithreaded charge assignment by coloring of grid tiles.
+ * The nodes are binned into tiles of cutoff x cutoff grid points with respect to the
+ * first two dimensions of their lowest summation index. Since each node spreads onto
+ * cutoff consecutive grid points per dimension, two tiles of the same color (same parity
+ * of both tile indices) never touch the same grid point. Therefore, all tiles of one
+ * color are processed concurrently, while the four colors are processed one after another.
+ * The order of the nodes given by sorted_index is preserved within each tile.
+ *
+ * If 'overlap' is set, only the nodes near the block borders are spread onto g2 before
+ * the master thread starts the ghost cell reduction. Meanwhile, the other threads spread
+ * the interior nodes onto a separate copy of the local block, which is added to g2 at the end. */
+static R loop_over_particles_adj_colored(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index, int overlap
+    )
+{
+  const int cutoff = ths->cutoff;
+  const INT no_offset[3] = {0, 0, 0};
+  INT tile_size[3], num_tiles[3], tiles_total;
+  INT *tile_start, *node_in_tile;
+  INT local_no_total_R = ths->howmany * ths->local_no_total;
+  R *g2_local = NULL;
+  R rsum = 0.0;
+  double times[PNFFTI_DETAIL_TIMES] = {0, 0};
+  double *detail = (ths->profile_detail) ? times : NULL;
+
+  /* the last axis is not split */
+  for(int t=0; t<2; t++){
+    tile_size[t] = cutoff;
+    num_tiles[t] = (local_ngc[t] + cutoff - 1) / cutoff;
+  }
+  tile_size[2] = local_ngc[2];
+  num_tiles[2] = 1;
+  tiles_total = num_tiles[0] * num_tiles[1];
+
+  node_in_tile = (INT*) PNX(scratch_malloc)(ths, sizeof(INT) * (size_t) ths->local_M);
+  tile_start   = (INT*) PNX(scratch_malloc)(ths, sizeof(INT) * (size_t) (tiles_total+1));
+  bin_nodes_to_tiles(ths, local_no_start, gcells_below, interlaced, sorted_index, tile_size, num_tiles,
+      tile_start, node_in_tile);
+
+  if(overlap){
+    if( !(ths->trafo_flag & PNFFTI_TRAFO_C2R) )
+      local_no_total_R *= 2;
+    g2_local = (R*) PNX(scratch_malloc)(ths, sizeof(R) * (size_t) local_no_total_R);
+    for(INT k=0; k<local_no_total_R; k++)
+      g2_local[k] = 0;
+  }
 
+  #pragma omp parallel reduction(+:rsum)
+  {
+    R *pre_psi = NULL;
+    R *spline_coeffs = ths->spline_coeffs;
 
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3 * ((interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : 1));
+
+    if(overlap){
+      rsum += spread_tiles(
+          ths, local_no_start, gcells_below, interlaced, sorted_index, PNFFT_NODES_BOUNDARY,
+          tiles_total, num_tiles, tile_start, node_in_tile,
+          ths->g2, local_ngc, no_offset, spline_coeffs, pre_psi, detail);
+
+      /* reduce ghost cells in ring, no barrier at the end of master */
+      #pragma omp master
+      {
+        PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+        reduce_gcells(ths, ths->gcplan, ths->ghosts);
+        PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_GCELLS);
+      }
 
+      rsum += spread_tiles(
+          ths, local_no_start, gcells_below, interlaced, sorted_index, PNFFT_NODES_INTERIOR,
+          tiles_total, num_tiles, tile_start, node_in_tile,
+          g2_local, ths->local_no, gcells_below, spline_coeffs, pre_psi, detail);
+
+      /* add the interior contributions to the reduced local block */
+      #pragma omp for schedule(static)
+      for(INT k=0; k<local_no_total_R; k++)
+        ths->g2[k] += g2_local[k];
+    } else
+      rsum += spread_tiles(
+          ths, local_no_start, gcells_below, interlaced, sorted_index, PNFFT_NODES_ALL,
+          tiles_total, num_tiles, tile_start, node_in_tile,
+          (use_mixed_precision(ths, interlaced, 0)) ? (R*) ths->g2_single : ths->g2,
+          local_ngc, no_offset, spline_coeffs, pre_psi, detail);
+
+    if(pre_psi != NULL) PNX(free)(pre_psi);
+  }
 
+  PNX(scratch_free)(ths, g2_local);
+  PNX(scratch_free)(ths, node_in_tile); PNX(scratch_free)(ths, tile_start);
+  if(detail != NULL)
+    PNX(profile_detail_times)(ths, 1, times);
 
+  return rsum;
+}
 
-void PNX(trafo_B_grad_ad)(
-    PNX(plan) ths, int interlaced
+/* Spread all nodes of subset 'select' color by color. Must be called inside a parallel region.
+ * If 'times' is not NULL, the times of all threads are added to it. */
+static R spread_tiles(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index, int select,
+    INT tiles_total, const INT *num_tiles, const INT *tile_start, const INT *node_in_tile,
+    R *grid, INT *grid_size, const INT *grid_offset,
+    R *spline_coeffs, R *pre_psi, double *times
     )
 {
-  INT *sorted_index = NULL;
-  INT local_no[3], local_no_start[3];
-  INT gcells_below[3], gcells_above[3];
-  INT local_ngc[3];
- 
-  local_size_B(ths,
-      local_no, local_no_start);
-
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g2, local_no[0]*local_no[1]*local_no[2],
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT: Sum of Fourier coefficients before twiddles");
-#endif
-
-  /* perform fftshift */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_SHIFT_INPUT]);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_SHIFT_INPUT]);
+  const int cutoff = ths->cutoff;
+  R rsum = 0.0;
+  psi_block block;
+  double thread_times[PNFFTI_DETAIL_TIMES] = {0, 0}, start;
+  double *detail = (times != NULL) ? thread_times : NULL;
+
+  init_psi_block(ths, 0, &block);
+
+  for(int color=0; color<4; color++){
+    /* implicit barrier at the end of each color */
+    #pragma omp for schedule(dynamic)
+    for(INT k=0; k<tiles_total; k++){
+      if( 2*((k / num_tiles[1]) % 2) + (k % num_tiles[1]) % 2 != color )
+        continue;
+      for(INT q=tile_start[k]; q<tile_start[k+1]; q++){
+        INT p = node_in_tile[q];
+        INT j = (sorted_index) ? sorted_index[2*p+1] : p;
+        INT u_j[3], b = (block.nodes) ? (q - tile_start[k]) % block.nodes : 0;
+        R x[3], floor_nx_j[3];
+
+        /* blocks of consecutive nodes within the tile */
+        if(block.nodes && b == 0){
+          start = detail_start(detail);
+          fill_psi_block(ths, q, (q + block.nodes < tile_start[k+1]) ? block.nodes : tile_start[k+1] - q,
+              node_in_tile, local_no_start, gcells_below, interlaced, sorted_index, spline_coeffs, &block);
+          detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+        }
+        if(block.nodes)
+          pre_psi = block.psi + b*PNFFT_POW3(cutoff);
+
+        if(select != PNFFT_NODES_ALL){
+          project_node_to_local_grid(
+              ths, j, local_no_start, gcells_below, interlaced,
+              x, floor_nx_j, u_j);
+          if( !node_in_subset(select, u_j, gcells_below, ths->local_no, cutoff) )
+            continue;
+        }
 
-  get_size_gcells(ths->m, ths->cutoff, ths->pnfft_flags,
-      gcells_below, gcells_above);
-  local_array_size(local_no, gcells_below, gcells_above,
-      local_ngc);
+        rsum += ths->spread_node_kernel(
+            ths, p, j, local_no_start, gcells_below, interlaced,
+            grid, grid_size, grid_offset, spline_coeffs, pre_psi, ths->shared_psi, detail);
+      }
+    }
+  }
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g2, local_no[0]*local_no[1]*local_no[2],
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT: Sum of Fourier coefficients before ghostcell send");
+  free_psi_block(&block);
+  detail_reduce(thread_times, times);
+  return rsum;
+}
 #endif
 
-  /* send ghost cells in ring */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_GCELLS]);
-  PX(exchange)(ths->gcplan);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_GCELLS]);
+/* Subproblem spreading: the nodes are binned into tiles of spread_tile^3 grid points with respect to
+ * their lowest summation index. Every tile is spread into a small padded buffer of
+ * (spread_tile+cutoff-1)^3 grid points, which stays in cache, and added to the grid in one pass.
+ * The tiles are at least cutoff wide, such that tiles of the same color (parity of all three
+ * tile indices) never add to the same grid point and the eight colors are threaded one after another. */
+static R loop_over_particles_adj_tiled(
+    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
+    int interlaced,
+    INT *sorted_index
+    )
+{
+  const int cutoff = ths->cutoff;
+  INT tile_size[3], num_tiles[3], buffer_size[3], tiles_total = 1, buffer_total;
+  INT *tile_start, *node_in_tile;
+  INT elem = ((ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2) * ((interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : ths->howmany);
+  R rsum = 0.0;
+  double times[PNFFTI_DETAIL_TIMES] = {0, 0};
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g2, PNX(prod_INT)(3, local_ngc),
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT: Sum of Fourier coefficients after ghostcell send");
-#endif  
+  for(int t=0; t<3; t++){
+    tile_size[t]   = PNFFT_MAX(ths->spread_tile, cutoff);
+    num_tiles[t]   = (local_ngc[t] + tile_size[t] - 1) / tile_size[t];
+    buffer_size[t] = tile_size[t] + cutoff - 1;
+    tiles_total   *= num_tiles[t];
+  }
+  buffer_total = elem * PNX(prod_INT)(3, buffer_size);
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
-      "PNFFT: Sum of x before sort");
+  node_in_tile = (INT*) PNX(scratch_malloc)(ths, sizeof(INT) * (size_t) ths->local_M);
+  tile_start   = (INT*) PNX(scratch_malloc)(ths, sizeof(INT) * (size_t) (tiles_total+1));
+  bin_nodes_to_tiles(ths, local_no_start, gcells_below, interlaced, sorted_index, tile_size, num_tiles,
+      tile_start, node_in_tile);
+
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel reduction(+:rsum)
 #endif
+  {
+    R *buffer = (R*) PNX(malloc)(sizeof(R) * (size_t) buffer_total);
+    R *pre_psi = NULL, *pre_psi_block = NULL;
+    R *spline_coeffs = ths->spline_coeffs;
+    psi_block block;
+    double thread_times[PNFFTI_DETAIL_TIMES] = {0, 0}, start;
+    double *detail = (ths->profile_detail) ? thread_times : NULL;
 
-  /* sort indices for better cache handling */
-  if(ths->pnfft_flags & PNFFT_SORT_NODES){
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_SORT_NODES]);
-    sorted_index = (INT*) PNX(malloc)(sizeof(INT) * (size_t) 2*ths->local_M);
-    sort_nodes_for_better_cache_handle(
-        ths->d, ths->n, ths->m, ths->local_M, ths->x,
-        sorted_index);
-    PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_SORT_NODES]);
-  }
+    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
+      pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3 * ((interlaced == PNFFTI_INTERLACED_BATCHED) ? 2 : 1));
+    init_psi_block(ths, 0, &block);
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
-      "PNFFT: Sum of x after sort");
+    for(int color=0; color<8; color++){
+      /* implicit barrier at the end of each color */
+#ifdef PNFFT_OPENMP
+      #pragma omp for schedule(dynamic)
 #endif
+      for(INT k=0; k<tiles_total; k++){
+        INT kt[3], origin[3], a[3];
+
+        kt[0] = k / (num_tiles[1]*num_tiles[2]);
+        kt[1] = (k / num_tiles[2]) % num_tiles[1];
+        kt[2] = k % num_tiles[2];
+        if( 4*(kt[0]%2) + 2*(kt[1]%2) + kt[2]%2 != color || tile_start[k] == tile_start[k+1] )
+          continue;
+        for(int t=0; t<3; t++)
+          origin[t] = kt[t] * tile_size[t];
+
+        for(INT l=0; l<buffer_total; l++)
+          buffer[l] = 0;
+
+        for(INT q=tile_start[k]; q<tile_start[k+1]; q++){
+          INT p = node_in_tile[q];
+          INT j = (sorted_index) ? sorted_index[2*p+1] : p;
+          INT b = (block.nodes) ? (q - tile_start[k]) % block.nodes : 0;
+
+          /* blocks of consecutive nodes within the tile */
+          if(block.nodes && b == 0){
+            start = detail_start(detail);
+            fill_psi_block(ths, q, (q + block.nodes < tile_start[k+1]) ? block.nodes : tile_start[k+1] - q,
+                node_in_tile, local_no_start, gcells_below, interlaced, sorted_index, spline_coeffs, &block);
+            detail_finish(detail, PNFFTI_DETAIL_PSI, start);
+          }
+          pre_psi_block = (block.nodes) ? block.psi + b*PNFFT_POW3(cutoff) : pre_psi;
 
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_trafo[PNFFT_TIMER_LOOP_B]);
-  loop_over_particles_trafo(
-      ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index);
-  PNFFT_FINISH_TIMING(ths->timer_trafo[PNFFT_TIMER_LOOP_B]);
+          rsum += ths->spread_node_kernel(
+              ths, p, j, local_no_start, gcells_below, interlaced,
+              buffer, buffer_size, origin, spline_coeffs, pre_psi_block, ths->shared_psi, detail);
+        }
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->f, ths->local_M,
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT: Sum of f");
+        /* add the padded tile to the grid, rows along the last axis are contiguous in both */
+        start = detail_start(detail);
+        for(a[0]=0; a[0]<buffer_size[0] && origin[0]+a[0]<local_ngc[0]; a[0]++){
+          for(a[1]=0; a[1]<buffer_size[1] && origin[1]+a[1]<local_ngc[1]; a[1]++){
+            INT g[3] = {origin[0]+a[0], origin[1]+a[1], origin[2]};
+            INT length = elem * PNFFT_MIN(buffer_size[2], local_ngc[2] - origin[2]);
+            R *grid_row = ths->g2 + elem * PNFFT_PLAIN_INDEX_3D(g, local_ngc);
+            const R *buffer_row = buffer + elem * ((a[0]*buffer_size[1] + a[1]) * buffer_size[2]);
+
+            for(INT l=0; l<length; l++)
+              grid_row[l] += buffer_row[l];
+          }
+        }
+        detail_finish(detail, PNFFTI_DETAIL_ACCUMULATE, start);
+      }
+    }
 
-  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-    PNX(debug_sum_print_strides)(ths->grad_f, ths->local_M, 3,
-        !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-        "PNFFT: Sum of %dst component of grad_f");
+    PNX(free)(buffer);
+    if(pre_psi != NULL) PNX(free)(pre_psi);
+    free_psi_block(&block);
+    if(detail != NULL)
+      detail_reduce(thread_times, times);
   }
-#endif
-  
-  if(sorted_index != NULL)
-    PNX(free)(sorted_index);
-}
-
 
+  PNX(scratch_free)(ths, node_in_tile); PNX(scratch_free)(ths, tile_start);
+  if(ths->profile_detail)
+    PNX(profile_detail_times)(ths, 1, times);
 
+  return rsum;
+}
 
-void PNX(adjoint_B)(
-    PNX(plan) ths, int interlaced
+/* Stable counting sort of the nodes into tiles of tile_size grid points with respect to their lowest
+ * summation index. The nodes of tile k are node_in_tile[tile_start[k]], ..., node_in_tile[tile_start[k+1]-1]. */
+static void bin_nodes_to_tiles(
+    PNX(plan) ths, INT *local_no_start, INT *gcells_below,
+    int interlaced, INT *sorted_index,
+    const INT *tile_size, const INT *num_tiles,
+    INT *tile_start, INT *node_in_tile
     )
 {
-  INT *sorted_index = NULL;
-  INT local_no[3], local_no_start[3];
-  INT gcells_below[3], gcells_above[3];
-  INT local_ngc[3], local_ngc_total;
+  INT tiles_total = num_tiles[0] * num_tiles[1] * num_tiles[2];
+  INT *tile_of_node = (INT*) PNX(scratch_malloc)(ths, sizeof(INT) * (size_t) ths->local_M);
 
-  local_size_B(ths,
-      local_no, local_no_start);
+  /* compute the tile of every node */
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(INT p=0; p<ths->local_M; p++){
+    INT j = (sorted_index) ? sorted_index[2*p+1] : p;
+    INT u_j[3];
+    R x[3], floor_nx_j[3];
+
+    project_node_to_local_grid(
+        ths, j, local_no_start, gcells_below, interlaced,
+        x, floor_nx_j, u_j);
+    tile_of_node[p] = ((u_j[0] / tile_size[0]) * num_tiles[1] + u_j[1] / tile_size[1]) * num_tiles[2]
+                      + u_j[2] / tile_size[2];
+  }
 
-  get_size_gcells(ths->m, ths->cutoff, ths->pnfft_flags,
-      gcells_below, gcells_above);
-  local_array_size(local_no, gcells_below, gcells_above,
-      local_ngc);
+  for(INT k=0; k<=tiles_total; k++)
+    tile_start[k] = 0;
+  for(INT p=0; p<ths->local_M; p++)
+    tile_start[tile_of_node[p]+1]++;
+  for(INT k=0; k<tiles_total; k++)
+    tile_start[k+1] += tile_start[k];
+  for(INT p=0; p<ths->local_M; p++)
+    node_in_tile[tile_start[tile_of_node[p]]++] = p;
+  for(INT k=tiles_total; k>0; k--)
+    tile_start[k] = tile_start[k-1];
+  tile_start[0] = 0;
+
+  PNX(scratch_free)(ths, tile_of_node);
+}
 
-  local_ngc_total = PNX(prod_INT)(3, local_ngc);
-  if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
-    for(INT k=0; k<local_ngc_total; k++)
-      ths->g2[k] = 0;
-  else
-    for(INT k=0; k<local_ngc_total; k++)
-      ((C*)ths->g2)[k] = 0;
+/* PNFFT_MIXED_PRECISION applies to single field complex plans without PNFFT_PRE_FULL_PSI,
+ * and the gather only to f without gradient. All other cases run in plan precision. */
+static int use_mixed_precision(
+    const PNX(plan) ths, int interlaced, int gather
+    )
+{
+  if( !(ths->pnfft_flags & PNFFT_MIXED_PRECISION) || ths->g2_single == NULL )
+    return 0;
+  if( ths->howmany > 1 || interlaced == PNFFTI_INTERLACED_BATCHED )
+    return 0;
+  if( ths->pnfft_flags & (PNFFT_REAL_F | PNFFT_PRE_FULL_PSI) )
+    return 0;
+  if( gather && (ths->compute_flags & (PNFFT_COMPUTE_GRAD_F | PNFFT_COMPUTE_HESSIAN_F)) )
+    return 0;
+
+  return 1;
+}
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
-      "PNFFT^H: Sum of x before sort");
+static void grid_to_single(
+    const C *grid, INT size,
+    CS *grid_single
+    )
+{
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
 #endif
+  for(INT k=0; k<size; k++)
+    grid_single[k] = (CS) grid[k];
+}
 
-  /* sort indices for better cache handling */
-  if(ths->pnfft_flags & PNFFT_SORT_NODES){
-    PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_SORT_NODES]);
-    sorted_index = (INT*) PNX(malloc)(sizeof(INT) * (size_t) 2*ths->local_M);
-    sort_nodes_for_better_cache_handle(
-        ths->d, ths->n, ths->m, ths->local_M, ths->x,
-        sorted_index);
-    PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_SORT_NODES]);
-  }
-  
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->x, 3*ths->local_M, 0,
-      "PNFFT^H: Sum of x after sort");
-  
-  PNX(debug_sum_print)(ths->f, ths->local_M,
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT^H: Sum of f");
+static void grid_from_single(
+    const CS *grid_single, INT size,
+    C *grid
+    )
+{
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
 #endif
-  
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_LOOP_B]);
-  loop_over_particles_adj(
-      ths, local_no_start, local_ngc, gcells_below, interlaced, sorted_index);
-  /* TODO: - try to optimize for real values inputs
-   *       - combine two r2c FFTs in one c2c FFT
-   *       - problem: with parallel domain decomposition its hard to use Hermitian symmetry in order to restore the two separate FFT outputs */
-//   if(interlaced){
-//     loop_over_particles_adj_interlaced_0(
-//         ths, local_no_start, local_ngc, gcells_below, sorted_index);
-//     loop_over_particles_adj_interlaced_1(
-//         ths, local_no_start, local_ngc, gcells_below, sorted_index);
-//   }
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_LOOP_B]);
+  for(INT k=0; k<size; k++)
+    grid[k] = (C) grid_single[k];
+}
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g2, local_ngc_total,
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT^H: Sum of Fourier coefficients before ghostcell reduce");
-#endif  
+/* The rows of node p are stored in the order of the loops over the nodes,
+ * therefore the static first touch gives every thread the rows of its nodes. */
+static void first_touch_pre_psi(
+    const PNX(plan) ths, size_t bytes_psi, size_t bytes_dpsi
+    )
+{
+  PNX(first_touch)(ths, ths->pre_psi, bytes_psi);
+  PNX(first_touch)(ths, ths->pre_psi_il, bytes_psi);
+  PNX(first_touch)(ths, ths->pre_dpsi, bytes_dpsi);
+  PNX(first_touch)(ths, ths->pre_dpsi_il, bytes_dpsi);
+}
 
-  /* reduce ghost cells in ring */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_GCELLS]);
-  PX(reduce)(ths->gcplan);
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_GCELLS]);
+/* Interior nodes have their support completely within the local block without ghost cells. */
+static int node_in_subset(
+    int select, const INT *u_j, const INT *gcells_below, const INT *local_no, int cutoff
+    )
+{
+  int interior = 1;
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g2, local_no[0]*local_no[1]*local_no[2],
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT^H: Sum of Fourier coefficients after ghostcell reduce");
-#endif
+  if(select == PNFFT_NODES_ALL)
+    return 1;
 
-  /* perform fftshift */
-  PNFFT_START_TIMING(ths->comm_cart, ths->timer_adj[PNFFT_TIMER_SHIFT_INPUT]);
-//   if(ths->pnfft_flags & PNFFT_SHIFTED_IN)
-  PNFFT_FINISH_TIMING(ths->timer_adj[PNFFT_TIMER_SHIFT_INPUT]);
+  for(int t=0; t<3; t++)
+    if( u_j[t] < gcells_below[t] || u_j[t] + cutoff > gcells_below[t] + local_no[t] )
+      interior = 0;
 
-#if PNFFT_ENABLE_DEBUG
-  PNX(debug_sum_print)(ths->g2, local_no[0]*local_no[1]*local_no[2],
-      !(ths->trafo_flag & PNFFTI_TRAFO_C2R),
-      "PNFFT^H: Sum of Fourier coefficients after twiddles");
-#endif
-  
-  if(sorted_index != NULL)
-    PNX(free)(sorted_index);
+  return (select == PNFFT_NODES_INTERIOR) ? interior : !interior;
 }
 
-static void loop_over_particles_trafo(
-    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
-    int interlaced,
-    INT *sorted_index
+#ifdef PNFFT_OPENMP
+/* Overlap ghost cell communication with computation, if there is more than one thread
+ * and the FFT output is distributed over more than one process. */
+static int use_gcells_overlap(
+    const PNX(plan) ths
     )
 {
-  const int cutoff = ths->cutoff;
-  INT j, m0, u_j[3];
-  R floor_nx_j[3];
-  R *pre_psi = NULL, *pre_dpsi = NULL;
-  R x[3];
-#if PNFFT_ENABLE_DEBUG
-  R rsum=0.0, rsum_derive=0.0, grsum, grsum_derive;
+  return (omp_get_max_threads() > 1) && (ths->np[0] * ths->np[1] * ths->np[2] > 1);
+}
 #endif
 
-  if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
-    pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
-    if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
-      pre_dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
+/* Shift x by half the mesh width for interlacing, compute the lowest summation index
+ * with respect to the local grid including ghost cells and fold x back into [-0.5,0.5). */
+static void project_node_to_local_grid(
+    PNX(plan) ths, INT j, INT *local_no_start, INT *gcells_below, int interlaced,
+    R *x, R *floor_nx_j, INT *u_j
+    )
+{
+  for(int t=0; t<3; t++){
+    x[t] = node_coordinate(ths, j, t);
+    if(interlaced)
+      x[t] += 0.5/ths->n[t];
   }
-  for(INT p=0; p<ths->local_M; p++){
-    j = (ths->pnfft_flags & PNFFT_SORT_NODES) ? sorted_index[2*p+1] : p;
-    
-    /* shift x by half the mesh width for interlacing */
-    for(int t=0; t<3; t++){
-      x[t] = ths->x[ths->d*j+t];
-      if(interlaced)
-        x[t] += 0.5/ths->n[t];
-    }
-
-    /* We need to compute the lowest summation index before we fold x back into [-0.5,0.5).
-     * Otherwise u_j may be also folded and gets less than the local offset local_no_start. */
-    lowest_summation_index(
-        ths->n, ths->m, x, local_no_start, gcells_below,
-        floor_nx_j, u_j);
-    
-    /* assure -0.5 <= x < 0.5 */
-    if(interlaced){
-      for(int t=0; t<3; t++){
-        if(x[t] >= 0.5){
-          x[t] -= 1.0;
-          floor_nx_j[t] -= ths->n[t];
-        }
-      }
-    }
 
-    if(ths->compute_flags & PNFFT_COMPUTE_F) {
-      if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-        ths->f[j] = 0;
-      else
-        ((C*)ths->f)[j] = 0;
-    }
-    if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-      if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-        for(int t=0; t<ths->d; t++)
-          ths->grad_f[ths->d*j+t] = 0;
-      else
-        for(int t=0; t<ths->d; t++)
-          ((C*)ths->grad_f)[ths->d*j+t] = 0;
-    }
+  /* We need to compute the lowest summation index before we fold x back into [-0.5,0.5).
+   * Otherwise u_j may be also folded and gets less than the local offset local_no_start. */
+  lowest_summation_index(
+      ths->n, ths->m, x, local_no_start, gcells_below,
+      floor_nx_j, u_j);
 
-    /* evaluate window on axes */
-    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
-      pre_psi_tensor(
-          ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j,
-          ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
-          pre_psi);
-  
-#if PNFFT_ENABLE_DEBUG
-      /* Don't want to use PNX(debug_sum_print) because we are in a loop */
-      for(int t=0; t<3*cutoff; t++)
-        rsum += pnfft_fabs(pre_psi[t]);
-#endif
- 
-      if(ths->compute_flags & (PNFFT_COMPUTE_GRAD_F)){
-        pre_dpsi_tensor(
-            ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j, ths->spline_coeffs,
-            ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_dpsi,
-            pre_psi, ths->pnfft_flags,
-            pre_dpsi);
+  /* the stencil of d < 3 plans has a single point on the axes of length 1 */
+  for(int t=ths->d; t<3; t++)
+    u_j[t] = 0;
 
-#if PNFFT_ENABLE_DEBUG
-        /* Don't want to use PNX(debug_sum_print) because we are in a loop */
-        if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F)
-          for(int t=0; t<3*cutoff; t++)
-            rsum_derive += pnfft_fabs(pre_dpsi[t]);
-#endif
+  /* assure -0.5 <= x < 0.5, the shifted stencil of open axes runs off the grid instead */
+  if(interlaced){
+    for(int t=0; t<3; t++){
+      if(x[t] >= 0.5 && ths->boundary[t] != PNFFT_BOUNDARY_OPEN){
+        x[t] -= 1.0;
+        floor_nx_j[t] -= ths->n[t];
       }
     }
+  }
+}
 
-    m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
-    if(ths->compute_flags & PNFFT_COMPUTE_F 
-       && ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-      /* compute f and grad_f at once */
-      if(ths->pnfft_flags & PNFFT_REAL_F)
-        PNX(assign_f_and_grad_f_r2r)(
-            ths, p, ths->g2, pre_psi, pre_dpsi,
-            2*m0, local_ngc, cutoff, 2, 2, interlaced,
-            ths->f + 2*j, ths->grad_f + 2*3*j);
-      else if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-        PNX(assign_f_and_grad_f_r2r)(
-            ths, p, ths->g2, pre_psi, pre_dpsi,
-            m0, local_ngc, cutoff, 1, 1, interlaced,
-            ths->f + j, ths->grad_f + 3*j);
-      else
-        PNX(assign_f_and_grad_f_c2c)(
-            ths, p, (C*)ths->g2, pre_psi, pre_dpsi,
-            m0, local_ngc, cutoff, interlaced,
-            (C*)ths->f + j, (C*)ths->grad_f + 3*j);
-    } else if(ths->compute_flags & PNFFT_COMPUTE_F){
-      /* compute f */
-      if(ths->trafo_flag & PNFFTI_TRAFO_C2R)
-        PNX(assign_f_r2r)(
-          ths, p, ths->g2, pre_psi, m0, local_ngc, cutoff, 1, interlaced,
-          ths->f + j);
-      else
-        PNX(assign_f_c2c)(
-            ths, p, (C*)ths->g2, pre_psi, m0, local_ngc, cutoff, interlaced,
-            (C*)ths->f + j);
-    } else if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-      /* compute grad_f */
-      PNX(assign_grad_f_c2c)(
-          ths, p, (C*)ths->g2, pre_psi, pre_dpsi,
-          m0, local_ngc, cutoff, interlaced,
-          (C*)ths->grad_f + 3*j);
+/* Get the lowest summation index of the interlaced grid from the non-interlaced one.
+ * The shift by half the mesh width moves the stencil by at most one grid point. */
+static void offset_node_to_interlaced_grid(
+    const PNX(plan) ths, const R *x, const R *floor_nx_j, const INT *u_j,
+    R *x_il, R *floor_nx_il, INT *u_il
+    )
+{
+  for(int t=0; t<3; t++){
+    x_il[t] = x[t] + 0.5/ths->n[t];
+    floor_nx_il[t] = pnfft_floor(ths->n[t]*x_il[t]);
+    u_il[t] = u_j[t] + (INT) (floor_nx_il[t] - floor_nx_j[t]);
+
+    /* assure -0.5 <= x < 0.5 on periodic axes */
+    if(x_il[t] >= 0.5 && ths->boundary[t] != PNFFT_BOUNDARY_OPEN){
+      x_il[t] -= 1.0;
+      floor_nx_il[t] -= ths->n[t];
     }
   }
+}
 
-#if PNFFT_ENABLE_DEBUG
-  MPI_Reduce(&rsum, &grsum, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
-  PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT: Sum of pre_psi: %e\n", grsum);
+/* Compute the start indices m0 and m0_il of node j within both fields of the interleaved grid
+ * (in units of complex for c2c and real for c2r plans) and evaluate the window of both grids, if it is not precomputed. */
+static void prepare_node_interlaced_batched(
+    PNX(plan) ths, INT j, INT *local_no_start, INT *gcells_below,
+    INT *grid_size, const INT *grid_offset, R *spline_coeffs,
+    R *pre_psi, R *pre_psi_il, INT *m0, INT *m0_il
+    )
+{
+  INT u_j[3], u_il[3];
+  R x[3], floor_nx_j[3], x_il[3], floor_nx_il[3];
 
-  if(ths->compute_flags & PNFFT_COMPUTE_GRAD_F){
-    MPI_Reduce(&rsum_derive, &grsum_derive, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
-    PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT: Sum of pre_dpsi: %e\n", grsum_derive);
+  project_node_to_local_grid(
+      ths, j, local_no_start, gcells_below, 0,
+      x, floor_nx_j, u_j);
+  offset_node_to_interlaced_grid(
+      ths, x, floor_nx_j, u_j,
+      x_il, floor_nx_il, u_il);
+
+  if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
+    pre_psi_tensor(
+        ths->n, ths->b, ths->m, ths->cutoff, x, floor_nx_j,
+        ths->exp_const, spline_coeffs, ths->pnfft_flags,
+        ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+        pre_psi);
+    pre_psi_tensor(
+        ths->n, ths->b, ths->m, ths->cutoff, x_il, floor_nx_il,
+        ths->exp_const, spline_coeffs, ths->pnfft_flags,
+        ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
+        pre_psi_il);
+  }
+
+  for(int t=0; t<3; t++){
+    u_j[t]  -= grid_offset[t];
+    u_il[t] -= grid_offset[t];
   }
-#endif
 
-  if(pre_psi != NULL)  PNX(free)(pre_psi);
-  if(pre_dpsi != NULL) PNX(free)(pre_dpsi);
+  *m0    = 2 * PNFFT_PLAIN_INDEX_3D(u_j,  grid_size);
+  *m0_il = 2 * PNFFT_PLAIN_INDEX_3D(u_il, grid_size);
 }
 
-static void loop_over_particles_adj(
-    PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
-    int interlaced,
-    INT *sorted_index
+/* The de Boor algorithm uses spline_coeffs as scratch. Every thread needs its own copy. */
+/* plan time coefficients of PNX(bspline_poly), shared by all threads */
+static void init_spline_coeffs(
+    PNX(plan) ths
     )
 {
-  const int cutoff = ths->cutoff;
-  INT j, m0, u_j[3];
-  R floor_nx_j[3];
-  R *pre_psi = NULL;
-  R x[3];
-#if PNFFT_ENABLE_DEBUG
-  R rsum = 0.0, grsum;
-#endif
-
-  if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
-    pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
-  for(INT p=0; p<ths->local_M; p++){
-    j = (sorted_index) ? sorted_index[2*p+1] : p;
+  const int k = 2*ths->m;
 
-    /* shift x by half the mesh width for interlacing */
-    for(int t=0; t<3; t++){
-      x[t] = ths->x[ths->d*j+t];
-      if(interlaced)
-        x[t] += 0.5/ths->n[t];
-    }
+  if(ths->spline_coeffs != NULL)
+    return;
 
-    /* We need to compute the lowest summation index before we fold x back into [-0.5,0.5).
-     * Otherwise u_j may be also folded and gets less than the local offset local_no_start. */
-    lowest_summation_index(
-        ths->n, ths->m, x, local_no_start, gcells_below,
-        floor_nx_j, u_j);
-
-    /* assure -0.5 <= x < 0.5 */
-    if(interlaced){
-      for(int t=0; t<3; t++){
-        if(x[t] >= 0.5){
-          x[t] -= 1.0;
-          floor_nx_j[t] -= ths->n[t];
-        }
-      }
-    }
+  ths->spline_coeffs = (R*) PNX(malloc)(sizeof(R) * 3 * (size_t) (k*k));
+  PNX(bspline_poly_coeffs)(k, ths->spline_coeffs);
+}
 
-    /* evaluate window on axes */
-    if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
-      pre_psi_tensor(
-          ths->n, ths->b, ths->m, cutoff, x, floor_nx_j,
-          ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-          ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
-          pre_psi);
+/* As many nodes as fit into the budget pre_psi_block_bytes with cutoff^3 window values
+ * (and three times as many derivatives) per node, but at least one. */
+static void init_psi_block(
+    const PNX(plan) ths, int compute_grad_ad,
+    psi_block *block
+    )
+{
+  const INT cutoff3 = PNFFT_POW3(ths->cutoff);
+  const INT node_bytes = (INT) sizeof(R) * cutoff3 * (compute_grad_ad ? 4 : 1);
 
-#if PNFFT_ENABLE_DEBUG
-      /* Don't want to use PNX(debug_sum_print) because we are in a loop */
-      for(int t=0; t<3*cutoff; t++)
-        rsum += pnfft_fabs(pre_psi[t]);
-#endif
-    }
+  block->psi = block->dpsi = block->buffer_psi = block->buffer_dpsi = NULL;
+  block->grad = compute_grad_ad;
+  block->nodes = 0;
+  if( !PNFFT_PRE_PSI_BLOCKED(ths) )
+    return;
 
-    m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
-    if (ths->trafo_flag & PNFFTI_TRAFO_C2R)
-      PNX(spread_f_r2r)(
-          ths, p, ths->f[j], pre_psi, m0, local_ngc, cutoff, 1, interlaced,
-          ths->g2);
-    else
-      PNX(spread_f_c2c)(
-          ths, p, ((C*)ths->f)[j], pre_psi, m0, local_ngc, cutoff, interlaced,
-          (C*)ths->g2);
+  block->nodes = ths->pre_psi_block_bytes / node_bytes;
+  if(block->nodes < 1)
+    block->nodes = 1;
+  if(block->nodes > ths->local_M)
+    block->nodes = (ths->local_M > 0) ? ths->local_M : 1;
+
+  block->psi = (R*) PNX(malloc)(sizeof(R) * (size_t) (block->nodes * cutoff3));
+  block->buffer_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->cutoff*3);
+  if(compute_grad_ad){
+    block->dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) (3 * block->nodes * cutoff3));
+    block->buffer_dpsi = (R*) PNX(malloc)(sizeof(R) * (size_t) ths->cutoff*3);
   }
+}
 
-#if PNFFT_ENABLE_DEBUG
-  MPI_Reduce(&rsum, &grsum, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
-  PX(fprintf)(MPI_COMM_WORLD, stderr, "PNFFT^H: Sum of pre_psi: %e\n", grsum);
-#endif
+/* Evaluate the window tensors of the nodes first, ..., first+count-1 of the sorted order
+ * or, if node_list is given, of the nodes node_list[first], ..., node_list[first+count-1]. */
+static void fill_psi_block(
+    PNX(plan) ths, INT first, INT count, const INT *node_list,
+    INT *local_no_start, INT *gcells_below, int interlaced, INT *sorted_index,
+    R *spline_coeffs, psi_block *block
+    )
+{
+  for(INT k=0; k<count; k++){
+    INT p = (node_list) ? node_list[first+k] : first+k;
+    INT j = (sorted_index) ? sorted_index[2*p+1] : p;
+    INT u_j[3];
+    R x[3], floor_nx_j[3];
+
+    project_node_to_local_grid(
+        ths, j, local_no_start, gcells_below, interlaced,
+        x, floor_nx_j, u_j);
+    precompute_psi(ths, k, x, block->buffer_psi, block->buffer_dpsi, block->grad, spline_coeffs,
+        block->psi, block->dpsi);
+  }
+}
 
-  if(pre_psi != NULL) PNX(free)(pre_psi);
+static void free_psi_block(
+    psi_block *block
+    )
+{
+  if(block->psi != NULL)         PNX(free)(block->psi);
+  if(block->dpsi != NULL)        PNX(free)(block->dpsi);
+  if(block->buffer_psi != NULL)  PNX(free)(block->buffer_psi);
+  if(block->buffer_dpsi != NULL) PNX(free)(block->buffer_dpsi);
 }
 
 
-// /* fill the real part of a complex array with the non-interlaced real valued charge spreading */
-// static void loop_over_particles_adj_interlaced_0(
-//     PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
-//     INT *sorted_index
-//     )
-// {
-//   const int cutoff = ths->cutoff;
-//   INT j, m0, u_j[3];
-//   R floor_nx_j[3];
-//   R *pre_psi = NULL;
-// 
-//   if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
-//     pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
-//   for(INT p=0; p<ths->local_M; p++){
-//     j = (sorted_index) ? sorted_index[2*p+1] : p;
-// 
-//     lowest_summation_index(
-//         ths->n, ths->m, &(ths->x[ths->d*j]), local_no_start, gcells_below,
-//         floor_nx_j, u_j);
-// 
-//     /* evaluate window on axes */
-//     if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
-//       pre_psi_tensor(
-//           ths->n, ths->b, ths->m, cutoff, &(ths->x[ths->d*j]), floor_nx_j,
-//           ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-//           ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
-//           pre_psi);
-//     }
-// 
-//     m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
-//     PNX(spread_f_r2r)(
-//         ths, p, (R)ths->f[j*2], pre_psi, 2*m0, local_ngc, cutoff, 2, 0,
-//         ths->g2);
-//   }
-// 
-//   if(pre_psi != NULL)
-//     PNX(free)(pre_psi);
-// }
-// 
-// /* fill the imaginary part of a complex array with the interlaced real valued charge spreading */
-// static void loop_over_particles_adj_interlaced_1(
-//     PNX(plan) ths, INT *local_no_start, INT *local_ngc, INT *gcells_below,
-//     INT *sorted_index
-//     )
-// {
-//   const int cutoff = ths->cutoff;
-//   INT j, m0, u_j[3];
-//   R floor_nx_j[3];
-//   R *pre_psi = NULL;
-//   R x[3];
-// 
-//   if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) )
-//     pre_psi = (R*) PNX(malloc)(sizeof(R) * (size_t) cutoff*3);
-//   for(INT p=0; p<ths->local_M; p++){
-//     j = (sorted_index) ? sorted_index[2*p+1] : p;
-// 
-//     /* shift x by half the mesh width */
-//     for(int t=0; t<3; t++)
-//       x[t] = ths->x[ths->d*j+t] + 0.5/ths->n[t];
-// 
-//     /* We need to compute the lowest summation index before we fold x back into [-0.5,0.5).
-//      * Otherwise u_j may be also folded and gets less than the local offset local_no_start. */
-//     lowest_summation_index(
-//         ths->n, ths->m, x, local_no_start, gcells_below,
-//         floor_nx_j, u_j);
-// 
-//     /* assure -0.5 <= x < 0.5 */
-//     for(int t=0; t<3; t++){
-//       if(x[t] >= 0.5){
-//         x[t] -= 1.0;
-//         floor_nx_j[t] -= ths->n[t];
-//       }
-//     }
-// 
-//     /* evaluate window on axes */
-//     if( !(ths->pnfft_flags & (PNFFT_PRE_PSI | PNFFT_PRE_FULL_PSI)) ){
-//       pre_psi_tensor(
-//           ths->n, ths->b, ths->m, cutoff, x, floor_nx_j,
-//           ths->exp_const, ths->spline_coeffs, ths->pnfft_flags,
-//           ths->intpol_order, ths->intpol_num_nodes, ths->intpol_tables_psi,
-//           pre_psi);
-//     }
-// 
-//     m0 = PNFFT_PLAIN_INDEX_3D(u_j, local_ngc);
-//     PNX(spread_f_r2r)(
-//         ths, p, (R)ths->f[j*2], pre_psi, 2*m0, local_ngc, cutoff, 2, 0,
-//         ths->g2);
-//   }
-// 
-//   if(pre_psi != NULL)
-//     PNX(free)(pre_psi);
-// }
 
 
 void PNX(scale_ik_diff_c2c)(
@@ -2663,20 +6189,58 @@ void PNX(scale_ik_diff_c2c)(
     C* g1
     )
 {
-  INT k[3], m=0;
+  int t0=0, t1=1, t2=2;
 
+  /* g_hat is transposed N1 x N2 x N0 */
   if(pnfft_flags & PNFFT_TRANSPOSED_F_HAT){
-    /* g_hat is transposed N1 x N2 x N0 */
-    for(k[1]=local_N_start[1]; k[1]<local_N_start[1] + local_N[1]; k[1]++)
-      for(k[2]=local_N_start[2]; k[2]<local_N_start[2] + local_N[2]; k[2]++)
-        for(k[0]=local_N_start[0]; k[0]<local_N_start[0] + local_N[0]; k[0]++, m++)
-          g1[m] = -2*PNFFT_PI * I * k[dim] * g1_buffer[m];
-  } else {
-    /* g_hat is non-transposed N0 x N1 x N2 */
-    for(k[0]=local_N_start[0]; k[0]<local_N_start[0] + local_N[0]; k[0]++)
-      for(k[1]=local_N_start[1]; k[1]<local_N_start[1] + local_N[1]; k[1]++)
-        for(k[2]=local_N_start[2]; k[2]<local_N_start[2] + local_N[2]; k[2]++, m++)
-          g1[m] = -2*PNFFT_PI * I * k[dim] * g1_buffer[m];
+    t0=1; t1=2; t2=0;
+  }
+
+  /* contiguous rows along the fastest axis, the factor is constant along a row unless dim is that axis */
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(INT ks=0; ks<local_N[t0]*local_N[t1]; ks++){
+    const C *in_row = g1_buffer + ks * local_N[t2];
+    C *out_row = g1 + ks * local_N[t2];
+    INT k[3];
+
+    k[t0] = local_N_start[t0] + ks / local_N[t1];
+    k[t1] = local_N_start[t1] + ks % local_N[t1];
+    if(dim == t2){
+      for(INT kf=0; kf<local_N[t2]; kf++)
+        out_row[kf] = -2*PNFFT_PI * I * (local_N_start[t2] + kf) * in_row[kf];
+    } else {
+      const C factor = -2*PNFFT_PI * I * k[dim];
+      for(INT kf=0; kf<local_N[t2]; kf++)
+        out_row[kf] = factor * in_row[kf];
+    }
+  }
+}
+
+/* expand g1 in place to 4 interleaved fields: g, -2 pi i k_0 g, -2 pi i k_1 g, -2 pi i k_2 g.
+ * Loop backwards since field 4m+h overwrites entries with index larger m. */
+void PNX(scale_ik_diff_batched_c2c)(
+    INT *local_N_start, INT *local_N, unsigned pnfft_flags,
+    C* g1
+    )
+{
+  INT k[3], m = local_N[0]*local_N[1]*local_N[2] - 1;
+  int t0=0, t1=1, t2=2;
+  C g;
+
+  /* g_hat is transposed N1 x N2 x N0 */
+  if(pnfft_flags & PNFFT_TRANSPOSED_F_HAT){
+    t0=1; t1=2; t2=0;
   }
+
+  for(k[t0]=local_N_start[t0] + local_N[t0] - 1; k[t0]>=local_N_start[t0]; k[t0]--)
+    for(k[t1]=local_N_start[t1] + local_N[t1] - 1; k[t1]>=local_N_start[t1]; k[t1]--)
+      for(k[t2]=local_N_start[t2] + local_N[t2] - 1; k[t2]>=local_N_start[t2]; k[t2]--, m--){
+        g = g1[m];
+        g1[4*m] = g;
+        for(int t=0; t<3; t++)
+          g1[4*m+1+t] = -2*PNFFT_PI * I * k[t] * g;
+      }
 }
 
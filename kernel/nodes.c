@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Node sets hold everything of a plan that depends on the nodes: x, f, grad_f, the Hessian,
+ * the cached sort,
+ * the precomputed window values, matrix B of PNFFT_SPARSE_B, the particle halo and the
+ * redistribution pattern.
+ * Several node sets share the FFT and ghost cell plans of one plan. Attaching a node set swaps
+ * these fields with the plan, such that all other functions work on the attached nodes.
+ * The node based buffers grow geometrically, if the number of nodes changes. */
+
+#include <string.h>
+#include "pnfft.h"
+#include "ipnfft.h"
+
+#define PNFFT_NODES_MALLOC_FLAGS  (PNFFT_MALLOC_X | PNFFT_MALLOC_F | PNFFT_MALLOC_GRAD_F | PNFFT_MALLOC_HESSIAN_F)
+#define PNFFT_NODES_COMPUTE_FLAGS (PNFFT_COMPUTE_F | PNFFT_COMPUTE_GRAD_F | PNFFT_COMPUTE_HESSIAN_F)
+
+#define PNFFT_SWAP(type, a, b) do { type tmp_ = (a); (a) = (b); (b) = tmp_; } while(0)
+
+struct PNX(nodes_s){
+  INT local_M;                 /**< Number of local nodes                        */
+  INT local_M_capacity;        /**< Number of nodes that fit into x, f, grad_f   */
+  unsigned malloc_flags;       /**< PNFFT_MALLOC_* bits of the own buffers       */
+  unsigned compute_flags;      /**< PNFFT_COMPUTE_* bits of the buffers          */
+  R *x;                        /**< Nodes                                        */
+  R *f;                        /**< Samples                                      */
+  R *grad_f;                   /**< Gradients                                    */
+  R *hessian_f;                /**< Hessians                                     */
+
+  INT *sorted_index;           /**< Cached permutation of the sorted nodes       */
+  int sorted_index_valid;      /**< Flag, if sorted_index fits to the nodes      */
+  int nodes_in_order;          /**< Flag, if the nodes are stored in sorted order */
+  INT *node_order;             /**< Original index of every node after sort_nodes */
+
+  R *pre_psi;                  /**< Precomputed window values                    */
+  R *pre_dpsi;                 /**< Precomputed window derivatives               */
+  R *pre_psi_il;               /**< Precomputed window values, interlaced        */
+  R *pre_dpsi_il;              /**< Precomputed window derivatives, interlaced   */
+  PNX(shared_psi) *shared_psi; /**< Window values of PNX(adj_op_trafo)           */
+  PNX(sparse_b) *sparse_b[2];  /**< Matrix B of PNFFT_SPARSE_B                   */
+  PNX(halo) halo;              /**< Particle halo of PNX(set_halo)               */
+
+  INT redist_M;                /**< Pattern of PNX(redistribute_nodes)           */
+  INT *redist_perm;
+  int *redist_sendcounts;
+  int *redist_senddispls;
+  int *redist_recvcounts;
+  int *redist_recvdispls;
+};
+
+static void swap_nodes(
+    PNX(plan) ths, PNX(nodes) nodes);
+static R* grow_buffer(
+    R *data, INT keep, INT capacity);
+static void free_node_data(
+    PNX(plan) ths);
+
+
+/* Node set of 'local_M' nodes for plan 'ths'. The buffers x, f, grad_f and hessian_f are allocated
+ * as selected by PNFFT_MALLOC_X, PNFFT_MALLOC_F, PNFFT_MALLOC_GRAD_F and PNFFT_MALLOC_HESSIAN_F
+ * of 'malloc_flags'. */
+PNX(nodes) PNX(mknodes)(
+    INT local_M, unsigned malloc_flags, const PNX(plan) ths
+    )
+{
+  PNX(nodes) nodes = (PNX(nodes)) malloc(sizeof(struct PNX(nodes_s)));
+
+  memset(nodes, 0, sizeof(struct PNX(nodes_s)));
+
+  nodes->local_M = nodes->local_M_capacity = local_M;
+  nodes->malloc_flags = malloc_flags & PNFFT_NODES_MALLOC_FLAGS;
+  nodes->compute_flags = malloc_flags & PNFFT_NODES_COMPUTE_FLAGS;
+
+  if(local_M > 0){
+    if(malloc_flags & PNFFT_MALLOC_X)
+      nodes->x = (R*) PNX(malloc)(sizeof(R) * (size_t) (ths->d * local_M));
+    if(malloc_flags & PNFFT_MALLOC_F)
+      nodes->f = (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) (ths->howmany * local_M));
+    if(malloc_flags & PNFFT_MALLOC_GRAD_F)
+      nodes->grad_f = (R*) PNX(malloc)(sizeof(R) * 2 * (size_t) (ths->d * local_M));
+    if(malloc_flags & PNFFT_MALLOC_HESSIAN_F)
+      nodes->hessian_f = (R*) PNX(malloc)(sizeof(R) * 2 * 6 * (size_t) local_M);
+  }
+
+  return nodes;
+}
+
+/* Work on the nodes of 'nodes' from now on, NULL switches back to the nodes of the plan itself.
+ * Every node set keeps its sort and precomputations while another one is attached. */
+void PNX(attach_nodes)(
+    PNX(nodes) nodes, PNX(plan) ths
+    )
+{
+  if(nodes == ths->nodes)
+    return;
+
+  /* swapping twice restores the previous state */
+  if(ths->nodes != NULL)
+    swap_nodes(ths, ths->nodes);
+  if(nodes != NULL)
+    swap_nodes(ths, nodes);
+  ths->nodes = nodes;
+}
+
+PNX(nodes) PNX(get_attached_nodes)(
+    const PNX(plan) ths
+    )
+{
+  return ths->nodes;
+}
+
+/* Free the node set and all its buffers. It must not be attached to 'ths',
+ * which is still needed and therefore finalized afterwards. */
+void PNX(rmnodes)(
+    PNX(nodes) nodes, PNX(plan) ths
+    )
+{
+  if(nodes == NULL)
+    return;
+
+  if(nodes == ths->nodes){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error in PNFFT: Can not free the attached node set !!!\n");
+    return;
+  }
+
+  swap_nodes(ths, nodes);
+  free_node_data(ths);
+  swap_nodes(ths, nodes);
+
+  free(nodes);
+}
+
+/* Change the number of local nodes of the plan or the attached node set. The buffers allocated
+ * by PNFFT keep the values of the first min(old, new) nodes and grow by a factor of 1.5,
+ * if they are too small. Buffers of the user must be replaced by the user.
+ * The sort and all precomputations are released, call PNX(precompute_psi) again. */
+void PNX(set_local_M)(
+    INT local_M, PNX(plan) ths
+    )
+{
+  INT keep = (local_M < ths->local_M) ? local_M : ths->local_M;
+
+  if(local_M < 0)
+    local_M = 0;
+
+  if(local_M > ths->local_M_capacity){
+    INT capacity = ths->local_M_capacity + ths->local_M_capacity / 2;
+
+    if(capacity < local_M)
+      capacity = local_M;
+
+    if(ths->pnfft_flags & PNFFT_MALLOC_X)
+      ths->x = grow_buffer(ths->x, ths->d * keep, ths->d * capacity);
+    if(ths->pnfft_flags & PNFFT_MALLOC_F)
+      ths->f = grow_buffer(ths->f, 2 * ths->howmany * keep, 2 * ths->howmany * capacity);
+    if(ths->pnfft_flags & PNFFT_MALLOC_GRAD_F)
+      ths->grad_f = grow_buffer(ths->grad_f, 2 * ths->d * keep, 2 * ths->d * capacity);
+    if(ths->pnfft_flags & PNFFT_MALLOC_HESSIAN_F)
+      ths->hessian_f = grow_buffer(ths->hessian_f, 2 * 6 * keep, 2 * 6 * capacity);
+    ths->local_M_capacity = capacity;
+  }
+
+  /* also drops the node order of PNX(sort_nodes) and resets nodes_in_order */
+  PNX(free_halo)(ths);
+  PNX(free_sorted_index)(ths);
+  PNX(free_sparse_b)(ths);
+  PNX(free_redistribution)(ths);
+  PNX(free_pre_psi)(ths);
+  ths->local_M = local_M;
+}
+
+INT PNX(get_local_M)(
+    const PNX(plan) ths
+    )
+{
+  return ths->local_M;
+}
+
+
+static void swap_nodes(
+    PNX(plan) ths, PNX(nodes) nodes
+    )
+{
+  unsigned flags;
+
+  PNFFT_SWAP(INT, ths->local_M, nodes->local_M);
+  PNFFT_SWAP(INT, ths->local_M_capacity, nodes->local_M_capacity);
+  PNFFT_SWAP(R*, ths->x, nodes->x);
+  PNFFT_SWAP(R*, ths->f, nodes->f);
+  PNFFT_SWAP(R*, ths->grad_f, nodes->grad_f);
+  PNFFT_SWAP(R*, ths->hessian_f, nodes->hessian_f);
+
+  PNFFT_SWAP(INT*, ths->sorted_index, nodes->sorted_index);
+  PNFFT_SWAP(int, ths->sorted_index_valid, nodes->sorted_index_valid);
+  PNFFT_SWAP(int, ths->nodes_in_order, nodes->nodes_in_order);
+  PNFFT_SWAP(INT*, ths->node_order, nodes->node_order);
+
+  PNFFT_SWAP(R*, ths->pre_psi, nodes->pre_psi);
+  PNFFT_SWAP(R*, ths->pre_dpsi, nodes->pre_dpsi);
+  PNFFT_SWAP(R*, ths->pre_psi_il, nodes->pre_psi_il);
+  PNFFT_SWAP(R*, ths->pre_dpsi_il, nodes->pre_dpsi_il);
+  PNFFT_SWAP(PNX(shared_psi)*, ths->shared_psi, nodes->shared_psi);
+  PNFFT_SWAP(PNX(sparse_b)*, ths->sparse_b[0], nodes->sparse_b[0]);
+  PNFFT_SWAP(PNX(sparse_b)*, ths->sparse_b[1], nodes->sparse_b[1]);
+  PNFFT_SWAP(PNX(halo), ths->halo, nodes->halo);
+
+  PNFFT_SWAP(INT, ths->redist_M, nodes->redist_M);
+  PNFFT_SWAP(INT*, ths->redist_perm, nodes->redist_perm);
+  PNFFT_SWAP(int*, ths->redist_sendcounts, nodes->redist_sendcounts);
+  PNFFT_SWAP(int*, ths->redist_senddispls, nodes->redist_senddispls);
+  PNFFT_SWAP(int*, ths->redist_recvcounts, nodes->redist_recvcounts);
+  PNFFT_SWAP(int*, ths->redist_recvdispls, nodes->redist_recvdispls);
+
+  /* ownership of the buffers and the results that fit into them */
+  flags = ths->pnfft_flags & PNFFT_NODES_MALLOC_FLAGS;
+  ths->pnfft_flags = (ths->pnfft_flags & ~PNFFT_NODES_MALLOC_FLAGS) | nodes->malloc_flags;
+  nodes->malloc_flags = flags;
+
+  flags = ths->compute_flags & PNFFT_NODES_COMPUTE_FLAGS;
+  ths->compute_flags = (ths->compute_flags & ~PNFFT_NODES_COMPUTE_FLAGS) | nodes->compute_flags;
+  nodes->compute_flags = flags;
+}
+
+static R* grow_buffer(
+    R *data, INT keep, INT capacity
+    )
+{
+  R *grown = (capacity > 0) ? (R*) PNX(malloc)(sizeof(R) * (size_t) capacity) : NULL;
+
+  if(data != NULL){
+    if(keep > 0)
+      memcpy(grown, data, sizeof(R) * (size_t) keep);
+    PNX(free)(data);
+  }
+
+  return grown;
+}
+
+/* buffers and precomputations of the nodes that are currently swapped into the plan */
+static void free_node_data(
+    PNX(plan) ths
+    )
+{
+  if((ths->pnfft_flags & PNFFT_MALLOC_X) && ths->x != NULL)
+    PNX(free)(ths->x);
+  if((ths->pnfft_flags & PNFFT_MALLOC_F) && ths->f != NULL)
+    PNX(free)(ths->f);
+  if((ths->pnfft_flags & PNFFT_MALLOC_GRAD_F) && ths->grad_f != NULL)
+    PNX(free)(ths->grad_f);
+  if((ths->pnfft_flags & PNFFT_MALLOC_HESSIAN_F) && ths->hessian_f != NULL)
+    PNX(free)(ths->hessian_f);
+  ths->x = ths->f = ths->grad_f = ths->hessian_f = NULL;
+
+  PNX(free_halo)(ths);
+  PNX(free_sorted_index)(ths);
+  PNX(free_sparse_b)(ths);
+  PNX(free_redistribution)(ths);
+  PNX(free_pre_psi)(ths);
+  PNX(free_shared_psi)(ths);
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Pipelined transforms of several fields on the same nodes. The plan owns a second buffer set
+ * of g1, g2 and their PFFT plans. While a thread runs the PFFT transposes of field k on one set,
+ * the caller's thread runs matrix D of field k+1 and matrix B of field k-1 (trafo), or
+ * matrix B of field k+1 and matrix D of field k-1 (adj) on the other set.
+ * D only touches g1 and B only touches g2, such that both fit into one set. */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+#include "matrix_D.h"
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
+struct PNX(pipe_s){
+  R *g1;                      /**< Input of PFFT of the second set                 */
+  R *g2;                      /**< Output of PFFT of the second set                */
+  PX(plan)   pfft_forw;       /**< Forward PFFT plan of the second set             */
+  PX(plan)   pfft_back;       /**< Backward PFFT plan of the second set            */
+  PX(gcplan) gcplan;          /**< PFFT Ghostcell plan of the second set           */
+};
+
+/* one buffer set, either the grids of the plan or the ones of the pipe */
+typedef struct{
+  R *g1, *g2;
+  PX(plan) pfft_forw, pfft_back;
+  PX(gcplan) gcplan;
+} grid_set;
+
+/* FFT of one field, possibly on a thread */
+typedef struct{
+  PX(plan) pfft;
+  double time;
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+#endif
+  int threaded;
+} fft_task;
+
+static int use_pipeline(
+    const PNX(plan) ths, int num_fields);
+static int use_fft_thread(
+    void);
+static void get_sets(
+    PNX(plan) ths, grid_set *sets);
+static void use_set(
+    PNX(plan) ths, const grid_set *set);
+static void start_fft(
+    PX(plan) pfft, int threaded,
+    fft_task *task);
+static void finish_fft(
+    fft_task *task);
+
+
+/* Forward NFFT of the num_fields fields f_hat[k] into f[k] and, if grad_f != NULL, grad_f[k].
+ * All fields share the nodes of the plan. Plans of real inputs take the real arrays cast to C*.
+ * Plans with PNFFT_INTERLACED, PNFFT_FFT_IN_PLACE or a Fourier-space gradient compute the fields
+ * one after another, as well as processes without MPI_THREAD_MULTIPLE and POSIX threads, which
+ * only keep the order of the steps. Collective. */
+void PNX(trafo_pipelined)(
+    PNX(plan) ths, int num_fields, C **f_hat, C **f, C **grad_f
+    )
+{
+  grid_set sets[2];
+  fft_task task;
+  C *f_hat_plan = ths->f_hat;
+  R *f_plan = ths->f, *grad_f_plan = ths->grad_f;
+  unsigned compute_flags = ths->compute_flags;
+  int threaded = use_fft_thread();
+
+  /* the Hessian is returned by PNX(trafo) only */
+  ths->compute_flags &= ~PNFFT_COMPUTE_HESSIAN_F;
+  if(grad_f == NULL)
+    ths->compute_flags &= ~PNFFT_COMPUTE_GRAD_F;
+
+  if(!use_pipeline(ths, num_fields) || ths->direction == PNFFT_ADJ_ONLY){
+    for(int k=0; k<num_fields; k++){
+      ths->f_hat = f_hat[k];
+      ths->f = (R*) f[k];
+      if(grad_f != NULL)
+        ths->grad_f = (R*) grad_f[k];
+      PNX(trafo)(ths);
+    }
+  } else {
+    PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
+    get_sets(ths, sets);
+
+    /* step s runs F of field s-1 while D of field s and B of field s-2 are computed */
+    for(int s=0; s<num_fields+2; s++){
+      if(s >= 1 && s <= num_fields)
+        start_fft(sets[(s-1)%2].pfft_forw, threaded, &task);
+
+      use_set(ths, &sets[s%2]);
+      if(s < num_fields){
+        ths->f_hat = f_hat[s];
+        PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+        PNX(trafo_D)(ths, 0);
+        PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_D);
+      }
+      if(s >= 2){
+        ths->f = (R*) f[s-2];
+        if(grad_f != NULL)
+          ths->grad_f = (R*) grad_f[s-2];
+        PNFFT_START_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+        PNX(trafo_B_grad_ad)(ths, 0);
+        PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_MATRIX_B);
+      }
+
+      if(s >= 1 && s <= num_fields){
+        finish_fft(&task);
+        ths->timer_trafo[PNFFT_TIMER_MATRIX_F] += task.time;
+      }
+    }
+
+    use_set(ths, &sets[0]);
+    ths->timer_trafo[PNFFT_TIMER_ITER] += num_fields;
+    PNFFT_FINISH_PHASE(ths, ths->timer_trafo, PNFFT_TIMER_WHOLE);
+  }
+
+  ths->f_hat = f_hat_plan;
+  ths->f = f_plan;
+  ths->grad_f = grad_f_plan;
+  ths->compute_flags = compute_flags;
+}
+
+/* Adjoint NFFT of the num_fields fields f[k] into f_hat[k], see PNX(trafo_pipelined). */
+void PNX(adj_pipelined)(
+    PNX(plan) ths, int num_fields, C **f, C **f_hat
+    )
+{
+  grid_set sets[2];
+  fft_task task;
+  C *f_hat_plan = ths->f_hat;
+  R *f_plan = ths->f;
+  int threaded = use_fft_thread();
+
+  if(!use_pipeline(ths, num_fields) || ths->direction == PNFFT_TRAFO_ONLY){
+    for(int k=0; k<num_fields; k++){
+      ths->f = (R*) f[k];
+      ths->f_hat = f_hat[k];
+      PNX(adj)(ths);
+    }
+  } else {
+    PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
+    get_sets(ths, sets);
+
+    /* step s runs F of field s-1 while B of field s and D of field s-2 are computed */
+    for(int s=0; s<num_fields+2; s++){
+      if(s >= 1 && s <= num_fields)
+        start_fft(sets[(s-1)%2].pfft_back, threaded, &task);
+
+      use_set(ths, &sets[s%2]);
+      if(s < num_fields){
+        ths->f = (R*) f[s];
+        PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+        PNX(adjoint_B)(ths, 0);
+        PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_B);
+      }
+      if(s >= 2){
+        ths->f_hat = f_hat[s-2];
+        PNFFT_START_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+        PNX(adjoint_D)(ths, 0);
+        PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_MATRIX_D);
+      }
+
+      if(s >= 1 && s <= num_fields){
+        finish_fft(&task);
+        ths->timer_adj[PNFFT_TIMER_MATRIX_F] += task.time;
+      }
+    }
+
+    use_set(ths, &sets[0]);
+    ths->timer_adj[PNFFT_TIMER_ITER] += num_fields;
+    PNFFT_FINISH_PHASE(ths, ths->timer_adj, PNFFT_TIMER_WHOLE);
+  }
+
+  ths->f_hat = f_hat_plan;
+  ths->f = f_plan;
+}
+
+void PNX(free_pipe)(
+    PNX(plan) ths
+    )
+{
+  PNX(pipe) pipe = ths->pipe;
+
+  if(pipe == NULL)
+    return;
+
+  if(pipe->pfft_forw != NULL)
+    PX(destroy_plan)(pipe->pfft_forw);
+  if(pipe->pfft_back != NULL)
+    PX(destroy_plan)(pipe->pfft_back);
+  PX(destroy_gcplan)(pipe->gcplan);
+  if(pipe->g1 != NULL)
+    PNX(free)(pipe->g1);
+  if(pipe->g2 != NULL)
+    PNX(free)(pipe->g2);
+  free(pipe);
+  ths->pipe = NULL;
+}
+
+
+static int use_pipeline(
+    const PNX(plan) ths, int num_fields
+    )
+{
+  if(num_fields < 2)
+    return 0;
+  if(ths->pnfft_flags & (PNFFT_INTERLACED | PNFFT_FFT_IN_PLACE))
+    return 0;
+  if((ths->pnfft_flags & PNFFT_GRAD_IK) && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F))
+    return 0;
+  return 1;
+}
+
+/* the caller communicates in matrix B while the thread runs the transposes */
+static int use_fft_thread(
+    void
+    )
+{
+#ifdef HAVE_PTHREAD_H
+  int provided;
+
+  MPI_Query_thread(&provided);
+  return provided >= MPI_THREAD_MULTIPLE;
+#else
+  return 0;
+#endif
+}
+
+/* The second set is planned on first use, which is collective. */
+static void get_sets(
+    PNX(plan) ths, grid_set *sets
+    )
+{
+  PNX(pipe) pipe = ths->pipe;
+
+  if(pipe == NULL){
+    pipe = (PNX(pipe)) malloc(sizeof(struct PNX(pipe_s)));
+    pipe->g1 = (R*) PNX(malloc)((size_t) ths->grid_bytes[PNFFTI_GRID_G1]);
+    pipe->g2 = (R*) PNX(malloc)((size_t) ths->grid_bytes[PNFFTI_GRID_G2]);
+    PNX(first_touch)(ths, pipe->g1, (size_t) ths->grid_bytes[PNFFTI_GRID_G1]);
+    PNX(first_touch)(ths, pipe->g2, (size_t) ths->grid_bytes[PNFFTI_GRID_G2]);
+    PNX(plan_grid_fft)(ths, pipe->g1, pipe->g2, ths->comm_cart,
+        &pipe->pfft_forw, &pipe->pfft_back, &pipe->gcplan);
+    ths->pipe = pipe;
+  }
+
+  sets[0].g1 = ths->g1;
+  sets[0].g2 = ths->g2;
+  sets[0].pfft_forw = ths->pfft_forw;
+  sets[0].pfft_back = ths->pfft_back;
+  sets[0].gcplan = ths->gcplan;
+
+  sets[1].g1 = pipe->g1;
+  sets[1].g2 = pipe->g2;
+  sets[1].pfft_forw = pipe->pfft_forw;
+  sets[1].pfft_back = pipe->pfft_back;
+  sets[1].gcplan = pipe->gcplan;
+}
+
+static void use_set(
+    PNX(plan) ths, const grid_set *set
+    )
+{
+  ths->g1 = set->g1;
+  ths->g2 = set->g2;
+  ths->pfft_forw = set->pfft_forw;
+  ths->pfft_back = set->pfft_back;
+  ths->gcplan = set->gcplan;
+}
+
+#ifdef HAVE_PTHREAD_H
+static void* run_fft(
+    void *arg
+    )
+{
+  fft_task *task = (fft_task*) arg;
+
+  task->time = -MPI_Wtime();
+  PX(execute)(task->pfft);
+  task->time += MPI_Wtime();
+  return NULL;
+}
+#endif
+
+/* without a thread the FFT runs right away */
+static void start_fft(
+    PX(plan) pfft, int threaded,
+    fft_task *task
+    )
+{
+  task->pfft = pfft;
+  task->threaded = 0;
+
+#ifdef HAVE_PTHREAD_H
+  if(threaded && pthread_create(&task->thread, NULL, run_fft, task) == 0){
+    task->threaded = 1;
+    return;
+  }
+#endif
+
+  task->time = -MPI_Wtime();
+  PX(execute)(pfft);
+  task->time += MPI_Wtime();
+}
+
+static void finish_fft(
+    fft_task *task
+    )
+{
+#ifdef HAVE_PTHREAD_H
+  if(task->threaded)
+    pthread_join(task->thread, NULL);
+#endif
+  task->threaded = 0;
+}
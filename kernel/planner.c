@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Choose the cutoff m, the FFT grid size n, the window function and the
+ * interpolation order from a target relative error. The error estimates are
+ * the well known a priori bounds of the NFFT approximation error, the costs
+ * are modeled by the number of window evaluations in matrix B and the flops
+ * of the parallel FFT. */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+
+#define PNFFT_PLANNER_MAX_M 20
+
+#define PNFFT_PLANNER_WINDOWS \
+  ((PNFFT_WINDOW_GAUSSIAN| PNFFT_WINDOW_BSPLINE| PNFFT_WINDOW_SINC_POWER| PNFFT_WINDOW_BESSEL_I0| PNFFT_WINDOW_ES))
+
+static const R planner_sigma[] = {1.25, 1.5, 2.0};
+static const unsigned planner_windows[] = {PNFFT_WINDOW_KAISER_BESSEL, PNFFT_WINDOW_ES, PNFFT_WINDOW_GAUSSIAN, PNFFT_WINDOW_BSPLINE};
+
+static R cost_model(
+    int d, const INT *n, INT local_M, int num_procs, int m);
+static void insert_candidate(
+    int d, R cost, const INT *n, int m, unsigned window_flag, int max_num,
+    R *costs, INT *n_cand, int *m_cand, unsigned *window_cand, int *num);
+static int group_by_node(
+    MPI_Comm comm,
+    int *node_of);
+static int procmesh_candidates(
+    int rnk, const INT *n, int size,
+    int *cand);
+static void procmesh_volume(
+    int rnk, const INT *n, int m, int num, const int *cand, MPI_Comm comm,
+    double *vol);
+
+
+/* A priori error estimate of the 1d approximation with oversampling factor sigma. */
+R PNX(window_error_estimate)(
+    unsigned window_flag, int m, R sigma
+    )
+{
+  R s;
+
+  if(sigma <= 1.0)
+    return 1.0;
+
+  if(window_flag & PNFFT_WINDOW_GAUSSIAN)
+    return 4.0 * pnfft_exp( -m * PNFFT_PI * (1.0 - 1.0 / (2.0*sigma - 1.0)) );
+  else if(window_flag & (PNFFT_WINDOW_BSPLINE | PNFFT_WINDOW_SINC_POWER))
+    return 4.0 * pnfft_pow( 1.0 / (2.0*sigma - 1.0), 2.0*m );
+
+  /* Kaiser-Bessel and its relatives Bessel-I0 and ES */
+  s = pnfft_sqrt(1.0 - 1.0/sigma);
+  return 4.0 * PNFFT_PI * (pnfft_sqrt((R)m) + m) * pnfft_sqrt(s) * pnfft_exp( -2.0 * PNFFT_PI * m * s );
+}
+
+/* Shape parameter b of the window for cutoff m and oversampling factor sigma, 1 < sigma <= 2.
+ * The B-spline window has no shape parameter. */
+R PNX(window_shape_parameter)(
+    unsigned window_flag, int m, R sigma
+    )
+{
+  if(window_flag & PNFFT_WINDOW_GAUSSIAN)
+    return ((R)m / PNFFT_PI) * K(2.0)*sigma / (K(2.0)*sigma - K(1.0));
+  else if(window_flag & PNFFT_WINDOW_BSPLINE)
+    return K(0.0);
+  else if(window_flag & PNFFT_WINDOW_SINC_POWER)
+    return (R)m * (K(2.0)*sigma) / (K(2.0)*sigma - K(1.0));
+  else if(window_flag & PNFFT_WINDOW_ES)
+    /* beta = 0.97 * pi * (1 - 1/(2 sigma)) * (2m), the factor 0.97 also holds for low oversampling */
+    return K(0.97) * (R) PNFFT_PI * (K(2.0) - K(1.0)/sigma) * (R)m;
+
+  /* Kaiser-Bessel and Bessel-I0 */
+  return (R) PNFFT_PI * (K(2.0) - K(1.0)/sigma);
+}
+
+/* Taylor rest term of the window interpolation of order 0 <= intpol_order <= 3
+ * with 'num_nodes' interpolation nodes per grid interval. */
+R PNX(intpol_error_estimate)(
+    int intpol_order, INT num_nodes
+    )
+{
+  /* constants of the Taylor rest term and guesses for the derivative bounds */
+  const R c[4] = {1.0, 1.0/8.0, 1.7320508075688772/9.0, 3.0/128.0};
+  const R bound[4] = {2.0, 1.7, 2.2, 1.4};
+
+  if(intpol_order < 0 || intpol_order > 3)
+    return 0.0;
+
+  return c[intpol_order] * bound[intpol_order] * pnfft_pow(1.0 / (R) num_nodes, intpol_order+1);
+}
+
+/* Number of interpolation nodes per interval that is used for the PNFFT_PRE_*_PSI tables. */
+INT PNX(default_intpol_num_nodes)(
+    int cutoff
+    )
+{
+  /* For m=15 we get 1e-15 accuracy with 3rd order interpolation and 2048 interpolation nodes per interval,
+   * which gives a total number of (2*15+1)*2048 interpolation nodes.
+   * Keep the total number of interpolation nodes (2*m+1)*intpol_num_nodes constant for all other 'm'. */
+  return (INT) pnfft_ceil( (2.0*15.0+1.0)/cutoff ) * 2048;
+}
+
+/* Return the lowest interpolation order, whose Taylor rest term stays below eps,
+ * or 0U if direct evaluation of the window is needed. */
+unsigned PNX(intpol_flag_for_accuracy)(
+    int m, R eps
+    )
+{
+  const unsigned flag[4] = {PNFFT_PRE_CONST_PSI, PNFFT_PRE_LIN_PSI, PNFFT_PRE_QUAD_PSI, PNFFT_PRE_CUB_PSI};
+  INT num_nodes = PNX(default_intpol_num_nodes)(2*m+2);
+
+  for(int p=0; p<4; p++)
+    if(PNX(intpol_error_estimate)(p, num_nodes) < 0.1 * eps)
+      return flag[p];
+
+  return 0U;
+}
+
+/* Collect the 'max_num' cheapest parameter sets (n, m, window) that reach the relative error eps,
+ * sorted by increasing modeled costs. Returns the number of found candidates. */
+int PNX(planner_candidates)(
+    int d, const INT *N, R eps, INT local_M, int num_procs,
+    unsigned pnfft_flags, int max_num,
+    INT *n_cand, int *m_cand, unsigned *window_cand
+    )
+{
+  int num = 0;
+  INT n[3];
+  R *costs = (R*) PNX(malloc)(sizeof(R) * (size_t) max_num);
+  int num_windows = sizeof(planner_windows) / sizeof(planner_windows[0]);
+  int num_sigma   = sizeof(planner_sigma) / sizeof(planner_sigma[0]);
+
+  for(int w=0; w<num_windows; w++){
+    /* a window given by the user is never replaced */
+    unsigned window_flag = planner_windows[w];
+    if(pnfft_flags & PNFFT_PLANNER_WINDOWS){
+      if(w > 0) break;
+      window_flag = pnfft_flags & PNFFT_PLANNER_WINDOWS;
+    }
+
+    for(int s=0; s<num_sigma; s++){
+      R sigma_min = planner_sigma[s];
+      for(int t=0; t<d; t++){
+        /* even FFT sizes */
+        n[t] = 2 * (INT) pnfft_ceil( 0.5 * planner_sigma[s] * N[t] );
+        if(n[t] < N[t] + 2) n[t] = N[t] + 2;
+        if((R) n[t] / N[t] < sigma_min) sigma_min = (R) n[t] / N[t];
+      }
+
+      /* smallest m that reaches the accuracy for this sigma */
+      for(int m=1; m<=PNFFT_PLANNER_MAX_M; m++){
+        int fits = 1;
+        for(int t=0; t<d; t++)
+          if(2*m+2 > n[t]) fits = 0;
+        if(!fits)
+          break;
+        if(PNX(window_error_estimate)(window_flag, m, sigma_min) <= eps){
+          insert_candidate(d, cost_model(d, n, local_M, num_procs, m), n, m, window_flag, max_num,
+              costs, n_cand, m_cand, window_cand, &num);
+          break;
+        }
+      }
+    }
+  }
+
+  PNX(free)(costs);
+  return num;
+}
+
+
+/* window evaluations and grid updates of matrix B plus the flops of the parallel FFT */
+static R cost_model(
+    int d, const INT *n, INT local_M, int num_procs, int m
+    )
+{
+  R cutoff_total = 1.0, n_total = 1.0;
+
+  for(int t=0; t<d; t++){
+    cutoff_total *= 2*m+2;
+    n_total *= n[t];
+  }
+
+  return local_M * cutoff_total + 2.5 * n_total / num_procs * pnfft_log2(n_total);
+}
+
+static void insert_candidate(
+    int d, R cost, const INT *n, int m, unsigned window_flag, int max_num,
+    R *costs, INT *n_cand, int *m_cand, unsigned *window_cand, int *num
+    )
+{
+  int pos = *num;
+
+  /* keep the list sorted, ties keep the earlier candidate */
+  while(pos > 0 && costs[pos-1] > cost)
+    pos--;
+  if(pos >= max_num)
+    return;
+
+  for(int i = (*num < max_num) ? *num : max_num-1; i > pos; i--){
+    costs[i] = costs[i-1];
+    m_cand[i] = m_cand[i-1];
+    window_cand[i] = window_cand[i-1];
+    for(int t=0; t<d; t++)
+      n_cand[d*i+t] = n_cand[d*(i-1)+t];
+  }
+
+  costs[pos] = cost;
+  m_cand[pos] = m;
+  window_cand[pos] = window_flag;
+  for(int t=0; t<d; t++)
+    n_cand[d*pos+t] = n[t];
+
+  if(*num < max_num)
+    (*num)++;
+}
+
+/* Choose the process mesh np[0] x ... x np[rnk-1] of all processes of 'comm' that minimizes
+ * the largest share of nodes on one process. The share is estimated by the product of the largest
+ * block shares of the node histograms along the distributed axes, with the default PFFT blocks of
+ * the FFT output. The nodes x are given in [-0.5,0.5)^3. Collective, returns 1 if no mesh fits. */
+int PNX(balanced_procmesh)(
+    int rnk, const INT *n, INT local_M, const R *x, MPI_Comm comm,
+    int *np
+    )
+{
+  int size, found = 0;
+  int cand[3];
+  double best = 2.0, best_shape = 0;
+  double *hist[3];
+  double n_total = 0;
+
+  if(rnk < 1 || rnk > 3)
+    return 1;
+
+  MPI_Comm_size(comm, &size);
+
+  /* global histograms of the nodes along every distributed axis */
+  for(int t=0; t<rnk; t++){
+    double *local_hist = (double*) PNX(malloc)(sizeof(double) * (size_t) n[t]);
+    hist[t] = (double*) PNX(malloc)(sizeof(double) * (size_t) n[t]);
+    for(INT k=0; k<n[t]; k++)
+      local_hist[k] = 0;
+    for(INT j=0; j<local_M; j++){
+      INT k = (INT) pnfft_floor( (x[3*j+t] + 0.5) * n[t] );
+      if(k < 0) k = 0;
+      if(k >= n[t]) k = n[t]-1;
+      local_hist[k] += 1.0;
+    }
+    MPI_Allreduce(local_hist, hist[t], (int) n[t], MPI_DOUBLE, MPI_SUM, comm);
+    PNX(free)(local_hist);
+  }
+  for(INT k=0; k<n[0]; k++)
+    n_total += hist[0][k];
+
+  /* all factorizations of size into rnk factors */
+  for(cand[0]=1; cand[0]<=size; cand[0]++){
+    if(size % cand[0]) continue;
+    for(cand[1]=1; cand[1]<=((rnk > 1) ? size/cand[0] : 1); cand[1]++){
+      double share = 1.0, shape;
+      int fits = 1, np_min = size, np_max = 1;
+
+      if(rnk > 1 && (size/cand[0]) % cand[1]) continue;
+      if(rnk == 1 && cand[0] != size) continue;
+      cand[2] = size / (cand[0] * ((rnk > 1) ? cand[1] : 1));
+      if(rnk == 2 && cand[2] != 1) continue;
+
+      for(int t=0; t<rnk; t++){
+        /* default block of PFFT */
+        INT block = (n[t] + cand[t] - 1) / cand[t];
+        double max_block = 0;
+
+        if(cand[t] > n[t]){
+          fits = 0;
+          break;
+        }
+        for(INT k0=0; k0<n[t]; k0+=block){
+          double sum = 0;
+          for(INT k=k0; k<k0+block && k<n[t]; k++)
+            sum += hist[t][k];
+          if(sum > max_block) max_block = sum;
+        }
+        share *= (n_total > 0) ? max_block / n_total : 1.0 / cand[t];
+
+        if(cand[t] < np_min) np_min = cand[t];
+        if(cand[t] > np_max) np_max = cand[t];
+      }
+      if(!fits)
+        continue;
+
+      /* equal shares prefer the most cubic mesh, i.e., the cheapest FFT communication */
+      shape = (double) np_min / np_max;
+      if(share < best * (1.0 - 1e-12) || (share <= best * (1.0 + 1e-12) && shape > best_shape)){
+        best = share;
+        best_shape = shape;
+        for(int t=0; t<rnk; t++)
+          np[t] = cand[t];
+        found = 1;
+      }
+    }
+  }
+
+  for(int t=0; t<rnk; t++)
+    PNX(free)(hist[t]);
+
+  return !found;
+}
+
+
+
+/* Choose the process mesh np[0] x ... x np[rnk-1] of all processes of 'comm' for the FFT grid
+ * n[0] x n[1] x n[2] and cutoff m that sends the least data between shared memory nodes.
+ * The estimate counts the global transposes of the parallel FFT and the ghost cell faces of
+ * a mesh built by PNX(create_procmesh_topology). Collective, returns 1 if no mesh fits. */
+int PNX(topology_procmesh)(
+    int rnk, const INT *n, int m, MPI_Comm comm,
+    int *np
+    )
+{
+  int size, num, best = -1;
+  int *cand;
+  double *vol;
+
+  if(rnk < 1 || rnk > 3)
+    return 1;
+
+  MPI_Comm_size(comm, &size);
+  num = procmesh_candidates(rnk, n, size, NULL);
+  if(num == 0)
+    return 1;
+
+  cand = (int*) PNX(malloc)(sizeof(int) * (size_t) (3*num));
+  vol = (double*) PNX(malloc)(sizeof(double) * (size_t) (4*num));
+  procmesh_candidates(rnk, n, size, cand);
+  procmesh_volume(rnk, n, m, num, cand, comm, vol);
+
+  /* equal off-node volumes prefer the least total volume */
+  for(int c=0; c<num; c++){
+    double off = vol[4*c+1] + vol[4*c+3], total = vol[4*c] + vol[4*c+2];
+    double best_off, best_total;
+
+    if(best < 0){
+      best = c;
+      continue;
+    }
+    best_off = vol[4*best+1] + vol[4*best+3];
+    best_total = vol[4*best] + vol[4*best+2];
+    if(off < best_off * (1.0 - 1e-12) || (off <= best_off * (1.0 + 1e-12) && total < best_total * (1.0 - 1e-12)))
+      best = c;
+  }
+
+  for(int t=0; t<rnk; t++)
+    np[t] = cand[3*best+t];
+
+  PNX(free)(cand); PNX(free)(vol);
+  return 0;
+}
+
+/* Print the estimated data volumes of all process meshes that PNX(topology_procmesh) considers. */
+void PNX(print_procmesh_volume)(
+    int rnk, const INT *n, int m, MPI_Comm comm
+    )
+{
+  int size, rank, num, node_size;
+  int *cand;
+  double *vol;
+  MPI_Comm comm_node;
+
+  if(rnk < 1 || rnk > 3)
+    return;
+
+  MPI_Comm_size(comm, &size);
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &comm_node);
+  MPI_Comm_size(comm_node, &node_size);
+  MPI_Comm_free(&comm_node);
+
+  num = procmesh_candidates(rnk, n, size, NULL);
+  cand = (int*) PNX(malloc)(sizeof(int) * (size_t) (3*num + 1));
+  vol = (double*) PNX(malloc)(sizeof(double) * (size_t) (4*num + 1));
+  procmesh_candidates(rnk, n, size, cand);
+  procmesh_volume(rnk, n, m, num, cand, comm, vol);
+
+  if(rank == 0){
+    double mib = (double) sizeof(C) / (1024.0 * 1024.0);
+
+    fprintf(stdout, "PNFFT process meshes for %d processes (%d on the node of rank 0), MiB per process and trafo:\n", size, node_size);
+    fprintf(stdout, "%-16s %12s %12s %12s %12s\n", "np", "FFT", "FFT off-node", "ghosts", "ghosts off-node");
+    for(int c=0; c<num; c++){
+      char name[64];
+
+      if(rnk == 1)
+        sprintf(name, "%d", cand[3*c]);
+      else if(rnk == 2)
+        sprintf(name, "%d x %d", cand[3*c], cand[3*c+1]);
+      else
+        sprintf(name, "%d x %d x %d", cand[3*c], cand[3*c+1], cand[3*c+2]);
+      fprintf(stdout, "%-16s %12.4e %12.4e %12.4e %12.4e\n", name,
+          vol[4*c] * mib, vol[4*c+1] * mib, vol[4*c+2] * mib, vol[4*c+3] * mib);
+    }
+    fflush(stdout);
+  }
+
+  PNX(free)(cand); PNX(free)(vol);
+}
+
+/* Same as PNX(create_procmesh), but the ranks of one shared memory node are numbered consecutively
+ * before the mesh is built. Then the last mesh dimensions are filled node by node, as assumed by
+ * PNX(topology_procmesh), independent of the rank order of 'comm'. */
+int PNX(create_procmesh_topology)(
+    int rnk, MPI_Comm comm, const int *np,
+    MPI_Comm *comm_cart
+    )
+{
+  int size, pos, ret;
+  int *node_of;
+  MPI_Comm comm_sorted;
+
+  MPI_Comm_size(comm, &size);
+  node_of = (int*) PNX(malloc)(sizeof(int) * (size_t) size);
+  pos = group_by_node(comm, node_of);
+  PNX(free)(node_of);
+
+  MPI_Comm_split(comm, 0, pos, &comm_sorted);
+  ret = PNX(create_procmesh)(rnk, comm_sorted, np, comm_cart);
+  MPI_Comm_free(&comm_sorted);
+
+  return ret;
+}
+
+
+/* Number the processes of 'comm' node by node, such that the ranks of every shared memory node
+ * are consecutive and keep their order. node_of[pos] is the index of the node of position pos,
+ * the return value is the position of the calling process. */
+static int group_by_node(
+    MPI_Comm comm,
+    int *node_of
+    )
+{
+  int size, rank, leader, num_nodes = 0, pos = 0;
+  int *leaders, *node_index, *node_start;
+  MPI_Comm comm_node;
+
+  MPI_Comm_size(comm, &size);
+  MPI_Comm_rank(comm, &rank);
+
+  /* the smallest rank of every node identifies the node */
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &comm_node);
+  leader = rank;
+  MPI_Bcast(&leader, 1, MPI_INT, 0, comm_node);
+  MPI_Comm_free(&comm_node);
+
+  leaders = (int*) PNX(malloc)(sizeof(int) * (size_t) (3*size));
+  node_index = leaders + size;
+  node_start = node_index + size;
+  MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, comm);
+
+  for(int r=0; r<size; r++){
+    if(leaders[r] == r)
+      node_index[r] = num_nodes++;
+    node_start[r] = 0;
+  }
+
+  /* positions of the first process of every node */
+  for(int r=0; r<size; r++)
+    node_start[node_index[leaders[r]]]++;
+  for(int k=0, sum=0; k<num_nodes; k++){
+    int count = node_start[k];
+    node_start[k] = sum;
+    sum += count;
+  }
+
+  for(int r=0; r<size; r++){
+    int k = node_index[leaders[r]], p = node_start[k]++;
+
+    node_of[p] = k;
+    if(r == rank)
+      pos = p;
+  }
+
+  PNX(free)(leaders);
+  return pos;
+}
+
+/* All factorizations np[0] x ... x np[rnk-1] = size with np[t] <= n[t], stored with stride 3.
+ * Returns their number, only counts them if cand is NULL. */
+static int procmesh_candidates(
+    int rnk, const INT *n, int size,
+    int *cand
+    )
+{
+  int num = 0;
+
+  for(int np0=1; np0<=size; np0++){
+    if(size % np0 || np0 > n[0]) continue;
+    for(int np1=1; np1<=size/np0; np1++){
+      int np2;
+
+      if((size/np0) % np1) continue;
+      np2 = size / (np0 * np1);
+      if(rnk == 1 && np0 != size) continue;
+      if(rnk == 2 && np2 != 1) continue;
+      if(rnk > 1 && np1 > n[1]) continue;
+      if(rnk > 2 && np2 > n[2]) continue;
+
+      if(cand != NULL){
+        cand[3*num] = np0; cand[3*num+1] = np1; cand[3*num+2] = np2;
+      }
+      num++;
+      if(rnk == 1) break;
+    }
+  }
+
+  return num;
+}
+
+/* Data volume in complex numbers that the calling process sends during one trafo: the FFT transposes
+ * and the ghost cell faces, each in total and between nodes. Both transposes of every mesh dimension
+ * (to the transposed layout and back) move the whole local block, the ghost cells of a dimension
+ * are m layers towards the lower and m+1 layers towards the upper neighbor. The results are
+ * the maxima over all processes. */
+static void procmesh_volume(
+    int rnk, const INT *n, int m, int num, const int *cand, MPI_Comm comm,
+    double *vol
+    )
+{
+  int size, pos;
+  int *node_of;
+  double local_fft;
+
+  MPI_Comm_size(comm, &size);
+  node_of = (int*) PNX(malloc)(sizeof(int) * (size_t) size);
+  pos = group_by_node(comm, node_of);
+
+  local_fft = (double) n[0] * (double) n[1] * (double) n[2] / size;
+
+  for(int c=0; c<num; c++){
+    const int *np = cand + 3*c;
+    int coords[3], stride[3];
+    double block[3];
+
+    /* row major order, the last dimension runs fastest */
+    stride[2] = 1; stride[1] = np[2]; stride[0] = np[1]*np[2];
+    for(int t=0; t<3; t++){
+      coords[t] = (pos / stride[t]) % np[t];
+      block[t] = (t < rnk) ? (double) n[t] / np[t] : (double) n[t];
+    }
+
+    for(int k=0; k<4; k++)
+      vol[4*c+k] = 0;
+
+    for(int t=0; t<rnk; t++){
+      int same = 0;
+      double face = block[(t+1)%3] * block[(t+2)%3];
+
+      if(np[t] == 1)
+        continue;
+
+      for(int q=0; q<np[t]; q++)
+        if(node_of[pos + (q - coords[t]) * stride[t]] == node_of[pos])
+          same++;
+      vol[4*c]   += 2.0 * local_fft * (np[t] - 1) / np[t];
+      vol[4*c+1] += 2.0 * local_fft * (np[t] - same) / np[t];
+
+      for(int side=0; side<2; side++){
+        int q = (coords[t] + ((side) ? 1 : np[t]-1)) % np[t];
+        double layers = (side) ? m+1 : m;
+
+        vol[4*c+2] += layers * face;
+        if(node_of[pos + (q - coords[t]) * stride[t]] != node_of[pos])
+          vol[4*c+3] += layers * face;
+      }
+    }
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, vol, 4*num, MPI_DOUBLE, MPI_MAX, comm);
+  PNX(free)(node_of);
+}
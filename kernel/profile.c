@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Per phase profile of trafo, adj and precompute_psi. Every timed phase counts its
+ * time, its calls and an estimate of the bytes it moves through memory or network.
+ * The ghost cell engines and the halo count the bytes they actually send, the ghost cells
+ * of PFFT count the cells that come from other processes. The sub-phases split matrix F,
+ * the ghost cells and loop B.
+ * A user hook is called at the start and the end of every phase, e.g., to open and
+ * close NVTX, ITT or Score-P regions. */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+
+/* layout of the profile array */
+#define PNFFT_PROFILE_TIME  0
+#define PNFFT_PROFILE_CALLS 1
+#define PNFFT_PROFILE_BYTES 2
+#define PNFFT_PROFILE_FIELDS 3
+
+static const char *phase_names[PNFFT_PROFILE_LENGTH] = {
+  "trafo iterations", "trafo whole", "trafo loop B", "trafo sort nodes", "trafo ghost cells",
+  "trafo matrix B", "trafo matrix F", "trafo matrix D", "trafo shift input", "trafo shift output",
+  "adj iterations", "adj whole", "adj loop B", "adj sort nodes", "adj ghost cells",
+  "adj matrix B", "adj matrix F", "adj matrix D", "adj shift input", "adj shift output",
+  "precompute psi",
+  "trafo F remap", "trafo F local", "trafo gc post", "trafo gc wait", "trafo B psi", "trafo B accum",
+  "adj F remap", "adj F local", "adj gc post", "adj gc wait", "adj B psi", "adj B accum"
+};
+
+static double estimate_bytes(
+    const PNX(plan) ths, int phase);
+
+
+double* PNX(mkprofile)(
+    void
+    )
+{
+  double *profile = (double*) malloc(sizeof(double) * PNFFT_PROFILE_FIELDS * PNFFT_PROFILE_LENGTH);
+
+  for(int k=0; k<PNFFT_PROFILE_FIELDS * PNFFT_PROFILE_LENGTH; k++)
+    profile[k] = 0;
+  return profile;
+}
+
+void PNX(rmprofile)(
+    double *profile
+    )
+{
+  if(profile != NULL)
+    free(profile);
+}
+
+void PNX(profile_start)(
+    PNX(plan) ths, int phase
+    )
+{
+  if(ths->profile_hook != NULL)
+    ths->profile_hook(phase, 1, ths->profile_hook_data);
+
+  ths->profile[PNFFT_PROFILE_FIELDS*phase + PNFFT_PROFILE_TIME] -= MPI_Wtime();
+}
+
+void PNX(profile_finish)(
+    PNX(plan) ths, int phase
+    )
+{
+  double *p = ths->profile + PNFFT_PROFILE_FIELDS*phase;
+
+  p[PNFFT_PROFILE_TIME] += MPI_Wtime();
+  p[PNFFT_PROFILE_CALLS] += 1;
+  p[PNFFT_PROFILE_BYTES] += estimate_bytes(ths, phase);
+
+  if(ths->profile_hook != NULL)
+    ths->profile_hook(phase, 0, ths->profile_hook_data);
+}
+
+/* Time and bytes of one call of a sub-phase that is not bracketed by start and finish. */
+void PNX(profile_add)(
+    PNX(plan) ths, int phase, double time, double bytes
+    )
+{
+  double *p = ths->profile + PNFFT_PROFILE_FIELDS*phase;
+
+  p[PNFFT_PROFILE_TIME] += time;
+  p[PNFFT_PROFILE_CALLS] += 1;
+  p[PNFFT_PROFILE_BYTES] += bytes;
+}
+
+/* One ghost cell or halo exchange of trafo or adj, the sent bytes also count for the ghost cells. */
+void PNX(profile_comm)(
+    PNX(plan) ths, int adj, const double *stats
+    )
+{
+  int sub = (adj) ? PNFFT_PROFILE_ADJ_SUB : PNFFT_PROFILE_TRAFO_SUB;
+  int gcells = ((adj) ? PNFFT_PROFILE_ADJ : PNFFT_PROFILE_TRAFO) + PNFFT_TIMER_GCELLS;
+
+  PNX(profile_add)(ths, sub + PNFFT_PROFILE_SUB_GCELLS_POST, stats[PNFFTI_COMM_POST], stats[PNFFTI_COMM_BYTES]);
+  PNX(profile_add)(ths, sub + PNFFT_PROFILE_SUB_GCELLS_WAIT, stats[PNFFTI_COMM_WAIT], 0);
+  ths->profile[PNFFT_PROFILE_FIELDS*gcells + PNFFT_PROFILE_BYTES] += stats[PNFFTI_COMM_BYTES];
+}
+
+/* The window evaluation and the accumulation of one loop B, summed over all threads. */
+void PNX(profile_detail_times)(
+    PNX(plan) ths, int adj, const double *times
+    )
+{
+  int sub = (adj) ? PNFFT_PROFILE_ADJ_SUB : PNFFT_PROFILE_TRAFO_SUB;
+
+  PNX(profile_add)(ths, sub + PNFFT_PROFILE_SUB_PSI, times[PNFFTI_DETAIL_PSI], 0);
+  PNX(profile_add)(ths, sub + PNFFT_PROFILE_SUB_ACCUMULATE, times[PNFFTI_DETAIL_ACCUMULATE], 0);
+}
+
+void PNX(reset_profile)(
+    PNX(plan) ths
+    )
+{
+  for(int k=0; k<PNFFT_PROFILE_FIELDS * PNFFT_PROFILE_LENGTH; k++)
+    ths->profile[k] = 0;
+}
+
+void PNX(set_profile_hook)(
+    PNX(plan) ths, PNX(profile_hook) hook, void *data
+    )
+{
+  ths->profile_hook = hook;
+  ths->profile_hook_data = data;
+}
+
+/* Time the window evaluation and the accumulation of every node in loop B. Costs a few
+ * calls of MPI_Wtime per node, with threads the sub-phases sum up the time of all threads. */
+void PNX(set_profile_detail)(
+    PNX(plan) ths, int detail
+    )
+{
+  ths->profile_detail = (detail != 0);
+}
+
+const char* PNX(get_profile_name)(
+    int phase
+    )
+{
+  if(phase < 0 || phase >= PNFFT_PROFILE_LENGTH)
+    return NULL;
+
+  return phase_names[phase];
+}
+
+/* time, calls and bytes summed over all calls of one phase on the calling process */
+void PNX(get_profile)(
+    const PNX(plan) ths, int phase,
+    double *time, double *calls, double *bytes
+    )
+{
+  const double *p = ths->profile + PNFFT_PROFILE_FIELDS*phase;
+
+  if(time  != NULL) *time  = p[PNFFT_PROFILE_TIME];
+  if(calls != NULL) *calls = p[PNFFT_PROFILE_CALLS];
+  if(bytes != NULL) *bytes = p[PNFFT_PROFILE_BYTES];
+}
+
+/* Minimum, average and maximum time of one phase over all processes of 'comm'.
+ * Collective, the results are valid on all processes. */
+void PNX(reduce_profile)(
+    const PNX(plan) ths, int phase, MPI_Comm comm,
+    double *time_min, double *time_avg, double *time_max
+    )
+{
+  int size;
+  double time = ths->profile[PNFFT_PROFILE_FIELDS*phase + PNFFT_PROFILE_TIME];
+
+  MPI_Comm_size(comm, &size);
+  MPI_Allreduce(&time, time_min, 1, MPI_DOUBLE, MPI_MIN, comm);
+  MPI_Allreduce(&time, time_max, 1, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(&time, time_avg, 1, MPI_DOUBLE, MPI_SUM, comm);
+  *time_avg /= size;
+}
+
+/* Print every phase that was called on any process. The load imbalance is the ratio of
+ * maximum and average time, the bandwidth refers to the average bytes per process. */
+void PNX(print_profile)(
+    const PNX(plan) ths, MPI_Comm comm
+    )
+{
+  int size;
+
+  MPI_Comm_size(comm, &size);
+
+  PX(fprintf)(comm, stdout, "PNFFT profile (time in seconds, bytes per process are estimated, except for the ghost cells):\n");
+  PX(fprintf)(comm, stdout, "%-20s %8s %10s %10s %10s %9s %10s %10s\n",
+      "phase", "calls", "min", "avg", "max", "max/avg", "bytes", "GB/s");
+
+  for(int phase=0; phase<PNFFT_PROFILE_LENGTH; phase++){
+    double calls, bytes, tmin, tavg, tmax, calls_max, bytes_avg;
+
+    PNX(get_profile)(ths, phase, NULL, &calls, &bytes);
+    MPI_Allreduce(&calls, &calls_max, 1, MPI_DOUBLE, MPI_MAX, comm);
+    if(calls_max < 1.0)
+      continue;
+
+    PNX(reduce_profile)(ths, phase, comm, &tmin, &tavg, &tmax);
+    MPI_Allreduce(&bytes, &bytes_avg, 1, MPI_DOUBLE, MPI_SUM, comm);
+    bytes_avg /= size;
+
+    PX(fprintf)(comm, stdout, "%-20s %8.0f %10.3e %10.3e %10.3e %9.2f %10.3e %10.3f\n",
+        phase_names[phase], calls_max, tmin, tavg, tmax,
+        (tavg > 0) ? tmax / tavg : 1.0,
+        bytes_avg, (tavg > 0) ? bytes_avg / tavg * 1e-9 : 0.0);
+  }
+}
+
+
+/* Rough number of bytes that one call of 'phase' reads and writes on the local process.
+ * Phases that only consist of other phases count nothing to avoid double counting,
+ * the ghost cells and the sub-phases add their bytes themselves. */
+static double estimate_bytes(
+    const PNX(plan) ths, int phase
+    )
+{
+  int adj = (phase >= PNFFT_PROFILE_ADJ && phase < PNFFT_PROFILE_PRECOMPUTE_PSI);
+  int slot = phase % PNFFT_TIMER_LENGTH;
+  double elem = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? sizeof(R) : sizeof(C);
+  double cutoff3 = (double) PNFFT_POW3(ths->cutoff);
+  double psi_per_node = 0, no = 1;
+
+  /* blocked full tensors stay in cache */
+  if((ths->pnfft_flags & PNFFT_PRE_FULL_PSI) && !PNFFT_PRE_PSI_BLOCKED(ths))
+    psi_per_node = cutoff3 * sizeof(R);
+  else if(ths->pnfft_flags & PNFFT_PRE_PSI)
+    psi_per_node = 3.0 * ths->cutoff * sizeof(R);
+
+  if(phase == PNFFT_PROFILE_PRECOMPUTE_PSI)
+    return (double) ths->local_M * (3.0 * sizeof(R) + psi_per_node);
+  if(phase >= PNFFT_PROFILE_TRAFO_SUB)
+    return 0;
+
+  for(int t=0; t<3; t++)
+    no *= (double) ths->local_no[t];
+
+  switch(slot){
+    case PNFFT_TIMER_LOOP_B:
+      /* grid values in the support of every node, spreading reads and writes them */
+      return (double) ths->local_M * ths->howmany * elem * (adj ? 2.0 : 1.0) * cutoff3
+          + (double) ths->local_M * (3.0 * sizeof(R) + ths->howmany * elem + psi_per_node);
+    case PNFFT_TIMER_SORT_NODES:
+      return (double) ths->local_M * (3.0 * sizeof(R) + 2.0 * sizeof(INT));
+    case PNFFT_TIMER_MATRIX_F:
+      return 2.0 * no * ths->howmany * sizeof(C);
+    case PNFFT_TIMER_MATRIX_D:
+      return 2.0 * (double) ths->local_N_total * ths->howmany * sizeof(C);
+    default:
+      return 0;
+  }
+}
+
+/* Number of nodes and time of the loop over the nodes in matrix B on every process.
+ * Since the FFT work is evenly distributed, these show the load imbalance caused by the nodes. */
+void PNX(print_load_balance)(
+    const PNX(plan) ths, MPI_Comm comm
+    )
+{
+  int size, rank;
+  double local[3], *all = NULL;
+  const char *names[3] = {"local_M", "trafo loop B", "adj loop B"};
+
+  MPI_Comm_size(comm, &size);
+  MPI_Comm_rank(comm, &rank);
+
+  local[0] = (double) ths->local_M;
+  PNX(get_profile)(ths, PNFFT_PROFILE_TRAFO + PNFFT_TIMER_LOOP_B, &local[1], NULL, NULL);
+  PNX(get_profile)(ths, PNFFT_PROFILE_ADJ + PNFFT_TIMER_LOOP_B, &local[2], NULL, NULL);
+
+  if(rank == 0)
+    all = (double*) malloc(sizeof(double) * 3 * (size_t) size);
+  MPI_Gather(local, 3, MPI_DOUBLE, all, 3, MPI_DOUBLE, 0, comm);
+
+  if(rank == 0){
+    fprintf(stdout, "PNFFT load balance over %d processes:\n", size);
+    fprintf(stdout, "%-14s %12s %12s %12s %9s\n", "", "min", "avg", "max", "max/avg");
+    for(int k=0; k<3; k++){
+      double vmin = all[k], vmax = all[k], vavg = 0;
+      for(int p=0; p<size; p++){
+        if(all[3*p+k] < vmin) vmin = all[3*p+k];
+        if(all[3*p+k] > vmax) vmax = all[3*p+k];
+        vavg += all[3*p+k] / size;
+      }
+      fprintf(stdout, "%-14s %12.4e %12.4e %12.4e %9.2f\n", names[k], vmin, vavg, vmax,
+          (vavg > 0) ? vmax / vavg : 1.0);
+    }
+
+    fprintf(stdout, "%6s %12s %12s %12s\n", "rank", names[0], names[1], names[2]);
+    for(int p=0; p<size; p++)
+      fprintf(stdout, "%6d %12.0f %12.4e %12.4e\n", p, all[3*p], all[3*p+1], all[3*p+2]);
+    fflush(stdout);
+    free(all);
+  }
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Redistribution of arbitrary scattered nodes to the process that owns
+ * the corresponding block of the FFT output. The communication pattern is
+ * stored within the plan, such that repeated trafo and adj with unchanged
+ * nodes only need one MPI_Alltoallv of the samples. */
+
+#include <complex.h>
+#include "pnfft.h"
+#include "ipnfft.h"
+
+static void find_owners(
+    const PNX(plan) ths, INT user_M, const R *user_x,
+    int *owner);
+static INT find_cut(
+    const R *cuts, INT num_cuts, R x);
+static int compare_R(
+    const void *a, const void *b);
+static void exchange_nodes(
+    PNX(plan) ths, int howmany, int backward,
+    R *user_data, R *local_data);
+static void trafo_redistributed(
+    PNX(plan) ths,
+    R *user_f, R *user_grad_f);
+static void adj_redistributed(
+    PNX(plan) ths,
+    const R *user_f);
+
+
+void PNX(redistribute_nodes)(
+    PNX(plan) ths, INT user_M, const R *user_x
+    )
+{
+  int np_total, *owner;
+  INT local_M, *offset;
+  unsigned pnfft_flags, pnfft_finalize_flags;
+
+  /* trafo_redistributed only returns f and grad_f to the user order */
+  if(ths->compute_flags & PNFFT_COMPUTE_HESSIAN_F){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error: PNX(redistribute_nodes) does not support plans with PNFFT_MALLOC_HESSIAN_F !!!\n");
+    return;
+  }
+
+  /* the owners are found from the cuts of three axes */
+  if(ths->d < 3){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error: PNX(redistribute_nodes) does not support plans with d < 3 !!!\n");
+    return;
+  }
+
+  MPI_Comm_size(ths->comm_cart, &np_total);
+
+  PNX(free_redistribution)(ths);
+
+  owner = (user_M > 0) ? PNX(malloc_int)((size_t) user_M) : NULL;
+  find_owners(ths, user_M, user_x,
+      owner);
+
+  /* reallocate the node based arrays that are owned by the plan */
+  pnfft_flags = PNFFT_MALLOC_X | (ths->compute_flags & (PNFFT_COMPUTE_F | PNFFT_COMPUTE_GRAD_F));
+  pnfft_finalize_flags = ths->compute_flags & (PNFFT_COMPUTE_F | PNFFT_COMPUTE_GRAD_F);
+  if(ths->pnfft_flags & PNFFT_MALLOC_X)
+    pnfft_finalize_flags |= PNFFT_FREE_X;
+
+  /* count the nodes for every process */
+  ths->redist_sendcounts = PNX(malloc_int)((size_t) 4 * np_total);
+  ths->redist_senddispls = ths->redist_sendcounts + np_total;
+  ths->redist_recvcounts = ths->redist_sendcounts + 2*np_total;
+  ths->redist_recvdispls = ths->redist_sendcounts + 3*np_total;
+
+  for(int r=0; r<np_total; r++)
+    ths->redist_sendcounts[r] = 0;
+  for(INT j=0; j<user_M; j++)
+    ths->redist_sendcounts[owner[j]]++;
+
+  MPI_Alltoall(ths->redist_sendcounts, 1, MPI_INT, ths->redist_recvcounts, 1, MPI_INT, ths->comm_cart);
+
+  ths->redist_senddispls[0] = ths->redist_recvdispls[0] = 0;
+  for(int r=1; r<np_total; r++){
+    ths->redist_senddispls[r] = ths->redist_senddispls[r-1] + ths->redist_sendcounts[r-1];
+    ths->redist_recvdispls[r] = ths->redist_recvdispls[r-1] + ths->redist_recvcounts[r-1];
+  }
+  local_M = ths->redist_recvdispls[np_total-1] + ths->redist_recvcounts[np_total-1];
+
+  /* position of every user node within the send buffer */
+  ths->redist_perm = (user_M > 0) ? PNX(malloc_INT)((size_t) user_M) : NULL;
+  offset = PNX(malloc_INT)((size_t) np_total);
+  for(int r=0; r<np_total; r++)
+    offset[r] = ths->redist_senddispls[r];
+  for(INT j=0; j<user_M; j++)
+    ths->redist_perm[j] = offset[owner[j]]++;
+  PNX(free)(offset);
+  if(owner != NULL)
+    PNX(free)(owner);
+
+  /* init_nodes frees the old pattern, therefore keep the new one temporarily */
+  {
+    int *counts = ths->redist_sendcounts;
+    INT *perm = ths->redist_perm;
+
+    ths->redist_sendcounts = NULL;
+    ths->redist_perm = NULL;
+    PNX(init_nodes)(ths, local_M, pnfft_flags, pnfft_finalize_flags);
+
+    ths->redist_M = user_M;
+    ths->redist_perm = perm;
+    ths->redist_sendcounts = counts;
+    ths->redist_senddispls = counts + np_total;
+    ths->redist_recvcounts = counts + 2*np_total;
+    ths->redist_recvdispls = counts + 3*np_total;
+  }
+
+  exchange_nodes(ths, ths->d, 0, (R*) user_x, ths->x);
+}
+
+void PNX(trafo_redistributed)(
+    PNX(plan) ths, C *user_f, C *user_grad_f
+    )
+{
+  trafo_redistributed(ths, (R*) user_f, (R*) user_grad_f);
+}
+
+void PNX(trafo_redistributed_real)(
+    PNX(plan) ths, R *user_f, R *user_grad_f
+    )
+{
+  trafo_redistributed(ths, user_f, user_grad_f);
+}
+
+void PNX(adj_redistributed)(
+    PNX(plan) ths, const C *user_f
+    )
+{
+  adj_redistributed(ths, (const R*) user_f);
+}
+
+void PNX(adj_redistributed_real)(
+    PNX(plan) ths, const R *user_f
+    )
+{
+  adj_redistributed(ths, user_f);
+}
+
+/* Move howmany reals per node between the user order and the plan without any transform,
+ * e.g., for the spreading step of the type-3 NFFT. Collective on the plan's comm. */
+void PNX(exchange_redistributed)(
+    PNX(plan) ths, int howmany, int backward,
+    R *user_data, R *local_data
+    )
+{
+  exchange_nodes(ths, howmany, backward, user_data, local_data);
+}
+
+void PNX(free_redistribution)(
+    PNX(plan) ths
+    )
+{
+  /* all counts and displacements share one allocation */
+  if(ths->redist_sendcounts != NULL)
+    PNX(free)(ths->redist_sendcounts);
+  if(ths->redist_perm != NULL)
+    PNX(free)(ths->redist_perm);
+
+  ths->redist_M = 0;
+  ths->redist_perm = NULL;
+  ths->redist_sendcounts = NULL;
+  ths->redist_senddispls = NULL;
+  ths->redist_recvcounts = NULL;
+  ths->redist_recvdispls = NULL;
+}
+
+
+static void trafo_redistributed(
+    PNX(plan) ths,
+    R *user_f, R *user_grad_f
+    )
+{
+  int cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+
+  if(ths->redist_sendcounts == NULL){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error: Call PNX(redistribute_nodes) before PNX(trafo_redistributed) !!!\n");
+    return;
+  }
+
+  PNX(trafo)(ths);
+
+  if((user_f != NULL) && (ths->compute_flags & PNFFT_COMPUTE_F))
+    exchange_nodes(ths, cplx * (int) ths->howmany, 1, user_f, ths->f);
+  if((user_grad_f != NULL) && (ths->compute_flags & PNFFT_COMPUTE_GRAD_F))
+    exchange_nodes(ths, cplx * ths->d, 1, user_grad_f, ths->grad_f);
+}
+
+static void adj_redistributed(
+    PNX(plan) ths,
+    const R *user_f
+    )
+{
+  int cplx = (ths->trafo_flag & PNFFTI_TRAFO_C2R) ? 1 : 2;
+
+  if(ths->redist_sendcounts == NULL){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error: Call PNX(redistribute_nodes) before PNX(adj_redistributed) !!!\n");
+    return;
+  }
+  if( ~ths->compute_flags & PNFFT_COMPUTE_F ){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error: PNX(adj_redistributed) needs a plan with PNFFT_MALLOC_F !!!\n");
+    return;
+  }
+
+  exchange_nodes(ths, cplx * (int) ths->howmany, 0, (R*) user_f, ths->f);
+
+  PNX(adj)(ths);
+}
+
+/* Send howmany reals per node from the user order to the owning processes
+ * (backward=0) or return them to the user order (backward=1). */
+static void exchange_nodes(
+    PNX(plan) ths, int howmany, int backward,
+    R *user_data, R *local_data
+    )
+{
+  INT user_M = ths->redist_M, local_M = ths->local_M;
+  R *user_buffer, *local_buffer;
+  MPI_Datatype node_type;
+
+  MPI_Type_contiguous(howmany, PNFFT_MPI_REAL_TYPE, &node_type);
+  MPI_Type_commit(&node_type);
+
+  user_buffer = (user_M > 0) ? PNX(malloc_R)((size_t) howmany * user_M) : NULL;
+
+  /* pnfft_sort_nodes changes the order of the received nodes */
+  local_buffer = local_data;
+  if(ths->node_order != NULL && local_M > 0)
+    local_buffer = PNX(malloc_R)((size_t) howmany * local_M);
+
+  if(!backward){
+    for(INT j=0; j<user_M; j++)
+      for(int t=0; t<howmany; t++)
+        user_buffer[howmany*ths->redist_perm[j]+t] = user_data[howmany*j+t];
+
+    MPI_Alltoallv(user_buffer, ths->redist_sendcounts, ths->redist_senddispls, node_type,
+        local_buffer, ths->redist_recvcounts, ths->redist_recvdispls, node_type, ths->comm_cart);
+
+    if(local_buffer != local_data)
+      for(INT j=0; j<local_M; j++)
+        for(int t=0; t<howmany; t++)
+          local_data[howmany*j+t] = local_buffer[howmany*ths->node_order[j]+t];
+  } else {
+    if(local_buffer != local_data)
+      for(INT j=0; j<local_M; j++)
+        for(int t=0; t<howmany; t++)
+          local_buffer[howmany*ths->node_order[j]+t] = local_data[howmany*j+t];
+
+    MPI_Alltoallv(local_buffer, ths->redist_recvcounts, ths->redist_recvdispls, node_type,
+        user_buffer, ths->redist_sendcounts, ths->redist_senddispls, node_type, ths->comm_cart);
+
+    for(INT j=0; j<user_M; j++)
+      for(int t=0; t<howmany; t++)
+        user_data[howmany*j+t] = user_buffer[howmany*ths->redist_perm[j]+t];
+  }
+
+  if(local_buffer != local_data)
+    PNX(free)(local_buffer);
+  if(user_buffer != NULL)
+    PNX(free)(user_buffer);
+  MPI_Type_free(&node_type);
+}
+
+/* The node borders of all processes form a tensor grid of cells.
+ * Look up the cell of every node and return the process that owns this cell. */
+static void find_owners(
+    const PNX(plan) ths, INT user_M, const R *user_x,
+    int *owner
+    )
+{
+  int np_total, myrank, *cell_owner;
+  INT num_cuts[3], num_cells, ind[3];
+  R lo[3], up[3], upper[3], *all_lo, *all_up, *cuts[3];
+
+  MPI_Comm_size(ths->comm_cart, &np_total);
+  MPI_Comm_rank(ths->comm_cart, &myrank);
+
+  PNX(node_borders)(ths->n, ths->local_no, ths->local_no_start, ths->x_max,
+      lo, up);
+
+  all_lo = PNX(malloc_R)((size_t) 6 * np_total);
+  all_up = all_lo + 3*np_total;
+  MPI_Allgather(lo, 3, PNFFT_MPI_REAL_TYPE, all_lo, 3, PNFFT_MPI_REAL_TYPE, ths->comm_cart);
+  MPI_Allgather(up, 3, PNFFT_MPI_REAL_TYPE, all_up, 3, PNFFT_MPI_REAL_TYPE, ths->comm_cart);
+
+  /* sorted lower borders and the largest upper border of all non-empty blocks */
+  for(int t=0; t<3; t++){
+    cuts[t] = PNX(malloc_R)((size_t) np_total);
+    num_cuts[t] = 0;
+    upper[t] = -ths->x_max[t];
+    for(int r=0; r<np_total; r++)
+      if(all_lo[3*r+t] < all_up[3*r+t]){
+        cuts[t][num_cuts[t]++] = all_lo[3*r+t];
+        if(all_up[3*r+t] > upper[t])
+          upper[t] = all_up[3*r+t];
+      }
+    qsort(cuts[t], (size_t) num_cuts[t], sizeof(R), compare_R);
+
+    INT k = 0;
+    for(INT i=0; i<num_cuts[t]; i++)
+      if(k == 0 || cuts[t][i] != cuts[t][k-1])
+        cuts[t][k++] = cuts[t][i];
+    num_cuts[t] = (k > 0) ? k : 1;
+    if(k == 0)
+      cuts[t][0] = -ths->x_max[t];
+  }
+
+  num_cells = num_cuts[0] * num_cuts[1] * num_cuts[2];
+  cell_owner = PNX(malloc_int)((size_t) num_cells);
+  for(INT c=0; c<num_cells; c++)
+    cell_owner[c] = -1;
+
+  /* every non-empty block covers all cells between its lower and upper border */
+  for(int r=0; r<np_total; r++){
+    INT start[3], end[3];
+    int empty = 0;
+    for(int t=0; t<3; t++){
+      if( !(all_lo[3*r+t] < all_up[3*r+t]) )
+        empty = 1;
+      start[t] = find_cut(cuts[t], num_cuts[t], all_lo[3*r+t]);
+      for(end[t] = start[t]+1; end[t] < num_cuts[t]; end[t]++)
+        if(cuts[t][end[t]] >= all_up[3*r+t])
+          break;
+    }
+    if(empty)
+      continue;
+
+    for(ind[0]=start[0]; ind[0]<end[0]; ind[0]++)
+      for(ind[1]=start[1]; ind[1]<end[1]; ind[1]++)
+        for(ind[2]=start[2]; ind[2]<end[2]; ind[2]++)
+          cell_owner[PNFFT_PLAIN_INDEX_3D(ind, num_cuts)] = r;
+  }
+
+  /* nodes outside of all blocks stay at the calling process */
+  for(INT j=0; j<user_M; j++){
+    int outside = 0;
+    for(int t=0; t<3; t++){
+      if(user_x[3*j+t] < cuts[t][0] || user_x[3*j+t] >= upper[t])
+        outside = 1;
+      ind[t] = find_cut(cuts[t], num_cuts[t], user_x[3*j+t]);
+    }
+    owner[j] = (outside) ? -1 : cell_owner[PNFFT_PLAIN_INDEX_3D(ind, num_cuts)];
+    if(owner[j] < 0)
+      owner[j] = myrank;
+  }
+
+  PNX(free)(cell_owner);
+  for(int t=0; t<3; t++)
+    PNX(free)(cuts[t]);
+  PNX(free)(all_lo);
+}
+
+/* index of the last cut that is less or equal x, binary search */
+static INT find_cut(
+    const R *cuts, INT num_cuts, R x
+    )
+{
+  INT lo = 0, up = num_cuts;
+
+  while(up - lo > 1){
+    INT mid = (lo + up) / 2;
+    if(cuts[mid] <= x)
+      lo = mid;
+    else
+      up = mid;
+  }
+
+  return lo;
+}
+
+static int compare_R(
+    const void *a, const void *b
+    )
+{
+  R ra = *(const R*) a, rb = *(const R*) b;
+  return (ra > rb) - (ra < rb);
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Inverse NFFT by conjugate gradients on the normal equations, similar to the solver module of NFFT.
+ * CGNR minimizes the weighted residual ||y - A W_hat f_hat||_W, CGNE the weighted error for
+ * consistent samples, where W is the density compensation and W_hat the damping.
+ * All vectors are distributed like f and f_hat of the plan, whose arrays serve as workspace.
+ * Every step consists of one round trip adj -> trafo, that evaluates the window only once. */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+
+struct PNX(solver_s){
+  PNX(plan) mv;                /**< Plan of the transforms                       */
+  unsigned flags;              /**< Flags of the solver                          */
+
+  C *y;                        /**< Samples, local_M                             */
+  C *f_hat_iter;               /**< Current approximation, local_N_total         */
+  C *r_iter;                   /**< Residual vector, local_M                     */
+  C *p_hat_iter;               /**< Search direction, local_N_total              */
+  R *w;                        /**< Weights of the samples                       */
+  R *w_hat;                    /**< Damping factors of the Fourier coefficients  */
+
+  R alpha_iter;                /**< Step size                                    */
+  R beta_iter;                 /**< Step size of the search direction            */
+  R dot_r_iter;                /**< Weighted norm of the residual                */
+  R dot_r_iter_old;            /**< Weighted norm of the previous residual       */
+  R dot_z_hat_iter;            /**< Weighted norm of A^H W r (CGNR)              */
+  R dot_z_hat_iter_old;        /**< Weighted norm of the previous A^H W r (CGNR) */
+  R dot_p_hat_iter;            /**< Weighted norm of the search direction (CGNE) */
+};
+
+static R dot_w(
+    const C *x, const R *w, INT size, MPI_Comm comm);
+static R quotient(
+    R a, R b);
+static void round_trip(
+    PNX(solver) ths, PNX(fourier_op) op);
+static void cgnr_update_direction(
+    C *f_hat, const INT *local_N, const INT *local_N_start, INT howmany, void *data);
+static void cgne_update_direction(
+    C *f_hat, const INT *local_N, const INT *local_N_start, INT howmany, void *data);
+
+
+/* The solver keeps a pointer to 'mv' and overwrites its f_hat and f in every step.
+ * Returns NULL if the plan does not fit. */
+PNX(solver) PNX(init_solver)(
+    PNX(plan) mv, unsigned solver_flags
+    )
+{
+  PNX(solver) ths;
+
+  if(mv == NULL)
+    return NULL;
+
+  if(mv->howmany > 1 || !(mv->trafo_flag & PNFFTI_TRAFO_C2C) || mv->f_hat == NULL || mv->f == NULL){
+    PX(fprintf)(mv->comm_cart, stderr, "!!! Error in PNFFT: The solver needs a complex plan of one field with allocated f_hat and f !!!\n");
+    return NULL;
+  }
+
+  /* default is CGNR */
+  if(!(solver_flags & PNFFT_SOLVER_CGNE))
+    solver_flags |= PNFFT_SOLVER_CGNR;
+  else
+    solver_flags &= ~PNFFT_SOLVER_CGNR;
+
+  ths = (PNX(solver)) malloc(sizeof(struct PNX(solver_s)));
+  ths->mv = mv;
+  ths->flags = solver_flags;
+
+  ths->y          = (C*) PNX(malloc)(sizeof(C) * (size_t) (mv->local_M + 1));
+  ths->r_iter     = (C*) PNX(malloc)(sizeof(C) * (size_t) (mv->local_M + 1));
+  ths->f_hat_iter = (C*) PNX(malloc)(sizeof(C) * (size_t) (mv->local_N_total + 1));
+  ths->p_hat_iter = (C*) PNX(malloc)(sizeof(C) * (size_t) (mv->local_N_total + 1));
+
+  for(INT j=0; j<mv->local_M; j++)
+    ths->y[j] = ths->r_iter[j] = 0;
+  for(INT k=0; k<mv->local_N_total; k++)
+    ths->f_hat_iter[k] = ths->p_hat_iter[k] = 0;
+
+  /* weights default to one */
+  ths->w = ths->w_hat = NULL;
+  if(solver_flags & PNFFT_SOLVER_PRECOMPUTE_WEIGHT){
+    ths->w = (R*) PNX(malloc)(sizeof(R) * (size_t) (mv->local_M + 1));
+    for(INT j=0; j<mv->local_M; j++)
+      ths->w[j] = 1;
+  }
+  if(solver_flags & PNFFT_SOLVER_PRECOMPUTE_DAMP){
+    ths->w_hat = (R*) PNX(malloc)(sizeof(R) * (size_t) (mv->local_N_total + 1));
+    for(INT k=0; k<mv->local_N_total; k++)
+      ths->w_hat[k] = 1;
+  }
+
+  ths->alpha_iter = ths->beta_iter = 0;
+  ths->dot_r_iter = ths->dot_r_iter_old = 0;
+  ths->dot_z_hat_iter = ths->dot_z_hat_iter_old = 0;
+  ths->dot_p_hat_iter = 0;
+
+  return ths;
+}
+
+/* Residual of the initial guess f_hat_iter, call after y, w and w_hat are set. Collective. */
+void PNX(solver_before_loop)(
+    PNX(solver) ths
+    )
+{
+  PNX(plan) mv = ths->mv;
+  C *f = (C*) mv->f;
+
+  for(INT k=0; k<mv->local_N_total; k++)
+    mv->f_hat[k] = ths->f_hat_iter[k];
+  PNX(trafo)(mv);
+
+  for(INT j=0; j<mv->local_M; j++)
+    ths->r_iter[j] = ths->y[j] - f[j];
+  ths->dot_r_iter = dot_w(ths->r_iter, ths->w, mv->local_M, mv->comm_cart);
+  ths->dot_r_iter_old = 0;
+
+  /* the first step starts a new search direction */
+  ths->beta_iter = 0;
+  ths->dot_z_hat_iter = ths->dot_z_hat_iter_old = 0;
+  ths->dot_p_hat_iter = 0;
+}
+
+/* One iteration of CGNR or CGNE. Collective. */
+void PNX(solver_loop_one_step)(
+    PNX(solver) ths
+    )
+{
+  PNX(plan) mv = ths->mv;
+  C *v = (C*) mv->f;
+  R dot_v;
+
+  if(ths->flags & PNFFT_SOLVER_CGNE){
+    /* p_hat, alpha and f_hat_iter are updated between adj and trafo */
+    round_trip(ths, cgne_update_direction);
+
+    for(INT j=0; j<mv->local_M; j++)
+      ths->r_iter[j] -= ths->alpha_iter * v[j];
+    ths->dot_r_iter_old = ths->dot_r_iter;
+    ths->dot_r_iter = dot_w(ths->r_iter, ths->w, mv->local_M, mv->comm_cart);
+    ths->beta_iter = quotient(ths->dot_r_iter, ths->dot_r_iter_old);
+  } else {
+    /* p_hat follows z_hat = A^H W r between adj and trafo, afterwards v = A W_hat p_hat */
+    round_trip(ths, cgnr_update_direction);
+
+    dot_v = dot_w(v, ths->w, mv->local_M, mv->comm_cart);
+    ths->alpha_iter = quotient(ths->dot_z_hat_iter, dot_v);
+
+    for(INT k=0; k<mv->local_N_total; k++)
+      ths->f_hat_iter[k] += ths->alpha_iter * ((ths->w_hat) ? ths->w_hat[k] : 1) * ths->p_hat_iter[k];
+    for(INT j=0; j<mv->local_M; j++)
+      ths->r_iter[j] -= ths->alpha_iter * v[j];
+    ths->dot_r_iter_old = ths->dot_r_iter;
+    ths->dot_r_iter = dot_w(ths->r_iter, ths->w, mv->local_M, mv->comm_cart);
+  }
+}
+
+void PNX(finalize_solver)(
+    PNX(solver) ths
+    )
+{
+  if(ths == NULL)
+    return;
+
+  PNX(free)(ths->y);
+  PNX(free)(ths->r_iter);
+  PNX(free)(ths->f_hat_iter);
+  PNX(free)(ths->p_hat_iter);
+  if(ths->w != NULL)
+    PNX(free)(ths->w);
+  if(ths->w_hat != NULL)
+    PNX(free)(ths->w_hat);
+
+  free(ths);
+}
+
+C* PNX(solver_get_y)(
+    const PNX(solver) ths
+    )
+{
+  return ths->y;
+}
+
+C* PNX(solver_get_f_hat_iter)(
+    const PNX(solver) ths
+    )
+{
+  return ths->f_hat_iter;
+}
+
+/* NULL without PNFFT_SOLVER_PRECOMPUTE_WEIGHT */
+R* PNX(solver_get_w)(
+    const PNX(solver) ths
+    )
+{
+  return ths->w;
+}
+
+/* NULL without PNFFT_SOLVER_PRECOMPUTE_DAMP */
+R* PNX(solver_get_w_hat)(
+    const PNX(solver) ths
+    )
+{
+  return ths->w_hat;
+}
+
+/* squared weighted norm of the residual, equal on all processes */
+R PNX(solver_get_dot_r_iter)(
+    const PNX(solver) ths
+    )
+{
+  return ths->dot_r_iter;
+}
+
+INT PNX(solver_get_memory)(
+    const PNX(solver) ths
+    )
+{
+  INT bytes = 2 * (ths->mv->local_M + ths->mv->local_N_total) * (INT) sizeof(C);
+
+  if(ths->w != NULL)     bytes += ths->mv->local_M * (INT) sizeof(R);
+  if(ths->w_hat != NULL) bytes += ths->mv->local_N_total * (INT) sizeof(R);
+
+  return bytes;
+}
+
+
+/* sum of w[j] |x[j]|^2 over all processes, w == NULL means unit weights */
+static R dot_w(
+    const C *x, const R *w, INT size, MPI_Comm comm
+    )
+{
+  R local = 0, global;
+
+#ifdef PNFFT_OPENMP
+  #pragma omp parallel for reduction(+:local)
+#endif
+  for(INT j=0; j<size; j++){
+    R abs2 = pnfft_creal(x[j]) * pnfft_creal(x[j]) + pnfft_cimag(x[j]) * pnfft_cimag(x[j]);
+    local += (w != NULL) ? w[j] * abs2 : abs2;
+  }
+
+  MPI_Allreduce(&local, &global, 1, PNFFT_MPI_REAL_TYPE, MPI_SUM, comm);
+  return global;
+}
+
+/* a vanishing denominator means the iteration converged, stay at the current approximation */
+static R quotient(
+    R a, R b
+    )
+{
+  return (b > 0) ? a / b : 0;
+}
+
+/* f = W r, f_hat = A^H f, op updates the search direction, f = A f_hat */
+static void round_trip(
+    PNX(solver) ths, PNX(fourier_op) op
+    )
+{
+  PNX(plan) mv = ths->mv;
+  C *f = (C*) mv->f;
+
+  for(INT j=0; j<mv->local_M; j++)
+    f[j] = (ths->w) ? ths->w[j] * ths->r_iter[j] : ths->r_iter[j];
+
+  PNX(adj_op_trafo)(mv, NULL, op, ths);
+}
+
+/* f_hat = z_hat = A^H W r on input, W_hat p_hat on output */
+static void cgnr_update_direction(
+    C *f_hat, const INT *local_N, const INT *local_N_start, INT howmany, void *data
+    )
+{
+  PNX(solver) ths = (PNX(solver)) data;
+  const INT local_N_total = ths->mv->local_N_total;
+
+  ths->dot_z_hat_iter_old = ths->dot_z_hat_iter;
+  ths->dot_z_hat_iter = dot_w(f_hat, ths->w_hat, local_N_total, ths->mv->comm_cart);
+  ths->beta_iter = quotient(ths->dot_z_hat_iter, ths->dot_z_hat_iter_old);
+
+  for(INT k=0; k<local_N_total; k++){
+    ths->p_hat_iter[k] = f_hat[k] + ths->beta_iter * ths->p_hat_iter[k];
+    f_hat[k] = (ths->w_hat) ? ths->w_hat[k] * ths->p_hat_iter[k] : ths->p_hat_iter[k];
+  }
+
+  /* unused */
+  (void) local_N; (void) local_N_start; (void) howmany;
+}
+
+/* f_hat = A^H W r on input, W_hat p_hat on output */
+static void cgne_update_direction(
+    C *f_hat, const INT *local_N, const INT *local_N_start, INT howmany, void *data
+    )
+{
+  PNX(solver) ths = (PNX(solver)) data;
+  const INT local_N_total = ths->mv->local_N_total;
+
+  for(INT k=0; k<local_N_total; k++)
+    ths->p_hat_iter[k] = f_hat[k] + ths->beta_iter * ths->p_hat_iter[k];
+  ths->dot_p_hat_iter = dot_w(ths->p_hat_iter, ths->w_hat, local_N_total, ths->mv->comm_cart);
+  ths->alpha_iter = quotient(ths->dot_r_iter, ths->dot_p_hat_iter);
+
+  for(INT k=0; k<local_N_total; k++){
+    f_hat[k] = (ths->w_hat) ? ths->w_hat[k] * ths->p_hat_iter[k] : ths->p_hat_iter[k];
+    ths->f_hat_iter[k] += ths->alpha_iter * f_hat[k];
+  }
+
+  /* unused */
+  (void) local_N; (void) local_N_start; (void) howmany;
+}
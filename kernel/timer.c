@@ -110,6 +110,7 @@ void PNX(reset_timer)(
 {
   timer_reset(ths->timer_trafo);
   timer_reset(ths->timer_adj);
+  PNX(reset_profile)(ths);
 }
 
 static void timer_reset(
@@ -165,8 +166,10 @@ void PNX(write_average_timer_adv)(
   f = open_or_create_file_to_append(comm, name);
   fprint_average_timer(comm, f, ths, PNFFT_PRINT_TIMER_ADV);
   fclose(f);
-  PX(write_average_timer_adv)(ths->pfft_forw, name, comm);
-  PX(write_average_timer_adv)(ths->pfft_back, name, comm);
+  if(ths->pfft_forw != NULL)
+    PX(write_average_timer_adv)(ths->pfft_forw, name, comm);
+  if(ths->pfft_back != NULL)
+    PX(write_average_timer_adv)(ths->pfft_back, name, comm);
   PX(write_average_gctimer_adv)(ths->gcplan, name, comm);
 }
 
@@ -185,8 +188,10 @@ void PNX(print_average_timer_adv)(
 {
   PNX(print_average_timer)(ths, comm);
   fprint_average_timer(comm, stdout, ths, PNFFT_PRINT_TIMER_ADV);
-  PX(print_average_timer_adv)(ths->pfft_forw, comm);
-  PX(print_average_timer_adv)(ths->pfft_back, comm);
+  if(ths->pfft_forw != NULL)
+    PX(print_average_timer_adv)(ths->pfft_forw, comm);
+  if(ths->pfft_back != NULL)
+    PX(print_average_timer_adv)(ths->pfft_back, comm);
   PX(print_average_gctimer_adv)(ths->gcplan, comm);
 }
 
@@ -254,6 +259,8 @@ static void write_run_specific_infos(
     PX(fprintf)(comm, file, "%% pnfft_flags == PNFFT_WINDOW_SINC_POWER");
   else if(ths->pnfft_flags & PNFFT_WINDOW_BESSEL_I0)
     PX(fprintf)(comm, file, "%% pnfft_flags == PNFFT_WINDOW_BESSEL_I0");
+  else if(ths->pnfft_flags & PNFFT_WINDOW_ES)
+    PX(fprintf)(comm, file, "%% pnfft_flags == PNFFT_WINDOW_ES");
   else
     PX(fprintf)(comm, file, "%% pnfft_flags == PNFFT_WINDOW_KAISER_BESSEL");
 
@@ -267,6 +274,8 @@ static void write_run_specific_infos(
     PX(fprintf)(comm, file, " | PNFFT_PRE_QUAD_PSI");
   if(ths->pnfft_flags & PNFFT_PRE_CUB_PSI)
     PX(fprintf)(comm, file, " | PNFFT_PRE_CUB_PSI");
+  if(ths->pnfft_flags & PNFFT_PRE_POLY_PSI)
+    PX(fprintf)(comm, file, " | PNFFT_PRE_POLY_PSI");
   if(ths->pnfft_flags & PNFFT_PRE_FG_PSI)
     PX(fprintf)(comm, file, " | PNFFT_PRE_FG_PSI");
   if(ths->pnfft_flags & PNFFT_PRE_PSI)
@@ -298,6 +307,8 @@ static void write_run_specific_infos(
 
   if(ths->pnfft_flags & PNFFT_REAL_F)
     PX(fprintf)(comm, file, " | PNFFT_REAL_F");
+  if(ths->pnfft_flags & PNFFT_MIXED_PRECISION)
+    PX(fprintf)(comm, file, " | PNFFT_MIXED_PRECISION");
 
   if(ths->pnfft_flags & PNFFT_MALLOC_F_HAT)
     PX(fprintf)(comm, file, " | PNFFT_MALLOC_F_HAT");
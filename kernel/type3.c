@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Nonuniform to nonuniform (type-3) NFFT
+ *   f(v_k) = sum_j c_j exp(-2 pi i v_k * x_j),  |x_j| < x_max, |v_k| <= v_max,
+ * similar to NFFT 3 of NNFFT. The coefficients c_j are spread onto an N1 grid at the
+ * scaled nodes x_j/gamma (matrix B^T of the plan 'spread'), the grid serves as Fourier
+ * coefficients of a second NFFT at the scaled frequencies gamma*v_k/n1 (plan 'nfft') and
+ * the result is divided by the Fourier transform of the first window at gamma*v_k.
+ * N1 = 4 x_max v_max + O(m) follows from the space-bandwidth product, such that the spread
+ * grid does not wrap around and gamma*v_k stays within the deconvolution range -N1/2..N1/2. */
+
+#include <complex.h>
+#include "pnfft.h"
+#include "ipnfft.h"
+#include "matrix_D.h"
+
+/* flags of the user that do not apply to the inner plans */
+#define PNFFTI_TYPE3_IGNORED_FLAGS ((PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_MALLOC_GRAD_F| \
+                                     PNFFT_MALLOC_HESSIAN_F| PNFFT_INTERLACED_BATCHED| PNFFT_SHIFTED_F_HAT| \
+                                     PNFFT_SHIFTED_X| PNFFT_TRANSPOSED_F_HAT| PNFFT_GRAD_IK_BATCHED| PNFFT_REAL_F))
+
+struct PNX(type3_s){
+  PNX(plan) spread;            /**< Spreading of c_j onto the N1 grid (adjoint only) */
+  PNX(plan) nfft;              /**< NFFT of the grid at the scaled frequencies      */
+  INT N[3];                    /**< Size N1 of the spread grid                      */
+  R gamma[3];                  /**< Scaling of the nodes and frequencies            */
+  MPI_Comm comm_cart;          /**< Communicator of both plans                      */
+
+  INT local_M;                 /**< Number of user nodes on this process            */
+  INT local_K;                 /**< Number of user frequencies on this process      */
+  R *inv_phi_hat;              /**< Deconvolution at every user frequency           */
+
+  /* redistribution of the spread grid into the Fourier coefficients of nfft */
+  int same_layout;             /**< Flag, if both blocks agree on all processes     */
+  int *boxes;                  /**< Both blocks of every process, start and size    */
+  int *sendcounts;             /**< Grid points sent to every process               */
+  int *senddispls;             /**< Send buffer offsets of every process            */
+  int *recvcounts;             /**< Grid points received from every process         */
+  int *recvdispls;             /**< Receive buffer offsets of every process         */
+};
+
+static void init_grid_exchange(
+    PNX(type3) ths);
+static INT intersect_boxes(
+    const int *a, const int *b,
+    INT *start, INT *size);
+static void copy_box(
+    const INT *start, const INT *size,
+    const INT *grid_start, const INT *grid_size, int pack,
+    C *buffer, C *grid);
+static void grid_to_f_hat(
+    PNX(type3) ths);
+
+
+/* x_max and v_max bound the nodes and the frequencies of all processes,
+ * m and the window flags apply to both inner plans. Returns NULL if d != 3. */
+PNX(type3) PNX(init_type3)(
+    int d, const R *x_max, const R *v_max, int m,
+    unsigned pnfft_flags, unsigned pfft_flags,
+    MPI_Comm comm_cart
+    )
+{
+  PNX(type3) ths;
+  INT N1[3], n1[3], N2[3], n2[3];
+  R x_max_plan[3] = {0.5, 0.5, 0.5};
+  int direction;
+
+  if(d != 3){
+    PX(fprintf)(comm_cart, stderr, "!!! Error in PNFFT: d != 3 not yet implemented !!!\n");
+    return NULL;
+  }
+
+  ths = (PNX(type3)) malloc(sizeof(struct PNX(type3_s)));
+  ths->comm_cart = comm_cart;
+  ths->local_M = ths->local_K = 0;
+  ths->inv_phi_hat = NULL;
+
+  /* oversampling 2 for both plans, the nodes x_j/gamma keep m+1 grid points distance to the border */
+  for(int t=0; t<3; t++){
+    N1[t] = 2 * ((INT) pnfft_ceil(2.0 * x_max[t] * v_max[t] + 0.5 * (m+1)) + 1);
+    n1[t] = 2 * N1[t];
+    N2[t] = n1[t];
+    n2[t] = 2 * n1[t];
+    ths->N[t] = N1[t];
+    ths->gamma[t] = x_max[t] / (0.5 - (R) (m+1) / (R) n1[t]);
+  }
+
+  pnfft_flags = (pnfft_flags & ~PNFFTI_TYPE3_IGNORED_FLAGS) | PNFFT_GRAD_NONE;
+
+  /* every inner plan needs one direction only */
+  direction = PNX(get_plan_direction)();
+  PNX(plan_with_direction)(PNFFT_ADJ_ONLY);
+  ths->spread = PNX(init_guru)(3, N1, n1, x_max_plan, 0, m,
+      pnfft_flags | PNFFT_MALLOC_X | PNFFT_MALLOC_F, pfft_flags, comm_cart);
+  PNX(plan_with_direction)(PNFFT_TRAFO_ONLY);
+  ths->nfft = PNX(init_guru)(3, N2, n2, x_max_plan, 0, m,
+      pnfft_flags | PNFFT_MALLOC_X | PNFFT_MALLOC_F_HAT | PNFFT_MALLOC_F, pfft_flags, comm_cart);
+  PNX(plan_with_direction)(direction);
+
+  init_grid_exchange(ths);
+
+  return ths;
+}
+
+/* Nodes x (3*local_M) and frequencies v (3*local_K) may be scattered arbitrarily over the processes,
+ * they are redistributed to the owners of the grid blocks. Collective on comm_cart. */
+void PNX(type3_set_nodes)(
+    PNX(type3) ths, INT local_M, const R *x, INT local_K, const R *v
+    )
+{
+  INT n1[3];
+  R *y = (local_M > 0) ? PNX(malloc_R)((size_t) (3*local_M)) : NULL;
+  R *s = (local_K > 0) ? PNX(malloc_R)((size_t) (3*local_K)) : NULL;
+
+  for(int t=0; t<3; t++)
+    n1[t] = 2 * ths->N[t];
+
+  for(INT j=0; j<local_M; j++)
+    for(int t=0; t<3; t++)
+      y[3*j+t] = x[3*j+t] / ths->gamma[t];
+  for(INT k=0; k<local_K; k++)
+    for(int t=0; t<3; t++)
+      s[3*k+t] = ths->gamma[t] * v[3*k+t] / (R) n1[t];
+
+  PNX(redistribute_nodes)(ths->spread, local_M, y);
+  PNX(redistribute_nodes)(ths->nfft, local_K, s);
+  PNX(precompute_psi)(ths->spread);
+  PNX(precompute_psi)(ths->nfft);
+
+  /* deconvolution in the user order of the frequencies */
+  if(ths->inv_phi_hat != NULL)
+    PNX(free)(ths->inv_phi_hat);
+  ths->inv_phi_hat = (local_K > 0) ? PNX(malloc_R)((size_t) local_K) : NULL;
+  for(INT k=0; k<local_K; k++){
+    R phi_hat = 1.0;
+    for(int t=0; t<3; t++)
+      phi_hat *= PNX(phi_hat_real)(ths->spread, t, ths->gamma[t] * v[3*k+t]);
+    ths->inv_phi_hat[k] = 1.0 / phi_hat;
+  }
+
+  ths->local_M = local_M;
+  ths->local_K = local_K;
+
+  if(y != NULL)
+    PNX(free)(y);
+  if(s != NULL)
+    PNX(free)(s);
+}
+
+/* c holds the coefficients of the local_M nodes and f receives the sums at the local_K frequencies,
+ * both in the order of PNX(type3_set_nodes). Collective on comm_cart. */
+void PNX(trafo_type3)(
+    PNX(type3) ths, const C *c, C *f
+    )
+{
+  PNX(plan) spread = ths->spread;
+
+  if(spread->redist_sendcounts == NULL){
+    PX(fprintf)(ths->comm_cart, stderr, "!!! Error: Call PNX(type3_set_nodes) before PNX(trafo_type3) !!!\n");
+    return;
+  }
+
+  /* spread only, the FFT and deconvolution of the first plan are replaced by the second NFFT */
+  PNX(exchange_redistributed)(spread, 2, 0, (R*) c, spread->f);
+  PNFFT_START_PHASE(spread, spread->timer_adj, PNFFT_TIMER_MATRIX_B);
+  PNX(adjoint_B)(spread, 0);
+  PNFFT_FINISH_PHASE(spread, spread->timer_adj, PNFFT_TIMER_MATRIX_B);
+
+  grid_to_f_hat(ths);
+  PNX(trafo_redistributed)(ths->nfft, f, NULL);
+
+  for(INT k=0; k<ths->local_K; k++)
+    f[k] *= ths->inv_phi_hat[k];
+}
+
+void PNX(type3_get_N)(
+    const PNX(type3) ths,
+    INT *N
+    )
+{
+  for(int t=0; t<3; t++)
+    N[t] = ths->N[t];
+}
+
+void PNX(finalize_type3)(
+    PNX(type3) ths
+    )
+{
+  if(ths == NULL)
+    return;
+
+  PNX(finalize)(ths->spread, PNFFT_FREE_X | PNFFT_FREE_F);
+  PNX(finalize)(ths->nfft, PNFFT_FREE_X | PNFFT_FREE_F_HAT | PNFFT_FREE_F);
+  if(ths->inv_phi_hat != NULL)
+    PNX(free)(ths->inv_phi_hat);
+  /* all counts and displacements share one allocation */
+  PNX(free)(ths->sendcounts);
+  PNX(free)(ths->boxes);
+
+  free(ths);
+}
+
+
+/* The spread grid is distributed like the FFT input of 'spread' (local_no), the Fourier
+ * coefficients like the FFT input of 'nfft' (local_N). Both cover the same index range
+ * -n1/2..n1/2-1, but the blocks may differ. Exchange the intersections of all pairs of blocks. */
+static void init_grid_exchange(
+    PNX(type3) ths
+    )
+{
+  int np_total, box[12], same, same_all;
+  INT start[3], size[3];
+
+  MPI_Comm_size(ths->comm_cart, &np_total);
+
+  for(int t=0; t<3; t++){
+    box[t]   = (int) ths->spread->local_no_start[t];
+    box[3+t] = (int) ths->spread->local_no[t];
+    box[6+t] = (int) ths->nfft->local_N_start[t];
+    box[9+t] = (int) ths->nfft->local_N[t];
+  }
+
+  same = 1;
+  for(int t=0; t<6; t++)
+    if(box[t] != box[6+t])
+      same = 0;
+  MPI_Allreduce(&same, &same_all, 1, MPI_INT, MPI_MIN, ths->comm_cart);
+  ths->same_layout = same_all;
+
+  ths->boxes = PNX(malloc_int)((size_t) (12*np_total));
+  MPI_Allgather(box, 12, MPI_INT, ths->boxes, 12, MPI_INT, ths->comm_cart);
+
+  ths->sendcounts = PNX(malloc_int)((size_t) (4*np_total));
+  ths->senddispls = ths->sendcounts + np_total;
+  ths->recvcounts = ths->sendcounts + 2*np_total;
+  ths->recvdispls = ths->sendcounts + 3*np_total;
+
+  for(int r=0; r<np_total; r++){
+    ths->sendcounts[r] = (int) intersect_boxes(box, ths->boxes + 12*r + 6, start, size);
+    ths->recvcounts[r] = (int) intersect_boxes(ths->boxes + 12*r, box + 6, start, size);
+  }
+
+  ths->senddispls[0] = ths->recvdispls[0] = 0;
+  for(int r=1; r<np_total; r++){
+    ths->senddispls[r] = ths->senddispls[r-1] + ths->sendcounts[r-1];
+    ths->recvdispls[r] = ths->recvdispls[r-1] + ths->recvcounts[r-1];
+  }
+}
+
+/* a and b point to start[3], size[3] of a block, returns the number of common grid points */
+static INT intersect_boxes(
+    const int *a, const int *b,
+    INT *start, INT *size
+    )
+{
+  INT vol = 1;
+
+  for(int t=0; t<3; t++){
+    INT lo = PNFFT_MAX(a[t], b[t]);
+    INT up = PNFFT_MIN(a[t] + a[3+t], b[t] + b[3+t]);
+    start[t] = lo;
+    size[t] = (up > lo) ? up - lo : 0;
+    vol *= size[t];
+  }
+
+  return vol;
+}
+
+/* Copy the block start, size of the row major local grid into the buffer (pack=1) or back (pack=0). */
+static void copy_box(
+    const INT *start, const INT *size,
+    const INT *grid_start, const INT *grid_size, int pack,
+    C *buffer, C *grid
+    )
+{
+  INT l = 0;
+
+  for(INT k0=start[0]; k0<start[0]+size[0]; k0++)
+    for(INT k1=start[1]; k1<start[1]+size[1]; k1++){
+      C *row = grid + ((k0-grid_start[0])*grid_size[1] + (k1-grid_start[1]))*grid_size[2] + (start[2]-grid_start[2]);
+      for(INT k2=0; k2<size[2]; k2++, l++){
+        if(pack)
+          buffer[l] = row[k2];
+        else
+          row[k2] = buffer[l];
+      }
+    }
+}
+
+static void grid_to_f_hat(
+    PNX(type3) ths
+    )
+{
+  int np_total, myrank;
+  INT start[3], size[3];
+  INT *no_start = ths->spread->local_no_start, *no = ths->spread->local_no;
+  INT *N_start = ths->nfft->local_N_start, *N = ths->nfft->local_N;
+  const int *box;
+  C *grid = (C*) ths->spread->g2, *f_hat = ths->nfft->f_hat;
+  C *sendbuf, *recvbuf;
+  MPI_Datatype point_type;
+
+  if(ths->same_layout){
+    for(INT k=0; k<ths->nfft->local_N_total; k++)
+      f_hat[k] = grid[k];
+    return;
+  }
+
+  MPI_Comm_size(ths->comm_cart, &np_total);
+  MPI_Comm_rank(ths->comm_cart, &myrank);
+  box = ths->boxes + 12*myrank;
+
+  sendbuf = PNX(malloc_C)((size_t) (ths->senddispls[np_total-1] + ths->sendcounts[np_total-1] + 1));
+  recvbuf = PNX(malloc_C)((size_t) (ths->recvdispls[np_total-1] + ths->recvcounts[np_total-1] + 1));
+
+  for(int r=0; r<np_total; r++){
+    if(ths->sendcounts[r] == 0)
+      continue;
+    intersect_boxes(box, ths->boxes + 12*r + 6, start, size);
+    copy_box(start, size, no_start, no, 1,
+        sendbuf + ths->senddispls[r], grid);
+  }
+
+  MPI_Type_contiguous(2, PNFFT_MPI_REAL_TYPE, &point_type);
+  MPI_Type_commit(&point_type);
+  MPI_Alltoallv(sendbuf, ths->sendcounts, ths->senddispls, point_type,
+      recvbuf, ths->recvcounts, ths->recvdispls, point_type, ths->comm_cart);
+  MPI_Type_free(&point_type);
+
+  for(int r=0; r<np_total; r++){
+    if(ths->recvcounts[r] == 0)
+      continue;
+    intersect_boxes(ths->boxes + 12*r, box + 6, start, size);
+    copy_box(start, size, N_start, N, 0,
+        recvbuf + ths->recvdispls[r], f_hat);
+  }
+
+  PNX(free)(sendbuf);
+  PNX(free)(recvbuf);
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2011-2013 Michael Pippig
+ *
+ * This file is part of PNFFT.
+ *
+ * PNFFT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PNFFT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PNFFT.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* PNFFT wisdom consists of the FFTW wisdom of all processes and the measured choices of
+ * PNX(init_guru_eps). A wisdom file starts with one line per choice, followed by the FFTW wisdom:
+ *
+ *   pnfft-wisdom 1
+ *   planner <procs> <flags> <M> <N0> <N1> <N2> <x_max0> <x_max1> <x_max2> <eps> <n0> <n1> <n2> <m> <window>
+ *   end
+ *   (fftw-3... wisdom) */
+
+#include "pnfft.h"
+#include "ipnfft.h"
+
+#define PNFFT_WISDOM_VERSION 1
+
+typedef struct{
+  int num_procs;
+  unsigned pnfft_flags;
+  long long M;
+  long long N[3];
+  double x_max[3];
+  double eps;
+  long long n[3];
+  int m;
+  unsigned window_flag;
+} planner_record;
+
+static planner_record *records = NULL;
+static int num_records = 0, max_records = 0;
+
+static planner_record* find_record(
+    int num_procs, unsigned pnfft_flags, long long M,
+    const INT *N, const R *x_max, R eps);
+static void add_record(
+    const planner_record *rec);
+static int parse_records(
+    const char *text, const char **fftw_wisdom);
+
+
+/* Collective, the FFTW wisdom of all processes of 'comm' is gathered on process 0 which writes the file.
+ * Returns 0 on success on all processes. */
+int PNX(export_wisdom)(
+    const char *filename, MPI_Comm comm
+    )
+{
+  int rank, err = 0;
+
+  MPI_Comm_rank(comm, &rank);
+  X(mpi_gather_wisdom)(comm);
+
+  if(rank == 0){
+    FILE *file = fopen(filename, "w");
+    char *fftw_wisdom = X(export_wisdom_to_string)();
+
+    if(file == NULL || fftw_wisdom == NULL)
+      err = 1;
+    else {
+      fprintf(file, "pnfft-wisdom %d\n", PNFFT_WISDOM_VERSION);
+      for(int k=0; k<num_records; k++){
+        const planner_record *r = &records[k];
+        fprintf(file, "planner %d %u %lld %lld %lld %lld %.17g %.17g %.17g %.17g %lld %lld %lld %d %u\n",
+            r->num_procs, r->pnfft_flags, r->M, r->N[0], r->N[1], r->N[2],
+            r->x_max[0], r->x_max[1], r->x_max[2], r->eps,
+            r->n[0], r->n[1], r->n[2], r->m, r->window_flag);
+      }
+      fprintf(file, "end\n%s", fftw_wisdom);
+      err = ferror(file);
+    }
+
+    if(file != NULL)
+      fclose(file);
+    if(fftw_wisdom != NULL)
+      X(free)(fftw_wisdom);
+  }
+
+  MPI_Bcast(&err, 1, MPI_INT, 0, comm);
+  return err;
+}
+
+/* Collective, process 0 reads the file and passes the FFTW wisdom and the planner choices
+ * to all processes of 'comm'. Returns 0 on success on all processes. */
+int PNX(import_wisdom)(
+    const char *filename, MPI_Comm comm
+    )
+{
+  int rank, err = 0, length = 0;
+  char *text = NULL;
+  const char *fftw_wisdom = NULL;
+
+  MPI_Comm_rank(comm, &rank);
+
+  if(rank == 0){
+    FILE *file = fopen(filename, "r");
+
+    if(file != NULL && fseek(file, 0, SEEK_END) == 0){
+      long size = ftell(file);
+      rewind(file);
+      if(size > 0){
+        text = (char*) malloc((size_t) size + 1);
+        length = (int) fread(text, 1, (size_t) size, file);
+        text[length] = '\0';
+      }
+    }
+    if(file != NULL)
+      fclose(file);
+  }
+
+  /* all processes need the planner choices to take the same decisions */
+  MPI_Bcast(&length, 1, MPI_INT, 0, comm);
+  if(length == 0){
+    if(text != NULL)
+      free(text);
+    return 1;
+  }
+  if(rank != 0)
+    text = (char*) malloc((size_t) length + 1);
+  MPI_Bcast(text, length + 1, MPI_CHAR, 0, comm);
+
+  err = parse_records(text, &fftw_wisdom);
+
+  if(rank == 0 && !err)
+    err = !X(import_wisdom_from_string)(fftw_wisdom);
+  MPI_Bcast(&err, 1, MPI_INT, 0, comm);
+  if(!err)
+    X(mpi_broadcast_wisdom)(comm);
+
+  free(text);
+  return err;
+}
+
+void PNX(forget_wisdom)(
+    void
+    )
+{
+  if(records != NULL)
+    free(records);
+  records = NULL;
+  num_records = max_records = 0;
+
+  X(forget_wisdom)();
+}
+
+
+/* Planner choice for the same problem on the same number of processes,
+ * the key uses the total number of nodes to be equal on all processes. */
+int PNX(wisdom_lookup_planner)(
+    int num_procs, unsigned pnfft_flags, INT M,
+    const INT *N, const R *x_max, R eps,
+    INT *n, int *m, unsigned *window_flag
+    )
+{
+  planner_record *rec = find_record(num_procs, pnfft_flags, (long long) M, N, x_max, eps);
+
+  if(rec == NULL)
+    return 0;
+
+  for(int t=0; t<3; t++)
+    n[t] = (INT) rec->n[t];
+  *m = rec->m;
+  *window_flag = rec->window_flag;
+  return 1;
+}
+
+void PNX(wisdom_add_planner)(
+    int num_procs, unsigned pnfft_flags, INT M,
+    const INT *N, const R *x_max, R eps,
+    const INT *n, int m, unsigned window_flag
+    )
+{
+  planner_record rec;
+
+  rec.num_procs = num_procs;
+  rec.pnfft_flags = pnfft_flags;
+  rec.M = (long long) M;
+  for(int t=0; t<3; t++){
+    rec.N[t] = (long long) N[t];
+    rec.x_max[t] = (double) x_max[t];
+    rec.n[t] = (long long) n[t];
+  }
+  rec.eps = (double) eps;
+  rec.m = m;
+  rec.window_flag = window_flag;
+
+  add_record(&rec);
+}
+
+
+static planner_record* find_record(
+    int num_procs, unsigned pnfft_flags, long long M,
+    const INT *N, const R *x_max, R eps
+    )
+{
+  for(int k=0; k<num_records; k++){
+    planner_record *r = &records[k];
+    int equal = (r->num_procs == num_procs) && (r->pnfft_flags == pnfft_flags)
+                && (r->M == M) && (r->eps == (double) eps);
+
+    for(int t=0; t<3; t++)
+      equal = equal && (r->N[t] == (long long) N[t]) && (r->x_max[t] == (double) x_max[t]);
+    if(equal)
+      return r;
+  }
+
+  return NULL;
+}
+
+/* a newer choice replaces the old one */
+static void add_record(
+    const planner_record *rec
+    )
+{
+  INT N[3];
+  R x_max[3];
+  planner_record *old;
+
+  for(int t=0; t<3; t++){
+    N[t] = (INT) rec->N[t];
+    x_max[t] = (R) rec->x_max[t];
+  }
+  old = find_record(rec->num_procs, rec->pnfft_flags, rec->M, N, x_max, (R) rec->eps);
+  if(old != NULL){
+    *old = *rec;
+    return;
+  }
+
+  if(num_records == max_records){
+    max_records = (max_records) ? 2*max_records : 8;
+    records = (planner_record*) realloc(records, sizeof(planner_record) * (size_t) max_records);
+  }
+  records[num_records++] = *rec;
+}
+
+/* Read the planner lines and return the begin of the FFTW wisdom. */
+static int parse_records(
+    const char *text, const char **fftw_wisdom
+    )
+{
+  int version;
+  const char *line = text;
+
+  if(sscanf(line, "pnfft-wisdom %d", &version) != 1 || version != PNFFT_WISDOM_VERSION)
+    return 1;
+
+  while( (line = strchr(line, '\n')) != NULL ){
+    planner_record rec;
+
+    line++;
+    if(strncmp(line, "end", 3) == 0){
+      line = strchr(line, '\n');
+      *fftw_wisdom = (line != NULL) ? line + 1 : "";
+      return 0;
+    }
+
+    if(sscanf(line, "planner %d %u %lld %lld %lld %lld %lg %lg %lg %lg %lld %lld %lld %d %u",
+          &rec.num_procs, &rec.pnfft_flags, &rec.M, &rec.N[0], &rec.N[1], &rec.N[2],
+          &rec.x_max[0], &rec.x_max[1], &rec.x_max[2], &rec.eps,
+          &rec.n[0], &rec.n[1], &rec.n[2], &rec.m, &rec.window_flag) != 15)
+      return 1;
+    add_record(&rec);
+  }
+
+  return 1;
+}
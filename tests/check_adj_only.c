@@ -0,0 +1,21 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* plans of the adjoint only skip the buffers of the trafo */
+  pnfft_plan_with_direction(PNFFT_ADJ_ONLY);
+  pnfft = check_fixture_plan(&fx, 0);
+  check_fixture_adj(&fx, pnfft, CHECK_TOL_EXACT, "* PNFFT_ADJ_ONLY, adj");
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  pnfft_plan_with_direction(PNFFT_TRAFO_AND_ADJ);
+
+  return check_fixture_finish(&fx);
+}
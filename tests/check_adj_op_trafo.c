@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include "check_fixture.h"
+
+static pnfft_plan init_plan(
+    const check_fixture *fx, int halo, const pnfft_complex *f);
+static void check_round_trip(
+    check_fixture *fx, pnfft_plan pnfft, ptrdiff_t bytes, const pnfft_complex *f,
+    const pnfft_complex *f_ref, const pnfft_complex *grad_f_ref, const char *name);
+
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  int myrank;
+  ptrdiff_t node_bytes;
+  pnfft_complex *f, *f_ref, *grad_f_ref;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+  MPI_Comm_rank(fx.comm, &myrank);
+
+  /* window values and derivatives of one node */
+  node_bytes = 2 * 3 * (2*fx.m+2) * (ptrdiff_t) sizeof(double);
+
+  f = pnfft_alloc_complex(fx.local_M);
+  f_ref = pnfft_alloc_complex(fx.local_M);
+  grad_f_ref = pnfft_alloc_complex(3*fx.local_M);
+  srand(myrank);
+  pnfft_init_f(fx.local_M, f);
+
+  for(int halo=0; halo<2; halo++){
+    /* adj and trafo as two calls give the reference */
+    pnfft = init_plan(&fx, halo, f);
+    pnfft_adj(pnfft);
+    pnfft_trafo(pnfft);
+    for(ptrdiff_t j=0; j<fx.local_M; j++)
+      f_ref[j] = pnfft_get_f(pnfft)[j];
+    for(ptrdiff_t j=0; j<3*fx.local_M; j++)
+      grad_f_ref[j] = pnfft_get_grad_f(pnfft)[j];
+
+    /* all nodes, half of the nodes and none of the nodes share their window values */
+    check_round_trip(&fx, pnfft, -1, f, f_ref, grad_f_ref,
+        (halo) ? "* PNFFT_HALO, default budget" : "* Default budget");
+    check_round_trip(&fx, pnfft, node_bytes * fx.local_M / 2, f, f_ref, grad_f_ref,
+        (halo) ? "* PNFFT_HALO, half of the nodes" : "* Half of the nodes");
+    check_round_trip(&fx, pnfft, 0, f, f_ref, grad_f_ref,
+        (halo) ? "* PNFFT_HALO, no budget" : "* No budget");
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_GRAD_F | PNFFT_FREE_F_HAT);
+  }
+
+  pnfft_free(f); pnfft_free(f_ref); pnfft_free(grad_f_ref);
+  return check_fixture_finish(&fx);
+}
+
+
+/* plan with gradient and the samples f */
+static pnfft_plan init_plan(
+    const check_fixture *fx, int halo, const pnfft_complex *f
+    )
+{
+  pnfft_plan pnfft = check_fixture_plan(fx, PNFFT_MALLOC_GRAD_F);
+
+  if(halo){
+    pnfft_set_halo(PNFFT_HALO, pnfft);
+    pnfft_precompute_psi(pnfft);
+  }
+  for(ptrdiff_t j=0; j<fx->local_M; j++)
+    pnfft_get_f(pnfft)[j] = f[j];
+
+  return pnfft;
+}
+
+/* pnfft_adj_op_trafo with the budget 'bytes' against adj and trafo */
+static void check_round_trip(
+    check_fixture *fx, pnfft_plan pnfft, ptrdiff_t bytes, const pnfft_complex *f,
+    const pnfft_complex *f_ref, const pnfft_complex *grad_f_ref, const char *name
+    )
+{
+  for(ptrdiff_t j=0; j<fx->local_M; j++)
+    pnfft_get_f(pnfft)[j] = f[j];
+  pnfft_set_shared_psi(bytes, pnfft);
+  pnfft_adj_op_trafo(pnfft, NULL, NULL, NULL);
+
+  pfft_printf(fx->comm, "%s\n", name);
+  check_fixture_compare(fx, pnfft_get_f(pnfft), f_ref, fx->local_M, CHECK_TOL_EXACT, "  f");
+  check_fixture_compare(fx, pnfft_get_grad_f(pnfft), grad_f_ref, 3*fx->local_M, CHECK_TOL_EXACT, "  grad_f");
+}
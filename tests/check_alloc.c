@@ -0,0 +1,27 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* placement of the grids, the planner setting applies to all following plans */
+  const unsigned allocs[2] = {PNFFT_ALLOC_FIRST_TOUCH, PNFFT_ALLOC_HUGE_PAGES};
+  const char *trafo_names[2] = {"* PNFFT_ALLOC_FIRST_TOUCH, trafo", "* PNFFT_ALLOC_HUGE_PAGES, trafo"};
+  const char *adj_names[2] = {"* PNFFT_ALLOC_FIRST_TOUCH, adj", "* PNFFT_ALLOC_HUGE_PAGES, adj"};
+  for(int i=0; i<2; i++){
+    pnfft_plan_with_alloc(allocs[i]);
+    pnfft = check_fixture_plan(&fx, 0);
+    check_fixture_trafo(&fx, pnfft, CHECK_TOL_EXACT, trafo_names[i]);
+    check_fixture_adj(&fx, pnfft, CHECK_TOL_EXACT, adj_names[i]);
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+  pnfft_plan_with_alloc(PNFFT_ALLOC_DEFAULT);
+
+  return check_fixture_finish(&fx);
+}
@@ -0,0 +1,154 @@
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void init_plan_data(
+    const ptrdiff_t *N, const ptrdiff_t *local_N, const ptrdiff_t *local_N_start,
+    const double *x, ptrdiff_t local_M,
+    pnfft_plan pnfft);
+static void compare_fields(
+    const pnfft_complex *data, const pnfft_complex *data_arena, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, m_small;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3];
+  unsigned flags[2];
+  MPI_Comm comm_cart_3d;
+  pnfft_plan pnfft[2], pnfft_shared[2];
+  pnfft_arena arena;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++)
+    n[t] = 2*N[t];
+  m_small = (m > 2) ? m-2 : m;
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, (double[3]){0.5,0.5,0.5}, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+  local_M = (local_M==0) ? local_N_total : local_M;
+
+  /* the second plan uses a smaller cutoff and takes its interlacing buffer from the pool */
+  flags[0] = PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F;
+  flags[1] = PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_INTERLACED;
+
+  /* plans with private grids */
+  for(int k=0; k<2; k++)
+    pnfft[k] = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, (k==0) ? m : m_small,
+        flags[k], PFFT_ESTIMATE, comm_cart_3d);
+
+  /* plans that share their grids, the plan with the larger cutoff comes first */
+  arena = pnfft_mkarena();
+  pnfft_plan_with_arena(arena);
+  for(int k=0; k<2; k++)
+    pnfft_shared[k] = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, (k==0) ? m : m_small,
+        flags[k], PFFT_ESTIMATE, comm_cart_3d);
+  pnfft_plan_with_arena(NULL);
+
+  /* all plans get the nodes of the first plan */
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft[0]));
+  for(int k=0; k<2; k++){
+    init_plan_data(N, local_N, local_N_start, pnfft_get_x(pnfft[0]), local_M, pnfft[k]);
+    init_plan_data(N, local_N, local_N_start, pnfft_get_x(pnfft[0]), local_M, pnfft_shared[k]);
+  }
+
+  /* use the plans one after another */
+  for(int k=0; k<2; k++){
+    pnfft_trafo(pnfft[k]);
+    pnfft_trafo(pnfft_shared[k]);
+  }
+  for(int k=0; k<2; k++)
+    compare_fields(pnfft_get_f(pnfft[k]), pnfft_get_f(pnfft_shared[k]), local_M,
+        (k==0) ? "* Results of trafo, first plan" : "* Results of trafo, second plan", comm_cart_3d);
+
+  for(int k=0; k<2; k++){
+    pnfft_adj(pnfft[k]);
+    pnfft_adj(pnfft_shared[k]);
+  }
+  for(int k=0; k<2; k++)
+    compare_fields(pnfft_get_f_hat(pnfft[k]), pnfft_get_f_hat(pnfft_shared[k]), local_N_total,
+        (k==0) ? "* Results of adj, first plan" : "* Results of adj, second plan", comm_cart_3d);
+
+  pnfft_print_memory(pnfft_shared[1], comm_cart_3d);
+  pfft_printf(comm_cart_3d, "* Private bytes of two plans: %td without arena, %td with arena (plus %td bytes in the arena on process 0)\n",
+      pnfft_get_memory(pnfft[0], PNFFT_MEMORY_TOTAL) + pnfft_get_memory(pnfft[1], PNFFT_MEMORY_TOTAL),
+      pnfft_get_memory(pnfft_shared[0], PNFFT_MEMORY_TOTAL) + pnfft_get_memory(pnfft_shared[1], PNFFT_MEMORY_TOTAL),
+      pnfft_get_arena_memory(arena));
+
+  /* free mem and finalize, the arena goes last */
+  for(int k=0; k<2; k++){
+    pnfft_finalize(pnfft[k], PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+    pnfft_finalize(pnfft_shared[k], PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+  pnfft_rmarena(arena);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void init_plan_data(
+    const ptrdiff_t *N, const ptrdiff_t *local_N, const ptrdiff_t *local_N_start,
+    const double *x, ptrdiff_t local_M,
+    pnfft_plan pnfft
+    )
+{
+  double *x_plan = pnfft_get_x(pnfft);
+
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      pnfft_get_f_hat(pnfft));
+  if(x_plan != x)
+    for(ptrdiff_t j=0; j<3*local_M; j++)
+      x_plan[j] = x[j];
+}
+
+
+static void compare_fields(
+    const pnfft_complex *data, const pnfft_complex *data_arena, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t k=0; k<size; k++)
+    if( cabs(data[k] - data_arena[k]) > error)
+      error = cabs(data[k] - data_arena[k]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s with arena: max. absolute deviation from private grids = %6.2e\n", name, error_max);
+}
@@ -0,0 +1,96 @@
+#include "check_fixture.h"
+
+static int declining_B(
+    pnfft_plan pnfft, int interlaced, void *data);
+static int trafo_B_ones(
+    pnfft_plan pnfft, int interlaced, void *data);
+static int adjoint_B_zeros(
+    pnfft_plan pnfft, int interlaced, void *data);
+
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  int calls = 0, calls_max;
+  pnfft_complex *ones, *zeros;
+  pnfft_plan pnfft;
+  pnfft_backend backend;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* a backend which leaves every pass to the host */
+  pnfft = check_fixture_plan(&fx, 0);
+  backend.trafo_B = backend.adjoint_B = declining_B;
+  backend.data = &calls;
+  pnfft_set_backend(pnfft, &backend);
+  check_fixture_trafo(&fx, pnfft, CHECK_TOL_EXACT, "* Declining backend, trafo");
+  check_fixture_adj(&fx, pnfft, CHECK_TOL_EXACT, "* Declining backend, adj");
+
+  MPI_Allreduce(&calls, &calls_max, 1, MPI_INT, MPI_MAX, fx.comm);
+  pfft_printf(fx.comm, "* Declining backend: %d calls of 2%s\n", calls_max,
+      (calls_max != 2) ? ", failed" : "");
+  if(calls_max != 2)
+    fx.err = 1;
+
+  /* the results of a backend which handles the passes */
+  ones = pnfft_alloc_complex(fx.local_M);
+  zeros = pnfft_alloc_complex(fx.local_N_total);
+  for(ptrdiff_t j=0; j<fx.local_M; j++)
+    ones[j] = 1;
+  for(ptrdiff_t l=0; l<fx.local_N_total; l++)
+    zeros[l] = 0;
+
+  backend.trafo_B = trafo_B_ones;
+  backend.adjoint_B = adjoint_B_zeros;
+  backend.data = NULL;
+  pnfft_set_backend(pnfft, &backend);
+  pnfft_trafo(pnfft);
+  check_fixture_compare(&fx, pnfft_get_f(pnfft), ones, fx.local_M, CHECK_TOL_EXACT, "* Backend, trafo");
+  pnfft_adj(pnfft);
+  check_fixture_compare(&fx, pnfft_get_f_hat(pnfft), zeros, fx.local_N_total, CHECK_TOL_EXACT, "* Backend, adj");
+
+  /* NULL restores the host loops */
+  pnfft_set_backend(pnfft, NULL);
+  check_fixture_trafo(&fx, pnfft, CHECK_TOL_EXACT, "* Host loops restored, trafo");
+
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  pnfft_free(ones); pnfft_free(zeros);
+  return check_fixture_finish(&fx);
+}
+
+
+/* counts the passes and returns them to the host loops */
+static int declining_B(
+    pnfft_plan pnfft, int interlaced, void *data
+    )
+{
+  int *calls = (int*) data;
+
+  (*calls)++;
+  return 0;
+}
+
+static int trafo_B_ones(
+    pnfft_plan pnfft, int interlaced, void *data
+    )
+{
+  for(ptrdiff_t j=0; j<pnfft_get_local_M(pnfft); j++)
+    pnfft_get_f(pnfft)[j] = 1;
+  return 1;
+}
+
+/* a zero grid gives f_hat = 0 after the FFT and the deconvolution */
+static int adjoint_B_zeros(
+    pnfft_plan pnfft, int interlaced, void *data
+    )
+{
+  ptrdiff_t local_no[3], local_no_start[3];
+  double *grid = pnfft_get_grid(pnfft, local_no, local_no_start);
+
+  for(ptrdiff_t k=0; k<2*local_no[0]*local_no[1]*local_no[2]; k++)
+    grid[k] = 0;
+  return 1;
+}
@@ -0,0 +1,157 @@
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, ptrdiff_t *chunk, int *m, int *np);
+static void set_chunk(
+    ptrdiff_t start, ptrdiff_t size, const double *x_all,
+    pnfft_plan pnfft);
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m;
+  ptrdiff_t N[3], n[3], local_M, chunk, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3], x_max[3];
+  double *x_all;
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat, *f_hat_ref, *f, *f_ref, *f_chunked;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  chunk = 100;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &chunk, &m, np);
+  for(int t=0; t<3; t++){
+    n[t] = 2*N[t];
+    x_max[t] = 0.5;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = (local_M==0) ? local_N[0]*local_N[1]*local_N[2] : local_M;
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+
+  pnfft = pnfft_init_guru(3, N, n, x_max, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_PRE_PSI| PNFFT_SORT_NODES, PFFT_ESTIMATE, comm_cart_3d);
+
+  /* all nodes at once give the reference */
+  x_all = pnfft_alloc_real(3*local_M);
+  f_hat = pnfft_alloc_complex(local_N_total);
+  f_hat_ref = pnfft_alloc_complex(local_N_total);
+  f_ref = pnfft_alloc_complex(local_M);
+  f_chunked = pnfft_alloc_complex(local_M);
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      x_all);
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat);
+  set_chunk(0, local_M, x_all, pnfft);
+
+  for(ptrdiff_t l=0; l<local_N_total; l++)
+    pnfft_get_f_hat(pnfft)[l] = f_hat[l];
+  pnfft_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f_ref[j] = pnfft_get_f(pnfft)[j];
+  pnfft_adj(pnfft);
+  for(ptrdiff_t l=0; l<local_N_total; l++)
+    f_hat_ref[l] = pnfft_get_f_hat(pnfft)[l];
+
+  /* chunked trafo, the nodes of every chunk replace the previous ones */
+  for(ptrdiff_t l=0; l<local_N_total; l++)
+    pnfft_get_f_hat(pnfft)[l] = f_hat[l];
+  pnfft_trafo_chunked_start(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j+=chunk){
+    ptrdiff_t size = (j+chunk < local_M) ? chunk : local_M-j;
+    set_chunk(j, size, x_all, pnfft);
+    pnfft_trafo_chunk(pnfft);
+    f = pnfft_get_f(pnfft);
+    for(ptrdiff_t k=0; k<size; k++)
+      f_chunked[j+k] = f[k];
+  }
+  pnfft_trafo_chunked_finish(pnfft);
+  compare(f_chunked, f_ref, local_M, "* Results of pnfft_trafo_chunk", comm_cart_3d);
+
+  /* chunked adjoint, all chunks are spread onto the same grid */
+  pnfft_adj_chunked_start(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j+=chunk){
+    ptrdiff_t size = (j+chunk < local_M) ? chunk : local_M-j;
+    set_chunk(j, size, x_all, pnfft);
+    f = pnfft_get_f(pnfft);
+    for(ptrdiff_t k=0; k<size; k++)
+      f[k] = f_ref[j+k];
+    pnfft_adj_chunk(pnfft);
+  }
+  pnfft_adj_chunked_finish(pnfft);
+  compare(pnfft_get_f_hat(pnfft), f_hat_ref, local_N_total, "* Results of pnfft_adj_chunked_finish", comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_free(x_all); pnfft_free(f_hat); pnfft_free(f_hat_ref); pnfft_free(f_ref); pnfft_free(f_chunked);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, ptrdiff_t *chunk, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_chunk", 1, PFFT_PTRDIFF_T, chunk);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+/* the plan only holds the nodes start, ..., start+size-1 */
+static void set_chunk(
+    ptrdiff_t start, ptrdiff_t size, const double *x_all,
+    pnfft_plan pnfft
+    )
+{
+  double *x;
+
+  pnfft_set_local_M(size, pnfft);
+  x = pnfft_get_x(pnfft);
+  for(ptrdiff_t k=0; k<3*size; k++)
+    x[k] = x_all[3*start+k];
+  pnfft_precompute_psi(pnfft);
+}
+
+
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t l=0; l<size; l++)
+    if( cabs(data[l] - data_ref[l]) > error)
+      error = cabs(data[l] - data_ref[l]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s: max. absolute difference = %6.2e\n", name, error_max);
+}
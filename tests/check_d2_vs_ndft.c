@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[1], m, myrank;
+  ptrdiff_t N[2], n[2], local_M, local_N[2], local_N_start[2], local_N_total;
+  double lower_border[2], upper_border[2], x_max[2] = {0.5, 0.5};
+  MPI_Comm comm_cart_1d;
+  pnfft_complex *f, *f_hat, *f_ref, *f_hat_ref;
+  double *x;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values, a two-dimensional plan on a one-dimensional process mesh */
+  N[0] = N[1] = 16;
+  local_M = 0;
+  m = 6;
+  np[0] = 2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<2; t++)
+    n[t] = 2*N[t];
+  local_M = (local_M==0) ? N[0]*N[1]/np[0] : local_M;
+
+  if( pnfft_create_procmesh(1, MPI_COMM_WORLD, np, &comm_cart_1d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d does not fit to number of allocated processes.\n", np[0]);
+    MPI_Finalize();
+    return 1;
+  }
+  MPI_Comm_rank(comm_cart_1d, &myrank);
+
+  pnfft_local_size_guru(2, N, n, x_max, m, comm_cart_1d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1];
+
+  pnfft = pnfft_init_guru(2, N, n, x_max, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_1d);
+
+  f_hat = pnfft_get_f_hat(pnfft);
+  f     = pnfft_get_f(pnfft);
+  x     = pnfft_get_x(pnfft);
+
+  /* nodes have two coordinates */
+  srand(myrank);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    for(int t=0; t<2; t++)
+      x[2*j+t] = lower_border[t] + ((double) rand()) / ((double) RAND_MAX + 1.0) * (upper_border[t] - lower_border[t]);
+
+  f_ref = pnfft_alloc_complex(local_M);
+  f_hat_ref = pnfft_alloc_complex(local_N_total);
+
+  /* trafo against the NDFT */
+  srand(1);
+  pnfft_init_f(local_N_total, f_hat);
+  pnfft_direct_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++) f_ref[j] = f[j];
+  pnfft_trafo(pnfft);
+  compare(f, f_ref, local_M, "* d = 2, trafo", comm_cart_1d);
+
+  /* adjoint against the NDFT */
+  srand(2);
+  pnfft_init_f(local_M, f);
+  pnfft_direct_adj(pnfft);
+  for(ptrdiff_t k=0; k<local_N_total; k++) f_hat_ref[k] = f_hat[k];
+  pnfft_adj(pnfft);
+  compare(f_hat, f_hat_ref, local_N_total, "* d = 2, adj", comm_cart_1d);
+
+  /* free mem and finalize */
+  pnfft_free(f_ref); pnfft_free(f_hat_ref);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_1d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 2, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 1, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t l=0; l<size; l++)
+    if( cabs(data[l] - data_ref[l]) > error)
+      error = cabs(data[l] - data_ref[l]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s: max. absolute difference = %6.2e\n", name, error_max);
+}
@@ -0,0 +1,148 @@
+#include <complex.h>
+#include <pnfft.h>
+#include "check_fixture.h"
+
+/* Initializes MPI and PNFFT, reads the parameters from the command line, creates the procmesh
+ * and the nodes and Fourier coefficients of the checks. Returns 1 if the procmesh does not fit. */
+int check_fixture_init(
+    int argc, char **argv,
+    check_fixture *fx
+    )
+{
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  fx->N[0] = fx->N[1] = fx->N[2] = 16;
+  fx->local_M = 0;
+  fx->m = 6;
+  fx->np[0]=2; fx->np[1]=2; fx->np[2]=2;
+  fx->err = 0;
+
+  /* set parameters by command line */
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, &fx->local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, fx->N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, fx->np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, &fx->m);
+  for(int t=0; t<3; t++){
+    fx->n[t] = 2*fx->N[t];
+    fx->x_max[t] = 0.5;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, fx->np, &fx->comm) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", fx->np[0], fx->np[1], fx->np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, fx->N, fx->n, fx->x_max, fx->m, fx->comm, PNFFT_TRANSPOSED_NONE,
+      fx->local_N, fx->local_N_start, fx->lower_border, fx->upper_border);
+  fx->local_M = (fx->local_M==0) ? fx->local_N[0]*fx->local_N[1]*fx->local_N[2] : fx->local_M;
+  fx->local_N_total = fx->local_N[0]*fx->local_N[1]*fx->local_N[2];
+
+  fx->x = pnfft_alloc_real(3*fx->local_M);
+  fx->f_hat = pnfft_alloc_complex(fx->local_N_total);
+  fx->f_ref = pnfft_alloc_complex(fx->local_M);
+  fx->f_hat_ref = pnfft_alloc_complex(fx->local_N_total);
+  pnfft_init_x_3d(fx->lower_border, fx->upper_border, fx->local_M,
+      fx->x);
+  pnfft_init_f_hat_3d(fx->N, fx->local_N, fx->local_N_start, PNFFT_TRANSPOSED_NONE,
+      fx->f_hat);
+
+  return 0;
+}
+
+/* frees the fixture and finalizes PNFFT and MPI, returns the result of main */
+int check_fixture_finish(
+    check_fixture *fx
+    )
+{
+  int err = fx->err;
+
+  pnfft_free(fx->x); pnfft_free(fx->f_hat); pnfft_free(fx->f_ref); pnfft_free(fx->f_hat_ref);
+  MPI_Comm_free(&fx->comm);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return err;
+}
+
+/* plan with the nodes x, f_hat and f are set by the caller */
+pnfft_plan check_fixture_plan(
+    const check_fixture *fx, unsigned pnfft_flags
+    )
+{
+  pnfft_plan pnfft;
+
+  pnfft = pnfft_init_guru(3, fx->N, fx->n, fx->x_max, fx->local_M, fx->m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| pnfft_flags, PFFT_ESTIMATE, fx->comm);
+  for(ptrdiff_t k=0; k<3*fx->local_M; k++)
+    pnfft_get_x(pnfft)[k] = fx->x[k];
+
+  return pnfft;
+}
+
+/* trafo of f_hat and adjoint of its result with the default plan give f_ref and f_hat_ref */
+void check_fixture_reference(
+    check_fixture *fx
+    )
+{
+  pnfft_plan pnfft = check_fixture_plan(fx, 0);
+
+  for(ptrdiff_t l=0; l<fx->local_N_total; l++)
+    pnfft_get_f_hat(pnfft)[l] = fx->f_hat[l];
+  pnfft_trafo(pnfft);
+  for(ptrdiff_t j=0; j<fx->local_M; j++)
+    fx->f_ref[j] = pnfft_get_f(pnfft)[j];
+  pnfft_adj(pnfft);
+  for(ptrdiff_t l=0; l<fx->local_N_total; l++)
+    fx->f_hat_ref[l] = pnfft_get_f_hat(pnfft)[l];
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+}
+
+/* trafo of f_hat with the plan against the default plan */
+void check_fixture_trafo(
+    check_fixture *fx, pnfft_plan pnfft, double tol, const char *name
+    )
+{
+  for(ptrdiff_t l=0; l<fx->local_N_total; l++)
+    pnfft_get_f_hat(pnfft)[l] = fx->f_hat[l];
+  pnfft_trafo(pnfft);
+  check_fixture_compare(fx, pnfft_get_f(pnfft), fx->f_ref, fx->local_M, tol, name);
+}
+
+/* adjoint of the reference f with the plan against the default plan */
+void check_fixture_adj(
+    check_fixture *fx, pnfft_plan pnfft, double tol, const char *name
+    )
+{
+  for(ptrdiff_t j=0; j<fx->local_M; j++)
+    pnfft_get_f(pnfft)[j] = fx->f_ref[j];
+  pnfft_adj(pnfft);
+  check_fixture_compare(fx, pnfft_get_f_hat(pnfft), fx->f_hat_ref, fx->local_N_total, tol, name);
+}
+
+/* max. difference relative to the max. of data_ref, marks the fixture as failed above tol */
+double check_fixture_compare(
+    check_fixture *fx, const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    double tol, const char *name
+    )
+{
+  double local[2] = {0, 0}, global[2], error;
+
+  for(ptrdiff_t l=0; l<size; l++){
+    if( cabs(data[l] - data_ref[l]) > local[0])
+      local[0] = cabs(data[l] - data_ref[l]);
+    if( cabs(data_ref[l]) > local[1])
+      local[1] = cabs(data_ref[l]);
+  }
+
+  MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_MAX, fx->comm);
+  error = (global[1] > 0) ? global[0] / global[1] : global[0];
+  if(error > tol)
+    fx->err = 1;
+
+  pfft_printf(fx->comm, "%s: max. relative difference = %6.2e (tolerance %6.2e)%s\n", name, error, tol,
+      (error > tol) ? ", failed" : "");
+  return error;
+}
@@ -0,0 +1,42 @@
+/* Fixture of the feature checks: every check runs the default plan and the plan with one
+ * feature on the same nodes and fails, if the relative difference exceeds the tolerance. */
+
+#ifndef CHECK_FIXTURE_H
+#define CHECK_FIXTURE_H 1
+
+#include <complex.h>
+#include <pnfft.h>
+
+/* relative tolerances of the max. difference */
+#define CHECK_TOL_EXACT   1e-11 /* the same sums in another order             */
+#define CHECK_TOL_WINDOW  1e-6  /* differences at the truncation error of m=6 */
+#define CHECK_TOL_SINGLE  1e-4  /* single precision within the plan           */
+
+typedef struct{
+  int np[3], m;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3], x_max[3];
+  double *x;
+  MPI_Comm comm;
+  pnfft_complex *f_hat, *f_ref, *f_hat_ref;
+  int err;
+} check_fixture;
+
+int check_fixture_init(
+    int argc, char **argv,
+    check_fixture *fx);
+int check_fixture_finish(
+    check_fixture *fx);
+pnfft_plan check_fixture_plan(
+    const check_fixture *fx, unsigned pnfft_flags);
+void check_fixture_reference(
+    check_fixture *fx);
+void check_fixture_trafo(
+    check_fixture *fx, pnfft_plan pnfft, double tol, const char *name);
+void check_fixture_adj(
+    check_fixture *fx, pnfft_plan pnfft, double tol, const char *name);
+double check_fixture_compare(
+    check_fixture *fx, const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    double tol, const char *name);
+
+#endif /* !CHECK_FIXTURE_H */
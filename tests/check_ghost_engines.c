@@ -0,0 +1,27 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* every ghost cell engine against the ghost cells of PFFT, the float wire format rounds the slabs */
+  const int engines[3] = {PNFFT_GHOSTS_PERSISTENT, PNFFT_GHOSTS_SHARED, PNFFT_GHOSTS_PERSISTENT| PNFFT_GHOSTS_FLOAT_WIRE};
+  const double tols[3] = {CHECK_TOL_EXACT, CHECK_TOL_EXACT, CHECK_TOL_SINGLE};
+  const char *trafo_names[3] = {"* PNFFT_GHOSTS_PERSISTENT, trafo", "* PNFFT_GHOSTS_SHARED, trafo", "* PNFFT_GHOSTS_FLOAT_WIRE, trafo"};
+  const char *adj_names[3] = {"* PNFFT_GHOSTS_PERSISTENT, adj", "* PNFFT_GHOSTS_SHARED, adj", "* PNFFT_GHOSTS_FLOAT_WIRE, adj"};
+  for(int i=0; i<3; i++){
+    pnfft = check_fixture_plan(&fx, 0);
+    pnfft_set_ghost_engine(engines[i], pnfft);
+    check_fixture_trafo(&fx, pnfft, tols[i], trafo_names[i]);
+    check_fixture_adj(&fx, pnfft, tols[i], adj_names[i]);
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+
+  return check_fixture_finish(&fx);
+}
@@ -0,0 +1,22 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* the nodes near the block borders are sent to the neighbors instead of the ghost cells */
+  pnfft = check_fixture_plan(&fx, 0);
+  pnfft_set_halo(PNFFT_HALO, pnfft);
+  pnfft_precompute_psi(pnfft);
+  check_fixture_trafo(&fx, pnfft, CHECK_TOL_EXACT, "* PNFFT_HALO, trafo");
+  check_fixture_adj(&fx, pnfft, CHECK_TOL_EXACT, "* PNFFT_HALO, adj");
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+
+  return check_fixture_finish(&fx);
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+#define HOWMANY 3
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void compare_fields(
+    const pnfft_complex *data, const pnfft_complex *data_many, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3];
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat, *f, *f_hat_many, *f_many;
+  double *x, *x_many;
+  pnfft_plan pnfft, pnfft_many;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++)
+    n[t] = 2*N[t];
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, (double[3]){0.5,0.5,0.5}, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+  local_M = (local_M==0) ? local_N_total : local_M;
+
+  /* one plan for a single field and one plan for HOWMANY fields with the same nodes */
+  pnfft = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+  pnfft_many = pnfft_init_guru_many(3, N, n, (double[3]){0.5,0.5,0.5}, HOWMANY, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+
+  f_hat = pnfft_get_f_hat(pnfft);
+  f     = pnfft_get_f(pnfft);
+  x     = pnfft_get_x(pnfft);
+  f_hat_many = pnfft_get_f_hat(pnfft_many);
+  f_many     = pnfft_get_f(pnfft_many);
+  x_many     = pnfft_get_x(pnfft_many);
+
+  /* field h of the interleaved plan is (h+1) times the single field */
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat);
+  for(ptrdiff_t k=0; k<local_N_total; k++)
+    for(int h=0; h<HOWMANY; h++)
+      f_hat_many[HOWMANY*k+h] = (h+1) * f_hat[k];
+
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      x);
+  for(ptrdiff_t j=0; j<3*local_M; j++)
+    x_many[j] = x[j];
+
+  pnfft_trafo(pnfft);
+  pnfft_trafo(pnfft_many);
+  compare_fields(f, f_many, local_M, "* Results of trafo", comm_cart_3d);
+
+  /* reuse f as input of the adjoint transform */
+  for(ptrdiff_t j=0; j<local_M; j++)
+    for(int h=0; h<HOWMANY; h++)
+      f_many[HOWMANY*j+h] = (h+1) * f[j];
+
+  pnfft_adj(pnfft);
+  pnfft_adj(pnfft_many);
+  compare_fields(f_hat, f_hat_many, local_N_total, "* Results of adj", comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  pnfft_finalize(pnfft_many, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void compare_fields(
+    const pnfft_complex *data, const pnfft_complex *data_many, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t k=0; k<size; k++)
+    for(int h=0; h<HOWMANY; h++)
+      if( cabs((h+1)*data[k] - data_many[HOWMANY*k+h]) > error)
+        error = cabs((h+1)*data[k] - data_many[HOWMANY*k+h]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s with %d fields: max. absolute deviation from single field = %6.2e\n", name, HOWMANY, error_max);
+}
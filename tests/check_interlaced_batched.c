@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void compare_fields(
+    const pnfft_complex *data, const pnfft_complex *data_batched, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+static void compare_fields_real(
+    const double *data, const double *data_batched, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+static void check_c2r(
+    const ptrdiff_t *N, const ptrdiff_t *n, ptrdiff_t local_M, int m,
+    const int *np, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3];
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat, *f, *f_hat_batched, *f_batched;
+  double *x, *x_batched;
+  pnfft_plan pnfft, pnfft_batched;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++)
+    n[t] = 2*N[t];
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, (double[3]){0.5,0.5,0.5}, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+  local_M = (local_M==0) ? local_N_total : local_M;
+
+  /* real inputs on both grids with one r2c FFT of two fields */
+  check_c2r(N, n, local_M, m, np, MPI_COMM_WORLD);
+
+  /* interlacing with two passes and with both grids in one pass */
+  pnfft = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_INTERLACED, PFFT_ESTIMATE,
+      comm_cart_3d);
+  pnfft_batched = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_INTERLACED_BATCHED, PFFT_ESTIMATE,
+      comm_cart_3d);
+
+  f_hat = pnfft_get_f_hat(pnfft);
+  f     = pnfft_get_f(pnfft);
+  x     = pnfft_get_x(pnfft);
+  f_hat_batched = pnfft_get_f_hat(pnfft_batched);
+  f_batched     = pnfft_get_f(pnfft_batched);
+  x_batched     = pnfft_get_x(pnfft_batched);
+
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat);
+  for(ptrdiff_t k=0; k<local_N_total; k++)
+    f_hat_batched[k] = f_hat[k];
+
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      x);
+  for(ptrdiff_t j=0; j<3*local_M; j++)
+    x_batched[j] = x[j];
+
+  pnfft_trafo(pnfft);
+  pnfft_trafo(pnfft_batched);
+  compare_fields(f, f_batched, local_M, "* Results of trafo", comm_cart_3d);
+
+  /* reuse f as input of the adjoint transform */
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f_batched[j] = f[j];
+
+  pnfft_adj(pnfft);
+  pnfft_adj(pnfft_batched);
+  compare_fields(f_hat, f_hat_batched, local_N_total, "* Results of adj", comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  pnfft_finalize(pnfft_batched, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void check_c2r(
+    const ptrdiff_t *N, const ptrdiff_t *n, ptrdiff_t local_M, int m,
+    const int *np, MPI_Comm comm
+    )
+{
+  int myrank, np_2d[2] = {np[0], np[1]*np[2]};
+  ptrdiff_t local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3];
+  MPI_Comm comm_cart_2d;
+  pnfft_plan pnfft, pnfft_batched;
+  double *f, *f_batched;
+
+  /* c2r plans need a two-dimensional process grid */
+  if( pnfft_create_procmesh(2, comm, np_2d, &comm_cart_2d) )
+    return;
+  MPI_Comm_rank(comm_cart_2d, &myrank);
+
+  pnfft_local_size_guru_c2r(3, N, n, (double[3]){0.5,0.5,0.5}, m, comm_cart_2d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+
+  pnfft = pnfft_init_guru_c2r(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_INTERLACED, PFFT_ESTIMATE,
+      comm_cart_2d);
+  pnfft_batched = pnfft_init_guru_c2r(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_INTERLACED_BATCHED, PFFT_ESTIMATE,
+      comm_cart_2d);
+
+  f         = pnfft_get_f_real(pnfft);
+  f_batched = pnfft_get_f_real(pnfft_batched);
+
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft));
+  for(ptrdiff_t j=0; j<3*local_M; j++)
+    pnfft_get_x(pnfft_batched)[j] = pnfft_get_x(pnfft)[j];
+
+  srand(myrank+1);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f[j] = f_batched[j] = 2.0 * rand() / RAND_MAX - 1.0;
+
+  /* the adjoint gives Hermitian Fourier coefficients for the trafo */
+  pnfft_adj(pnfft);
+  pnfft_adj(pnfft_batched);
+  compare_fields(pnfft_get_f_hat(pnfft), pnfft_get_f_hat(pnfft_batched), local_N_total, "* Results of c2r adj", comm_cart_2d);
+
+  for(ptrdiff_t k=0; k<local_N_total; k++)
+    pnfft_get_f_hat(pnfft_batched)[k] = pnfft_get_f_hat(pnfft)[k];
+
+  pnfft_trafo(pnfft);
+  pnfft_trafo(pnfft_batched);
+  compare_fields_real(f, f_batched, local_M, "* Results of c2r trafo", comm_cart_2d);
+
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  pnfft_finalize(pnfft_batched, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_2d);
+}
+
+
+static void compare_fields(
+    const pnfft_complex *data, const pnfft_complex *data_batched, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t k=0; k<size; k++)
+    if( cabs(data[k] - data_batched[k]) > error)
+      error = cabs(data[k] - data_batched[k]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s with batched interlacing: max. absolute deviation from two passes = %6.2e\n", name, error_max);
+}
+
+
+static void compare_fields_real(
+    const double *data, const double *data_batched, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t k=0; k<size; k++)
+    if( fabs(data[k] - data_batched[k]) > error)
+      error = fabs(data[k] - data_batched[k]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s with batched interlacing: max. absolute deviation from two passes = %6.2e\n", name, error_max);
+}
@@ -0,0 +1,20 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* spreading and interpolation in single precision */
+  pnfft = check_fixture_plan(&fx, PNFFT_MIXED_PRECISION);
+  check_fixture_trafo(&fx, pnfft, CHECK_TOL_SINGLE, "* PNFFT_MIXED_PRECISION, trafo");
+  check_fixture_adj(&fx, pnfft, CHECK_TOL_SINGLE, "* PNFFT_MIXED_PRECISION, adj");
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+
+  return check_fixture_finish(&fx);
+}
@@ -0,0 +1,122 @@
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void check_trafo(
+    const ptrdiff_t *N, const ptrdiff_t *local_N, const ptrdiff_t *local_N_start,
+    const double *lower_border, const double *upper_border,
+    const char *name, pnfft_plan pnfft, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3];
+  double lower_border[3], upper_border[3], x_max[3];
+  MPI_Comm comm_cart_3d;
+  pnfft_nodes nodes;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++){
+    n[t] = 2*N[t];
+    x_max[t] = 0.5;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = (local_M==0) ? local_N[0]*local_N[1]*local_N[2] : local_M;
+
+  pnfft = pnfft_init_guru(3, N, n, x_max, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_PRE_PSI, PFFT_ESTIMATE, comm_cart_3d);
+  check_trafo(N, local_N, local_N_start, lower_border, upper_border,
+      "* Results of the plan", pnfft, comm_cart_3d);
+
+  /* more and then fewer nodes on the same plan */
+  pnfft_set_local_M(3*local_M, pnfft);
+  check_trafo(N, local_N, local_N_start, lower_border, upper_border,
+      "* Results after growing local_M", pnfft, comm_cart_3d);
+  pnfft_set_local_M(local_M/2, pnfft);
+  check_trafo(N, local_N, local_N_start, lower_border, upper_border,
+      "* Results after shrinking local_M", pnfft, comm_cart_3d);
+
+  /* a second node set shares the FFT and ghost cell plans */
+  nodes = pnfft_mknodes(2*local_M, PNFFT_MALLOC_X| PNFFT_MALLOC_F, pnfft);
+  pnfft_attach_nodes(nodes, pnfft);
+  check_trafo(N, local_N, local_N_start, lower_border, upper_border,
+      "* Results of the attached node set", pnfft, comm_cart_3d);
+  pnfft_attach_nodes(NULL, pnfft);
+  pfft_printf(comm_cart_3d, "* Nodes of the plan after detaching: local_M = %td (expected %td)\n",
+      pnfft_get_local_M(pnfft), local_M/2);
+
+  /* free mem and finalize */
+  pnfft_rmnodes(nodes, pnfft);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+/* compare trafo on the current nodes of the plan with the direct sum */
+static void check_trafo(
+    const ptrdiff_t *N, const ptrdiff_t *local_N, const ptrdiff_t *local_N_start,
+    const double *lower_border, const double *upper_border,
+    const char *name, pnfft_plan pnfft, MPI_Comm comm
+    )
+{
+  ptrdiff_t local_M = pnfft_get_local_M(pnfft);
+  double error = 0, error_max;
+  pnfft_complex *f = pnfft_get_f(pnfft), *f_ref;
+
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      pnfft_get_f_hat(pnfft));
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft));
+
+  pnfft_precompute_psi(pnfft);
+  pnfft_trafo(pnfft);
+  f_ref = pnfft_alloc_complex(local_M);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f_ref[j] = f[j];
+
+  pnfft_direct_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    if( cabs(f_ref[j] - f[j]) > error)
+      error = cabs(f_ref[j] - f[j]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s: local_M = %td, max. absolute error = %6.2e\n", name, local_M, error_max);
+  pnfft_free(f_ref);
+}
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void init_nodes(
+    const double *lower_border, const double *upper_border, const double *margin,
+    ptrdiff_t local_M,
+    double *x);
+static pnfft_plan init_plan(
+    const ptrdiff_t *N, const ptrdiff_t *n, const double *x_max, ptrdiff_t local_M, int m,
+    const int *boundary, int engine, const double *x, MPI_Comm comm);
+static int check_adjoint(
+    pnfft_plan pnfft, const pnfft_complex *f_hat, ptrdiff_t local_N_total,
+    const pnfft_complex *f, ptrdiff_t local_M, const char *name, MPI_Comm comm);
+static double compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, myrank, err = 0;
+  int periodic[3] = {PNFFT_BOUNDARY_PERIODIC, PNFFT_BOUNDARY_PERIODIC, PNFFT_BOUNDARY_PERIODIC};
+  int open[3] = {PNFFT_BOUNDARY_OPEN, PNFFT_BOUNDARY_PERIODIC, PNFFT_BOUNDARY_OPEN};
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3], x_max[3], margin[3], no_margin[3] = {0, 0, 0};
+  double *x;
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat, *f, *f_ref;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values, the first axis is distributed and the last one is not */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=1;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++){
+    n[t] = 2*N[t];
+    x_max[t] = 0.5;
+    margin[t] = (open[t] == PNFFT_BOUNDARY_OPEN) ? (m+1.0)/n[t] : 0;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+  MPI_Comm_rank(comm_cart_3d, &myrank);
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = (local_M==0) ? local_N[0]*local_N[1]*local_N[2] : local_M;
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+
+  x = pnfft_alloc_real(3*local_M);
+  f_hat = pnfft_alloc_complex(local_N_total);
+  f = pnfft_alloc_complex(local_M);
+  f_ref = pnfft_alloc_complex(local_M);
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat);
+  srand(myrank);
+  pnfft_init_f(local_M, f);
+
+  /* the windows of nodes away from the border of the open axes never wrap around */
+  init_nodes(lower_border, upper_border, margin, local_M, x);
+  pnfft = init_plan(N, n, x_max, local_M, m, periodic, PNFFT_GHOSTS_PFFT, x, comm_cart_3d);
+  for(ptrdiff_t l=0; l<local_N_total; l++)
+    pnfft_get_f_hat(pnfft)[l] = f_hat[l];
+  pnfft_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f_ref[j] = pnfft_get_f(pnfft)[j];
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+
+  for(int engine=PNFFT_GHOSTS_PFFT; engine<=PNFFT_GHOSTS_PERSISTENT; engine++){
+    pnfft = init_plan(N, n, x_max, local_M, m, open, engine, x, comm_cart_3d);
+    for(ptrdiff_t l=0; l<local_N_total; l++)
+      pnfft_get_f_hat(pnfft)[l] = f_hat[l];
+    pnfft_trafo(pnfft);
+    if(compare(pnfft_get_f(pnfft), f_ref, local_M,
+          (engine == PNFFT_GHOSTS_PFFT) ? "* Open axes, interior nodes, PFFT ghost cells, trafo"
+                                        : "* Open axes, interior nodes, persistent ghost cells, trafo",
+          comm_cart_3d) > 1e-12)
+      err = 1;
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+
+  /* the windows cut off at the border, trafo and adjoint have to stay adjoint */
+  init_nodes(lower_border, upper_border, no_margin, local_M, x);
+  for(int engine=PNFFT_GHOSTS_PFFT; engine<=PNFFT_GHOSTS_PERSISTENT; engine++){
+    pnfft = init_plan(N, n, x_max, local_M, m, open, engine, x, comm_cart_3d);
+    err |= check_adjoint(pnfft, f_hat, local_N_total, f, local_M,
+        (engine == PNFFT_GHOSTS_PFFT) ? "* Open axes, all nodes, PFFT ghost cells"
+                                      : "* Open axes, all nodes, persistent ghost cells",
+        comm_cart_3d);
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+
+  /* free mem and finalize */
+  pnfft_free(x); pnfft_free(f_hat); pnfft_free(f); pnfft_free(f_ref);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return err;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+/* random nodes of the local block, at least margin away from the global border */
+static void init_nodes(
+    const double *lower_border, const double *upper_border, const double *margin,
+    ptrdiff_t local_M,
+    double *x
+    )
+{
+  double lo[3], up[3];
+
+  for(int t=0; t<3; t++){
+    lo[t] = (lower_border[t] < -0.5 + margin[t]) ? -0.5 + margin[t] : lower_border[t];
+    up[t] = (upper_border[t] >  0.5 - margin[t]) ?  0.5 - margin[t] : upper_border[t];
+  }
+
+  srand(1);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    for(int t=0; t<3; t++)
+      x[3*j+t] = lo[t] + ((double) rand()) / ((double) RAND_MAX + 1.0) * (up[t] - lo[t]);
+}
+
+/* plan with the nodes x and the boundaries of all axes, f_hat and f are set by the caller */
+static pnfft_plan init_plan(
+    const ptrdiff_t *N, const ptrdiff_t *n, const double *x_max, ptrdiff_t local_M, int m,
+    const int *boundary, int engine, const double *x, MPI_Comm comm
+    )
+{
+  pnfft_plan pnfft;
+
+  pnfft = pnfft_init_guru(3, N, n, x_max, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE, comm);
+  pnfft_set_ghost_engine(engine, pnfft);
+  pnfft_set_boundary(boundary, pnfft);
+  for(ptrdiff_t k=0; k<3*local_M; k++)
+    pnfft_get_x(pnfft)[k] = x[k];
+
+  return pnfft;
+}
+
+/* <trafo(f_hat), f> against <f_hat, adj(f)>, returns 1 above the tolerance */
+static int check_adjoint(
+    pnfft_plan pnfft, const pnfft_complex *f_hat, ptrdiff_t local_N_total,
+    const pnfft_complex *f, ptrdiff_t local_M, const char *name, MPI_Comm comm
+    )
+{
+  pnfft_complex dot[2] = {0, 0}, dot_sum[2];
+  double error;
+
+  for(ptrdiff_t l=0; l<local_N_total; l++)
+    pnfft_get_f_hat(pnfft)[l] = f_hat[l];
+  pnfft_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    dot[0] += pnfft_get_f(pnfft)[j] * conj(f[j]);
+
+  for(ptrdiff_t j=0; j<local_M; j++)
+    pnfft_get_f(pnfft)[j] = f[j];
+  pnfft_adj(pnfft);
+  for(ptrdiff_t l=0; l<local_N_total; l++)
+    dot[1] += f_hat[l] * conj(pnfft_get_f_hat(pnfft)[l]);
+
+  MPI_Allreduce(dot, dot_sum, 4, MPI_DOUBLE, MPI_SUM, comm);
+  error = cabs(dot_sum[0] - dot_sum[1]) / cabs(dot_sum[0]);
+  pfft_printf(comm, "%s: relative difference of <trafo(f_hat), f> and <f_hat, adj(f)> = %6.2e\n", name, error);
+
+  return error > 1e-10;
+}
+
+
+static double compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t l=0; l<size; l++)
+    if( cabs(data[l] - data_ref[l]) > error)
+      error = cabs(data[l] - data_ref[l]);
+
+  MPI_Allreduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, comm);
+  pfft_printf(comm, "%s: max. absolute difference = %6.2e\n", name, error_max);
+  return error_max;
+}
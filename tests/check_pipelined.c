@@ -0,0 +1,127 @@
+#include <complex.h>
+#include <pnfft.h>
+
+#define NUM_FIELDS 3
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, provided;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3], x_max[3];
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat[NUM_FIELDS], *f[NUM_FIELDS], *ref;
+  pnfft_plan pnfft;
+
+  /* the transposes run on a thread, if MPI allows it */
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++){
+    n[t] = 2*N[t];
+    x_max[t] = 0.5;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = (local_M==0) ? local_N[0]*local_N[1]*local_N[2] : local_M;
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+
+  pnfft = pnfft_init_guru(3, N, n, x_max, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_PRE_PSI, PFFT_ESTIMATE, comm_cart_3d);
+  pfft_printf(comm_cart_3d, "* MPI_THREAD_MULTIPLE %s\n", (provided >= MPI_THREAD_MULTIPLE) ? "provided" : "not provided");
+
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft));
+  pnfft_precompute_psi(pnfft);
+
+  /* different Fourier coefficients for every field */
+  for(int k=0; k<NUM_FIELDS; k++){
+    f_hat[k] = pnfft_alloc_complex(local_N_total);
+    f[k] = pnfft_alloc_complex(local_M);
+    pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+        f_hat[k]);
+    for(ptrdiff_t l=0; l<local_N_total; l++)
+      f_hat[k][l] *= (k+1) + I*k;
+  }
+
+  /* pipelined trafo against one trafo per field */
+  pnfft_trafo_pipelined(pnfft, NUM_FIELDS, f_hat, f, NULL);
+  ref = pnfft_get_f(pnfft);
+  for(int k=0; k<NUM_FIELDS; k++){
+    for(ptrdiff_t l=0; l<local_N_total; l++)
+      pnfft_get_f_hat(pnfft)[l] = f_hat[k][l];
+    pnfft_trafo(pnfft);
+    compare(f[k], ref, local_M, "* Results of pnfft_trafo_pipelined", comm_cart_3d);
+  }
+
+  /* pipelined adj against one adj per field */
+  pnfft_adj_pipelined(pnfft, NUM_FIELDS, f, f_hat);
+  ref = pnfft_get_f_hat(pnfft);
+  for(int k=0; k<NUM_FIELDS; k++){
+    for(ptrdiff_t j=0; j<local_M; j++)
+      pnfft_get_f(pnfft)[j] = f[k][j];
+    pnfft_adj(pnfft);
+    compare(f_hat[k], ref, local_N_total, "* Results of pnfft_adj_pipelined", comm_cart_3d);
+  }
+
+  /* free mem and finalize */
+  for(int k=0; k<NUM_FIELDS; k++){
+    pnfft_free(f_hat[k]);
+    pnfft_free(f[k]);
+  }
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t l=0; l<size; l++)
+    if( cabs(data[l] - data_ref[l]) > error)
+      error = cabs(data[l] - data_ref[l]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s: max. absolute difference = %6.2e\n", name, error_max);
+}
@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, double *eps, int *np, int *wisdom);
+static void check_wisdom(
+    const ptrdiff_t *N, const double *x_max, double eps, ptrdiff_t local_M,
+    const ptrdiff_t *n, int m, MPI_Comm comm);
+static void ndft_trafo(
+    const ptrdiff_t *N, const pnfft_complex *f_hat_global,
+    ptrdiff_t M, const double *x,
+    pnfft_complex *f);
+static void compare_f(
+    const pnfft_complex *f_pnfft, const pnfft_complex *f_nfft, ptrdiff_t local_M,
+    double f_hat_sum, const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, wisdom;
+  unsigned pfft_flags;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], N_start[3];
+  double lower_border[3], upper_border[3], x_max[3] = {0.5,0.5,0.5};
+  double eps, local_sum = 0, f_hat_sum;
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat, *f, *f_hat_global, *f_ndft;
+  double *x;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  eps = 1e-8;
+  np[0]=2; np[1]=2; np[2]=2;
+  wisdom = 0;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &eps, np, &wisdom);
+  local_M = (local_M==0) ? N[0]*N[1]*N[2]/(np[0]*np[1]*np[2]) : local_M;
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  /* let the planner choose n, m and the window, with wisdom the candidates are timed */
+  pfft_flags = (wisdom) ? PFFT_MEASURE : PFFT_ESTIMATE;
+  pnfft = pnfft_init_guru_eps(3, N, x_max, eps, local_M,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, pfft_flags,
+      comm_cart_3d);
+  if(pnfft == NULL){
+    MPI_Finalize();
+    return 1;
+  }
+
+  m = pnfft_get_m(pnfft);
+  pnfft_get_n(pnfft, n);
+  pfft_printf(comm_cart_3d, "* Planner chose n = %td x %td x %td, m = %d for eps = %.2e\n", n[0], n[1], n[2], m, eps);
+  pfft_printf(comm_cart_3d, "* A priori error estimate of the plan = %6.2e\n", pnfft_get_error_estimate(pnfft));
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+
+  f_hat = pnfft_get_f_hat(pnfft);
+  f     = pnfft_get_f(pnfft);
+  x     = pnfft_get_x(pnfft);
+
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat);
+  for(ptrdiff_t k=0; k<local_N[0]*local_N[1]*local_N[2]; k++)
+    local_sum += cabs(f_hat[k]);
+  MPI_Allreduce(&local_sum, &f_hat_sum, 1, MPI_DOUBLE, MPI_SUM, comm_cart_3d);
+
+  /* every process knows all Fourier coefficients for the serial NDFT */
+  for(int t=0; t<3; t++)
+    N_start[t] = -N[t]/2;
+  f_hat_global = pnfft_alloc_complex(N[0]*N[1]*N[2]);
+  pnfft_init_f_hat_3d(N, N, N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat_global);
+
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      x);
+
+  pnfft_trafo(pnfft);
+
+  f_ndft = pnfft_alloc_complex(local_M);
+  ndft_trafo(N, f_hat_global, local_M, x, f_ndft);
+  compare_f(f, f_ndft, local_M, f_hat_sum, "* Results in", comm_cart_3d);
+
+  if(wisdom)
+    check_wisdom(N, x_max, eps, local_M, n, m, comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_free(f_ndft); pnfft_free(f_hat_global);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, double *eps, int *np, int *wisdom
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_eps", 1, PFFT_DOUBLE, eps);
+  pfft_get_args(argc, argv, "-pnfft_wisdom", 1, PFFT_INT, wisdom);
+}
+
+
+/* Write the wisdom and the window tables, forget them and read them again, like a restarted run.
+ * The next plan must take the same choice without timing. */
+static void check_wisdom(
+    const ptrdiff_t *N, const double *x_max, double eps, ptrdiff_t local_M,
+    const ptrdiff_t *n, int m, MPI_Comm comm
+    )
+{
+  ptrdiff_t n_wisdom[3];
+  double time;
+  pnfft_plan pnfft;
+
+  if( pnfft_export_wisdom("check_planner.wisdom", comm) ){
+    pfft_printf(comm, "* Export of wisdom failed\n");
+    return;
+  }
+  if( pnfft_save_table_cache("check_planner.tables", comm) ){
+    pfft_printf(comm, "* Saving the table cache failed\n");
+    return;
+  }
+  pnfft_forget_wisdom();
+  pnfft_forget_table_cache();
+  if( pnfft_import_wisdom("check_planner.wisdom", comm) ){
+    pfft_printf(comm, "* Import of wisdom failed\n");
+    return;
+  }
+  if( pnfft_load_table_cache("check_planner.tables", comm) ){
+    pfft_printf(comm, "* Loading the table cache failed\n");
+    return;
+  }
+
+  time = -MPI_Wtime();
+  pnfft = pnfft_init_guru_eps(3, N, x_max, eps, local_M,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_MEASURE,
+      comm);
+  time += MPI_Wtime();
+
+  pnfft_get_n(pnfft, n_wisdom);
+  pfft_printf(comm, "* Plan from wisdom took %.2e s and chose n = %td x %td x %td, m = %d (%s)\n",
+      time, n_wisdom[0], n_wisdom[1], n_wisdom[2], pnfft_get_m(pnfft),
+      (n_wisdom[0] == n[0] && n_wisdom[1] == n[1] && n_wisdom[2] == n[2] && pnfft_get_m(pnfft) == m) ? "same choice" : "different choice");
+
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+}
+
+
+static void ndft_trafo(
+    const ptrdiff_t *N, const pnfft_complex *f_hat_global,
+    ptrdiff_t M, const double *x,
+    pnfft_complex *f
+    )
+{
+  for(ptrdiff_t j=0; j<M; j++){
+    ptrdiff_t l=0;
+    f[j] = 0;
+    for(ptrdiff_t k0=-N[0]/2; k0<N[0]/2; k0++)
+      for(ptrdiff_t k1=-N[1]/2; k1<N[1]/2; k1++)
+        for(ptrdiff_t k2=-N[2]/2; k2<N[2]/2; k2++, l++)
+          f[j] += f_hat_global[l] * cexp(-2.0 * PNFFT_PI * I * (k0*x[3*j+0] + k1*x[3*j+1] + k2*x[3*j+2]));
+  }
+}
+
+
+static void compare_f(
+    const pnfft_complex *f_pnfft, const pnfft_complex *f_nfft, ptrdiff_t local_M,
+    double f_hat_sum, const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t j=0; j<local_M; j++)
+    if( cabs(f_pnfft[j]-f_nfft[j]) > error)
+      error = cabs(f_pnfft[j]-f_nfft[j]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s absolute error = %6.2e\n", name, error_max);
+  pfft_printf(comm, "%s relative error = %6.2e\n", name, error_max/f_hat_sum);
+}
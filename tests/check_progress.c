@@ -0,0 +1,44 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* split-phase execution, the caller would compute between the calls,
+   * the persistent ghost cell engine overlaps its messages with the calls */
+  const int modes[3] = {PNFFT_PROGRESS_CALLS, PNFFT_PROGRESS_THREAD, PNFFT_PROGRESS_CALLS};
+  const int engines[3] = {PNFFT_GHOSTS_PFFT, PNFFT_GHOSTS_PFFT, PNFFT_GHOSTS_PERSISTENT};
+  const char *trafo_names[3] = {"* PNFFT_PROGRESS_CALLS, trafo", "* PNFFT_PROGRESS_THREAD, trafo",
+    "* PNFFT_PROGRESS_CALLS, persistent ghost cells, trafo"};
+  const char *adj_names[3] = {"* PNFFT_PROGRESS_CALLS, adj", "* PNFFT_PROGRESS_THREAD, adj",
+    "* PNFFT_PROGRESS_CALLS, persistent ghost cells, adj"};
+  for(int i=0; i<3; i++){
+    pnfft = check_fixture_plan(&fx, 0);
+    pnfft_set_progress(modes[i], pnfft);
+    pnfft_set_ghost_engine(engines[i], pnfft);
+
+    for(ptrdiff_t l=0; l<fx.local_N_total; l++)
+      pnfft_get_f_hat(pnfft)[l] = fx.f_hat[l];
+    pnfft_trafo_start(pnfft);
+    while(!pnfft_progress(pnfft));
+    pnfft_trafo_wait(pnfft);
+    check_fixture_compare(&fx, pnfft_get_f(pnfft), fx.f_ref, fx.local_M, CHECK_TOL_EXACT, trafo_names[i]);
+
+    for(ptrdiff_t j=0; j<fx.local_M; j++)
+      pnfft_get_f(pnfft)[j] = fx.f_ref[j];
+    pnfft_adj_start(pnfft);
+    while(!pnfft_progress(pnfft));
+    pnfft_adj_wait(pnfft);
+    check_fixture_compare(&fx, pnfft_get_f_hat(pnfft), fx.f_hat_ref, fx.local_N_total, CHECK_TOL_EXACT, adj_names[i]);
+
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+
+  return check_fixture_finish(&fx);
+}
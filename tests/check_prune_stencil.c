@@ -0,0 +1,21 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* the stencil skips the grid points with negligible window values */
+  pnfft = check_fixture_plan(&fx, 0);
+  pnfft_set_prune_stencil(1, pnfft);
+  check_fixture_trafo(&fx, pnfft, CHECK_TOL_WINDOW, "* Pruned stencil, trafo");
+  check_fixture_adj(&fx, pnfft, CHECK_TOL_WINDOW, "* Pruned stencil, adj");
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+
+  return check_fixture_finish(&fx);
+}
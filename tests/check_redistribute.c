@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void ndft_trafo(
+    const ptrdiff_t *N, const pnfft_complex *f_hat_global,
+    ptrdiff_t M, const double *x,
+    pnfft_complex *f);
+static void compare_f(
+    const pnfft_complex *f_pnfft, const pnfft_complex *f_nfft, ptrdiff_t local_M,
+    double f_hat_sum, const char *name, MPI_Comm comm);
+static int check_balanced_procmesh(
+    const ptrdiff_t *N, const ptrdiff_t *n, int m, const int *np,
+    ptrdiff_t M, const double *x, MPI_Comm comm);
+static double node_imbalance(
+    const ptrdiff_t *N, const ptrdiff_t *n, int m, const int *np,
+    ptrdiff_t M, const double *x);
+
+
+int main(int argc, char **argv){
+  int np[3], np_balanced[3], m, myrank, err;
+  ptrdiff_t N[3], n[3], user_M, local_N[3], local_N_start[3], N_start[3];
+  double lower_border[3], upper_border[3], local_sum = 0, f_hat_sum;
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat, *f_hat_global, *f_user, *f_ndft;
+  double *x_user, *x_skewed;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  user_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &user_M, &m, np);
+  user_M = (user_M==0) ? N[0]*N[1]*N[2]/(np[0]*np[1]*np[2]) : user_M;
+  for(int t=0; t<3; t++)
+    n[t] = 2*N[t];
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+  MPI_Comm_rank(comm_cart_3d, &myrank);
+
+  pnfft_local_size_guru(3, N, n, (double[3]){0.5,0.5,0.5}, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+
+  /* the plan gets its nodes from pnfft_redistribute_nodes */
+  pnfft = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, 0, m,
+      PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+  f_hat = pnfft_get_f_hat(pnfft);
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat);
+
+  for(ptrdiff_t k=0; k<local_N[0]*local_N[1]*local_N[2]; k++)
+    local_sum += cabs(f_hat[k]);
+  MPI_Allreduce(&local_sum, &f_hat_sum, 1, MPI_DOUBLE, MPI_SUM, comm_cart_3d);
+
+  /* every process knows all Fourier coefficients for the serial NDFT */
+  for(int t=0; t<3; t++)
+    N_start[t] = -N[t]/2;
+  f_hat_global = pnfft_alloc_complex(N[0]*N[1]*N[2]);
+  pnfft_init_f_hat_3d(N, N, N_start, PNFFT_TRANSPOSED_NONE,
+      f_hat_global);
+
+  /* nodes are scattered over the whole domain on every process */
+  x_user = pnfft_alloc_real(3*user_M);
+  f_user = pnfft_alloc_complex(user_M);
+  f_ndft = pnfft_alloc_complex(user_M);
+  srand(myrank);
+  for(ptrdiff_t j=0; j<3*user_M; j++)
+    x_user[j] = ((double) rand()) / ((double) RAND_MAX + 1.0) - 0.5;
+
+  pnfft_redistribute_nodes(pnfft, user_M, x_user);
+  pnfft_trafo_redistributed(pnfft, f_user, NULL);
+
+  ndft_trafo(N, f_hat_global, user_M, x_user, f_ndft);
+  compare_f(f_user, f_ndft, user_M, f_hat_sum, "* Results in", comm_cart_3d);
+
+  /* second call reuses the communication pattern */
+  pnfft_trafo_redistributed(pnfft, f_user, NULL);
+  compare_f(f_user, f_ndft, user_M, f_hat_sum, "* Repeated call results in", comm_cart_3d);
+
+  /* nodes per process after the redistribution and the mesh that would balance them */
+  pnfft_print_load_balance(pnfft, comm_cart_3d);
+  if( !pnfft_balanced_procmesh(3, n, user_M, x_user, comm_cart_3d, np_balanced) )
+    pfft_printf(comm_cart_3d, "* Balanced procmesh for these nodes: %d x %d x %d\n", np_balanced[0], np_balanced[1], np_balanced[2]);
+
+  /* nodes crowded into the first quarter of axis 0, the balanced mesh has to beat np */
+  x_skewed = pnfft_alloc_real(3*user_M);
+  for(ptrdiff_t j=0; j<user_M; j++){
+    x_skewed[3*j+0] = 0.25 * ((double) rand()) / ((double) RAND_MAX + 1.0) - 0.5;
+    x_skewed[3*j+1] = ((double) rand()) / ((double) RAND_MAX + 1.0) - 0.5;
+    x_skewed[3*j+2] = ((double) rand()) / ((double) RAND_MAX + 1.0) - 0.5;
+  }
+  err = check_balanced_procmesh(N, n, m, np, user_M, x_skewed, comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_free(x_user); pnfft_free(x_skewed); pnfft_free(f_user); pnfft_free(f_ndft);
+  pnfft_free(f_hat_global);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return err;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void ndft_trafo(
+    const ptrdiff_t *N, const pnfft_complex *f_hat_global,
+    ptrdiff_t M, const double *x,
+    pnfft_complex *f
+    )
+{
+  for(ptrdiff_t j=0; j<M; j++){
+    ptrdiff_t l=0;
+    f[j] = 0;
+    for(ptrdiff_t k0=-N[0]/2; k0<N[0]/2; k0++)
+      for(ptrdiff_t k1=-N[1]/2; k1<N[1]/2; k1++)
+        for(ptrdiff_t k2=-N[2]/2; k2<N[2]/2; k2++, l++)
+          f[j] += f_hat_global[l] * cexp(-2.0 * PNFFT_PI * I * (k0*x[3*j+0] + k1*x[3*j+1] + k2*x[3*j+2]));
+  }
+}
+
+
+static void compare_f(
+    const pnfft_complex *f_pnfft, const pnfft_complex *f_nfft, ptrdiff_t local_M,
+    double f_hat_sum, const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t j=0; j<local_M; j++)
+    if( cabs(f_pnfft[j]-f_nfft[j]) > error)
+      error = cabs(f_pnfft[j]-f_nfft[j]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s absolute error = %6.2e\n", name, error_max);
+  pfft_printf(comm, "%s relative error = %6.2e\n", name, error_max/f_hat_sum);
+}
+
+/* pnfft_balanced_procmesh for the nodes x has to factorize the number of processes and must not
+ * distribute x worse than the mesh np, returns 1 otherwise */
+static int check_balanced_procmesh(
+    const ptrdiff_t *N, const ptrdiff_t *n, int m, const int *np,
+    ptrdiff_t M, const double *x, MPI_Comm comm
+    )
+{
+  int size, np_balanced[3];
+  double imbalance, imbalance_balanced;
+
+  MPI_Comm_size(comm, &size);
+  if( pnfft_balanced_procmesh(3, n, M, x, comm, np_balanced) ){
+    pfft_printf(comm, "* Balanced procmesh for skewed nodes: none found, failed\n");
+    return 1;
+  }
+  if(np_balanced[0] * np_balanced[1] * np_balanced[2] != size){
+    pfft_printf(comm, "* Balanced procmesh for skewed nodes: %d x %d x %d does not fit to %d processes, failed\n",
+        np_balanced[0], np_balanced[1], np_balanced[2], size);
+    return 1;
+  }
+
+  imbalance = node_imbalance(N, n, m, np, M, x);
+  imbalance_balanced = node_imbalance(N, n, m, np_balanced, M, x);
+  pfft_printf(comm, "* Skewed nodes, max/avg nodes per process: %.2f on %d x %d x %d, %.2f on balanced %d x %d x %d%s\n",
+      imbalance, np[0], np[1], np[2], imbalance_balanced, np_balanced[0], np_balanced[1], np_balanced[2],
+      (imbalance_balanced > imbalance * (1.0 + 1e-12)) ? ", failed" : "");
+
+  return imbalance_balanced > imbalance * (1.0 + 1e-12);
+}
+
+/* max/avg of the nodes per process after pnfft_redistribute_nodes on the mesh np */
+static double node_imbalance(
+    const ptrdiff_t *N, const ptrdiff_t *n, int m, const int *np,
+    ptrdiff_t M, const double *x
+    )
+{
+  int size;
+  double local, max, sum;
+  MPI_Comm comm_cart_3d;
+  pnfft_plan pnfft;
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) )
+    return 1e300;
+  MPI_Comm_size(comm_cart_3d, &size);
+
+  pnfft = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, 0, m,
+      PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+  pnfft_redistribute_nodes(pnfft, M, x);
+  local = (double) pnfft_get_local_M(pnfft);
+  MPI_Allreduce(&local, &max, 1, MPI_DOUBLE, MPI_MAX, comm_cart_3d);
+  MPI_Allreduce(&local, &sum, 1, MPI_DOUBLE, MPI_SUM, comm_cart_3d);
+
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  return (sum > 0) ? max * size / sum : 1.0;
+}
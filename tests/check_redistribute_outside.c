@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+
+
+int main(int argc, char **argv){
+  int np[3], m, myrank;
+  ptrdiff_t N[3], n[3], user_M, local_M, outside_M = 0, kept_M = 0;
+  int sum[4], local[4];
+  MPI_Comm comm_cart_3d;
+  double *x_user, *x;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values, a small mesh with less processes than mesh dimensions */
+  N[0] = N[1] = N[2] = 16;
+  user_M = 1000;
+  m = 6;
+  np[0]=2; np[1]=1; np[2]=1;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &user_M, &m, np);
+  for(int t=0; t<3; t++)
+    n[t] = 2*N[t];
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+  MPI_Comm_rank(comm_cart_3d, &myrank);
+
+  pnfft = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, 0, m,
+      PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE,
+      comm_cart_3d);
+
+  /* every fourth node lies beyond x_max, i.e., outside of every block */
+  x_user = pnfft_alloc_real(3*user_M);
+  srand(myrank);
+  for(ptrdiff_t j=0; j<user_M; j++){
+    for(int t=0; t<3; t++)
+      x_user[3*j+t] = ((double) rand()) / ((double) RAND_MAX + 1.0) - 0.5;
+    if(j%4 == 0){
+      x_user[3*j] += 1.0;
+      outside_M++;
+    }
+  }
+
+  pnfft_redistribute_nodes(pnfft, user_M, x_user);
+
+  /* the nodes outside of all blocks have to stay at the calling process */
+  local_M = pnfft_get_local_M(pnfft);
+  x = pnfft_get_x(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    if(x[3*j] >= 0.5)
+      kept_M++;
+
+  local[0] = (int) user_M; local[1] = (int) local_M;
+  local[2] = (kept_M == outside_M) ? 0 : 1;
+  local[3] = (int) outside_M;
+  MPI_Allreduce(local, sum, 4, MPI_INT, MPI_SUM, comm_cart_3d);
+
+  pfft_printf(comm_cart_3d, "* %d of %d nodes lie outside of all blocks\n", sum[3], sum[0]);
+  pfft_printf(comm_cart_3d, "* Total number of nodes after redistribution: %d (expected %d)\n", sum[1], sum[0]);
+  pfft_printf(comm_cart_3d, "* Processes that did not keep their outside nodes: %d\n", sum[2]);
+
+  /* free mem and finalize */
+  pnfft_free(x_user);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
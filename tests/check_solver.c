@@ -0,0 +1,129 @@
+#include <complex.h>
+#include <math.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *iter, int *np);
+static void run_solver(
+    unsigned solver_flags, int iter, const pnfft_complex *f, const pnfft_complex *f_hat_ref,
+    ptrdiff_t local_N_total, ptrdiff_t local_M, const char *name,
+    pnfft_plan pnfft, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, iter;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3], local_N_total;
+  double lower_border[3], upper_border[3];
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_hat_ref, *f;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  iter = 20;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, &iter, np);
+  for(int t=0; t<3; t++)
+    n[t] = 2*N[t];
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, (double[3]){0.5,0.5,0.5}, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_N_total = local_N[0]*local_N[1]*local_N[2];
+  local_M = (local_M==0) ? 2*local_N_total : local_M;
+
+  pnfft = pnfft_init_guru(3, N, n, (double[3]){0.5,0.5,0.5}, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE, comm_cart_3d);
+
+  /* samples of known Fourier coefficients */
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft));
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      pnfft_get_f_hat(pnfft));
+  pnfft_precompute_psi(pnfft);
+  pnfft_trafo(pnfft);
+
+  f_hat_ref = pnfft_alloc_complex(local_N_total);
+  f         = pnfft_alloc_complex(local_M);
+  for(ptrdiff_t k=0; k<local_N_total; k++)
+    f_hat_ref[k] = pnfft_get_f_hat(pnfft)[k];
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f[j] = pnfft_get_f(pnfft)[j];
+
+  run_solver(PNFFT_SOLVER_CGNR, iter, f, f_hat_ref, local_N_total, local_M, "CGNR", pnfft, comm_cart_3d);
+  run_solver(PNFFT_SOLVER_CGNE, iter, f, f_hat_ref, local_N_total, local_M, "CGNE", pnfft, comm_cart_3d);
+  run_solver(PNFFT_SOLVER_CGNR| PNFFT_SOLVER_PRECOMPUTE_WEIGHT| PNFFT_SOLVER_PRECOMPUTE_DAMP, iter, f, f_hat_ref,
+      local_N_total, local_M, "CGNR with unit weights", pnfft, comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_free(f_hat_ref);
+  pnfft_free(f);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *iter, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+  pfft_get_args(argc, argv, "-pnfft_iter", 1, PFFT_INT, iter);
+}
+
+
+/* start from zero and compare with the coefficients that produced the samples */
+static void run_solver(
+    unsigned solver_flags, int iter, const pnfft_complex *f, const pnfft_complex *f_hat_ref,
+    ptrdiff_t local_N_total, ptrdiff_t local_M, const char *name,
+    pnfft_plan pnfft, MPI_Comm comm
+    )
+{
+  double error = 0, norm = 0, error_sum, norm_sum, dot_r_init;
+  pnfft_complex *y, *f_hat_iter;
+  pnfft_solver solver;
+
+  solver = pnfft_init_solver(pnfft, solver_flags);
+  y = pnfft_solver_get_y(solver);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    y[j] = f[j];
+
+  pnfft_solver_before_loop(solver);
+  dot_r_init = pnfft_solver_get_dot_r_iter(solver);
+  for(int l=0; l<iter; l++)
+    pnfft_solver_loop_one_step(solver);
+
+  f_hat_iter = pnfft_solver_get_f_hat_iter(solver);
+  for(ptrdiff_t k=0; k<local_N_total; k++){
+    error += pow(cabs(f_hat_iter[k] - f_hat_ref[k]), 2);
+    norm  += pow(cabs(f_hat_ref[k]), 2);
+  }
+  MPI_Reduce(&error, &error_sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(&norm, &norm_sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  pfft_printf(comm, "* %s after %d steps: relative residual = %6.2e, relative error of f_hat = %6.2e\n",
+      name, iter, sqrt(pnfft_solver_get_dot_r_iter(solver) / dot_r_init), sqrt(error_sum / norm_sum));
+
+  pnfft_finalize_solver(solver);
+}
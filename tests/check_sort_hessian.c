@@ -0,0 +1,127 @@
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3];
+  double lower_border[3], upper_border[3], x_max[3];
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *f_ref, *grad_f_ref, *hessian_f_ref, *f_sorted, *grad_f_sorted, *hessian_f_sorted;
+  const ptrdiff_t *node_order;
+  pnfft_plan pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++){
+    n[t] = 2*N[t];
+    x_max[t] = 0.5;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = (local_M==0) ? local_N[0]*local_N[1]*local_N[2] : local_M;
+
+  pnfft = pnfft_init_guru(3, N, n, x_max, local_M, m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_MALLOC_GRAD_F| PNFFT_MALLOC_HESSIAN_F,
+      PFFT_ESTIMATE, comm_cart_3d);
+
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      pnfft_get_f_hat(pnfft));
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft));
+
+  /* nodes in the user's order give the reference */
+  f_ref = pnfft_alloc_complex(local_M);
+  grad_f_ref = pnfft_alloc_complex(3*local_M);
+  hessian_f_ref = pnfft_alloc_complex(6*local_M);
+  f_sorted = pnfft_alloc_complex(local_M);
+  grad_f_sorted = pnfft_alloc_complex(3*local_M);
+  hessian_f_sorted = pnfft_alloc_complex(6*local_M);
+
+  pnfft_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++){
+    f_ref[j] = pnfft_get_f(pnfft)[j];
+    for(int t=0; t<3; t++) grad_f_ref[3*j+t] = pnfft_get_grad_f(pnfft)[3*j+t];
+    for(int t=0; t<6; t++) hessian_f_ref[6*j+t] = pnfft_get_hessian_f(pnfft)[6*j+t];
+  }
+
+  /* sorted nodes, every result is mapped back by the node order */
+  pnfft_sort_nodes(pnfft);
+  pnfft_trafo(pnfft);
+  node_order = pnfft_get_node_order(pnfft);
+  for(ptrdiff_t p=0; p<local_M; p++){
+    ptrdiff_t j = (node_order != NULL) ? node_order[p] : p;
+    f_sorted[j] = pnfft_get_f(pnfft)[p];
+    for(int t=0; t<3; t++) grad_f_sorted[3*j+t] = pnfft_get_grad_f(pnfft)[3*p+t];
+    for(int t=0; t<6; t++) hessian_f_sorted[6*j+t] = pnfft_get_hessian_f(pnfft)[6*p+t];
+  }
+  compare(f_sorted, f_ref, local_M, "* Sorted nodes, f", comm_cart_3d);
+  compare(grad_f_sorted, grad_f_ref, 3*local_M, "* Sorted nodes, grad_f", comm_cart_3d);
+  compare(hessian_f_sorted, hessian_f_ref, 6*local_M, "* Sorted nodes, hessian_f", comm_cart_3d);
+
+  /* unsorting has to restore the Hessian of every node together with f */
+  pnfft_unsort_nodes(pnfft);
+  compare(pnfft_get_f(pnfft), f_ref, local_M, "* Unsorted nodes, f", comm_cart_3d);
+  compare(pnfft_get_hessian_f(pnfft), hessian_f_ref, 6*local_M, "* Unsorted nodes, hessian_f", comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_free(f_ref); pnfft_free(grad_f_ref); pnfft_free(hessian_f_ref);
+  pnfft_free(f_sorted); pnfft_free(grad_f_sorted); pnfft_free(hessian_f_sorted);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_GRAD_F | PNFFT_FREE_HESSIAN_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void compare(
+    const pnfft_complex *data, const pnfft_complex *data_ref, ptrdiff_t size,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t l=0; l<size; l++)
+    if( cabs(data[l] - data_ref[l]) > error)
+      error = cabs(data[l] - data_ref[l]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s: max. absolute difference = %6.2e\n", name, error_max);
+}
@@ -0,0 +1,24 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* spreading of the nodes in the order of every sort key */
+  const int keys[3] = {PNFFT_SORT_KEYS_PLAIN, PNFFT_SORT_KEYS_TILED, PNFFT_SORT_KEYS_MORTON};
+  const char *adj_names[3] = {"* PNFFT_SORT_KEYS_PLAIN, adj", "* PNFFT_SORT_KEYS_TILED, adj", "* PNFFT_SORT_KEYS_MORTON, adj"};
+  for(int i=0; i<3; i++){
+    pnfft = check_fixture_plan(&fx, PNFFT_SORT_NODES);
+    pnfft_set_sort_keys(keys[i], pnfft);
+    check_fixture_adj(&fx, pnfft, CHECK_TOL_EXACT, adj_names[i]);
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+
+  return check_fixture_finish(&fx);
+}
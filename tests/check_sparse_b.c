@@ -0,0 +1,28 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the default plan gives the reference */
+  check_fixture_reference(&fx);
+
+  /* the matrix B of the fixed nodes is stored in double and in single precision */
+  const int modes[2] = {PNFFT_SPARSE_B, PNFFT_SPARSE_B_SINGLE};
+  const double tols[2] = {CHECK_TOL_EXACT, CHECK_TOL_SINGLE};
+  const char *trafo_names[2] = {"* PNFFT_SPARSE_B, trafo", "* PNFFT_SPARSE_B_SINGLE, trafo"};
+  const char *adj_names[2] = {"* PNFFT_SPARSE_B, adj", "* PNFFT_SPARSE_B_SINGLE, adj"};
+  for(int i=0; i<2; i++){
+    pnfft = check_fixture_plan(&fx, 0);
+    pnfft_set_sparse_b(modes[i], 0, pnfft);
+    pnfft_precompute_psi(pnfft);
+    check_fixture_trafo(&fx, pnfft, tols[i], trafo_names[i]);
+    check_fixture_adj(&fx, pnfft, tols[i], adj_names[i]);
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+
+  return check_fixture_finish(&fx);
+}
@@ -0,0 +1,65 @@
+#include "check_fixture.h"
+
+static void trafo_vs_ndft(
+    check_fixture *fx, MPI_Comm comm_cart_3d, const char *name);
+
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  int np_topo[3];
+  MPI_Comm comm_topo;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* the given procmesh gives the reference */
+  trafo_vs_ndft(&fx, fx.comm, "* Given procmesh, trafo");
+
+  /* the procmesh with the least communication between shared memory nodes */
+  pnfft_print_procmesh_volume(3, fx.n, fx.m, MPI_COMM_WORLD);
+  if( pnfft_topology_procmesh(3, fx.n, fx.m, MPI_COMM_WORLD, np_topo) )
+    pfft_printf(MPI_COMM_WORLD, "Warning: No topology-aware procmesh fits.\n");
+  else if( pnfft_create_procmesh_topology(3, MPI_COMM_WORLD, np_topo, &comm_topo) ){
+    pfft_printf(MPI_COMM_WORLD, "* Topology-aware procmesh %d x %d x %d can not be created, failed\n", np_topo[0], np_topo[1], np_topo[2]);
+    fx.err = 1;
+  } else {
+    pfft_printf(MPI_COMM_WORLD, "* Topology-aware procmesh: %d x %d x %d\n", np_topo[0], np_topo[1], np_topo[2]);
+    trafo_vs_ndft(&fx, comm_topo, "* Topology-aware procmesh, trafo");
+    MPI_Comm_free(&comm_topo);
+  }
+
+  return check_fixture_finish(&fx);
+}
+
+
+/* trafo on the procmesh comm_cart_3d against the NDFT */
+static void trafo_vs_ndft(
+    check_fixture *fx, MPI_Comm comm_cart_3d, const char *name
+    )
+{
+  ptrdiff_t local_M, local_N[3], local_N_start[3];
+  double lower_border[3], upper_border[3];
+  pnfft_complex *f_ndft;
+  pnfft_plan pnfft;
+
+  pnfft_local_size_guru(3, fx->N, fx->n, fx->x_max, fx->m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = local_N[0]*local_N[1]*local_N[2];
+
+  pnfft = pnfft_init_guru(3, fx->N, fx->n, fx->x_max, local_M, fx->m,
+      PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F, PFFT_ESTIMATE, comm_cart_3d);
+  pnfft_init_f_hat_3d(fx->N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      pnfft_get_f_hat(pnfft));
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft));
+
+  f_ndft = pnfft_alloc_complex(local_M);
+  pnfft_direct_trafo(pnfft);
+  for(ptrdiff_t j=0; j<local_M; j++)
+    f_ndft[j] = pnfft_get_f(pnfft)[j];
+  pnfft_trafo(pnfft);
+  check_fixture_compare(fx, pnfft_get_f(pnfft), f_ndft, local_M, CHECK_TOL_WINDOW, name);
+
+  pnfft_free(f_ndft);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+}
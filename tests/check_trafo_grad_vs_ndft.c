@@ -4,14 +4,14 @@
 
 static void pnfft_perform_guru(
     const ptrdiff_t *N, const ptrdiff_t *n, ptrdiff_t local_M,
-    int m, const double *x_max, unsigned pnfft_flags,
+    int m, const double *x_max, unsigned pnfft_flags, ptrdiff_t pre_psi_block,
     const int *np, MPI_Comm comm);
 
 static void init_parameters(
     int argc, char **argv,
     ptrdiff_t *N, ptrdiff_t *n, ptrdiff_t *M,
-    int *m, int *window, int *intpol, int *interlacing, int *grad_ik,
-    double *x_max, int *np);
+    int *m, int *window, int *intpol, int *interlacing, int *grad_ik, int *hessian,
+    ptrdiff_t *pre_psi_block, double *x_max, int *np);
 static void init_random_x(
     const double *lo, const double *up,
     const double *x_max, ptrdiff_t M,
@@ -22,13 +22,16 @@ static void compare_f(
 static void compare_grad_f(
     const pnfft_complex *grad_f1, const pnfft_complex *grad_f2, ptrdiff_t local_M,
     double f_hat_sum, const char *name, MPI_Comm comm);
+static void compare_hessian_f(
+    const pnfft_complex *hessian_f1, const pnfft_complex *hessian_f2, ptrdiff_t local_M,
+    double f_hat_sum, const char *name, MPI_Comm comm);
 static double random_number_less_than_one(
     void);
 
 
 int main(int argc, char **argv){
-  int np[3], m, window, interlacing, grad_ik;
-  ptrdiff_t N[3], n[3], local_M;
+  int np[3], m, window, interlacing, grad_ik, hessian;
+  ptrdiff_t N[3], n[3], local_M, pre_psi_block;
   double x_max[3];
   
   MPI_Init(&argc, &argv);
@@ -42,12 +45,14 @@ int main(int argc, char **argv){
   window = 4;
   interlacing = 0;
   grad_ik = 0;
+  hessian = 0;
+  pre_psi_block = -1;
   x_max[0] = x_max[1] = x_max[2] = 0.5;
   np[0]=2; np[1]=2; np[2]=2;
   
   /* set values by commandline */
   int intpol = -1;
-  init_parameters(argc, argv, N, n, &local_M, &m, &window, &intpol, &interlacing, &grad_ik, x_max, np);
+  init_parameters(argc, argv, N, n, &local_M, &m, &window, &intpol, &interlacing, &grad_ik, &hessian, &pre_psi_block, x_max, np);
 
   /* if M or n are set to zero, we choose nice values */
   local_M = (local_M==0) ? N[0]*N[1]*N[2]/(np[0]*np[1]*np[2]) : local_M;
@@ -74,6 +79,8 @@ int main(int argc, char **argv){
 
   unsigned interlacing_flag = (interlacing) ? PNFFT_INTERLACED : 0;
   unsigned grad_ik_flag     = (grad_ik)     ? PNFFT_GRAD_IK : 0;
+  unsigned full_psi_flag    = (pre_psi_block >= 0) ? PNFFT_PRE_FULL_PSI : 0;
+  unsigned hessian_flag     = (hessian)     ? PNFFT_MALLOC_HESSIAN_F : 0;
 
   pfft_printf(MPI_COMM_WORLD, "******************************************************************************************************\n");
   pfft_printf(MPI_COMM_WORLD, "* Computation of parallel NFFT\n");
@@ -110,13 +117,21 @@ int main(int argc, char **argv){
     pfft_printf(MPI_COMM_WORLD, "*      grad = grad-ik (enable grad-ad with -pnfft_grad_ik 0)");
   else
     pfft_printf(MPI_COMM_WORLD, "*      grad = grad-ad (enable grad-ik with -pnfft_grad_ik 1)");
+  if(hessian)
+    pfft_printf(MPI_COMM_WORLD, "*      hessian = enabled (disable with -pnfft_hessian 0)\n");
+  else
+    pfft_printf(MPI_COMM_WORLD, "*      hessian = disabled (enable with -pnfft_hessian 1)\n");
+  if(pre_psi_block > 0)
+    pfft_printf(MPI_COMM_WORLD, "*      PNFFT_PRE_FULL_PSI in blocks of %td bytes (all nodes with -pnfft_pre_psi_block 0)\n", pre_psi_block);
+  else if(pre_psi_block == 0)
+    pfft_printf(MPI_COMM_WORLD, "*      PNFFT_PRE_FULL_PSI for all nodes (blocks with -pnfft_pre_psi_block * bytes)\n");
   pfft_printf(MPI_COMM_WORLD, "* on   np[0] x np[1] x np[2] = %td x %td x %td processes (change with -pnfft_np * * *)\n", np[0], np[1], np[2]);
   pfft_printf(MPI_COMM_WORLD, "*******************************************************************************************************\n\n");
 
 //  window_flag |= PNFFT_PRE_CUB_PSI;
 
   /* calculate parallel NFFT */
-  pnfft_perform_guru(N, n, local_M, m,   x_max, window_flag| intpol_flag| interlacing_flag| grad_ik_flag, np, MPI_COMM_WORLD);
+  pnfft_perform_guru(N, n, local_M, m,   x_max, window_flag| intpol_flag| interlacing_flag| grad_ik_flag| full_psi_flag| hessian_flag, pre_psi_block, np, MPI_COMM_WORLD);
 
   /* free mem and finalize */
   pnfft_cleanup();
@@ -127,7 +142,7 @@ int main(int argc, char **argv){
 
 static void pnfft_perform_guru(
     const ptrdiff_t *N, const ptrdiff_t *n, ptrdiff_t local_M,
-    int m, const double *x_max, unsigned pnfft_flags,
+    int m, const double *x_max, unsigned pnfft_flags, ptrdiff_t pre_psi_block,
     const int *np, MPI_Comm comm
     )
 {
@@ -136,7 +151,7 @@ static void pnfft_perform_guru(
   double lower_border[3], upper_border[3];
   double local_sum = 0, time, time_max;
   MPI_Comm comm_cart_3d;
-  pnfft_complex *f_hat, *f, *f1, *grad_f, *grad_f1;
+  pnfft_complex *f_hat, *f, *f1, *grad_f, *grad_f1, *hessian_f, *hessian_f1 = NULL;
   double *x, f_hat_sum;
   pnfft_plan pnfft;
 
@@ -160,6 +175,7 @@ static void pnfft_perform_guru(
   f_hat   = pnfft_get_f_hat(pnfft);
   f      = pnfft_get_f(pnfft);
   grad_f = pnfft_get_grad_f(pnfft);
+  hessian_f = pnfft_get_hessian_f(pnfft);
   x       = pnfft_get_x(pnfft);
 
   pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
@@ -169,6 +185,11 @@ static void pnfft_perform_guru(
   init_random_x(lower_border, upper_border, x_max, local_M,
       x);
 
+  if(pnfft_flags & PNFFT_PRE_FULL_PSI){
+    pnfft_set_pre_psi_block(pre_psi_block, pnfft);
+    pnfft_precompute_psi(pnfft);
+  }
+
   time = -MPI_Wtime();
   pnfft_trafo(pnfft);
   time += MPI_Wtime();
@@ -188,6 +209,11 @@ static void pnfft_perform_guru(
   grad_f1 = pnfft_alloc_complex(3*local_M);
   for(ptrdiff_t j=0; j<3*local_M; j++) grad_f1[j] = grad_f[j];
 
+  if(hessian_f != NULL){
+    hessian_f1 = pnfft_alloc_complex(6*local_M);
+    for(ptrdiff_t j=0; j<6*local_M; j++) hessian_f1[j] = hessian_f[j];
+  }
+
   /* execute parallel NDFT */
   time = -MPI_Wtime();
   pnfft_direct_trafo(pnfft);
@@ -200,10 +226,13 @@ static void pnfft_perform_guru(
   /* calculate error of PNFFT */
   compare_f(f1, f, local_M, f_hat_sum, "* Results in f", MPI_COMM_WORLD);
   compare_grad_f(grad_f1, grad_f, local_M, f_hat_sum, "* Results in grad_f", MPI_COMM_WORLD);
+  if(hessian_f1 != NULL)
+    compare_hessian_f(hessian_f1, hessian_f, local_M, f_hat_sum, "* Results in hessian_f", MPI_COMM_WORLD);
 
   /* free mem and finalize */
   pnfft_free(f1); pnfft_free(grad_f1);
-  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_GRAD_F | PNFFT_FREE_F_HAT);
+  if(hessian_f1 != NULL) pnfft_free(hessian_f1);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_GRAD_F | PNFFT_FREE_HESSIAN_F | PNFFT_FREE_F_HAT);
   MPI_Comm_free(&comm_cart_3d);
 }
 
@@ -211,8 +240,8 @@ static void pnfft_perform_guru(
 static void init_parameters(
     int argc, char **argv,
     ptrdiff_t *N, ptrdiff_t *n, ptrdiff_t *M,
-    int *m, int *window, int *intpol, int *interlacing, int *grad_ik,
-    double *x_max, int *np
+    int *m, int *window, int *intpol, int *interlacing, int *grad_ik, int *hessian,
+    ptrdiff_t *pre_psi_block, double *x_max, int *np
     )
 {
   pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, M);
@@ -224,6 +253,8 @@ static void init_parameters(
   pfft_get_args(argc, argv, "-pnfft_intpol", 1, PFFT_INT, intpol);
   pfft_get_args(argc, argv, "-pnfft_interlacing", 1, PFFT_INT, interlacing);
   pfft_get_args(argc, argv, "-pnfft_grad_ik", 1, PFFT_INT, grad_ik);
+  pfft_get_args(argc, argv, "-pnfft_hessian", 1, PFFT_INT, hessian);
+  pfft_get_args(argc, argv, "-pnfft_pre_psi_block", 1, PFFT_PTRDIFF_T, pre_psi_block);
   pfft_get_args(argc, argv, "-pnfft_x_max", 3, PFFT_DOUBLE, x_max);
 }
 
@@ -276,6 +307,26 @@ static void compare_grad_f(
   pfft_printf(comm, "%sz relative error = %6.2e\n", name, error_max/f_hat_sum);
 }
 
+/* components in the order xx, xy, xz, yy, yz, zz */
+static void compare_hessian_f(
+    const pnfft_complex *hessian_f1, const pnfft_complex *hessian_f2, ptrdiff_t local_M,
+    double f_hat_sum, const char *name, MPI_Comm comm
+    )
+{
+  const char *component[6] = {"xx", "xy", "xz", "yy", "yz", "zz"};
+  double error, error_max;
+
+  for(int c=0; c<6; c++){
+    error = 0;
+    for(ptrdiff_t j=0; j<local_M; j++)
+      if( cabs(hessian_f1[6*j+c]-hessian_f2[6*j+c]) > error)
+        error = cabs(hessian_f1[6*j+c]-hessian_f2[6*j+c]);
+    MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    pfft_printf(comm, "%s%s absolute error = %6.2e\n", name, component[c], error_max);
+    pfft_printf(comm, "%s%s relative error = %6.2e\n", name, component[c], error_max/f_hat_sum);
+  }
+}
+
 static void init_random_x(
     const double *lo, const double *up,
     const double *x_max, ptrdiff_t M,
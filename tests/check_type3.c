@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    double *x_max, double *v_max, ptrdiff_t *local_M, ptrdiff_t *local_K, int *m, int *np);
+static void direct_type3(
+    ptrdiff_t M, const double *x, const pnfft_complex *c,
+    ptrdiff_t K, const double *v,
+    pnfft_complex *f);
+static void compare_f(
+    const pnfft_complex *f_pnfft, const pnfft_complex *f_direct, ptrdiff_t local_K,
+    double c_sum, const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, myrank, num_procs;
+  ptrdiff_t local_M, local_K, M, N[3];
+  double x_max[3], v_max[3], local_sum = 0, c_sum;
+  double *x, *v, *x_all;
+  MPI_Comm comm_cart_3d;
+  pnfft_complex *c, *c_all, *f, *f_direct;
+  pnfft_type3 plan;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  x_max[0] = x_max[1] = x_max[2] = 1.0;
+  v_max[0] = v_max[1] = v_max[2] = 4.0;
+  local_M = local_K = 1000;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, x_max, v_max, &local_M, &local_K, &m, np);
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+  MPI_Comm_rank(comm_cart_3d, &myrank);
+  MPI_Comm_size(comm_cart_3d, &num_procs);
+
+  plan = pnfft_init_type3(3, x_max, v_max, m, 0, PFFT_ESTIMATE, comm_cart_3d);
+  pnfft_type3_get_N(plan, N);
+  pfft_printf(comm_cart_3d, "* Space-bandwidth product gives the grid %td x %td x %td\n", N[0], N[1], N[2]);
+
+  /* nodes and frequencies are scattered over the whole domain on every process */
+  x = pnfft_alloc_real(3*local_M);
+  v = pnfft_alloc_real(3*local_K);
+  c = pnfft_alloc_complex(local_M);
+  f = pnfft_alloc_complex(local_K);
+  f_direct = pnfft_alloc_complex(local_K);
+  srand(myrank);
+  for(ptrdiff_t j=0; j<local_M; j++){
+    for(int t=0; t<3; t++)
+      x[3*j+t] = x_max[t] * (2.0 * rand() / ((double) RAND_MAX + 1.0) - 1.0);
+    c[j] = (double) rand() / RAND_MAX + I * (double) rand() / RAND_MAX;
+    local_sum += cabs(c[j]);
+  }
+  for(ptrdiff_t k=0; k<local_K; k++)
+    for(int t=0; t<3; t++)
+      v[3*k+t] = v_max[t] * (2.0 * rand() / ((double) RAND_MAX + 1.0) - 1.0);
+  MPI_Allreduce(&local_sum, &c_sum, 1, MPI_DOUBLE, MPI_SUM, comm_cart_3d);
+
+  pnfft_type3_set_nodes(plan, local_M, x, local_K, v);
+  pnfft_trafo_type3(plan, c, f);
+
+  /* every process knows all nodes for the direct sum */
+  M = local_M * num_procs;
+  x_all = pnfft_alloc_real(3*M);
+  c_all = pnfft_alloc_complex(M);
+  MPI_Allgather(x, 3*local_M, MPI_DOUBLE, x_all, 3*local_M, MPI_DOUBLE, comm_cart_3d);
+  MPI_Allgather(c, local_M, MPI_C_DOUBLE_COMPLEX, c_all, local_M, MPI_C_DOUBLE_COMPLEX, comm_cart_3d);
+  direct_type3(M, x_all, c_all, local_K, v, f_direct);
+  compare_f(f, f_direct, local_K, c_sum, "* Results in", comm_cart_3d);
+
+  /* second call reuses the nodes and the deconvolution */
+  pnfft_trafo_type3(plan, c, f);
+  compare_f(f, f_direct, local_K, c_sum, "* Repeated call results in", comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_free(x); pnfft_free(v); pnfft_free(c); pnfft_free(f); pnfft_free(f_direct);
+  pnfft_free(x_all); pnfft_free(c_all);
+  pnfft_finalize_type3(plan);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    double *x_max, double *v_max, ptrdiff_t *local_M, ptrdiff_t *local_K, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_local_K", 1, PFFT_PTRDIFF_T, local_K);
+  pfft_get_args(argc, argv, "-pnfft_x_max", 3, PFFT_DOUBLE, x_max);
+  pfft_get_args(argc, argv, "-pnfft_v_max", 3, PFFT_DOUBLE, v_max);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void direct_type3(
+    ptrdiff_t M, const double *x, const pnfft_complex *c,
+    ptrdiff_t K, const double *v,
+    pnfft_complex *f
+    )
+{
+  for(ptrdiff_t k=0; k<K; k++){
+    f[k] = 0;
+    for(ptrdiff_t j=0; j<M; j++)
+      f[k] += c[j] * cexp(-2.0 * PNFFT_PI * I * (v[3*k+0]*x[3*j+0] + v[3*k+1]*x[3*j+1] + v[3*k+2]*x[3*j+2]));
+  }
+}
+
+
+static void compare_f(
+    const pnfft_complex *f_pnfft, const pnfft_complex *f_direct, ptrdiff_t local_K,
+    double c_sum, const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t k=0; k<local_K; k++)
+    if( cabs(f_pnfft[k]-f_direct[k]) > error)
+      error = cabs(f_pnfft[k]-f_direct[k]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s absolute error = %6.2e\n", name, error_max);
+  pfft_printf(comm, "%s relative error = %6.2e\n", name, error_max/c_sum);
+}
@@ -0,0 +1,131 @@
+#include <complex.h>
+#include <pnfft.h>
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np);
+static void run_trafo(
+    const ptrdiff_t *N, const ptrdiff_t *local_N, const ptrdiff_t *local_N_start,
+    const double *x, ptrdiff_t local_M,
+    pnfft_plan pnfft);
+static void compare_f(
+    const pnfft_complex *f_ref, const pnfft_complex *f, ptrdiff_t local_M,
+    const char *name, MPI_Comm comm);
+
+
+int main(int argc, char **argv){
+  int np[3], m, err;
+  ptrdiff_t N[3], n[3], local_M, local_N[3], local_N_start[3];
+  double lower_border[3], upper_border[3], x_max[3], b[3], b_new[3];
+  unsigned pnfft_flags;
+  MPI_Comm comm_cart_3d;
+  pnfft_plan pnfft_ref, pnfft;
+
+  MPI_Init(&argc, &argv);
+  pnfft_init();
+
+  /* set default values */
+  N[0] = N[1] = N[2] = 16;
+  local_M = 0;
+  m = 6;
+  np[0]=2; np[1]=2; np[2]=2;
+
+  /* set parameters by command line */
+  init_parameters(argc, argv, N, &local_M, &m, np);
+  for(int t=0; t<3; t++){
+    n[t] = 2*N[t];
+    x_max[t] = 0.5;
+  }
+
+  if( pnfft_create_procmesh(3, MPI_COMM_WORLD, np, &comm_cart_3d) ){
+    pfft_fprintf(MPI_COMM_WORLD, stderr, "Error: Procmesh of size %d x %d x %d does not fit to number of allocated processes.\n", np[0], np[1], np[2]);
+    MPI_Finalize();
+    return 1;
+  }
+
+  pnfft_local_size_guru(3, N, n, x_max, m, comm_cart_3d, PNFFT_TRANSPOSED_NONE,
+      local_N, local_N_start, lower_border, upper_border);
+  local_M = (local_M==0) ? local_N[0]*local_N[1]*local_N[2] : local_M;
+
+  /* the updated plan must recompute the interpolation tables and the deconvolution */
+  pnfft_flags = PNFFT_MALLOC_X| PNFFT_MALLOC_F_HAT| PNFFT_MALLOC_F| PNFFT_PRE_PHI_HAT| PNFFT_PRE_INTPOL_PSI;
+  pnfft_ref = pnfft_init_guru(3, N, n, x_max, local_M, m, pnfft_flags, PFFT_ESTIMATE, comm_cart_3d);
+  pnfft     = pnfft_init_guru(3, N, n, x_max, local_M, m, pnfft_flags, PFFT_ESTIMATE, comm_cart_3d);
+
+  pnfft_init_x_3d(lower_border, upper_border, local_M,
+      pnfft_get_x(pnfft_ref));
+  run_trafo(N, local_N, local_N_start, pnfft_get_x(pnfft_ref), local_M, pnfft_ref);
+
+  /* another shape parameter changes the result within the accuracy of the window */
+  pnfft_get_b(pnfft_ref, &b[0], &b[1], &b[2]);
+  for(int t=0; t<3; t++)
+    b_new[t] = 0.9 * b[t];
+  pnfft_update_plan(NULL, b_new, pnfft);
+  run_trafo(N, local_N, local_N_start, pnfft_get_x(pnfft_ref), local_M, pnfft);
+  compare_f(pnfft_get_f(pnfft_ref), pnfft_get_f(pnfft), local_M, "* Results of trafo with 0.9*b", comm_cart_3d);
+
+  /* a smaller FFT output needs a new plan */
+  err = pnfft_update_plan((double[3]){0.1,0.1,0.1}, NULL, pnfft);
+  pfft_printf(comm_cart_3d, "* Update to x_max = 0.1 %s\n", (err) ? "refused" : "accepted");
+
+  /* going back to the old parameters must reproduce the results of the untouched plan */
+  pnfft_update_plan(x_max, b, pnfft);
+  run_trafo(N, local_N, local_N_start, pnfft_get_x(pnfft_ref), local_M, pnfft);
+  compare_f(pnfft_get_f(pnfft_ref), pnfft_get_f(pnfft), local_M, "* Results of trafo with b restored", comm_cart_3d);
+
+  /* free mem and finalize */
+  pnfft_finalize(pnfft_ref, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  MPI_Comm_free(&comm_cart_3d);
+
+  pnfft_cleanup();
+  MPI_Finalize();
+  return 0;
+}
+
+
+static void init_parameters(
+    int argc, char **argv,
+    ptrdiff_t *N, ptrdiff_t *local_M, int *m, int *np
+    )
+{
+  pfft_get_args(argc, argv, "-pnfft_local_M", 1, PFFT_PTRDIFF_T, local_M);
+  pfft_get_args(argc, argv, "-pnfft_N", 3, PFFT_PTRDIFF_T, N);
+  pfft_get_args(argc, argv, "-pnfft_np", 3, PFFT_INT, np);
+  pfft_get_args(argc, argv, "-pnfft_m", 1, PFFT_INT, m);
+}
+
+
+static void run_trafo(
+    const ptrdiff_t *N, const ptrdiff_t *local_N, const ptrdiff_t *local_N_start,
+    const double *x, ptrdiff_t local_M,
+    pnfft_plan pnfft
+    )
+{
+  double *x_plan = pnfft_get_x(pnfft);
+
+  pnfft_init_f_hat_3d(N, local_N, local_N_start, PNFFT_TRANSPOSED_NONE,
+      pnfft_get_f_hat(pnfft));
+  if(x_plan != x)
+    for(ptrdiff_t j=0; j<3*local_M; j++)
+      x_plan[j] = x[j];
+
+  pnfft_precompute_psi(pnfft);
+  pnfft_trafo(pnfft);
+}
+
+
+static void compare_f(
+    const pnfft_complex *f_ref, const pnfft_complex *f, ptrdiff_t local_M,
+    const char *name, MPI_Comm comm
+    )
+{
+  double error = 0, error_max;
+
+  for(ptrdiff_t j=0; j<local_M; j++)
+    if( cabs(f_ref[j] - f[j]) > error)
+      error = cabs(f_ref[j] - f[j]);
+
+  MPI_Reduce(&error, &error_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  pfft_printf(comm, "%s: max. absolute deviation from the untouched plan = %6.2e\n", name, error_max);
+}
@@ -0,0 +1,30 @@
+#include "check_fixture.h"
+
+int main(int argc, char **argv){
+  check_fixture fx;
+  pnfft_plan pnfft;
+  pnfft_complex *f_ndft;
+
+  if( check_fixture_init(argc, argv, &fx) )
+    return 1;
+
+  /* exponential of semicircle window, both windows against the NDFT */
+  const unsigned windows[2] = {0, PNFFT_WINDOW_ES};
+  const char *names[2] = {"* Default window, trafo", "* PNFFT_WINDOW_ES, trafo"};
+  f_ndft = pnfft_alloc_complex(fx.local_M);
+  for(int i=0; i<2; i++){
+    pnfft = check_fixture_plan(&fx, windows[i]);
+    for(ptrdiff_t l=0; l<fx.local_N_total; l++)
+      pnfft_get_f_hat(pnfft)[l] = fx.f_hat[l];
+    pnfft_direct_trafo(pnfft);
+    for(ptrdiff_t j=0; j<fx.local_M; j++)
+      f_ndft[j] = pnfft_get_f(pnfft)[j];
+    pnfft_trafo(pnfft);
+    check_fixture_compare(&fx, pnfft_get_f(pnfft), f_ndft, fx.local_M, CHECK_TOL_WINDOW, names[i]);
+    pfft_printf(fx.comm, "%s: a priori error estimate = %6.2e\n", names[i], pnfft_get_error_estimate(pnfft));
+    pnfft_finalize(pnfft, PNFFT_FREE_X | PNFFT_FREE_F | PNFFT_FREE_F_HAT);
+  }
+  pnfft_free(f_ndft);
+
+  return check_fixture_finish(&fx);
+}
@@ -152,6 +152,8 @@ int main(int argc, char **argv)
 
   pnfft_print_average_timer_adv(plan_c2c, comm_3d_c2c);
   pnfft_print_average_timer_adv(plan_c2r, comm_3d_c2r);
+  pnfft_print_profile(plan_c2c, comm_3d_c2c);
+  pnfft_print_profile(plan_c2r, comm_3d_c2r);
 
 
   /* free mem and finalize */
@@ -362,3 +362,83 @@ void PNX(sort_node_indices_radix_msdf)(INT n, INT *keys0, INT *keys1, INT rhigh)
 }
 
 
+
+/**
+ * Incremental sort for node indices that are almost sorted, e.g., if the
+ * keys of a previously sorted sequence changed only slightly.
+ * A single pass splits the sequence into a sorted subsequence, which is
+ * kept in place, and a small set of displaced elements. The displaced
+ * elements are sorted with radix sort and merged back into the sorted
+ * subsequence. Falls back to a full radix sort if more than n/4 elements
+ * are out of order. keys1 must be of the same size as keys0.
+ */
+void PNX(sort_node_indices_incremental)(INT n, INT *keys0, INT *keys1, INT rhigh)
+{
+  const INT max_displaced = n / 4;
+
+  INT i, k, v, w, nd, id, out;
+
+  /* keys0[0 .. 2*w) holds the sorted subsequence, keys1[0 .. 2*nd) the displaced elements */
+  w = nd = 0;
+  for (i = 0; i < n; ++i)
+  {
+    k = keys0[2 * i + 0];
+    v = keys0[2 * i + 1];
+
+    if (w == 0 || keys0[2 * (w - 1) + 0] <= k)
+    {
+      keys0[2 * w + 0] = k;
+      keys0[2 * w + 1] = v;
+      ++w;
+    }
+    else if (w == 1 || keys0[2 * (w - 2) + 0] <= k)
+    {
+      /* the last kept element jumped forward, displace it instead of the current one */
+      keys1[2 * nd + 0] = keys0[2 * (w - 1) + 0];
+      keys1[2 * nd + 1] = keys0[2 * (w - 1) + 1];
+      ++nd;
+      keys0[2 * (w - 1) + 0] = k;
+      keys0[2 * (w - 1) + 1] = v;
+    }
+    else
+    {
+      keys1[2 * nd + 0] = k;
+      keys1[2 * nd + 1] = v;
+      ++nd;
+    }
+
+    if (nd > max_displaced)
+    {
+      /* too many elements out of order, the free slots keys0[2*w .. 2*(i+1)) take the displaced elements */
+      memcpy(keys0 + 2 * w, keys1, nd * 2 * sizeof(INT));
+      PNX(sort_node_indices_radix_lsdf)(n, keys0, keys1, rhigh);
+      return;
+    }
+  }
+
+  if (nd == 0) return;
+
+  /* sort the displaced elements, second half of keys1 serves as buffer */
+  PNX(sort_node_indices_radix_lsdf)(nd, keys1, keys1 + 2 * nd, rhigh);
+
+  /* merge both sorted sequences from the back */
+  out = n - 1;
+  id = nd - 1;
+  --w;
+  while (id >= 0)
+  {
+    if (w >= 0 && keys0[2 * w + 0] > keys1[2 * id + 0])
+    {
+      keys0[2 * out + 0] = keys0[2 * w + 0];
+      keys0[2 * out + 1] = keys0[2 * w + 1];
+      --w;
+    }
+    else
+    {
+      keys0[2 * out + 0] = keys1[2 * id + 0];
+      keys0[2 * out + 1] = keys1[2 * id + 1];
+      --id;
+    }
+    --out;
+  }
+}